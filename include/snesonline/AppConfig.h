@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <map>
 #include <string>
 
 namespace snesonline {
@@ -8,9 +9,10 @@ namespace snesonline {
 struct AppConfig {
     // Netplay
     bool netplayEnabled = false;
-    // If true, use UDP lockstep netplay (Android-compatible) instead of GGPO.
+    // If true, use UDP lockstep netplay (Android-compatible) instead of rollback (built-in or GGPO).
     bool netplayLockstep = false;
-    // GGPO only: delay local inputs by N frames (0..GGPO_MAX_PREDICTION_FRAMES).
+    // Rollback only: delay local inputs by N frames (0..GGPO_MAX_PREDICTION_FRAMES).
+    // The built-in RollbackSession treats 0 as its default (2 frames).
     // Higher values reduce visible rollbacks/desync-looking artifacts at the cost of added input latency.
     uint8_t netplayFrameDelay = 0;
     // Must be 1 or 2.
@@ -32,6 +34,14 @@ struct AppConfig {
     // Paths
     std::string romsDir; // empty -> auto ("<exe_dir>/roms")
 
+    // Run-ahead (EmulatorEngine::setRunAheadFrames): frames of the game's own input lag to hide,
+    // 0..8. Set per ROM in the [runahead] section as "<rom file name>=N"; "default=N" covers the rest.
+    uint8_t runAheadFrames = 0;
+    // Keyed by lower-case ROM file name (no directory).
+    std::map<std::string, uint8_t> runAheadFramesByRom;
+
+    uint8_t runAheadFramesFor(const std::string& romPath) const;
+
     static std::string defaultConfigPath();
 };
 
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace snesonline {
+
+// Converts the core's stereo S16 audio (LibretroCore::sampleRateHz(), ~32 kHz for snes9x) to the
+// output device rate, and keeps the output buffer at a target fill without dropping samples.
+//
+// Emulation and the audio device run on different clocks, so a fixed ratio slowly fills or drains
+// any buffer between them. Instead of discarding the oldest samples (an audible click), the host
+// reports the buffer's fill level before each push and the resampler stretches or squeezes its
+// output by at most kAudioMaxRateAdjust: proportional to the distance from the target, plus a slow
+// integral term that absorbs a constant clock mismatch. A 0.5% pitch change is inaudible.
+//
+// The filter is a polyphase windowed sinc (kAudioResamplerTaps taps, kAudioResamplerPhases phases,
+// coefficients interpolated between neighbouring phases) over float channel buffers, so the inner
+// loops are fixed-length multiply-adds that compilers turn into SSE/NEON code. Not thread-safe:
+// call it from the thread that produces audio.
+
+static constexpr uint32_t kAudioResamplerTaps = 16;
+static constexpr uint32_t kAudioResamplerPhases = 256;
+// Largest rate change applied by the fill controller (+-0.5%).
+static constexpr double kAudioMaxRateAdjust = 0.005;
+
+class AudioResampler {
+public:
+    AudioResampler() noexcept = default;
+
+    AudioResampler(const AudioResampler&) = delete;
+    AudioResampler& operator=(const AudioResampler&) = delete;
+
+    // Builds the filter for `inputRateHz` -> `outputRateHz` and resets all state. Returns false for
+    // rates outside 8..192 kHz (or if the tables cannot be allocated); process() then passes audio
+    // through unchanged.
+    bool configure(double inputRateHz, double outputRateHz) noexcept;
+    // Clears the filter history and the fill controller (e.g. after the output buffer was flushed).
+    void reset() noexcept;
+
+    bool configured() const noexcept { return !coeffs_.empty(); }
+    double inputRateHz() const noexcept { return inputRateHz_; }
+    double outputRateHz() const noexcept { return outputRateHz_; }
+
+    // Fill controller: `bufferedFrames` is how much output is queued ahead of the device right now,
+    // `targetFrames` how much should be. Call once per push; targetFrames == 0 disables the nudge.
+    void updateFill(uint32_t bufferedFrames, uint32_t targetFrames) noexcept;
+    // Current output/input ratio including the nudge, and the nudge alone (-0.005..0.005).
+    double ratio() const noexcept { return baseRatio_ * (1.0 + adjust_); }
+    double rateAdjust() const noexcept { return adjust_; }
+
+    // Most output frames process() can produce for `inputFrames` input frames.
+    std::size_t maxOutputFrames(std::size_t inputFrames) const noexcept;
+
+    // Resamples interleaved stereo frames; returns frames written to `out` (never more than
+    // `outCapacityFrames`; size it with maxOutputFrames() so nothing is cut short).
+    std::size_t process(const int16_t* stereoFrames, std::size_t inputFrames, int16_t* out, std::size_t outCapacityFrames) noexcept;
+
+private:
+    static constexpr uint32_t kBlockFrames = 1024;
+
+    double inputRateHz_ = 0.0;
+    double outputRateHz_ = 0.0;
+    double baseRatio_ = 1.0;
+
+    // Fill controller state.
+    double adjust_ = 0.0;
+    double integral_ = 0.0;
+
+    // Phase p's taps at [p * kTaps, ...) and their slope towards phase p + 1 at the same offset in
+    // slopes_ (kPhases + 1 rows, so p + 1 always exists).
+    std::vector<float> coeffs_;
+    std::vector<float> slopes_;
+
+    // Per-channel history plus the current block, converted to float.
+    std::vector<float> left_;
+    std::vector<float> right_;
+    uint32_t buffered_ = 0;
+    // Read position in input frames relative to left_[0], 32.32 fixed point.
+    uint64_t pos_ = 0;
+};
+
+} // namespace snesonline
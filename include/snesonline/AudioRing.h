@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace snesonline {
+
+// Lock-free ring of interleaved stereo S16 frames between the emulation thread (producer, the core's
+// audio sink) and the audio device callback (consumer). Exactly one thread may push and exactly one
+// thread may pop; everything else (configuration, stats, flush requests) may be called from anywhere.
+//
+// Each side only ever moves its own index: when the ring is full, push() keeps what fits and drops
+// the newest frames; the latency cap (setMaxBufferedFrames) and flush() are applied by pop(), which
+// discards the oldest frames. Copies are at most two memcpy()s per call.
+//
+// Counters are cumulative since construction; diff two snapshots for a rate. The fill histogram
+// records how much audio was queued at each pop(), in buckets of histogramBucketFrames (the last
+// bucket also holds everything beyond it).
+class AudioRing {
+public:
+    static constexpr uint32_t kCapacityFrames = 1u << 16; // ~1.4 s at 48 kHz
+    static constexpr uint32_t kHistogramBuckets = 16;
+
+    struct Stats {
+        uint64_t pushedFrames = 0;
+        uint64_t poppedFrames = 0;
+        // Newest frames refused by push() because the ring was full.
+        uint64_t overflowFrames = 0;
+        // Oldest frames discarded by pop() for the latency cap or a flush.
+        uint64_t trimmedFrames = 0;
+        // Frames pop() was asked for but did not have.
+        uint64_t underflowFrames = 0;
+        uint32_t histogramBucketFrames = 0;
+        uint64_t fillHistogram[kHistogramBuckets] = {};
+
+        uint64_t droppedFrames() const noexcept { return overflowFrames + trimmedFrames; }
+    };
+
+    AudioRing() noexcept = default;
+
+    AudioRing(const AudioRing&) = delete;
+    AudioRing& operator=(const AudioRing&) = delete;
+
+    // Producer side. Returns frames queued (fewer than `frameCount` only when the ring is full).
+    uint32_t push(const int16_t* stereoFrames, uint32_t frameCount) noexcept;
+
+    // Consumer side. Returns frames written to `out`; the caller fills the rest with silence.
+    uint32_t pop(int16_t* outStereoFrames, uint32_t frameCount) noexcept;
+
+    // Approximate when called concurrently with either side.
+    uint32_t bufferedFrames() const noexcept;
+
+    // Latency cap applied by pop(): above `maxFrames` queued it discards the oldest, at most
+    // `maxDropPerPop` frames per pop() unless more than twice `maxFrames` is queued (0 = no per-pop
+    // limit). `maxFrames` 0 disables the cap.
+    void setMaxBufferedFrames(uint32_t maxFrames, uint32_t maxDropPerPop = 0) noexcept;
+    uint32_t maxBufferedFrames() const noexcept { return maxBuffered_.load(std::memory_order_relaxed); }
+
+    // The next pop() discards everything queued (e.g. after a latency preset change).
+    void flush() noexcept { flush_.store(true, std::memory_order_release); }
+
+    void setHistogramBucketFrames(uint32_t frames) noexcept;
+    void stats(Stats& out) const noexcept;
+
+private:
+    static constexpr uint32_t kMask = kCapacityFrames - 1;
+
+    // Single-writer counter: plain load + store, readable from any thread.
+    static void add_(std::atomic<uint64_t>& c, uint64_t n) noexcept {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // Producer-owned line.
+    alignas(64) std::atomic<uint32_t> write_{0};
+    uint32_t readCache_ = 0;
+    std::atomic<uint64_t> pushed_{0};
+    std::atomic<uint64_t> overflow_{0};
+
+    // Consumer-owned line.
+    alignas(64) std::atomic<uint32_t> read_{0};
+    std::atomic<uint64_t> popped_{0};
+    std::atomic<uint64_t> trimmed_{0};
+    std::atomic<uint64_t> underflow_{0};
+
+    // Shared configuration (rarely written).
+    alignas(64) std::atomic<uint32_t> maxBuffered_{0};
+    std::atomic<uint32_t> maxDropPerPop_{0};
+    std::atomic<uint32_t> bucketFrames_{256};
+    std::atomic<bool> flush_{false};
+
+    // Consumer-written.
+    alignas(64) std::atomic<uint64_t> histogram_[kHistogramBuckets] = {};
+
+    alignas(64) int16_t samples_[kCapacityFrames * 2] = {};
+};
+
+} // namespace snesonline
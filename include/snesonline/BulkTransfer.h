@@ -0,0 +1,230 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace snesonline {
+
+// Reliable one-way transfer of a blob (savestate, SRAM) over an existing UDP socket.
+//
+// The sender keeps a congestion window (slow start, then AIMD; halved once per round trip on loss,
+// but never below the rate of the fixed-rate chunk cycling it replaces) and retransmits exactly the
+// ranges the receiver's selective acks report missing, instead of cycling through every chunk. Its
+// first datagrams double as path MTU probes: a few larger chunks go out alongside normal-size ones
+// and, once one of them is acked, the rest of the transfer (and later transfers from the same
+// sender) use that size. A lost probe is resent in normal-size pieces and does not count as
+// congestion. A blob that arrives complete but fails its CRC is discarded; the receiver's acks then
+// carry the restart flag until it has the blob again, and the sender starts the transfer over.
+//
+// Neither side owns a socket. The caller routes incoming datagrams (peekBulkDatagram) to the right
+// object and sends what poll()/pollAck() return, e.g. with sendBulkDatagrams(), which batches them
+// into one sendmmsg() call where available. Both sides are single-threaded; call them from the
+// thread that runs the session.
+//
+// Data datagram, 24-byte header + payload:
+//   u32 magic 'SNOB', u8 channel, u8 flags, u16 payloadBytes
+//   u32 totalBytes, u32 crc32 (of the whole blob; with totalBytes, identifies the transfer)
+//   u32 offset, u32 seq (per transmission, echoed by acks)
+// Ack, 24 bytes + 8 per range:
+//   u32 magic 'SNOY', u8 channel, u8 rangeCount, u16 flags (kBulkAckFlagRestart)
+//   u32 totalBytes, u32 crc32
+//   u32 cumulativeBytes (everything below has arrived), u32 highestSeq (with the restart flag: the
+//   highest seq when the CRC check failed)
+//   rangeCount x { u32 begin, u32 end }: received byte ranges above cumulativeBytes
+// Neither is ever 8 or 12 bytes long or starts with 'S2', so lockstep peers that predate it drop both.
+
+static constexpr uint32_t kBulkDataMagic = 0x534E4F42u; // 'SNOB'
+static constexpr uint32_t kBulkAckMagic = 0x534E4F59u;  // 'SNOY'
+// Ack flag: the receiver discarded a blob that failed its CRC and needs every byte again.
+static constexpr uint16_t kBulkAckFlagRestart = 1u << 0;
+
+// Largest datagram either side produces: a full Ethernet frame over IPv6 (1500 - 40 - 8).
+static constexpr std::size_t kBulkMaxDatagramBytes = 1452;
+// Start size, safe on any IPv6 path (1280-byte minimum MTU) and through typical tunnels.
+static constexpr std::size_t kBulkBaseDatagramBytes = 1200;
+static constexpr std::size_t kBulkDataHeaderBytes = 24;
+static constexpr std::size_t kBulkAckHeaderBytes = 24;
+static constexpr std::size_t kBulkMaxAckBytes = kBulkAckHeaderBytes + 8 * 16;
+// Most datagrams one poll() returns.
+static constexpr std::size_t kBulkMaxBatch = 64;
+// Blobs above this are refused (bounds what a malformed datagram can make the receiver allocate).
+static constexpr uint32_t kBulkMaxBlobBytes = 16u * 1024u * 1024u;
+
+enum class BulkDatagramKind : uint8_t { None, Data, Ack };
+
+// Classifies a received datagram and reports its channel.
+BulkDatagramKind peekBulkDatagram(const uint8_t* data, std::size_t sizeBytes, uint8_t& outChannel) noexcept;
+
+struct BulkDatagram {
+    const uint8_t* data = nullptr;
+    std::size_t sizeBytes = 0;
+};
+
+// Sends `count` datagrams to one address in as few system calls as the platform allows (sendmmsg on
+// Linux/Android, a sendto loop elsewhere). `socket` is a native socket (fd or SOCKET), `to` a sockaddr
+// of any family. A datagram the kernel refuses is skipped. Returns how many were handed to the kernel.
+std::size_t sendBulkDatagrams(std::intptr_t socket, const BulkDatagram* datagrams, std::size_t count, const void* to,
+                              std::size_t toLenBytes) noexcept;
+
+class BulkSender {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    BulkSender() noexcept = default;
+
+    BulkSender(const BulkSender&) = delete;
+    BulkSender& operator=(const BulkSender&) = delete;
+
+    // Starts sending a copy of `data` on `channel`, replacing any transfer in progress.
+    // With `waitForReceiver`, nothing goes out until the receiver acks once (used when the transfer
+    // is offered over an older protocol and only a peer that understands it should get the data).
+    bool begin(uint8_t channel, const void* data, std::size_t sizeBytes, bool waitForReceiver = false) noexcept;
+    void cancel() noexcept;
+
+    bool active() const noexcept { return active_; }
+    // Every byte acknowledged.
+    bool done() const noexcept { return active_ && ackedBytes_ == total_; }
+    // The receiver has acked this transfer at least once.
+    bool receiverSeen() const noexcept { return receiverSeen_; }
+    uint8_t channel() const noexcept { return channel_; }
+    uint32_t totalBytes() const noexcept { return total_; }
+    uint32_t crc() const noexcept { return crc_; }
+
+    // Feed acks for this sender's channel (anything else is ignored).
+    void onDatagram(const uint8_t* data, std::size_t sizeBytes, Clock::time_point now) noexcept;
+
+    // Datagrams due now, at most min(maxCount, kBulkMaxBatch). They point into this sender and
+    // stay valid until the next poll() or begin().
+    std::size_t poll(Clock::time_point now, BulkDatagram* out, std::size_t maxCount) noexcept;
+
+    // Current datagram size (grows after a successful MTU probe) and congestion window.
+    std::size_t datagramBytes() const noexcept { return kBulkDataHeaderBytes + mss_; }
+    uint32_t windowBytes() const noexcept { return cwnd_; }
+    uint32_t srttMicros() const noexcept { return srttUs_; }
+
+    uint64_t sentDatagramCount() const noexcept { return sentDatagrams_; }
+    uint64_t retransmitCount() const noexcept { return retransmits_; }
+    uint64_t sentByteCount() const noexcept { return sentBytes_; }
+    // Times the transfer started over because the receiver's copy failed its CRC.
+    uint64_t restartCount() const noexcept { return restarts_; }
+
+private:
+    struct Segment {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+        uint32_t seq = 0;
+        Clock::time_point sentAt{};
+        bool probe = false;
+    };
+    struct Range {
+        uint32_t begin = 0;
+        uint32_t end = 0;
+    };
+
+    bool lostByReorder_(const Segment& s, Clock::time_point now) const noexcept;
+    bool isAcked_(uint32_t begin, uint32_t end) const noexcept;
+    void markAcked_(uint32_t begin, uint32_t end) noexcept;
+    void onLoss_(const Segment& s, bool timeout) noexcept;
+    void restart_() noexcept;
+    bool emit_(uint32_t offset, uint32_t length, bool probe, Clock::time_point now, std::size_t slot, BulkDatagram& out) noexcept;
+    uint32_t rtoMicros_() const noexcept;
+
+    bool active_ = false;
+    bool receiverSeen_ = false;
+    uint8_t channel_ = 0;
+    uint32_t total_ = 0;
+    uint32_t crc_ = 0;
+    std::vector<uint8_t> blob_;
+
+    // One bit per 64-byte granule; segments always start on a granule.
+    std::vector<uint64_t> acked_;
+    uint32_t ackedBytes_ = 0;
+    uint32_t nextNew_ = 0;
+    std::vector<Segment> inFlight_;
+    uint32_t inFlightBytes_ = 0;
+    std::vector<Range> lost_;
+
+    // Transmission counter (never reused, so every ack maps to one send), the newest transmission
+    // known to be acked, and the newest one sent when the window was last reduced.
+    uint32_t seq_ = 0;
+    uint32_t highestAckedSeq_ = 0;
+    uint32_t recoverySeq_ = 0;
+    uint32_t cwnd_ = 0;
+    uint32_t ssthresh_ = 0;
+    uint32_t srttUs_ = 0;
+    uint32_t rttVarUs_ = 0;
+    // Consecutive retransmission timeouts (each doubles the timeout).
+    uint32_t backoff_ = 0;
+    // The newest transmission sent when this transfer last started over, and the seq the restart
+    // ack echoed (later acks for the same failure echo it too).
+    uint32_t restartSeq_ = 0;
+    uint32_t restartEcho_ = 0;
+    bool restarted_ = false;
+
+    // Payload bytes per datagram; persists across transfers once a probe succeeded.
+    uint32_t mss_ = 0;
+    bool probesSent_ = false;
+
+    std::vector<uint8_t> scratch_;
+
+    uint64_t sentDatagrams_ = 0;
+    uint64_t retransmits_ = 0;
+    uint64_t sentBytes_ = 0;
+    uint64_t restarts_ = 0;
+};
+
+class BulkReceiver {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    BulkReceiver() noexcept = default;
+
+    BulkReceiver(const BulkReceiver&) = delete;
+    BulkReceiver& operator=(const BulkReceiver&) = delete;
+
+    // Prepares for a transfer announced out of band and acks it straight away, which tells a
+    // waiting sender (BulkSender::begin with waitForReceiver) to start. Without expect(), the first
+    // data datagram of a new transfer starts it.
+    bool expect(uint8_t channel, uint32_t totalBytes, uint32_t crc) noexcept;
+    void reset() noexcept;
+
+    // Feed data datagrams for this receiver's channel. Returns true when this datagram completed
+    // the blob and its CRC matched.
+    bool onDatagram(const uint8_t* data, std::size_t sizeBytes, Clock::time_point now) noexcept;
+
+    // Ack due now: after new data arrived, while a transfer stalls, and in reply to duplicates of a
+    // finished one (the sender may have missed the last ack). Returns its size, 0 if none is due.
+    // After a CRC mismatch it carries kBulkAckFlagRestart until the blob completes.
+    std::size_t pollAck(Clock::time_point now, uint8_t* out, std::size_t capacity) noexcept;
+
+    bool active() const noexcept { return total_ != 0; }
+    bool complete() const noexcept { return complete_; }
+    uint8_t channel() const noexcept { return channel_; }
+    uint32_t totalBytes() const noexcept { return total_; }
+    uint32_t crc() const noexcept { return crc_; }
+    uint32_t receivedBytes() const noexcept { return receivedBytes_; }
+    // The blob once complete() (stays until the next transfer starts).
+    const std::vector<uint8_t>& data() const noexcept { return blob_; }
+
+private:
+    bool start_(uint8_t channel, uint32_t totalBytes, uint32_t crc) noexcept;
+
+    uint8_t channel_ = 0;
+    uint32_t total_ = 0;
+    uint32_t crc_ = 0;
+    std::vector<uint8_t> blob_;
+    std::vector<uint64_t> have_;
+    uint32_t receivedBytes_ = 0;
+    bool complete_ = false;
+    // The blob failed its CRC; acks ask the sender to start over until it completes.
+    bool restartDue_ = false;
+    uint32_t failedSeq_ = 0;
+
+    uint32_t highestSeq_ = 0;
+    bool ackDue_ = false;
+    Clock::time_point lastAck_{};
+};
+
+} // namespace snesonline
@@ -6,6 +6,7 @@
 
 #include "snesonline/AlignedBuffer.h"
 #include "snesonline/LibretroCore.h"
+#include "snesonline/RunAheadWorker.h"
 
 namespace snesonline {
 
@@ -16,10 +17,26 @@ struct SaveState {
     uint32_t checksum = 0;
 };
 
+// What a frame's output is used for (EmulatorEngine::advanceFrame). Frames nobody will see let the
+// core skip rendering and the host skip the video sink; emulation state is the same either way.
+enum class FrameOutput : uint8_t {
+    Present,   // shown and heard
+    AudioOnly, // not shown, but its audio is part of the stream (catch-up bursts)
+    VideoOnly, // shown, audio already played (last frame of a rollback re-simulation)
+    None,      // neither (the rest of a re-simulation, replay verification)
+};
+
+// One emulator (core + per-port input). Engines are independent and may run on different threads;
+// each one is driven by one thread at a time.
 class EmulatorEngine {
 public:
+    // Process-wide default engine used by the platform apps. Tools and tests that need more than one
+    // emulator in a process construct their own.
     static EmulatorEngine& instance() noexcept;
 
+    EmulatorEngine() noexcept;
+    ~EmulatorEngine() noexcept;
+
     EmulatorEngine(const EmulatorEngine&) = delete;
     EmulatorEngine& operator=(const EmulatorEngine&) = delete;
 
@@ -36,22 +53,59 @@ public:
     uint16_t remoteInputMask() const noexcept { return inputMasks_[1].load(std::memory_order_relaxed); }
 
     // Core logic required by GGPO callbacks.
-    void advanceFrame() noexcept;
+    void advanceFrame(FrameOutput output = FrameOutput::Present) noexcept;
+
+    // Run-ahead: hides up to `frames` frames of the game's own input lag. Every frame that is shown
+    // (Present / VideoOnly) runs for real without video, then the state is saved, `frames` more
+    // frames run hidden on the same inputs, the last one is shown, and the saved state is restored.
+    // Emulation state, audio and everything netplay hashes are as without run-ahead; the cost is
+    // `frames` extra frames plus a serialize/unserialize per shown frame. Frames that are not shown
+    // run normally. 0 disables; clamped to kMaxRunAheadFrames. The snapshot buffer is allocated
+    // once and reused.
+    static constexpr uint32_t kMaxRunAheadFrames = 8;
+    void setRunAheadFrames(uint32_t frames) noexcept;
+    uint32_t runAheadFrames() const noexcept { return runAhead_; }
+
+    // Second-instance run-ahead: a second copy of the core (RunAheadWorker) on its own thread is
+    // kept `frames` ahead and produces every shown picture, while this instance only runs real
+    // frames with audio. The second copy is reloaded from this one's savestate only when the inputs
+    // change (or after a frame that was not shown, or a loadState), so with steady input the
+    // emulation thread pays one frame and nothing else. Needs a loaded game; fails if the second
+    // core cannot be loaded. The video sink is then called on the worker thread, up to a frame
+    // after advanceFrame() returns, so it must be safe to call from there (FrameExchange producers
+    // are; sinks that touch a thread-bound graphics API are not).
+    bool setRunAheadSecondInstance(bool enabled) noexcept;
+    bool runAheadSecondInstance() const noexcept { return aheadWorker_.running(); }
+    // Blocks until the second instance has delivered the picture for the last shown frame.
+    void waitForRunAhead() noexcept;
+    const RunAheadWorker& runAheadWorker() const noexcept { return aheadWorker_; }
     bool saveState(SaveState& out) noexcept;
     bool loadState(const SaveState& in) noexcept;
 
+    // Zero-allocation variants for callers that own their snapshot memory (e.g. SnapshotRing).
+    // saveStateInto fails if `capacityBytes` is smaller than the core's serialize size.
+    bool saveStateInto(void* dst, std::size_t capacityBytes, std::size_t& outSizeBytes, uint32_t& outChecksum) noexcept;
+    bool loadStateFrom(const void* src, std::size_t sizeBytes) noexcept;
+
     // Exposed for netplay integration.
     LibretroCore& core() noexcept { return core_; }
 
 private:
-    EmulatorEngine() noexcept;
-    ~EmulatorEngine() noexcept;
-
     uint32_t checksum32_(const void* data, std::size_t sizeBytes) noexcept;
+    void runFrame_(FrameOutput output) noexcept;
+    bool reserveRunAhead_() noexcept;
+    void submitRunAhead_(uint16_t port0Mask, uint16_t port1Mask) noexcept;
 
 private:
     LibretroCore core_;
     std::atomic<uint16_t> inputMasks_[2] = {0, 0};
+
+    uint32_t runAhead_ = 0;
+    AlignedBuffer runAheadState_;
+
+    RunAheadWorker aheadWorker_;
+    bool aheadDirty_ = true;
+    uint16_t aheadMasks_[2] = {0, 0};
 };
 
 } // namespace snesonline
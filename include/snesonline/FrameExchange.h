@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace snesonline {
+
+// Triple-buffered handoff of converted video frames (32-bit pixels, see PixelConvert.h) from the
+// emulation thread (producer, the core's video sink) to the thread that presents them (consumer).
+// Exactly one thread may produce and exactly one may consume.
+//
+// The producer always owns a back buffer, the consumer owns the front buffer it acquired last, and
+// the third buffer sits in the middle holding the newest published frame. Publishing and acquiring
+// each swap with the middle through one atomic exchange, so neither side ever waits, a frame is
+// never seen half-written, and when the producer runs ahead the consumer simply gets the latest
+// frame (older unconsumed frames are overwritten).
+class FrameExchange {
+public:
+    static constexpr unsigned kMaxWidth = 512;
+    static constexpr unsigned kMaxHeight = 512;
+    static constexpr unsigned kStridePixels = kMaxWidth;
+    static constexpr std::size_t kStrideBytes = kStridePixels * sizeof(uint32_t);
+    static constexpr std::size_t kBufferBytes = kStrideBytes * kMaxHeight;
+    static constexpr unsigned kBufferCount = 3;
+
+    struct Frame {
+        // Rows of kStridePixels; valid and unchanged until the consumer's next acquire().
+        const uint32_t* pixels = nullptr;
+        unsigned width = 0;
+        unsigned height = 0;
+        // Number of frames published up to and including this one (0 = nothing published yet).
+        uint32_t seq = 0;
+        // Which of buffer(0..kBufferCount-1) holds the pixels.
+        unsigned index = 0;
+    };
+
+    FrameExchange() noexcept = default;
+
+    FrameExchange(const FrameExchange&) = delete;
+    FrameExchange& operator=(const FrameExchange&) = delete;
+
+    // Producer side: fill backBuffer() (kStrideBytes per row), then publish it. The next
+    // backBuffer() is another buffer; contents left from older frames are undefined.
+    uint32_t* backBuffer() noexcept { return slots_[back_].pixels; }
+    // Returns false (and publishes nothing) for a size above kMaxWidth x kMaxHeight.
+    bool publish(unsigned width, unsigned height) noexcept;
+
+    // Consumer side: takes the newest published frame if there is one, otherwise returns the frame
+    // acquired last again (same seq). Before the first publish, `pixels` points at a zeroed buffer
+    // and width/height are 0.
+    Frame acquire() noexcept;
+
+    // The raw buffers, for consumers that map them once (e.g. Android direct ByteBuffers) and
+    // then pick the one named by Frame::index.
+    uint32_t* buffer(unsigned index) noexcept { return index < kBufferCount ? slots_[index].pixels : nullptr; }
+
+    // Frames published so far; readable from any thread.
+    uint32_t publishedFrames() const noexcept { return published_.load(std::memory_order_relaxed); }
+
+private:
+    // Middle index (low bits) plus a flag saying it holds a frame the consumer has not taken.
+    static constexpr uint32_t kIndexMask = 0x3u;
+    static constexpr uint32_t kFreshBit = 0x4u;
+
+    struct Slot {
+        alignas(64) uint32_t pixels[kStridePixels * kMaxHeight] = {};
+        unsigned width = 0;
+        unsigned height = 0;
+        uint32_t seq = 0;
+    };
+
+    Slot slots_[kBufferCount];
+
+    // Producer-owned.
+    alignas(64) unsigned back_ = 0;
+    std::atomic<uint32_t> published_{0};
+
+    // Shared.
+    alignas(64) std::atomic<uint32_t> middle_{1};
+
+    // Consumer-owned.
+    alignas(64) unsigned front_ = 2;
+};
+
+} // namespace snesonline
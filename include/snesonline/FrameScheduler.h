@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace snesonline {
+
+// Paces emulation at the core's real frame rate (LibretroCore::framesPerSecond(); ~60.0988 Hz for
+// NTSC SNES, not 60). Deadlines are kept as an integer nanosecond period plus a remainder carried
+// from frame to frame, so the schedule never drifts against the rate it was given no matter how
+// long it runs.
+//
+// A loop asks due() how many frames to run now, calls advance() once per frame it ran, and sleeps
+// with waitUntil() / waitForNext(). Catch-up after a stall is bounded: due() hands out at most
+// maxCatchUpFrames per call, and a backlog beyond maxBacklogFrames (or any backlog while the audio
+// queue already holds its target, see setAudioLevel) is dropped by moving the schedule forward
+// rather than fast-forwarding through it.
+//
+// Used by one thread; stats() may be called from anywhere.
+class FrameScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config {
+        double framesPerSecond = 60.0;
+        // Most frames a single due() call returns.
+        uint32_t maxCatchUpFrames = 4;
+        // Frames behind schedule beyond which the rest of the backlog is dropped (0 = never drop).
+        uint32_t maxBacklogFrames = 0;
+        // waitUntil() sleeps until this long before the deadline and spins for the rest.
+        uint32_t spinMicros = 1000;
+    };
+
+    struct Stats {
+        // advance()d frames.
+        uint64_t frames = 0;
+        // due() calls that returned more than one frame, and the frames beyond the first.
+        uint64_t catchUpBursts = 0;
+        uint64_t catchUpFrames = 0;
+        // Frames the schedule skipped instead of running (backlog limit or audio already full).
+        uint64_t droppedFrames = 0;
+        // waitUntil() calls that had to wait, and how far past the deadline they returned.
+        uint64_t waits = 0;
+        uint64_t wakeErrorMicrosTotal = 0;
+        uint32_t maxWakeErrorMicros = 0;
+        // Waits where the sleep alone overshot the deadline (spinMicros too small for this OS).
+        uint64_t lateWakeups = 0;
+        // Time spent spinning; the CPU cost of the accuracy.
+        uint64_t spinMicrosTotal = 0;
+    };
+
+    FrameScheduler() noexcept { configure(Config{}); }
+    explicit FrameScheduler(const Config& cfg) noexcept { configure(cfg); }
+
+    FrameScheduler(const FrameScheduler&) = delete;
+    FrameScheduler& operator=(const FrameScheduler&) = delete;
+
+    // Applies `cfg` and restarts the schedule (the next due() starts it).
+    void configure(const Config& cfg) noexcept;
+
+    // Changes the rate from the next deadline on without restarting (e.g. after a core reports a
+    // different timing). Rates <= 1 fall back to 60.
+    void setFramesPerSecond(double fps) noexcept;
+    double framesPerSecond() const noexcept { return static_cast<double>(rateNum_) / static_cast<double>(rateDen_); }
+    // Nominal frame period, rounded to the nearest microsecond.
+    uint32_t frameMicros() const noexcept { return static_cast<uint32_t>((periodNs_ + 500u) / 1000u); }
+
+    // The first frame is due at `start`. Without a call, the first due() starts the schedule.
+    void start(Clock::time_point start) noexcept;
+    // Forgets the schedule; the next due() starts a new one.
+    void restart() noexcept { started_ = false; }
+    bool started() const noexcept { return started_; }
+
+    // Frames to run now (0 if the next deadline is still ahead), at most maxCatchUpFrames. Drops
+    // backlog as described above.
+    uint32_t due(Clock::time_point now) noexcept;
+    // Marks `frames` deadlines as consumed.
+    void advance(uint32_t frames = 1) noexcept;
+    // Moves the schedule `frames` periods later without counting them as run (e.g. rollback time
+    // sync yielding to a peer that is behind).
+    void delay(uint32_t frames) noexcept;
+
+    // Deadline of the next frame not yet advance()d.
+    Clock::time_point nextDeadline() const noexcept { return next_; }
+
+    // Audio-aware catch-up: with a queue of at least `targetFrames`, extra frames would only push
+    // audio past its latency target, so any backlog is dropped instead. Both in the same units
+    // (e.g. output-rate frames); targetFrames 0 disables the check.
+    void setAudioLevel(uint32_t bufferedFrames, uint32_t targetFrames) noexcept {
+        audioBuffered_ = bufferedFrames;
+        audioTarget_ = targetFrames;
+    }
+
+    // Sleeps until spinMicros before `deadline`, then spins (yielding) until it. Returns at once
+    // if the deadline has passed.
+    void waitUntil(Clock::time_point deadline) noexcept;
+    void waitForNext() noexcept { waitUntil(next_); }
+
+    void stats(Stats& out) const noexcept;
+
+private:
+    // Single-writer counter: plain load + store, readable from any thread.
+    static void add_(std::atomic<uint64_t>& c, uint64_t n) noexcept {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void drop_(uint32_t frames) noexcept;
+
+    Config cfg_{};
+
+    // Rate as rateNum_ / rateDen_ frames per second; period = periodNs_ + periodRem_ / rateNum_ ns.
+    uint64_t rateNum_ = 60;
+    uint64_t rateDen_ = 1;
+    uint64_t periodNs_ = 16666666;
+    uint64_t periodRem_ = 40;
+
+    bool started_ = false;
+    Clock::time_point next_{};
+    // Nanosecond fraction of next_, in units of 1 / rateNum_.
+    uint64_t frac_ = 0;
+
+    uint32_t audioBuffered_ = 0;
+    uint32_t audioTarget_ = 0;
+
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> catchUpBursts_{0};
+    std::atomic<uint64_t> catchUpFrames_{0};
+    std::atomic<uint64_t> droppedFrames_{0};
+    std::atomic<uint64_t> waits_{0};
+    std::atomic<uint64_t> wakeErrorMicrosTotal_{0};
+    std::atomic<uint32_t> maxWakeErrorMicros_{0};
+    std::atomic<uint64_t> lateWakeups_{0};
+    std::atomic<uint64_t> spinMicrosTotal_{0};
+};
+
+} // namespace snesonline
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <cstdint>
+
 #include "snesonline/GGPOFwd.h"
 
 namespace snesonline {
 
+class EmulatorEngine;
+class SnapshotRing;
+
 // GGPO callback glue; implemented in src/GGPOCallbacks.cpp
 struct GGPOCallbacks {
     static GGPOSessionCallbacks make() noexcept;
@@ -13,12 +18,23 @@ struct GGPOCallbacks {
     // session pointer here.
     static void setActiveSession(GGPOSession* session) noexcept;
 
+    // Optional preallocated snapshot storage for save/load_game_state. When set, the core
+    // serializes straight into a ring slot and GGPO's buffer pointer is the slot itself.
+    // Falls back to malloc'd buffers when unset or when the state outgrows the slots.
+    static void setSnapshotRing(SnapshotRing* ring) noexcept;
+
+    // Engine the callbacks save/load/advance; nullptr => EmulatorEngine::instance().
+    static void setEngine(EmulatorEngine* engine) noexcept;
+
     struct EventState {
         bool running = false;
         bool connectionInterrupted = false;
         bool disconnected = false;
         // If >0, GGPO suggests we sleep to let the other side catch up.
         int timesyncFramesAhead = 0;
+        // Rollbacks (load_game_state) and frames re-simulated after them (advance_frame).
+        uint32_t rollbacks = 0;
+        uint32_t resimulatedFrames = 0;
     };
 
     // Returns and clears the latest event state since the last call.
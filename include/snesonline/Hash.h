@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace snesonline {
+
+// Checksums/hashes for savestates, RAM comparisons and transfer verification.
+// The fastest kernel for the running CPU is picked once at first use (SSE4.2/PCLMUL/AVX2 on x86-64,
+// ARMv8 CRC/NEON on arm64, portable slicing-by-8 / scalar elsewhere). Every kernel produces
+// bit-identical results, so values can be compared across devices and platforms.
+
+// Standard CRC-32 (IEEE 802.3 / zlib polynomial). Use this for anything that goes on the wire:
+// it matches what older builds computed. Pass a previous result as `crc` to continue a running CRC.
+uint32_t crc32(const void* data, std::size_t sizeBytes, uint32_t crc = 0) noexcept;
+
+// CRC-32C (Castagnoli). For new formats that do not need to match older builds.
+uint32_t crc32c(const void* data, std::size_t sizeBytes, uint32_t crc = 0) noexcept;
+
+// Fast non-cryptographic hash for large blobs (full savestates, WRAM). Not a CRC; only compare
+// it against values produced by stateHash64/stateHash32.
+uint64_t stateHash64(const void* data, std::size_t sizeBytes, uint64_t seed = 0) noexcept;
+uint32_t stateHash32(const void* data, std::size_t sizeBytes, uint64_t seed = 0) noexcept;
+
+// Portable reference implementations and the name of the kernel selected at runtime.
+// Intended for benchmarks and self-checks.
+uint32_t crc32Portable(const void* data, std::size_t sizeBytes, uint32_t crc = 0) noexcept;
+uint32_t crc32cPortable(const void* data, std::size_t sizeBytes, uint32_t crc = 0) noexcept;
+uint64_t stateHash64Portable(const void* data, std::size_t sizeBytes, uint64_t seed = 0) noexcept;
+const char* crc32KernelName() noexcept;
+const char* crc32cKernelName() noexcept;
+const char* stateHashKernelName() noexcept;
+
+} // namespace snesonline
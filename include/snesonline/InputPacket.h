@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace snesonline {
+
+// Redundant input window shared by the v2 input packets of every transport (LockstepSession,
+// RollbackSession, Android/iOS UdpNetplay). One datagram carries the newest frame's mask plus the
+// preceding ones, run-length encoded, so a single packet per frame keeps the loss tolerance of the
+// old per-frame resend loop.
+//
+// Encoding (big-endian):
+//   u32 newestFrame
+//   u8  count            number of frames carried (1..kMaxInputWindow), ending at newestFrame
+//   repeated runs, oldest frame first, until `count` frames are covered:
+//     u8  runLength      1..255
+//     u16 mask
+//
+// Transports put their own prefix (magic, token, ...) in front of this.
+static constexpr uint32_t kMaxInputWindow = 64;
+static constexpr std::size_t kMaxInputWindowBytes = 5 + 3 * kMaxInputWindow;
+
+// masks[0] is frame (newestFrame - count + 1). Returns bytes written, or 0 if it does not fit.
+std::size_t encodeInputWindow(uint32_t newestFrame, const uint16_t* masks, uint32_t count, uint8_t* out,
+                              std::size_t capacity) noexcept;
+
+// Rejects truncated/overlong payloads. outMasks must hold kMaxInputWindow entries.
+bool decodeInputWindow(const uint8_t* data, std::size_t sizeBytes, uint32_t& outNewestFrame, uint16_t* outMasks,
+                       uint32_t& outCount) noexcept;
+
+// Decides which input packet formats to send to the current peer. A v2-capable sender emits both
+// the legacy per-frame packets and the v2 window until it hears from the peer: once a v2 packet
+// arrives it sends v2 only, and after enough legacy-only packets it assumes an old client and
+// sends legacy only.
+class InputPacketNegotiator {
+public:
+    // Legacy-only v1 packets seen before concluding the peer does not understand v2.
+    static constexpr uint32_t kV1OnlyPacketsBeforeFallback = 120;
+
+    void reset(bool allowV2) noexcept {
+        allowV2_ = allowV2;
+        peerV2_ = false;
+        peerV1Only_ = false;
+        v1Seen_ = 0;
+    }
+
+    void onV1Received() noexcept {
+        if (peerV2_ || peerV1Only_) return;
+        if (++v1Seen_ >= kV1OnlyPacketsBeforeFallback) peerV1Only_ = true;
+    }
+    void onV2Received() noexcept {
+        peerV2_ = true;
+        peerV1Only_ = false;
+    }
+
+    bool sendV2() const noexcept { return allowV2_ && !peerV1Only_; }
+    bool sendV1() const noexcept { return !allowV2_ || !peerV2_; }
+    bool peerUsesV2() const noexcept { return peerV2_; }
+
+private:
+    bool allowV2_ = true;
+    bool peerV2_ = false;
+    bool peerV1Only_ = false;
+    uint32_t v1Seen_ = 0;
+};
+
+} // namespace snesonline
@@ -3,11 +3,18 @@
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <string>
 
 namespace snesonline {
 
 // Minimal Libretro host by dynamic symbol loading.
 // This avoids pulling in libretro headers and keeps the core boundary explicit.
+//
+// Several instances can live in one process (e.g. both netplay peers, or batch workers on separate
+// threads). Libretro callbacks carry no user pointer, so every call into the core marks this
+// instance as the calling thread's active core and the static callbacks dispatch to it. Cores keep
+// their emulation state in globals, so an instance that loads a core file another instance already
+// has loaded (under any path) gets a private copy of the shared object (see privateCopyPath()).
 class LibretroCore {
 public:
     LibretroCore() noexcept;
@@ -22,7 +29,10 @@ public:
     bool loadGame(const char* romPath) noexcept;
     void unloadGame() noexcept;
 
-    void runFrame() noexcept;
+    // Runs one frame. With `video` or `audio` false the core is told it may skip rendering or mixing
+    // (RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE), and whatever it still outputs is not forwarded to
+    // the sinks. Emulation state advances exactly as with both enabled.
+    void runFrame(bool video = true, bool audio = true) noexcept;
 
     // Optional host sinks (video/audio). If unset, frames/samples are dropped.
     using VideoRefreshFn = void (*)(void* ctx, const void* data, unsigned width, unsigned height, std::size_t pitchBytes) noexcept;
@@ -30,6 +40,8 @@ public:
 
     void setVideoSink(void* ctx, VideoRefreshFn fn) noexcept;
     void setAudioSink(void* ctx, AudioSampleBatchFn fn) noexcept;
+    void* videoSinkCtx() const noexcept { return videoCtx_; }
+    VideoRefreshFn videoSinkFn() const noexcept { return videoFn_; }
 
     // Runtime info (populated after core is loaded; AV info after game is loaded).
     enum class PixelFormat : uint8_t {
@@ -58,8 +70,22 @@ public:
 
     bool isLoaded() const noexcept { return handle_ != nullptr; }
 
+    // Core identity from retro_get_system_info (empty if the core does not export it), and the ROM
+    // path passed to loadGame(). Replays record these to check they are played on the same game.
+    const std::string& libraryName() const noexcept { return libraryName_; }
+    const std::string& libraryVersion() const noexcept { return libraryVersion_; }
+    const std::string& romPath() const noexcept { return romPath_; }
+    // Core path as passed to load() (not the private copy).
+    const std::string& corePath() const noexcept { return loadedPath_; }
+
+    // Path of the temporary copy this instance loaded the core from, or empty if it uses the original.
+    const std::string& privateCopyPath() const noexcept { return privateCopyPath_; }
+
 private:
+    class ActiveScope;
+
     void* resolve_(const char* name) noexcept;
+    static LibretroCore* active_() noexcept;
 
     void* handle_ = nullptr;
 
@@ -79,6 +105,7 @@ private:
     void (*retro_set_input_poll_)(void (*)(void)) = nullptr;
     void (*retro_set_input_state_)(int16_t (*)(unsigned, unsigned, unsigned, unsigned)) = nullptr;
 
+    void (*retro_get_system_info_)(void* /*retro_system_info*/ ) = nullptr;
     void (*retro_get_system_av_info_)(void* /*retro_system_av_info*/ ) = nullptr;
     void (*retro_set_environment_)(bool (*)(unsigned, void*)) = nullptr;
     void (*retro_set_video_refresh_)(void (*)(const void*, unsigned, unsigned, size_t)) = nullptr;
@@ -96,16 +123,33 @@ private:
     static void videoRefresh_(const void* data, unsigned width, unsigned height, size_t pitch) noexcept;
     static void audioSample_(int16_t left, int16_t right) noexcept;
     static size_t audioSampleBatch_(const int16_t* data, size_t frames) noexcept;
+    void flushAudio_() noexcept;
+
+    std::atomic<uint16_t> inputMasks_[2] = {0, 0};
+
+    void* videoCtx_ = nullptr;
+    VideoRefreshFn videoFn_ = nullptr;
 
-    static std::atomic<uint16_t> inputMasks_[2]; // global for callback simplicity
+    void* audioCtx_ = nullptr;
+    AudioSampleBatchFn audioFn_ = nullptr;
 
-    static void* videoCtx_;
-    static VideoRefreshFn videoFn_;
+    // Cores using retro_audio_sample deliver one stereo frame per call; those are gathered here and
+    // handed to the sink once per runFrame() (or when full) instead of one sink call per sample.
+    // A frame is ~535 samples at 32 kHz / 60 fps; this holds a 48 kHz / 50 fps one.
+    static constexpr std::size_t kAudioAccumFrames = 1024;
+    int16_t audioAccum_[kAudioAccumFrames * 2] = {};
+    std::size_t audioAccumFrames_ = 0;
 
-    static void* audioCtx_;
-    static AudioSampleBatchFn audioFn_;
+    int pixelFormatRaw_ = 1; // libretro RETRO_PIXEL_FORMAT_*, XRGB8888 until the core says otherwise
+    int avEnable_ = 3;       // GET_AUDIO_VIDEO_ENABLE bits for the frame being run (1 video, 2 audio)
 
-    static std::atomic<int> pixelFormatRaw_; // libretro RETRO_PIXEL_FORMAT_*
+    std::string loadedPath_;      // path as passed to load()
+    std::string loadedKey_;       // identity of that file, for detecting shared loads
+    std::string privateCopyDir_;  // private directory holding privateCopyPath_
+    std::string privateCopyPath_; // temp copy of the core when the file was already in use
+    std::string libraryName_;
+    std::string libraryVersion_;
+    std::string romPath_;
 
     PixelFormat pixelFormat_ = PixelFormat::XRGB8888;
     double fps_ = 60.0;
@@ -1,18 +1,47 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include "snesonline/BulkTransfer.h"
+#include "snesonline/FrameScheduler.h"
+#include "snesonline/InputPacket.h"
+#include "snesonline/NetplayStats.h"
+#include "snesonline/Replay.h"
+#include "snesonline/SpectatorHost.h"
+#include "snesonline/SpscRing.h"
 
 namespace snesonline {
 
+class EmulatorEngine;
+
 // Simple UDP lockstep netplay compatible with the Android implementation.
 // Packet format:
 //   u32 frame (big-endian)
 //   u16 inputMask (big-endian)
 //   u16 reserved (0)
+// Peers that both understand it switch to a v2 packet instead: one datagram per frame carrying the
+// whole resend window (see InputPacket.h). Old clients keep receiving the packets above.
+//
+// Input delay is adaptive by default: both peers ping each other to track round-trip time and
+// jitter. The start delay is agreed before frame 0: the peers ping while waiting for each other and
+// player 1 sends the delay its first samples call for. After that player 1 proposes changes together
+// with the frame they take effect on. Each local input is scheduled exactly once, so changing the
+// delay (or stalling) never alters a frame the peer may already have simulated. Against peers that
+// do not answer pings the delay stays at kDefaultInputDelayFrames.
 class LockstepSession {
 public:
+    static constexpr uint32_t kDefaultInputDelayFrames = 5;
+    static constexpr uint32_t kMinAdaptiveDelayFrames = 2;
+    static constexpr uint32_t kMaxInputDelayFrames = 15;
+
     LockstepSession() noexcept;
     ~LockstepSession() noexcept;
 
@@ -34,6 +63,30 @@ public:
         const char* roomServerHost = ""; // hostname or IPv4
         uint16_t roomServerPort = 0; // 0 => disable
         const char* roomCode = ""; // 8-12 chars
+
+        // 2: negotiate the single-datagram v2 input packet. 1: legacy per-frame packets only.
+        uint8_t inputPacketVersion = 2;
+
+        // 0: adaptive (agreed from the measured RTT before frame 0; kDefaultInputDelayFrames if the
+        // peer does not ping). 1..kMaxInputDelayFrames: fixed.
+        uint8_t inputDelayFrames = 0;
+
+        // Receive on a dedicated network thread: it blocks in poll() on the socket, timestamps each
+        // datagram, answers pings immediately and hands everything else to tick() through a
+        // wait-free ring. Input packets are still sent from the thread calling tick().
+        bool networkThread = false;
+
+        // Serve spectators (SpectatorSession) on this UDP port; 0 disables. Every simulated frame is
+        // final in lockstep, so spectators get each frame's inputs as soon as it has run.
+        uint16_t spectatorPort = 0;
+        uint32_t maxSpectators = SpectatorHost::kDefaultMaxSpectators;
+
+        // Record the match to this replay file (see Replay.h); nullptr/empty disables. The replay
+        // starts from the engine's state at start() and is finished by stop().
+        const char* replayPath = nullptr;
+
+        // Engine the session drives; nullptr => EmulatorEngine::instance().
+        EmulatorEngine* engine = nullptr;
     };
 
     bool start(const Config& cfg) noexcept;
@@ -41,18 +94,67 @@ public:
 
     void setLocalInput(uint16_t mask) noexcept;
     void tick() noexcept;
+    // Like tick(), but when the due frame is blocked on the peer's input, waits for it (on the
+    // socket, or for the network thread) until `deadline` and runs the frame as soon as it lands.
+    // Frame loops pass the time they would otherwise sleep until.
+    void tickUntil(std::chrono::steady_clock::time_point deadline) noexcept;
 
     bool waitingForPeer() const noexcept { return waitingForPeer_; }
     bool connected() const noexcept { return connected_; }
 
+    // Input datagrams received (one per packet, however many frames a v2 window carries).
     uint64_t recvCount() const noexcept { return recvCount_; }
     // Returns -1 if never received anything.
     int64_t lastRecvAgeMs() const noexcept;
 
     uint32_t localFrame() const noexcept { return frame_; }
+    // When the next local frame is due; frame loops can sleep until then between ticks.
+    std::chrono::steady_clock::time_point nextFrameDeadline() const noexcept { return pacer_.nextDeadline(); }
+    const FrameScheduler& scheduler() const noexcept { return pacer_; }
     uint32_t lastRemoteFrame() const noexcept { return lastRemoteFrame_; }
     uint32_t maxRemoteFrame() const noexcept { return maxRemoteFrame_; }
 
+    // Local input is scheduled for localFrame() + inputDelayFrames().
+    uint32_t inputDelayFrames() const noexcept { return inputDelay_; }
+    bool adaptiveDelay() const noexcept { return adaptiveDelay_; }
+    // Smoothed round-trip time and its mean deviation; 0 until the peer has answered a ping.
+    uint32_t rttMicros() const noexcept { return srttUs_; }
+    uint32_t jitterMicros() const noexcept { return rttVarUs_; }
+    uint32_t lastRttMicros() const noexcept { return lastRttUs_; }
+    uint32_t rttSampleCount() const noexcept { return rttSamples_; }
+
+    // Stalls: a due frame waiting for remote input, from the first failed attempt until it runs.
+    uint64_t stallCount() const noexcept { return stallCount_; }
+    uint64_t stallMicrosTotal() const noexcept { return stallMicrosTotal_; }
+    uint32_t maxStallMicros() const noexcept { return maxStallMicros_; }
+
+    // Everything above plus RTT distribution, probe loss, reordering and traffic rates in one copy.
+    void stats(NetplayStats& out) const noexcept;
+
+    bool networkThreadActive() const noexcept { return netThread_.joinable(); }
+    // Datagrams the network thread dropped because tick() fell behind (ring full).
+    uint64_t droppedDatagrams() const noexcept { return droppedDatagrams_.load(std::memory_order_relaxed); }
+
+    bool peerUsesPacketV2() const noexcept { return negotiator_.peerUsesV2(); }
+    uint64_t sentPacketCount() const noexcept { return sentPackets_; }
+    // UDP payload bytes (no IP/UDP headers).
+    uint64_t sentByteCount() const noexcept { return sentBytes_; }
+
+    const SpectatorHost& spectators() const noexcept { return spectators_; }
+    const ReplayWriter& replay() const noexcept { return replay_; }
+
+    // Reliable transfer of a blob (savestate, SRAM) to the peer over the session socket, alongside
+    // the match (see BulkTransfer.h). One transfer per channel at a time; a new sendBulk() replaces
+    // the previous one. Progress is made from tick().
+    static constexpr uint8_t kBulkChannels = 4;
+    bool sendBulk(uint8_t channel, const void* data, std::size_t sizeBytes) noexcept;
+    // The peer has acknowledged every byte of the last sendBulk() on `channel`.
+    bool bulkSendDone(uint8_t channel) const noexcept;
+    // Copies out a blob the peer sent on `channel`, once per completed transfer.
+    bool takeReceivedBulk(uint8_t channel, std::vector<uint8_t>& out);
+    const BulkSender& bulkSender(uint8_t channel) const noexcept { return bulkOut_[channel % kBulkChannels]; }
+    const BulkReceiver& bulkReceiver(uint8_t channel) const noexcept { return bulkIn_[channel % kBulkChannels]; }
+
     // For UI/debug.
     std::string peerEndpoint() const;
 
@@ -69,6 +171,20 @@ private:
     void closeSocket_() noexcept;
     void pumpRecv_() noexcept;
     void sendLocal_() noexcept;
+    void storeRemoteInput_(uint32_t frame, uint16_t mask) noexcept;
+    void handleDatagram_(const uint8_t* data, std::size_t sizeBytes, uint32_t fromIpv4_be, uint16_t fromPort_be,
+                         uint32_t arrivalUs, bool pingAnswered) noexcept;
+    void handleControl_(const uint8_t* data, std::size_t sizeBytes, uint32_t arrivalUs, bool pingAnswered) noexcept;
+    void netThreadMain_() noexcept;
+    void stopNetThread_() noexcept;
+    bool waitForDatagram_(std::chrono::steady_clock::time_point deadline) noexcept;
+    void sendPing_() noexcept;
+    void addRttSample_(uint32_t rttUs) noexcept;
+    uint32_t desiredDelay_() const noexcept;
+    void agreeStartDelay_() noexcept;
+    void updateDelay_() noexcept;
+    bool sendToPeer_(const void* data, std::size_t sizeBytes) noexcept;
+    void pumpBulk_() noexcept;
 
     struct Peer {
         uint32_t ipv4_be = 0; // network order
@@ -82,10 +198,31 @@ private:
     uint16_t localPort_ = 7000;
     uint16_t remotePort_ = 7000;
     uint8_t localPlayerNum_ = 1;
+    EmulatorEngine* engine_ = nullptr;
 
     uint16_t localMask_ = 0;
     uint32_t frame_ = 0;
 
+    static constexpr uint32_t kNoFrame = 0xFFFFFFFFu;
+    bool adaptiveDelay_ = true;
+    uint32_t inputDelay_ = kDefaultInputDelayFrames;
+    // Highest frame that already has a local input assigned.
+    uint32_t lastScheduled_ = 0;
+    // Agreed delay change: `delayChange_` applies from frame `delayChangeFrame_` on.
+    uint32_t delayChange_ = 0;
+    uint32_t delayChangeFrame_ = kNoFrame;
+    uint32_t nextDelayEvalFrame_ = 0;
+    // Adaptive sessions hold frame 0 until the start delay is known (or startDelayDeadline_ passes).
+    bool delayAgreed_ = true;
+    bool peerHeard_ = false;
+    std::chrono::steady_clock::time_point startDelayDeadline_{};
+
+    uint32_t srttUs_ = 0;
+    uint32_t rttVarUs_ = 0;
+    uint32_t rttSamples_ = 0;
+    uint32_t lastRttUs_ = 0;
+    std::chrono::steady_clock::time_point lastPingSent_{};
+
     static constexpr uint32_t kBufN = 256;
     uint16_t remoteMask_[kBufN] = {};
     uint32_t remoteFrameTag_[kBufN] = {};
@@ -97,13 +234,49 @@ private:
     bool connected_ = false;
     std::chrono::steady_clock::time_point lastRecv_{};
 
-    // Used to prevent running faster than real-time when catch-up is enabled.
-    std::chrono::steady_clock::time_point startTime_{};
+    // Paces frames at the core's rate with bounded catch-up after stalls.
+    FrameScheduler pacer_;
 
     uint64_t recvCount_ = 0;
 
+    InputPacketNegotiator negotiator_;
+    bool allowPacketV2_ = true;
+    uint64_t sentPackets_ = 0;
+    uint64_t sentBytes_ = 0;
+
+    // Largest datagram the session handles (a full-size bulk transfer datagram).
+    static constexpr uint16_t kMaxDatagramBytes = static_cast<uint16_t>(kBulkMaxDatagramBytes);
+    struct RecvDatagram {
+        uint32_t arrivalUs;
+        uint32_t fromIpv4_be;
+        uint16_t fromPort_be;
+        uint16_t sizeBytes;
+        uint8_t data[kMaxDatagramBytes];
+    };
+    SpscRing<RecvDatagram, 256> recvRing_;
+    std::thread netThread_;
+    std::atomic<bool> netRunning_{false};
+    std::atomic<uint64_t> droppedDatagrams_{0};
+    // Lets tickUntil() sleep until the network thread publishes something.
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCv_;
+    std::atomic<bool> consumerWaiting_{false};
+
+    std::chrono::steady_clock::time_point stallStart_{};
+    uint64_t stallCount_ = 0;
+    uint64_t stallMicrosTotal_ = 0;
+    uint32_t maxStallMicros_ = 0;
+    NetplayStatsTracker statsTracker_;
+
     uint32_t lastRemoteFrame_ = 0;
     uint32_t maxRemoteFrame_ = 0;
+
+    SpectatorHost spectators_;
+    ReplayWriter replay_;
+
+    BulkSender bulkOut_[kBulkChannels];
+    BulkReceiver bulkIn_[kBulkChannels];
+    bool bulkTaken_[kBulkChannels] = {};
 };
 
 } // namespace snesonline
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace snesonline {
+
+// Small LZ77 byte codec (LZ4-style block layout) for savestates and other blobs sent over the
+// network or written to disk. Savestates are dominated by zeroed RAM and repeated tiles, which this
+// compresses several-fold at a few hundred MB/s without a third-party dependency.
+//
+// Block: a sequence of
+//   u8  token            high nibble literal count, low nibble match length - 4 (15 => extended)
+//   [u8 ...]             literal count extension (255, 255, ..., <255) when the nibble is 15
+//   literals
+//   u16 offset (LE)      1..65535, omitted after the final literals
+//   [u8 ...]             match length extension when the nibble is 15
+// The block always ends with a literal-only sequence (possibly zero literals).
+
+// Worst-case output size for `sizeBytes` of input.
+constexpr std::size_t lzMaxCompressedSize(std::size_t sizeBytes) noexcept {
+    return sizeBytes + sizeBytes / 255 + 16;
+}
+
+// Returns bytes written, or 0 if `capacity` is too small.
+std::size_t lzCompress(const void* src, std::size_t sizeBytes, void* dst, std::size_t capacity) noexcept;
+
+// Returns bytes written. Malformed input, or output that would exceed `capacity`, returns 0
+// (callers store the raw size next to the block, so an empty blob is never ambiguous).
+std::size_t lzDecompress(const void* src, std::size_t sizeBytes, void* dst, std::size_t capacity) noexcept;
+
+} // namespace snesonline
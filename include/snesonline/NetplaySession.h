@@ -5,9 +5,13 @@
 #include <string>
 
 #include "snesonline/GGPOFwd.h"
+#include "snesonline/NetplayStats.h"
+#include "snesonline/SnapshotRing.h"
 
 namespace snesonline {
 
+class EmulatorEngine;
+
 // Thin wrapper around GGPO session lifetime + input exchange.
 // This is intentionally minimal; your app is expected to wire transport + UI.
 class NetplaySession {
@@ -29,6 +33,10 @@ public:
         uint8_t frameDelay = 0;
         // Must be 1 or 2. The other side should use the opposite.
         uint8_t localPlayerNum = 1;
+
+        // Engine the session drives; nullptr => EmulatorEngine::instance(). GGPO's callbacks carry
+        // no context, so only one NetplaySession can be active per process.
+        EmulatorEngine* engine = nullptr;
     };
 
     bool start(const Config& cfg) noexcept;
@@ -41,6 +49,11 @@ public:
     bool disconnected() const noexcept { return disconnected_; }
     bool reconnecting() const noexcept { return reconnecting_; }
 
+    // GGPO reports its own estimates: RTT is its ping (sampled once a second), the send rate its
+    // kbps figure; rollbacks come from the save/load callbacks, stalls are ticks where GGPO held the
+    // frame back after synchronizing. Loss, reordering and packet counts are not available.
+    void stats(NetplayStats& out) const noexcept;
+
     // Called once per frame by the platform loop.
     // For now, this only advances the emulator frame with synchronized inputs.
     void tick() noexcept;
@@ -49,6 +62,8 @@ public:
     void setLocalInput(uint16_t mask) noexcept;
 
 private:
+    EmulatorEngine& engine_() noexcept;
+
     struct OwnedConfig {
         std::string gameName;
         std::string remoteIp;
@@ -56,11 +71,15 @@ private:
         uint16_t localPort = 7000;
         uint8_t frameDelay = 0;
         uint8_t localPlayerNum = 1;
+        EmulatorEngine* engine = nullptr;
     } lastCfg_;
 
     GGPOSession* session_ = nullptr;
     uint16_t localMask_ = 0;
 
+    // Preallocated save/load storage for GGPO rollback (sized from LibretroCore::serializeSize()).
+    SnapshotRing snapshots_;
+
     // Last synchronized inputs for the current frame.
     uint16_t syncedMasks_[2] = {0, 0};
 
@@ -88,10 +107,20 @@ private:
     bool startGgpoSession_() noexcept;
     void closeListenSocket_() noexcept;
     void pollListenSocket_() noexcept;
+    // Feeds statsTracker_: rollbacks drained from the callbacks, GGPO's network stats once a second.
+    void sampleStats_(uint32_t rollbacks, uint32_t resimulatedFrames) noexcept;
+    // Opens (frame held back) or closes (frame advanced) a stall.
+    void noteStall_(bool stalled) noexcept;
 #endif
 
     std::chrono::steady_clock::time_point nextReconnectAttempt_{};
     uint32_t reconnectBackoffMs_ = 1000;
+
+    uint32_t frame_ = 0;
+    NetplayStatsTracker statsTracker_;
+    std::chrono::steady_clock::time_point stallStart_{};
+    std::chrono::steady_clock::time_point nextStatsSample_{};
+    uint32_t ggpoBytesSentPerSecond_ = 0;
 };
 
 } // namespace snesonline
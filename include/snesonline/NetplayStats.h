@@ -0,0 +1,159 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace snesonline {
+
+// Point-in-time netplay diagnostics, the same shape for every session type (LockstepSession,
+// RollbackSession, NetplaySession, SpectatorSession). Fields a session cannot measure stay at their
+// defaults; `lossPercent` is negative while unknown. Filled by the sessions' `stats(NetplayStats&)`,
+// which only copies counters, so front-ends can poll it every frame.
+struct NetplayStats {
+    uint32_t localFrame = 0;
+    // Newest remote input frame received (spectators: first frame whose inputs have not arrived).
+    uint32_t remoteFrame = 0;
+    bool connected = false;
+    bool waitingForPeer = false;
+    uint32_t inputDelayFrames = 0;
+    // -1 if nothing was received yet.
+    int64_t lastRecvAgeMs = -1;
+
+    // Round-trip time over the session's probes (ping/pong; GGPO: its ping estimate, sampled once a
+    // second). All 0 until rttSamples > 0. p99 has the resolution of the RTT histogram (1 ms below
+    // 64 ms, 8 ms above).
+    uint32_t rttSamples = 0;
+    uint32_t rttMinMicros = 0;
+    uint32_t rttAvgMicros = 0;
+    uint32_t rttP99Micros = 0;
+    uint32_t rttMaxMicros = 0;
+    uint32_t rttLastMicros = 0;
+    // RFC 3550 interarrival jitter of consecutive RTT samples.
+    uint32_t jitterMicros = 0;
+
+    // Loss is measured on probes: a probe unanswered after NetplayStatsTracker::kProbeTimeoutMicros
+    // counts as lost. Duplicates are repeated answers; out-of-order counts answers and input packets
+    // that arrive after a newer one.
+    uint64_t probesSent = 0;
+    uint64_t probesAnswered = 0;
+    float lossPercent = -1.0f;
+    uint64_t duplicatePackets = 0;
+    uint64_t outOfOrderPackets = 0;
+
+    // Stalls: a due frame waiting on the peer, from the first failed attempt until it runs.
+    // stalledFrames counts the frame periods spent stalled (rounded up per stall).
+    uint64_t stallCount = 0;
+    uint64_t stalledFrames = 0;
+    uint64_t stallMicrosTotal = 0;
+    uint32_t maxStallMicros = 0;
+
+    // Rollbacks (rollback sessions only); depth is the number of frames re-simulated.
+    uint64_t rollbackCount = 0;
+    uint64_t rolledBackFrames = 0;
+    uint32_t lastRollbackDepth = 0;
+    uint32_t maxRollbackDepth = 0;
+    // Frames currently simulated on predicted input.
+    int32_t frameLead = 0;
+
+    // UDP payload bytes (no IP/UDP headers). Rates are over the last full second.
+    uint64_t packetsSent = 0;
+    uint64_t bytesSent = 0;
+    uint64_t packetsReceived = 0;
+    uint64_t bytesReceived = 0;
+    uint32_t packetsSentPerSecond = 0;
+    uint32_t bytesSentPerSecond = 0;
+    uint32_t packetsReceivedPerSecond = 0;
+    uint32_t bytesReceivedPerSecond = 0;
+};
+
+// Accumulates the NetplayStats counters a session cannot read off its own state. Fixed-size, no
+// allocation, and every call is bounded (at most a scan of the probe history or RTT histogram).
+// Not thread-safe: feed it from the thread that runs the session.
+class NetplayStatsTracker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr uint32_t kProbeTimeoutMicros = 2000000;
+    static constexpr uint32_t kProbeHistory = 32;
+    static constexpr uint32_t kRttBuckets = 128;
+
+    void reset(Clock::time_point now, uint32_t frameMicros) noexcept;
+
+    void onDatagramReceived(std::size_t sizeBytes) noexcept;
+
+    // Probes are identified by their send timestamp, which the answer echoes: microseconds of
+    // Clock::now().time_since_epoch(), truncated to 32 bits.
+    void onProbeSent(uint32_t sentUs) noexcept;
+    // Returns false for answers to unknown probes (stale, or from an earlier session).
+    bool onProbeAnswered(uint32_t sentUs, uint32_t arrivalUs) noexcept;
+    // RTT measured some other way (no probe bookkeeping).
+    void onRttSample(uint32_t rttUs) noexcept;
+
+    // Newest frame carried by a windowed input packet.
+    void onInputPacket(uint32_t newestFrame) noexcept;
+    void onStall(uint32_t micros) noexcept;
+    void onRollback(uint32_t depthFrames) noexcept;
+
+    // Expires unanswered probes and refreshes the per-second rates (at most once a second).
+    void update(Clock::time_point now, uint64_t packetsSent, uint64_t bytesSent) noexcept;
+
+    // Fills the tracker-owned fields; the session fills the rest.
+    void fill(NetplayStats& out) const noexcept;
+
+private:
+    enum class ProbeState : uint8_t { Empty, Pending, Answered, Lost };
+    struct Probe {
+        uint32_t sentUs = 0;
+        uint32_t seq = 0;
+        ProbeState state = ProbeState::Empty;
+    };
+
+    static uint32_t bucketOf_(uint32_t rttUs) noexcept;
+    static uint32_t bucketUpperMicros_(uint32_t bucket) noexcept;
+
+    uint32_t frameMicros_ = 16639;
+
+    uint32_t rttCount_[kRttBuckets] = {};
+    uint32_t rttSamples_ = 0;
+    uint64_t rttSumMicros_ = 0;
+    uint32_t rttMin_ = 0;
+    uint32_t rttMax_ = 0;
+    uint32_t rttLast_ = 0;
+    uint32_t rttP99_ = 0;
+    uint32_t jitter16_ = 0; // jitter << 4 (RFC 3550 fixed point)
+
+    Probe probes_[kProbeHistory] = {};
+    uint32_t nextProbeSeq_ = 0;
+    uint32_t newestAnsweredSeq_ = 0;
+    bool anyAnswered_ = false;
+    uint64_t probesSent_ = 0;
+    uint64_t probesAnswered_ = 0;
+    uint64_t probesLost_ = 0;
+    uint64_t duplicates_ = 0;
+    uint64_t outOfOrder_ = 0;
+
+    uint32_t newestInputFrame_ = 0;
+    bool anyInput_ = false;
+
+    uint64_t stallCount_ = 0;
+    uint64_t stalledFrames_ = 0;
+    uint64_t stallMicrosTotal_ = 0;
+    uint32_t maxStallMicros_ = 0;
+
+    uint64_t rollbacks_ = 0;
+    uint64_t rolledBackFrames_ = 0;
+    uint32_t lastRollbackDepth_ = 0;
+    uint32_t maxRollbackDepth_ = 0;
+
+    uint64_t packetsSent_ = 0;
+    uint64_t bytesSent_ = 0;
+    uint64_t packetsReceived_ = 0;
+    uint64_t bytesReceived_ = 0;
+
+    Clock::time_point rateStart_{};
+    uint64_t rateBase_[4] = {}; // packets/bytes sent, packets/bytes received at rateStart_
+    uint32_t rates_[4] = {};
+};
+
+} // namespace snesonline
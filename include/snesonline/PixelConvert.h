@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "snesonline/LibretroCore.h"
+
+namespace snesonline {
+
+// Converts video frames from the core's pixel format (LibretroCore::pixelFormat()) to the 32-bit
+// layouts the front-ends display. Every (source, destination) pair is its own template
+// instantiation, so the per-pixel loop has no format branches; the SIMD flavour (SSE2/AVX2 on
+// x86-64, NEON on ARM, scalar elsewhere) is picked once at first use. All kernels produce
+// bit-identical output.
+//
+// 5- and 6-bit channels expand by replicating their top bits (0x1F -> 0xFF), and alpha is always
+// opaque, so the result can be shown without blending.
+
+enum class DstPixelFormat : uint8_t {
+    // uint32 0xAARRGGBB in native byte order (bytes B,G,R,A): Android ARGB_8888 Bitmap ints,
+    // CoreGraphics byteOrder32Little + skipFirst, SDL_PIXELFORMAT_ARGB8888.
+    ARGB8888 = 0,
+    // uint32 0xAABBGGRR (bytes R,G,B,A): GL/Vulkan/Metal RGBA8 textures.
+    ABGR8888 = 1,
+};
+
+// Converts `width` x `height` pixels from `src` to `dst`. Pitches are row strides in bytes and only
+// need to cover a row, so `dst` can be a sub-rectangle of a larger buffer or a locked texture.
+// Returns false (and writes nothing) for null buffers or an unknown format.
+bool convertPixels(LibretroCore::PixelFormat srcFormat, DstPixelFormat dstFormat, const void* src, std::size_t srcPitchBytes,
+                   void* dst, std::size_t dstPitchBytes, unsigned width, unsigned height) noexcept;
+
+// Portable reference implementation and the name of the kernel selected at runtime.
+// Intended for benchmarks and self-checks.
+bool convertPixelsPortable(LibretroCore::PixelFormat srcFormat, DstPixelFormat dstFormat, const void* src, std::size_t srcPitchBytes,
+                           void* dst, std::size_t dstPitchBytes, unsigned width, unsigned height) noexcept;
+const char* pixelConvertKernelName() noexcept;
+
+} // namespace snesonline
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace snesonline {
+
+// Scoped-timer instrumentation for the per-frame hot paths (emulation, savestates, session pumps,
+// platform sinks).
+//
+// Each thread that records gets its own ring of kEventsPerThread fixed-size events on first use;
+// recording is two clock reads and a few stores, with no locks and no allocation. When a ring wraps,
+// the oldest events are overwritten. Rings are never freed: when a thread exits, its ring keeps its
+// events until a new thread claims it (dropping them), so at most kMaxThreads threads record at once
+// however many come and go. Readers
+// (writeChromeTrace, summarize) may run on any thread at any time; events overwritten while being
+// copied are skipped.
+//
+// The SNESONLINE_PROFILE_SCOPE("name") markers compile to nothing unless the build defines
+// SNESONLINE_ENABLE_PROFILER (CMake option of the same name). The API below always exists, so
+// front-ends can offer a dump without #ifdefs; with the markers compiled out it records nothing
+// except explicit ProfileScope objects. `name` must be a string with static storage duration.
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t kEventsPerThread = 1u << 14; // ~270 s of 60 events per frame
+    static constexpr std::size_t kMaxThreads = 16;
+
+    struct Event {
+        const char* name = nullptr;
+        uint64_t startNs = 0; // since the process-wide profiler epoch
+        uint32_t durationNs = 0;
+        uint32_t depth = 0; // nesting level on its thread
+    };
+
+    struct PhaseStats {
+        const char* name = nullptr;
+        uint64_t count = 0;
+        double meanUs = 0.0;
+        double p50Us = 0.0;
+        double p99Us = 0.0;
+        double maxUs = 0.0;
+    };
+
+    // True when the build compiled the SNESONLINE_PROFILE_SCOPE markers in.
+    static constexpr bool compiledIn() noexcept {
+#if defined(SNESONLINE_ENABLE_PROFILER)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Runtime switch (on by default); scopes opened while off are not recorded.
+    static void setEnabled(bool enabled) noexcept;
+    static bool enabled() noexcept;
+
+    // Label for the calling thread in the trace (static string). Optional.
+    static void setThreadName(const char* name) noexcept;
+
+    // Drops every recorded event (events being recorded concurrently may survive).
+    static void clear() noexcept;
+
+    // Chrome trace ("Trace Event Format") JSON, loadable in chrome://tracing or Perfetto.
+    static bool writeChromeTrace(const char* path) noexcept;
+    static bool writeChromeTrace(std::FILE* f) noexcept;
+
+    // Per-name duration statistics over the recorded events, sorted by total time (descending).
+    static bool summarize(std::vector<PhaseStats>& out) noexcept;
+    // One line per phase: count, mean, p50, p99, max.
+    static bool writeSummary(std::FILE* f) noexcept;
+
+    // Events recorded but lost: more than kMaxThreads live recording threads, or the per-thread ring
+    // failed to allocate.
+    static uint64_t droppedEvents() noexcept;
+
+    // Used by ProfileScope.
+    static bool begin_(uint32_t& depth) noexcept;
+    static void end_(const char* name, Clock::time_point start, uint32_t depth) noexcept;
+};
+
+// Records one event from construction to destruction on the calling thread.
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) noexcept : name_(name) {
+        if (Profiler::begin_(depth_)) start_ = Profiler::Clock::now();
+        else name_ = nullptr;
+    }
+    ~ProfileScope() noexcept {
+        if (name_) Profiler::end_(name_, start_, depth_);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name_;
+    Profiler::Clock::time_point start_{};
+    uint32_t depth_ = 0;
+};
+
+} // namespace snesonline
+
+#if defined(SNESONLINE_ENABLE_PROFILER)
+#define SNESONLINE_PROFILE_CONCAT2_(a, b) a##b
+#define SNESONLINE_PROFILE_CONCAT_(a, b) SNESONLINE_PROFILE_CONCAT2_(a, b)
+#define SNESONLINE_PROFILE_SCOPE(name) ::snesonline::ProfileScope SNESONLINE_PROFILE_CONCAT_(snesonlineProfileScope_, __LINE__)(name)
+#else
+#define SNESONLINE_PROFILE_SCOPE(name) ((void)0)
+#endif
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace snesonline {
+
+class EmulatorEngine;
+
+// Replay file: everything needed to re-run a match frame for frame on the same core and ROM.
+//
+// Layout (integers big-endian, like the netplay wire formats):
+//   header, kReplayHeaderBytes:
+//     u32 magic 'SNRP', u16 version, u16 headerBytes
+//     u32 flags                 kReplayHasStartState
+//     u32 startFrame            session frame of the first recorded input
+//     u32 frameCount            kReplayUnknownFrames if the writer never closed the file
+//     u32 endChecksum           EmulatorEngine state checksum after the last frame; 0 => unknown
+//     u32 romCrc32, u32 romSizeBytes
+//     u32 stateRawBytes, u32 stateCompressedBytes, u32 stateCrc32 (crc32 of the raw state)
+//     char coreName[32], char coreVersion[32] (retro_get_system_info, NUL-padded)
+//   starting savestate, LZ-compressed (see Lz.h), when kReplayHasStartState is set
+//   input runs until end of file: u8 runLength (1..255), u16 p1Mask, u16 p2Mask
+//
+// Idle stretches and held buttons collapse into one 5-byte run per 255 frames; input that changes
+// every few frames costs a few kilobytes per minute of play.
+
+static constexpr uint32_t kReplayMagic = 0x534E5250u; // 'SNRP'
+static constexpr uint16_t kReplayVersion = 1;
+static constexpr std::size_t kReplayHeaderBytes = 128;
+static constexpr uint32_t kReplayHasStartState = 1u << 0;
+static constexpr uint32_t kReplayUnknownFrames = 0xFFFFFFFFu;
+
+struct ReplayHeader {
+    uint32_t flags = 0;
+    uint32_t startFrame = 0;
+    uint32_t frameCount = kReplayUnknownFrames;
+    uint32_t endChecksum = 0;
+    uint32_t romCrc32 = 0;
+    uint32_t romSizeBytes = 0;
+    uint32_t stateRawBytes = 0;
+    uint32_t stateCompressedBytes = 0;
+    uint32_t stateCrc32 = 0;
+    char coreName[32] = {};
+    char coreVersion[32] = {};
+};
+
+// Fills the core/ROM identity fields from the engine's loaded core and ROM file (reads the ROM once
+// to checksum it). Returns false, leaving the ROM fields 0, if the ROM file cannot be read.
+bool replayIdentity(EmulatorEngine& engine, ReplayHeader& out) noexcept;
+
+// True if the engine runs the core and ROM the replay was recorded on. The ROM is only compared
+// when both sides could checksum it.
+bool replayMatchesEngine(const ReplayHeader& header, EmulatorEngine& engine) noexcept;
+
+// Streams a replay to disk. open() does the one-off work (identity, savestate compression, buffer
+// allocation); recordFrame() then only appends to a fixed buffer that is written out when full.
+class ReplayWriter {
+public:
+    ReplayWriter() noexcept = default;
+    ~ReplayWriter() noexcept;
+
+    ReplayWriter(const ReplayWriter&) = delete;
+    ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+    // Starts a replay of `engine` from its current state. With `withStartState` the current
+    // savestate is embedded, so playback does not depend on how the game got to this point.
+    bool open(const char* path, EmulatorEngine& engine, uint32_t startFrame, bool withStartState = true) noexcept;
+
+    // Flushes the remaining runs and writes the final frame count and `endChecksum` into the header.
+    // Returns false if any write failed along the way.
+    bool close(uint32_t endChecksum = 0) noexcept;
+
+    bool isOpen() const noexcept { return file_ != nullptr; }
+
+    // Appends the inputs of the next frame. No allocation; a disk write every few hundred runs.
+    void recordFrame(uint16_t p1, uint16_t p2) noexcept {
+        if (!file_) return;
+        frames_++;
+        if (runLength_ != 0 && p1 == runP1_ && p2 == runP2_ && runLength_ < 255) {
+            runLength_++;
+            return;
+        }
+        if (runLength_ != 0) emitRun_();
+        runP1_ = p1;
+        runP2_ = p2;
+        runLength_ = 1;
+    }
+
+    uint32_t frameCount() const noexcept { return frames_; }
+    // Bytes written so far, header and savestate included.
+    uint64_t byteCount() const noexcept { return written_ + used_; }
+
+private:
+    void emitRun_() noexcept;
+    bool flush_() noexcept;
+
+    std::FILE* file_ = nullptr;
+    ReplayHeader header_{};
+    std::vector<uint8_t> buf_;
+    std::size_t used_ = 0;
+    uint64_t written_ = 0;
+    bool failed_ = false;
+
+    uint32_t frames_ = 0;
+    uint16_t runP1_ = 0;
+    uint16_t runP2_ = 0;
+    uint8_t runLength_ = 0;
+};
+
+// Reads a replay back one frame at a time.
+class ReplayReader {
+public:
+    ReplayReader() noexcept = default;
+    ~ReplayReader() noexcept;
+
+    ReplayReader(const ReplayReader&) = delete;
+    ReplayReader& operator=(const ReplayReader&) = delete;
+
+    // Parses the header and reads the compressed starting savestate into memory.
+    bool open(const char* path) noexcept;
+    void close() noexcept;
+
+    const ReplayHeader& header() const noexcept { return header_; }
+
+    // Loads the starting savestate into `engine` (no-op success when the replay has none) and
+    // rewinds the input stream to the first frame.
+    bool loadStartState(EmulatorEngine& engine) noexcept;
+
+    // Inputs of the next frame; false at the end of the replay (or at a truncated run).
+    bool next(uint16_t& p1, uint16_t& p2) noexcept;
+
+    uint32_t framesRead() const noexcept { return framesRead_; }
+
+private:
+    bool refill_() noexcept;
+
+    std::FILE* file_ = nullptr;
+    ReplayHeader header_{};
+    long inputsOffset_ = 0;
+    std::vector<uint8_t> state_;
+    std::vector<uint8_t> buf_;
+    std::size_t pos_ = 0;
+    std::size_t end_ = 0;
+
+    uint32_t framesRead_ = 0;
+    uint16_t runP1_ = 0;
+    uint16_t runP2_ = 0;
+    uint8_t runLeft_ = 0;
+};
+
+struct ReplayPlayback {
+    uint32_t frames = 0;
+    double seconds = 0.0;
+    // State checksum after the last frame, and whether it equals the recorded one (false when the
+    // replay has no end checksum).
+    uint32_t endChecksum = 0;
+    bool checksumMatched = false;
+};
+
+// Loads the starting state and runs every frame of the replay back to back, as fast as the core
+// allows. Video/audio go wherever the engine's sinks point; leave them unset for headless runs.
+// Fails if the replay was recorded on another core/ROM or the starting state does not load.
+bool playReplay(EmulatorEngine& engine, ReplayReader& reader, ReplayPlayback& out) noexcept;
+
+} // namespace snesonline
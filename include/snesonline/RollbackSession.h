@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <string>
+
+#include "snesonline/FrameScheduler.h"
+#include "snesonline/InputPacket.h"
+#include "snesonline/NetplayStats.h"
+#include "snesonline/Replay.h"
+#include "snesonline/SnapshotRing.h"
+#include "snesonline/SpectatorHost.h"
+
+namespace snesonline {
+
+class EmulatorEngine;
+enum class FrameOutput : uint8_t;
+
+// First-party UDP rollback netplay (no GGPO dependency).
+// Uses the same 8-byte packet as LockstepSession:
+//   u32 frame (big-endian)
+//   u16 inputMask (big-endian)
+//   u16 reserved: bit 15 set => low byte is the sender's frame lead (int8), used for time sync.
+//                 LockstepSession sends 0 and ignores the field.
+// and negotiates the same single-datagram v2 input packet (its aux field carries the lead).
+// Missing remote input is predicted by repeating the last confirmed mask. When the real input
+// arrives and differs, the engine is restored from a SnapshotRing slot and re-simulated.
+// Peers also ping each other with LockstepSession's control packets, only to measure round-trip
+// time and loss for stats(); peers that predate them drop the pings and the fields stay unknown.
+class RollbackSession {
+public:
+    RollbackSession() noexcept;
+    ~RollbackSession() noexcept;
+
+    RollbackSession(const RollbackSession&) = delete;
+    RollbackSession& operator=(const RollbackSession&) = delete;
+
+    static constexpr uint32_t kMaxInputDelayFrames = 15;
+    static constexpr uint32_t kMaxRollbackFrames = SnapshotRing::kMaxSlots - 2;
+
+    struct Config {
+        // If empty and localPlayerNum==1, the session will auto-discover the peer from the first UDP packet.
+        const char* remoteHost = "";
+        uint16_t remotePort = 7000;
+        uint16_t localPort = 7000;
+        uint8_t localPlayerNum = 1; // 1 or 2
+
+        // Local input is scheduled this many frames ahead (0..kMaxInputDelayFrames).
+        uint8_t inputDelayFrames = 2;
+        // How far the simulation may run on predicted input before stalling (0..kMaxRollbackFrames).
+        // 0 behaves like lockstep with a shorter delay.
+        uint8_t maxRollbackFrames = 8;
+
+        // Optional: server-assisted first connection (see LockstepSession::Config).
+        bool serverAssistFirstConnect = false;
+        const char* roomServerHost = "";
+        uint16_t roomServerPort = 0;
+        const char* roomCode = "";
+
+        // See LockstepSession::Config::inputPacketVersion.
+        uint8_t inputPacketVersion = 2;
+
+        // Serve spectators on this UDP port; 0 disables. Spectators only ever see frames whose
+        // inputs are confirmed, so they trail the players by the current prediction depth.
+        uint16_t spectatorPort = 0;
+        uint32_t maxSpectators = SpectatorHost::kDefaultMaxSpectators;
+
+        // Record the match to this replay file (see Replay.h); nullptr/empty disables. Like
+        // spectators, the replay only gets frames once their inputs are confirmed.
+        const char* replayPath = nullptr;
+
+        // Engine the session drives; nullptr => EmulatorEngine::instance().
+        EmulatorEngine* engine = nullptr;
+    };
+
+    // The core must already be loaded (its serialize size sizes the snapshot ring).
+    bool start(const Config& cfg) noexcept;
+    void stop() noexcept;
+
+    void setLocalInput(uint16_t mask) noexcept;
+    void tick() noexcept;
+
+    bool waitingForPeer() const noexcept { return waitingForPeer_; }
+    bool connected() const noexcept { return connected_; }
+
+    // Input datagrams received (one per packet, however many frames a v2 window carries).
+    uint64_t recvCount() const noexcept { return recvCount_; }
+    // Returns -1 if never received anything.
+    int64_t lastRecvAgeMs() const noexcept;
+
+    uint32_t localFrame() const noexcept { return frame_; }
+    // When the next local frame is due; frame loops can sleep until then between ticks.
+    std::chrono::steady_clock::time_point nextFrameDeadline() const noexcept { return pacer_.nextDeadline(); }
+    const FrameScheduler& scheduler() const noexcept { return pacer_; }
+    // Every remote input before this frame has been received.
+    uint32_t confirmedFrame() const noexcept { return confirmed_; }
+    uint32_t lastRemoteFrame() const noexcept { return lastRemoteFrame_; }
+    uint32_t maxRemoteFrame() const noexcept { return maxRemoteFrame_; }
+
+    uint32_t inputDelayFrames() const noexcept { return inputDelay_; }
+    uint32_t maxRollbackFrames() const noexcept { return maxRollback_; }
+    // Frames currently simulated on predicted input (negative: remote input is ahead of us).
+    int32_t frameLead() const noexcept { return static_cast<int32_t>(frame_ - confirmed_); }
+
+    uint64_t rollbackCount() const noexcept { return rollbacks_; }
+    uint64_t rolledBackFrames() const noexcept { return rolledBackFrames_; }
+    // Rollbacks whose snapshot was missing (should stay 0; non-zero means a likely desync).
+    uint64_t failedRollbacks() const noexcept { return failedRollbacks_; }
+
+    // Counters above plus RTT distribution, probe loss, reordering, stalls and traffic rates.
+    void stats(NetplayStats& out) const noexcept;
+
+    bool peerUsesPacketV2() const noexcept { return negotiator_.peerUsesV2(); }
+    uint64_t sentPacketCount() const noexcept { return sentPackets_; }
+    // UDP payload bytes (no IP/UDP headers).
+    uint64_t sentByteCount() const noexcept { return sentBytes_; }
+
+    const SpectatorHost& spectators() const noexcept { return spectators_; }
+    const ReplayWriter& replay() const noexcept { return replay_; }
+
+    // For UI/debug.
+    std::string peerEndpoint() const;
+
+private:
+#if defined(_WIN32)
+    using SocketHandle = uint64_t;
+    static constexpr SocketHandle kInvalidSocket = ~0ull;
+#else
+    using SocketHandle = int;
+    static constexpr SocketHandle kInvalidSocket = -1;
+#endif
+
+    void resetHistory_() noexcept;
+    void pumpRecv_() noexcept;
+    void sendLocal_() noexcept;
+    void storeRemoteInput_(uint32_t frame, uint16_t mask, uint16_t reserved) noexcept;
+    void resimulate_() noexcept;
+    void simulateFrame_(uint32_t f, FrameOutput output) noexcept;
+    void syncTime_() noexcept;
+    void publishFinalFrames_() noexcept;
+    void sendPing_() noexcept;
+
+    struct Peer {
+        uint32_t ipv4_be = 0; // network order
+        uint16_t port_be = 0; // network order
+        bool valid() const noexcept { return ipv4_be != 0 && port_be != 0; }
+    } peer_;
+
+    bool discoverPeer_ = false;
+
+    SocketHandle sock_ = kInvalidSocket;
+    uint16_t localPort_ = 7000;
+    uint16_t remotePort_ = 7000;
+    uint8_t localPlayerNum_ = 1;
+    EmulatorEngine* engine_ = nullptr;
+    uint32_t inputDelay_ = 2;
+    uint32_t maxRollback_ = 8;
+
+    uint16_t localMask_ = 0;
+    uint32_t frame_ = 0;
+    uint32_t confirmed_ = 0;
+
+    static constexpr uint32_t kBufN = 256;
+    static constexpr uint32_t kNoFrame = 0xFFFFFFFFu;
+    uint16_t remoteMask_[kBufN] = {};
+    uint32_t remoteFrameTag_[kBufN] = {};
+
+    uint16_t sentMask_[kBufN] = {};
+    uint32_t sentFrameTag_[kBufN] = {};
+
+    // Remote masks used for frames that ran on prediction.
+    uint16_t predictedMask_[kBufN] = {};
+    uint32_t predictedFrameTag_[kBufN] = {};
+    uint32_t rollbackFrom_ = kNoFrame;
+
+    SnapshotRing snapshots_;
+
+    // Peer's last reported lead (frames it is running ahead on prediction).
+    int32_t remoteLead_ = 0;
+    bool remoteLeadValid_ = false;
+    uint32_t nextSyncFrame_ = 0;
+
+    bool waitingForPeer_ = false;
+    bool connected_ = false;
+    std::chrono::steady_clock::time_point lastRecv_{};
+    FrameScheduler pacer_;
+
+    uint64_t recvCount_ = 0;
+    uint64_t rollbacks_ = 0;
+    uint64_t rolledBackFrames_ = 0;
+    uint64_t failedRollbacks_ = 0;
+
+    std::chrono::steady_clock::time_point lastPingSent_{};
+    // Set while the simulation is held back by maxRollback_ waiting for remote input.
+    std::chrono::steady_clock::time_point stallStart_{};
+    NetplayStatsTracker statsTracker_;
+
+    InputPacketNegotiator negotiator_;
+    bool allowPacketV2_ = true;
+    uint64_t sentPackets_ = 0;
+    uint64_t sentBytes_ = 0;
+
+    uint32_t lastRemoteFrame_ = 0;
+    uint32_t maxRemoteFrame_ = 0;
+
+    SpectatorHost spectators_;
+    ReplayWriter replay_;
+    // Next confirmed frame to hand to spectators_ and replay_.
+    uint32_t finalFrame_ = 0;
+};
+
+} // namespace snesonline
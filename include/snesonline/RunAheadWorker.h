@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "snesonline/AlignedBuffer.h"
+#include "snesonline/LibretroCore.h"
+
+namespace snesonline {
+
+// Second emulator instance for run-ahead on its own thread (EmulatorEngine::setRunAheadSecondInstance).
+//
+// The instance is kept `aheadFrames` ahead of the primary. After each real frame the emulation
+// thread submits a job, and the worker either runs one more frame (input unchanged, so its
+// prediction still holds) or first reloads the primary's state and runs the hidden frames again.
+// Only the worker's last frame of a job produces video, delivered to the given sink on the worker
+// thread; its audio is discarded. Jobs overlap with the primary's next frame, so the cost lands on
+// a second CPU core instead of the emulation thread.
+//
+// wait(), stateBuffer() and submit() are called from one thread (the engine's).
+class RunAheadWorker {
+public:
+    RunAheadWorker() noexcept = default;
+    ~RunAheadWorker() noexcept { stop(); }
+
+    RunAheadWorker(const RunAheadWorker&) = delete;
+    RunAheadWorker& operator=(const RunAheadWorker&) = delete;
+
+    // Loads `corePath` again (LibretroCore makes a private copy of a core already loaded) with
+    // `romPath`, and starts the thread.
+    bool start(const char* corePath, const char* romPath) noexcept;
+    void stop() noexcept;
+    bool running() const noexcept { return thread_.joinable(); }
+
+    // Blocks until the last submitted job has finished.
+    void wait() noexcept;
+
+    // Buffer for the primary's state of a resync job, grown to `sizeBytes` if needed (nullptr if that
+    // fails). Only valid between wait() and submit().
+    void* stateBuffer(std::size_t sizeBytes) noexcept;
+
+    // Queues one shown frame on `port0Mask` / `port1Mask`. With `resync`, the worker first loads the
+    // `stateBytes` written to stateBuffer() and runs aheadFrames - 1 hidden frames. Call after wait().
+    void submit(bool resync, std::size_t stateBytes, uint32_t aheadFrames, uint16_t port0Mask, uint16_t port1Mask, void* videoCtx,
+                LibretroCore::VideoRefreshFn videoFn) noexcept;
+
+    // True if the instance has lost track of the primary (e.g. its state failed to load), so the
+    // next job must resync. Read after wait().
+    bool needsResync() const noexcept { return !inSync_; }
+
+    uint64_t jobCount() const noexcept { return jobs_.load(std::memory_order_relaxed); }
+    uint64_t resyncCount() const noexcept { return resyncs_.load(std::memory_order_relaxed); }
+    // Frames run by the second instance (hidden plus shown).
+    uint64_t frameCount() const noexcept { return frames_.load(std::memory_order_relaxed); }
+
+private:
+    struct Job {
+        bool resync = false;
+        std::size_t stateBytes = 0;
+        uint32_t aheadFrames = 1;
+        uint16_t masks[2] = {0, 0};
+        void* videoCtx = nullptr;
+        LibretroCore::VideoRefreshFn videoFn = nullptr;
+    };
+
+    void threadMain_() noexcept;
+    void run_(const Job& job) noexcept;
+
+    // Single-writer counter: plain load + store, readable from any thread.
+    static void add_(std::atomic<uint64_t>& c, uint64_t n) noexcept {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    LibretroCore core_;
+    AlignedBuffer state_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    Job job_{};
+    bool queued_ = false;
+    bool busy_ = false;
+    bool stopping_ = false;
+
+    // Worker-owned while busy_, engine-readable after wait().
+    bool inSync_ = false;
+
+    std::atomic<uint64_t> jobs_{0};
+    std::atomic<uint64_t> resyncs_{0};
+    std::atomic<uint64_t> frames_{0};
+};
+
+} // namespace snesonline
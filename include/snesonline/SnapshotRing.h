@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "snesonline/AlignedBuffer.h"
+
+namespace snesonline {
+
+class EmulatorEngine;
+
+// Frame-indexed ring of preallocated savestate slots for rollback netcode.
+// All slots live in one aligned allocation sized once at session start, so saving and
+// loading a frame never allocates and the core serializes straight into slot memory.
+// A slot for frame F is reused by frame F + slotCount().
+class SnapshotRing {
+public:
+    struct Slot {
+        uint8_t* data = nullptr;
+        std::size_t sizeBytes = 0;
+        uint32_t checksum = 0;
+        uint32_t frame = 0xFFFFFFFFu; // 0xFFFFFFFF => empty
+    };
+
+    static constexpr uint32_t kMaxSlots = 32;
+
+    SnapshotRing() noexcept = default;
+
+    SnapshotRing(const SnapshotRing&) = delete;
+    SnapshotRing& operator=(const SnapshotRing&) = delete;
+
+    // slotBytes is usually LibretroCore::serializeSize(). slotCount is clamped to [1, kMaxSlots].
+    bool allocate(std::size_t slotBytes, uint32_t slotCount) noexcept;
+    void reset() noexcept;
+
+    bool ready() const noexcept { return slotCount_ != 0; }
+    std::size_t slotBytes() const noexcept { return slotBytes_; }
+    uint32_t slotCount() const noexcept { return slotCount_; }
+
+    // Serializes the engine state into the slot for `frame`. Returns nullptr on failure
+    // (ring not allocated, or the core's state grew beyond slotBytes()).
+    const Slot* save(EmulatorEngine& engine, uint32_t frame) noexcept;
+
+    // Restores the snapshot taken for `frame`. Fails if it was overwritten or never saved.
+    bool load(EmulatorEngine& engine, uint32_t frame) const noexcept;
+
+    // Returns the slot holding `frame`, or nullptr if it is not (or no longer) present.
+    const Slot* find(uint32_t frame) const noexcept;
+
+    // True if `p` points into ring storage (used to recognize ring-owned buffers handed to GGPO).
+    bool owns(const void* p) const noexcept;
+
+    // Marks all slots empty without releasing memory.
+    void invalidate() noexcept;
+
+private:
+    AlignedBuffer storage_;
+    std::size_t slotBytes_ = 0;
+    std::size_t strideBytes_ = 0;
+    uint32_t slotCount_ = 0;
+    Slot slots_[kMaxSlots];
+};
+
+} // namespace snesonline
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace snesonline {
+
+class EmulatorEngine;
+
+namespace wire {
+struct SpectatorAck;
+}
+
+// Serves read-only spectators from a netplay host. Spectators do not take part in the match: they
+// receive the confirmed inputs of both players and run their own emulator. A spectator joining
+// mid-game first gets an LZ-compressed savestate (see Lz.h), then the inputs from that frame on,
+// and fast-forwards to the live frame (SpectatorSession).
+//
+// Everything happens on the session's thread from one service() call per frame: one socket, one
+// input history shared by all spectators, and inputs sent in batches of kBatchFrames (one datagram
+// carries both players' masks for all frames in the batch). A spectator costs roughly
+// 4 datagrams/s and a few hundred bytes/s while live; snapshots are reused across joins that arrive
+// close together.
+class SpectatorHost {
+public:
+    static constexpr uint32_t kDefaultMaxSpectators = 32;
+    // Frames per input datagram while live (~250 ms of play).
+    static constexpr uint32_t kBatchFrames = 15;
+
+    SpectatorHost() noexcept = default;
+    ~SpectatorHost() noexcept;
+
+    SpectatorHost(const SpectatorHost&) = delete;
+    SpectatorHost& operator=(const SpectatorHost&) = delete;
+
+    // Opens the spectator socket. `firstFrame` is the first frame that will be recorded.
+    bool start(uint16_t localPort, uint32_t maxSpectators, uint32_t firstFrame = 0) noexcept;
+    void stop() noexcept;
+    bool active() const noexcept;
+
+    // Records the inputs of `frame`; frames must be recorded in order without gaps.
+    void recordFrame(uint32_t frame, uint16_t p1Mask, uint16_t p2Mask) noexcept;
+
+    // The engine's state changed outside the recorded inputs (e.g. a savestate was loaded):
+    // every spectator downloads a new snapshot.
+    void invalidate() noexcept;
+
+    // Handles joins/acks and sends inputs and snapshot chunks. `stateFrame` is the next frame the
+    // engine will run; pass `stateConfirmed` = false while that state depends on predicted input
+    // (rollback), so no snapshot is taken from it.
+    void service(EmulatorEngine& engine, uint32_t stateFrame, bool stateConfirmed) noexcept;
+
+    uint32_t spectatorCount() const noexcept { return static_cast<uint32_t>(viewers_.size()); }
+    uint64_t joinCount() const noexcept { return joins_; }
+    uint64_t snapshotCount() const noexcept { return snapshotsTaken_; }
+    // Size of the most recent snapshot, before and after compression.
+    std::size_t lastSnapshotRawBytes() const noexcept { return lastRawBytes_; }
+    std::size_t lastSnapshotCompressedBytes() const noexcept { return lastCompressedBytes_; }
+    uint64_t sentPacketCount() const noexcept { return sentPackets_; }
+    // UDP payload bytes (no IP/UDP headers), split by kind.
+    uint64_t sentInputBytes() const noexcept { return sentInputBytes_; }
+    uint64_t sentSnapshotBytes() const noexcept { return sentSnapshotBytes_; }
+    uint64_t recvByteCount() const noexcept { return recvBytes_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+#if defined(_WIN32)
+    using SocketHandle = uint64_t;
+    static constexpr SocketHandle kInvalidSocket = ~0ull;
+#else
+    using SocketHandle = int;
+    static constexpr SocketHandle kInvalidSocket = -1;
+#endif
+
+    struct Snapshot {
+        uint32_t frame = 0;
+        uint32_t rawBytes = 0;
+        uint32_t rawCrc = 0;
+        std::vector<uint8_t> compressed;
+        Clock::time_point taken{};
+    };
+
+    struct Viewer {
+        enum class Phase : uint8_t { WaitSnapshot, Snapshot, Inputs };
+
+        uint32_t ipv4_be = 0;
+        uint16_t port_be = 0;
+        Clock::time_point lastHeard{};
+        Phase phase = Phase::WaitSnapshot;
+
+        // Snapshot phase: go-back-N over the chunks of `snapshot`.
+        std::shared_ptr<const Snapshot> snapshot;
+        uint16_t nextChunk = 0;
+        uint16_t ackedChunk = 0;
+        Clock::time_point lastChunkPass{};
+        Clock::time_point nextChunkAt{};
+
+        // Input phase: frames < ackedFrame are confirmed received, frames < sentFrame were sent.
+        uint32_t ackedFrame = 0;
+        uint32_t sentFrame = 0;
+        Clock::time_point lastProgress{};
+        Clock::time_point lastSend{};
+    };
+
+    void receive_(const Clock::time_point& now) noexcept;
+    void handleAck_(uint32_t ipv4_be, uint16_t port_be, const wire::SpectatorAck& ack, const Clock::time_point& now) noexcept;
+    bool prepareSnapshot_(EmulatorEngine& engine, uint32_t stateFrame, bool stateConfirmed, const Clock::time_point& now) noexcept;
+    void sendChunks_(Viewer& v, const Clock::time_point& now) noexcept;
+    void sendInputs_(Viewer& v, const Clock::time_point& now) noexcept;
+    void trimHistory_() noexcept;
+    bool sendTo_(const Viewer& v, const void* data, std::size_t sizeBytes) noexcept;
+
+    uint32_t historyEnd_() const noexcept { return historyBase_ + static_cast<uint32_t>(history_.size()); }
+
+    SocketHandle sock_ = kInvalidSocket;
+    uint32_t maxViewers_ = kDefaultMaxSpectators;
+    std::vector<Viewer> viewers_;
+
+    // history_[i] = p1 | (p2 << 16) for frame historyBase_ + i.
+    std::vector<uint32_t> history_;
+    uint32_t historyBase_ = 0;
+    // Snapshots taken before this frame no longer match the host (see invalidate()).
+    uint32_t validFrom_ = 0;
+
+    std::shared_ptr<const Snapshot> snapshot_;
+    std::vector<uint8_t> stateScratch_;
+
+    uint64_t joins_ = 0;
+    uint64_t snapshotsTaken_ = 0;
+    std::size_t lastRawBytes_ = 0;
+    std::size_t lastCompressedBytes_ = 0;
+    uint64_t sentPackets_ = 0;
+    uint64_t sentInputBytes_ = 0;
+    uint64_t sentSnapshotBytes_ = 0;
+    uint64_t recvBytes_ = 0;
+};
+
+} // namespace snesonline
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "snesonline/NetplayStats.h"
+
+namespace snesonline {
+
+class EmulatorEngine;
+enum class FrameOutput : uint8_t;
+
+// Watches a match served by a SpectatorHost (LockstepSession/RollbackSession `spectatorPort`).
+// Joining downloads a compressed savestate; the session loads it, then runs the confirmed inputs the
+// host streams, fast-forwarding (several frames per tick, within a time budget) until it is live.
+// Live playback trails the players by about two input batches so bursts never starve it.
+class SpectatorSession {
+public:
+    SpectatorSession() noexcept;
+    ~SpectatorSession() noexcept;
+
+    SpectatorSession(const SpectatorSession&) = delete;
+    SpectatorSession& operator=(const SpectatorSession&) = delete;
+
+    struct Config {
+        const char* hostAddress = ""; // hostname or IPv4
+        uint16_t hostPort = 7001;
+        uint16_t localPort = 0; // 0 => any free port
+
+        // Upper bound on emulation time per tick while fast-forwarding.
+        uint32_t catchUpBudgetMicros = 8000;
+
+        // Engine the session drives; nullptr => EmulatorEngine::instance().
+        EmulatorEngine* engine = nullptr;
+    };
+
+    bool start(const Config& cfg) noexcept;
+    void stop() noexcept;
+
+    // Call once per 60 Hz frame slot: receives, acks, and runs the frames that are due.
+    void tick() noexcept;
+
+    // A snapshot has been loaded and frames are being played.
+    bool joined() const noexcept { return joined_; }
+    // Caught up: within a couple of batches of the newest received input.
+    bool live() const noexcept { return live_; }
+
+    // Next frame the engine will run, and the first frame whose inputs have not arrived yet.
+    uint32_t frame() const noexcept { return frame_; }
+    uint32_t receivedFrame() const noexcept { return receivedEnd_; }
+    uint32_t snapshotFrame() const noexcept { return snapshotFrame_; }
+    std::size_t snapshotCompressedBytes() const noexcept { return snapshotCompressedBytes_; }
+
+    // UDP payload bytes (no IP/UDP headers).
+    uint64_t recvByteCount() const noexcept { return recvBytes_; }
+    uint64_t recvPacketCount() const noexcept { return recvPackets_; }
+    uint64_t sentByteCount() const noexcept { return sentBytes_; }
+    uint64_t sentPacketCount() const noexcept { return sentPackets_; }
+
+    // Frames and traffic in the shape the player sessions report. connected: joined; waiting: not live.
+    void stats(NetplayStats& out) const noexcept;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+#if defined(_WIN32)
+    using SocketHandle = uint64_t;
+    static constexpr SocketHandle kInvalidSocket = ~0ull;
+#else
+    using SocketHandle = int;
+    static constexpr SocketHandle kInvalidSocket = -1;
+#endif
+
+    void receive_() noexcept;
+    void handleInputs_(const uint8_t* data, std::size_t sizeBytes) noexcept;
+    void handleChunk_(const uint8_t* data, std::size_t sizeBytes) noexcept;
+    bool finishSnapshot_() noexcept;
+    void sendAck_() noexcept;
+    void runFrame_(FrameOutput output) noexcept;
+
+    SocketHandle sock_ = kInvalidSocket;
+    uint32_t hostIpv4_be = 0;
+    uint16_t hostPort_be = 0;
+    EmulatorEngine* engine_ = nullptr;
+    uint32_t catchUpBudgetUs_ = 8000;
+
+    bool joined_ = false;
+    bool live_ = false;
+    uint32_t frame_ = 0;
+    uint32_t receivedEnd_ = 0;
+    uint32_t snapshotFrame_ = 0;
+    std::size_t snapshotCompressedBytes_ = 0;
+    // End of the newest input datagram seen; receivedEnd_ catches up to it unless something was lost.
+    uint32_t newestSeen_ = 0;
+
+    static constexpr uint32_t kRingN = 8192;
+    std::vector<uint32_t> ringMask_;
+    std::vector<uint32_t> ringTag_;
+
+    // Snapshot being assembled (assemblyFrame_ == kNoFrame: none).
+    static constexpr uint32_t kNoFrame = 0xFFFFFFFFu;
+    uint32_t assemblyFrame_ = kNoFrame;
+    uint32_t assemblyRawBytes_ = 0;
+    uint32_t assemblyCrc_ = 0;
+    uint16_t assemblyChunks_ = 0;
+    uint16_t nextChunk_ = 0;
+    std::vector<uint8_t> assembly_;
+    std::vector<uint8_t> chunkReceived_;
+    std::vector<uint8_t> rawState_;
+
+    bool ackDue_ = false;
+    Clock::time_point lastAck_{};
+
+    uint64_t recvBytes_ = 0;
+    uint64_t recvPackets_ = 0;
+    uint64_t sentBytes_ = 0;
+    uint64_t sentPackets_ = 0;
+    Clock::time_point lastRecv_{};
+    NetplayStatsTracker statsTracker_;
+};
+
+} // namespace snesonline
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace snesonline {
+
+// Wait-free single-producer/single-consumer ring of trivially copyable items.
+// Capacity is a power of two known at compile time and the storage is inline, so handing an item
+// between threads never allocates. Exactly one thread may push and exactly one thread may pop.
+template <typename T, uint32_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() noexcept = default;
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    static constexpr uint32_t capacity() noexcept { return Capacity; }
+
+    // Producer side. Returns false (and drops nothing already queued) when full.
+    bool tryPush(const T& item) noexcept {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - tailCache_ >= Capacity) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head - tailCache_ >= Capacity) return false;
+        }
+        items_[head & (Capacity - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer side: reserve the next slot to fill in place, then publish it with commitPush().
+    T* beginPush() noexcept {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - tailCache_ >= Capacity) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head - tailCache_ >= Capacity) return nullptr;
+        }
+        return &items_[head & (Capacity - 1)];
+    }
+    void commitPush() noexcept { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Consumer side. Returns nullptr when empty; the item stays valid until popFront().
+    const T* front() noexcept {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == headCache_) {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (tail == headCache_) return nullptr;
+        }
+        return &items_[tail & (Capacity - 1)];
+    }
+    void popFront() noexcept { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    bool tryPop(T& out) noexcept {
+        const T* item = front();
+        if (!item) return false;
+        out = *item;
+        popFront();
+        return true;
+    }
+
+    // Approximate when called concurrently with the other side.
+    uint32_t size() const noexcept {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    // Only valid while neither side is active.
+    void clear() noexcept {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        headCache_ = 0;
+        tailCache_ = 0;
+    }
+
+private:
+    // Producer-owned line: head plus its cached view of tail.
+    alignas(64) std::atomic<uint32_t> head_{0};
+    uint32_t tailCache_ = 0;
+    // Consumer-owned line: tail plus its cached view of head.
+    alignas(64) std::atomic<uint32_t> tail_{0};
+    uint32_t headCache_ = 0;
+    alignas(64) T items_[Capacity];
+};
+
+} // namespace snesonline
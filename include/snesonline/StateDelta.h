@@ -0,0 +1,210 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "snesonline/BulkTransfer.h"
+
+namespace snesonline {
+
+// Delta resync of a serialized state. After a desync the joiner still has a state that differs from
+// the host's in a few places, so instead of resending all of it the host offers a hash tree over its
+// state and the joiner walks it top-down, fetching only the blocks that differ.
+//
+// The state is cut into kDeltaBlockBytes blocks. A leaf is the CRC-32C of one block, an inner node
+// the CRC-32C of its (up to kDeltaFanout) children's hashes in big-endian order; level 0 is the root.
+// The joiner builds the same tree over its own state, fetches the deepest level that fits one
+// datagram in full, then the children of every node that differs, level by level, and finally the
+// differing blocks, which come back concatenated and LZ-compressed (Lz.h) as one BulkSender
+// transfer. The patched state must match the CRC-32 of the host's state; if it does not (a hash
+// collision, or a base of another size), the joiner fetches every block the same way.
+//
+// As with BulkTransfer.h, neither side owns a socket: the caller routes datagrams to onDatagram()
+// and sends what poll() returns. Wire formats (big-endian):
+//   offer 'SNOT', 20 bytes: u32 magic, u32 stateBytes, u32 stateCrc32, u32 rootHash,
+//     u16 blockBytes, u16 fanout
+//   node request 'SNOU', 16 bytes: u32 magic, u32 stateCrc32, u8 level, u8 reserved, u16 first, u16 count
+//   node hashes 'SNOV', 16 + 4 * count bytes: the request's header, then count x u32 hash
+//   block request 'SNOW', 12 + bitmap bytes: u32 magic, u32 stateCrc32, u32 leafCount,
+//     one bit per block (LSB first)
+//   patch: bulk transfer on the caller's channel: u32 stateCrc32, u32 crc32 of the request bitmap,
+//     then the requested blocks in order, LZ-compressed
+
+static constexpr uint32_t kDeltaOfferMagic = 0x534E4F54u;        // 'SNOT'
+static constexpr uint32_t kDeltaNodeRequestMagic = 0x534E4F55u;  // 'SNOU'
+static constexpr uint32_t kDeltaNodeHashesMagic = 0x534E4F56u;   // 'SNOV'
+static constexpr uint32_t kDeltaBlockRequestMagic = 0x534E4F57u; // 'SNOW'
+
+static constexpr std::size_t kDeltaOfferBytes = 20;
+static constexpr uint32_t kDeltaBlockBytes = 512;
+static constexpr uint32_t kDeltaFanout = 16;
+// Most hashes in one 'SNOV' datagram.
+static constexpr uint32_t kDeltaMaxHashesPerDatagram = 256;
+// The block request bitmap fits one base-size datagram: about 4.8 MB of state.
+static constexpr uint32_t kDeltaMaxLeaves = static_cast<uint32_t>((kBulkBaseDatagramBytes - 12) * 8);
+
+class BlockHashTree {
+public:
+    BlockHashTree() noexcept = default;
+
+    bool build(const void* data, std::size_t sizeBytes, uint32_t blockBytes = kDeltaBlockBytes,
+               uint32_t fanout = kDeltaFanout) noexcept;
+    void clear() noexcept;
+
+    bool empty() const noexcept { return counts_.empty(); }
+    uint32_t levelCount() const noexcept { return static_cast<uint32_t>(counts_.size()); }
+    uint32_t nodeCount(uint32_t level) const noexcept { return level < counts_.size() ? counts_[level] : 0u; }
+    uint32_t hash(uint32_t level, uint32_t index) const noexcept { return hashes_[offsets_[level] + index]; }
+    uint32_t root() const noexcept { return empty() ? 0u : hashes_[0]; }
+    uint32_t leafCount() const noexcept { return empty() ? 0u : counts_.back(); }
+    uint32_t blockBytes() const noexcept { return blockBytes_; }
+    uint32_t fanout() const noexcept { return fanout_; }
+    std::size_t sizeBytes() const noexcept { return sizeBytes_; }
+
+private:
+    // All levels, root first.
+    std::vector<uint32_t> hashes_;
+    std::vector<uint32_t> offsets_;
+    std::vector<uint32_t> counts_;
+    uint32_t blockBytes_ = 0;
+    uint32_t fanout_ = 0;
+    std::size_t sizeBytes_ = 0;
+};
+
+// Host side: answers the joiner's node and block requests for one state.
+class DeltaSyncHost {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    DeltaSyncHost() noexcept = default;
+
+    DeltaSyncHost(const DeltaSyncHost&) = delete;
+    DeltaSyncHost& operator=(const DeltaSyncHost&) = delete;
+
+    // Offers a copy of `state`; the patch goes out as a bulk transfer on `bulkChannel`.
+    // Fails for states with more than kDeltaMaxLeaves blocks.
+    bool begin(uint8_t bulkChannel, const void* state, std::size_t sizeBytes) noexcept;
+    void cancel() noexcept;
+
+    bool active() const noexcept { return active_; }
+    // The joiner has sent a valid request (it understands delta resync).
+    bool receiverSeen() const noexcept { return receiverSeen_; }
+    uint8_t channel() const noexcept { return channel_; }
+
+    // The 'SNOT' offer; returns its size (kDeltaOfferBytes), 0 when inactive.
+    std::size_t writeOffer(uint8_t* out, std::size_t capacity) const noexcept;
+
+    // Feed 'SNOU'/'SNOW' requests and bulk acks for this host's channel (anything else is ignored).
+    void onDatagram(const uint8_t* data, std::size_t sizeBytes, Clock::time_point now) noexcept;
+
+    // Node replies and patch datagrams due now, at most min(maxCount, kBulkMaxBatch). They stay
+    // valid until the next poll() or begin().
+    std::size_t poll(Clock::time_point now, BulkDatagram* out, std::size_t maxCount) noexcept;
+
+    uint32_t patchBlockCount() const noexcept { return patchBlocks_; }
+    uint64_t sentByteCount() const noexcept { return sentBytes_ + patch_.sentByteCount(); }
+
+private:
+    struct Reply {
+        uint8_t level = 0;
+        uint16_t first = 0;
+        uint16_t count = 0;
+    };
+
+    void startPatch_(const uint8_t* bitmap, uint32_t requestCrc) noexcept;
+
+    bool active_ = false;
+    bool receiverSeen_ = false;
+    uint8_t channel_ = 0;
+    uint32_t crc_ = 0;
+    std::vector<uint8_t> state_;
+    BlockHashTree tree_;
+
+    std::vector<Reply> replies_;
+    uint32_t patchRequestCrc_ = 0;
+    uint32_t patchBlocks_ = 0;
+    BulkSender patch_;
+    std::vector<uint8_t> scratch_;
+    uint64_t sentBytes_ = 0;
+};
+
+// Joiner side: rebuilds the host's state from its own and the blocks that differ.
+class DeltaSyncJoiner {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    DeltaSyncJoiner() noexcept = default;
+
+    DeltaSyncJoiner(const DeltaSyncJoiner&) = delete;
+    DeltaSyncJoiner& operator=(const DeltaSyncJoiner&) = delete;
+
+    // True if `offer` describes the state this joiner is already fetching (repeated offers).
+    bool isCurrentOffer(const uint8_t* offer, std::size_t offerBytes) const noexcept;
+
+    // Starts fetching the offered state, patching a copy of `base` (the joiner's own serialized
+    // state; may be empty). The patch is expected as a bulk transfer on `bulkChannel`.
+    bool begin(uint8_t bulkChannel, const uint8_t* offer, std::size_t offerBytes, const void* base, std::size_t baseBytes) noexcept;
+    void reset() noexcept;
+
+    bool active() const noexcept { return size_ != 0; }
+    // The state is rebuilt and matches the offer's CRC.
+    bool complete() const noexcept { return phase_ == Phase::Complete; }
+    uint32_t stateBytes() const noexcept { return size_; }
+    uint32_t stateCrc() const noexcept { return crc_; }
+    // The rebuilt state once complete().
+    const std::vector<uint8_t>& state() const noexcept { return state_; }
+
+    // Feed 'SNOV' replies and bulk data for this joiner's channel. Returns true when this datagram
+    // completed the state.
+    bool onDatagram(const uint8_t* data, std::size_t sizeBytes, Clock::time_point now) noexcept;
+
+    // Requests (repeated while unanswered) and patch acks due now.
+    std::size_t poll(Clock::time_point now, BulkDatagram* out, std::size_t maxCount) noexcept;
+
+    // Blocks fetched by the last request (all of them after a fallback) and whether it was a fallback.
+    uint32_t blocksRequested() const noexcept { return blocksRequested_; }
+    bool fetchedEverything() const noexcept { return fetchAll_; }
+
+private:
+    enum class Phase : uint8_t { Idle, Nodes, Blocks, Complete };
+
+    void startLevel_(uint32_t level, const std::vector<uint32_t>& parents) noexcept;
+    void finishLevel_() noexcept;
+    void requestBlocks_(const std::vector<uint32_t>& leaves) noexcept;
+    void requestAll_() noexcept;
+    bool applyPatch_() noexcept;
+
+    Phase phase_ = Phase::Idle;
+    uint8_t channel_ = 0;
+    uint32_t size_ = 0;
+    uint32_t crc_ = 0;
+    uint32_t root_ = 0;
+    uint32_t blockBytes_ = 0;
+    uint32_t fanout_ = 0;
+    uint32_t leafCount_ = 0;
+
+    BlockHashTree tree_;
+    std::vector<uint8_t> state_;
+
+    // Level being fetched: which nodes were asked for, which arrived, and their remote hashes.
+    uint32_t level_ = 0;
+    std::vector<uint8_t> wanted_;
+    std::vector<uint8_t> have_;
+    std::vector<uint32_t> remote_;
+    uint32_t missing_ = 0;
+
+    std::vector<uint8_t> bitmap_;
+    uint32_t requestCrc_ = 0;
+    uint32_t blocksRequested_ = 0;
+    bool fetchAll_ = false;
+    BulkReceiver patch_;
+    std::vector<uint8_t> patchRaw_;
+
+    bool requestDue_ = false;
+    Clock::time_point lastRequest_{};
+    std::vector<uint8_t> scratch_;
+};
+
+} // namespace snesonline
@@ -86,8 +86,9 @@ public class GameActivity extends Activity {
 
     private static final int MAX_W = 512;
     private static final int MAX_H = 512;
-    private ByteBuffer video;
-    private IntBuffer videoInts;
+    private IntBuffer[] videoBuffers;
+    private final int[] videoInfo = new int[3];
+    private int lastVideoSeq = 0;
     private int[] videoArray;
     private Bitmap bitmap;
 
@@ -215,6 +216,7 @@ public class GameActivity extends Activity {
                 finish();
                 return;
             }
+            applyRunAhead();
             initVideo();
             NativeBridge.nativeStartLoop();
             startGameplay();
@@ -268,6 +270,7 @@ public class GameActivity extends Activity {
                     sharedSecret);
                 if (!ok) throw new Exception("Native init failed");
 
+                applyRunAhead();
                 initVideo();
                 NativeBridge.nativeStartLoop();
                 ui.post(this::startWaitingLoop);
@@ -310,6 +313,7 @@ public class GameActivity extends Activity {
                         "");
                 if (!ok) throw new Exception("Native init failed");
 
+                applyRunAhead();
                 initVideo();
                 NativeBridge.nativeStartLoop();
 
@@ -329,11 +333,24 @@ public class GameActivity extends Activity {
         if (hasFocus) applyImmersiveFullscreen();
     }
 
+    // Optional intent extras: "runAheadFrames" (0 = off) and "runAheadSecondInstance".
+    private void applyRunAhead() {
+        int frames = getIntent().getIntExtra("runAheadFrames", 0);
+        if (frames <= 0) return;
+        boolean second = getIntent().getBooleanExtra("runAheadSecondInstance", true);
+        if (!NativeBridge.nativeSetRunAhead(frames, second) && second) {
+            Log.w(TAG, "Second-instance run-ahead unavailable; using single-instance");
+        }
+    }
+
     private void initVideo() {
-        video = NativeBridge.nativeGetVideoBufferRGBA();
-        if (video != null) {
-            video.order(ByteOrder.nativeOrder());
-            videoInts = video.asIntBuffer();
+        ByteBuffer[] buffers = NativeBridge.nativeGetVideoBuffersRGBA();
+        if (buffers != null) {
+            videoBuffers = new IntBuffer[buffers.length];
+            for (int i = 0; i < buffers.length; i++) {
+                buffers[i].order(ByteOrder.nativeOrder());
+                videoBuffers[i] = buffers[i].asIntBuffer();
+            }
         }
         bitmap = Bitmap.createBitmap(MAX_W, MAX_H, Bitmap.Config.ARGB_8888);
         videoArray = new int[MAX_W * MAX_H];
@@ -734,10 +751,16 @@ public class GameActivity extends Activity {
             try { android.os.SystemClock.sleep(10); } catch (Exception ignored) {}
         }
 
-        audioSampleRateHz = nativeHzRaw;
+        // Play at the device's native rate (no resampling in the Android mixer); native code
+        // converts the core's audio to it.
+        audioSampleRateHz = AudioTrack.getNativeOutputSampleRate(AudioManager.STREAM_MUSIC);
+        if (audioSampleRateHz < 8000 || audioSampleRateHz > 192000) {
+            audioSampleRateHz = nativeHzRaw;
+        }
         if (audioSampleRateHz < 8000 || audioSampleRateHz > 192000) {
             audioSampleRateHz = 48000;
         }
+        NativeBridge.nativeSetAudioOutputSampleRateHz(audioSampleRateHz);
 
         final int channelMask = AudioFormat.CHANNEL_OUT_STEREO;
         final int format = AudioFormat.ENCODING_PCM_16BIT;
@@ -809,8 +832,11 @@ public class GameActivity extends Activity {
                     if (buffered < 0) buffered += audioJitterCapacityFrames;
                     int free = audioJitterCapacityFrames - buffered;
                     if (free < 64) break;
+                    // Take only the next write's worth: the backlog stays in the native ring,
+                    // whose fill level steers the resampler's rate.
+                    if (buffered >= framesWanted) break;
 
-                    int want = Math.min(pumpChunkFrames, free);
+                    int want = Math.min(pumpChunkFrames, Math.min(free, framesWanted - buffered));
                     int got = NativeBridge.nativePopAudio(pumpChunk, want);
                     if (got < 0) got = 0;
                     if (got == 0) break;
@@ -887,17 +913,24 @@ public class GameActivity extends Activity {
     }
 
     private void renderOnce() {
-        if (holder == null || video == null || bitmap == null) return;
+        if (holder == null || videoBuffers == null || bitmap == null) return;
 
-        final int w = NativeBridge.nativeGetVideoWidth();
-        final int h = NativeBridge.nativeGetVideoHeight();
+        final int idx = NativeBridge.nativeAcquireVideoFrame(videoInfo);
+        if (idx < 0 || idx >= videoBuffers.length) return;
+        final int w = videoInfo[0];
+        final int h = videoInfo[1];
         if (w <= 0 || h <= 0) return;
 
-        // Copy full backing buffer (512x512) then crop on draw.
-        if (videoInts == null) return;
-        videoInts.position(0);
-        videoInts.get(videoArray, 0, MAX_W * MAX_H);
-        bitmap.setPixels(videoArray, 0, MAX_W, 0, 0, MAX_W, MAX_H);
+        // Copy the visible rows of a new frame into the bitmap, then crop on draw. The acquired buffer
+        // is not written by the emulation thread until the next acquire.
+        if (videoInfo[2] != lastVideoSeq) {
+            lastVideoSeq = videoInfo[2];
+            final int rows = Math.min(h, MAX_H);
+            final IntBuffer frame = videoBuffers[idx];
+            frame.position(0);
+            frame.get(videoArray, 0, MAX_W * rows);
+            bitmap.setPixels(videoArray, 0, MAX_W, 0, 0, MAX_W, rows);
+        }
 
         Canvas c = holder.lockCanvas();
         if (c == null) return;
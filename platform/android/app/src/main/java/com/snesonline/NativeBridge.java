@@ -30,6 +30,14 @@ public final class NativeBridge {
     // Pause emulation (loop keeps running to allow netplay state sync).
     public static native void nativeSetPaused(boolean paused);
 
+    // Run-ahead: hide `frames` frames of the game's input lag (0 = off). With secondInstance, a
+    // second core on a worker thread renders them. Call after nativeInitialize, before nativeStartLoop.
+    public static native boolean nativeSetRunAhead(int frames, boolean secondInstance);
+
+    // Profiling: writes the hot-path timings as a Chrome trace JSON to tracePath and a per-phase
+    // p50/p99 summary to tracePath + ".txt". Empty unless the native build enabled the profiler.
+    public static native boolean nativeDumpProfile(String tracePath);
+
     // Save states
     public static native boolean nativeSaveStateToFile(String statePath);
     public static native boolean nativeLoadStateFromFile(String statePath);
@@ -38,14 +46,25 @@ public final class NativeBridge {
     public static native void nativeOnKey(int keyCode, int action);
 
     // Video
-    public static native int nativeGetVideoWidth();
-    public static native int nativeGetVideoHeight();
-    public static native ByteBuffer nativeGetVideoBufferRGBA();
+    // Triple-buffered frames (ARGB ints, rows of 512 pixels). nativeAcquireVideoFrame returns the index
+    // of the buffer holding the newest frame (-1 before the first) and fills {width, height, seq};
+    // that buffer is not written until the next acquire. Map the buffers once.
+    public static native ByteBuffer[] nativeGetVideoBuffersRGBA();
+    public static native int nativeAcquireVideoFrame(int[] outWidthHeightSeq);
 
     // Netplay status
     // 0=off, 1=connecting (no peer yet), 2=waiting (peer but missing inputs), 3=ok, 4=syncing state
     public static native int nativeGetNetplayStatus();
 
+    // Stall counters since start: {stalls, total stalled microseconds, longest stall microseconds}.
+    // A stall is a due frame waiting for the peer's input, from the first failed attempt until it runs.
+    public static native long[] nativeGetNetplayStallStats();
+
+    // Spectators: Player 1 serves read-only viewers on this UDP port (0 = off). Call before
+    // nativeInitialize; the host starts with the netplay session.
+    public static native void nativeSetSpectatorPort(int port);
+    public static native int nativeGetSpectatorCount();
+
     // Networking helpers
     // Returns the best-effort public mapped UDP port for a socket bound to localPort (0 on failure).
     public static native int nativeStunPublicUdpPort(int localPort);
@@ -57,4 +76,9 @@ public final class NativeBridge {
     // Returns frames written into dst (dst length must be framesWanted*2)
     public static native int nativeGetAudioSampleRateHz();
     public static native int nativePopAudio(short[] dstInterleavedStereo, int framesWanted);
+    // AudioTrack's rate; native code resamples the core's audio to it.
+    public static native void nativeSetAudioOutputSampleRateHz(int hz);
+    // Audio ring counters since start: {dropped frames, frames asked for but missing, frames played,
+    // histogram bucket size in frames, then 16 buckets counting the ring's fill at each nativePopAudio}.
+    public static native long[] nativeGetAudioStats();
 }
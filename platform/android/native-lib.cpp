@@ -12,14 +12,27 @@
 #include <vector>
 #include <cstdio>
 
+#include "snesonline/AudioResampler.h"
+#include "snesonline/AudioRing.h"
+#include "snesonline/BulkTransfer.h"
 #include "snesonline/EmulatorEngine.h"
+#include "snesonline/FrameExchange.h"
+#include "snesonline/FrameScheduler.h"
+#include "snesonline/Hash.h"
 #include "snesonline/InputBits.h"
 #include "snesonline/InputMapping.h"
+#include "snesonline/InputPacket.h"
+#include "snesonline/Lz.h"
+#include "snesonline/PixelConvert.h"
+#include "snesonline/Profiler.h"
+#include "snesonline/SpectatorHost.h"
+#include "snesonline/StateDelta.h"
 #include "snesonline/StunClient.h"
 
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <poll.h>
 #include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -50,19 +63,6 @@ static inline void write_u16_be_(uint8_t* p, uint16_t v) noexcept {
     std::memcpy(p, &be, sizeof(be));
 }
 
-static uint32_t crc32_(const void* data, std::size_t sizeBytes) noexcept {
-    uint32_t crc = 0xFFFFFFFFu;
-    const auto* p = static_cast<const uint8_t*>(data);
-    for (std::size_t i = 0; i < sizeBytes; ++i) {
-        crc ^= p[i];
-        for (int k = 0; k < 8; ++k) {
-            const uint32_t mask = -(crc & 1u);
-            crc = (crc >> 1) ^ (0xEDB88320u & mask);
-        }
-    }
-    return ~crc;
-}
-
 static bool readFile_(const char* path, std::vector<uint8_t>& out) noexcept {
     out.clear();
     if (!path || !path[0]) return false;
@@ -114,10 +114,23 @@ static bool loadStateBytes_(const uint8_t* data, std::size_t sizeBytes) noexcept
     if (!st.buffer.allocate(sizeBytes)) return false;
     std::memcpy(st.buffer.data(), data, sizeBytes);
     st.sizeBytes = sizeBytes;
-    st.checksum = crc32_(data, sizeBytes);
+    st.checksum = snesonline::crc32(data, sizeBytes);
     return snesonline::EmulatorEngine::instance().loadState(st);
 }
 
+static bool saveStateBytes_(std::vector<uint8_t>& out) noexcept {
+    snesonline::SaveState st;
+    if (!snesonline::EmulatorEngine::instance().saveState(st)) return false;
+    if (st.sizeBytes == 0 || !st.buffer.data()) return false;
+    try {
+        out.resize(st.sizeBytes);
+    } catch (...) {
+        return false;
+    }
+    std::memcpy(out.data(), st.buffer.data(), st.sizeBytes);
+    return true;
+}
+
 static bool ensureDir_(const std::string& dir) noexcept {
     if (dir.empty()) return false;
     if (::mkdir(dir.c_str(), 0755) == 0) return true;
@@ -211,7 +224,11 @@ static void maybeFlushSaveRam_(bool force) noexcept {
         g_saveRamLastCheck = now;
     }
 
-    const uint32_t crc = crc32_(mem, memSize);
+    uint32_t crc = 0;
+    {
+        SNESONLINE_PROFILE_SCOPE("android.saveRamCrc");
+        crc = snesonline::crc32(mem, memSize);
+    }
     if (!force && crc == g_saveRamLastCrc) return;
     if (!force && g_saveRamLastFlush.time_since_epoch().count() != 0 && (now - g_saveRamLastFlush) < std::chrono::milliseconds(1000)) return;
 
@@ -269,6 +286,8 @@ struct UdpNetplay {
     std::chrono::steady_clock::time_point lastRecv{};
     std::chrono::steady_clock::time_point lastKeepAliveSent{};
 
+    snesonline::InputPacketNegotiator inputNegotiator;
+
     struct Packet {
         uint32_t magic_be;
         uint32_t frame_be;
@@ -277,6 +296,10 @@ struct UdpNetplay {
     };
 
     static constexpr uint32_t kMagicInput = 0x534E4F49u;     // 'SNOI'
+    // v2 input: u32 magic, u16 token, then the RLE input window from snesonline/InputPacket.h.
+    // Negotiated per peer (snesonline::InputPacketNegotiator); older builds only understand 'SNOI'.
+    static constexpr uint32_t kMagicInputWindow = 0x534E4F4Au; // 'SNOJ'
+    static constexpr int kInputWindowHeaderBytes = 6;
     static constexpr uint32_t kMagicHash = 0x534E4F48u;      // 'SNOH'
     static constexpr uint32_t kMagicKeepAlive = 0x534E4F4Bu; // 'SNOK'
     static constexpr uint32_t kMagicResyncReq = 0x534E4F51u; // 'SNOQ'
@@ -330,13 +353,46 @@ struct UdpNetplay {
     std::vector<uint8_t> saveRamRxHave;
     uint16_t saveRamRxHaveCount = 0;
 
+    // State and SRAM also go through snesonline::BulkSender/BulkReceiver (selective acks, congestion
+    // window, large datagrams). The host sets kOfferFlagBulk in its 'SNOS'/'SNOR' offer and keeps
+    // cycling legacy chunks until the joiner's first bulk ack, so older joiners still get the data.
+    // The legacy 'SNOA'/'SNOE' ack still means "loaded/applied" either way.
+    static constexpr uint8_t kBulkChannelState = 1;
+    static constexpr uint8_t kBulkChannelSaveRam = 2;
+    static constexpr uint16_t kOfferFlagBulk = 1u << 1;
+    snesonline::BulkSender stateBulkTx;
+    snesonline::BulkReceiver stateBulkRx;
+    snesonline::BulkSender saveRamBulkTx;
+    snesonline::BulkReceiver saveRamBulkRx;
+
+    // The bulk blob is LZ-compressed (snesonline/Lz.h) when that makes it smaller. The host then sets
+    // kOfferFlagLz and appends u32 packedBytes, u32 packedCrc (26-byte offer); the joiner expects
+    // that blob, decompresses it and checks the result against the offer's raw CRC.
+    // Legacy chunks always carry the raw bytes.
+    static constexpr uint16_t kOfferFlagLz = 1u << 2;
+    uint32_t statePackedSize = 0; // joiner: 0 => the bulk blob is raw
+    uint32_t statePackedCrc = 0;
+    uint32_t saveRamPackedSize = 0;
+    uint32_t saveRamPackedCrc = 0;
+
+    // Desync resyncs also offer a block-hash delta (snesonline/StateDelta.h): the host sets
+    // kOfferFlagDelta and sends a 'SNOT' tree offer after each 'SNOS'. A joiner that understands it
+    // patches its own state with the blocks that differ instead of expecting the whole bulk transfer;
+    // the legacy 'SNOA' ack still ends the sync.
+    static constexpr uint8_t kBulkChannelDelta = 3;
+    static constexpr uint16_t kOfferFlagDelta = 1u << 3;
+    snesonline::DeltaSyncHost stateDeltaTx;
+    snesonline::DeltaSyncJoiner stateDeltaRx;
+
     void configureStateSyncHost(std::vector<uint8_t>&& bytes) noexcept {
         stateTx = std::move(bytes);
         stateSize = static_cast<uint32_t>(stateTx.size());
-        stateCrc = stateSize ? crc32_(stateTx.data(), stateTx.size()) : 0;
+        stateCrc = stateSize ? snesonline::crc32(stateTx.data(), stateTx.size()) : 0;
         stateChunkSize = 1024;
         stateChunkCount = static_cast<uint16_t>((stateSize + stateChunkSize - 1u) / stateChunkSize);
         wantStateSync = (stateSize > 0);
+        beginBulk_(stateBulkTx, kBulkChannelState, stateTx);
+        stateDeltaTx.cancel();
         isHost = true;
         peerStateReady = !wantStateSync;
         selfStateReady = true;
@@ -356,6 +412,10 @@ struct UdpNetplay {
         stateRx.clear();
         stateRxHave.clear();
         stateRxHaveCount = 0;
+        stateBulkRx.reset();
+        stateDeltaRx.reset();
+        statePackedSize = 0;
+        statePackedCrc = 0;
         stateSize = 0;
         stateCrc = 0;
         stateChunkSize = 1024;
@@ -365,18 +425,19 @@ struct UdpNetplay {
     bool queueSaveRamSync(std::vector<uint8_t>&& bytes, bool gateUntilAck) noexcept {
         if (bytes.empty()) return false;
         // Avoid restarting the same transfer.
-        const uint32_t crc = crc32_(bytes.data(), bytes.size());
+        const uint32_t crc = snesonline::crc32(bytes.data(), bytes.size());
         if (wantSaveRamSync && crc == saveRamCrc && static_cast<uint32_t>(bytes.size()) == saveRamSize) {
             return true;
         }
 
         saveRamTx = std::move(bytes);
         saveRamSize = static_cast<uint32_t>(saveRamTx.size());
-        saveRamCrc = saveRamSize ? crc32_(saveRamTx.data(), saveRamTx.size()) : 0;
+        saveRamCrc = saveRamSize ? snesonline::crc32(saveRamTx.data(), saveRamTx.size()) : 0;
         saveRamChunkSize = 1024;
         saveRamChunkCount = static_cast<uint16_t>((saveRamSize + saveRamChunkSize - 1u) / saveRamChunkSize);
 
         wantSaveRamSync = (saveRamSize > 0);
+        beginBulk_(saveRamBulkTx, kBulkChannelSaveRam, saveRamTx);
         saveRamGate = gateUntilAck;
         peerSaveRamReady = !saveRamGate;
         nextSaveRamChunkToSend = 0;
@@ -394,6 +455,9 @@ struct UdpNetplay {
         saveRamRx.clear();
         saveRamRxHave.clear();
         saveRamRxHaveCount = 0;
+        saveRamBulkRx.reset();
+        saveRamPackedSize = 0;
+        saveRamPackedCrc = 0;
         saveRamSize = 0;
         saveRamCrc = 0;
         saveRamChunkSize = 1024;
@@ -669,6 +733,13 @@ struct UdpNetplay {
         joinAwaitingSaveRamOffer = false;
         joinWaitSaveRamOfferDeadline = {};
 
+        stateBulkTx.cancel();
+        stateBulkRx.reset();
+        stateDeltaTx.cancel();
+        stateDeltaRx.reset();
+        saveRamBulkTx.cancel();
+        saveRamBulkRx.reset();
+
         remoteFrameTag.fill(0xFFFFFFFFu);
         remoteMask.fill(0);
         sentFrameTag.fill(0xFFFFFFFFu);
@@ -688,6 +759,7 @@ struct UdpNetplay {
 
         hasPeer = false;
         lastRecv = {};
+        inputNegotiator.reset(true);
 
         pendingResyncHost = false;
         lastResyncRequestSent = {};
@@ -696,7 +768,7 @@ struct UdpNetplay {
         discoverPeer = false;
 
         requireSecret = (sharedSecret && sharedSecret[0]);
-        secret32 = requireSecret ? crc32_(sharedSecret, std::strlen(sharedSecret)) : 0u;
+        secret32 = requireSecret ? snesonline::crc32(sharedSecret, std::strlen(sharedSecret)) : 0u;
         uint32_t mix = secret32 ^ (secret32 >> 16);
         secret16 = static_cast<uint16_t>(mix & 0xFFFFu);
         if (requireSecret && secret16 == 0) secret16 = 1;
@@ -769,6 +841,7 @@ struct UdpNetplay {
     }
 
     void pumpRecv() noexcept {
+        SNESONLINE_PROFILE_SCOPE("android.netplay.pumpRecv");
         if (sock < 0) return;
         while (true) {
             uint8_t buf[1500] = {};
@@ -784,11 +857,10 @@ struct UdpNetplay {
 
             // Host auto-discovery: only accept the first peer if it presents the correct secret token.
             if (discoverPeer && !hasPeer) {
-                if (magic != kMagicInput) continue;
-                if (n != static_cast<int>(sizeof(Packet))) continue;
-                if (requireSecret) {
-                    const uint16_t tok = read_u16_be_(buf + 10);
-                    if (tok != secret16) continue;
+                if (magic == kMagicInput) {
+                    if (n != static_cast<int>(sizeof(Packet))) continue;
+                } else if (magic != kMagicInputWindow || n <= kInputWindowHeaderBytes) {
+                    continue;
                 }
             }
 
@@ -797,6 +869,11 @@ struct UdpNetplay {
                 const uint16_t tok = read_u16_be_(buf + 10);
                 if (tok != secret16) continue;
             }
+            if (magic == kMagicInputWindow && requireSecret) {
+                if (n <= kInputWindowHeaderBytes) continue;
+                const uint16_t tok = read_u16_be_(buf + 4);
+                if (tok != secret16) continue;
+            }
 
             // Validate token on keepalives.
             if (magic == kMagicKeepAlive && requireSecret) {
@@ -826,6 +903,29 @@ struct UdpNetplay {
             hasPeer = true;
             lastRecv = std::chrono::steady_clock::now();
 
+            uint8_t bulkChannel = 0;
+            const snesonline::BulkDatagramKind bulk = snesonline::peekBulkDatagram(buf, static_cast<std::size_t>(n), bulkChannel);
+            if (bulk == snesonline::BulkDatagramKind::Ack) {
+                if (!isHost) continue;
+                if (bulkChannel == kBulkChannelState) stateBulkTx.onDatagram(buf, static_cast<std::size_t>(n), lastRecv);
+                if (bulkChannel == kBulkChannelSaveRam) saveRamBulkTx.onDatagram(buf, static_cast<std::size_t>(n), lastRecv);
+                if (bulkChannel == kBulkChannelDelta) stateDeltaTx.onDatagram(buf, static_cast<std::size_t>(n), lastRecv);
+                continue;
+            }
+            if (bulk == snesonline::BulkDatagramKind::Data) {
+                if (isHost) continue;
+                if (bulkChannel == kBulkChannelState && stateBulkRx.onDatagram(buf, static_cast<std::size_t>(n), lastRecv)) {
+                    const uint8_t* data = bulkPayload_(stateBulkRx, stateSize, stateCrc, statePackedSize, statePackedCrc, stateRx);
+                    if (wantStateSync && !selfStateReady && data) onStateReceived_(data, stateSize);
+                }
+                if (bulkChannel == kBulkChannelSaveRam && saveRamBulkRx.onDatagram(buf, static_cast<std::size_t>(n), lastRecv)) {
+                    const uint8_t* data = bulkPayload_(saveRamBulkRx, saveRamSize, saveRamCrc, saveRamPackedSize, saveRamPackedCrc, saveRamRx);
+                    if (wantSaveRamSync && data) onSaveRamReceived_(data, saveRamSize);
+                }
+                if (bulkChannel == kBulkChannelDelta && stateDeltaRx.onDatagram(buf, static_cast<std::size_t>(n), lastRecv)) onStateDeltaComplete_();
+                continue;
+            }
+
             if (magic == kMagicKeepAlive) {
                 // Keepalive: refresh peer/lastRecv only.
                 continue;
@@ -838,6 +938,22 @@ struct UdpNetplay {
                 const uint32_t idx = f % kBufN;
                 remoteFrameTag[idx] = f;
                 remoteMask[idx] = m;
+                inputNegotiator.onV1Received();
+                continue;
+            }
+
+            if (magic == kMagicInputWindow) {
+                uint32_t newest = 0;
+                uint32_t count = 0;
+                uint16_t masks[snesonline::kMaxInputWindow];
+                if (!snesonline::decodeInputWindow(buf + kInputWindowHeaderBytes, static_cast<std::size_t>(n - kInputWindowHeaderBytes), newest, masks, count)) continue;
+                for (uint32_t i = 0; i < count; ++i) {
+                    const uint32_t f = newest - count + 1 + i;
+                    const uint32_t idx = f % kBufN;
+                    remoteFrameTag[idx] = f;
+                    remoteMask[idx] = masks[i];
+                }
+                inputNegotiator.onV2Received();
                 continue;
             }
 
@@ -903,6 +1019,44 @@ struct UdpNetplay {
                         selfStateReady = true;
                     }
                 }
+                // 18/26 bytes: bulk-capable host (a 20-byte offer is an old iOS host with a frame number there).
+                const uint16_t flags = (n == 18 || n == 26) ? read_u16_be_(buf + 16) : 0u;
+                const bool packed = (flags & kOfferFlagLz) && n == 26;
+                if ((flags & kOfferFlagBulk) && wantStateSync && sz == stateSize && crc == stateCrc) {
+                    statePackedSize = packed ? read_u32_be_(buf + 18) : 0u;
+                    statePackedCrc = packed ? read_u32_be_(buf + 22) : 0u;
+                    // A bulk host stops sending once its data is acked; if our "loaded" ack got lost,
+                    // the repeated offer is the only sign of it.
+                    if (selfStateReady) sendSyncAck_(kMagicStateAck, sz, crc);
+                    else if (!(flags & kOfferFlagDelta)) (void)stateBulkRx.expect(kBulkChannelState, packed ? statePackedSize : sz, packed ? statePackedCrc : crc);
+                }
+                continue;
+            }
+
+            if (magic == snesonline::kDeltaOfferMagic) {
+                if (isHost || !wantStateSync || selfStateReady) continue;
+                if (n < static_cast<int>(snesonline::kDeltaOfferBytes)) continue;
+                if (read_u32_be_(buf + 4) != stateSize || read_u32_be_(buf + 8) != stateCrc) continue;
+                if (stateDeltaRx.isCurrentOffer(buf, static_cast<std::size_t>(n))) continue;
+                // Patch what we have (we stopped at the offer, so it holds still). Without a state of
+                // our own, every block is fetched.
+                std::vector<uint8_t> base;
+                (void)saveStateBytes_(base);
+                if (stateDeltaRx.begin(kBulkChannelDelta, buf, static_cast<std::size_t>(n), base.data(), base.size()) && stateDeltaRx.complete()) {
+                    onStateDeltaComplete_();
+                }
+                continue;
+            }
+
+            if (magic == snesonline::kDeltaNodeHashesMagic) {
+                if (isHost) continue;
+                (void)stateDeltaRx.onDatagram(buf, static_cast<std::size_t>(n), lastRecv);
+                continue;
+            }
+
+            if (magic == snesonline::kDeltaNodeRequestMagic || magic == snesonline::kDeltaBlockRequestMagic) {
+                if (!isHost) continue;
+                stateDeltaTx.onDatagram(buf, static_cast<std::size_t>(n), lastRecv);
                 continue;
             }
 
@@ -930,17 +1084,8 @@ struct UdpNetplay {
                 std::memcpy(stateRx.data() + off, buf + 12, copyN);
 
                 if (stateRxHaveCount == stateChunkCount) {
-                    const uint32_t got = crc32_(stateRx.data(), stateRx.size());
-                    if (got == stateCrc) {
-                        if (loadStateBytes_(stateRx.data(), stateRx.size())) {
-                            selfStateReady = true;
-                            uint8_t ack[12] = {};
-                            write_u32_be_(ack, kMagicStateAck);
-                            write_u32_be_(ack + 4, stateSize);
-                            write_u32_be_(ack + 8, stateCrc);
-                            sendto(sock, ack, sizeof(ack), 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
-                        }
-                    }
+                    const uint32_t got = snesonline::crc32(stateRx.data(), stateRx.size());
+                    if (got == stateCrc) onStateReceived_(stateRx.data(), stateRx.size());
                 }
                 continue;
             }
@@ -968,6 +1113,15 @@ struct UdpNetplay {
                 uint16_t flags = 0;
                 if (n >= 18) flags = read_u16_be_(buf + 16);
                 const bool gate = (flags & 1u) != 0;
+                const bool packed = (flags & kOfferFlagLz) && n >= 26;
+                const uint32_t bulkSz = packed ? read_u32_be_(buf + 18) : sz;
+                const uint32_t bulkCrc = packed ? read_u32_be_(buf + 22) : crc;
+
+                if ((flags & kOfferFlagBulk) && saveRamBulkRx.complete() && saveRamBulkRx.totalBytes() == bulkSz && saveRamBulkRx.crc() == bulkCrc) {
+                    // Already applied; our ack got lost (see the state offer above).
+                    sendSyncAck_(kMagicSaveRamAck, sz, crc);
+                    continue;
+                }
 
                 // Start (or restart) a save-ram transfer.
                 wantSaveRamSync = true;
@@ -986,6 +1140,9 @@ struct UdpNetplay {
                     saveRamGate = false;
                     selfSaveRamReady = true;
                 }
+                saveRamPackedSize = packed ? bulkSz : 0u;
+                saveRamPackedCrc = packed ? bulkCrc : 0u;
+                if ((flags & kOfferFlagBulk) && wantSaveRamSync) (void)saveRamBulkRx.expect(kBulkChannelSaveRam, bulkSz, bulkCrc);
                 continue;
             }
 
@@ -1013,29 +1170,8 @@ struct UdpNetplay {
                 std::memcpy(saveRamRx.data() + off, buf + 12, copyN);
 
                 if (saveRamRxHaveCount == saveRamChunkCount) {
-                    const uint32_t got = crc32_(saveRamRx.data(), saveRamRx.size());
-                    if (got == saveRamCrc) {
-                        // Apply to core memory and persist.
-                        (void)applySaveRamBytes_(saveRamRx.data(), saveRamRx.size());
-                        if (!g_saveRamPath.empty()) {
-                            (void)writeFile_(g_saveRamPath.c_str(), saveRamRx.data(), saveRamRx.size());
-                            g_saveRamLastCrc = saveRamCrc;
-                        }
-
-                        uint8_t ack[12] = {};
-                        write_u32_be_(ack, kMagicSaveRamAck);
-                        write_u32_be_(ack + 4, saveRamSize);
-                        write_u32_be_(ack + 8, saveRamCrc);
-                        sendto(sock, ack, sizeof(ack), 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
-
-                        if (saveRamGate) {
-                            selfSaveRamReady = true;
-                            saveRamGate = false;
-                        }
-
-                        // Keep wantSaveRamSync=true so we can accept future updates; reset receive state.
-                        saveRamRxHaveCount = 0;
-                    }
+                    const uint32_t got = snesonline::crc32(saveRamRx.data(), saveRamRx.size());
+                    if (got == saveRamCrc) onSaveRamReceived_(saveRamRx.data(), saveRamRx.size());
                 }
                 continue;
             }
@@ -1056,7 +1192,109 @@ struct UdpNetplay {
         }
     }
 
+    void sendSyncAck_(uint32_t magic, uint32_t size, uint32_t crc) noexcept {
+        uint8_t ack[12] = {};
+        write_u32_be_(ack, magic);
+        write_u32_be_(ack + 4, size);
+        write_u32_be_(ack + 8, crc);
+        sendto(sock, ack, sizeof(ack), 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
+    }
+
+    // Joiner: a complete, CRC-checked state arrived (legacy chunks or bulk).
+    void onStateReceived_(const uint8_t* data, std::size_t size) noexcept {
+        if (!loadStateBytes_(data, size)) return;
+        selfStateReady = true;
+        sendSyncAck_(kMagicStateAck, stateSize, stateCrc);
+    }
+
+    // Joiner: the delta resync rebuilt the offered state.
+    void onStateDeltaComplete_() noexcept {
+        if (!wantStateSync || selfStateReady) return;
+        if (stateDeltaRx.stateBytes() != stateSize || stateDeltaRx.stateCrc() != stateCrc) return;
+        onStateReceived_(stateDeltaRx.state().data(), stateDeltaRx.state().size());
+    }
+
+    // Joiner: a complete, CRC-checked SRAM image arrived (legacy chunks or bulk).
+    void onSaveRamReceived_(const uint8_t* data, std::size_t size) noexcept {
+        // Apply to core memory and persist.
+        (void)applySaveRamBytes_(data, size);
+        if (!g_saveRamPath.empty()) {
+            (void)writeFile_(g_saveRamPath.c_str(), data, size);
+            g_saveRamLastCrc = saveRamCrc;
+        }
+
+        sendSyncAck_(kMagicSaveRamAck, saveRamSize, saveRamCrc);
+
+        if (saveRamGate) {
+            selfSaveRamReady = true;
+            saveRamGate = false;
+        }
+
+        // Keep wantSaveRamSync=true so we can accept future updates; reset receive state.
+        saveRamRxHaveCount = 0;
+    }
+
+    // Host: starts the bulk side of a state/SRAM transfer, LZ-compressed when that makes it smaller.
+    static void beginBulk_(snesonline::BulkSender& tx, uint8_t channel, const std::vector<uint8_t>& raw) noexcept {
+        std::vector<uint8_t> packed;
+        std::size_t packedBytes = 0;
+        try {
+            packed.resize(snesonline::lzMaxCompressedSize(raw.size()));
+            packedBytes = snesonline::lzCompress(raw.data(), raw.size(), packed.data(), packed.size());
+        } catch (...) {
+            packedBytes = 0;
+        }
+        const bool lz = packedBytes != 0 && packedBytes < raw.size();
+        if (!tx.begin(channel, lz ? packed.data() : raw.data(), lz ? packedBytes : raw.size(), true)) tx.cancel();
+    }
+
+    // Host: offer tail after the 16-byte 'SNOS'/'SNOR' header. Returns the offer length (18 or 26).
+    static std::size_t writeOfferTail_(uint8_t* info, uint16_t flags, const snesonline::BulkSender& tx, uint32_t rawSize) noexcept {
+        if (tx.active()) flags |= kOfferFlagBulk;
+        if (!tx.active() || tx.totalBytes() == rawSize) {
+            write_u16_be_(info + 16, flags);
+            return 18;
+        }
+        write_u16_be_(info + 16, static_cast<uint16_t>(flags | kOfferFlagLz));
+        write_u32_be_(info + 18, tx.totalBytes());
+        write_u32_be_(info + 22, tx.crc());
+        return 26;
+    }
+
+    // Joiner: the raw bytes of a finished bulk transfer, or nullptr if it is not the one offered. A
+    // compressed blob is decoded into `scratch` (sized by the offer) and checked against the raw CRC.
+    static const uint8_t* bulkPayload_(const snesonline::BulkReceiver& rx, uint32_t size, uint32_t crc, uint32_t packedSize, uint32_t packedCrc,
+                                       std::vector<uint8_t>& scratch) noexcept {
+        if (packedSize == 0) return (rx.totalBytes() == size && rx.crc() == crc) ? rx.data().data() : nullptr;
+        if (rx.totalBytes() != packedSize || rx.crc() != packedCrc || scratch.size() != size) return nullptr;
+        if (snesonline::lzDecompress(rx.data().data(), rx.data().size(), scratch.data(), scratch.size()) != size) return nullptr;
+        return (snesonline::crc32(scratch.data(), size) == crc) ? scratch.data() : nullptr;
+    }
+
+    void pumpBulkSend_(snesonline::BulkSender& tx) noexcept {
+        snesonline::BulkDatagram out[snesonline::kBulkMaxBatch];
+        const std::size_t count = tx.poll(std::chrono::steady_clock::now(), out, snesonline::kBulkMaxBatch);
+        (void)snesonline::sendBulkDatagrams(sock, out, count, &remote, sizeof(remote));
+    }
+
+    // Host: tree replies and the patch; joiner: requests and patch acks.
+    void pumpDelta_() noexcept {
+        if (remote.sin6_family != AF_INET6 || remote.sin6_port == 0) return;
+        snesonline::BulkDatagram out[snesonline::kBulkMaxBatch];
+        const auto now = std::chrono::steady_clock::now();
+        const std::size_t count = isHost ? stateDeltaTx.poll(now, out, snesonline::kBulkMaxBatch) : stateDeltaRx.poll(now, out, snesonline::kBulkMaxBatch);
+        (void)snesonline::sendBulkDatagrams(sock, out, count, &remote, sizeof(remote));
+    }
+
+    void pumpBulkAck_(snesonline::BulkReceiver& rx) noexcept {
+        if (remote.sin6_family != AF_INET6 || remote.sin6_port == 0) return;
+        uint8_t ack[snesonline::kBulkMaxAckBytes];
+        const std::size_t len = rx.pollAck(std::chrono::steady_clock::now(), ack, sizeof(ack));
+        if (len != 0) sendto(sock, ack, len, 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
+    }
+
     void sendKeepAlive() noexcept {
+        SNESONLINE_PROFILE_SCOPE("android.netplay.sendKeepAlive");
         if (sock < 0) return;
         if (!hasPeer) return;
         if (remote.sin6_family != AF_INET6 || remote.sin6_port == 0) return;
@@ -1080,11 +1318,12 @@ struct UdpNetplay {
         void* mem = core.memoryData(kRetroMemorySystemRam_);
         const std::size_t memSize = core.memorySize(kRetroMemorySystemRam_);
         if (!mem || memSize == 0) return false;
-        outHash = crc32_(mem, memSize);
+        outHash = snesonline::crc32(mem, memSize);
         return true;
     }
 
     void recordLocalHashForCompletedFrame_(uint32_t completedFrame) noexcept {
+        SNESONLINE_PROFILE_SCOPE("android.netplay.recordLocalHash");
         uint32_t h = 0;
         if (!computeFastStateHash_(h)) return;
         if (h == 0) return;
@@ -1094,6 +1333,7 @@ struct UdpNetplay {
     }
 
     void maybeSendLocalHashForCompletedFrame_(uint32_t completedFrame) noexcept {
+        SNESONLINE_PROFILE_SCOPE("android.netplay.sendLocalHash");
         if (sock < 0) return;
         if (!hasPeer) return;
         if (discoverPeer && !hasPeer) return;
@@ -1114,6 +1354,7 @@ struct UdpNetplay {
     }
 
     void performResyncHostIfPending_() noexcept {
+        SNESONLINE_PROFILE_SCOPE("android.netplay.resyncHost");
         if (localPlayerNum != 1) return;
         if (!pendingResyncHost) return;
         pendingResyncHost = false;
@@ -1129,28 +1370,24 @@ struct UdpNetplay {
             return;
         }
 
-        snesonline::SaveState st;
-        if (!snesonline::EmulatorEngine::instance().saveState(st)) {
-            return;
-        }
-        if (st.sizeBytes == 0 || !st.buffer.data()) {
-            return;
-        }
-
         std::vector<uint8_t> bytes;
-        try {
-            bytes.resize(st.sizeBytes);
-        } catch (...) {
+        if (!saveStateBytes_(bytes)) {
             return;
         }
-        std::memcpy(bytes.data(), st.buffer.data(), st.sizeBytes);
         configureStateSyncHost(std::move(bytes));
+        // The joiner still has a nearly identical state: let it fetch just the blocks that differ.
+        if (!stateDeltaTx.begin(kBulkChannelDelta, stateTx.data(), stateTx.size())) stateDeltaTx.cancel();
         lastResyncTriggered = now;
     }
 
     void pumpSaveRamSyncSend() noexcept {
+        SNESONLINE_PROFILE_SCOPE("android.netplay.saveRamSyncSend");
         if (sock < 0) return;
-        if (!isHost || !wantSaveRamSync) return;
+        if (!isHost) {
+            pumpBulkAck_(saveRamBulkRx);
+            return;
+        }
+        if (!wantSaveRamSync) return;
         if (!hasPeer) return;
         if (discoverPeer && !hasPeer) return;
         if (remote.sin6_family != AF_INET6 || remote.sin6_port == 0) return;
@@ -1161,17 +1398,21 @@ struct UdpNetplay {
         const auto now = std::chrono::steady_clock::now();
 
         if (lastSaveRamInfoSent.time_since_epoch().count() == 0 || now - lastSaveRamInfoSent >= std::chrono::milliseconds(250)) {
-            uint8_t info[18] = {};
+            uint8_t info[26] = {};
             write_u32_be_(info, kMagicSaveRamInfo);
             write_u32_be_(info + 4, saveRamSize);
             write_u32_be_(info + 8, saveRamCrc);
             write_u16_be_(info + 12, saveRamChunkSize);
             write_u16_be_(info + 14, saveRamChunkCount);
-            write_u16_be_(info + 16, saveRamGate ? 1u : 0u);
-            sendto(sock, info, sizeof(info), 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
+            const std::size_t len = writeOfferTail_(info, saveRamGate ? 1u : 0u, saveRamBulkTx, saveRamSize);
+            sendto(sock, info, len, 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
             lastSaveRamInfoSent = now;
         }
 
+        // Once the joiner speaks bulk, it gets only that.
+        pumpBulkSend_(saveRamBulkTx);
+        if (saveRamBulkTx.receiverSeen()) return;
+
         const uint16_t burst = 6;
         for (uint16_t k = 0; k < burst; ++k) {
             const uint16_t idx = nextSaveRamChunkToSend;
@@ -1193,8 +1434,14 @@ struct UdpNetplay {
     }
 
     void pumpStateSyncSend() noexcept {
+        SNESONLINE_PROFILE_SCOPE("android.netplay.stateSyncSend");
         if (sock < 0) return;
-        if (!isHost || !wantStateSync) return;
+        if (!isHost) {
+            pumpBulkAck_(stateBulkRx);
+            pumpDelta_();
+            return;
+        }
+        if (!wantStateSync) return;
         if (!hasPeer || peerStateReady) return;
         if (discoverPeer && !hasPeer) return;
         if (remote.sin6_family != AF_INET6 || remote.sin6_port == 0) return;
@@ -1203,16 +1450,26 @@ struct UdpNetplay {
 
         // Periodically send state offer.
         if (lastInfoSent.time_since_epoch().count() == 0 || now - lastInfoSent >= std::chrono::milliseconds(250)) {
-            uint8_t info[16] = {};
+            // Older joiners read the first 16 bytes only.
+            uint8_t info[26] = {};
             write_u32_be_(info, kMagicStateInfo);
             write_u32_be_(info + 4, stateSize);
             write_u32_be_(info + 8, stateCrc);
             write_u16_be_(info + 12, stateChunkSize);
             write_u16_be_(info + 14, stateChunkCount);
-            sendto(sock, info, sizeof(info), 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
+            const std::size_t len = writeOfferTail_(info, stateDeltaTx.active() ? kOfferFlagDelta : 0u, stateBulkTx, stateSize);
+            sendto(sock, info, len, 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
+            uint8_t tree[snesonline::kDeltaOfferBytes];
+            const std::size_t treeLen = stateDeltaTx.writeOffer(tree, sizeof(tree));
+            if (treeLen != 0) sendto(sock, tree, treeLen, 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
             lastInfoSent = now;
         }
 
+        // Once the joiner speaks bulk (or delta), it gets only that.
+        pumpBulkSend_(stateBulkTx);
+        pumpDelta_();
+        if (stateBulkTx.receiverSeen() || stateDeltaTx.receiverSeen()) return;
+
         // Burst a few chunks per call.
         const uint16_t burst = 6;
         for (uint16_t k = 0; k < burst; ++k) {
@@ -1248,6 +1505,7 @@ struct UdpNetplay {
             if (!peerStateReady && stateSyncDeadline.time_since_epoch().count() != 0 && now > stateSyncDeadline) {
                 // Peer never acked (likely couldn't load the state). Fall back to starting from reset.
                 wantStateSync = false;
+                stateDeltaTx.cancel();
                 peerStateReady = true;
                 selfStateReady = true;
                 stateTx.clear();
@@ -1262,6 +1520,7 @@ struct UdpNetplay {
             if (!selfStateReady && stateSyncDeadline.time_since_epoch().count() != 0 && now > stateSyncDeadline) {
                 // State offer received but never successfully loaded. Fall back to starting from reset.
                 wantStateSync = false;
+                stateDeltaRx.reset();
                 selfStateReady = true;
                 peerStateReady = true;
                 stateRx.clear();
@@ -1280,6 +1539,7 @@ struct UdpNetplay {
     }
 
     void sendLocal(uint16_t mask) noexcept {
+        SNESONLINE_PROFILE_SCOPE("android.netplay.sendLocal");
         if (sock < 0) return;
         const uint32_t targetFrame = frame + kInputDelayFrames;
         const uint32_t idx = targetFrame % kBufN;
@@ -1291,6 +1551,21 @@ struct UdpNetplay {
         if (discoverPeer && !hasPeer) return;
         if (remote.sin6_family != AF_INET6 || remote.sin6_port == 0) return;
 
+        if (inputNegotiator.sendV2()) {
+            // Oldest-first contiguous run of scheduled frames ending at targetFrame.
+            uint16_t masks[kResendWindow];
+            uint32_t count = 0;
+            while (count < kResendWindow && count <= targetFrame && sentFrameTag[(targetFrame - count) % kBufN] == targetFrame - count) ++count;
+            for (uint32_t i = 0; i < count; ++i) masks[i] = sentMask[(targetFrame - count + 1 + i) % kBufN];
+
+            uint8_t pkt[kInputWindowHeaderBytes + snesonline::kMaxInputWindowBytes];
+            write_u32_be_(pkt, kMagicInputWindow);
+            write_u16_be_(pkt + 4, requireSecret ? secret16 : 0);
+            const std::size_t len = snesonline::encodeInputWindow(targetFrame, masks, count, pkt + kInputWindowHeaderBytes, sizeof(pkt) - kInputWindowHeaderBytes);
+            if (len != 0) sendto(sock, pkt, kInputWindowHeaderBytes + len, 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
+        }
+        if (!inputNegotiator.sendV1()) return;
+
         const uint32_t start = (targetFrame >= (kResendWindow - 1)) ? (targetFrame - (kResendWindow - 1)) : 0u;
         for (uint32_t f = start; f <= targetFrame; ++f) {
             const uint32_t i = f % kBufN;
@@ -1304,6 +1579,19 @@ struct UdpNetplay {
         }
     }
 
+    // Blocks until a datagram is pending or `deadline` passes. Returns true if readable.
+    bool waitForDatagramUntil(std::chrono::steady_clock::time_point deadline) const noexcept {
+        if (sock < 0) return false;
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) return false;
+        // poll() takes whole milliseconds; round up so we do not spin just short of the deadline.
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now).count();
+        pollfd pfd{};
+        pfd.fd = sock;
+        pfd.events = POLLIN;
+        return ::poll(&pfd, 1, static_cast<int>((us + 999) / 1000)) > 0 && (pfd.revents & POLLIN);
+    }
+
     bool tryGetInputsForCurrentFrame(uint16_t& outLocalMask, uint16_t& outRemoteMask) noexcept {
         const uint32_t need = frame;
         const uint32_t idx = need % kBufN;
@@ -1313,124 +1601,82 @@ struct UdpNetplay {
         outRemoteMask = remoteMask[idx];
         return true;
     }
+
+    // Both inputs for frame `f` are already buffered.
+    bool inputsReadyFor(uint32_t f) const noexcept {
+        const uint32_t idx = f % kBufN;
+        return remoteFrameTag[idx] == f && sentFrameTag[idx] == f;
+    }
 };
 
 std::unique_ptr<UdpNetplay> g_netplay;
 std::atomic<bool> g_netplayEnabled{false};
 
+// Player 1 serves spectators on this UDP port when non-zero (set before nativeInitialize). The host
+// is started in nativeInitialize and then only touched by the loop thread.
+std::atomic<int> g_spectatorPort{0};
+snesonline::SpectatorHost g_spectators;
+// Set when a savestate is loaded mid-game; the loop thread makes spectators re-download the state.
+std::atomic<bool> g_spectatorStateChanged{false};
+
 // 0=off, 1=connecting (no peer), 2=waiting (missing inputs), 3=ok
 // 4=syncing state
 std::atomic<int> g_netplayStatus{0};
 
-// --- Video buffer (RGBA8888) ---
-static constexpr int kMaxW = 512;
-static constexpr int kMaxH = 512;
-alignas(64) static uint32_t g_rgba[kMaxW * kMaxH];
-static std::atomic<int> g_videoW{0};
-static std::atomic<int> g_videoH{0};
-static std::atomic<uint32_t> g_videoSeq{0};
-
-static inline uint32_t toRGBA_fromXRGB8888(uint32_t xrgb) noexcept {
-    // RETRO_PIXEL_FORMAT_XRGB8888 is X,R,G,B byte order.
-    // When read as a uint32 on little-endian CPUs, the bytes land as:
-    //   xrgb = (B<<24) | (G<<16) | (R<<8) | X
-    // Convert to ARGB8888 int (0xAARRGGBB).
-    const uint32_t r = (xrgb >> 8) & 0xFF;
-    const uint32_t g = (xrgb >> 16) & 0xFF;
-    const uint32_t b = (xrgb >> 24) & 0xFF;
-    return 0xFF000000u | (r << 16) | (g << 8) | b;
-}
-
-static inline uint32_t toRGBA_fromRGB565(uint16_t p) noexcept {
-    const uint32_t r = (p >> 11) & 0x1F;
-    const uint32_t g = (p >> 5) & 0x3F;
-    const uint32_t b = (p >> 0) & 0x1F;
-    const uint32_t rr = (r << 3) | (r >> 2);
-    const uint32_t gg = (g << 2) | (g >> 4);
-    const uint32_t bb = (b << 3) | (b >> 2);
-    return 0xFF000000u | (rr << 16) | (gg << 8) | bb;
-}
-
-static inline uint32_t toRGBA_from0RGB1555(uint16_t p) noexcept {
-    const uint32_t r = (p >> 10) & 0x1F;
-    const uint32_t g = (p >> 5) & 0x1F;
-    const uint32_t b = (p >> 0) & 0x1F;
-    const uint32_t rr = (r << 3) | (r >> 2);
-    const uint32_t gg = (g << 3) | (g >> 2);
-    const uint32_t bb = (b << 3) | (b >> 2);
-    return 0xFF000000u | (rr << 16) | (gg << 8) | bb;
-}
+// --- Video frames (ARGB8888 ints, 512-pixel rows) ---
+// Producer: videoSink (emulation thread). Consumer: nativeAcquireVideoFrame (Java render loop), which
+// names one of the nativeGetVideoBuffersRGBA buffers that stays untouched until its next call.
+static snesonline::FrameExchange g_video;
 
 static void videoSink(void* /*ctx*/, const void* data, unsigned width, unsigned height, std::size_t pitchBytes) noexcept {
+    SNESONLINE_PROFILE_SCOPE("android.videoSink");
     if (!data || width == 0 || height == 0) return;
-    if (width > static_cast<unsigned>(kMaxW) || height > static_cast<unsigned>(kMaxH)) return;
+    if (width > snesonline::FrameExchange::kMaxWidth || height > snesonline::FrameExchange::kMaxHeight) return;
 
     const auto fmt = snesonline::EmulatorEngine::instance().core().pixelFormat();
-
-    if (fmt == snesonline::LibretroCore::PixelFormat::XRGB8888) {
-        const auto* src = static_cast<const uint8_t*>(data);
-        for (unsigned y = 0; y < height; ++y) {
-            const uint32_t* row = reinterpret_cast<const uint32_t*>(src + y * pitchBytes);
-            uint32_t* dst = &g_rgba[y * kMaxW];
-            for (unsigned x = 0; x < width; ++x) {
-                dst[x] = toRGBA_fromXRGB8888(row[x]);
-            }
-        }
-    } else if (fmt == snesonline::LibretroCore::PixelFormat::RGB565) {
-        const auto* src = static_cast<const uint8_t*>(data);
-        for (unsigned y = 0; y < height; ++y) {
-            const uint16_t* row = reinterpret_cast<const uint16_t*>(src + y * pitchBytes);
-            uint32_t* dst = &g_rgba[y * kMaxW];
-            for (unsigned x = 0; x < width; ++x) {
-                dst[x] = toRGBA_fromRGB565(row[x]);
-            }
-        }
-    } else {
-        // XRGB1555
-        const auto* src = static_cast<const uint8_t*>(data);
-        for (unsigned y = 0; y < height; ++y) {
-            const uint16_t* row = reinterpret_cast<const uint16_t*>(src + y * pitchBytes);
-            uint32_t* dst = &g_rgba[y * kMaxW];
-            for (unsigned x = 0; x < width; ++x) {
-                dst[x] = toRGBA_from0RGB1555(row[x]);
-            }
-        }
+    if (!snesonline::convertPixels(fmt, snesonline::DstPixelFormat::ARGB8888, data, pitchBytes, g_video.backBuffer(),
+                                   snesonline::FrameExchange::kStrideBytes, width, height)) {
+        return;
     }
-
-    g_videoW.store(static_cast<int>(width), std::memory_order_relaxed);
-    g_videoH.store(static_cast<int>(height), std::memory_order_relaxed);
-    g_videoSeq.fetch_add(1, std::memory_order_relaxed);
+    g_video.publish(width, height);
 }
 
 // --- Audio ring buffer (stereo S16) ---
-static constexpr uint32_t kAudioCapacityFrames = 48000; // ~1s @48k
-// Keep buffered audio bounded to avoid perceived "audio lag".
-// If we get ahead (e.g., emulator catch-up frames), drop oldest samples.
-// Drop gradually to avoid audible "rubber-band" jumps.
-// Default: no latency clamp (prioritize stable audio over minimum latency).
-// The ring buffer itself is ~1s, so this still won't grow unbounded.
-static std::atomic<uint32_t> g_audioMaxBufferedFrames{0};
-static std::atomic<uint32_t> g_audioMaxDropPerCallFrames{0};
-alignas(64) static int16_t g_audio[kAudioCapacityFrames * 2];
-static std::atomic<uint32_t> g_audioW{0};
-static std::atomic<uint32_t> g_audioR{0};
-static std::atomic<uint64_t> g_audioDroppedTotalFrames{0};
-static std::atomic<uint64_t> g_audioUnderflowTotalFrames{0};
-
-// Loop timing stats (diagnostics)
-static std::atomic<uint64_t> g_loopFramesTotal{0};
-static std::atomic<uint64_t> g_loopCatchupEventsTotal{0};
-static std::atomic<uint64_t> g_loopCatchupFramesTotal{0};
+// Producer: audioSink (emulation thread). Consumer: nativePopAudio (Java audio thread).
+// Keep buffered audio bounded to avoid perceived "audio lag": above the cap the consumer drops the
+// oldest samples, gradually to avoid audible "rubber-band" jumps (AudioRing::setMaxBufferedFrames).
+static constexpr uint32_t kAudioCapacityFrames = snesonline::AudioRing::kCapacityFrames;
+static snesonline::AudioRing g_audio;
+
+// The ring holds audio at AudioTrack's rate (nativeSetAudioOutputSampleRateHz; 0 until Java sets
+// it, meaning the core's rate). The resampler runs on the emulation thread and steers the ring's
+// fill towards g_audioTargetFrames, so the drop clamp below is only a safety net.
+static constexpr uint32_t kAudioChunkFrames = 1024;
+static std::atomic<uint32_t> g_audioOutputRateHz{0};
+static std::atomic<uint32_t> g_audioTargetFrames{0};
+static snesonline::AudioResampler g_resampler;
+static std::vector<int16_t> g_resampled;
+
+// Frame pacing at the core's rate; its stats() are the loop timing diagnostics.
+static snesonline::FrameScheduler g_pacer;
+
+// Netplay stalls: a due frame waiting for remote input, from the first failed attempt until it runs.
+static std::atomic<uint64_t> g_netplayStallEventsTotal{0};
+static std::atomic<uint64_t> g_netplayStallMicrosTotal{0};
+static std::atomic<uint64_t> g_netplayStallMicrosMax{0};
 
 static void configureAudioLatencyCaps(double sampleRateHz) noexcept {
     int sr = static_cast<int>(sampleRateHz + 0.5);
     if (sr < 8000 || sr > 192000) sr = 48000;
 
-    // Target ~50ms of buffered audio max, with a small per-callback drop cap.
-    // This keeps latency tight while avoiding large discontinuities.
-    const int targetMs = 50;
-    uint32_t maxBuf = static_cast<uint32_t>((static_cast<uint64_t>(sr) * targetMs) / 1000);
-    if (maxBuf < 1024) maxBuf = 1024;
+    // Rate control keeps ~40ms buffered; drops (capped per callback to avoid large
+    // discontinuities) only start past ~100ms, e.g. after catch-up frames.
+    const int targetMs = 40;
+    const int maxMs = 100;
+    uint32_t target = static_cast<uint32_t>((static_cast<uint64_t>(sr) * targetMs) / 1000);
+    if (target < 1024) target = 1024;
+    uint32_t maxBuf = static_cast<uint32_t>((static_cast<uint64_t>(sr) * maxMs) / 1000);
+    if (maxBuf < target * 2) maxBuf = target * 2;
     if (maxBuf > (kAudioCapacityFrames / 2)) maxBuf = (kAudioCapacityFrames / 2);
 
     // Cap drops to ~5ms of audio per callback.
@@ -1438,13 +1684,21 @@ static void configureAudioLatencyCaps(double sampleRateHz) noexcept {
     if (maxDrop < 128) maxDrop = 128;
     if (maxDrop > 1024) maxDrop = 1024;
 
-    g_audioMaxBufferedFrames.store(maxBuf, std::memory_order_relaxed);
-    g_audioMaxDropPerCallFrames.store(maxDrop, std::memory_order_relaxed);
+    g_audioTargetFrames.store(target, std::memory_order_relaxed);
+    g_audio.setMaxBufferedFrames(maxBuf, maxDrop);
+    // ~5ms histogram buckets.
+    g_audio.setHistogramBucketFrames(static_cast<uint32_t>(sr / 200));
+}
+
+// Sample rate of the audio in the ring.
+static double audioRingRateHz_() noexcept {
+    const uint32_t out = g_audioOutputRateHz.load(std::memory_order_relaxed);
+    return out ? static_cast<double>(out) : snesonline::EmulatorEngine::instance().core().sampleRateHz();
 }
 
 static void setAudioLatencyCapsMs(int maxBufferedMs, int maxDropMs) noexcept {
-    // Convert ms -> frames using the core's current sample rate.
-    const double hz = snesonline::EmulatorEngine::instance().core().sampleRateHz();
+    // Convert ms -> frames at the ring's sample rate.
+    const double hz = audioRingRateHz_();
     int sr = static_cast<int>(hz + 0.5);
     if (sr < 8000 || sr > 192000) sr = 48000;
 
@@ -1462,58 +1716,41 @@ static void setAudioLatencyCapsMs(int maxBufferedMs, int maxDropMs) noexcept {
         if (maxDropFrames > 4096) maxDropFrames = 4096;
     }
 
-    g_audioMaxBufferedFrames.store(maxBufFrames, std::memory_order_relaxed);
-    g_audioMaxDropPerCallFrames.store(maxDropFrames, std::memory_order_relaxed);
+    g_audio.setMaxBufferedFrames(maxBufFrames, maxDropFrames);
 
     // Flush any stale buffered samples to prevent a "burst" after preset changes.
-    const uint32_t w = g_audioW.load(std::memory_order_acquire);
-    g_audioR.store(w, std::memory_order_release);
+    g_audio.flush();
 }
 
 static std::size_t audioSink(void* /*ctx*/, const int16_t* stereoFrames, std::size_t frameCount) noexcept {
+    SNESONLINE_PROFILE_SCOPE("android.audioSink");
     if (!stereoFrames || frameCount == 0) return frameCount;
-    uint32_t w = g_audioW.load(std::memory_order_relaxed);
-    uint32_t r = g_audioR.load(std::memory_order_acquire);
-    uint32_t used = w - r;
-    if (used > kAudioCapacityFrames) used = kAudioCapacityFrames;
-    uint32_t freeFrames = kAudioCapacityFrames - used;
-
-    uint32_t frames = static_cast<uint32_t>(frameCount);
-    if (frames > freeFrames) {
-        // Drop oldest.
-        const uint32_t drop = frames - freeFrames;
-        g_audioR.store(r + drop, std::memory_order_release);
-        g_audioDroppedTotalFrames.fetch_add(drop, std::memory_order_relaxed);
-    }
-
-    w = g_audioW.load(std::memory_order_relaxed);
-    for (uint32_t i = 0; i < frames; ++i) {
-        const uint32_t idx = (w + i) % kAudioCapacityFrames;
-        g_audio[idx * 2 + 0] = stereoFrames[i * 2 + 0];
-        g_audio[idx * 2 + 1] = stereoFrames[i * 2 + 1];
-    }
-    const uint32_t newW = w + frames;
-    g_audioW.store(newW, std::memory_order_release);
-
-    // Clamp buffered audio to avoid latency drifting upward over time.
-    const uint32_t maxBuffered = g_audioMaxBufferedFrames.load(std::memory_order_relaxed);
-    const uint32_t maxDropPerCall = g_audioMaxDropPerCallFrames.load(std::memory_order_relaxed);
-    if (maxBuffered > 0) {
-        const uint32_t curR = g_audioR.load(std::memory_order_acquire);
-        uint32_t usedNow = newW - curR;
-        if (usedNow > kAudioCapacityFrames) usedNow = kAudioCapacityFrames;
-        if (usedNow > maxBuffered) {
-            uint32_t drop = usedNow - maxBuffered;
-            // If far beyond the target, hard-drop to the target immediately.
-            // This avoids a long period of tiny drops (audible repeated glitches).
-            const uint32_t hardDropThreshold = maxBuffered * 2;
-            if (usedNow <= hardDropThreshold && maxDropPerCall > 0 && drop > maxDropPerCall) {
-                drop = maxDropPerCall;
+
+    // (Re)build the filter when Java picks the output rate or the core reports a new one.
+    const uint32_t outHz = g_audioOutputRateHz.load(std::memory_order_relaxed);
+    const double coreHz = snesonline::EmulatorEngine::instance().core().sampleRateHz();
+    if (outHz != 0 && (g_resampler.outputRateHz() != static_cast<double>(outHz) || g_resampler.inputRateHz() != coreHz)) {
+        g_resampled.clear();
+        if (g_resampler.configure(coreHz, static_cast<double>(outHz))) {
+            try {
+                g_resampled.assign(g_resampler.maxOutputFrames(kAudioChunkFrames) * 2, 0);
+            } catch (...) {
+                g_resampled.clear();
             }
-            g_audioR.store(curR + drop, std::memory_order_release);
-            g_audioDroppedTotalFrames.fetch_add(drop, std::memory_order_relaxed);
         }
     }
+    if (g_resampled.empty()) {
+        (void)g_audio.push(stereoFrames, static_cast<uint32_t>(frameCount));
+        return frameCount;
+    }
+
+    for (std::size_t done = 0; done < frameCount;) {
+        const std::size_t n = std::min<std::size_t>(frameCount - done, kAudioChunkFrames);
+        g_resampler.updateFill(g_audio.bufferedFrames(), g_audioTargetFrames.load(std::memory_order_relaxed));
+        const std::size_t out = g_resampler.process(stereoFrames + done * 2, n, g_resampled.data(), g_resampled.size() / 2);
+        (void)g_audio.push(g_resampled.data(), static_cast<uint32_t>(out));
+        done += n;
+    }
     return frameCount;
 }
 
@@ -1584,27 +1821,37 @@ inline void setBit(uint16_t bit, bool down) noexcept {
     g_inputMask.store(cur, std::memory_order_relaxed);
 }
 
-void loop60fps() {
+void frameLoop() {
     using clock = std::chrono::steady_clock;
-    constexpr auto frame = std::chrono::microseconds(16667);
+    snesonline::Profiler::setThreadName("emulation");
 
     // Best-effort: prioritize emulation/audio production.
     // (May be ignored by the OS depending on device/vendor restrictions.)
     setpriority(PRIO_PROCESS, 0, -10);
 
-    auto next = clock::now();
+    // Fixed-timestep loop at the core's real rate with bounded catch-up.
+    // If catch-up is too small and we ever miss our schedule (GC, I/O, CPU contention),
+    // we will under-produce audio and Java will start zero-padding. Once the audio queue is back
+    // at its target, the rest of a backlog is dropped rather than fast-forwarded.
+    snesonline::FrameScheduler::Config pace;
+    pace.framesPerSecond = snesonline::EmulatorEngine::instance().core().framesPerSecond();
+    pace.maxCatchUpFrames = 60;
+    // Shorter spin than desktop: every microsecond spun is battery.
+    pace.spinMicros = 500;
+    g_pacer.configure(pace);
+
+    clock::time_point stallStart{};
     while (g_running.load(std::memory_order_relaxed)) {
         const uint16_t localMask = g_inputMask.load(std::memory_order_relaxed);
         const bool paused = g_paused.load(std::memory_order_relaxed);
 
-        // Fixed-timestep loop with bounded catch-up.
-        // If this is too small and we ever miss our schedule (GC, I/O, CPU contention),
-        // we will under-produce audio and Java will start zero-padding.
-        constexpr int kMaxCatchUpFrames = 60;
-        int steps = 0;
-        auto now = clock::now();
-        while (now >= next && steps < kMaxCatchUpFrames) {
-            next += frame;
+        g_pacer.setAudioLevel(g_audio.bufferedFrames(), g_audioTargetFrames.load(std::memory_order_relaxed));
+        const uint32_t due = g_pacer.due(clock::now());
+        for (uint32_t step = 0; step < due; ++step) {
+            // The slot is used up even if the frame cannot run (paused, waiting for the peer).
+            g_pacer.advance();
+            // Only the newest frame of a catch-up burst is shown; the ones before it still feed audio.
+            const bool lastStep = step + 1 == due;
 
             // Persist in-game saves (SRAM) periodically (independent of savestates).
             maybeFlushSaveRam_(false);
@@ -1631,7 +1878,7 @@ void loop60fps() {
                     void* mem = core.memoryData(kRetroMemorySaveRam_);
                     const std::size_t memSize = core.memorySize(kRetroMemorySaveRam_);
                     if (mem && memSize > 0) {
-                        const uint32_t crc = crc32_(mem, memSize);
+                        const uint32_t crc = snesonline::crc32(mem, memSize);
                         static uint32_t lastSentCrc = 0;
                         static auto lastSentAt = clock::time_point{};
                         const auto now2 = clock::now();
@@ -1665,17 +1912,44 @@ void loop60fps() {
                 uint16_t localForFrame = 0;
                 uint16_t remoteForFrame = 0;
                 if (!g_netplay->tryGetInputsForCurrentFrame(localForFrame, remoteForFrame)) {
-                    g_netplayStatus.store(2, std::memory_order_relaxed);
-                    // Can't advance this frame yet; try again on the next iteration.
-                    break;
+                    // Wait on the socket until the next frame slot is due instead of sleeping through
+                    // it, so the frame runs the moment its input lands.
+                    if (stallStart.time_since_epoch().count() == 0) stallStart = clock::now();
+                    SNESONLINE_PROFILE_SCOPE("android.netplay.waitForInput");
+                    bool ready = false;
+                    while (!ready && g_running.load(std::memory_order_relaxed) && g_netplay->waitForDatagramUntil(g_pacer.nextDeadline())) {
+                        g_netplay->pumpRecv();
+                        ready = g_netplay->tryGetInputsForCurrentFrame(localForFrame, remoteForFrame);
+                    }
+                    if (!ready) {
+                        g_netplayStatus.store(2, std::memory_order_relaxed);
+                        // Can't advance this frame yet; try again on the next iteration.
+                        break;
+                    }
+                }
+
+                if (stallStart.time_since_epoch().count() != 0) {
+                    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - stallStart).count();
+                    const uint64_t stallUs = (us > 0) ? static_cast<uint64_t>(us) : 0u;
+                    stallStart = {};
+                    g_netplayStallEventsTotal.fetch_add(1, std::memory_order_relaxed);
+                    g_netplayStallMicrosTotal.fetch_add(stallUs, std::memory_order_relaxed);
+                    if (stallUs > g_netplayStallMicrosMax.load(std::memory_order_relaxed)) {
+                        g_netplayStallMicrosMax.store(stallUs, std::memory_order_relaxed);
+                    }
                 }
 
                 g_netplayStatus.store(3, std::memory_order_relaxed);
 
                 const bool localIsP1 = (g_netplay->localPlayerNum == 1);
-                snesonline::EmulatorEngine::instance().setInputMask(0, localIsP1 ? localForFrame : remoteForFrame);
-                snesonline::EmulatorEngine::instance().setInputMask(1, localIsP1 ? remoteForFrame : localForFrame);
-                snesonline::EmulatorEngine::instance().advanceFrame();
+                const uint16_t p1 = localIsP1 ? localForFrame : remoteForFrame;
+                const uint16_t p2 = localIsP1 ? remoteForFrame : localForFrame;
+                snesonline::EmulatorEngine::instance().setInputMask(0, p1);
+                snesonline::EmulatorEngine::instance().setInputMask(1, p2);
+                // A burst that will stall on the next frame ends here, so this frame has to be shown.
+                const bool last = lastStep || !g_netplay->inputsReadyFor(g_netplay->frame + 1);
+                snesonline::EmulatorEngine::instance().advanceFrame(last ? snesonline::FrameOutput::Present : snesonline::FrameOutput::AudioOnly);
+                g_spectators.recordFrame(g_netplay->frame, p1, p2);
                 g_netplay->frame++;
 
                 // Record + periodically exchange a light-weight checksum for desync detection.
@@ -1688,31 +1962,26 @@ void loop60fps() {
                     break;
                 }
                 snesonline::EmulatorEngine::instance().setLocalInputMask(localMask);
-                snesonline::EmulatorEngine::instance().advanceFrame();
+                snesonline::EmulatorEngine::instance().advanceFrame(lastStep ? snesonline::FrameOutput::Present : snesonline::FrameOutput::AudioOnly);
             }
 
-            steps++;
-            now = clock::now();
-
             if (paused) {
                 // Don't try to catch up accumulated time while paused.
                 break;
             }
         }
 
-        // Do NOT resync `next` forward here.
+        // Do NOT resync the schedule forward here.
         // Resyncing effectively *skips emulated frames*, which directly causes audio underflows.
-        // If we're behind, we want to keep advancing frames until we catch up.
+        // If we're behind, we want to keep advancing frames until we catch up (FrameScheduler
+        // only drops backlog once the audio queue is full).
 
-        if (steps > 0) {
-            g_loopFramesTotal.fetch_add(static_cast<uint64_t>(steps), std::memory_order_relaxed);
-            if (steps > 1) {
-                g_loopCatchupEventsTotal.fetch_add(1, std::memory_order_relaxed);
-                g_loopCatchupFramesTotal.fetch_add(static_cast<uint64_t>(steps - 1), std::memory_order_relaxed);
-            }
+        if (g_netplayEnabled.load(std::memory_order_relaxed) && g_netplay && g_spectators.active()) {
+            if (g_spectatorStateChanged.exchange(false, std::memory_order_relaxed)) g_spectators.invalidate();
+            g_spectators.service(snesonline::EmulatorEngine::instance(), g_netplay->frame, true);
         }
 
-        std::this_thread::sleep_until(next);
+        g_pacer.waitForNext();
     }
 }
 
@@ -1763,7 +2032,7 @@ Java_com_snesonline_NativeBridge_nativeInitialize(JNIEnv* env, jclass /*cls*/, j
     if (ok) {
         eng.core().setVideoSink(nullptr, &videoSink);
         eng.core().setAudioSink(nullptr, &audioSink);
-        configureAudioLatencyCaps(eng.core().sampleRateHz());
+        configureAudioLatencyCaps(audioRingRateHz_());
 
         const bool wantNetplay = (enableNetplay == JNI_TRUE);
         const uint8_t pnum = static_cast<uint8_t>((localPlayerNum == 2) ? 2 : 1);
@@ -1790,7 +2059,7 @@ Java_com_snesonline_NativeBridge_nativeInitialize(JNIEnv* env, jclass /*cls*/, j
         {
             void* mem = eng.core().memoryData(kRetroMemorySaveRam_);
             const std::size_t memSize = eng.core().memorySize(kRetroMemorySaveRam_);
-            g_saveRamLastCrc = (mem && memSize) ? crc32_(mem, memSize) : 0;
+            g_saveRamLastCrc = (mem && memSize) ? snesonline::crc32(mem, memSize) : 0;
             g_saveRamLastCheck = {};
             g_saveRamLastFlush = {};
         }
@@ -1837,6 +2106,12 @@ Java_com_snesonline_NativeBridge_nativeInitialize(JNIEnv* env, jclass /*cls*/, j
 
                 g_netplay = std::move(np);
                 g_netplayEnabled.store(true, std::memory_order_relaxed);
+
+                const int sp = g_spectatorPort.load(std::memory_order_relaxed);
+                if (pnum == 1 && sp >= 1 && sp <= 65535) {
+                    // Best-effort: the match runs without spectators if the port is taken.
+                    (void)g_spectators.start(static_cast<uint16_t>(sp), snesonline::SpectatorHost::kDefaultMaxSpectators);
+                }
             } else {
                 // Do not silently fall back to offline play if the user asked for netplay.
                 netplayOk = false;
@@ -1917,6 +2192,7 @@ Java_com_snesonline_NativeBridge_nativeLoadStateFromFile(JNIEnv* env, jclass /*c
             // If host in netplay, immediately stage and transfer the same state to the joiner.
             if (g_netplayEnabled.load(std::memory_order_relaxed) && g_netplay && g_netplay->localPlayerNum == 1) {
                 g_netplay->configureStateSyncHost(std::move(bytes));
+                g_spectatorStateChanged.store(true, std::memory_order_relaxed);
             }
         }
     }
@@ -1930,6 +2206,38 @@ Java_com_snesonline_NativeBridge_nativeSetPaused(JNIEnv* /*env*/, jclass /*cls*/
     g_paused.store(paused == JNI_TRUE, std::memory_order_relaxed);
 }
 
+// Call after nativeInitialize and before nativeStartLoop. With `secondInstance`, a second core on
+// its own thread renders the run-ahead frames; it writes into the FrameExchange directly, so the
+// picture path is the same. Returns false (and keeps single-instance run-ahead) if that core
+// cannot be started.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_snesonline_NativeBridge_nativeSetRunAhead(JNIEnv* /*env*/, jclass /*cls*/, jint frames, jboolean secondInstance) {
+    auto& eng = snesonline::EmulatorEngine::instance();
+    eng.setRunAheadFrames(frames > 0 ? static_cast<uint32_t>(frames) : 0u);
+    const bool second = secondInstance == JNI_TRUE && frames > 0;
+    return eng.setRunAheadSecondInstance(second) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Writes the recorded hot-path timings as a Chrome trace to `tracePath` and the per-phase summary
+// next to it (`tracePath` + ".txt"). Records nothing unless built with SNESONLINE_ENABLE_PROFILER.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_snesonline_NativeBridge_nativeDumpProfile(JNIEnv* env, jclass /*cls*/, jstring tracePath) {
+    if (!tracePath) return JNI_FALSE;
+    const char* path = env->GetStringUTFChars(tracePath, nullptr);
+    if (!path) return JNI_FALSE;
+    bool ok = snesonline::Profiler::writeChromeTrace(path);
+    const std::string summaryPath = std::string(path) + ".txt";
+    env->ReleaseStringUTFChars(tracePath, path);
+
+    if (std::FILE* f = std::fopen(summaryPath.c_str(), "wb")) {
+        ok = snesonline::Profiler::writeSummary(f) && ok;
+        ok = (std::fclose(f) == 0) && ok;
+    } else {
+        ok = false;
+    }
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
 extern "C" JNIEXPORT void JNICALL
 Java_com_snesonline_NativeBridge_nativeShutdown(JNIEnv* /*env*/, jclass /*cls*/) {
     // Flush natural saves (SRAM) on exit.
@@ -1940,6 +2248,7 @@ Java_com_snesonline_NativeBridge_nativeShutdown(JNIEnv* /*env*/, jclass /*cls*/)
 
     g_netplayEnabled.store(false, std::memory_order_relaxed);
     g_netplayStatus.store(0, std::memory_order_relaxed);
+    g_spectators.stop();
     if (g_netplay) {
         g_netplay->stop();
         g_netplay.reset();
@@ -1952,6 +2261,29 @@ Java_com_snesonline_NativeBridge_nativeGetNetplayStatus(JNIEnv* /*env*/, jclass
     return static_cast<jint>(g_netplayStatus.load(std::memory_order_relaxed));
 }
 
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_snesonline_NativeBridge_nativeGetNetplayStallStats(JNIEnv* env, jclass /*cls*/) {
+    const jlong v[3] = {
+        static_cast<jlong>(g_netplayStallEventsTotal.load(std::memory_order_relaxed)),
+        static_cast<jlong>(g_netplayStallMicrosTotal.load(std::memory_order_relaxed)),
+        static_cast<jlong>(g_netplayStallMicrosMax.load(std::memory_order_relaxed)),
+    };
+    jlongArray out = env->NewLongArray(3);
+    if (!out) return nullptr;
+    env->SetLongArrayRegion(out, 0, 3, v);
+    return out;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_snesonline_NativeBridge_nativeSetSpectatorPort(JNIEnv* /*env*/, jclass /*cls*/, jint port) {
+    g_spectatorPort.store((port >= 1 && port <= 65535) ? static_cast<int>(port) : 0, std::memory_order_relaxed);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_snesonline_NativeBridge_nativeGetSpectatorCount(JNIEnv* /*env*/, jclass /*cls*/) {
+    return static_cast<jint>(g_spectators.spectatorCount());
+}
+
 extern "C" JNIEXPORT jint JNICALL
 Java_com_snesonline_NativeBridge_nativeStunPublicUdpPort(JNIEnv* /*env*/, jclass /*cls*/, jint localPort) {
     const uint16_t lp = static_cast<uint16_t>((localPort >= 1 && localPort <= 65535) ? localPort : 0);
@@ -2007,7 +2339,7 @@ Java_com_snesonline_NativeBridge_nativeOnKey(JNIEnv* /*env*/, jclass /*cls*/, ji
 extern "C" JNIEXPORT void JNICALL
 Java_com_snesonline_NativeBridge_nativeStartLoop(JNIEnv* /*env*/, jclass /*cls*/) {
     if (g_running.exchange(true, std::memory_order_relaxed)) return;
-    g_loopThread = std::thread(loop60fps);
+    g_loopThread = std::thread(frameLoop);
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -2017,19 +2349,29 @@ Java_com_snesonline_NativeBridge_nativeStopLoop(JNIEnv* /*env*/, jclass /*cls*/)
 }
 
 extern "C" JNIEXPORT jint JNICALL
-Java_com_snesonline_NativeBridge_nativeGetVideoWidth(JNIEnv* /*env*/, jclass /*cls*/) {
-    return static_cast<jint>(g_videoW.load(std::memory_order_relaxed));
-}
-
-extern "C" JNIEXPORT jint JNICALL
-Java_com_snesonline_NativeBridge_nativeGetVideoHeight(JNIEnv* /*env*/, jclass /*cls*/) {
-    return static_cast<jint>(g_videoH.load(std::memory_order_relaxed));
+Java_com_snesonline_NativeBridge_nativeAcquireVideoFrame(JNIEnv* env, jclass /*cls*/, jintArray outWidthHeightSeq) {
+    const snesonline::FrameExchange::Frame f = g_video.acquire();
+    if (f.seq == 0) return -1;
+    if (outWidthHeightSeq && env->GetArrayLength(outWidthHeightSeq) >= 3) {
+        const jint info[3] = {static_cast<jint>(f.width), static_cast<jint>(f.height), static_cast<jint>(f.seq)};
+        env->SetIntArrayRegion(outWidthHeightSeq, 0, 3, info);
+    }
+    return static_cast<jint>(f.index);
 }
 
-extern "C" JNIEXPORT jobject JNICALL
-Java_com_snesonline_NativeBridge_nativeGetVideoBufferRGBA(JNIEnv* env, jclass /*cls*/) {
-    // Whole buffer; GameActivity uses width/height.
-    return env->NewDirectByteBuffer(g_rgba, static_cast<jlong>(sizeof(g_rgba)));
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_com_snesonline_NativeBridge_nativeGetVideoBuffersRGBA(JNIEnv* env, jclass /*cls*/) {
+    jclass byteBufferCls = env->FindClass("java/nio/ByteBuffer");
+    if (!byteBufferCls) return nullptr;
+    jobjectArray arr = env->NewObjectArray(static_cast<jsize>(snesonline::FrameExchange::kBufferCount), byteBufferCls, nullptr);
+    if (!arr) return nullptr;
+    for (unsigned i = 0; i < snesonline::FrameExchange::kBufferCount; ++i) {
+        jobject buf = env->NewDirectByteBuffer(g_video.buffer(i), static_cast<jlong>(snesonline::FrameExchange::kBufferBytes));
+        if (!buf) return nullptr;
+        env->SetObjectArrayElement(arr, static_cast<jsize>(i), buf);
+        env->DeleteLocalRef(buf);
+    }
+    return arr;
 }
 
 extern "C" JNIEXPORT jint JNICALL
@@ -2042,28 +2384,38 @@ Java_com_snesonline_NativeBridge_nativePopAudio(JNIEnv* env, jclass /*cls*/, jsh
     jshort* out = env->GetShortArrayElements(dstInterleavedStereo, &isCopy);
     if (!out) return 0;
 
-    uint32_t r = g_audioR.load(std::memory_order_relaxed);
-    uint32_t w = g_audioW.load(std::memory_order_acquire);
-    uint32_t avail = w - r;
-    if (avail > kAudioCapacityFrames) avail = kAudioCapacityFrames;
-    uint32_t frames = static_cast<uint32_t>(framesWanted);
-    if (frames > avail) frames = avail;
-    if (static_cast<uint32_t>(framesWanted) > frames) {
-        g_audioUnderflowTotalFrames.fetch_add(static_cast<uint64_t>(static_cast<uint32_t>(framesWanted) - frames), std::memory_order_relaxed);
-    }
-
-    for (uint32_t i = 0; i < frames; ++i) {
-        const uint32_t idx = (r + i) % kAudioCapacityFrames;
-        out[i * 2 + 0] = g_audio[idx * 2 + 0];
-        out[i * 2 + 1] = g_audio[idx * 2 + 1];
-    }
-
-    g_audioR.store(r + frames, std::memory_order_release);
+    const uint32_t frames = g_audio.pop(reinterpret_cast<int16_t*>(out), static_cast<uint32_t>(framesWanted));
 
     env->ReleaseShortArrayElements(dstInterleavedStereo, out, 0);
     return static_cast<jint>(frames);
 }
 
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_snesonline_NativeBridge_nativeGetAudioStats(JNIEnv* env, jclass /*cls*/) {
+    snesonline::AudioRing::Stats st;
+    g_audio.stats(st);
+    constexpr jsize kHead = 4;
+    constexpr jsize kCount = kHead + static_cast<jsize>(snesonline::AudioRing::kHistogramBuckets);
+    jlong v[kCount] = {
+        static_cast<jlong>(st.droppedFrames()),
+        static_cast<jlong>(st.underflowFrames),
+        static_cast<jlong>(st.poppedFrames),
+        static_cast<jlong>(st.histogramBucketFrames),
+    };
+    for (uint32_t i = 0; i < snesonline::AudioRing::kHistogramBuckets; ++i) v[kHead + i] = static_cast<jlong>(st.fillHistogram[i]);
+    jlongArray arr = env->NewLongArray(kCount);
+    if (!arr) return nullptr;
+    env->SetLongArrayRegion(arr, 0, kCount, v);
+    return arr;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_snesonline_NativeBridge_nativeSetAudioOutputSampleRateHz(JNIEnv* /*env*/, jclass /*cls*/, jint hz) {
+    const uint32_t out = (hz >= 8000 && hz <= 192000) ? static_cast<uint32_t>(hz) : 0u;
+    g_audioOutputRateHz.store(out, std::memory_order_relaxed);
+    configureAudioLatencyCaps(audioRingRateHz_());
+}
+
 extern "C" JNIEXPORT jint JNICALL
 Java_com_snesonline_NativeBridge_nativeGetAudioSampleRateHz(JNIEnv* /*env*/, jclass /*cls*/) {
     const double hz = snesonline::EmulatorEngine::instance().core().sampleRateHz();
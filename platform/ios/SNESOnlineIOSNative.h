@@ -11,6 +11,10 @@ extern "C" {
 // 0=off, 1=connecting (no peer yet), 2=waiting (peer but missing inputs), 3=ok, 4=syncing state
 int snesonline_ios_get_netplay_status(void);
 
+// Stall counters since start. A stall is a due frame waiting for the peer's input, from the first
+// failed attempt until it runs. Any pointer may be NULL.
+void snesonline_ios_get_netplay_stall_stats(uint64_t* outStalls, uint64_t* outTotalMicros, uint64_t* outMaxMicros);
+
 bool snesonline_ios_initialize(const char* corePath,
                               const char* romPath,
                               const char* statePath,
@@ -32,6 +36,10 @@ void snesonline_ios_stop_loop(void);
 // Pause emulation (loop keeps running to allow netplay state sync).
 void snesonline_ios_set_paused(bool paused);
 
+// Hot-path timings: Chrome trace JSON to tracePath, per-phase p50/p99 summary to tracePath + ".txt".
+// Empty unless built with SNESONLINE_ENABLE_PROFILER.
+bool snesonline_ios_dump_profile(const char* tracePath);
+
 // Save states (host-only in netplay).
 bool snesonline_ios_save_state_to_file(const char* statePath);
 bool snesonline_ios_load_state_from_file(const char* statePath);
@@ -45,14 +53,17 @@ const char* snesonline_ios_stun_mapped_address(int localPort);
 // Input mask is SNES bits (see include/snesonline/InputBits.h)
 void snesonline_ios_set_local_input_mask(uint16_t mask);
 
-// Video (RGBA8888 stored as 0xAARRGGBB uint32, backing buffer is 512x512)
-int snesonline_ios_get_video_width(void);
-int snesonline_ios_get_video_height(void);
-const uint32_t* snesonline_ios_get_video_buffer_rgba(void);
+// Video (RGBA8888 stored as 0xAARRGGBB uint32, rows of 512 pixels). Returns the newest frame (or the
+// previous one again if none is newer; outSeq counts frames) and NULL before the first. The pixels
+// stay valid and unchanged until the next call.
+const uint32_t* snesonline_ios_acquire_video_frame(int* outWidth, int* outHeight, uint32_t* outSeq);
 
 // Audio (stereo S16)
 int snesonline_ios_get_audio_sample_rate_hz(void);
 int snesonline_ios_pop_audio(int16_t* dstInterleavedStereo, int framesWanted);
+// Audio ring counters since start. outFillHistogram (16 entries, may be NULL) counts the ring's
+// fill at each pop in buckets of *outBucketFrames frames.
+void snesonline_ios_get_audio_stats(uint64_t* outDroppedFrames, uint64_t* outUnderflowFrames, uint64_t* outFillHistogram, uint32_t* outBucketFrames);
 
 #ifdef __cplusplus
 } // extern "C"
@@ -14,14 +14,25 @@
 #include <vector>
 #include <cstdio>
 
+#include "snesonline/AudioRing.h"
+#include "snesonline/BulkTransfer.h"
 #include "snesonline/EmulatorEngine.h"
+#include "snesonline/FrameExchange.h"
+#include "snesonline/FrameScheduler.h"
+#include "snesonline/Hash.h"
 #include "snesonline/InputBits.h"
+#include "snesonline/InputPacket.h"
+#include "snesonline/Lz.h"
+#include "snesonline/PixelConvert.h"
+#include "snesonline/Profiler.h"
+#include "snesonline/StateDelta.h"
 #include "snesonline/StunClient.h"
 
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <poll.h>
 #include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -51,19 +62,6 @@ static inline void write_u16_be_(uint8_t* p, uint16_t v) noexcept {
     std::memcpy(p, &be, sizeof(be));
 }
 
-static uint32_t crc32_(const void* data, std::size_t sizeBytes) noexcept {
-    uint32_t crc = 0xFFFFFFFFu;
-    const auto* p = static_cast<const uint8_t*>(data);
-    for (std::size_t i = 0; i < sizeBytes; ++i) {
-        crc ^= p[i];
-        for (int k = 0; k < 8; ++k) {
-            const uint32_t mask = -(crc & 1u);
-            crc = (crc >> 1) ^ (0xEDB88320u & mask);
-        }
-    }
-    return ~crc;
-}
-
 static bool readFile_(const char* path, std::vector<uint8_t>& out) noexcept {
     out.clear();
     if (!path || !path[0]) return false;
@@ -115,10 +113,23 @@ static bool loadStateBytes_(const uint8_t* data, std::size_t sizeBytes) noexcept
     if (!st.buffer.allocate(sizeBytes)) return false;
     std::memcpy(st.buffer.data(), data, sizeBytes);
     st.sizeBytes = sizeBytes;
-    st.checksum = crc32_(data, sizeBytes);
+    st.checksum = snesonline::crc32(data, sizeBytes);
     return snesonline::EmulatorEngine::instance().loadState(st);
 }
 
+static bool saveStateBytes_(std::vector<uint8_t>& out) noexcept {
+    snesonline::SaveState st;
+    if (!snesonline::EmulatorEngine::instance().saveState(st)) return false;
+    if (st.sizeBytes == 0 || !st.buffer.data()) return false;
+    try {
+        out.resize(st.sizeBytes);
+    } catch (...) {
+        return false;
+    }
+    std::memcpy(out.data(), st.buffer.data(), st.sizeBytes);
+    return true;
+}
+
 static bool ensureDir_(const std::string& dir) noexcept {
     if (dir.empty()) return false;
     if (::mkdir(dir.c_str(), 0755) == 0) return true;
@@ -211,7 +222,11 @@ static void maybeFlushSaveRam_(bool force) noexcept {
         g_saveRamLastCheck = now;
     }
 
-    const uint32_t crc = crc32_(mem, memSize);
+    uint32_t crc = 0;
+    {
+        SNESONLINE_PROFILE_SCOPE("ios.saveRamCrc");
+        crc = snesonline::crc32(mem, memSize);
+    }
     if (!force && crc == g_saveRamLastCrc) return;
     if (!force && g_saveRamLastFlush.time_since_epoch().count() != 0 && (now - g_saveRamLastFlush) < std::chrono::milliseconds(1000)) return;
 
@@ -226,6 +241,11 @@ std::atomic<bool> g_running{false};
 std::atomic<bool> g_paused{false};
 std::thread g_loopThread;
 
+// Netplay stalls: a due frame waiting for remote input, from the first failed attempt until it runs.
+std::atomic<uint64_t> g_netplayStallEventsTotal{0};
+std::atomic<uint64_t> g_netplayStallMicrosTotal{0};
+std::atomic<uint64_t> g_netplayStallMicrosMax{0};
+
 struct UdpNetplay {
     int sock = -1;
     sockaddr_in6 remote{};
@@ -264,6 +284,8 @@ struct UdpNetplay {
     std::chrono::steady_clock::time_point lastRecv{};
     std::chrono::steady_clock::time_point lastKeepAliveSent{};
 
+    snesonline::InputPacketNegotiator inputNegotiator;
+
     // While hosting and waiting for the first inbound packet, we still need outbound UDP traffic
     // to keep the NAT mapping alive so the joiner can reach us.
     sockaddr_in6 natPunchTarget{};
@@ -278,6 +300,10 @@ struct UdpNetplay {
     };
 
     static constexpr uint32_t kMagicInput = 0x534E4F49u;     // 'SNOI'
+    // v2 input: u32 magic, u16 token, then the RLE input window from snesonline/InputPacket.h.
+    // Negotiated per peer (snesonline::InputPacketNegotiator); older builds only understand 'SNOI'.
+    static constexpr uint32_t kMagicInputWindow = 0x534E4F4Au; // 'SNOJ'
+    static constexpr ssize_t kInputWindowHeaderBytes = 6;
     static constexpr uint32_t kMagicHash = 0x534E4F48u;      // 'SNOH'
     static constexpr uint32_t kMagicKeepAlive = 0x534E4F4Bu; // 'SNOK'
     static constexpr uint32_t kMagicResyncReq = 0x534E4F51u; // 'SNOQ'
@@ -330,13 +356,38 @@ struct UdpNetplay {
     std::vector<uint8_t> saveRamRxHave;
     uint16_t saveRamRxHaveCount = 0;
 
+    // Bulk transfer for state/SRAM, negotiated through the offer flags (same scheme as Android):
+    // the host keeps sending legacy chunks until the joiner's first bulk ack.
+    static constexpr uint8_t kBulkChannelState = 1;
+    static constexpr uint8_t kBulkChannelSaveRam = 2;
+    static constexpr uint16_t kOfferFlagBulk = 1u << 1;
+    snesonline::BulkSender stateBulkTx;
+    snesonline::BulkReceiver stateBulkRx;
+    snesonline::BulkSender saveRamBulkTx;
+    snesonline::BulkReceiver saveRamBulkRx;
+
+    // LZ-compressed bulk blob (kOfferFlagLz, 26-byte offer with packed size/CRC), as on Android.
+    static constexpr uint16_t kOfferFlagLz = 1u << 2;
+    uint32_t statePackedSize = 0; // joiner: 0 => the bulk blob is raw
+    uint32_t statePackedCrc = 0;
+    uint32_t saveRamPackedSize = 0;
+    uint32_t saveRamPackedCrc = 0;
+
+    // Block-hash delta for desync resyncs (kOfferFlagDelta + 'SNOT' offer), as on Android.
+    static constexpr uint8_t kBulkChannelDelta = 3;
+    static constexpr uint16_t kOfferFlagDelta = 1u << 3;
+    snesonline::DeltaSyncHost stateDeltaTx;
+    snesonline::DeltaSyncJoiner stateDeltaRx;
+
     void configureStateSyncHost(std::vector<uint8_t>&& bytes) noexcept {
         stateTx = std::move(bytes);
         stateSize = static_cast<uint32_t>(stateTx.size());
-        stateCrc = stateSize ? crc32_(stateTx.data(), stateTx.size()) : 0;
+        stateCrc = stateSize ? snesonline::crc32(stateTx.data(), stateTx.size()) : 0;
         stateChunkSize = 1024;
         stateChunkCount = static_cast<uint16_t>((stateSize + stateChunkSize - 1u) / stateChunkSize);
         wantStateSync = (stateSize > 0);
+        beginBulk_(stateBulkTx, kBulkChannelState, stateTx);
+        stateDeltaTx.cancel();
         isHost = true;
         peerStateReady = !wantStateSync;
         selfStateReady = true;
@@ -356,6 +407,10 @@ struct UdpNetplay {
         stateRx.clear();
         stateRxHave.clear();
         stateRxHaveCount = 0;
+        stateBulkRx.reset();
+        stateDeltaRx.reset();
+        statePackedSize = 0;
+        statePackedCrc = 0;
         stateSize = 0;
         stateCrc = 0;
         stateChunkSize = 1024;
@@ -364,18 +419,19 @@ struct UdpNetplay {
 
     bool queueSaveRamSync(std::vector<uint8_t>&& bytes, bool gateUntilAck) noexcept {
         if (bytes.empty()) return false;
-        const uint32_t crc = crc32_(bytes.data(), bytes.size());
+        const uint32_t crc = snesonline::crc32(bytes.data(), bytes.size());
         if (wantSaveRamSync && crc == saveRamCrc && static_cast<uint32_t>(bytes.size()) == saveRamSize) {
             return true;
         }
 
         saveRamTx = std::move(bytes);
         saveRamSize = static_cast<uint32_t>(saveRamTx.size());
-        saveRamCrc = saveRamSize ? crc32_(saveRamTx.data(), saveRamTx.size()) : 0;
+        saveRamCrc = saveRamSize ? snesonline::crc32(saveRamTx.data(), saveRamTx.size()) : 0;
         saveRamChunkSize = 1024;
         saveRamChunkCount = static_cast<uint16_t>((saveRamSize + saveRamChunkSize - 1u) / saveRamChunkSize);
 
         wantSaveRamSync = (saveRamSize > 0);
+        beginBulk_(saveRamBulkTx, kBulkChannelSaveRam, saveRamTx);
         saveRamGate = gateUntilAck;
         peerSaveRamReady = !saveRamGate;
         nextSaveRamChunkToSend = 0;
@@ -393,6 +449,9 @@ struct UdpNetplay {
         saveRamRx.clear();
         saveRamRxHave.clear();
         saveRamRxHaveCount = 0;
+        saveRamBulkRx.reset();
+        saveRamPackedSize = 0;
+        saveRamPackedCrc = 0;
         saveRamSize = 0;
         saveRamCrc = 0;
         saveRamChunkSize = 1024;
@@ -655,6 +714,13 @@ struct UdpNetplay {
         joinAwaitingSaveRamOffer = false;
         joinWaitSaveRamOfferDeadline = {};
 
+        stateBulkTx.cancel();
+        stateBulkRx.reset();
+        stateDeltaTx.cancel();
+        stateDeltaRx.reset();
+        saveRamBulkTx.cancel();
+        saveRamBulkRx.reset();
+
         remoteFrameTag.fill(0xFFFFFFFFu);
         remoteMask.fill(0);
         sentFrameTag.fill(0xFFFFFFFFu);
@@ -675,6 +741,7 @@ struct UdpNetplay {
 
         hasPeer = false;
         lastRecv = {};
+        inputNegotiator.reset(true);
 
         natPunchTarget = {};
         natPunchReady = false;
@@ -683,7 +750,7 @@ struct UdpNetplay {
         discoverPeer = false;
 
         requireSecret = (sharedSecret && sharedSecret[0]);
-        secret32 = requireSecret ? crc32_(sharedSecret, std::strlen(sharedSecret)) : 0u;
+        secret32 = requireSecret ? snesonline::crc32(sharedSecret, std::strlen(sharedSecret)) : 0u;
         uint32_t mix = secret32 ^ (secret32 >> 16);
         secret16 = static_cast<uint16_t>(mix & 0xFFFFu);
         if (requireSecret && secret16 == 0) secret16 = 1;
@@ -774,6 +841,7 @@ struct UdpNetplay {
             if (!peerStateReady && stateSyncDeadline.time_since_epoch().count() != 0 && now > stateSyncDeadline) {
                 // Peer never acked (likely couldn't load the state). Fall back to starting from reset.
                 wantStateSync = false;
+                stateDeltaTx.cancel();
                 peerStateReady = true;
                 selfStateReady = true;
                 stateTx.clear();
@@ -788,6 +856,7 @@ struct UdpNetplay {
             if (!selfStateReady && stateSyncDeadline.time_since_epoch().count() != 0 && now > stateSyncDeadline) {
                 // We received a state offer but couldn't successfully load it. Fall back to starting from reset.
                 wantStateSync = false;
+                stateDeltaRx.reset();
                 selfStateReady = true;
                 peerStateReady = true;
                 stateRx.clear();
@@ -839,6 +908,7 @@ struct UdpNetplay {
     }
 
     void performResyncHostIfPending_() noexcept {
+        SNESONLINE_PROFILE_SCOPE("ios.netplay.resyncHost");
         if (!pendingResyncHost) return;
         const auto now = std::chrono::steady_clock::now();
         if (lastResyncTriggered.time_since_epoch().count() != 0 && (now - lastResyncTriggered) < std::chrono::seconds(2)) {
@@ -848,22 +918,23 @@ struct UdpNetplay {
         lastResyncTriggered = now;
         pendingResyncHost = false;
 
-        snesonline::SaveState st;
-        if (snesonline::EmulatorEngine::instance().saveState(st) && st.sizeBytes > 0 && st.buffer.data()) {
-            std::vector<uint8_t> bytes(st.sizeBytes);
-            std::memcpy(bytes.data(), st.buffer.data(), st.sizeBytes);
+        std::vector<uint8_t> bytes;
+        if (saveStateBytes_(bytes)) {
             configureStateSyncHost(std::move(bytes));
+            // The joiner's state is nearly the same: offer just the blocks that differ as well.
+            if (!stateDeltaTx.begin(kBulkChannelDelta, stateTx.data(), stateTx.size())) stateDeltaTx.cancel();
             peerStateReady = false;
         }
     }
 
     void recordLocalHashForCompletedFrame_(uint32_t completedFrame) noexcept {
+        SNESONLINE_PROFILE_SCOPE("ios.netplay.recordLocalHash");
         auto& core = snesonline::EmulatorEngine::instance().core();
         void* mem = core.memoryData(2 /* RETRO_MEMORY_SYSTEM_RAM */);
         const std::size_t memSize = core.memorySize(2);
         uint32_t h = 0;
         if (mem && memSize > 0) {
-            h = crc32_(mem, memSize);
+            h = snesonline::crc32(mem, memSize);
         }
         const uint32_t idx = completedFrame % kBufN;
         localHashTag[idx] = completedFrame;
@@ -871,6 +942,7 @@ struct UdpNetplay {
     }
 
     void maybeSendLocalHashForCompletedFrame_(uint32_t completedFrame) noexcept {
+        SNESONLINE_PROFILE_SCOPE("ios.netplay.sendLocalHash");
         if (sock < 0 || !hasPeer) return;
         if ((completedFrame % kHashIntervalFrames) != 0) return;
         const uint32_t idx = completedFrame % kBufN;
@@ -882,26 +954,104 @@ struct UdpNetplay {
         sendto(sock, pkt, sizeof(pkt), 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
     }
 
+    // Host: starts the bulk side of a state/SRAM transfer, LZ-compressed when that makes it smaller.
+    static void beginBulk_(snesonline::BulkSender& tx, uint8_t channel, const std::vector<uint8_t>& raw) noexcept {
+        std::vector<uint8_t> packed;
+        size_t packedBytes = 0;
+        try {
+            packed.resize(snesonline::lzMaxCompressedSize(raw.size()));
+            packedBytes = snesonline::lzCompress(raw.data(), raw.size(), packed.data(), packed.size());
+        } catch (...) {
+            packedBytes = 0;
+        }
+        const bool lz = packedBytes != 0 && packedBytes < raw.size();
+        if (!tx.begin(channel, lz ? packed.data() : raw.data(), lz ? packedBytes : raw.size(), true)) tx.cancel();
+    }
+
+    // Host: offer tail after the 16-byte header. Returns the offer length (18 or 26).
+    static size_t writeOfferTail_(uint8_t* info, uint16_t flags, const snesonline::BulkSender& tx, uint32_t rawSize) noexcept {
+        if (tx.active()) flags |= kOfferFlagBulk;
+        if (!tx.active() || tx.totalBytes() == rawSize) {
+            write_u16_be_(info + 16, flags);
+            return 18;
+        }
+        write_u16_be_(info + 16, static_cast<uint16_t>(flags | kOfferFlagLz));
+        write_u32_be_(info + 18, tx.totalBytes());
+        write_u32_be_(info + 22, tx.crc());
+        return 26;
+    }
+
+    // Joiner: the raw bytes of a finished bulk transfer, or nullptr if it is not the one offered. A
+    // compressed blob is decoded into `scratch` (sized by the offer) and checked against the raw CRC.
+    static const uint8_t* bulkPayload_(const snesonline::BulkReceiver& rx, uint32_t size, uint32_t crc, uint32_t packedSize, uint32_t packedCrc,
+                                       std::vector<uint8_t>& scratch) noexcept {
+        if (packedSize == 0) return (rx.totalBytes() == size && rx.crc() == crc) ? rx.data().data() : nullptr;
+        if (rx.totalBytes() != packedSize || rx.crc() != packedCrc || scratch.size() != size) return nullptr;
+        if (snesonline::lzDecompress(rx.data().data(), rx.data().size(), scratch.data(), scratch.size()) != size) return nullptr;
+        return (snesonline::crc32(scratch.data(), size) == crc) ? scratch.data() : nullptr;
+    }
+
+    void pumpBulkSend_(snesonline::BulkSender& tx) noexcept {
+        snesonline::BulkDatagram out[snesonline::kBulkMaxBatch];
+        const std::size_t count = tx.poll(std::chrono::steady_clock::now(), out, snesonline::kBulkMaxBatch);
+        (void)snesonline::sendBulkDatagrams(sock, out, count, &remote, sizeof(remote));
+    }
+
+    void pumpDelta_() noexcept {
+        snesonline::BulkDatagram out[snesonline::kBulkMaxBatch];
+        const auto now = std::chrono::steady_clock::now();
+        const std::size_t count = (localPlayerNum == 1) ? stateDeltaTx.poll(now, out, snesonline::kBulkMaxBatch)
+                                                        : stateDeltaRx.poll(now, out, snesonline::kBulkMaxBatch);
+        (void)snesonline::sendBulkDatagrams(sock, out, count, &remote, sizeof(remote));
+    }
+
+    // Joiner: the delta resync rebuilt the offered state.
+    void onStateDeltaComplete_() noexcept {
+        if (selfStateReady) return;
+        if (stateDeltaRx.stateBytes() != stateSize || stateDeltaRx.stateCrc() != stateCrc) return;
+        onStateReceived_(stateDeltaRx.state().data(), stateDeltaRx.state().size());
+    }
+
+    void pumpBulkAck_(snesonline::BulkReceiver& rx) noexcept {
+        uint8_t ack[snesonline::kBulkMaxAckBytes];
+        const std::size_t len = rx.pollAck(std::chrono::steady_clock::now(), ack, sizeof(ack));
+        if (len != 0) sendto(sock, ack, len, 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
+    }
+
     void pumpStateSyncSend() noexcept {
+        SNESONLINE_PROFILE_SCOPE("ios.netplay.stateSyncSend");
         if (sock < 0 || !hasPeer) return;
+        if (localPlayerNum != 1) {
+            pumpBulkAck_(stateBulkRx);
+            pumpDelta_();
+            return;
+        }
         if (!wantStateSync || stateTx.empty() || stateChunkCount == 0) return;
         if (peerStateReady) return;
 
         // Android wire format (for cross-platform):
-        // - StateInfo: 16 bytes: magic, size, crc, chunkSize, chunkCount
+        // - StateInfo: 16 bytes (+ optional 2 byte flags, + packed size/crc with kOfferFlagLz): magic, size, crc, chunkSize, chunkCount, [flags]
         // - StateChunk: 12 + payload: magic, idx, chunkCount, payloadSize, reserved, payload
         const auto now = std::chrono::steady_clock::now();
         if (lastInfoSent.time_since_epoch().count() == 0 || (now - lastInfoSent) > std::chrono::milliseconds(500)) {
-            uint8_t info[16] = {};
+            uint8_t info[26] = {};
             write_u32_be_(info, kMagicStateInfo);
             write_u32_be_(info + 4, stateSize);
             write_u32_be_(info + 8, stateCrc);
             write_u16_be_(info + 12, stateChunkSize);
             write_u16_be_(info + 14, stateChunkCount);
-            sendto(sock, info, sizeof(info), 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
+            const size_t len = writeOfferTail_(info, stateDeltaTx.active() ? kOfferFlagDelta : 0u, stateBulkTx, stateSize);
+            sendto(sock, info, len, 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
+            uint8_t tree[snesonline::kDeltaOfferBytes];
+            const size_t treeLen = stateDeltaTx.writeOffer(tree, sizeof(tree));
+            if (treeLen != 0) sendto(sock, tree, treeLen, 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
             lastInfoSent = now;
         }
 
+        pumpBulkSend_(stateBulkTx);
+        pumpDelta_();
+        if (stateBulkTx.receiverSeen() || stateDeltaTx.receiverSeen()) return;
+
         for (int i = 0; i < 8; ++i) {
             const uint16_t chunk = static_cast<uint16_t>(nextChunkToSend % stateChunkCount);
             const uint32_t off = static_cast<uint32_t>(chunk) * static_cast<uint32_t>(stateChunkSize);
@@ -923,27 +1073,34 @@ struct UdpNetplay {
     }
 
     void pumpSaveRamSyncSend() noexcept {
+        SNESONLINE_PROFILE_SCOPE("ios.netplay.saveRamSyncSend");
         if (sock < 0 || !hasPeer) return;
+        if (localPlayerNum != 1) {
+            pumpBulkAck_(saveRamBulkRx);
+            return;
+        }
         if (!wantSaveRamSync || saveRamTx.empty() || saveRamChunkCount == 0) return;
         if (peerSaveRamReady) return;
 
         // Android wire format (for cross-platform):
-        // - SaveRamInfo: 16 bytes (+ optional 2 byte flags): magic, size, crc, chunkSize, chunkCount, [flags]
+        // - SaveRamInfo: 16 bytes (+ optional 2 byte flags, + packed size/crc with kOfferFlagLz): magic, size, crc, chunkSize, chunkCount, [flags]
         // - SaveRamChunk: 12 + payload: magic, idx, chunkCount, payloadSize, reserved, payload
         const auto now = std::chrono::steady_clock::now();
         if (lastSaveRamInfoSent.time_since_epoch().count() == 0 || (now - lastSaveRamInfoSent) > std::chrono::milliseconds(500)) {
-            uint8_t info[18] = {};
+            uint8_t info[26] = {};
             write_u32_be_(info, kMagicSaveRamInfo);
             write_u32_be_(info + 4, saveRamSize);
             write_u32_be_(info + 8, saveRamCrc);
             write_u16_be_(info + 12, saveRamChunkSize);
             write_u16_be_(info + 14, saveRamChunkCount);
-            const uint16_t flags = saveRamGate ? 1u : 0u;
-            write_u16_be_(info + 16, flags);
-            sendto(sock, info, sizeof(info), 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
+            const size_t len = writeOfferTail_(info, saveRamGate ? 1u : 0u, saveRamBulkTx, saveRamSize);
+            sendto(sock, info, len, 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
             lastSaveRamInfoSent = now;
         }
 
+        pumpBulkSend_(saveRamBulkTx);
+        if (saveRamBulkTx.receiverSeen()) return;
+
         for (int i = 0; i < 8; ++i) {
             const uint16_t chunk = static_cast<uint16_t>(nextSaveRamChunkToSend % saveRamChunkCount);
             const uint32_t off = static_cast<uint32_t>(chunk) * static_cast<uint32_t>(saveRamChunkSize);
@@ -965,6 +1122,7 @@ struct UdpNetplay {
     }
 
     void pumpRecv() noexcept {
+        SNESONLINE_PROFILE_SCOPE("ios.netplay.pumpRecv");
         if (sock < 0) return;
 
         for (;;) {
@@ -985,11 +1143,14 @@ struct UdpNetplay {
 
             // Host auto-discovery: only accept the first peer if it presents the correct secret token.
             if (discoverPeer && !hasPeer) {
-                if (magic != kMagicInput) continue;
-                if (static_cast<size_t>(n) < sizeof(Packet)) continue;
-                if (requireSecret) {
-                    const uint16_t tok = read_u16_be_(buf + 10);
-                    if (tok != secret16) continue;
+                if (magic == kMagicInput) {
+                    if (static_cast<size_t>(n) < sizeof(Packet)) continue;
+                    if (requireSecret) {
+                        const uint16_t tok = read_u16_be_(buf + 10);
+                        if (tok != secret16) continue;
+                    }
+                } else if (magic != kMagicInputWindow || n <= kInputWindowHeaderBytes) {
+                    continue;
                 }
             }
 
@@ -1003,14 +1164,42 @@ struct UdpNetplay {
                 const uint16_t tok = read_u16_be_(buf + 10);
                 if (tok != secret16) continue;
             }
+            if (magic == kMagicInputWindow && requireSecret) {
+                if (n <= kInputWindowHeaderBytes) continue;
+                const uint16_t tok = read_u16_be_(buf + 4);
+                if (tok != secret16) continue;
+            }
 
             // For all other packet types, require a discovered peer first.
-            if (!hasPeer && magic != kMagicInput && magic != kMagicKeepAlive) {
+            if (!hasPeer && magic != kMagicInput && magic != kMagicInputWindow && magic != kMagicKeepAlive) {
                 continue;
             }
 
             markPeerConnected_(from);
 
+            uint8_t bulkChannel = 0;
+            const snesonline::BulkDatagramKind bulk = snesonline::peekBulkDatagram(buf, static_cast<size_t>(n), bulkChannel);
+            if (bulk == snesonline::BulkDatagramKind::Ack) {
+                if (localPlayerNum != 1) continue;
+                if (bulkChannel == kBulkChannelState) stateBulkTx.onDatagram(buf, static_cast<size_t>(n), lastRecv);
+                if (bulkChannel == kBulkChannelSaveRam) saveRamBulkTx.onDatagram(buf, static_cast<size_t>(n), lastRecv);
+                if (bulkChannel == kBulkChannelDelta) stateDeltaTx.onDatagram(buf, static_cast<size_t>(n), lastRecv);
+                continue;
+            }
+            if (bulk == snesonline::BulkDatagramKind::Data) {
+                if (localPlayerNum != 2) continue;
+                if (bulkChannel == kBulkChannelState && stateBulkRx.onDatagram(buf, static_cast<size_t>(n), lastRecv)) {
+                    const uint8_t* data = bulkPayload_(stateBulkRx, stateSize, stateCrc, statePackedSize, statePackedCrc, stateRx);
+                    if (!selfStateReady && data) onStateReceived_(data, stateSize);
+                }
+                if (bulkChannel == kBulkChannelSaveRam && saveRamBulkRx.onDatagram(buf, static_cast<size_t>(n), lastRecv)) {
+                    const uint8_t* data = bulkPayload_(saveRamBulkRx, saveRamSize, saveRamCrc, saveRamPackedSize, saveRamPackedCrc, saveRamRx);
+                    if (!selfSaveRamReady && data) onSaveRamReceived_(data, saveRamSize);
+                }
+                if (bulkChannel == kBulkChannelDelta && stateDeltaRx.onDatagram(buf, static_cast<size_t>(n), lastRecv)) onStateDeltaComplete_();
+                continue;
+            }
+
             if (magic == kMagicKeepAlive) {
                 // Keepalive: refresh peer/lastRecv only.
                 continue;
@@ -1025,6 +1214,22 @@ struct UdpNetplay {
                 const uint32_t idx = f % kBufN;
                 remoteFrameTag[idx] = f;
                 remoteMask[idx] = m;
+                inputNegotiator.onV1Received();
+                continue;
+            }
+
+            if (magic == kMagicInputWindow) {
+                uint32_t newest = 0;
+                uint32_t count = 0;
+                uint16_t masks[snesonline::kMaxInputWindow];
+                if (!snesonline::decodeInputWindow(buf + kInputWindowHeaderBytes, static_cast<size_t>(n - kInputWindowHeaderBytes), newest, masks, count)) continue;
+                for (uint32_t i = 0; i < count; ++i) {
+                    const uint32_t f = newest - count + 1 + i;
+                    const uint32_t fi = f % kBufN;
+                    remoteFrameTag[fi] = f;
+                    remoteMask[fi] = masks[i];
+                }
+                inputNegotiator.onV2Received();
                 continue;
             }
 
@@ -1061,9 +1266,22 @@ struct UdpNetplay {
                 const uint32_t crc = read_u32_be_(buf + 8);
                 const uint16_t chunkSize = read_u16_be_(buf + 12);
                 const uint16_t chunkCount = read_u16_be_(buf + 14);
-                // iOS legacy includes frame at +16; ignore.
+                // iOS legacy includes frame at +16 (20-byte offer); Android/bulk-capable hosts send flags there (18/26 bytes).
+                const uint16_t flags = (n == 18 || n == 26) ? read_u16_be_(buf + 16) : 0u;
+                const bool packed = (flags & kOfferFlagLz) && n == 26;
+                const uint32_t bulkSize = packed ? read_u32_be_(buf + 18) : size;
+                const uint32_t bulkCrc = packed ? read_u32_be_(buf + 22) : crc;
 
                 if (size == 0 || chunkSize == 0 || chunkCount == 0) continue;
+                statePackedSize = packed ? bulkSize : 0u;
+                statePackedCrc = packed ? bulkCrc : 0u;
+                if ((flags & kOfferFlagBulk) && size == stateSize && crc == stateCrc) {
+                    // Offer repeated while the transfer runs: keep what has arrived. Once loaded, a
+                    // repeat means our ack got lost, and a bulk host sends no more chunks; ack again.
+                    if (selfStateReady) sendSyncAck_(kMagicStateAck, size, crc);
+                    else if (!(flags & kOfferFlagDelta)) (void)stateBulkRx.expect(kBulkChannelState, bulkSize, bulkCrc);
+                    continue;
+                }
                 stateSize = size;
                 stateCrc = crc;
                 stateChunkSize = chunkSize;
@@ -1075,6 +1293,33 @@ struct UdpNetplay {
                 selfStateReady = false;
                 joinAwaitingStateOffer = false;
                 stateSyncDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+                if ((flags & kOfferFlagBulk) && !(flags & kOfferFlagDelta)) (void)stateBulkRx.expect(kBulkChannelState, bulkSize, bulkCrc);
+                continue;
+            }
+
+            if (magic == snesonline::kDeltaOfferMagic) {
+                if (localPlayerNum != 2 || selfStateReady) continue;
+                if (n < static_cast<int>(snesonline::kDeltaOfferBytes)) continue;
+                if (read_u32_be_(buf + 4) != stateSize || read_u32_be_(buf + 8) != stateCrc) continue;
+                if (stateDeltaRx.isCurrentOffer(buf, static_cast<size_t>(n))) continue;
+                // Patch our own state; without one, every block is fetched.
+                std::vector<uint8_t> base;
+                (void)saveStateBytes_(base);
+                if (stateDeltaRx.begin(kBulkChannelDelta, buf, static_cast<size_t>(n), base.data(), base.size()) && stateDeltaRx.complete()) {
+                    onStateDeltaComplete_();
+                }
+                continue;
+            }
+
+            if (magic == snesonline::kDeltaNodeHashesMagic) {
+                if (localPlayerNum != 2) continue;
+                (void)stateDeltaRx.onDatagram(buf, static_cast<size_t>(n), lastRecv);
+                continue;
+            }
+
+            if (magic == snesonline::kDeltaNodeRequestMagic || magic == snesonline::kDeltaBlockRequestMagic) {
+                if (localPlayerNum != 1) continue;
+                stateDeltaTx.onDatagram(buf, static_cast<size_t>(n), lastRecv);
                 continue;
             }
 
@@ -1123,18 +1368,8 @@ struct UdpNetplay {
                 stateRxHaveCount++;
 
                 if (stateRxHaveCount == stateChunkCount) {
-                    const uint32_t gotCrc = crc32_(stateRx.data(), stateRx.size());
-                    if (gotCrc == stateCrc) {
-                        (void)loadStateBytes_(stateRx.data(), stateRx.size());
-                        selfStateReady = true;
-
-                        // Android ack format: magic, size, crc
-                        uint8_t ack[12] = {};
-                        write_u32_be_(ack, kMagicStateAck);
-                        write_u32_be_(ack + 4, stateSize);
-                        write_u32_be_(ack + 8, stateCrc);
-                        sendto(sock, ack, sizeof(ack), 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
-                    }
+                    const uint32_t gotCrc = snesonline::crc32(stateRx.data(), stateRx.size());
+                    if (gotCrc == stateCrc && !selfStateReady) onStateReceived_(stateRx.data(), stateRx.size());
                 }
                 continue;
             }
@@ -1173,8 +1408,18 @@ struct UdpNetplay {
                 const uint16_t chunkCount = read_u16_be_(buf + 14);
                 uint16_t flags = 0;
                 if (n >= 18) flags = read_u16_be_(buf + 16);
+                const bool packed = (flags & kOfferFlagLz) && n >= 26;
+                const uint32_t bulkSize = packed ? read_u32_be_(buf + 18) : size;
+                const uint32_t bulkCrc = packed ? read_u32_be_(buf + 22) : crc;
 
                 if (size == 0 || chunkSize == 0 || chunkCount == 0) continue;
+                saveRamPackedSize = packed ? bulkSize : 0u;
+                saveRamPackedCrc = packed ? bulkCrc : 0u;
+                if ((flags & kOfferFlagBulk) && size == saveRamSize && crc == saveRamCrc) {
+                    if (selfSaveRamReady) sendSyncAck_(kMagicSaveRamAck, size, crc);
+                    else (void)saveRamBulkRx.expect(kBulkChannelSaveRam, bulkSize, bulkCrc);
+                    continue;
+                }
                 saveRamSize = size;
                 saveRamCrc = crc;
                 saveRamChunkSize = chunkSize;
@@ -1186,6 +1431,7 @@ struct UdpNetplay {
                 saveRamRxHaveCount = 0;
                 selfSaveRamReady = false;
                 joinAwaitingSaveRamOffer = false;
+                if (flags & kOfferFlagBulk) (void)saveRamBulkRx.expect(kBulkChannelSaveRam, bulkSize, bulkCrc);
                 continue;
             }
 
@@ -1234,18 +1480,8 @@ struct UdpNetplay {
                 saveRamRxHaveCount++;
 
                 if (saveRamRxHaveCount == saveRamChunkCount) {
-                    const uint32_t gotCrc = crc32_(saveRamRx.data(), saveRamRx.size());
-                    if (gotCrc == saveRamCrc) {
-                        (void)applySaveRamBytes_(saveRamRx.data(), saveRamRx.size());
-                        selfSaveRamReady = true;
-
-                        // Android ack format: magic, size, crc
-                        uint8_t ack[12] = {};
-                        write_u32_be_(ack, kMagicSaveRamAck);
-                        write_u32_be_(ack + 4, saveRamSize);
-                        write_u32_be_(ack + 8, saveRamCrc);
-                        sendto(sock, ack, sizeof(ack), 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
-                    }
+                    const uint32_t gotCrc = snesonline::crc32(saveRamRx.data(), saveRamRx.size());
+                    if (gotCrc == saveRamCrc && !selfSaveRamReady) onSaveRamReceived_(saveRamRx.data(), saveRamRx.size());
                 }
                 continue;
             }
@@ -1271,7 +1507,31 @@ struct UdpNetplay {
         }
     }
 
+    // Android ack format: magic, size, crc
+    void sendSyncAck_(uint32_t magic, uint32_t size, uint32_t crc) noexcept {
+        uint8_t ack[12] = {};
+        write_u32_be_(ack, magic);
+        write_u32_be_(ack + 4, size);
+        write_u32_be_(ack + 8, crc);
+        sendto(sock, ack, sizeof(ack), 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
+    }
+
+    // Joiner: a complete, CRC-checked state arrived (legacy chunks or bulk).
+    void onStateReceived_(const uint8_t* data, std::size_t size) noexcept {
+        (void)loadStateBytes_(data, size);
+        selfStateReady = true;
+        sendSyncAck_(kMagicStateAck, stateSize, stateCrc);
+    }
+
+    // Joiner: a complete, CRC-checked SRAM image arrived (legacy chunks or bulk).
+    void onSaveRamReceived_(const uint8_t* data, std::size_t size) noexcept {
+        (void)applySaveRamBytes_(data, size);
+        selfSaveRamReady = true;
+        sendSyncAck_(kMagicSaveRamAck, saveRamSize, saveRamCrc);
+    }
+
     void sendKeepAlive() noexcept {
+        SNESONLINE_PROFILE_SCOPE("ios.netplay.sendKeepAlive");
         if (sock < 0) return;
         if (!hasPeer) return;
         if (remote.sin6_family != AF_INET6 || remote.sin6_port == 0) return;
@@ -1307,6 +1567,7 @@ struct UdpNetplay {
     }
 
     void sendLocal(uint16_t localMask) noexcept {
+        SNESONLINE_PROFILE_SCOPE("ios.netplay.sendLocal");
         if (sock < 0) return;
 
         // Host auto-discovery: don't send inputs until we know where to send them.
@@ -1318,6 +1579,21 @@ struct UdpNetplay {
         sentFrameTag[idx] = sendFrame;
         sentMask[idx] = localMask;
 
+        if (inputNegotiator.sendV2()) {
+            // Oldest-first contiguous run of scheduled frames ending at sendFrame.
+            uint16_t masks[kResendWindow + 1];
+            uint32_t count = 0;
+            while (count < kResendWindow + 1 && count <= sendFrame && sentFrameTag[(sendFrame - count) % kBufN] == sendFrame - count) ++count;
+            for (uint32_t i = 0; i < count; ++i) masks[i] = sentMask[(sendFrame - count + 1 + i) % kBufN];
+
+            uint8_t pkt[kInputWindowHeaderBytes + snesonline::kMaxInputWindowBytes];
+            write_u32_be_(pkt, kMagicInputWindow);
+            write_u16_be_(pkt + 4, requireSecret ? secret16 : 0);
+            const size_t len = snesonline::encodeInputWindow(sendFrame, masks, count, pkt + kInputWindowHeaderBytes, sizeof(pkt) - kInputWindowHeaderBytes);
+            if (len != 0) sendto(sock, pkt, kInputWindowHeaderBytes + len, 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
+        }
+        if (!inputNegotiator.sendV1()) return;
+
         const uint32_t start = (sendFrame > kResendWindow) ? (sendFrame - kResendWindow) : 0;
         for (uint32_t f = start; f <= sendFrame; ++f) {
             const uint32_t fi = f % kBufN;
@@ -1332,6 +1608,19 @@ struct UdpNetplay {
         }
     }
 
+    // Blocks until a datagram is pending or `deadline` passes. Returns true if readable.
+    bool waitForDatagramUntil(std::chrono::steady_clock::time_point deadline) const noexcept {
+        if (sock < 0) return false;
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) return false;
+        // poll() takes whole milliseconds; round up so we do not spin just short of the deadline.
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now).count();
+        pollfd pfd{};
+        pfd.fd = sock;
+        pfd.events = POLLIN;
+        return ::poll(&pfd, 1, static_cast<int>((us + 999) / 1000)) > 0 && (pfd.revents & POLLIN);
+    }
+
     bool tryGetInputsForCurrentFrame(uint16_t& outLocalMask, uint16_t& outRemoteMask) noexcept {
         const uint32_t need = frame;
         const uint32_t idx = need % kBufN;
@@ -1347,120 +1636,67 @@ std::unique_ptr<UdpNetplay> g_netplay;
 std::atomic<bool> g_netplayEnabled{false};
 std::atomic<int> g_netplayStatus{0};
 
-// --- Video buffer (RGBA8888 stored in uint32 as 0xAARRGGBB) ---
-static constexpr int kMaxW = 512;
-static constexpr int kMaxH = 512;
-alignas(64) static uint32_t g_rgba[kMaxW * kMaxH];
-static std::atomic<int> g_videoW{0};
-static std::atomic<int> g_videoH{0};
-
-static inline uint32_t toRGBA_fromXRGB8888(uint32_t xrgb) noexcept {
-    const uint32_t r = (xrgb >> 8) & 0xFF;
-    const uint32_t g = (xrgb >> 16) & 0xFF;
-    const uint32_t b = (xrgb >> 24) & 0xFF;
-    return 0xFF000000u | (r << 16) | (g << 8) | b;
-}
-
-static inline uint32_t toRGBA_fromRGB565(uint16_t p) noexcept {
-    const uint32_t r = (p >> 11) & 0x1F;
-    const uint32_t g = (p >> 5) & 0x3F;
-    const uint32_t b = (p >> 0) & 0x1F;
-    const uint32_t rr = (r << 3) | (r >> 2);
-    const uint32_t gg = (g << 2) | (g >> 4);
-    const uint32_t bb = (b << 3) | (b >> 2);
-    return 0xFF000000u | (rr << 16) | (gg << 8) | bb;
-}
-
-static inline uint32_t toRGBA_from0RGB1555(uint16_t p) noexcept {
-    const uint32_t r = (p >> 10) & 0x1F;
-    const uint32_t g = (p >> 5) & 0x1F;
-    const uint32_t b = (p >> 0) & 0x1F;
-    const uint32_t rr = (r << 3) | (r >> 2);
-    const uint32_t gg = (g << 3) | (g >> 2);
-    const uint32_t bb = (b << 3) | (b >> 2);
-    return 0xFF000000u | (rr << 16) | (gg << 8) | bb;
-}
+// --- Video frames (ARGB8888 stored in uint32 as 0xAARRGGBB, 512-pixel rows) ---
+// Producer: videoSink (emulation loop). Consumer: snesonline_ios_acquire_video_frame (display link).
+static snesonline::FrameExchange g_video;
 
 static void videoSink(void* /*ctx*/, const void* data, unsigned width, unsigned height, std::size_t pitchBytes) noexcept {
+    SNESONLINE_PROFILE_SCOPE("ios.videoSink");
     if (!data || width == 0 || height == 0) return;
-    if (width > static_cast<unsigned>(kMaxW) || height > static_cast<unsigned>(kMaxH)) return;
+    if (width > snesonline::FrameExchange::kMaxWidth || height > snesonline::FrameExchange::kMaxHeight) return;
 
     const auto fmt = snesonline::EmulatorEngine::instance().core().pixelFormat();
-
-    if (fmt == snesonline::LibretroCore::PixelFormat::XRGB8888) {
-        const auto* src = static_cast<const uint8_t*>(data);
-        for (unsigned y = 0; y < height; ++y) {
-            const uint32_t* row = reinterpret_cast<const uint32_t*>(src + y * pitchBytes);
-            uint32_t* dst = &g_rgba[y * kMaxW];
-            for (unsigned x = 0; x < width; ++x) dst[x] = toRGBA_fromXRGB8888(row[x]);
-        }
-    } else if (fmt == snesonline::LibretroCore::PixelFormat::RGB565) {
-        const auto* src = static_cast<const uint8_t*>(data);
-        for (unsigned y = 0; y < height; ++y) {
-            const uint16_t* row = reinterpret_cast<const uint16_t*>(src + y * pitchBytes);
-            uint32_t* dst = &g_rgba[y * kMaxW];
-            for (unsigned x = 0; x < width; ++x) dst[x] = toRGBA_fromRGB565(row[x]);
-        }
-    } else {
-        const auto* src = static_cast<const uint8_t*>(data);
-        for (unsigned y = 0; y < height; ++y) {
-            const uint16_t* row = reinterpret_cast<const uint16_t*>(src + y * pitchBytes);
-            uint32_t* dst = &g_rgba[y * kMaxW];
-            for (unsigned x = 0; x < width; ++x) dst[x] = toRGBA_from0RGB1555(row[x]);
-        }
+    if (!snesonline::convertPixels(fmt, snesonline::DstPixelFormat::ARGB8888, data, pitchBytes, g_video.backBuffer(),
+                                   snesonline::FrameExchange::kStrideBytes, width, height)) {
+        return;
     }
-
-    g_videoW.store(static_cast<int>(width), std::memory_order_relaxed);
-    g_videoH.store(static_cast<int>(height), std::memory_order_relaxed);
+    g_video.publish(width, height);
 }
 
 // --- Audio ring buffer (stereo S16) ---
-static constexpr uint32_t kAudioCapacityFrames = 48000;
-alignas(64) static int16_t g_audio[kAudioCapacityFrames * 2];
-static std::atomic<uint32_t> g_audioW{0};
-static std::atomic<uint32_t> g_audioR{0};
+// Producer: audioSink (emulation loop). Consumer: snesonline_ios_pop_audio (audio render thread).
+static snesonline::AudioRing g_audio;
 
 static std::size_t audioSink(void* /*ctx*/, const int16_t* stereoFrames, std::size_t frameCount) noexcept {
-    if (!stereoFrames || frameCount == 0) return frameCount;
-    uint32_t w = g_audioW.load(std::memory_order_relaxed);
-    uint32_t r = g_audioR.load(std::memory_order_acquire);
-    uint32_t used = w - r;
-    if (used > kAudioCapacityFrames) used = kAudioCapacityFrames;
-    uint32_t freeFrames = kAudioCapacityFrames - used;
-
-    uint32_t frames = static_cast<uint32_t>(frameCount);
-    if (frames > freeFrames) {
-        const uint32_t drop = frames - freeFrames;
-        g_audioR.store(r + drop, std::memory_order_release);
-    }
-
-    w = g_audioW.load(std::memory_order_relaxed);
-    for (uint32_t i = 0; i < frames; ++i) {
-        const uint32_t idx = (w + i) % kAudioCapacityFrames;
-        g_audio[idx * 2 + 0] = stereoFrames[i * 2 + 0];
-        g_audio[idx * 2 + 1] = stereoFrames[i * 2 + 1];
-    }
-    g_audioW.store(w + frames, std::memory_order_release);
+    SNESONLINE_PROFILE_SCOPE("ios.audioSink");
+    (void)g_audio.push(stereoFrames, static_cast<uint32_t>(frameCount));
     return frameCount;
 }
 
-void loop60fps() {
+// Frame pacing at the core's rate; its stats() are the loop timing diagnostics.
+static snesonline::FrameScheduler g_pacer;
+
+void frameLoop() {
     using clock = std::chrono::steady_clock;
-    constexpr auto frameDur = std::chrono::microseconds(16667);
+    snesonline::Profiler::setThreadName("emulation");
 
     // Best-effort: prioritize emulation/audio production.
     (void)setpriority(PRIO_PROCESS, 0, -10);
 
-    auto next = clock::now();
+    const auto& core = snesonline::EmulatorEngine::instance().core();
+    snesonline::FrameScheduler::Config pace;
+    pace.framesPerSecond = core.framesPerSecond();
+    pace.maxCatchUpFrames = 60;
+    // Shorter spin than desktop: every microsecond spun is battery.
+    pace.spinMicros = 500;
+    g_pacer.configure(pace);
+    // With a few frames of audio already queued, a backlog is dropped instead of fast-forwarded:
+    // the extra frames would only add audio latency.
+    constexpr double kAudioTargetFrames = 4.0;
+    const uint32_t audioTarget = static_cast<uint32_t>(core.sampleRateHz() * kAudioTargetFrames / g_pacer.framesPerSecond());
+
+    clock::time_point stallStart{};
     while (g_running.load(std::memory_order_relaxed)) {
         const uint16_t localMask = g_inputMask.load(std::memory_order_relaxed);
         const bool paused = g_paused.load(std::memory_order_relaxed);
 
-        constexpr int kMaxCatchUpFrames = 60;
-        int steps = 0;
-        auto now = clock::now();
-        while (now >= next && steps < kMaxCatchUpFrames) {
-            next += frameDur;
+        g_pacer.setAudioLevel(g_audio.bufferedFrames(), audioTarget);
+        const uint32_t due = g_pacer.due(clock::now());
+        for (uint32_t step = 0; step < due; ++step) {
+            // The slot is used up even if the frame cannot run (paused, waiting for the peer).
+            g_pacer.advance();
+            // Only the newest frame of a catch-up burst is shown; the ones before it still feed audio.
+            const auto frameOutput = (step + 1 == due) ? snesonline::FrameOutput::Present : snesonline::FrameOutput::AudioOnly;
 
             maybeFlushSaveRam_(false);
 
@@ -1487,7 +1723,7 @@ void loop60fps() {
                     void* mem = core.memoryData(kRetroMemorySaveRam_);
                     const std::size_t memSize = core.memorySize(kRetroMemorySaveRam_);
                     if (mem && memSize > 0) {
-                        const uint32_t crc = crc32_(mem, memSize);
+                        const uint32_t crc = snesonline::crc32(mem, memSize);
                         static uint32_t lastSentCrc = 0;
                         static auto lastSentAt = clock::time_point{};
                         const auto now2 = clock::now();
@@ -1520,8 +1756,30 @@ void loop60fps() {
                 uint16_t localForFrame = 0;
                 uint16_t remoteForFrame = 0;
                 if (!g_netplay->tryGetInputsForCurrentFrame(localForFrame, remoteForFrame)) {
-                    g_netplayStatus.store(2, std::memory_order_relaxed);
-                    break;
+                    // Wait on the socket until the next frame slot is due instead of sleeping through
+                    // it, so the frame runs the moment its input lands.
+                    if (stallStart.time_since_epoch().count() == 0) stallStart = clock::now();
+                    SNESONLINE_PROFILE_SCOPE("ios.netplay.waitForInput");
+                    bool ready = false;
+                    while (!ready && g_running.load(std::memory_order_relaxed) && g_netplay->waitForDatagramUntil(g_pacer.nextDeadline())) {
+                        g_netplay->pumpRecv();
+                        ready = g_netplay->tryGetInputsForCurrentFrame(localForFrame, remoteForFrame);
+                    }
+                    if (!ready) {
+                        g_netplayStatus.store(2, std::memory_order_relaxed);
+                        break;
+                    }
+                }
+
+                if (stallStart.time_since_epoch().count() != 0) {
+                    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - stallStart).count();
+                    const uint64_t stallUs = (us > 0) ? static_cast<uint64_t>(us) : 0u;
+                    stallStart = {};
+                    g_netplayStallEventsTotal.fetch_add(1, std::memory_order_relaxed);
+                    g_netplayStallMicrosTotal.fetch_add(stallUs, std::memory_order_relaxed);
+                    if (stallUs > g_netplayStallMicrosMax.load(std::memory_order_relaxed)) {
+                        g_netplayStallMicrosMax.store(stallUs, std::memory_order_relaxed);
+                    }
                 }
 
                 g_netplayStatus.store(3, std::memory_order_relaxed);
@@ -1529,7 +1787,7 @@ void loop60fps() {
                 const bool localIsP1 = (g_netplay->localPlayerNum == 1);
                 snesonline::EmulatorEngine::instance().setInputMask(0, localIsP1 ? localForFrame : remoteForFrame);
                 snesonline::EmulatorEngine::instance().setInputMask(1, localIsP1 ? remoteForFrame : localForFrame);
-                snesonline::EmulatorEngine::instance().advanceFrame();
+                snesonline::EmulatorEngine::instance().advanceFrame(frameOutput);
                 g_netplay->frame++;
 
                 const uint32_t completedFrame = g_netplay->frame - 1;
@@ -1539,15 +1797,13 @@ void loop60fps() {
                 g_netplayStatus.store(0, std::memory_order_relaxed);
                 if (paused) break;
                 snesonline::EmulatorEngine::instance().setLocalInputMask(localMask);
-                snesonline::EmulatorEngine::instance().advanceFrame();
+                snesonline::EmulatorEngine::instance().advanceFrame(frameOutput);
             }
 
-            steps++;
-            now = clock::now();
             if (paused) break;
         }
 
-        std::this_thread::sleep_until(next);
+        g_pacer.waitForNext();
     }
 }
 
@@ -1557,6 +1813,12 @@ int snesonline_ios_get_netplay_status(void) {
     return g_netplayStatus.load(std::memory_order_relaxed);
 }
 
+void snesonline_ios_get_netplay_stall_stats(uint64_t* outStalls, uint64_t* outTotalMicros, uint64_t* outMaxMicros) {
+    if (outStalls) *outStalls = g_netplayStallEventsTotal.load(std::memory_order_relaxed);
+    if (outTotalMicros) *outTotalMicros = g_netplayStallMicrosTotal.load(std::memory_order_relaxed);
+    if (outMaxMicros) *outMaxMicros = g_netplayStallMicrosMax.load(std::memory_order_relaxed);
+}
+
 bool snesonline_ios_initialize(const char* corePath,
                               const char* romPath,
                               const char* statePath,
@@ -1613,7 +1875,7 @@ bool snesonline_ios_initialize(const char* corePath,
     {
         void* mem = eng.core().memoryData(kRetroMemorySaveRam_);
         const std::size_t memSize = eng.core().memorySize(kRetroMemorySaveRam_);
-        g_saveRamLastCrc = (mem && memSize) ? crc32_(mem, memSize) : 0;
+        g_saveRamLastCrc = (mem && memSize) ? snesonline::crc32(mem, memSize) : 0;
         g_saveRamLastCheck = {};
         g_saveRamLastFlush = {};
     }
@@ -1683,7 +1945,7 @@ void snesonline_ios_shutdown(void) {
 
 void snesonline_ios_start_loop(void) {
     if (g_running.exchange(true, std::memory_order_relaxed)) return;
-    g_loopThread = std::thread(loop60fps);
+    g_loopThread = std::thread(frameLoop);
 }
 
 void snesonline_ios_stop_loop(void) {
@@ -1699,6 +1961,19 @@ void snesonline_ios_set_paused(bool paused) {
     g_paused.store(paused, std::memory_order_relaxed);
 }
 
+bool snesonline_ios_dump_profile(const char* tracePath) {
+    if (!tracePath || !tracePath[0]) return false;
+    bool ok = snesonline::Profiler::writeChromeTrace(tracePath);
+    const std::string summaryPath = std::string(tracePath) + ".txt";
+    if (std::FILE* f = std::fopen(summaryPath.c_str(), "wb")) {
+        ok = snesonline::Profiler::writeSummary(f) && ok;
+        ok = (std::fclose(f) == 0) && ok;
+    } else {
+        ok = false;
+    }
+    return ok;
+}
+
 bool snesonline_ios_save_state_to_file(const char* statePath) {
     if (!statePath || !statePath[0]) return false;
     snesonline::SaveState st;
@@ -1753,16 +2028,12 @@ const char* snesonline_ios_stun_mapped_address(int localPort) {
     return s.c_str();
 }
 
-int snesonline_ios_get_video_width(void) {
-    return g_videoW.load(std::memory_order_relaxed);
-}
-
-int snesonline_ios_get_video_height(void) {
-    return g_videoH.load(std::memory_order_relaxed);
-}
-
-const uint32_t* snesonline_ios_get_video_buffer_rgba(void) {
-    return g_rgba;
+const uint32_t* snesonline_ios_acquire_video_frame(int* outWidth, int* outHeight, uint32_t* outSeq) {
+    const snesonline::FrameExchange::Frame f = g_video.acquire();
+    if (outWidth) *outWidth = static_cast<int>(f.width);
+    if (outHeight) *outHeight = static_cast<int>(f.height);
+    if (outSeq) *outSeq = f.seq;
+    return f.seq != 0 ? f.pixels : nullptr;
 }
 
 int snesonline_ios_get_audio_sample_rate_hz(void) {
@@ -1774,21 +2045,16 @@ int snesonline_ios_get_audio_sample_rate_hz(void) {
 
 int snesonline_ios_pop_audio(int16_t* dstInterleavedStereo, int framesWanted) {
     if (!dstInterleavedStereo || framesWanted <= 0) return 0;
+    return (int)g_audio.pop(dstInterleavedStereo, (uint32_t)framesWanted);
+}
 
-    uint32_t r = g_audioR.load(std::memory_order_relaxed);
-    uint32_t w = g_audioW.load(std::memory_order_acquire);
-    uint32_t avail = w - r;
-    if (avail > kAudioCapacityFrames) avail = kAudioCapacityFrames;
-
-    uint32_t frames = (uint32_t)framesWanted;
-    if (frames > avail) frames = avail;
-
-    for (uint32_t i = 0; i < frames; ++i) {
-        const uint32_t idx = (r + i) % kAudioCapacityFrames;
-        dstInterleavedStereo[i * 2 + 0] = g_audio[idx * 2 + 0];
-        dstInterleavedStereo[i * 2 + 1] = g_audio[idx * 2 + 1];
+void snesonline_ios_get_audio_stats(uint64_t* outDroppedFrames, uint64_t* outUnderflowFrames, uint64_t* outFillHistogram, uint32_t* outBucketFrames) {
+    snesonline::AudioRing::Stats st;
+    g_audio.stats(st);
+    if (outDroppedFrames) *outDroppedFrames = st.droppedFrames();
+    if (outUnderflowFrames) *outUnderflowFrames = st.underflowFrames;
+    if (outFillHistogram) {
+        for (uint32_t i = 0; i < snesonline::AudioRing::kHistogramBuckets; ++i) outFillHistogram[i] = st.fillHistogram[i];
     }
-
-    g_audioR.store(r + frames, std::memory_order_release);
-    return (int)frames;
+    if (outBucketFrames) *outBucketFrames = st.histogramBucketFrames;
 }
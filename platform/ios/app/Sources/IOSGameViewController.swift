@@ -42,6 +42,7 @@ final class IOSGameViewController: UIViewController {
     private var overlay: OnscreenControlsOverlay?
 
     private var noVideoTicks: Int = 0
+    private var lastVideoSeq: UInt32 = 0
 
     init(config: IOSGameConfig) {
         self.config = config
@@ -335,9 +336,7 @@ final class IOSGameViewController: UIViewController {
         pushInput()
 
         // Render.
-        let w = NativeBridgeIOS.videoWidth()
-        let h = NativeBridgeIOS.videoHeight()
-        guard w > 0, h > 0, let ptr = NativeBridgeIOS.videoBufferRGBA() else {
+        guard let frame = NativeBridgeIOS.acquireVideoFrame() else {
             // When netplay is waiting (peer/inputs/state sync), the core intentionally doesn't
             // advance frames; avoid replacing the expected netplay status overlay.
             if config.enableNetplay && netplayStatus != 3 {
@@ -354,12 +353,17 @@ final class IOSGameViewController: UIViewController {
         }
         noVideoTicks = 0
 
-        // Build CGImage from 512x512 backing buffer but crop to w/h.
+        // Nothing new since the last tick: keep the current image.
+        if frame.seq == lastVideoSeq { return }
+        lastVideoSeq = frame.seq
+
+        // Copy the visible rows: the buffer goes back to the emulation thread on the next acquire,
+        // and UIKit may draw the image later than that.
         let maxW = 512
+        let w = min(frame.width, maxW)
+        let h = min(frame.height, 512)
         let bytesPerRow = maxW * 4
-        let dataSize = bytesPerRow * 512
-
-        let data = Data(bytesNoCopy: UnsafeMutableRawPointer(mutating: ptr), count: dataSize, deallocator: .none)
+        let data = Data(bytes: frame.pixels, count: bytesPerRow * h)
         guard let provider = CGDataProvider(data: data as CFData) else { return }
 
         let cs = CGColorSpaceCreateDeviceRGB()
@@ -370,20 +374,19 @@ final class IOSGameViewController: UIViewController {
             CGBitmapInfo(rawValue: CGImageAlphaInfo.noneSkipFirst.rawValue)
         ]
 
-        guard let full = CGImage(width: maxW,
-                                 height: 512,
-                                 bitsPerComponent: 8,
-                                 bitsPerPixel: 32,
-                                 bytesPerRow: bytesPerRow,
-                                 space: cs,
-                                 bitmapInfo: bitmapInfo,
-                                 provider: provider,
-                                 decode: nil,
-                                 shouldInterpolate: false,
-                                 intent: .defaultIntent) else { return }
-
-        guard let cropped = full.cropping(to: CGRect(x: 0, y: 0, width: min(w, maxW), height: min(h, 512))) else { return }
-        imageView.image = UIImage(cgImage: cropped)
+        guard let image = CGImage(width: w,
+                                  height: h,
+                                  bitsPerComponent: 8,
+                                  bitsPerPixel: 32,
+                                  bytesPerRow: bytesPerRow,
+                                  space: cs,
+                                  bitmapInfo: bitmapInfo,
+                                  provider: provider,
+                                  decode: nil,
+                                  shouldInterpolate: false,
+                                  intent: .defaultIntent) else { return }
+
+        imageView.image = UIImage(cgImage: image)
     }
 
     override func viewWillDisappear(_ animated: Bool) {
@@ -90,11 +90,20 @@ final class NativeBridgeIOS {
         return Int(snesonline_ios_get_netplay_status())
     }
 
-    static func videoWidth() -> Int { Int(snesonline_ios_get_video_width()) }
-    static func videoHeight() -> Int { Int(snesonline_ios_get_video_height()) }
+    struct VideoFrame {
+        let pixels: UnsafePointer<UInt32> // rows of 512 pixels
+        let width: Int
+        let height: Int
+        let seq: UInt32
+    }
 
-    static func videoBufferRGBA() -> UnsafePointer<UInt32>? {
-        return snesonline_ios_get_video_buffer_rgba()
+    // Newest frame (or the previous one again, same seq); the pixels stay valid until the next call.
+    static func acquireVideoFrame() -> VideoFrame? {
+        var w: Int32 = 0
+        var h: Int32 = 0
+        var seq: UInt32 = 0
+        guard let ptr = snesonline_ios_acquire_video_frame(&w, &h, &seq), w > 0, h > 0 else { return nil }
+        return VideoFrame(pixels: ptr, width: Int(w), height: Int(h), seq: seq)
     }
 
     static func audioSampleRateHz() -> Int {
@@ -15,6 +15,7 @@
 #include <ws2tcpip.h>
 #endif
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cstdint>
@@ -27,11 +28,18 @@
 #include <vector>
 
 #include "snesonline/AppConfig.h"
+#include "snesonline/AudioResampler.h"
+#include "snesonline/AudioRing.h"
 #include "snesonline/EmulatorEngine.h"
+#include "snesonline/FrameScheduler.h"
 #include "snesonline/InputBits.h"
 #include "snesonline/InputMapping.h"
 #include "snesonline/LockstepSession.h"
 #include "snesonline/NetplaySession.h"
+#include "snesonline/NetplayStats.h"
+#include "snesonline/PixelConvert.h"
+#include "snesonline/Profiler.h"
+#include "snesonline/RollbackSession.h"
 #include "snesonline/StunClient.h"
 
 #include "ConfigDialog.h"
@@ -49,6 +57,35 @@ static std::string lockstepDebugLogPath() {
 #endif
 }
 
+// Window-title status: " [label rx=... f=... delay=... rtt=avg/p99ms ... ok]".
+static void formatNetplayTitle(char* out, std::size_t cap, const char* label, const snesonline::NetplayStats& s, bool rollback) {
+    std::size_t n = 0;
+    auto put = [&](const char* fmt, auto... args) {
+        if (n >= cap) return;
+        const int w = std::snprintf(out + n, cap - n, fmt, args...);
+        if (w > 0) n += static_cast<std::size_t>(w);
+    };
+    put(" [%s", label);
+    if (s.packetsReceived > 0) {
+        put(" rx=%llu", static_cast<unsigned long long>(s.packetsReceived));
+        if (s.lastRecvAgeMs >= 0) put(" last=%lldms", static_cast<long long>(s.lastRecvAgeMs));
+    }
+    put(" f=%u", s.localFrame);
+    if (s.remoteFrame > 0) put(" rf=%u", s.remoteFrame);
+    put(" delay=%u", s.inputDelayFrames);
+    if (s.rttSamples > 0) put(" rtt=%u/%ums jit=%ums", s.rttAvgMicros / 1000u, s.rttP99Micros / 1000u, s.jitterMicros / 1000u);
+    if (s.lossPercent > 0.0f) put(" loss=%.1f%%", static_cast<double>(s.lossPercent));
+    if (s.outOfOrderPackets > 0) put(" ooo=%llu", static_cast<unsigned long long>(s.outOfOrderPackets));
+    if (s.stallCount > 0) {
+        put(" stalls=%llu max=%ums", static_cast<unsigned long long>(s.stallCount), s.maxStallMicros / 1000u);
+    }
+    if (rollback) put(" lead=%d rb=%llu max=%u", s.frameLead, static_cast<unsigned long long>(s.rollbackCount), s.maxRollbackDepth);
+    if (s.bytesSentPerSecond > 0 || s.bytesReceivedPerSecond > 0) {
+        put(" up=%.1f down=%.1fKB/s", s.bytesSentPerSecond / 1024.0, s.bytesReceivedPerSecond / 1024.0);
+    }
+    put("%s]", s.waitingForPeer ? " wait" : (s.connected ? " ok" : ""));
+}
+
 #if defined(_WIN32)
 static void showMessageBox(const char* title, const char* text, unsigned flags = 0) {
     MessageBoxA(nullptr, text ? text : "", title ? title : "snes-online", MB_OK | flags);
@@ -769,84 +806,30 @@ static bool roomConnectAtStart(const snesonline::AppConfig& cfg, uint16_t localP
 }
 #endif
 
-struct AudioRing {
-    static constexpr uint32_t kCapacityFrames = 48000 * 2; // ~2s @48k
-    alignas(64) int16_t samples[kCapacityFrames * 2]; // interleaved stereo
-    std::atomic<uint32_t> writeFrame{0};
-    std::atomic<uint32_t> readFrame{0};
-    std::atomic<uint32_t> maxBufferedFrames{kCapacityFrames / 4}; // ~500ms @48k by default
-
-    void setMaxBufferedFrames(uint32_t frames) noexcept {
-        if (frames < 256) frames = 256;
-        if (frames > kCapacityFrames) frames = kCapacityFrames;
-        maxBufferedFrames.store(frames, std::memory_order_relaxed);
-    }
-
-    void push(const int16_t* stereoFrames, uint32_t frameCount) noexcept {
-        // Drop-on-overflow policy.
-        uint32_t w = writeFrame.load(std::memory_order_relaxed);
-        uint32_t r = readFrame.load(std::memory_order_acquire);
-        uint32_t used = w - r;
-        uint32_t freeFrames = kCapacityFrames - (used > kCapacityFrames ? kCapacityFrames : used);
-        if (frameCount > freeFrames) {
-            // Drop oldest by advancing read pointer.
-            uint32_t drop = frameCount - freeFrames;
-            readFrame.store(r + drop, std::memory_order_release);
-        }
-
-        w = writeFrame.load(std::memory_order_relaxed);
-        for (uint32_t i = 0; i < frameCount; ++i) {
-            const uint32_t idx = (w + i) % kCapacityFrames;
-            samples[idx * 2 + 0] = stereoFrames[i * 2 + 0];
-            samples[idx * 2 + 1] = stereoFrames[i * 2 + 1];
-        }
-        const uint32_t newW = w + frameCount;
-        writeFrame.store(newW, std::memory_order_release);
-
-        // Clamp buffered audio to avoid latency drifting upward over time.
-        // If we get ahead, drop the oldest samples so A/V stays tight.
-        const uint32_t maxFrames = maxBufferedFrames.load(std::memory_order_relaxed);
-        if (maxFrames > 0) {
-            const uint32_t curR = readFrame.load(std::memory_order_acquire);
-            uint32_t usedNow = newW - curR;
-            if (usedNow > kCapacityFrames) usedNow = kCapacityFrames;
-            if (usedNow > maxFrames) {
-                const uint32_t drop = usedNow - maxFrames;
-                readFrame.store(curR + drop, std::memory_order_release);
-            }
-        }
-    }
+// Producer: audioSink (frame loop). Consumer: sdlAudioCallback (SDL audio thread).
+static snesonline::AudioRing g_audio;
 
-    uint32_t pop(int16_t* outStereoFrames, uint32_t frameCount) noexcept {
-        uint32_t r = readFrame.load(std::memory_order_relaxed);
-        uint32_t w = writeFrame.load(std::memory_order_acquire);
-        uint32_t avail = w - r;
-        if (avail > kCapacityFrames) avail = kCapacityFrames;
-        const uint32_t n = (frameCount < avail) ? frameCount : avail;
-
-        for (uint32_t i = 0; i < n; ++i) {
-            const uint32_t idx = (r + i) % kCapacityFrames;
-            outStereoFrames[i * 2 + 0] = samples[idx * 2 + 0];
-            outStereoFrames[i * 2 + 1] = samples[idx * 2 + 1];
-        }
+// Core rate -> device rate. The ratio follows the ring's fill, so buffered audio stays near
+// g_audioTargetFrames without dropping samples; the ring's own clamp is only a safety net.
+static constexpr std::size_t kAudioChunkFrames = 1024;
+static snesonline::AudioResampler g_resampler;
+static std::vector<int16_t> g_resampled;
+static uint32_t g_audioTargetFrames = 0;
 
-        readFrame.store(r + n, std::memory_order_release);
-        return n;
+static std::size_t audioSink(void* /*ctx*/, const int16_t* stereoFrames, std::size_t frameCount) noexcept {
+    SNESONLINE_PROFILE_SCOPE("windows.audioSink");
+    if (!stereoFrames) return frameCount;
+    if (g_resampled.empty()) {
+        g_audio.push(stereoFrames, static_cast<uint32_t>(frameCount));
+        return frameCount;
     }
-
-    uint32_t bufferedFrames() const noexcept {
-        const uint32_t r = readFrame.load(std::memory_order_relaxed);
-        const uint32_t w = writeFrame.load(std::memory_order_acquire);
-        uint32_t avail = w - r;
-        if (avail > kCapacityFrames) avail = kCapacityFrames;
-        return avail;
+    for (std::size_t done = 0; done < frameCount;) {
+        const std::size_t n = std::min(frameCount - done, kAudioChunkFrames);
+        g_resampler.updateFill(g_audio.bufferedFrames(), g_audioTargetFrames);
+        const std::size_t out = g_resampler.process(stereoFrames + done * 2, n, g_resampled.data(), g_resampled.size() / 2);
+        g_audio.push(g_resampled.data(), static_cast<uint32_t>(out));
+        done += n;
     }
-};
-
-static AudioRing g_audio;
-
-static std::size_t audioSink(void* /*ctx*/, const int16_t* stereoFrames, std::size_t frameCount) noexcept {
-    g_audio.push(stereoFrames, static_cast<uint32_t>(frameCount));
     return frameCount;
 }
 
@@ -863,11 +846,15 @@ struct VideoSinkCtx {
     SDL_Renderer* renderer = nullptr;
     SDL_Texture* texture = nullptr;
     SDL_PixelFormatEnum sdlFmt = SDL_PIXELFORMAT_ARGB8888;
+    // 16-bit core formats are converted into an ARGB8888 texture (see main()).
+    bool convert = false;
+    snesonline::LibretroCore::PixelFormat srcFmt = snesonline::LibretroCore::PixelFormat::XRGB8888;
     unsigned texW = 0;
     unsigned texH = 0;
 };
 
 static void videoSink(void* ctx, const void* data, unsigned width, unsigned height, std::size_t pitchBytes) noexcept {
+    SNESONLINE_PROFILE_SCOPE("windows.videoSink");
     auto* v = static_cast<VideoSinkCtx*>(ctx);
     if (!v || !v->renderer) return;
     if (!data) return;
@@ -883,6 +870,15 @@ static void videoSink(void* ctx, const void* data, unsigned width, unsigned heig
         SDL_SetTextureBlendMode(v->texture, SDL_BLENDMODE_NONE);
     }
 
+    if (v->convert) {
+        void* pixels = nullptr;
+        int texPitch = 0;
+        if (SDL_LockTexture(v->texture, nullptr, &pixels, &texPitch) != 0) return;
+        snesonline::convertPixels(v->srcFmt, snesonline::DstPixelFormat::ARGB8888, data, pitchBytes, pixels, static_cast<std::size_t>(texPitch), width, height);
+        SDL_UnlockTexture(v->texture);
+        return;
+    }
+
     // Update the whole texture. pitchBytes is per-row byte stride.
     SDL_UpdateTexture(v->texture, nullptr, data, static_cast<int>(pitchBytes));
 }
@@ -953,10 +949,12 @@ struct InputState {
 
 static void usage() {
     std::puts(
-    "Usage: snesonline_win --core <path_to_libretro_core.dll> --rom <path_to_rom> [--config] [--netplay] [--player <1|2>] [--remote-ip <ip>] [--remote-port <port>] [--local-port <port>]\n\n"
+    "Usage: snesonline_win --core <path_to_libretro_core.dll> --rom <path_to_rom> [--config] [--netplay] [--player <1|2>] [--remote-ip <ip>] [--remote-port <port>] [--local-port <port>] [--spectator-port <port>] [--record-replay <file>]\n\n"
         "Notes:\n"
     "  - Press F1 to open configuration while running.\n"
-    "  - Netplay requires building with -DSNESONLINE_ENABLE_GGPO=ON.\n"
+    "  - --spectator-port lets spectators watch a lockstep/rollback match over UDP on that port.\n"
+    "  - --record-replay writes the netplay match's inputs to a replay file.\n"
+    "  - Netplay uses the built-in rollback session, or GGPO when built with -DSNESONLINE_ENABLE_GGPO=ON.\n"
     "  - By default, CMake will fetch/build GGPO automatically (SNESONLINE_FETCH_GGPO=ON).\n");
 }
 
@@ -976,6 +974,8 @@ int main(int argc, char** argv) {
     const char* remoteIp = nullptr;
     uint16_t remotePort = 0;
     uint16_t localPort = 0;
+    uint16_t spectatorPort = 0;
+    const char* replayPath = nullptr;
 
     bool remoteIpSpecified = false;
     bool remotePortSpecified = false;
@@ -1008,6 +1008,15 @@ int main(int argc, char** argv) {
             localPortSpecified = true;
             continue;
         }
+        if (std::strcmp(argv[i], "--spectator-port") == 0 && i + 1 < argc) {
+            const int p = std::atoi(argv[++i]);
+            spectatorPort = static_cast<uint16_t>((p > 0 && p <= 65535) ? p : 0);
+            continue;
+        }
+        if (std::strcmp(argv[i], "--record-replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+            continue;
+        }
     }
 
     // Load config and ensure default ROMs folder exists.
@@ -1117,14 +1126,23 @@ int main(int argc, char** argv) {
 #endif
         return 1;
     }
+    eng.setRunAheadFrames(cfg.runAheadFramesFor(romPath));
 
     // Optional netplay.
     snesonline::NetplaySession netplay;
     snesonline::LockstepSession lockstep;
+    snesonline::RollbackSession rollback;
     const bool effectiveNetplay = wantNetplay || cfg.netplayEnabled;
     bool netplayStarted = false;
     std::string netplayBaseTitle;
+    auto netplayTitleNext = std::chrono::steady_clock::time_point{};
     const bool useLockstep = cfg.netplayLockstep;
+#if defined(SNESONLINE_ENABLE_GGPO)
+    const bool useNativeRollback = false;
+#else
+    // Without GGPO, rollback netplay uses the built-in RollbackSession.
+    const bool useNativeRollback = !useLockstep;
+#endif
 
     std::ofstream lockstepLog;
     auto lockstepLogLast = std::chrono::steady_clock::time_point{};
@@ -1225,6 +1243,9 @@ int main(int argc, char** argv) {
             np.remotePort = autoDiscover ? 0 : effectiveRemotePort;
             np.localPort = effectiveLocalPort;
             np.localPlayerNum = effectivePlayer;
+            np.networkThread = true;
+            np.spectatorPort = spectatorPort;
+            np.replayPath = replayPath;
 
             if (!lockstep.start(np)) {
                 std::fprintf(stderr, "Lockstep netplay failed to start.\n");
@@ -1254,6 +1275,59 @@ int main(int argc, char** argv) {
                 static_cast<unsigned>(autoDiscover ? 0 : effectiveRemotePort));
             netplayBaseTitle = std::string(title);
             SDL_SetWindowTitle(window, netplayBaseTitle.c_str());
+        } else if (useNativeRollback) {
+            // Built-in rollback (same UDP packets as lockstep).
+            if (effectivePlayer == 2 && (!effectiveIp || !effectiveIp[0] || effectiveRemotePort == 0)) {
+                std::fprintf(stderr, "Rollback netplay requires remote IP/port for Player 2.\n");
+#if defined(_WIN32)
+                showMessageBox(
+                    "snes-online",
+                    "Rollback netplay requires a Remote IP and Remote Port for Player 2.\n\n"
+                    "Use the Config dialog and either:\n"
+                    "  - Paste the connection code and click 'Join From Code', or\n"
+                    "  - Manually enter Remote IP + Remote Port.\n",
+                    MB_ICONERROR);
+#endif
+                return 2;
+            }
+
+            snesonline::RollbackSession::Config np{};
+            np.remoteHost = autoDiscover ? "" : effectiveIp;
+            np.remotePort = autoDiscover ? 0 : effectiveRemotePort;
+            np.localPort = effectiveLocalPort;
+            np.localPlayerNum = effectivePlayer;
+            if (cfg.netplayFrameDelay != 0) np.inputDelayFrames = cfg.netplayFrameDelay;
+            np.spectatorPort = spectatorPort;
+            np.replayPath = replayPath;
+
+            if (!rollback.start(np)) {
+                std::fprintf(stderr, "Rollback netplay failed to start.\n");
+#if defined(_WIN32)
+                showMessageBox(
+                    "snes-online",
+                    "Rollback netplay failed to start.\n\n"
+                    "Common causes:\n"
+                    "  - Remote IP is not a valid IPv4 address\n"
+                    "  - Local port is already in use (try a different Local Port)\n"
+                    "  - Firewall is blocking UDP\n",
+                    MB_ICONERROR);
+#endif
+                return 1;
+            }
+
+            netplayStarted = true;
+
+            char title[256] = {};
+            std::snprintf(
+                title,
+                sizeof(title),
+                "snes-online (rollback P%d %u->%s:%u)",
+                static_cast<int>(effectivePlayer),
+                static_cast<unsigned>(effectiveLocalPort),
+                autoDiscover ? "(auto)" : effectiveIp,
+                static_cast<unsigned>(autoDiscover ? 0 : effectiveRemotePort));
+            netplayBaseTitle = std::string(title);
+            SDL_SetWindowTitle(window, netplayBaseTitle.c_str());
         } else {
             // GGPO rollback.
             if (!effectiveIp || !effectiveIp[0] || effectiveRemotePort == 0) {
@@ -1305,20 +1379,12 @@ int main(int argc, char** argv) {
     VideoSinkCtx video{};
     video.renderer = renderer;
 
-    // Pick SDL texture format based on core pixel format.
-    const auto fmt = eng.core().pixelFormat();
-    switch (fmt) {
-        case snesonline::LibretroCore::PixelFormat::RGB565:
-            video.sdlFmt = SDL_PIXELFORMAT_RGB565;
-            break;
-        case snesonline::LibretroCore::PixelFormat::XRGB1555:
-            video.sdlFmt = SDL_PIXELFORMAT_XRGB1555;
-            break;
-        case snesonline::LibretroCore::PixelFormat::XRGB8888:
-        default:
-            video.sdlFmt = SDL_PIXELFORMAT_XRGB8888;
-            break;
-    }
+    // XRGB8888 frames upload as-is. Renderers without 16-bit texture formats (Direct3D) would
+    // have SDL convert those on every update, so convert them ourselves straight into the locked
+    // ARGB8888 texture instead.
+    video.srcFmt = eng.core().pixelFormat();
+    video.convert = video.srcFmt != snesonline::LibretroCore::PixelFormat::XRGB8888;
+    video.sdlFmt = video.convert ? SDL_PIXELFORMAT_ARGB8888 : SDL_PIXELFORMAT_XRGB8888;
 
     // Texture will be created on first video frame (size comes from the core).
 
@@ -1328,19 +1394,23 @@ int main(int argc, char** argv) {
     // Audio device.
     SDL_AudioSpec want{};
     SDL_AudioSpec have{};
-    want.freq = static_cast<int>(eng.core().sampleRateHz());
-    if (want.freq <= 0) want.freq = 48000;
+    // Open at the device's own rate; AudioResampler converts from the core rate.
+    want.freq = 48000;
     want.format = AUDIO_S16SYS;
     want.channels = 2;
     // Smaller buffer reduces perceived latency.
     want.samples = 512;
     want.callback = &sdlAudioCallback;
 
-    SDL_AudioDeviceID audioDev = SDL_OpenAudioDevice(nullptr, 0, &want, &have, 0);
+    SDL_AudioDeviceID audioDev = SDL_OpenAudioDevice(nullptr, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
     if (audioDev != 0) {
-        // Keep only a few callbacks worth of audio buffered.
-        const uint32_t target = (have.samples > 0) ? (static_cast<uint32_t>(have.samples) * 4u) : 2048u;
-        g_audio.setMaxBufferedFrames(target);
+        // Keep about two callbacks worth of audio buffered; drop only past six (e.g. catch-up bursts).
+        const uint32_t callbackFrames = (have.samples > 0) ? static_cast<uint32_t>(have.samples) : 512u;
+        g_audioTargetFrames = callbackFrames * 2u;
+        g_audio.setMaxBufferedFrames(callbackFrames * 6u);
+        if (g_resampler.configure(eng.core().sampleRateHz(), static_cast<double>(have.freq))) {
+            g_resampled.assign(g_resampler.maxOutputFrames(kAudioChunkFrames) * 2, 0);
+        }
         SDL_PauseAudioDevice(audioDev, 0);
     }
 
@@ -1353,14 +1423,18 @@ int main(int argc, char** argv) {
         }
     }
 
-    const double fps = eng.core().framesPerSecond();
-    const auto frameDur = std::chrono::duration<double>(1.0 / (fps > 1.0 ? fps : 60.0));
+    // One pass per frame at the core's rate. Netplay sessions pace their own frames; the loop only
+    // wakes them on the same cadence.
+    snesonline::FrameScheduler::Config pace;
+    pace.framesPerSecond = eng.core().framesPerSecond();
+    snesonline::FrameScheduler pacer(pace);
 
     bool running = true;
-    auto next = std::chrono::steady_clock::now();
 
     while (running) {
-        next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(frameDur);
+        pacer.setAudioLevel(g_audio.bufferedFrames(), g_audioTargetFrames);
+        const uint32_t due = pacer.due(std::chrono::steady_clock::now());
+        if (effectiveNetplay) pacer.advance(due);
 
         SDL_Event ev;
         while (SDL_PollEvent(&ev)) {
@@ -1380,6 +1454,14 @@ int main(int argc, char** argv) {
                         }
                         break;
                     }
+                    if (down && ev.key.keysym.sym == SDLK_F11) {
+                        // Hot-path timings (SNESONLINE_ENABLE_PROFILER builds): trace next to config.ini, summary to stderr.
+                        const std::string tracePath = cfgPath.substr(0, cfgPath.find_last_of("\\/") + 1) + "profile.json";
+                        if (snesonline::Profiler::writeChromeTrace(tracePath.c_str())) std::fprintf(stderr, "Profile trace written to: %s\n", tracePath.c_str());
+                        else std::fprintf(stderr, "Failed to write profile trace to: %s\n", tracePath.c_str());
+                        (void)snesonline::Profiler::writeSummary(stderr);
+                        break;
+                    }
                     const uint16_t bit = keyToSnes(ev.key.keysym.sym);
                     input.setBit(bit, down);
                     break;
@@ -1410,7 +1492,9 @@ int main(int argc, char** argv) {
             if (useLockstep) {
                 const uint32_t f0 = lockstep.localFrame();
                 lockstep.setLocalInput(input.mask);
-                lockstep.tick();
+                // If the frame is waiting on the peer, run it as soon as the input lands instead of
+                // giving up the whole frame slot.
+                lockstep.tickUntil(pacer.nextDeadline());
                 const uint32_t f1 = lockstep.localFrame();
                 const uint32_t advanced = (f1 >= f0) ? (f1 - f0) : 0u;
 
@@ -1445,50 +1529,42 @@ int main(int argc, char** argv) {
                         }
                     }
                 }
+            } else if (useNativeRollback) {
+                rollback.setLocalInput(input.mask);
+                rollback.tick();
             } else {
                 netplay.setLocalInput(input.mask);
                 netplay.tick();
             }
 
-            if (netplayStarted) {
-                // Non-intrusive status in the window title.
+            if (netplayStarted && std::chrono::steady_clock::now() >= netplayTitleNext) {
+                // Non-intrusive status in the window title, a few times a second.
+                netplayTitleNext = std::chrono::steady_clock::now() + std::chrono::milliseconds(250);
                 std::string desired = netplayBaseTitle.empty() ? std::string("snes-online (netplay)") : netplayBaseTitle;
+                snesonline::NetplayStats st;
+                char status[384];
+                status[0] = '\0';
                 if (useLockstep) {
+                    lockstep.stats(st);
                     const std::string peer = lockstep.peerEndpoint();
-                    const uint64_t rx = lockstep.recvCount();
-                    const int64_t ageMs = lockstep.lastRecvAgeMs();
-                    const uint32_t f = lockstep.localFrame();
-                    const uint32_t need = f + 5; // must match kInputDelayFrames in LockstepSession.cpp
-                    const uint32_t rlast = lockstep.lastRemoteFrame();
-                    const uint32_t rmax = lockstep.maxRemoteFrame();
-                    desired += " [lockstep";
-                    if (!peer.empty()) desired += " " + peer;
-                    if (rx > 0) {
-                        desired += " rx=" + std::to_string(rx);
-                        if (ageMs >= 0) desired += " last=" + std::to_string(ageMs) + "ms";
-                    } else {
-                        desired += " rx=0";
-                    }
-                    desired += " f=" + std::to_string(f);
-                    desired += " need=" + std::to_string(need);
-                    if (rx > 0) {
-                        desired += " rlast=" + std::to_string(rlast);
-                        desired += " rmax=" + std::to_string(rmax);
-                    }
-                    if (lockstep.waitingForPeer()) desired += " wait";
-                    else if (lockstep.connected()) desired += " ok";
-                    desired += "]";
-                } else {
-                    if (netplay.reconnecting()) {
-                        desired += " [reconnecting]";
-                    } else if (netplay.disconnected()) {
-                        desired += " [disconnected]";
-                    } else if (netplay.waitingForPeer()) {
-                        desired += " [waiting for peer]";
-                    } else if (netplay.hasSynchronized()) {
-                        desired += " [connected]";
-                    }
+                    const std::string label = peer.empty() ? std::string("lockstep") : "lockstep " + peer;
+                    formatNetplayTitle(status, sizeof(status), label.c_str(), st, false);
+                } else if (useNativeRollback) {
+                    rollback.stats(st);
+                    const std::string peer = rollback.peerEndpoint();
+                    const std::string label = peer.empty() ? std::string("rollback") : "rollback " + peer;
+                    formatNetplayTitle(status, sizeof(status), label.c_str(), st, true);
+                } else if (netplay.reconnecting()) {
+                    std::snprintf(status, sizeof(status), " [reconnecting]");
+                } else if (netplay.disconnected()) {
+                    std::snprintf(status, sizeof(status), " [disconnected]");
+                } else if (netplay.waitingForPeer()) {
+                    std::snprintf(status, sizeof(status), " [waiting for peer]");
+                } else if (netplay.hasSynchronized()) {
+                    netplay.stats(st);
+                    formatNetplayTitle(status, sizeof(status), "connected", st, true);
                 }
+                desired += status;
 
                 const char* cur = SDL_GetWindowTitle(window);
                 if (!cur || desired != cur) {
@@ -1497,7 +1573,11 @@ int main(int argc, char** argv) {
             }
         } else {
             eng.setLocalInputMask(input.mask);
-            eng.advanceFrame();
+            // Only the newest frame of a catch-up burst is shown.
+            for (uint32_t i = 0; i < due; ++i) {
+                eng.advanceFrame(i + 1 == due ? snesonline::FrameOutput::Present : snesonline::FrameOutput::AudioOnly);
+                pacer.advance();
+            }
         }
 
         // Render last uploaded frame (if any). If the core outputs dynamic sizes, a smarter resize path is needed.
@@ -1505,7 +1585,7 @@ int main(int argc, char** argv) {
         if (video.texture) SDL_RenderCopy(renderer, video.texture, nullptr, nullptr);
         SDL_RenderPresent(renderer);
 
-        std::this_thread::sleep_until(next);
+        pacer.waitForNext();
     }
 
     if (input.controller) SDL_GameControllerClose(input.controller);
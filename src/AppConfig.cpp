@@ -32,6 +32,14 @@ static inline bool iequals(const std::string& a, const std::string& b) {
     return true;
 }
 
+// Lower-case file name without directory, the key of AppConfig::runAheadFramesByRom.
+static std::string romKey(const std::string& romPath) {
+    const auto pos = romPath.find_last_of("\\/");
+    std::string name = trim(pos == std::string::npos ? romPath : romPath.substr(pos + 1));
+    for (char& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return name;
+}
+
 std::string getExecutableDir() {
 #if defined(_WIN32)
     char path[MAX_PATH] = {};
@@ -118,23 +126,36 @@ static uint8_t parseU8Clamped(const std::string& v, uint8_t fallback, uint8_t ma
     return static_cast<uint8_t>(n);
 }
 
+uint8_t AppConfig::runAheadFramesFor(const std::string& romPath) const {
+    const auto it = runAheadFramesByRom.find(romKey(romPath));
+    return (it != runAheadFramesByRom.end()) ? it->second : runAheadFrames;
+}
+
 bool loadConfig(const std::string& path, AppConfig& outCfg) {
     std::ifstream f(path);
     if (!f.is_open()) return false;
 
     std::string line;
+    bool runAheadSection = false;
     while (std::getline(f, line)) {
         line = trim(line);
         if (line.empty()) continue;
         if (line[0] == ';' || line[0] == '#') continue;
-        if (line.front() == '[' && line.back() == ']') continue; // ignore sections
+        if (line.front() == '[' && line.back() == ']') {
+            // Sections are cosmetic, except [runahead] whose keys are ROM file names.
+            runAheadSection = iequals(line, "[runahead]");
+            continue;
+        }
 
         const auto eq = line.find('=');
         if (eq == std::string::npos) continue;
         std::string key = trim(line.substr(0, eq));
         std::string val = trim(line.substr(eq + 1));
 
-        if (iequals(key, "netplayEnabled")) outCfg.netplayEnabled = parseBool(val, outCfg.netplayEnabled);
+        if (runAheadSection) {
+            if (iequals(key, "default")) outCfg.runAheadFrames = parseU8Clamped(val, outCfg.runAheadFrames, 8);
+            else if (!key.empty()) outCfg.runAheadFramesByRom[romKey(key)] = parseU8Clamped(val, 0, 8);
+        } else if (iequals(key, "netplayEnabled")) outCfg.netplayEnabled = parseBool(val, outCfg.netplayEnabled);
         else if (iequals(key, "netplayLockstep")) outCfg.netplayLockstep = parseBool(val, outCfg.netplayLockstep);
         else if (iequals(key, "netplayFrameDelay")) outCfg.netplayFrameDelay = parseU8Clamped(val, outCfg.netplayFrameDelay, 8);
         else if (iequals(key, "localPlayerNum")) outCfg.localPlayerNum = parsePlayerNum(val, outCfg.localPlayerNum);
@@ -174,7 +195,11 @@ bool saveConfig(const std::string& path, const AppConfig& cfg) {
     f << "roomPassword=" << cfg.roomPassword << "\n\n";
 
     f << "[paths]\n";
-    f << "romsDir=" << cfg.romsDir << "\n";
+    f << "romsDir=" << cfg.romsDir << "\n\n";
+
+    f << "[runahead]\n";
+    f << "default=" << static_cast<unsigned>(cfg.runAheadFrames) << "\n";
+    for (const auto& kv : cfg.runAheadFramesByRom) f << kv.first << "=" << static_cast<unsigned>(kv.second) << "\n";
 
     return true;
 }
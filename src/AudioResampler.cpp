@@ -0,0 +1,208 @@
+#include "snesonline/AudioResampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace snesonline {
+
+namespace {
+
+constexpr uint32_t kTaps = kAudioResamplerTaps;
+constexpr uint32_t kPhases = kAudioResamplerPhases;
+// Taps before the output position: the window for position x starts at floor(x) - kLead.
+constexpr uint32_t kLead = kTaps / 2 - 1;
+// Independent partial sums in the dot product; four floats fill an SSE/NEON register.
+constexpr uint32_t kLanes = 4;
+// Fixed-point read position: the low 32 bits are the fraction, its top 8 bits the phase.
+constexpr uint32_t kFracBits = 32;
+constexpr uint32_t kPhaseBits = 8;
+static_assert((1u << kPhaseBits) == kPhases, "phase count must match the phase bits");
+static_assert(kTaps % kLanes == 0, "taps must be a multiple of the lane count");
+
+constexpr double kPi = 3.14159265358979323846;
+// Kaiser window shape: ~60 dB stopband for a 16-tap kernel.
+constexpr double kKaiserBeta = 6.0;
+// Passband edge as a fraction of the lower Nyquist frequency.
+constexpr double kCutoff = 0.85;
+// Per-update weight of the fill error in the integral term; at ~60 updates/s it trims a constant
+// clock mismatch within a few seconds without making the loop ring.
+constexpr double kIntegralGain = 0.00002;
+
+double besselI0(double x) noexcept {
+    double sum = 1.0;
+    double term = 1.0;
+    const double q = x * x / 4.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= q / (static_cast<double>(k) * static_cast<double>(k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+int16_t toS16(float v) noexcept {
+    if (v >= 32767.0f) return 32767;
+    if (v <= -32768.0f) return -32768;
+    return static_cast<int16_t>(v + (v >= 0.0f ? 0.5f : -0.5f));
+}
+
+} // namespace
+
+bool AudioResampler::configure(double inputRateHz, double outputRateHz) noexcept {
+    coeffs_.clear();
+    slopes_.clear();
+    inputRateHz_ = inputRateHz;
+    outputRateHz_ = outputRateHz;
+    baseRatio_ = 1.0;
+    if (!(inputRateHz >= 8000.0 && inputRateHz <= 192000.0) || !(outputRateHz >= 8000.0 && outputRateHz <= 192000.0)) {
+        reset();
+        return false;
+    }
+    baseRatio_ = outputRateHz / inputRateHz;
+
+    std::vector<float> coeffs;
+    std::vector<float> slopes;
+    try {
+        coeffs.resize(static_cast<std::size_t>(kPhases + 1) * kTaps);
+        slopes.resize(static_cast<std::size_t>(kPhases + 1) * kTaps);
+        left_.assign(kTaps + kBlockFrames, 0.0f);
+        right_.assign(kTaps + kBlockFrames, 0.0f);
+    } catch (...) {
+        left_.clear();
+        right_.clear();
+        baseRatio_ = 1.0;
+        return false;
+    }
+
+    // Downsampling also has to remove what the output rate cannot represent.
+    const double cutoff = kCutoff * std::min(1.0, baseRatio_);
+    const double i0Beta = besselI0(kKaiserBeta);
+    const double halfWidth = static_cast<double>(kTaps) / 2.0;
+    for (uint32_t p = 0; p <= kPhases; ++p) {
+        const double frac = static_cast<double>(p) / static_cast<double>(kPhases);
+        float* row = &coeffs[static_cast<std::size_t>(p) * kTaps];
+        double sum = 0.0;
+        double taps[kTaps];
+        for (uint32_t k = 0; k < kTaps; ++k) {
+            const double t = static_cast<double>(k) - static_cast<double>(kLead) - frac;
+            const double x = cutoff * t;
+            const double sinc = (std::fabs(x) < 1e-9) ? 1.0 : std::sin(kPi * x) / (kPi * x);
+            const double u = t / halfWidth;
+            const double window = (u <= -1.0 || u >= 1.0) ? 0.0 : besselI0(kKaiserBeta * std::sqrt(1.0 - u * u)) / i0Beta;
+            taps[k] = sinc * window;
+            sum += taps[k];
+        }
+        // Unity gain at DC for every phase, so a fractional position never changes the volume.
+        for (uint32_t k = 0; k < kTaps; ++k) row[k] = static_cast<float>(taps[k] / sum);
+    }
+    for (uint32_t p = 0; p <= kPhases; ++p) {
+        const std::size_t row = static_cast<std::size_t>(p) * kTaps;
+        const std::size_t next = static_cast<std::size_t>(std::min(p + 1, kPhases)) * kTaps;
+        for (uint32_t k = 0; k < kTaps; ++k) slopes[row + k] = coeffs[next + k] - coeffs[row + k];
+    }
+
+    coeffs_ = std::move(coeffs);
+    slopes_ = std::move(slopes);
+    reset();
+    return true;
+}
+
+void AudioResampler::reset() noexcept {
+    std::fill(left_.begin(), left_.end(), 0.0f);
+    std::fill(right_.begin(), right_.end(), 0.0f);
+    // Start on the first real sample with silence before it.
+    buffered_ = kLead;
+    pos_ = static_cast<uint64_t>(kLead) << kFracBits;
+    adjust_ = 0.0;
+    integral_ = 0.0;
+}
+
+void AudioResampler::updateFill(uint32_t bufferedFrames, uint32_t targetFrames) noexcept {
+    if (targetFrames == 0) {
+        adjust_ = 0.0;
+        integral_ = 0.0;
+        return;
+    }
+    // Positive when the buffer runs low: produce a little more audio per input frame.
+    double err = (static_cast<double>(targetFrames) - static_cast<double>(bufferedFrames)) / static_cast<double>(targetFrames);
+    err = std::clamp(err, -1.0, 1.0);
+    integral_ = std::clamp(integral_ + err * kIntegralGain, -kAudioMaxRateAdjust, kAudioMaxRateAdjust);
+    adjust_ = std::clamp(err * kAudioMaxRateAdjust + integral_, -kAudioMaxRateAdjust, kAudioMaxRateAdjust);
+}
+
+std::size_t AudioResampler::maxOutputFrames(std::size_t inputFrames) const noexcept {
+    if (!configured()) return inputFrames;
+    const double maxRatio = baseRatio_ * (1.0 + kAudioMaxRateAdjust);
+    return static_cast<std::size_t>(std::ceil(static_cast<double>(inputFrames) * maxRatio)) + 2;
+}
+
+std::size_t AudioResampler::process(const int16_t* stereoFrames, std::size_t inputFrames, int16_t* out, std::size_t outCapacityFrames) noexcept {
+    if (!stereoFrames || !out) return 0;
+    if (!configured()) {
+        const std::size_t n = std::min(inputFrames, outCapacityFrames);
+        std::memcpy(out, stereoFrames, n * 2 * sizeof(int16_t));
+        return n;
+    }
+
+    const uint64_t step = static_cast<uint64_t>(std::llround(std::ldexp(1.0 / ratio(), kFracBits)));
+    float* const left = left_.data();
+    float* const right = right_.data();
+    const float* const coeffs = coeffs_.data();
+    const float* const slopes = slopes_.data();
+    std::size_t written = 0;
+
+    while (inputFrames > 0) {
+        const uint32_t n = static_cast<uint32_t>(std::min<std::size_t>(inputFrames, kBlockFrames));
+        for (uint32_t i = 0; i < n; ++i) {
+            left[buffered_ + i] = static_cast<float>(stereoFrames[i * 2 + 0]);
+            right[buffered_ + i] = static_cast<float>(stereoFrames[i * 2 + 1]);
+        }
+        buffered_ += n;
+        stereoFrames += static_cast<std::size_t>(n) * 2;
+        inputFrames -= n;
+
+        for (;;) {
+            const uint32_t start = static_cast<uint32_t>(pos_ >> kFracBits) - kLead;
+            if (start + kTaps > buffered_) break;
+
+            // Past the caller's capacity the position still advances, so the stream stays in time.
+            if (written < outCapacityFrames) {
+                const uint32_t frac = static_cast<uint32_t>(pos_);
+                const uint32_t p = frac >> (kFracBits - kPhaseBits);
+                const float mix = static_cast<float>(frac & ((1u << (kFracBits - kPhaseBits)) - 1u)) * (1.0f / (1u << (kFracBits - kPhaseBits)));
+                const float* c = coeffs + static_cast<std::size_t>(p) * kTaps;
+                const float* d = slopes + static_cast<std::size_t>(p) * kTaps;
+                const float* xl = left + start;
+                const float* xr = right + start;
+
+                float accL[kLanes] = {};
+                float accR[kLanes] = {};
+                for (uint32_t k = 0; k < kTaps; k += kLanes) {
+                    for (uint32_t j = 0; j < kLanes; ++j) {
+                        const float w = c[k + j] + mix * d[k + j];
+                        accL[j] += xl[k + j] * w;
+                        accR[j] += xr[k + j] * w;
+                    }
+                }
+                out[written * 2 + 0] = toS16((accL[0] + accL[1]) + (accL[2] + accL[3]));
+                out[written * 2 + 1] = toS16((accR[0] + accR[1]) + (accR[2] + accR[3]));
+                ++written;
+            }
+            pos_ += step;
+        }
+
+        // Keep only the history the next window needs.
+        const uint32_t next = static_cast<uint32_t>(pos_ >> kFracBits) - kLead;
+        const uint32_t drop = std::min(next, buffered_);
+        if (drop > 0) {
+            std::memmove(left, left + drop, (buffered_ - drop) * sizeof(float));
+            std::memmove(right, right + drop, (buffered_ - drop) * sizeof(float));
+            buffered_ -= drop;
+            pos_ -= static_cast<uint64_t>(drop) << kFracBits;
+        }
+    }
+    return written;
+}
+
+} // namespace snesonline
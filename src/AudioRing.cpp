@@ -0,0 +1,93 @@
+#include "snesonline/AudioRing.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace snesonline {
+
+uint32_t AudioRing::push(const int16_t* stereoFrames, uint32_t frameCount) noexcept {
+    if (!stereoFrames || frameCount == 0) return 0;
+    const uint32_t w = write_.load(std::memory_order_relaxed);
+    uint32_t freeFrames = kCapacityFrames - (w - readCache_);
+    if (freeFrames < frameCount) {
+        readCache_ = read_.load(std::memory_order_acquire);
+        freeFrames = kCapacityFrames - (w - readCache_);
+    }
+    const uint32_t n = std::min(frameCount, freeFrames);
+    if (n < frameCount) add_(overflow_, frameCount - n);
+    if (n == 0) return 0;
+
+    const uint32_t idx = w & kMask;
+    const uint32_t first = std::min(n, kCapacityFrames - idx);
+    std::memcpy(&samples_[idx * 2], stereoFrames, static_cast<std::size_t>(first) * 2 * sizeof(int16_t));
+    std::memcpy(&samples_[0], stereoFrames + static_cast<std::size_t>(first) * 2, static_cast<std::size_t>(n - first) * 2 * sizeof(int16_t));
+    write_.store(w + n, std::memory_order_release);
+    add_(pushed_, n);
+    return n;
+}
+
+uint32_t AudioRing::pop(int16_t* outStereoFrames, uint32_t frameCount) noexcept {
+    uint32_t r = read_.load(std::memory_order_relaxed);
+    const uint32_t w = write_.load(std::memory_order_acquire);
+    uint32_t avail = w - r;
+
+    if (flush_.load(std::memory_order_relaxed) && flush_.exchange(false, std::memory_order_acq_rel)) {
+        add_(trimmed_, avail);
+        r = w;
+        avail = 0;
+    }
+
+    const uint32_t maxFrames = maxBuffered_.load(std::memory_order_relaxed);
+    if (maxFrames > 0 && avail > maxFrames) {
+        uint32_t drop = avail - maxFrames;
+        // Far beyond the cap, catch up at once instead of a long run of small audible skips.
+        const uint32_t maxDrop = maxDropPerPop_.load(std::memory_order_relaxed);
+        if (maxDrop > 0 && drop > maxDrop && avail <= maxFrames * 2) drop = maxDrop;
+        add_(trimmed_, drop);
+        r += drop;
+        avail -= drop;
+    }
+
+    const uint32_t bucketFrames = bucketFrames_.load(std::memory_order_relaxed);
+    add_(histogram_[std::min(avail / bucketFrames, kHistogramBuckets - 1)], 1);
+
+    const uint32_t n = outStereoFrames ? std::min(frameCount, avail) : 0u;
+    if (n < frameCount) add_(underflow_, frameCount - n);
+    if (n > 0) {
+        const uint32_t idx = r & kMask;
+        const uint32_t first = std::min(n, kCapacityFrames - idx);
+        std::memcpy(outStereoFrames, &samples_[idx * 2], static_cast<std::size_t>(first) * 2 * sizeof(int16_t));
+        std::memcpy(outStereoFrames + static_cast<std::size_t>(first) * 2, &samples_[0], static_cast<std::size_t>(n - first) * 2 * sizeof(int16_t));
+        add_(popped_, n);
+    }
+    read_.store(r + n, std::memory_order_release);
+    return n;
+}
+
+uint32_t AudioRing::bufferedFrames() const noexcept {
+    const uint32_t r = read_.load(std::memory_order_acquire);
+    const uint32_t w = write_.load(std::memory_order_acquire);
+    const uint32_t used = w - r;
+    return used > kCapacityFrames ? kCapacityFrames : used;
+}
+
+void AudioRing::setMaxBufferedFrames(uint32_t maxFrames, uint32_t maxDropPerPop) noexcept {
+    maxBuffered_.store(std::min(maxFrames, kCapacityFrames), std::memory_order_relaxed);
+    maxDropPerPop_.store(maxDropPerPop, std::memory_order_relaxed);
+}
+
+void AudioRing::setHistogramBucketFrames(uint32_t frames) noexcept {
+    bucketFrames_.store(frames > 0 ? frames : 1u, std::memory_order_relaxed);
+}
+
+void AudioRing::stats(Stats& out) const noexcept {
+    out.pushedFrames = pushed_.load(std::memory_order_relaxed);
+    out.poppedFrames = popped_.load(std::memory_order_relaxed);
+    out.overflowFrames = overflow_.load(std::memory_order_relaxed);
+    out.trimmedFrames = trimmed_.load(std::memory_order_relaxed);
+    out.underflowFrames = underflow_.load(std::memory_order_relaxed);
+    out.histogramBucketFrames = bucketFrames_.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < kHistogramBuckets; ++i) out.fillHistogram[i] = histogram_[i].load(std::memory_order_relaxed);
+}
+
+} // namespace snesonline
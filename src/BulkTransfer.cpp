@@ -0,0 +1,551 @@
+#include "snesonline/BulkTransfer.h"
+
+#include "snesonline/Hash.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <WinSock2.h>
+#else
+#include <sys/socket.h>
+#include <sys/types.h>
+#endif
+
+namespace snesonline {
+
+namespace {
+
+static constexpr std::size_t kHeaderBytes = kBulkDataHeaderBytes;
+static constexpr std::size_t kAckHeaderBytes = kBulkAckHeaderBytes;
+static constexpr std::size_t kMaxAckRanges = (kBulkMaxAckBytes - kAckHeaderBytes) / 8;
+static constexpr uint8_t kFlagProbe = 1u << 0;
+
+// Segments start on a granule so the receiver can track them in a bitmap.
+static constexpr uint32_t kGranule = 64;
+
+inline uint32_t payloadFor(std::size_t datagramBytes) noexcept {
+    return static_cast<uint32_t>((datagramBytes - kHeaderBytes) / kGranule * kGranule);
+}
+
+// Payload sizes probed during a sender's first transfer, largest first. Normal-size datagrams go out
+// next to them, so a path that drops the big ones only loses the probes.
+static constexpr std::size_t kProbeDatagramBytes[] = {kBulkMaxDatagramBytes, 1392};
+
+// Initial window (datagrams) and window cap. The cap stays well inside the 1 MiB socket buffers
+// the sessions ask for, and the kernel default receive buffer when that request is clamped.
+static constexpr uint32_t kInitialWindowSegments = 10;
+static constexpr uint32_t kMaxWindowBytes = 192u * 1024u;
+// The window never shrinks below this rate (times the RTT): what the fixed 6 x 1 KiB per frame
+// state sync it replaces sent regardless of loss. Keeps random, non-congestive loss from
+// throttling a transfer below the old scheme.
+static constexpr uint64_t kFloorBytesPerSecond = 6u * 1024u * 60u;
+// A segment is lost once this many segments sent after it have been acked and it is older than a
+// round trip plus a quarter (so a jittery path that reorders a burst does not trigger resends).
+static constexpr uint32_t kReorderSegments = 3;
+
+static constexpr uint32_t kInitialRtoUs = 500000;
+static constexpr uint32_t kMinRtoUs = 60000;
+static constexpr uint32_t kMaxRtoUs = 2000000;
+// The receiver repeats its ack this often while a transfer is incomplete but idle.
+static constexpr int64_t kStallAckIntervalMs = 200;
+
+inline void put16(uint8_t* p, uint16_t v) noexcept {
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+}
+
+inline void put32(uint8_t* p, uint32_t v) noexcept {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (24 - 8 * i));
+}
+
+inline uint16_t get16(const uint8_t* p) noexcept {
+    return static_cast<uint16_t>((static_cast<uint16_t>(p[0]) << 8) | p[1]);
+}
+
+inline uint32_t get32(const uint8_t* p) noexcept {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline uint32_t granuleCount(uint32_t totalBytes) noexcept { return (totalBytes + kGranule - 1) / kGranule; }
+
+inline bool testBit(const std::vector<uint64_t>& bits, uint32_t i) noexcept { return (bits[i >> 6] >> (i & 63)) & 1u; }
+
+inline uint32_t micros(std::chrono::steady_clock::duration d) noexcept {
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    return (us <= 0) ? 0u : (us > 0x7FFFFFFF ? 0x7FFFFFFFu : static_cast<uint32_t>(us));
+}
+
+} // namespace
+
+BulkDatagramKind peekBulkDatagram(const uint8_t* data, std::size_t sizeBytes, uint8_t& outChannel) noexcept {
+    if (!data || sizeBytes < kHeaderBytes) return BulkDatagramKind::None;
+    const uint32_t magic = get32(data);
+    outChannel = data[4];
+    if (magic == kBulkDataMagic && sizeBytes > kHeaderBytes) return BulkDatagramKind::Data;
+    if (magic == kBulkAckMagic) return BulkDatagramKind::Ack;
+    return BulkDatagramKind::None;
+}
+
+std::size_t sendBulkDatagrams(std::intptr_t socket, const BulkDatagram* datagrams, std::size_t count, const void* to,
+                              std::size_t toLenBytes) noexcept {
+    if (!datagrams || count == 0 || !to) return 0;
+#if defined(_WIN32)
+    const SOCKET s = static_cast<SOCKET>(socket);
+    std::size_t sent = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const int n = sendto(s, reinterpret_cast<const char*>(datagrams[i].data), static_cast<int>(datagrams[i].sizeBytes), 0,
+                             static_cast<const sockaddr*>(to), static_cast<int>(toLenBytes));
+        if (n == static_cast<int>(datagrams[i].sizeBytes)) sent++;
+    }
+    return sent;
+#elif defined(__linux__)
+    const int fd = static_cast<int>(socket);
+    mmsghdr msgs[kBulkMaxBatch];
+    iovec iov[kBulkMaxBatch];
+    std::size_t sent = 0;
+    std::size_t next = 0;
+    while (next < count) {
+        const std::size_t n = std::min(count - next, kBulkMaxBatch);
+        for (std::size_t i = 0; i < n; ++i) {
+            iov[i].iov_base = const_cast<uint8_t*>(datagrams[next + i].data);
+            iov[i].iov_len = datagrams[next + i].sizeBytes;
+            std::memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = const_cast<void*>(to);
+            msgs[i].msg_hdr.msg_namelen = static_cast<socklen_t>(toLenBytes);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        // sendmmsg stops at the first datagram that fails (e.g. EMSGSIZE for an MTU probe on a
+        // smaller-MTU route); skip it and send the rest, the sender retransmits it later.
+        const int r = sendmmsg(fd, msgs, static_cast<unsigned>(n), 0);
+        sent += (r > 0) ? static_cast<std::size_t>(r) : 0u;
+        next += (r > 0) ? static_cast<std::size_t>(r) : 0u;
+        if (r < static_cast<int>(n)) next++;
+    }
+    return sent;
+#else
+    const int fd = static_cast<int>(socket);
+    std::size_t sent = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const ssize_t n = sendto(fd, datagrams[i].data, datagrams[i].sizeBytes, 0, static_cast<const sockaddr*>(to),
+                                 static_cast<socklen_t>(toLenBytes));
+        if (n == static_cast<ssize_t>(datagrams[i].sizeBytes)) sent++;
+    }
+    return sent;
+#endif
+}
+
+// ---- Sender ----
+
+bool BulkSender::begin(uint8_t channel, const void* data, std::size_t sizeBytes, bool waitForReceiver) noexcept {
+    cancel();
+    if (!data || sizeBytes == 0 || sizeBytes > kBulkMaxBlobBytes) return false;
+
+    const uint32_t total = static_cast<uint32_t>(sizeBytes);
+    try {
+        blob_.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + sizeBytes);
+        acked_.assign((granuleCount(total) + 63) / 64, 0u);
+        inFlight_.clear();
+        inFlight_.reserve(kMaxWindowBytes / payloadFor(kBulkBaseDatagramBytes) + 8);
+        lost_.clear();
+        lost_.reserve(64);
+        if (scratch_.empty()) scratch_.resize(kBulkMaxBatch * kBulkMaxDatagramBytes);
+    } catch (...) {
+        cancel();
+        return false;
+    }
+
+    if (mss_ == 0) mss_ = payloadFor(kBulkBaseDatagramBytes);
+    channel_ = channel;
+    total_ = total;
+    crc_ = crc32(blob_.data(), blob_.size());
+    ackedBytes_ = 0;
+    nextNew_ = 0;
+    inFlightBytes_ = 0;
+    highestAckedSeq_ = seq_;
+    recoverySeq_ = seq_;
+    restartSeq_ = seq_;
+    restarted_ = false;
+    cwnd_ = kInitialWindowSegments * mss_;
+    ssthresh_ = kMaxWindowBytes;
+    backoff_ = 0;
+    receiverSeen_ = !waitForReceiver;
+    active_ = true;
+    return true;
+}
+
+void BulkSender::cancel() noexcept {
+    active_ = false;
+    receiverSeen_ = false;
+    total_ = 0;
+    ackedBytes_ = 0;
+    nextNew_ = 0;
+    inFlight_.clear();
+    inFlightBytes_ = 0;
+    lost_.clear();
+}
+
+uint32_t BulkSender::rtoMicros_() const noexcept {
+    uint32_t rto = (srttUs_ == 0) ? kInitialRtoUs : srttUs_ + 4 * rttVarUs_;
+    rto = std::max(rto, kMinRtoUs);
+    for (uint32_t i = 0; i < backoff_ && rto < kMaxRtoUs; ++i) rto *= 2;
+    return std::min(rto, kMaxRtoUs);
+}
+
+bool BulkSender::lostByReorder_(const Segment& s, Clock::time_point now) const noexcept {
+    if (static_cast<int32_t>(highestAckedSeq_ - s.seq) < static_cast<int32_t>(kReorderSegments)) return false;
+    return micros(now - s.sentAt) >= srttUs_ + srttUs_ / 4;
+}
+
+bool BulkSender::isAcked_(uint32_t begin, uint32_t end) const noexcept {
+    for (uint32_t g = begin / kGranule; g * kGranule < end; ++g) {
+        if (!testBit(acked_, g)) return false;
+    }
+    return true;
+}
+
+void BulkSender::markAcked_(uint32_t begin, uint32_t end) noexcept {
+    end = std::min(end, total_);
+    // Only whole granules; a range end short of a granule boundary is the end of the blob.
+    for (uint32_t g = (begin + kGranule - 1) / kGranule; g * kGranule < end; ++g) {
+        const uint32_t gEnd = std::min((g + 1) * kGranule, total_);
+        if (gEnd > end) break;
+        uint64_t& w = acked_[g >> 6];
+        const uint64_t bit = uint64_t{1} << (g & 63);
+        if (w & bit) continue;
+        w |= bit;
+        ackedBytes_ += gEnd - g * kGranule;
+    }
+}
+
+void BulkSender::onLoss_(const Segment& s, bool timeout) noexcept {
+    try {
+        lost_.push_back({s.offset, s.offset + s.length});
+    } catch (...) {
+        // Reserved up front; if it ever fails the range is still covered by the timeout pass.
+    }
+    // A probe that did not make it says nothing about congestion.
+    if (s.probe) return;
+    if (timeout) backoff_++;
+    // One reduction per window: losses among segments sent before the last reduction are the same event.
+    if (static_cast<int32_t>(s.seq - recoverySeq_) <= 0) return;
+    const uint32_t floor = static_cast<uint32_t>(kFloorBytesPerSecond * srttUs_ / 1000000u);
+    ssthresh_ = std::max({cwnd_ / 2, 2 * mss_, std::min(floor, kMaxWindowBytes)});
+    cwnd_ = ssthresh_;
+    recoverySeq_ = seq_;
+}
+
+void BulkSender::restart_() noexcept {
+    std::fill(acked_.begin(), acked_.end(), 0u);
+    ackedBytes_ = 0;
+    nextNew_ = 0;
+    inFlight_.clear();
+    inFlightBytes_ = 0;
+    lost_.clear();
+    highestAckedSeq_ = seq_;
+    recoverySeq_ = seq_;
+    restartSeq_ = seq_;
+    restarted_ = true;
+    restarts_++;
+}
+
+void BulkSender::onDatagram(const uint8_t* data, std::size_t sizeBytes, Clock::time_point now) noexcept {
+    if (!active_ || !data || sizeBytes < kAckHeaderBytes || get32(data) != kBulkAckMagic) return;
+    if (data[4] != channel_ || get32(data + 8) != total_ || get32(data + 12) != crc_) return;
+    const uint32_t ranges = data[5];
+    if (sizeBytes < kAckHeaderBytes + 8 * static_cast<std::size_t>(ranges)) return;
+
+    // The receiver threw away a blob that failed its CRC. Its acks carry the flag, echoing the
+    // transmission that completed the bad copy, until it has the blob again: the first one for a
+    // failure restarts the transfer, later ones only report progress. Acks from before the restart
+    // describe data the receiver no longer has.
+    const uint32_t echoSeq = get32(data + 20);
+    if ((get16(data + 6) & kBulkAckFlagRestart) != 0) {
+        if (static_cast<int32_t>(echoSeq - restartSeq_) > 0) {
+            restart_();
+            restartEcho_ = echoSeq;
+        } else if (!restarted_ || echoSeq != restartEcho_) {
+            return;
+        }
+    } else if (restarted_ && static_cast<int32_t>(echoSeq - restartSeq_) <= 0) {
+        return;
+    }
+
+    receiverSeen_ = true;
+    backoff_ = 0;
+
+    // RTT from the newest transmission the receiver has seen, if this is the first ack covering it.
+    for (const Segment& s : inFlight_) {
+        if (s.seq != echoSeq) continue;
+        const uint32_t rtt = micros(now - s.sentAt);
+        if (srttUs_ == 0) {
+            srttUs_ = rtt;
+            rttVarUs_ = rtt / 2;
+        } else {
+            const uint32_t err = (rtt > srttUs_) ? (rtt - srttUs_) : (srttUs_ - rtt);
+            rttVarUs_ = (3 * rttVarUs_ + err) / 4;
+            srttUs_ = (7 * srttUs_ + rtt) / 8;
+        }
+        break;
+    }
+
+    markAcked_(0, get32(data + 16));
+    for (uint32_t i = 0; i < ranges; ++i) {
+        const uint8_t* r = data + kAckHeaderBytes + 8 * i;
+        const uint32_t b = get32(r);
+        const uint32_t e = get32(r + 4);
+        if (b < e) markAcked_(b, e);
+    }
+
+    uint32_t newlyAcked = 0;
+    for (const Segment& s : inFlight_) {
+        if (!isAcked_(s.offset, s.offset + s.length)) continue;
+        newlyAcked += s.length;
+        if (static_cast<int32_t>(s.seq - highestAckedSeq_) > 0) highestAckedSeq_ = s.seq;
+        if (s.probe && s.length > mss_) mss_ = s.length;
+    }
+
+    std::size_t keep = 0;
+    inFlightBytes_ = 0;
+    for (std::size_t i = 0; i < inFlight_.size(); ++i) {
+        const Segment s = inFlight_[i];
+        if (isAcked_(s.offset, s.offset + s.length)) continue;
+        if (lostByReorder_(s, now)) {
+            onLoss_(s, false);
+            continue;
+        }
+        inFlight_[keep++] = s;
+        inFlightBytes_ += s.length;
+    }
+    inFlight_.resize(keep);
+
+    // Slow start below ssthresh, then about one segment per window.
+    if (newlyAcked != 0) {
+        if (cwnd_ < ssthresh_) {
+            cwnd_ += newlyAcked;
+        } else {
+            cwnd_ += std::max<uint32_t>(1u, static_cast<uint32_t>(static_cast<uint64_t>(mss_) * newlyAcked / cwnd_));
+        }
+        cwnd_ = std::min(cwnd_, kMaxWindowBytes);
+    }
+}
+
+bool BulkSender::emit_(uint32_t offset, uint32_t length, bool probe, Clock::time_point now, std::size_t slot, BulkDatagram& out) noexcept {
+    Segment s{};
+    s.offset = offset;
+    s.length = length;
+    s.seq = seq_ + 1;
+    s.sentAt = now;
+    s.probe = probe;
+    try {
+        inFlight_.push_back(s);
+    } catch (...) {
+        return false;
+    }
+
+    uint8_t* p = scratch_.data() + slot * kBulkMaxDatagramBytes;
+    put32(p, kBulkDataMagic);
+    p[4] = channel_;
+    p[5] = probe ? kFlagProbe : 0u;
+    put16(p + 6, static_cast<uint16_t>(length));
+    put32(p + 8, total_);
+    put32(p + 12, crc_);
+    put32(p + 16, offset);
+    put32(p + 20, ++seq_);
+    std::memcpy(p + kHeaderBytes, blob_.data() + offset, length);
+    out.data = p;
+    out.sizeBytes = kHeaderBytes + length;
+
+    inFlightBytes_ += length;
+    sentDatagrams_++;
+    sentBytes_ += out.sizeBytes;
+    return true;
+}
+
+std::size_t BulkSender::poll(Clock::time_point now, BulkDatagram* out, std::size_t maxCount) noexcept {
+    if (!active_ || done() || !receiverSeen_ || !out) return 0;
+    maxCount = std::min(maxCount, kBulkMaxBatch);
+
+    // Retransmission timeout: nothing acked for a while (the tail of a transfer, or the ack path
+    // died). Segments held back by the reorder window are re-checked here as they age.
+    const uint32_t rto = rtoMicros_();
+    bool timedOut = false;
+    std::size_t keep = 0;
+    inFlightBytes_ = 0;
+    for (std::size_t i = 0; i < inFlight_.size(); ++i) {
+        const Segment s = inFlight_[i];
+        if (micros(now - s.sentAt) >= rto) {
+            onLoss_(s, !timedOut && !s.probe);
+            timedOut = timedOut || !s.probe;
+            continue;
+        }
+        if (lostByReorder_(s, now)) {
+            onLoss_(s, false);
+            continue;
+        }
+        inFlight_[keep++] = s;
+        inFlightBytes_ += s.length;
+    }
+    inFlight_.resize(keep);
+
+    std::size_t n = 0;
+    while (n < maxCount && inFlightBytes_ < cwnd_) {
+        if (!lost_.empty()) {
+            Range& r = lost_.front();
+            // Skip what has been acked since (a late ack, or a range queued twice).
+            while (r.begin < r.end && isAcked_(r.begin, std::min(r.begin + kGranule, r.end))) r.begin += kGranule;
+            if (r.begin >= r.end) {
+                lost_.erase(lost_.begin());
+                continue;
+            }
+            const uint32_t len = std::min(mss_, r.end - r.begin);
+            if (!emit_(r.begin, len, false, now, n, out[n])) break;
+            r.begin += len;
+            if (r.begin >= r.end) lost_.erase(lost_.begin());
+            retransmits_++;
+            n++;
+            continue;
+        }
+        if (nextNew_ >= total_) break;
+
+        if (!probesSent_) {
+            probesSent_ = true;
+            for (std::size_t size : kProbeDatagramBytes) {
+                const uint32_t len = payloadFor(size);
+                if (len <= mss_ || total_ - nextNew_ < len || n >= maxCount) continue;
+                if (!emit_(nextNew_, len, true, now, n, out[n])) break;
+                nextNew_ += len;
+                n++;
+            }
+            continue;
+        }
+
+        const uint32_t len = std::min(mss_, total_ - nextNew_);
+        if (!emit_(nextNew_, len, false, now, n, out[n])) break;
+        nextNew_ += len;
+        n++;
+    }
+    return n;
+}
+
+// ---- Receiver ----
+
+bool BulkReceiver::start_(uint8_t channel, uint32_t totalBytes, uint32_t crc) noexcept {
+    if (totalBytes == 0 || totalBytes > kBulkMaxBlobBytes) return false;
+    try {
+        blob_.assign(totalBytes, 0u);
+        have_.assign((granuleCount(totalBytes) + 63) / 64, 0u);
+    } catch (...) {
+        reset();
+        return false;
+    }
+    channel_ = channel;
+    total_ = totalBytes;
+    crc_ = crc;
+    receivedBytes_ = 0;
+    complete_ = false;
+    restartDue_ = false;
+    highestSeq_ = 0;
+    return true;
+}
+
+bool BulkReceiver::expect(uint8_t channel, uint32_t totalBytes, uint32_t crc) noexcept {
+    if (channel != channel_ || totalBytes != total_ || crc != crc_) {
+        if (!start_(channel, totalBytes, crc)) return false;
+    }
+    ackDue_ = true;
+    return true;
+}
+
+void BulkReceiver::reset() noexcept {
+    total_ = 0;
+    crc_ = 0;
+    receivedBytes_ = 0;
+    complete_ = false;
+    restartDue_ = false;
+    ackDue_ = false;
+    have_.clear();
+    blob_.clear();
+}
+
+bool BulkReceiver::onDatagram(const uint8_t* data, std::size_t sizeBytes, Clock::time_point /*now*/) noexcept {
+    if (!data || sizeBytes <= kHeaderBytes || get32(data) != kBulkDataMagic) return false;
+    const uint8_t channel = data[4];
+    const uint32_t length = get16(data + 6);
+    const uint32_t total = get32(data + 8);
+    const uint32_t crc = get32(data + 12);
+    const uint32_t offset = get32(data + 16);
+    const uint32_t seq = get32(data + 20);
+    if (length == 0 || sizeBytes != kHeaderBytes + length || offset % kGranule != 0) return false;
+    if (offset >= total || length > total - offset) return false;
+    if (length % kGranule != 0 && offset + length != total) return false;
+
+    if (channel != channel_ || total != total_ || crc != crc_) {
+        if (!start_(channel, total, crc)) return false;
+    }
+    if (receivedBytes_ == 0 || static_cast<int32_t>(seq - highestSeq_) > 0) highestSeq_ = seq;
+    ackDue_ = true;
+    if (complete_) return false;
+
+    std::memcpy(blob_.data() + offset, data + kHeaderBytes, length);
+    for (uint32_t g = offset / kGranule; g * kGranule < offset + length; ++g) {
+        uint64_t& w = have_[g >> 6];
+        const uint64_t bit = uint64_t{1} << (g & 63);
+        if (w & bit) continue;
+        w |= bit;
+        receivedBytes_ += std::min((g + 1) * kGranule, total_) - g * kGranule;
+    }
+    if (receivedBytes_ != total_) return false;
+
+    if (crc32(blob_.data(), blob_.size()) != crc_) {
+        // Corrupted somewhere along the way. The sender may have every byte acked by now, so it is
+        // told to send everything again rather than left waiting for acks that will not come.
+        std::fill(have_.begin(), have_.end(), 0u);
+        receivedBytes_ = 0;
+        restartDue_ = true;
+        failedSeq_ = highestSeq_;
+        return false;
+    }
+    complete_ = true;
+    restartDue_ = false;
+    return true;
+}
+
+std::size_t BulkReceiver::pollAck(Clock::time_point now, uint8_t* out, std::size_t capacity) noexcept {
+    if (total_ == 0 || !out || capacity < kAckHeaderBytes) return 0;
+    const bool stalled = !complete_ && std::chrono::duration_cast<std::chrono::milliseconds>(now - lastAck_).count() >= kStallAckIntervalMs;
+    if (!ackDue_ && !stalled) return 0;
+
+    const uint32_t granules = granuleCount(total_);
+    uint32_t g = 0;
+    while (g < granules && testBit(have_, g)) ++g;
+    const uint32_t cumulative = std::min(g * kGranule, total_);
+
+    const std::size_t maxRanges = std::min(kMaxAckRanges, (capacity - kAckHeaderBytes) / 8);
+    std::size_t ranges = 0;
+    while (g < granules && ranges < maxRanges) {
+        while (g < granules && !testBit(have_, g)) ++g;
+        if (g >= granules) break;
+        const uint32_t begin = g;
+        while (g < granules && testBit(have_, g)) ++g;
+        uint8_t* r = out + kAckHeaderBytes + 8 * ranges;
+        put32(r, begin * kGranule);
+        put32(r + 4, std::min(g * kGranule, total_));
+        ranges++;
+    }
+
+    put32(out, kBulkAckMagic);
+    out[4] = channel_;
+    out[5] = static_cast<uint8_t>(ranges);
+    put16(out + 6, restartDue_ ? kBulkAckFlagRestart : uint16_t{0});
+    put32(out + 8, total_);
+    put32(out + 12, crc_);
+    put32(out + 16, cumulative);
+    put32(out + 20, restartDue_ ? failedSeq_ : highestSeq_);
+    ackDue_ = false;
+    lastAck_ = now;
+    return kAckHeaderBytes + 8 * ranges;
+}
+
+} // namespace snesonline
@@ -1,5 +1,8 @@
 #include "snesonline/EmulatorEngine.h"
 
+#include "snesonline/Hash.h"
+#include "snesonline/Profiler.h"
+
 #include <cstdint>
 #include <cstring>
 
@@ -20,7 +23,10 @@ bool EmulatorEngine::initialize(const char* corePath, const char* romPath) noexc
 }
 
 void EmulatorEngine::shutdown() noexcept {
+    aheadWorker_.stop();
+    aheadDirty_ = true;
     core_.unload();
+    runAheadState_.reset();
 }
 
 void EmulatorEngine::setLocalInputMask(uint16_t mask) noexcept {
@@ -36,23 +42,104 @@ void EmulatorEngine::setInputMask(unsigned port, uint16_t mask) noexcept {
     inputMasks_[port].store(mask, std::memory_order_relaxed);
 }
 
-void EmulatorEngine::advanceFrame() noexcept {
+void EmulatorEngine::advanceFrame(FrameOutput output) noexcept {
+    SNESONLINE_PROFILE_SCOPE("engine.advanceFrame");
     // No allocations, no std::string in hot path.
-    core_.setInputMasks(
-        inputMasks_[0].load(std::memory_order_relaxed),
-        inputMasks_[1].load(std::memory_order_relaxed));
-    core_.runFrame();
+    const uint16_t m0 = inputMasks_[0].load(std::memory_order_relaxed);
+    const uint16_t m1 = inputMasks_[1].load(std::memory_order_relaxed);
+    core_.setInputMasks(m0, m1);
+
+    const bool video = output == FrameOutput::Present || output == FrameOutput::VideoOnly;
+    if (runAhead_ != 0 && video && aheadWorker_.running()) {
+        runFrame_(output == FrameOutput::Present ? FrameOutput::AudioOnly : FrameOutput::None);
+        submitRunAhead_(m0, m1);
+        return;
+    }
+    // The second instance no longer follows this one.
+    aheadDirty_ = true;
+    if (runAhead_ == 0 || !video || !reserveRunAhead_()) {
+        runFrame_(output);
+        return;
+    }
+
+    // The real frame keeps its audio; only the picture comes from the future.
+    runFrame_(output == FrameOutput::Present ? FrameOutput::AudioOnly : FrameOutput::None);
+    const std::size_t sz = core_.serializeSize();
+    if (!core_.serialize(runAheadState_.data(), sz)) {
+        // Nothing to come back to; the previous picture stays up for this frame.
+        return;
+    }
+    for (uint32_t i = 1; i < runAhead_; ++i) runFrame_(FrameOutput::None);
+    runFrame_(FrameOutput::VideoOnly);
+    (void)core_.unserialize(runAheadState_.data(), sz);
 }
 
-uint32_t EmulatorEngine::checksum32_(const void* data, std::size_t sizeBytes) noexcept {
-    // Fast-ish FNV-1a 32-bit checksum. Deterministic and cheap.
-    const uint8_t* p = static_cast<const uint8_t*>(data);
-    uint32_t hash = 2166136261u;
-    for (std::size_t i = 0; i < sizeBytes; ++i) {
-        hash ^= p[i];
-        hash *= 16777619u;
+void EmulatorEngine::submitRunAhead_(uint16_t port0Mask, uint16_t port1Mask) noexcept {
+    SNESONLINE_PROFILE_SCOPE("engine.runAheadSubmit");
+    aheadWorker_.wait();
+    // Its frames were predicted on the previous inputs; start over from the real state.
+    const bool resync = aheadDirty_ || aheadWorker_.needsResync() || port0Mask != aheadMasks_[0] || port1Mask != aheadMasks_[1];
+    std::size_t sz = 0;
+    if (resync) {
+        sz = core_.serializeSize();
+        void* dst = aheadWorker_.stateBuffer(sz);
+        if (!dst || !core_.serialize(dst, sz)) {
+            // The previous picture stays up; try again next frame.
+            aheadDirty_ = true;
+            return;
+        }
+    }
+    aheadWorker_.submit(resync, sz, runAhead_, port0Mask, port1Mask, core_.videoSinkCtx(), core_.videoSinkFn());
+    aheadMasks_[0] = port0Mask;
+    aheadMasks_[1] = port1Mask;
+    aheadDirty_ = false;
+}
+
+void EmulatorEngine::waitForRunAhead() noexcept {
+    if (aheadWorker_.running()) aheadWorker_.wait();
+}
+
+bool EmulatorEngine::setRunAheadSecondInstance(bool enabled) noexcept {
+    aheadDirty_ = true;
+    if (!enabled) {
+        aheadWorker_.stop();
+        return true;
+    }
+    if (aheadWorker_.running()) return true;
+    if (!core_.isLoaded() || core_.romPath().empty()) return false;
+    return aheadWorker_.start(core_.corePath().c_str(), core_.romPath().c_str());
+}
+
+void EmulatorEngine::runFrame_(FrameOutput output) noexcept {
+    SNESONLINE_PROFILE_SCOPE("engine.runFrame");
+    const bool video = output == FrameOutput::Present || output == FrameOutput::VideoOnly;
+    const bool audio = output == FrameOutput::Present || output == FrameOutput::AudioOnly;
+    core_.runFrame(video, audio);
+}
+
+void EmulatorEngine::setRunAheadFrames(uint32_t frames) noexcept {
+    runAhead_ = (frames > kMaxRunAheadFrames) ? kMaxRunAheadFrames : frames;
+    waitForRunAhead();
+    aheadDirty_ = true;
+    if (runAhead_ == 0) {
+        runAheadState_.reset();
+        return;
     }
-    return hash;
+    // Allocate now if a game is loaded so the first shown frame does not.
+    (void)reserveRunAhead_();
+}
+
+bool EmulatorEngine::reserveRunAhead_() noexcept {
+    const std::size_t sz = core_.serializeSize();
+    if (sz == 0) return false;
+    if (runAheadState_.size() >= sz) return true;
+    return runAheadState_.allocate(sz, 64);
+}
+
+uint32_t EmulatorEngine::checksum32_(const void* data, std::size_t sizeBytes) noexcept {
+    SNESONLINE_PROFILE_SCOPE("engine.checksum");
+    // Deterministic across platforms; uses the SIMD state hash when the CPU supports it.
+    return stateHash32(data, sizeBytes);
 }
 
 bool EmulatorEngine::saveState(SaveState& out) noexcept {
@@ -63,16 +150,31 @@ bool EmulatorEngine::saveState(SaveState& out) noexcept {
         if (!out.buffer.allocate(sz, 64)) return false;
     }
 
-    if (!core_.serialize(out.buffer.data(), sz)) return false;
+    return saveStateInto(out.buffer.data(), out.buffer.size(), out.sizeBytes, out.checksum);
+}
+
+bool EmulatorEngine::loadState(const SaveState& in) noexcept {
+    if (!in.buffer.data()) return false;
+    return loadStateFrom(in.buffer.data(), in.sizeBytes);
+}
 
-    out.sizeBytes = sz;
-    out.checksum = checksum32_(out.buffer.data(), out.sizeBytes);
+bool EmulatorEngine::saveStateInto(void* dst, std::size_t capacityBytes, std::size_t& outSizeBytes, uint32_t& outChecksum) noexcept {
+    SNESONLINE_PROFILE_SCOPE("engine.saveState");
+    const std::size_t sz = core_.serializeSize();
+    if (sz == 0 || !dst || capacityBytes < sz) return false;
+
+    if (!core_.serialize(dst, sz)) return false;
+
+    outSizeBytes = sz;
+    outChecksum = checksum32_(dst, sz);
     return true;
 }
 
-bool EmulatorEngine::loadState(const SaveState& in) noexcept {
-    if (in.sizeBytes == 0 || !in.buffer.data()) return false;
-    return core_.unserialize(in.buffer.data(), in.sizeBytes);
+bool EmulatorEngine::loadStateFrom(const void* src, std::size_t sizeBytes) noexcept {
+    if (sizeBytes == 0 || !src) return false;
+    SNESONLINE_PROFILE_SCOPE("engine.loadState");
+    aheadDirty_ = true;
+    return core_.unserialize(src, sizeBytes);
 }
 
 } // namespace snesonline
@@ -0,0 +1,37 @@
+#include "snesonline/FrameExchange.h"
+
+namespace snesonline {
+
+bool FrameExchange::publish(unsigned width, unsigned height) noexcept {
+    if (width > kMaxWidth || height > kMaxHeight) return false;
+    const uint32_t seq = published_.load(std::memory_order_relaxed) + 1;
+    Slot& s = slots_[back_];
+    s.width = width;
+    s.height = height;
+    s.seq = seq;
+
+    // Release hands the filled slot to the consumer; acquire makes sure the consumer has finished
+    // reading the slot we get back before the next frame is written into it.
+    const uint32_t prev = middle_.exchange(back_ | kFreshBit, std::memory_order_acq_rel);
+    back_ = prev & kIndexMask;
+    published_.store(seq, std::memory_order_relaxed);
+    return true;
+}
+
+FrameExchange::Frame FrameExchange::acquire() noexcept {
+    // Only the consumer clears the flag, so a stale read here just means trying again next time.
+    if (middle_.load(std::memory_order_relaxed) & kFreshBit) {
+        const uint32_t prev = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = prev & kIndexMask;
+    }
+    const Slot& s = slots_[front_];
+    Frame f;
+    f.pixels = s.pixels;
+    f.width = s.width;
+    f.height = s.height;
+    f.seq = s.seq;
+    f.index = front_;
+    return f;
+}
+
+} // namespace snesonline
@@ -0,0 +1,150 @@
+#include "snesonline/FrameScheduler.h"
+
+#include <cmath>
+#include <thread>
+
+namespace snesonline {
+
+namespace {
+
+// Rates are kept to the micro-hertz: 60.0988139 Hz becomes 60098814 / 1000000, good to well under
+// a millisecond per hour against the core's own clock.
+constexpr uint64_t kRateDen = 1000000;
+constexpr uint64_t kNsPerSec = 1000000000;
+
+uint64_t gcd(uint64_t a, uint64_t b) noexcept {
+    while (b != 0) {
+        const uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+uint64_t micros(FrameScheduler::Clock::duration d) noexcept {
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    return (us > 0) ? static_cast<uint64_t>(us) : 0u;
+}
+
+} // namespace
+
+void FrameScheduler::configure(const Config& cfg) noexcept {
+    cfg_ = cfg;
+    if (cfg_.maxCatchUpFrames == 0) cfg_.maxCatchUpFrames = 1;
+    setFramesPerSecond(cfg.framesPerSecond);
+    frac_ = 0;
+    started_ = false;
+}
+
+void FrameScheduler::setFramesPerSecond(double fps) noexcept {
+    if (!(fps > 1.0) || fps > 4000.0) fps = 60.0;
+    uint64_t num = static_cast<uint64_t>(std::llround(fps * static_cast<double>(kRateDen)));
+    uint64_t den = kRateDen;
+    const uint64_t g = gcd(num, den);
+    num /= g;
+    den /= g;
+
+    // Keep the fraction of the pending deadline in the new units.
+    frac_ = frac_ * num / rateNum_;
+    rateNum_ = num;
+    rateDen_ = den;
+    periodNs_ = (kNsPerSec * den) / num;
+    periodRem_ = (kNsPerSec * den) % num;
+    cfg_.framesPerSecond = fps;
+}
+
+void FrameScheduler::start(Clock::time_point start) noexcept {
+    next_ = start;
+    frac_ = 0;
+    started_ = true;
+}
+
+uint32_t FrameScheduler::due(Clock::time_point now) noexcept {
+    if (!started_) start(now);
+    if (now < next_) return 0;
+
+    const uint64_t lateNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - next_).count());
+    // Exact for the common case of being less than a second behind; one period at a time beyond
+    // that, where the backlog is capped anyway.
+    const uint64_t periodScaled = kNsPerSec * rateDen_;
+    const uint64_t extra = (lateNs < kNsPerSec) ? (lateNs * rateNum_) / periodScaled : lateNs / periodNs_;
+    uint64_t behind = 1 + extra;
+
+    if (behind > 1) {
+        uint64_t keep = behind;
+        if (audioTarget_ != 0 && audioBuffered_ >= audioTarget_) {
+            keep = 1;
+        } else if (cfg_.maxBacklogFrames != 0 && behind > cfg_.maxBacklogFrames) {
+            keep = cfg_.maxBacklogFrames;
+        }
+        if (keep < behind) {
+            const uint64_t dropped = behind - keep;
+            drop_(dropped > 0xFFFFFFFFull ? 0xFFFFFFFFu : static_cast<uint32_t>(dropped));
+            behind = keep;
+        }
+    }
+
+    const uint32_t n = (behind > cfg_.maxCatchUpFrames) ? cfg_.maxCatchUpFrames : static_cast<uint32_t>(behind);
+    if (n > 1) {
+        add_(catchUpBursts_, 1);
+        add_(catchUpFrames_, n - 1);
+    }
+    return n;
+}
+
+void FrameScheduler::advance(uint32_t frames) noexcept {
+    delay(frames);
+    add_(frames_, frames);
+}
+
+void FrameScheduler::delay(uint32_t frames) noexcept {
+    if (frames == 0) return;
+    const uint64_t rem = frac_ + static_cast<uint64_t>(frames) * periodRem_;
+    const uint64_t ns = static_cast<uint64_t>(frames) * periodNs_ + rem / rateNum_;
+    frac_ = rem % rateNum_;
+    next_ += std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(static_cast<int64_t>(ns)));
+}
+
+void FrameScheduler::drop_(uint32_t frames) noexcept {
+    delay(frames);
+    add_(droppedFrames_, frames);
+}
+
+void FrameScheduler::waitUntil(Clock::time_point deadline) noexcept {
+    auto now = Clock::now();
+    if (now >= deadline) return;
+    add_(waits_, 1);
+
+    const auto spin = std::chrono::microseconds(cfg_.spinMicros);
+    if (deadline - now > spin) {
+        std::this_thread::sleep_until(deadline - spin);
+        now = Clock::now();
+        if (now >= deadline) add_(lateWakeups_, 1);
+    }
+
+    const auto spinStart = now;
+    while (now < deadline) {
+        std::this_thread::yield();
+        now = Clock::now();
+    }
+    if (deadline > spinStart) add_(spinMicrosTotal_, micros(deadline - spinStart));
+
+    const uint64_t errUs = micros(now - deadline);
+    add_(wakeErrorMicrosTotal_, errUs);
+    const uint32_t err32 = (errUs > 0xFFFFFFFFull) ? 0xFFFFFFFFu : static_cast<uint32_t>(errUs);
+    if (err32 > maxWakeErrorMicros_.load(std::memory_order_relaxed)) maxWakeErrorMicros_.store(err32, std::memory_order_relaxed);
+}
+
+void FrameScheduler::stats(Stats& out) const noexcept {
+    out.frames = frames_.load(std::memory_order_relaxed);
+    out.catchUpBursts = catchUpBursts_.load(std::memory_order_relaxed);
+    out.catchUpFrames = catchUpFrames_.load(std::memory_order_relaxed);
+    out.droppedFrames = droppedFrames_.load(std::memory_order_relaxed);
+    out.waits = waits_.load(std::memory_order_relaxed);
+    out.wakeErrorMicrosTotal = wakeErrorMicrosTotal_.load(std::memory_order_relaxed);
+    out.maxWakeErrorMicros = maxWakeErrorMicros_.load(std::memory_order_relaxed);
+    out.lateWakeups = lateWakeups_.load(std::memory_order_relaxed);
+    out.spinMicrosTotal = spinMicrosTotal_.load(std::memory_order_relaxed);
+}
+
+} // namespace snesonline
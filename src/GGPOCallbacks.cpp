@@ -1,6 +1,7 @@
 #include "snesonline/GGPOCallbacks.h"
 
 #include "snesonline/EmulatorEngine.h"
+#include "snesonline/SnapshotRing.h"
 
 #include <cstdint>
 #include <cstdlib>
@@ -13,11 +14,17 @@ namespace snesonline {
 #if defined(SNESONLINE_ENABLE_GGPO) && SNESONLINE_ENABLE_GGPO
 
 static GGPOSession* g_activeSession = nullptr;
+static SnapshotRing* g_snapshotRing = nullptr;
+static EmulatorEngine* g_engine = nullptr;
+
+static EmulatorEngine& engine() noexcept { return g_engine ? *g_engine : EmulatorEngine::instance(); }
 
 static std::atomic<bool> g_evRunning{false};
 static std::atomic<bool> g_evInterrupted{false};
 static std::atomic<bool> g_evDisconnected{false};
 static std::atomic<int> g_evTimesyncFramesAhead{0};
+static std::atomic<uint32_t> g_evRollbacks{0};
+static std::atomic<uint32_t> g_evResimulatedFrames{0};
 
 // NOTE: These functions are written to match common GGPO callback signatures.
 // Depending on your GGPO fork/version, you may need small signature tweaks.
@@ -26,11 +33,24 @@ static bool __cdecl begin_game_cb(const char* /*game*/) {
     return true;
 }
 
-static bool __cdecl save_game_state_cb(unsigned char** buffer, int* len, int* checksum, int /*frame*/) {
+static bool __cdecl save_game_state_cb(unsigned char** buffer, int* len, int* checksum, int frame) {
     if (!buffer || !len || !checksum) return false;
 
+    // Fast path: serialize straight into the ring slot for this frame and hand GGPO the slot.
+    // GGPO keeps at most GGPO_MAX_PREDICTION_FRAMES + 2 saved frames, which is what the ring
+    // is sized for, so a slot is never reused while GGPO still references it.
+    if (g_snapshotRing && g_snapshotRing->ready()) {
+        const SnapshotRing::Slot* slot = g_snapshotRing->save(engine(), static_cast<uint32_t>(frame));
+        if (slot) {
+            *buffer = slot->data;
+            *len = static_cast<int>(slot->sizeBytes);
+            *checksum = static_cast<int>(slot->checksum);
+            return true;
+        }
+    }
+
     SaveState state;
-    if (!EmulatorEngine::instance().saveState(state)) return false;
+    if (!engine().saveState(state)) return false;
 
     // GGPO expects to own the buffer and later call free_buffer.
     unsigned char* out = static_cast<unsigned char*>(std::malloc(state.sizeBytes));
@@ -46,12 +66,10 @@ static bool __cdecl save_game_state_cb(unsigned char** buffer, int* len, int* ch
 static bool __cdecl load_game_state_cb(unsigned char* buffer, int len) {
     if (!buffer || len <= 0) return false;
 
-    SaveState state;
-    if (!state.buffer.allocate(static_cast<std::size_t>(len), 64)) return false;
-    std::memcpy(state.buffer.data(), buffer, static_cast<std::size_t>(len));
-    state.sizeBytes = static_cast<std::size_t>(len);
-
-    return EmulatorEngine::instance().loadState(state);
+    // The core only reads from the buffer, so unserialize in place (ring slot or malloc'd).
+    if (!engine().loadStateFrom(buffer, static_cast<std::size_t>(len))) return false;
+    g_evRollbacks.fetch_add(1, std::memory_order_relaxed);
+    return true;
 }
 
 static bool __cdecl log_game_state_cb(char* /*filename*/, unsigned char* /*buffer*/, int /*len*/) {
@@ -59,6 +77,8 @@ static bool __cdecl log_game_state_cb(char* /*filename*/, unsigned char* /*buffe
 }
 
 static void __cdecl free_buffer_cb(void* buffer) {
+    // Ring slots are recycled by frame index; only fallback buffers are heap-owned.
+    if (g_snapshotRing && g_snapshotRing->owns(buffer)) return;
     std::free(buffer);
 }
 
@@ -73,9 +93,12 @@ static bool __cdecl advance_frame_cb(int /*flags*/) {
         return true;
     }
 
-    EmulatorEngine::instance().setInputMask(0, inputs[0]);
-    EmulatorEngine::instance().setInputMask(1, inputs[1]);
-    EmulatorEngine::instance().advanceFrame();
+    EmulatorEngine& eng = engine();
+    eng.setInputMask(0, inputs[0]);
+    eng.setInputMask(1, inputs[1]);
+    // Re-simulated frames were already heard; the frame after the rollback shows the result.
+    eng.advanceFrame(FrameOutput::None);
+    g_evResimulatedFrames.fetch_add(1, std::memory_order_relaxed);
 
     ggpo_advance_frame(g_activeSession);
     return true;
@@ -125,12 +148,22 @@ void GGPOCallbacks::setActiveSession(GGPOSession* session) noexcept {
     g_activeSession = session;
 }
 
+void GGPOCallbacks::setSnapshotRing(SnapshotRing* ring) noexcept {
+    g_snapshotRing = ring;
+}
+
+void GGPOCallbacks::setEngine(EmulatorEngine* engine) noexcept {
+    g_engine = engine;
+}
+
 GGPOCallbacks::EventState GGPOCallbacks::drainEvents() noexcept {
     EventState st{};
     st.running = g_evRunning.exchange(false, std::memory_order_relaxed);
     st.connectionInterrupted = g_evInterrupted.exchange(false, std::memory_order_relaxed);
     st.disconnected = g_evDisconnected.exchange(false, std::memory_order_relaxed);
     st.timesyncFramesAhead = g_evTimesyncFramesAhead.exchange(0, std::memory_order_relaxed);
+    st.rollbacks = g_evRollbacks.exchange(0, std::memory_order_relaxed);
+    st.resimulatedFrames = g_evResimulatedFrames.exchange(0, std::memory_order_relaxed);
     return st;
 }
 
@@ -144,6 +177,12 @@ GGPOSessionCallbacks GGPOCallbacks::make() noexcept {
 void GGPOCallbacks::setActiveSession(GGPOSession* /*session*/) noexcept {
 }
 
+void GGPOCallbacks::setSnapshotRing(SnapshotRing* /*ring*/) noexcept {
+}
+
+void GGPOCallbacks::setEngine(EmulatorEngine* /*engine*/) noexcept {
+}
+
 GGPOCallbacks::EventState GGPOCallbacks::drainEvents() noexcept {
     return {};
 }
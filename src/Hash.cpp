@@ -0,0 +1,599 @@
+#include "snesonline/Hash.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SNESONLINE_HASH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__)
+#define SNESONLINE_HASH_ARM64 1
+#include <arm_acle.h>
+#include <arm_neon.h>
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#elif defined(__linux__)
+#include <sys/auxv.h>
+#endif
+#endif
+
+// Per-function ISA enablement, so this file builds with the default flags of every platform
+// (the iOS project compiles src/ directly) and only dispatches to what the CPU reports.
+#if defined(__GNUC__) || defined(__clang__)
+#define SNESONLINE_TARGET(x) __attribute__((target(x)))
+#else
+#define SNESONLINE_TARGET(x)
+#endif
+
+#if defined(__clang__)
+#define SNESONLINE_TARGET_ARM_CRC SNESONLINE_TARGET("crc")
+#else
+#define SNESONLINE_TARGET_ARM_CRC SNESONLINE_TARGET("+crc")
+#endif
+
+namespace snesonline {
+
+namespace {
+
+// All supported targets are little-endian; loads go through memcpy to stay alignment-agnostic.
+inline uint32_t load32_(const uint8_t* p) noexcept {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t load64_(const uint8_t* p) noexcept {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// ---- CRC tables (slicing-by-8) ----
+
+struct CrcTables {
+    uint32_t t[8][256] = {};
+
+    constexpr explicit CrcTables(uint32_t reflectedPoly) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (reflectedPoly & (0u - (c & 1u)));
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFFu];
+        }
+    }
+};
+
+constexpr CrcTables kCrc32Tables(0xEDB88320u);
+constexpr CrcTables kCrc32cTables(0x82F63B78u);
+
+// Operates on the raw (non-inverted) CRC register.
+uint32_t crcSlicing8_(const CrcTables& tb, const uint8_t* p, std::size_t n, uint32_t crc) noexcept {
+    const auto& t = tb.t;
+    while (n >= 8) {
+        const uint32_t one = load32_(p) ^ crc;
+        const uint32_t two = load32_(p + 4);
+        crc = t[7][one & 0xFFu] ^ t[6][(one >> 8) & 0xFFu] ^ t[5][(one >> 16) & 0xFFu] ^ t[4][one >> 24] ^
+              t[3][two & 0xFFu] ^ t[2][(two >> 8) & 0xFFu] ^ t[1][(two >> 16) & 0xFFu] ^ t[0][two >> 24];
+        p += 8;
+        n -= 8;
+    }
+    while (n--) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFFu];
+    return crc;
+}
+
+uint32_t crc32Slicing_(const uint8_t* p, std::size_t n, uint32_t crc) noexcept {
+    return crcSlicing8_(kCrc32Tables, p, n, crc);
+}
+
+uint32_t crc32cSlicing_(const uint8_t* p, std::size_t n, uint32_t crc) noexcept {
+    return crcSlicing8_(kCrc32cTables, p, n, crc);
+}
+
+// ---- State hash ----
+//
+// Eight 64-bit lanes over 64-byte stripes: lane i accumulates lo32(d^k) * hi32(d^k) and its
+// neighbour accumulates the raw word (so zero words still contribute). Accumulators are scrambled
+// every kStripesPerBlock stripes. Only 32x32->64 multiplies are used, which map directly to
+// SSE2/AVX2 mul_epu32 and NEON vmlal_u32.
+
+constexpr std::size_t kStripeBytes = 64;
+constexpr std::size_t kStripesPerBlock = 16;
+constexpr std::size_t kBlockBytes = kStripeBytes * kStripesPerBlock;
+constexpr uint32_t kScramblePrime = 0x9E3779B1u;
+constexpr uint64_t kPrime64a = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime64b = 0x27D4EB2F165667C5ull;
+
+constexpr uint64_t splitmix64_(uint64_t i) noexcept {
+    uint64_t z = (i + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+struct HashKeys {
+    uint64_t secret[8] = {};
+    uint64_t scramble[8] = {};
+
+    constexpr HashKeys() {
+        for (uint64_t i = 0; i < 8; ++i) {
+            secret[i] = splitmix64_(i);
+            scramble[i] = splitmix64_(i + 8);
+        }
+    }
+};
+
+constexpr HashKeys kHashKeys;
+
+inline uint64_t fmix64_(uint64_t h) noexcept {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+inline void accumulateStripeScalar_(uint64_t acc[8], const uint8_t* p, const uint64_t key[8]) noexcept {
+    for (int i = 0; i < 8; ++i) {
+        const uint64_t d = load64_(p + i * 8);
+        const uint64_t dk = d ^ key[i];
+        acc[i ^ 1] += d;
+        acc[i] += static_cast<uint64_t>(static_cast<uint32_t>(dk)) * (dk >> 32);
+    }
+}
+
+inline void scrambleScalar_(uint64_t acc[8]) noexcept {
+    for (int i = 0; i < 8; ++i) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= kHashKeys.scramble[i];
+        acc[i] = a * kScramblePrime;
+    }
+}
+
+using HashBlocksFn = void (*)(uint64_t acc[8], const uint8_t* p, std::size_t blocks, const uint64_t key[8]);
+
+void hashBlocksScalar_(uint64_t acc[8], const uint8_t* p, std::size_t blocks, const uint64_t key[8]) noexcept {
+    for (std::size_t b = 0; b < blocks; ++b) {
+        for (std::size_t s = 0; s < kStripesPerBlock; ++s) accumulateStripeScalar_(acc, p + s * kStripeBytes, key);
+        scrambleScalar_(acc);
+        p += kBlockBytes;
+    }
+}
+
+uint64_t stateHashWith_(HashBlocksFn blocksFn, const void* data, std::size_t sizeBytes, uint64_t seed) noexcept {
+    const auto* p = static_cast<const uint8_t*>(data);
+
+    uint64_t key[8];
+    uint64_t acc[8];
+    for (int i = 0; i < 8; ++i) {
+        key[i] = kHashKeys.secret[i] + seed;
+        acc[i] = kHashKeys.scramble[i] ^ seed;
+    }
+
+    std::size_t n = p ? sizeBytes : 0;
+    const std::size_t blocks = n / kBlockBytes;
+    if (blocks) {
+        blocksFn(acc, p, blocks, key);
+        p += blocks * kBlockBytes;
+        n -= blocks * kBlockBytes;
+    }
+    while (n >= kStripeBytes) {
+        accumulateStripeScalar_(acc, p, key);
+        p += kStripeBytes;
+        n -= kStripeBytes;
+    }
+    if (n) {
+        uint8_t last[kStripeBytes] = {};
+        std::memcpy(last, p, n);
+        accumulateStripeScalar_(acc, last, key);
+    }
+
+    uint64_t h = static_cast<uint64_t>(sizeBytes) * kPrime64a ^ seed;
+    for (int i = 0; i < 8; ++i) {
+        h += fmix64_(acc[i] + kHashKeys.secret[i]);
+        h = ((h << 31) | (h >> 33)) * kPrime64a + kPrime64b;
+    }
+    return fmix64_(h);
+}
+
+#if defined(SNESONLINE_HASH_X86)
+
+// ---- x86-64 kernels ----
+
+SNESONLINE_TARGET("sse4.2")
+uint32_t crc32cSse42_(const uint8_t* p, std::size_t n, uint32_t crc) noexcept {
+    uint64_t c = crc;
+    while (n >= 32) {
+        c = _mm_crc32_u64(c, load64_(p));
+        c = _mm_crc32_u64(c, load64_(p + 8));
+        c = _mm_crc32_u64(c, load64_(p + 16));
+        c = _mm_crc32_u64(c, load64_(p + 24));
+        p += 32;
+        n -= 32;
+    }
+    while (n >= 8) {
+        c = _mm_crc32_u64(c, load64_(p));
+        p += 8;
+        n -= 8;
+    }
+    uint32_t c32 = static_cast<uint32_t>(c);
+    while (n--) c32 = _mm_crc32_u8(c32, *p++);
+    return c32;
+}
+
+// Carry-less multiply folding for the IEEE polynomial (Intel, "Fast CRC Computation for Generic
+// Polynomials Using PCLMULQDQ"). Requires n >= 64 and n % 16 == 0.
+SNESONLINE_TARGET("pclmul,sse4.1")
+uint32_t crc32Pclmul_(const uint8_t* p, std::size_t n, uint32_t crc) noexcept {
+    alignas(16) static const uint64_t k1k2[2] = {0x0154442bd4ull, 0x01c6e41596ull};
+    alignas(16) static const uint64_t k3k4[2] = {0x01751997d0ull, 0x00ccaa009eull};
+    alignas(16) static const uint64_t k5k0[2] = {0x0163cd6124ull, 0x0000000000ull};
+    alignas(16) static const uint64_t poly[2] = {0x01db710641ull, 0x01f7011641ull};
+
+    __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x00));
+    __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x10));
+    __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x20));
+    __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+    __m128i x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+    p += 64;
+    n -= 64;
+
+    // Fold 4x128 bits at a time.
+    while (n >= 64) {
+        const __m128i x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        const __m128i x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        const __m128i x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        const __m128i x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x30)));
+        p += 64;
+        n -= 64;
+    }
+
+    // Fold into 128 bits.
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+    __m128i x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // Single 128-bit folds for the remainder.
+    while (n >= 16) {
+        x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        p += 16;
+        n -= 16;
+    }
+
+    // Fold 128 -> 64 bits.
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+    x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits.
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+uint32_t crc32PclmulDispatch_(const uint8_t* p, std::size_t n, uint32_t crc) noexcept {
+    const std::size_t bulk = n & ~static_cast<std::size_t>(15);
+    if (bulk >= 64) {
+        crc = crc32Pclmul_(p, bulk, crc);
+        p += bulk;
+        n -= bulk;
+    }
+    return crc32Slicing_(p, n, crc);
+}
+
+void hashBlocksSse2_(uint64_t acc[8], const uint8_t* p, std::size_t blocks, const uint64_t key[8]) noexcept {
+    __m128i a[4];
+    __m128i k[4];
+    __m128i sk[4];
+    for (int j = 0; j < 4; ++j) {
+        a[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + j * 2));
+        k[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + j * 2));
+        sk[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kHashKeys.scramble + j * 2));
+    }
+    const __m128i prime = _mm_set1_epi32(static_cast<int>(kScramblePrime));
+
+    for (std::size_t b = 0; b < blocks; ++b) {
+        for (std::size_t s = 0; s < kStripesPerBlock; ++s) {
+            const uint8_t* stripe = p + s * kStripeBytes;
+            for (int j = 0; j < 4; ++j) {
+                const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(stripe + j * 16));
+                const __m128i dk = _mm_xor_si128(d, k[j]);
+                const __m128i prod = _mm_mul_epu32(dk, _mm_srli_epi64(dk, 32));
+                const __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+                a[j] = _mm_add_epi64(a[j], _mm_add_epi64(prod, swapped));
+            }
+        }
+        for (int j = 0; j < 4; ++j) {
+            __m128i v = _mm_xor_si128(a[j], _mm_srli_epi64(a[j], 47));
+            v = _mm_xor_si128(v, sk[j]);
+            const __m128i lo = _mm_mul_epu32(v, prime);
+            const __m128i hi = _mm_mul_epu32(_mm_srli_epi64(v, 32), prime);
+            a[j] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+        }
+        p += kBlockBytes;
+    }
+
+    for (int j = 0; j < 4; ++j) _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + j * 2), a[j]);
+}
+
+SNESONLINE_TARGET("avx2")
+void hashBlocksAvx2_(uint64_t acc[8], const uint8_t* p, std::size_t blocks, const uint64_t key[8]) noexcept {
+    __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc));
+    __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + 4));
+    const __m256i k0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key));
+    const __m256i k1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key + 4));
+    const __m256i sk0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kHashKeys.scramble));
+    const __m256i sk1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kHashKeys.scramble + 4));
+    const __m256i prime = _mm256_set1_epi32(static_cast<int>(kScramblePrime));
+
+    for (std::size_t b = 0; b < blocks; ++b) {
+        for (std::size_t s = 0; s < kStripesPerBlock; ++s) {
+            const uint8_t* stripe = p + s * kStripeBytes;
+            const __m256i d0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(stripe));
+            const __m256i d1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(stripe + 32));
+            const __m256i dk0 = _mm256_xor_si256(d0, k0);
+            const __m256i dk1 = _mm256_xor_si256(d1, k1);
+            const __m256i p0 = _mm256_mul_epu32(dk0, _mm256_srli_epi64(dk0, 32));
+            const __m256i p1 = _mm256_mul_epu32(dk1, _mm256_srli_epi64(dk1, 32));
+            a0 = _mm256_add_epi64(a0, _mm256_add_epi64(p0, _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2))));
+            a1 = _mm256_add_epi64(a1, _mm256_add_epi64(p1, _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2))));
+        }
+
+        __m256i v0 = _mm256_xor_si256(_mm256_xor_si256(a0, _mm256_srli_epi64(a0, 47)), sk0);
+        __m256i v1 = _mm256_xor_si256(_mm256_xor_si256(a1, _mm256_srli_epi64(a1, 47)), sk1);
+        a0 = _mm256_add_epi64(_mm256_mul_epu32(v0, prime), _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(v0, 32), prime), 32));
+        a1 = _mm256_add_epi64(_mm256_mul_epu32(v1, prime), _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(v1, 32), prime), 32));
+        p += kBlockBytes;
+    }
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc), a0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + 4), a1);
+}
+
+struct X86Features {
+    bool sse42 = false;
+    bool pclmul = false;
+    bool avx2 = false;
+};
+
+X86Features detectX86_() noexcept {
+    X86Features f;
+#if defined(_MSC_VER) && !defined(__clang__)
+    int r[4] = {};
+    __cpuid(r, 0);
+    const int maxLeaf = r[0];
+    __cpuid(r, 1);
+    f.sse42 = (r[2] & (1 << 20)) != 0;
+    f.pclmul = (r[2] & (1 << 1)) != 0;
+    const bool osxsave = (r[2] & (1 << 27)) != 0;
+    const bool avx = (r[2] & (1 << 28)) != 0;
+    const bool ymmEnabled = osxsave && avx && ((_xgetbv(0) & 6u) == 6u);
+    if (maxLeaf >= 7) {
+        __cpuidex(r, 7, 0);
+        f.avx2 = ymmEnabled && (r[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    f.sse42 = __builtin_cpu_supports("sse4.2");
+    f.pclmul = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+    f.avx2 = __builtin_cpu_supports("avx2");
+#endif
+    return f;
+}
+
+#elif defined(SNESONLINE_HASH_ARM64)
+
+// ---- arm64 kernels ----
+
+SNESONLINE_TARGET_ARM_CRC
+uint32_t crc32Arm_(const uint8_t* p, std::size_t n, uint32_t crc) noexcept {
+    while (n >= 32) {
+        crc = __crc32d(crc, load64_(p));
+        crc = __crc32d(crc, load64_(p + 8));
+        crc = __crc32d(crc, load64_(p + 16));
+        crc = __crc32d(crc, load64_(p + 24));
+        p += 32;
+        n -= 32;
+    }
+    while (n >= 8) {
+        crc = __crc32d(crc, load64_(p));
+        p += 8;
+        n -= 8;
+    }
+    while (n--) crc = __crc32b(crc, *p++);
+    return crc;
+}
+
+SNESONLINE_TARGET_ARM_CRC
+uint32_t crc32cArm_(const uint8_t* p, std::size_t n, uint32_t crc) noexcept {
+    while (n >= 32) {
+        crc = __crc32cd(crc, load64_(p));
+        crc = __crc32cd(crc, load64_(p + 8));
+        crc = __crc32cd(crc, load64_(p + 16));
+        crc = __crc32cd(crc, load64_(p + 24));
+        p += 32;
+        n -= 32;
+    }
+    while (n >= 8) {
+        crc = __crc32cd(crc, load64_(p));
+        p += 8;
+        n -= 8;
+    }
+    while (n--) crc = __crc32cb(crc, *p++);
+    return crc;
+}
+
+void hashBlocksNeon_(uint64_t acc[8], const uint8_t* p, std::size_t blocks, const uint64_t key[8]) noexcept {
+    uint64x2_t a[4];
+    uint64x2_t k[4];
+    uint64x2_t sk[4];
+    for (int j = 0; j < 4; ++j) {
+        a[j] = vld1q_u64(acc + j * 2);
+        k[j] = vld1q_u64(key + j * 2);
+        sk[j] = vld1q_u64(kHashKeys.scramble + j * 2);
+    }
+    const uint32x2_t prime = vdup_n_u32(kScramblePrime);
+
+    for (std::size_t b = 0; b < blocks; ++b) {
+        for (std::size_t s = 0; s < kStripesPerBlock; ++s) {
+            const uint8_t* stripe = p + s * kStripeBytes;
+            for (int j = 0; j < 4; ++j) {
+                const uint64x2_t d = vreinterpretq_u64_u8(vld1q_u8(stripe + j * 16));
+                const uint64x2_t dk = veorq_u64(d, k[j]);
+                a[j] = vaddq_u64(a[j], vextq_u64(d, d, 1));
+                a[j] = vmlal_u32(a[j], vmovn_u64(dk), vshrn_n_u64(dk, 32));
+            }
+        }
+        for (int j = 0; j < 4; ++j) {
+            uint64x2_t v = veorq_u64(a[j], vshrq_n_u64(a[j], 47));
+            v = veorq_u64(v, sk[j]);
+            const uint64x2_t lo = vmull_u32(vmovn_u64(v), prime);
+            const uint64x2_t hi = vmull_u32(vshrn_n_u64(v, 32), prime);
+            a[j] = vaddq_u64(lo, vshlq_n_u64(hi, 32));
+        }
+        p += kBlockBytes;
+    }
+
+    for (int j = 0; j < 4; ++j) vst1q_u64(acc + j * 2, a[j]);
+}
+
+bool detectArmCrc_() noexcept {
+#if defined(__ARM_FEATURE_CRC32)
+    return true;
+#elif defined(__APPLE__)
+    int v = 0;
+    std::size_t len = sizeof(v);
+    return sysctlbyname("hw.optional.armv8_crc32", &v, &len, nullptr, 0) == 0 && v != 0;
+#elif defined(__linux__)
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+    return false;
+#endif
+}
+
+#endif
+
+using CrcFn = uint32_t (*)(const uint8_t* p, std::size_t n, uint32_t crc);
+
+struct Kernels {
+    CrcFn crc32 = crc32Slicing_;
+    CrcFn crc32c = crc32cSlicing_;
+    HashBlocksFn hashBlocks = hashBlocksScalar_;
+    const char* crc32Name = "slicing-by-8";
+    const char* crc32cName = "slicing-by-8";
+    const char* hashName = "scalar";
+};
+
+Kernels selectKernels_() noexcept {
+    Kernels k;
+#if defined(SNESONLINE_HASH_X86)
+    const X86Features f = detectX86_();
+    if (f.pclmul) {
+        k.crc32 = crc32PclmulDispatch_;
+        k.crc32Name = "pclmul";
+    }
+    if (f.sse42) {
+        k.crc32c = crc32cSse42_;
+        k.crc32cName = "sse4.2";
+    }
+    k.hashBlocks = hashBlocksSse2_;
+    k.hashName = "sse2";
+    if (f.avx2) {
+        k.hashBlocks = hashBlocksAvx2_;
+        k.hashName = "avx2";
+    }
+#elif defined(SNESONLINE_HASH_ARM64)
+    if (detectArmCrc_()) {
+        k.crc32 = crc32Arm_;
+        k.crc32c = crc32cArm_;
+        k.crc32Name = "armv8-crc";
+        k.crc32cName = "armv8-crc";
+    }
+    k.hashBlocks = hashBlocksNeon_;
+    k.hashName = "neon";
+#endif
+    return k;
+}
+
+const Kernels& kernels_() noexcept {
+    static const Kernels k = selectKernels_();
+    return k;
+}
+
+} // namespace
+
+uint32_t crc32(const void* data, std::size_t sizeBytes, uint32_t crc) noexcept {
+    if (!data || sizeBytes == 0) return crc;
+    return ~kernels_().crc32(static_cast<const uint8_t*>(data), sizeBytes, ~crc);
+}
+
+uint32_t crc32c(const void* data, std::size_t sizeBytes, uint32_t crc) noexcept {
+    if (!data || sizeBytes == 0) return crc;
+    return ~kernels_().crc32c(static_cast<const uint8_t*>(data), sizeBytes, ~crc);
+}
+
+uint64_t stateHash64(const void* data, std::size_t sizeBytes, uint64_t seed) noexcept {
+    return stateHashWith_(kernels_().hashBlocks, data, sizeBytes, seed);
+}
+
+uint32_t stateHash32(const void* data, std::size_t sizeBytes, uint64_t seed) noexcept {
+    const uint64_t h = stateHash64(data, sizeBytes, seed);
+    return static_cast<uint32_t>(h ^ (h >> 32));
+}
+
+uint32_t crc32Portable(const void* data, std::size_t sizeBytes, uint32_t crc) noexcept {
+    if (!data || sizeBytes == 0) return crc;
+    return ~crc32Slicing_(static_cast<const uint8_t*>(data), sizeBytes, ~crc);
+}
+
+uint32_t crc32cPortable(const void* data, std::size_t sizeBytes, uint32_t crc) noexcept {
+    if (!data || sizeBytes == 0) return crc;
+    return ~crc32cSlicing_(static_cast<const uint8_t*>(data), sizeBytes, ~crc);
+}
+
+uint64_t stateHash64Portable(const void* data, std::size_t sizeBytes, uint64_t seed) noexcept {
+    return stateHashWith_(hashBlocksScalar_, data, sizeBytes, seed);
+}
+
+const char* crc32KernelName() noexcept { return kernels_().crc32Name; }
+const char* crc32cKernelName() noexcept { return kernels_().crc32cName; }
+const char* stateHashKernelName() noexcept { return kernels_().hashName; }
+
+} // namespace snesonline
@@ -0,0 +1,59 @@
+#include "snesonline/InputPacket.h"
+
+namespace snesonline {
+
+std::size_t encodeInputWindow(uint32_t newestFrame, const uint16_t* masks, uint32_t count, uint8_t* out,
+                              std::size_t capacity) noexcept {
+    if (!masks || !out || count == 0 || count > kMaxInputWindow || count - 1 > newestFrame) return 0;
+    if (capacity < 5) return 0;
+
+    out[0] = static_cast<uint8_t>(newestFrame >> 24);
+    out[1] = static_cast<uint8_t>(newestFrame >> 16);
+    out[2] = static_cast<uint8_t>(newestFrame >> 8);
+    out[3] = static_cast<uint8_t>(newestFrame);
+    out[4] = static_cast<uint8_t>(count);
+    std::size_t pos = 5;
+
+    uint32_t i = 0;
+    while (i < count) {
+        const uint16_t m = masks[i];
+        uint32_t run = 1;
+        while (i + run < count && masks[i + run] == m && run < 255) ++run;
+        if (pos + 3 > capacity) return 0;
+        out[pos + 0] = static_cast<uint8_t>(run);
+        out[pos + 1] = static_cast<uint8_t>(m >> 8);
+        out[pos + 2] = static_cast<uint8_t>(m);
+        pos += 3;
+        i += run;
+    }
+    return pos;
+}
+
+bool decodeInputWindow(const uint8_t* data, std::size_t sizeBytes, uint32_t& outNewestFrame, uint16_t* outMasks,
+                       uint32_t& outCount) noexcept {
+    if (!data || !outMasks || sizeBytes < 5) return false;
+
+    const uint32_t newest = (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+                            (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+    const uint32_t count = data[4];
+    if (count == 0 || count > kMaxInputWindow || count - 1 > newest) return false;
+
+    std::size_t pos = 5;
+    uint32_t filled = 0;
+    while (filled < count) {
+        if (pos + 3 > sizeBytes) return false;
+        const uint32_t run = data[pos];
+        const uint16_t m = static_cast<uint16_t>((static_cast<uint16_t>(data[pos + 1]) << 8) | data[pos + 2]);
+        pos += 3;
+        if (run == 0 || filled + run > count) return false;
+        for (uint32_t k = 0; k < run; ++k) outMasks[filled + k] = m;
+        filled += run;
+    }
+    if (pos != sizeBytes) return false;
+
+    outNewestFrame = newest;
+    outCount = count;
+    return true;
+}
+
+} // namespace snesonline
@@ -0,0 +1,127 @@
+#pragma once
+
+// Internal wire helpers shared by LockstepSession and RollbackSession.
+//
+// v1 (legacy, exactly 8 bytes, one datagram per frame in the resend window):
+//   u32 frame, u16 mask, u16 reserved
+// v2 (one datagram per frame, never 8 bytes long so v1-only peers drop it):
+//   u16 magic 'S2', u16 aux (same meaning as the v1 reserved field), input window (InputPacket.h)
+//
+// Which formats to send is decided by InputPacketNegotiator (InputPacket.h).
+//
+// Control (exactly 12 bytes, like a v2 packet with one short run; dispatch on the magic, not the
+// size. Older peers drop anything that is not an input packet):
+//   u16 magic 'SP' (ping) or 'SQ' (pong)
+//   u16 delay      ping only: proposed input delay, 0 = no proposal
+//   u32 timeUs     sender's clock; a pong echoes the ping's value
+//   u32 applyFrame ping only: first frame that uses `delay`
+
+#include <cstddef>
+#include <cstdint>
+
+#include "snesonline/InputPacket.h"
+
+namespace snesonline::wire {
+
+#pragma pack(push, 1)
+struct InputPacketV1 {
+    uint32_t frame_be;
+    uint16_t mask_be;
+    uint16_t reserved_be;
+};
+#pragma pack(pop)
+static_assert(sizeof(InputPacketV1) == 8, "v1 input packet must stay 8 bytes");
+
+static constexpr uint16_t kInputV2Magic = 0x5332u; // 'S2'
+static constexpr std::size_t kInputV2HeaderBytes = 4;
+static constexpr std::size_t kMaxInputV2Bytes = kInputV2HeaderBytes + kMaxInputWindowBytes;
+
+static constexpr uint16_t kPingMagic = 0x5350u; // 'SP'
+static constexpr uint16_t kPongMagic = 0x5351u; // 'SQ'
+static constexpr std::size_t kControlBytes = 12;
+
+struct ControlPacket {
+    uint16_t magic = 0;
+    uint16_t delay = 0;
+    uint32_t timeUs = 0;
+    uint32_t applyFrame = 0;
+};
+
+inline void buildControl(const ControlPacket& c, uint8_t (&out)[kControlBytes]) noexcept {
+    out[0] = static_cast<uint8_t>(c.magic >> 8);
+    out[1] = static_cast<uint8_t>(c.magic);
+    out[2] = static_cast<uint8_t>(c.delay >> 8);
+    out[3] = static_cast<uint8_t>(c.delay);
+    for (int i = 0; i < 4; ++i) {
+        out[4 + i] = static_cast<uint8_t>(c.timeUs >> (24 - 8 * i));
+        out[8 + i] = static_cast<uint8_t>(c.applyFrame >> (24 - 8 * i));
+    }
+}
+
+// Control packets share their size with some v2 input packets; only the magic tells them apart.
+inline bool isControl(const uint8_t* data, std::size_t sizeBytes) noexcept {
+    if (sizeBytes != kControlBytes) return false;
+    const uint16_t magic = static_cast<uint16_t>((static_cast<uint16_t>(data[0]) << 8) | data[1]);
+    return magic == kPingMagic || magic == kPongMagic;
+}
+
+inline bool parseControl(const uint8_t* data, std::size_t sizeBytes, ControlPacket& out) noexcept {
+    if (sizeBytes != kControlBytes) return false;
+    const uint16_t magic = static_cast<uint16_t>((static_cast<uint16_t>(data[0]) << 8) | data[1]);
+    if (magic != kPingMagic && magic != kPongMagic) return false;
+    out.magic = magic;
+    out.delay = static_cast<uint16_t>((static_cast<uint16_t>(data[2]) << 8) | data[3]);
+    out.timeUs = 0;
+    out.applyFrame = 0;
+    for (int i = 0; i < 4; ++i) {
+        out.timeUs = (out.timeUs << 8) | data[4 + i];
+        out.applyFrame = (out.applyFrame << 8) | data[8 + i];
+    }
+    return true;
+}
+
+// IPv4 + UDP header bytes, for on-the-wire accounting.
+static constexpr std::size_t kUdpIpv4OverheadBytes = 28;
+
+inline std::size_t buildInputV2(uint16_t aux, uint32_t newestFrame, const uint16_t* masks, uint32_t count, uint8_t* out,
+                                std::size_t capacity) noexcept {
+    if (capacity < kInputV2HeaderBytes) return 0;
+    out[0] = static_cast<uint8_t>(kInputV2Magic >> 8);
+    out[1] = static_cast<uint8_t>(kInputV2Magic & 0xFFu);
+    out[2] = static_cast<uint8_t>(aux >> 8);
+    out[3] = static_cast<uint8_t>(aux & 0xFFu);
+    const std::size_t n = encodeInputWindow(newestFrame, masks, count, out + kInputV2HeaderBytes, capacity - kInputV2HeaderBytes);
+    return n ? (kInputV2HeaderBytes + n) : 0;
+}
+
+inline bool isInputV2(const uint8_t* data, std::size_t sizeBytes) noexcept {
+    return sizeBytes > kInputV2HeaderBytes && sizeBytes != sizeof(InputPacketV1) &&
+           data[0] == static_cast<uint8_t>(kInputV2Magic >> 8) && data[1] == static_cast<uint8_t>(kInputV2Magic & 0xFFu);
+}
+
+inline bool parseInputV2(const uint8_t* data, std::size_t sizeBytes, uint16_t& outAux, uint32_t& outNewestFrame,
+                         uint16_t* outMasks, uint32_t& outCount) noexcept {
+    if (!isInputV2(data, sizeBytes)) return false;
+    outAux = static_cast<uint16_t>((static_cast<uint16_t>(data[2]) << 8) | data[3]);
+    return decodeInputWindow(data + kInputV2HeaderBytes, sizeBytes - kInputV2HeaderBytes, outNewestFrame, outMasks, outCount);
+}
+
+// Gathers the contiguous run of scheduled local inputs ending at `newestFrame` (oldest first).
+// Returns the number of masks written (0 if newestFrame itself is not scheduled).
+template <uint32_t N>
+inline uint32_t collectInputWindow(const uint16_t (&sentMask)[N], const uint32_t (&sentFrameTag)[N], uint32_t newestFrame,
+                                   uint32_t maxCount, uint16_t* outMasks) noexcept {
+    uint32_t count = 0;
+    while (count < maxCount && count <= newestFrame) {
+        const uint32_t f = newestFrame - count;
+        if (sentFrameTag[f % N] != f) break;
+        ++count;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t f = newestFrame - count + 1 + i;
+        outMasks[i] = sentMask[f % N];
+    }
+    return count;
+}
+
+} // namespace snesonline::wire
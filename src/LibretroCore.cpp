@@ -2,30 +2,198 @@
 
 #include "snesonline/InputBits.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <mutex>
+#include <vector>
 
 #if defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #else
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 namespace snesonline {
 
-std::atomic<uint16_t> LibretroCore::inputMasks_[2] = {0, 0};
-void* LibretroCore::videoCtx_ = nullptr;
-LibretroCore::VideoRefreshFn LibretroCore::videoFn_ = nullptr;
-void* LibretroCore::audioCtx_ = nullptr;
-LibretroCore::AudioSampleBatchFn LibretroCore::audioFn_ = nullptr;
-// Initialize to RETRO_PIXEL_FORMAT_XRGB8888 (1) without depending on constants declared below.
-std::atomic<int> LibretroCore::pixelFormatRaw_{1};
+namespace {
+
+// Core that libretro callbacks on this thread belong to (set around every call into a core).
+thread_local LibretroCore* t_activeCore = nullptr;
+// First loaded core; receives callbacks made from threads the core spawned itself.
+std::atomic<LibretroCore*> g_primaryCore{nullptr};
+
+// Identities (identityOf) of the core files currently loaded by some instance (one entry per instance).
+std::mutex g_loadedPathsMutex;
+std::vector<std::string> g_loadedPaths;
+std::atomic<uint32_t> g_copyCounter{0};
+
+// Key under which the loader would treat two paths as the same image: the file itself (device and
+// inode) on POSIX, the full path on Windows. Relative paths, symlinks and "./" all map to one key.
+// Names the loader resolves itself (no such file here) are keyed as given.
+bool identityOf(const char* path, std::string& out) noexcept {
+    try {
+#if defined(_WIN32)
+        char full[MAX_PATH + 1] = {};
+        const DWORD len = GetFullPathNameA(path, static_cast<DWORD>(sizeof(full)), full, nullptr);
+        if (len == 0 || len > MAX_PATH) {
+            out = path;
+            return true;
+        }
+        out.assign(full, len);
+        for (char& c : out) {
+            if (c == '/') c = '\\';
+            else if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        }
+#else
+        struct stat st {};
+        if (::stat(path, &st) != 0) {
+            out = path;
+            return true;
+        }
+        char key[48];
+        std::snprintf(key, sizeof(key), "%llx:%llx", static_cast<unsigned long long>(st.st_dev), static_cast<unsigned long long>(st.st_ino));
+        out = key;
+#endif
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+// Copies `from` to `to`, which must not exist yet: an existing file or symlink there fails the copy
+// instead of being written through.
+bool copyToNewFile(const char* from, const char* to) noexcept {
+    std::FILE* in = std::fopen(from, "rb");
+    if (!in) return false;
+#if defined(_WIN32)
+    HANDLE out = CreateFileA(to, GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (out == INVALID_HANDLE_VALUE) {
+        std::fclose(in);
+        return false;
+    }
+#else
+    const int out = ::open(to, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0700);
+    if (out < 0) {
+        std::fclose(in);
+        return false;
+    }
+#endif
+    char buf[64 * 1024];
+    bool ok = true;
+    std::size_t n = 0;
+    while (ok && (n = std::fread(buf, 1, sizeof(buf), in)) > 0) {
+#if defined(_WIN32)
+        DWORD written = 0;
+        ok = WriteFile(out, buf, static_cast<DWORD>(n), &written, nullptr) && written == n;
+#else
+        for (std::size_t off = 0; ok && off < n;) {
+            const ssize_t w = ::write(out, buf + off, n - off);
+            if (w > 0) off += static_cast<std::size_t>(w);
+            else if (w < 0 && errno == EINTR) continue;
+            else ok = false;
+        }
+#endif
+    }
+    if (std::ferror(in)) ok = false;
+    std::fclose(in);
+#if defined(_WIN32)
+    if (!CloseHandle(out)) ok = false;
+#else
+    if (::close(out) != 0) ok = false;
+#endif
+    if (!ok) std::remove(to);
+    return ok;
+}
+
+// Copies the core into a new private directory so the loader maps a second, independent image (its
+// own globals). On POSIX the directory comes from mkdtemp (random name, mode 0700) under $TMPDIR,
+// /tmp or the core's own directory (Android has no /tmp; its cores live in the app's private files),
+// so nobody else can plant or swap the file before it is loaded. Windows uses the per-user temp
+// directory. Fails rather than falling back to a predictable path.
+bool makePrivateCopy(const std::string& corePath, std::string& outDir, std::string& outPath) noexcept {
+    try {
+        const std::size_t slash = corePath.find_last_of("/\\");
+        const std::string dir = (slash == std::string::npos) ? std::string(".") : corePath.substr(0, slash);
+        const std::string base = (slash == std::string::npos) ? corePath : corePath.substr(slash + 1);
+
+#if defined(_WIN32)
+        char tmp[MAX_PATH + 1] = {};
+        const DWORD len = GetTempPathA(static_cast<DWORD>(sizeof(tmp)), tmp);
+        if (len == 0 || len > MAX_PATH) return false;
+        char name[96];
+        std::snprintf(name, sizeof(name), "snesonline-core-%lu-%u-%llx", static_cast<unsigned long>(GetCurrentProcessId()), g_copyCounter.fetch_add(1),
+                      static_cast<unsigned long long>(GetTickCount64()));
+        const std::string privateDir = std::string(tmp, len) + name;
+        if (!CreateDirectoryA(privateDir.c_str(), nullptr)) return false;
+        const std::string path = privateDir + "\\" + base;
+        if (!copyToNewFile(corePath.c_str(), path.c_str())) {
+            RemoveDirectoryA(privateDir.c_str());
+            return false;
+        }
+        outDir = privateDir;
+        outPath = path;
+        return true;
+#else
+        std::vector<std::string> parents;
+        const char* env = std::getenv("TMPDIR");
+        if (env && env[0]) parents.emplace_back(env);
+        parents.emplace_back("/tmp");
+        parents.push_back(dir);
+        for (std::string& parent : parents) {
+            if (parent.back() != '/') parent += '/';
+            std::string tmpl = parent + "snesonline-core-XXXXXX";
+            if (!::mkdtemp(&tmpl[0])) continue;
+            const std::string path = tmpl + "/" + base;
+            if (copyToNewFile(corePath.c_str(), path.c_str())) {
+                outDir = tmpl;
+                outPath = path;
+                return true;
+            }
+            ::rmdir(tmpl.c_str());
+        }
+#endif
+    } catch (...) {
+    }
+    return false;
+}
+
+} // namespace
+
+class LibretroCore::ActiveScope {
+public:
+    explicit ActiveScope(const LibretroCore* core) noexcept : prev_(t_activeCore) {
+        t_activeCore = const_cast<LibretroCore*>(core);
+    }
+    ~ActiveScope() noexcept { t_activeCore = prev_; }
+
+    ActiveScope(const ActiveScope&) = delete;
+    ActiveScope& operator=(const ActiveScope&) = delete;
+
+private:
+    LibretroCore* prev_;
+};
+
+LibretroCore* LibretroCore::active_() noexcept {
+    LibretroCore* c = t_activeCore;
+    return c ? c : g_primaryCore.load(std::memory_order_acquire);
+}
 
 // Minimal libretro command/format values used by this host.
 static constexpr unsigned RETRO_ENVIRONMENT_SET_PIXEL_FORMAT = 10;
 static constexpr unsigned RETRO_ENVIRONMENT_GET_LOG_INTERFACE = 27;
 static constexpr unsigned RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY = 9;
 static constexpr unsigned RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY = 31;
+static constexpr unsigned RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE = 47 | 0x10000; // RETRO_ENVIRONMENT_EXPERIMENTAL
+
+static constexpr int RETRO_AV_ENABLE_VIDEO = 1;
+static constexpr int RETRO_AV_ENABLE_AUDIO = 2;
 
 static constexpr int RETRO_PIXEL_FORMAT_0RGB1555 = 0;
 static constexpr int RETRO_PIXEL_FORMAT_XRGB8888 = 1;
@@ -52,13 +220,37 @@ void* LibretroCore::resolve_(const char* name) noexcept {
 
 bool LibretroCore::load(const char* corePath) noexcept {
     unload();
+    if (!corePath || !corePath[0]) return false;
+
+    // Loading the same file twice (under any path that resolves to it) would hand back the already
+    // mapped image and its globals.
+    bool shared = false;
+    try {
+        std::string key;
+        if (!identityOf(corePath, key)) return false;
+        std::lock_guard<std::mutex> lock(g_loadedPathsMutex);
+        shared = std::find(g_loadedPaths.begin(), g_loadedPaths.end(), key) != g_loadedPaths.end();
+        g_loadedPaths.push_back(key);
+        loadedKey_ = std::move(key);
+        loadedPath_ = corePath;
+    } catch (...) {
+        return false;
+    }
+    if (shared && !makePrivateCopy(loadedPath_, privateCopyDir_, privateCopyPath_)) {
+        unload();
+        return false;
+    }
+    const char* loadPath = privateCopyPath_.empty() ? corePath : privateCopyPath_.c_str();
 
 #if defined(_WIN32)
-    handle_ = static_cast<void*>(LoadLibraryA(corePath));
+    handle_ = static_cast<void*>(LoadLibraryA(loadPath));
 #else
-    handle_ = dlopen(corePath, RTLD_NOW);
+    handle_ = dlopen(loadPath, RTLD_NOW | RTLD_LOCAL);
 #endif
-    if (!handle_) return false;
+    if (!handle_) {
+        unload();
+        return false;
+    }
 
     retro_init_ = reinterpret_cast<void (*)()>(resolve_("retro_init"));
     retro_deinit_ = reinterpret_cast<void (*)()>(resolve_("retro_deinit"));
@@ -75,6 +267,7 @@ bool LibretroCore::load(const char* corePath) noexcept {
     retro_set_input_poll_ = reinterpret_cast<void (*)(void (*)(void))>(resolve_("retro_set_input_poll"));
     retro_set_input_state_ = reinterpret_cast<void (*)(int16_t (*)(unsigned, unsigned, unsigned, unsigned))>(resolve_("retro_set_input_state"));
 
+    retro_get_system_info_ = reinterpret_cast<void (*)(void*)>(resolve_("retro_get_system_info"));
     retro_get_system_av_info_ = reinterpret_cast<void (*)(void*)>(resolve_("retro_get_system_av_info"));
     retro_set_environment_ = reinterpret_cast<void (*)(bool (*)(unsigned, void*))>(resolve_("retro_set_environment"));
     retro_set_video_refresh_ = reinterpret_cast<void (*)(void (*)(const void*, unsigned, unsigned, size_t))>(resolve_("retro_set_video_refresh"));
@@ -90,6 +283,10 @@ bool LibretroCore::load(const char* corePath) noexcept {
         return false;
     }
 
+    LibretroCore* expected = nullptr;
+    g_primaryCore.compare_exchange_strong(expected, this, std::memory_order_acq_rel);
+
+    ActiveScope scope(this);
     if (retro_set_environment_) retro_set_environment_(&LibretroCore::environment_);
     if (retro_set_video_refresh_) retro_set_video_refresh_(&LibretroCore::videoRefresh_);
     if (retro_set_audio_sample_) retro_set_audio_sample_(&LibretroCore::audioSample_);
@@ -100,23 +297,71 @@ bool LibretroCore::load(const char* corePath) noexcept {
     retro_init_();
     (void)retro_api_version_;
 
+    if (retro_get_system_info_) {
+        // Minimal retro_system_info layout.
+        struct RetroSystemInfo {
+            const char* library_name;
+            const char* library_version;
+            const char* valid_extensions;
+            bool need_fullpath;
+            bool block_extract;
+        } info{};
+        retro_get_system_info_(&info);
+        try {
+            libraryName_ = info.library_name ? info.library_name : "";
+            libraryVersion_ = info.library_version ? info.library_version : "";
+        } catch (...) {
+            libraryName_.clear();
+            libraryVersion_.clear();
+        }
+    }
+
     return true;
 }
 
 void LibretroCore::unload() noexcept {
-    if (!handle_) return;
+    if (!handle_ && loadedPath_.empty()) return;
 
-    unloadGame();
-
-    if (retro_deinit_) retro_deinit_();
+    if (handle_) {
+        {
+            ActiveScope scope(this);
+            unloadGame();
+            if (retro_deinit_) retro_deinit_();
+        }
 
 #if defined(_WIN32)
-    FreeLibrary(static_cast<HMODULE>(handle_));
+        FreeLibrary(static_cast<HMODULE>(handle_));
 #else
-    dlclose(handle_);
+        dlclose(handle_);
 #endif
+        handle_ = nullptr;
+    }
 
-    handle_ = nullptr;
+    LibretroCore* self = this;
+    g_primaryCore.compare_exchange_strong(self, nullptr, std::memory_order_acq_rel);
+
+    if (!privateCopyPath_.empty()) {
+        std::remove(privateCopyPath_.c_str());
+        privateCopyPath_.clear();
+    }
+    if (!privateCopyDir_.empty()) {
+#if defined(_WIN32)
+        RemoveDirectoryA(privateCopyDir_.c_str());
+#else
+        ::rmdir(privateCopyDir_.c_str());
+#endif
+        privateCopyDir_.clear();
+    }
+    if (!loadedKey_.empty()) {
+        std::lock_guard<std::mutex> lock(g_loadedPathsMutex);
+        const auto it = std::find(g_loadedPaths.begin(), g_loadedPaths.end(), loadedKey_);
+        if (it != g_loadedPaths.end()) g_loadedPaths.erase(it);
+        loadedKey_.clear();
+    }
+    loadedPath_.clear();
+    libraryName_.clear();
+    libraryVersion_.clear();
+    romPath_.clear();
 
     retro_init_ = nullptr;
     retro_deinit_ = nullptr;
@@ -133,6 +378,7 @@ void LibretroCore::unload() noexcept {
     retro_set_input_poll_ = nullptr;
     retro_set_input_state_ = nullptr;
 
+    retro_get_system_info_ = nullptr;
     retro_get_system_av_info_ = nullptr;
     retro_set_environment_ = nullptr;
     retro_set_video_refresh_ = nullptr;
@@ -149,8 +395,9 @@ void LibretroCore::unload() noexcept {
     videoFn_ = nullptr;
     audioCtx_ = nullptr;
     audioFn_ = nullptr;
+    audioAccumFrames_ = 0;
 
-    pixelFormatRaw_.store(1 /* RETRO_PIXEL_FORMAT_XRGB8888 */, std::memory_order_relaxed);
+    pixelFormatRaw_ = RETRO_PIXEL_FORMAT_XRGB8888;
 
     pixelFormat_ = PixelFormat::XRGB8888;
     fps_ = 60.0;
@@ -181,9 +428,16 @@ bool LibretroCore::loadGame(const char* romPath) noexcept {
     std::memset(&info, 0, sizeof(info));
     info.path = romPath;
 
+    ActiveScope scope(this);
     const bool ok = retro_load_game_(&info);
     if (!ok) return false;
 
+    try {
+        romPath_ = romPath ? romPath : "";
+    } catch (...) {
+        romPath_.clear();
+    }
+
     // Pull AV info if available to configure host timing/audio.
     // Minimal retro_system_av_info layout.
     struct RetroGameGeometry {
@@ -210,7 +464,7 @@ bool LibretroCore::loadGame(const char* romPath) noexcept {
     }
 
     // Map negotiated pixel format into the public enum.
-    switch (pixelFormatRaw_.load(std::memory_order_relaxed)) {
+    switch (pixelFormatRaw_) {
         case RETRO_PIXEL_FORMAT_RGB565:
             pixelFormat_ = PixelFormat::RGB565;
             break;
@@ -228,12 +482,18 @@ bool LibretroCore::loadGame(const char* romPath) noexcept {
 
 void LibretroCore::unloadGame() noexcept {
     if (retro_unload_game_) {
+        ActiveScope scope(this);
         retro_unload_game_();
     }
 }
 
-void LibretroCore::runFrame() noexcept {
-    if (retro_run_) retro_run_();
+void LibretroCore::runFrame(bool video, bool audio) noexcept {
+    if (!retro_run_) return;
+    ActiveScope scope(this);
+    avEnable_ = (video ? RETRO_AV_ENABLE_VIDEO : 0) | (audio ? RETRO_AV_ENABLE_AUDIO : 0);
+    retro_run_();
+    flushAudio_();
+    avEnable_ = RETRO_AV_ENABLE_VIDEO | RETRO_AV_ENABLE_AUDIO;
 }
 
 std::size_t LibretroCore::serializeSize() const noexcept {
@@ -243,11 +503,13 @@ std::size_t LibretroCore::serializeSize() const noexcept {
 
 bool LibretroCore::serialize(void* dst, std::size_t sizeBytes) const noexcept {
     if (!retro_serialize_) return false;
+    ActiveScope scope(this);
     return retro_serialize_(dst, static_cast<size_t>(sizeBytes));
 }
 
 bool LibretroCore::unserialize(const void* src, std::size_t sizeBytes) noexcept {
     if (!retro_unserialize_) return false;
+    ActiveScope scope(this);
     return retro_unserialize_(src, static_cast<size_t>(sizeBytes));
 }
 
@@ -272,20 +534,21 @@ void LibretroCore::setAudioSink(void* ctx, AudioSampleBatchFn fn) noexcept {
 }
 
 void LibretroCore::inputPoll_() noexcept {
-    // No-op: inputMask_ is already set by the host.
+    // No-op: inputMasks_ is already set by the host.
 }
 
 int16_t LibretroCore::inputState_(unsigned port, unsigned device, unsigned index, unsigned id) noexcept {
     (void)index;
 
-    if (port >= 2) return 0;
+    LibretroCore* self = active_();
+    if (!self || port >= 2) return 0;
 
     // Device/id values match libretro: device=RETRO_DEVICE_JOYPAD, id=RETRO_DEVICE_ID_JOYPAD_*
     // We map a subset (common SNES ids). If the core asks for unknown ids, return 0.
     // Known ordering in libretro joypad: B,Y,SELECT,START,UP,DOWN,LEFT,RIGHT,A,X,L,R
     if (device != 1 /* RETRO_DEVICE_JOYPAD */) return 0;
 
-    const uint16_t inputMask = inputMasks_[port].load(std::memory_order_relaxed);
+    const uint16_t inputMask = self->inputMasks_[port].load(std::memory_order_relaxed);
 
     switch (id) {
         case 0: return (inputMask & SNES_B) ? 1 : 0;
@@ -308,17 +571,14 @@ bool LibretroCore::environment_(unsigned cmd, void* data) noexcept {
     // Keep this minimal; many cores require pixel format to be accepted.
     switch (cmd) {
         case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT: {
-            if (!data) return false;
+            LibretroCore* self = active_();
+            if (!data || !self) return false;
             const int fmt = *static_cast<const int*>(data);
             switch (fmt) {
                 case RETRO_PIXEL_FORMAT_0RGB1555:
-                    pixelFormatRaw_.store(RETRO_PIXEL_FORMAT_0RGB1555, std::memory_order_relaxed);
-                    return true;
                 case RETRO_PIXEL_FORMAT_XRGB8888:
-                    pixelFormatRaw_.store(RETRO_PIXEL_FORMAT_XRGB8888, std::memory_order_relaxed);
-                    return true;
                 case RETRO_PIXEL_FORMAT_RGB565:
-                    pixelFormatRaw_.store(RETRO_PIXEL_FORMAT_RGB565, std::memory_order_relaxed);
+                    self->pixelFormatRaw_ = fmt;
                     return true;
                 default:
                     return false;
@@ -341,25 +601,45 @@ bool LibretroCore::environment_(unsigned cmd, void* data) noexcept {
             return true;
         }
 
+        case RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE: {
+            LibretroCore* self = active_();
+            if (!data || !self) return false;
+            *static_cast<int*>(data) = self->avEnable_;
+            return true;
+        }
+
         default:
             return false;
     }
 }
 
 void LibretroCore::videoRefresh_(const void* data, unsigned width, unsigned height, size_t pitch) noexcept {
-    if (!videoFn_) return;
-    videoFn_(videoCtx_, data, width, height, static_cast<std::size_t>(pitch));
+    LibretroCore* self = active_();
+    if (!self || !self->videoFn_ || !(self->avEnable_ & RETRO_AV_ENABLE_VIDEO)) return;
+    self->videoFn_(self->videoCtx_, data, width, height, static_cast<std::size_t>(pitch));
 }
 
 void LibretroCore::audioSample_(int16_t left, int16_t right) noexcept {
-    if (!audioFn_) return;
-    const int16_t stereo[2] = {left, right};
-    audioFn_(audioCtx_, stereo, 1);
+    LibretroCore* self = active_();
+    if (!self || !self->audioFn_ || !(self->avEnable_ & RETRO_AV_ENABLE_AUDIO)) return;
+    int16_t* dst = self->audioAccum_ + self->audioAccumFrames_ * 2;
+    dst[0] = left;
+    dst[1] = right;
+    if (++self->audioAccumFrames_ == kAudioAccumFrames) self->flushAudio_();
 }
 
 size_t LibretroCore::audioSampleBatch_(const int16_t* data, size_t frames) noexcept {
-    if (!audioFn_) return frames;
-    return static_cast<size_t>(audioFn_(audioCtx_, data, static_cast<std::size_t>(frames)));
+    LibretroCore* self = active_();
+    if (!self || !self->audioFn_ || !(self->avEnable_ & RETRO_AV_ENABLE_AUDIO)) return frames;
+    // Keep order if a core mixes both callbacks.
+    if (self->audioAccumFrames_) self->flushAudio_();
+    return static_cast<size_t>(self->audioFn_(self->audioCtx_, data, static_cast<std::size_t>(frames)));
+}
+
+void LibretroCore::flushAudio_() noexcept {
+    if (audioAccumFrames_ == 0) return;
+    if (audioFn_) audioFn_(audioCtx_, audioAccum_, audioAccumFrames_);
+    audioAccumFrames_ = 0;
 }
 
 } // namespace snesonline
@@ -1,207 +1,39 @@
 #include "snesonline/LockstepSession.h"
 
 #include "snesonline/EmulatorEngine.h"
+#include "snesonline/Profiler.h"
+
+#include "InputWire.h"
+#include "NetSocket.h"
 
 #include <cstdint>
 #include <cstring>
-#include <thread>
-
-#if defined(_WIN32)
-#include <WinSock2.h>
-#include <ws2tcpip.h>
-#pragma comment(lib, "ws2_32.lib")
-#else
-#include <arpa/inet.h>
-#include <fcntl.h>
-#include <netdb.h>
-#include <sys/socket.h>
-#include <unistd.h>
-#endif
 
 namespace snesonline {
 
-namespace {
-
-#if defined(_WIN32)
-static bool ensureWinSockInitialized() noexcept {
-    static bool ok = false;
-    static bool tried = false;
-    if (tried) return ok;
-    tried = true;
-    WSADATA wsa{};
-    ok = (WSAStartup(MAKEWORD(2, 2), &wsa) == 0);
-    return ok;
-}
-#endif
-
-static bool isValidIpv4Address(const char* ip) noexcept {
-    if (!ip || !ip[0]) return false;
-#if defined(_WIN32)
-    IN_ADDR addr{};
-    return InetPtonA(AF_INET, ip, &addr) == 1;
-#else
-    in_addr addr{};
-    return inet_pton(AF_INET, ip, &addr) == 1;
-#endif
-}
-
-static bool resolveIpv4ToSockaddr(const char* hostOrIp, sockaddr_in& out, uint16_t port) noexcept {
-    if (!hostOrIp || !hostOrIp[0]) return false;
-
-    // Fast path: numeric IPv4.
-    if (isValidIpv4Address(hostOrIp)) {
-        out = {};
-        out.sin_family = AF_INET;
-        out.sin_port = htons(port);
-#if defined(_WIN32)
-        InetPtonA(AF_INET, hostOrIp, &out.sin_addr);
-#else
-        inet_pton(AF_INET, hostOrIp, &out.sin_addr);
-#endif
-        return true;
-    }
-
-    addrinfo hints{};
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_DGRAM;
-
-    addrinfo* res = nullptr;
-    if (getaddrinfo(hostOrIp, nullptr, &hints, &res) != 0 || !res) return false;
-
-    bool ok = false;
-    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
-        if (!ai->ai_addr || ai->ai_family != AF_INET) continue;
-        const auto* sin = reinterpret_cast<const sockaddr_in*>(ai->ai_addr);
-        out = *sin;
-        out.sin_port = htons(port);
-        ok = true;
-        break;
-    }
-
-    freeaddrinfo(res);
-    return ok;
-}
-
-static bool setSocketNonBlocking(
-#if defined(_WIN32)
-    SOCKET s
-#else
-    int s
-#endif
-) noexcept {
-#if defined(_WIN32)
-    u_long mode = 1;
-    return ioctlsocket(s, FIONBIO, &mode) == 0;
-#else
-    const int flags = fcntl(s, F_GETFL, 0);
-    if (flags < 0) return false;
-    return fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
-#endif
-}
-
-#pragma pack(push, 1)
-struct Packet {
-    uint32_t frame_be;
-    uint16_t mask_be;
-    uint16_t reserved_be;
-};
-#pragma pack(pop)
-
-static bool parsePeerLine(const char* data, int len, sockaddr_in& outPeer) noexcept {
-    if (!data || len <= 0) return false;
-    // Expect: "SNO_PEER1 ip port\n"
-    if (len < 10) return false;
-    if (std::memcmp(data, "SNO_PEER1", 9) != 0) return false;
-
-    // Copy into a small NUL-terminated buffer for sscanf.
-    char buf[128] = {};
-    const int n = (len >= static_cast<int>(sizeof(buf))) ? (static_cast<int>(sizeof(buf)) - 1) : len;
-    std::memcpy(buf, data, static_cast<size_t>(n));
-    buf[n] = '\0';
-
-    char ip[64] = {};
-    int port = 0;
-    if (std::sscanf(buf, "SNO_PEER1 %63s %d", ip, &port) != 2) return false;
-    if (port < 1 || port > 65535) return false;
-
-    sockaddr_in peer{};
-    if (!resolveIpv4ToSockaddr(ip, peer, static_cast<uint16_t>(port))) return false;
-    outPeer = peer;
-    return true;
-}
-
-static bool doServerAssistPunch(
-#if defined(_WIN32)
-    uint64_t sock,
-#else
-    int sock,
-#endif
-    const char* roomServerHost,
-    uint16_t roomServerPort,
-    const char* roomCode,
-    sockaddr_in& outPeer
-) noexcept {
-    if (!roomServerHost || !roomServerHost[0] || roomServerPort == 0) return false;
-    if (!roomCode || !roomCode[0]) return false;
-
-    sockaddr_in server{};
-    if (!resolveIpv4ToSockaddr(roomServerHost, server, roomServerPort)) return false;
-
-    char msg[64] = {};
-    std::snprintf(msg, sizeof(msg), "SNO_PUNCH1 %s\n", roomCode);
-
-    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(4);
-    auto nextSend = std::chrono::steady_clock::now();
-
-    while (std::chrono::steady_clock::now() < deadline) {
-        const auto now = std::chrono::steady_clock::now();
-        if (now >= nextSend) {
-#if defined(_WIN32)
-            SOCKET s = static_cast<SOCKET>(sock);
-            (void)sendto(s, msg, static_cast<int>(std::strlen(msg)), 0, reinterpret_cast<const sockaddr*>(&server), sizeof(server));
-#else
-            (void)sendto(sock, msg, std::strlen(msg), 0, reinterpret_cast<const sockaddr*>(&server), sizeof(server));
-#endif
-            nextSend = now + std::chrono::milliseconds(250);
-        }
-
-        // Poll for replies.
-        for (int i = 0; i < 8; ++i) {
-            char buf[256] = {};
-            sockaddr_in from{};
-#if defined(_WIN32)
-            int fromLen = sizeof(from);
-            SOCKET s = static_cast<SOCKET>(sock);
-            const int n = recvfrom(s, buf, static_cast<int>(sizeof(buf)), 0, reinterpret_cast<sockaddr*>(&from), &fromLen);
-#else
-            socklen_t fromLen = sizeof(from);
-            const int n = static_cast<int>(recvfrom(sock, buf, sizeof(buf), 0, reinterpret_cast<sockaddr*>(&from), &fromLen));
-#endif
-            if (n <= 0) break;
-
-            // Only accept replies from the room server IP.
-            if (from.sin_addr.s_addr != server.sin_addr.s_addr) continue;
-
-            sockaddr_in peer{};
-            if (parsePeerLine(buf, n, peer)) {
-                outPeer = peer;
-                return true;
-            }
-        }
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
-    }
+static constexpr uint32_t kResendWindow = 16;
 
-    return false;
+// Adaptive delay: before frame 0, ping every kStartPingIntervalMs until player 1 has kMinRttSamples
+// answers and picks the start delay (or kStartDelayTimeoutMs pass without one). Then ping every
+// kPingIntervalMs; player 1 re-evaluates the delay every kDelayEvalFrames, and schedules a change
+// kDelayChangeLeadFrames ahead so the proposal (repeated in every ping) reaches the peer first.
+static constexpr int64_t kStartPingIntervalMs = 20;
+static constexpr int64_t kStartDelayTimeoutMs = 2000;
+static constexpr int64_t kPingIntervalMs = 100;
+static constexpr uint32_t kMinRttSamples = 8;
+static constexpr uint32_t kDelayEvalFrames = 120;
+static constexpr uint32_t kDelayChangeLeadFrames = 30;
+static constexpr uint32_t kMaxCatchUpFrames = 4;
+
+static constexpr int kNetThreadPollMs = 50;
+static_assert(wire::kMaxInputV2Bytes <= kBulkMaxDatagramBytes, "RecvDatagram must hold the largest input packet");
+
+static uint32_t nowMicros() noexcept {
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    return static_cast<uint32_t>(us);
 }
 
-} // namespace
-
-static constexpr uint32_t kInputDelayFrames = 5;
-static constexpr uint32_t kResendWindow = 16;
-static constexpr int kSocketBufBytes = 1 << 20;
-
-LockstepSession::LockstepSession() noexcept {
+LockstepSession::LockstepSession() noexcept : engine_(&EmulatorEngine::instance()) {
     // Mark tags as invalid.
     for (uint32_t& t : remoteFrameTag_) t = 0xFFFFFFFFu;
     for (uint32_t& t : sentFrameTag_) t = 0xFFFFFFFFu;
@@ -211,64 +43,10 @@ LockstepSession::~LockstepSession() noexcept { stop(); }
 
 bool LockstepSession::openSocket_(uint16_t localPort) noexcept {
     closeSocket_();
-
-#if defined(_WIN32)
-    if (!ensureWinSockInitialized()) return false;
-    SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (s == INVALID_SOCKET) return false;
-
-    int yes = 1;
-    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&yes), sizeof(yes));
-    setsockopt(s, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&kSocketBufBytes), sizeof(kSocketBufBytes));
-    setsockopt(s, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&kSocketBufBytes), sizeof(kSocketBufBytes));
-
-    sockaddr_in local{};
-    local.sin_family = AF_INET;
-    local.sin_addr.s_addr = htonl(INADDR_ANY);
-    local.sin_port = htons(static_cast<u_short>(localPort));
-
-    if (bind(s, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
-        closesocket(s);
-        return false;
-    }
-
-    (void)setSocketNonBlocking(s);
-    sock_ = static_cast<SocketHandle>(s);
-    return true;
-#else
-    int s = ::socket(AF_INET, SOCK_DGRAM, 0);
-    if (s < 0) return false;
-
-    int yes = 1;
-    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
-    setsockopt(s, SOL_SOCKET, SO_RCVBUF, &kSocketBufBytes, sizeof(kSocketBufBytes));
-    setsockopt(s, SOL_SOCKET, SO_SNDBUF, &kSocketBufBytes, sizeof(kSocketBufBytes));
-
-    sockaddr_in local{};
-    local.sin_family = AF_INET;
-    local.sin_addr.s_addr = htonl(INADDR_ANY);
-    local.sin_port = htons(localPort);
-
-    if (bind(s, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
-        ::close(s);
-        return false;
-    }
-
-    (void)setSocketNonBlocking(s);
-    sock_ = s;
-    return true;
-#endif
+    return net::openUdpSocket(localPort, sock_);
 }
 
-void LockstepSession::closeSocket_() noexcept {
-    if (sock_ == kInvalidSocket) return;
-#if defined(_WIN32)
-    closesocket(static_cast<SOCKET>(sock_));
-#else
-    ::close(sock_);
-#endif
-    sock_ = kInvalidSocket;
-}
+void LockstepSession::closeSocket_() noexcept { net::closeSocket(sock_); }
 
 bool LockstepSession::start(const Config& cfg) noexcept {
     stop();
@@ -276,6 +54,38 @@ bool LockstepSession::start(const Config& cfg) noexcept {
     localPort_ = (cfg.localPort != 0) ? cfg.localPort : 7000;
     remotePort_ = (cfg.remotePort != 0) ? cfg.remotePort : 7000;
     localPlayerNum_ = (cfg.localPlayerNum == 2) ? 2 : 1;
+    engine_ = cfg.engine ? cfg.engine : &EmulatorEngine::instance();
+    allowPacketV2_ = (cfg.inputPacketVersion != 1);
+    negotiator_.reset(allowPacketV2_);
+    sentPackets_ = 0;
+    sentBytes_ = 0;
+
+    adaptiveDelay_ = (cfg.inputDelayFrames == 0);
+    inputDelay_ = adaptiveDelay_ ? kDefaultInputDelayFrames
+                                 : ((cfg.inputDelayFrames > kMaxInputDelayFrames) ? kMaxInputDelayFrames : cfg.inputDelayFrames);
+    delayChange_ = 0;
+    delayChangeFrame_ = kNoFrame;
+    nextDelayEvalFrame_ = kDelayEvalFrames;
+    delayAgreed_ = !adaptiveDelay_;
+    peerHeard_ = false;
+    // Player 2 waits for player 1's proposal; player 1's clock starts when the peer shows up.
+    startDelayDeadline_ = (localPlayerNum_ == 2) ? std::chrono::steady_clock::now() + std::chrono::milliseconds(kStartDelayTimeoutMs)
+                                                 : std::chrono::steady_clock::time_point::max();
+    srttUs_ = 0;
+    rttVarUs_ = 0;
+    rttSamples_ = 0;
+    lastPingSent_ = {};
+    lastRttUs_ = 0;
+    droppedDatagrams_.store(0, std::memory_order_relaxed);
+    stallStart_ = {};
+    stallCount_ = 0;
+    stallMicrosTotal_ = 0;
+    maxStallMicros_ = 0;
+    for (uint8_t c = 0; c < kBulkChannels; ++c) {
+        bulkOut_[c].cancel();
+        bulkIn_[c].reset();
+        bulkTaken_[c] = false;
+    }
 
     for (uint32_t& t : remoteFrameTag_) t = 0xFFFFFFFFu;
     std::memset(remoteMask_, 0, sizeof(remoteMask_));
@@ -284,12 +94,15 @@ bool LockstepSession::start(const Config& cfg) noexcept {
     frame_ = 0;
 
     // Prime our local input history for the first few frames. With input delay, the first
-    // kInputDelayFrames frames would otherwise have no locally-buffered input.
-    for (uint32_t f = 0; f < kInputDelayFrames; ++f) {
+    // inputDelay_ frames would otherwise have no locally-buffered input. An adaptive session does
+    // not know its start delay yet; sendLocal_ fills any frames beyond the primed ones.
+    const uint32_t primed = adaptiveDelay_ ? kMinAdaptiveDelayFrames : inputDelay_;
+    for (uint32_t f = 0; f < primed; ++f) {
         const uint32_t idx = f % kBufN;
         sentFrameTag_[idx] = f;
         sentMask_[idx] = 0;
     }
+    lastScheduled_ = primed - 1;
 
     peer_ = {};
     discoverPeer_ = false;
@@ -306,7 +119,7 @@ bool LockstepSession::start(const Config& cfg) noexcept {
         discoverPeer_ = true;
     } else {
         sockaddr_in remote{};
-        if (!resolveIpv4ToSockaddr(cfg.remoteHost, remote, remotePort_)) {
+        if (!net::resolveIpv4ToSockaddr(cfg.remoteHost, remote, remotePort_)) {
             return false;
         }
         peer_.ipv4_be = remote.sin_addr.s_addr;
@@ -320,7 +133,7 @@ bool LockstepSession::start(const Config& cfg) noexcept {
     // Optional: server-assisted first connection (UDP punch helper).
     if (cfg.serverAssistFirstConnect && cfg.roomServerPort != 0 && cfg.roomServerHost && cfg.roomServerHost[0] && cfg.roomCode && cfg.roomCode[0]) {
         sockaddr_in peer{};
-        if (doServerAssistPunch(sock_, cfg.roomServerHost, cfg.roomServerPort, cfg.roomCode, peer)) {
+        if (net::doServerAssistPunch(sock_, cfg.roomServerHost, cfg.roomServerPort, cfg.roomCode, peer)) {
             peer_.ipv4_be = peer.sin_addr.s_addr;
             peer_.port_be = peer.sin_port;
             discoverPeer_ = false;
@@ -328,25 +141,52 @@ bool LockstepSession::start(const Config& cfg) noexcept {
         }
     }
 
-    startTime_ = std::chrono::steady_clock::now();
+    FrameScheduler::Config pace;
+    pace.framesPerSecond = engine_->core().framesPerSecond();
+    pace.maxCatchUpFrames = kMaxCatchUpFrames;
+    pacer_.configure(pace);
+    pacer_.start(std::chrono::steady_clock::now());
+    statsTracker_.reset(std::chrono::steady_clock::now(), pacer_.frameMicros());
 
     // If peer is already configured, we can start sending immediately.
     if (!discoverPeer_ && peer_.valid()) {
         waitingForPeer_ = false;
     }
 
+    // Spectators are optional; the match runs without them if the port is taken.
+    if (cfg.spectatorPort != 0) (void)spectators_.start(cfg.spectatorPort, cfg.maxSpectators);
+    if (cfg.replayPath && cfg.replayPath[0]) (void)replay_.open(cfg.replayPath, *engine_, 0);
+
+    if (cfg.networkThread) {
+        recvRing_.clear();
+        netRunning_.store(true, std::memory_order_release);
+        try {
+            netThread_ = std::thread(&LockstepSession::netThreadMain_, this);
+        } catch (...) {
+            // Fall back to polling the socket from tick().
+            netRunning_.store(false, std::memory_order_relaxed);
+        }
+    }
+
     return true;
 }
 
 void LockstepSession::stop() noexcept {
+    stopNetThread_();
     closeSocket_();
+    spectators_.stop();
+    if (replay_.isOpen()) {
+        // Every recorded frame has run, so the current state is the replay's end state.
+        SaveState st;
+        (void)replay_.close(engine_->saveState(st) ? st.checksum : 0u);
+    }
     peer_ = {};
     discoverPeer_ = false;
     waitingForPeer_ = false;
     connected_ = false;
     localMask_ = 0;
     frame_ = 0;
-    startTime_ = {};
+    pacer_.restart();
 
     for (uint32_t& t : remoteFrameTag_) t = 0xFFFFFFFFu;
     std::memset(remoteMask_, 0, sizeof(remoteMask_));
@@ -356,85 +196,97 @@ void LockstepSession::stop() noexcept {
 
 void LockstepSession::setLocalInput(uint16_t mask) noexcept { localMask_ = mask; }
 
-void LockstepSession::pumpRecv_() noexcept {
-    if (sock_ == kInvalidSocket) return;
+void LockstepSession::stopNetThread_() noexcept {
+    netRunning_.store(false, std::memory_order_release);
+    if (netThread_.joinable()) netThread_.join();
+    recvRing_.clear();
+}
+
+void LockstepSession::netThreadMain_() noexcept {
+    while (netRunning_.load(std::memory_order_acquire)) {
+        if (!net::waitReadable(sock_, kNetThreadPollMs)) continue;
 
-#if defined(_WIN32)
-    SOCKET s = static_cast<SOCKET>(sock_);
-    while (true) {
-        Packet p{};
-        sockaddr_in from{};
-        int fromLen = sizeof(from);
-        const int n = recvfrom(s, reinterpret_cast<char*>(&p), static_cast<int>(sizeof(p)), 0, reinterpret_cast<sockaddr*>(&from), &fromLen);
-        if (n <= 0) break;
-        if (n != static_cast<int>(sizeof(p))) continue;
-
-        // Learn/refresh peer endpoint from observed packets (NATs may rewrite source ports).
-        if (discoverPeer_) {
-            if (!peer_.valid()) {
-                peer_.ipv4_be = from.sin_addr.s_addr;
-                peer_.port_be = from.sin_port;
-            } else if (peer_.ipv4_be == from.sin_addr.s_addr) {
-                peer_.port_be = from.sin_port;
+        bool published = false;
+        while (true) {
+            RecvDatagram* slot = recvRing_.beginPush();
+            uint8_t scratch[kMaxDatagramBytes];
+            uint8_t* dst = slot ? slot->data : scratch;
+            sockaddr_in from{};
+            const int n = net::recvFrom(sock_, dst, kMaxDatagramBytes, from);
+            if (n <= 0) break;
+            const uint32_t arrivalUs = nowMicros();
+
+            // Answer pings here so the measured RTT reflects the network, not the frame loop.
+            wire::ControlPacket c{};
+            if (wire::parseControl(dst, static_cast<std::size_t>(n), c) && c.magic == wire::kPingMagic) {
+                wire::ControlPacket pong{};
+                pong.magic = wire::kPongMagic;
+                pong.timeUs = c.timeUs;
+                uint8_t out[wire::kControlBytes];
+                wire::buildControl(pong, out);
+                (void)net::sendTo(sock_, out, sizeof(out), from);
             }
-        } else {
-            if (peer_.valid() && peer_.ipv4_be == from.sin_addr.s_addr) {
-                peer_.port_be = from.sin_port;
+
+            if (!slot) {
+                droppedDatagrams_.fetch_add(1, std::memory_order_relaxed);
+                continue;
             }
+            slot->arrivalUs = arrivalUs;
+            slot->fromIpv4_be = from.sin_addr.s_addr;
+            slot->fromPort_be = from.sin_port;
+            slot->sizeBytes = static_cast<uint16_t>(n);
+            recvRing_.commitPush();
+            published = true;
         }
 
-        const uint32_t f = ntohl(p.frame_be);
-        const uint16_t m = ntohs(p.mask_be);
-        const uint32_t idx = f % kBufN;
-        remoteFrameTag_[idx] = f;
-        remoteMask_[idx] = m;
+        // Pairs with the fence in waitForDatagram_: either it sees the push, or we see it waiting.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (published && consumerWaiting_.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            wakeCv_.notify_one();
+        }
+    }
+}
 
-        lastRemoteFrame_ = f;
-        if (recvCount_ == 0 || f > maxRemoteFrame_) maxRemoteFrame_ = f;
+bool LockstepSession::waitForDatagram_(std::chrono::steady_clock::time_point deadline) noexcept {
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) return false;
 
-        connected_ = true;
-        waitingForPeer_ = false;
-        lastRecv_ = std::chrono::steady_clock::now();
-        recvCount_++;
+    if (!netThread_.joinable()) {
+        // poll() takes whole milliseconds; round up so we do not spin just short of the deadline.
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now).count();
+        return net::waitReadable(sock_, static_cast<int>((us + 999) / 1000));
     }
-#else
-    while (true) {
-        Packet p{};
-        sockaddr_in from{};
-        socklen_t fromLen = sizeof(from);
-        const int n = static_cast<int>(recvfrom(sock_, &p, sizeof(p), 0, reinterpret_cast<sockaddr*>(&from), &fromLen));
-        if (n <= 0) break;
-        if (n != static_cast<int>(sizeof(p))) continue;
-
-        // Learn/refresh peer endpoint from observed packets (NATs may rewrite source ports).
-        if (discoverPeer_) {
-            if (!peer_.valid()) {
-                peer_.ipv4_be = from.sin_addr.s_addr;
-                peer_.port_be = from.sin_port;
-            } else if (peer_.ipv4_be == from.sin_addr.s_addr) {
-                peer_.port_be = from.sin_port;
-            }
-        } else {
-            if (peer_.valid() && peer_.ipv4_be == from.sin_addr.s_addr) {
-                peer_.port_be = from.sin_port;
-            }
-        }
 
-        const uint32_t f = ntohl(p.frame_be);
-        const uint16_t m = ntohs(p.mask_be);
-        const uint32_t idx = f % kBufN;
-        remoteFrameTag_[idx] = f;
-        remoteMask_[idx] = m;
+    consumerWaiting_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool ready = false;
+    {
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        ready = wakeCv_.wait_until(lock, deadline, [this] { return recvRing_.front() != nullptr; });
+    }
+    consumerWaiting_.store(false, std::memory_order_relaxed);
+    return ready;
+}
 
-        lastRemoteFrame_ = f;
-        if (recvCount_ == 0 || f > maxRemoteFrame_) maxRemoteFrame_ = f;
+void LockstepSession::pumpRecv_() noexcept {
+    SNESONLINE_PROFILE_SCOPE("lockstep.pumpRecv");
+    if (sock_ == kInvalidSocket) return;
 
-        connected_ = true;
-        waitingForPeer_ = false;
-        lastRecv_ = std::chrono::steady_clock::now();
-        recvCount_++;
+    if (netThread_.joinable()) {
+        while (const RecvDatagram* d = recvRing_.front()) {
+            handleDatagram_(d->data, d->sizeBytes, d->fromIpv4_be, d->fromPort_be, d->arrivalUs, true);
+            recvRing_.popFront();
+        }
+    } else {
+        while (true) {
+            uint8_t buf[kMaxDatagramBytes];
+            sockaddr_in from{};
+            const int n = net::recvFrom(sock_, buf, sizeof(buf), from);
+            if (n <= 0) break;
+            handleDatagram_(buf, static_cast<std::size_t>(n), from.sin_addr.s_addr, from.sin_port, nowMicros(), false);
+        }
     }
-#endif
 
     if (discoverPeer_ && peer_.valid()) {
         // Once discovered, stop being in waiting state.
@@ -442,6 +294,255 @@ void LockstepSession::pumpRecv_() noexcept {
     }
 }
 
+void LockstepSession::handleDatagram_(const uint8_t* data, std::size_t n, uint32_t fromIpv4_be, uint16_t fromPort_be,
+                                      uint32_t arrivalUs, bool pingAnswered) noexcept {
+    sockaddr_in from{};
+    from.sin_family = AF_INET;
+    from.sin_addr.s_addr = fromIpv4_be;
+    from.sin_port = fromPort_be;
+    statsTracker_.onDatagramReceived(n);
+    if (!delayAgreed_ && !peerHeard_) {
+        peerHeard_ = true;
+        startDelayDeadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(kStartDelayTimeoutMs);
+    }
+
+    if (n == sizeof(wire::InputPacketV1)) {
+        wire::InputPacketV1 p{};
+        std::memcpy(&p, data, sizeof(p));
+        net::refreshPeerFromPacket(discoverPeer_, peer_.ipv4_be, peer_.port_be, from);
+        negotiator_.onV1Received();
+        storeRemoteInput_(ntohl(p.frame_be), ntohs(p.mask_be));
+        recvCount_++;
+        return;
+    }
+
+    if (wire::isControl(data, n)) {
+        net::refreshPeerFromPacket(discoverPeer_, peer_.ipv4_be, peer_.port_be, from);
+        handleControl_(data, n, arrivalUs, pingAnswered);
+        return;
+    }
+
+    uint8_t channel = 0;
+    const BulkDatagramKind bulk = peekBulkDatagram(data, n, channel);
+    if (bulk != BulkDatagramKind::None) {
+        if (channel >= kBulkChannels) return;
+        net::refreshPeerFromPacket(discoverPeer_, peer_.ipv4_be, peer_.port_be, from);
+        const auto now = std::chrono::steady_clock::now();
+        if (bulk == BulkDatagramKind::Ack) {
+            bulkOut_[channel].onDatagram(data, n, now);
+        } else if (bulkIn_[channel].onDatagram(data, n, now)) {
+            bulkTaken_[channel] = false;
+        }
+        return;
+    }
+
+    uint16_t aux = 0;
+    uint32_t newest = 0;
+    uint32_t count = 0;
+    uint16_t masks[kMaxInputWindow];
+    if (!allowPacketV2_ || !wire::parseInputV2(data, n, aux, newest, masks, count)) return;
+
+    net::refreshPeerFromPacket(discoverPeer_, peer_.ipv4_be, peer_.port_be, from);
+    negotiator_.onV2Received();
+    statsTracker_.onInputPacket(newest);
+    for (uint32_t i = 0; i < count; ++i) storeRemoteInput_(newest - count + 1 + i, masks[i]);
+    recvCount_++;
+}
+
+void LockstepSession::storeRemoteInput_(uint32_t f, uint16_t m) noexcept {
+    const uint32_t idx = f % kBufN;
+    remoteFrameTag_[idx] = f;
+    remoteMask_[idx] = m;
+
+    lastRemoteFrame_ = f;
+    if (recvCount_ == 0 || f > maxRemoteFrame_) maxRemoteFrame_ = f;
+
+    connected_ = true;
+    waitingForPeer_ = false;
+    lastRecv_ = std::chrono::steady_clock::now();
+}
+
+void LockstepSession::handleControl_(const uint8_t* data, std::size_t sizeBytes, uint32_t arrivalUs, bool pingAnswered) noexcept {
+    wire::ControlPacket c{};
+    if (!wire::parseControl(data, sizeBytes, c)) return;
+
+    if (c.magic == wire::kPongMagic) {
+        (void)statsTracker_.onProbeAnswered(c.timeUs, arrivalUs);
+        addRttSample_(arrivalUs - c.timeUs);
+        return;
+    }
+
+    if (pingAnswered) {
+        // The network thread already replied; account for it here so the counters stay single-threaded.
+        sentPackets_++;
+        sentBytes_ += wire::kControlBytes;
+    } else {
+        wire::ControlPacket pong{};
+        pong.magic = wire::kPongMagic;
+        pong.timeUs = c.timeUs;
+        uint8_t out[wire::kControlBytes];
+        wire::buildControl(pong, out);
+        (void)sendToPeer_(out, sizeof(out));
+    }
+
+    // Player 2 follows player 1's delay proposals; a late one still applies at the next frame.
+    if (localPlayerNum_ == 2 && adaptiveDelay_ && c.delay != 0 && c.delay <= kMaxInputDelayFrames &&
+        (delayChangeFrame_ == kNoFrame || c.applyFrame > delayChangeFrame_)) {
+        delayChange_ = c.delay;
+        delayChangeFrame_ = c.applyFrame;
+    }
+}
+
+void LockstepSession::addRttSample_(uint32_t rttUs) noexcept {
+    // Ignore garbage (e.g. a pong from a previous session) rather than poisoning the estimate.
+    if (rttUs > 5000000u) return;
+    lastRttUs_ = rttUs;
+
+    // RFC 6298 smoothing.
+    if (rttSamples_ == 0) {
+        srttUs_ = rttUs;
+        rttVarUs_ = rttUs / 2;
+    } else {
+        const uint32_t err = (rttUs > srttUs_) ? (rttUs - srttUs_) : (srttUs_ - rttUs);
+        rttVarUs_ = (3 * rttVarUs_ + err) / 4;
+        srttUs_ = (7 * srttUs_ + rttUs) / 8;
+    }
+    rttSamples_++;
+}
+
+void LockstepSession::sendPing_() noexcept {
+    if (!peer_.valid()) return;
+    const auto now = std::chrono::steady_clock::now();
+    const int64_t intervalMs = delayAgreed_ ? kPingIntervalMs : kStartPingIntervalMs;
+    if (lastPingSent_.time_since_epoch().count() != 0 &&
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - lastPingSent_).count() < intervalMs) {
+        return;
+    }
+    lastPingSent_ = now;
+
+    wire::ControlPacket ping{};
+    ping.magic = wire::kPingMagic;
+    ping.timeUs = nowMicros();
+    if (localPlayerNum_ == 1 && delayChangeFrame_ != kNoFrame) {
+        ping.delay = static_cast<uint16_t>(delayChange_);
+        ping.applyFrame = delayChangeFrame_;
+    }
+    uint8_t out[wire::kControlBytes];
+    wire::buildControl(ping, out);
+    if (sendToPeer_(out, sizeof(out))) statsTracker_.onProbeSent(ping.timeUs);
+}
+
+uint32_t LockstepSession::desiredDelay_() const noexcept {
+    // Cover the one-way trip plus jitter, with one extra frame for tick phase.
+    const uint32_t frameUs = pacer_.frameMicros();
+    const uint32_t budgetUs = srttUs_ / 2 + 2 * rttVarUs_ + frameUs;
+    uint32_t desired = (budgetUs + frameUs - 1) / frameUs;
+    if (desired < kMinAdaptiveDelayFrames) desired = kMinAdaptiveDelayFrames;
+    if (desired > kMaxInputDelayFrames) desired = kMaxInputDelayFrames;
+    return desired;
+}
+
+void LockstepSession::agreeStartDelay_() noexcept {
+    // Frame 0 is due once the delay is known, not at start() plus the time spent agreeing.
+    const auto now = std::chrono::steady_clock::now();
+    if (localPlayerNum_ == 1 && rttSamples_ >= kMinRttSamples) {
+        // Frame 0 uses it; every ping repeats it until the next proposal. One frame of headroom over
+        // the target, which is where lowering stops later on, so a few samples do not cut it close.
+        const uint32_t desired = desiredDelay_();
+        inputDelay_ = (desired < kMaxInputDelayFrames) ? desired + 1 : desired;
+        delayChange_ = inputDelay_;
+        delayChangeFrame_ = 0;
+        delayAgreed_ = true;
+        // Send the proposal now, ahead of the first input packet, and start when it lands so both
+        // peers run frame 0 at about the same time.
+        lastPingSent_ = {};
+        pacer_.start(now + std::chrono::microseconds(srttUs_ / 2));
+        return;
+    }
+    if (localPlayerNum_ == 2 && delayChangeFrame_ != kNoFrame) {
+        inputDelay_ = delayChange_;
+        delayAgreed_ = true;
+        pacer_.start(now);
+        return;
+    }
+    // Input from the peer means it has started without us (or does not ping); keep the default.
+    if (connected_ || now >= startDelayDeadline_) {
+        delayAgreed_ = true;
+        pacer_.start(now);
+    }
+}
+
+void LockstepSession::updateDelay_() noexcept {
+    if (!adaptiveDelay_) return;
+
+    if (delayChangeFrame_ != kNoFrame && frame_ >= delayChangeFrame_) inputDelay_ = delayChange_;
+
+    // Player 1 decides; player 2 only applies what it receives.
+    if (localPlayerNum_ != 1 || rttSamples_ < kMinRttSamples || frame_ < nextDelayEvalFrame_) return;
+    nextDelayEvalFrame_ = frame_ + kDelayEvalFrames;
+    if (delayChangeFrame_ != kNoFrame && frame_ < delayChangeFrame_) return;
+
+    const uint32_t desired = desiredDelay_();
+
+    // Raise at once; lower one frame at a time so a brief good spell does not cause stalls.
+    uint32_t next = inputDelay_;
+    if (desired > inputDelay_) next = desired;
+    else if (desired + 1 < inputDelay_) next = inputDelay_ - 1;
+    if (next == inputDelay_) return;
+
+    delayChange_ = next;
+    delayChangeFrame_ = frame_ + kDelayChangeLeadFrames;
+}
+
+bool LockstepSession::sendToPeer_(const void* data, std::size_t sizeBytes) noexcept {
+    if (sock_ == kInvalidSocket || !peer_.valid()) return false;
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = peer_.ipv4_be;
+    to.sin_port = peer_.port_be;
+    if (!net::sendTo(sock_, data, sizeBytes, to)) return false;
+    sentPackets_++;
+    sentBytes_ += sizeBytes;
+    return true;
+}
+
+bool LockstepSession::sendBulk(uint8_t channel, const void* data, std::size_t sizeBytes) noexcept {
+    if (channel >= kBulkChannels) return false;
+    return bulkOut_[channel].begin(channel, data, sizeBytes);
+}
+
+bool LockstepSession::bulkSendDone(uint8_t channel) const noexcept {
+    return channel < kBulkChannels && bulkOut_[channel].done();
+}
+
+bool LockstepSession::takeReceivedBulk(uint8_t channel, std::vector<uint8_t>& out) {
+    if (channel >= kBulkChannels || bulkTaken_[channel] || !bulkIn_[channel].complete()) return false;
+    out = bulkIn_[channel].data();
+    bulkTaken_[channel] = true;
+    return true;
+}
+
+void LockstepSession::pumpBulk_() noexcept {
+    if (sock_ == kInvalidSocket || !peer_.valid()) return;
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = peer_.ipv4_be;
+    to.sin_port = peer_.port_be;
+
+    const auto now = std::chrono::steady_clock::now();
+    for (uint8_t c = 0; c < kBulkChannels; ++c) {
+        uint8_t ack[kBulkMaxAckBytes];
+        const std::size_t ackBytes = bulkIn_[c].pollAck(now, ack, sizeof(ack));
+        if (ackBytes != 0) (void)sendToPeer_(ack, ackBytes);
+
+        BulkDatagram out[kBulkMaxBatch];
+        const std::size_t count = bulkOut_[c].poll(now, out, kBulkMaxBatch);
+        const std::size_t sent = sendBulkDatagrams(static_cast<std::intptr_t>(sock_), out, count, &to, sizeof(to));
+        for (std::size_t i = 0; i < sent; ++i) sentBytes_ += out[i].sizeBytes;
+        sentPackets_ += sent;
+    }
+}
+
 int64_t LockstepSession::lastRecvAgeMs() const noexcept {
     if (recvCount_ == 0) return -1;
     const auto now = std::chrono::steady_clock::now();
@@ -449,103 +550,142 @@ int64_t LockstepSession::lastRecvAgeMs() const noexcept {
     return static_cast<int64_t>(ms);
 }
 
+void LockstepSession::stats(NetplayStats& out) const noexcept {
+    statsTracker_.fill(out);
+    out.localFrame = frame_;
+    out.remoteFrame = maxRemoteFrame_;
+    out.connected = connected_;
+    out.waitingForPeer = waitingForPeer_;
+    out.inputDelayFrames = inputDelay_;
+    out.lastRecvAgeMs = lastRecvAgeMs();
+    out.frameLead = 0;
+}
+
 void LockstepSession::sendLocal_() noexcept {
+    SNESONLINE_PROFILE_SCOPE("lockstep.sendLocal");
     if (sock_ == kInvalidSocket) return;
 
-    const uint32_t targetFrame = frame_ + kInputDelayFrames;
-    const uint32_t sidx = targetFrame % kBufN;
-    sentFrameTag_[sidx] = targetFrame;
-    sentMask_[sidx] = localMask_;
+    // Each frame's input is assigned once; the peer may already have simulated it. When the delay
+    // grows, the skipped frames repeat the previous input. When it shrinks (or while stalled),
+    // nothing new is scheduled until frame_ + inputDelay_ passes the last assigned frame.
+    const uint32_t targetFrame = frame_ + inputDelay_;
+    if (targetFrame > lastScheduled_) {
+        const uint16_t held = sentMask_[lastScheduled_ % kBufN];
+        for (uint32_t f = lastScheduled_ + 1; f < targetFrame; ++f) {
+            sentFrameTag_[f % kBufN] = f;
+            sentMask_[f % kBufN] = held;
+        }
+        const uint32_t sidx = targetFrame % kBufN;
+        sentFrameTag_[sidx] = targetFrame;
+        sentMask_[sidx] = localMask_;
+        lastScheduled_ = targetFrame;
+    }
+    const uint32_t newest = lastScheduled_;
 
     // Host in discover mode must wait until a peer is known.
     if (discoverPeer_ && !peer_.valid()) return;
     if (!peer_.valid()) return;
 
-    sockaddr_in to{};
-    to.sin_family = AF_INET;
-    to.sin_addr.s_addr = peer_.ipv4_be;
-    to.sin_port = peer_.port_be;
+    if (negotiator_.sendV2()) {
+        uint16_t masks[kResendWindow];
+        const uint32_t count = wire::collectInputWindow(sentMask_, sentFrameTag_, newest, kResendWindow, masks);
+        uint8_t buf[wire::kMaxInputV2Bytes];
+        const std::size_t len = wire::buildInputV2(0, newest, masks, count, buf, sizeof(buf));
+        if (len != 0) (void)sendToPeer_(buf, len);
+    }
+    if (!negotiator_.sendV1()) return;
 
-    const uint32_t start = (targetFrame >= (kResendWindow - 1)) ? (targetFrame - (kResendWindow - 1)) : 0u;
-    for (uint32_t f = start; f <= targetFrame; ++f) {
+    const uint32_t start = (newest >= (kResendWindow - 1)) ? (newest - (kResendWindow - 1)) : 0u;
+    for (uint32_t f = start; f <= newest; ++f) {
         const uint32_t i = f % kBufN;
         if (sentFrameTag_[i] != f) continue;
-        Packet p{};
+        wire::InputPacketV1 p{};
         p.frame_be = htonl(f);
         p.mask_be = htons(sentMask_[i]);
         p.reserved_be = 0;
-
-#if defined(_WIN32)
-        SOCKET s = static_cast<SOCKET>(sock_);
-        sendto(s, reinterpret_cast<const char*>(&p), static_cast<int>(sizeof(p)), 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to));
-#else
-        sendto(sock_, &p, sizeof(p), 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to));
-#endif
+        (void)sendToPeer_(&p, sizeof(p));
     }
 }
 
 void LockstepSession::tick() noexcept {
+    SNESONLINE_PROFILE_SCOPE("lockstep.tick");
     // Pump network.
     pumpRecv_();
+    if (!delayAgreed_) agreeStartDelay_();
+    sendPing_();
+    pumpBulk_();
+
+    if (!delayAgreed_) {
+        // Nothing is scheduled or sent before the start delay is known.
+        waitingForPeer_ = true;
+        spectators_.service(*engine_, frame_, true);
+        statsTracker_.update(std::chrono::steady_clock::now(), sentPackets_, sentBytes_);
+        return;
+    }
 
-    // Time-based pacing: only simulate frames that are "due" according to wall clock.
-    // This preserves ~60fps average while still allowing bounded catch-up after stalls.
-    static constexpr uint32_t kMaxCatchUpFrames = 4;
-    const auto now = std::chrono::steady_clock::now();
-    if (startTime_.time_since_epoch().count() == 0) startTime_ = now;
-
-    const uint64_t elapsedNs = static_cast<uint64_t>(
-        std::chrono::duration_cast<std::chrono::nanoseconds>(now - startTime_).count());
-    const uint32_t desiredFrames = static_cast<uint32_t>((elapsedNs * 60ull) / 1000000000ull) + 1u;
-    const uint32_t behind = (desiredFrames > frame_) ? (desiredFrames - frame_) : 0u;
-    const uint32_t toRun = (behind > kMaxCatchUpFrames) ? kMaxCatchUpFrames : behind;
+    // Time-based pacing: only simulate frames that are due by the wall clock, at the core's rate,
+    // with bounded catch-up after stalls. A frame blocked on the peer stays due.
+    const uint32_t toRun = pacer_.due(std::chrono::steady_clock::now());
 
     for (uint32_t step = 0; step < toRun; ++step) {
+        updateDelay_();
+
         // Always send (except host waiting for first peer packet).
         sendLocal_();
 
         const uint32_t need = frame_;
         const uint32_t idx = need % kBufN;
         if (remoteFrameTag_[idx] != need || sentFrameTag_[idx] != need) {
+            if (connected_ && stallStart_.time_since_epoch().count() == 0) stallStart_ = std::chrono::steady_clock::now();
             waitingForPeer_ = true;
             break;
         }
 
+        if (stallStart_.time_since_epoch().count() != 0) {
+            const auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - stallStart_).count();
+            const uint32_t stallUs = (us > 0xFFFFFFFFll) ? 0xFFFFFFFFu : static_cast<uint32_t>(us);
+            stallStart_ = {};
+            stallCount_++;
+            stallMicrosTotal_ += stallUs;
+            if (stallUs > maxStallMicros_) maxStallMicros_ = stallUs;
+            statsTracker_.onStall(stallUs);
+        }
+
         const uint16_t localMask = sentMask_[idx];
         const uint16_t remoteMask = remoteMask_[idx];
         const bool localIsP1 = (localPlayerNum_ == 1);
 
-        EmulatorEngine::instance().setInputMask(0, localIsP1 ? localMask : remoteMask);
-        EmulatorEngine::instance().setInputMask(1, localIsP1 ? remoteMask : localMask);
-        EmulatorEngine::instance().advanceFrame();
+        const uint16_t p1 = localIsP1 ? localMask : remoteMask;
+        const uint16_t p2 = localIsP1 ? remoteMask : localMask;
+        engine_->setInputMask(0, p1);
+        engine_->setInputMask(1, p2);
+        // Only the newest frame of a catch-up burst is shown. Inputs only arrive between ticks, so a
+        // missing one for the next frame means this is the last frame of the burst.
+        const uint32_t nextIdx = (need + 1) % kBufN;
+        const bool last = step + 1 == toRun || remoteFrameTag_[nextIdx] != need + 1 || sentFrameTag_[nextIdx] != need + 1;
+        engine_->advanceFrame(last ? FrameOutput::Present : FrameOutput::AudioOnly);
+        spectators_.recordFrame(frame_, p1, p2);
+        replay_.recordFrame(p1, p2);
         frame_++;
+        pacer_.advance();
 
         waitingForPeer_ = false;
     }
+
+    spectators_.service(*engine_, frame_, true);
+    statsTracker_.update(std::chrono::steady_clock::now(), sentPackets_, sentBytes_);
 }
 
-std::string LockstepSession::peerEndpoint() const {
-    if (!peer_.valid()) return {};
-
-    char ip[INET_ADDRSTRLEN] = {};
-#if defined(_WIN32)
-    IN_ADDR a{};
-    a.s_addr = peer_.ipv4_be;
-    if (!InetNtopA(AF_INET, &a, ip, INET_ADDRSTRLEN)) return {};
-#else
-    in_addr a{};
-    a.s_addr = peer_.ipv4_be;
-    if (!inet_ntop(AF_INET, &a, ip, INET_ADDRSTRLEN)) return {};
-#endif
-
-    const uint16_t port = ntohs(peer_.port_be);
-    char out[64] = {};
-#if defined(_WIN32)
-    std::snprintf(out, sizeof(out), "%s:%u", ip, static_cast<unsigned>(port));
-#else
-    std::snprintf(out, sizeof(out), "%s:%u", ip, static_cast<unsigned>(port));
-#endif
-    return std::string(out);
+void LockstepSession::tickUntil(std::chrono::steady_clock::time_point deadline) noexcept {
+    tick();
+
+    // Before the first packet there is nothing to wait for; the caller's normal sleep is fine.
+    while (waitingForPeer_ && connected_) {
+        if (!waitForDatagram_(deadline)) break;
+        tick();
+    }
 }
 
+std::string LockstepSession::peerEndpoint() const { return net::formatEndpoint(peer_.ipv4_be, peer_.port_be); }
+
 } // namespace snesonline
@@ -0,0 +1,159 @@
+#include "snesonline/Lz.h"
+
+#include <cstring>
+
+namespace snesonline {
+
+namespace {
+
+constexpr std::size_t kMinMatch = 4;
+constexpr std::size_t kMaxOffset = 65535;
+constexpr unsigned kHashBits = 14;
+
+inline uint32_t read32(const uint8_t* p) noexcept {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t hash4(uint32_t v) noexcept { return (v * 2654435761u) >> (32 - kHashBits); }
+
+// Writes the 255-run length extension for a nibble that saturated at 15.
+inline bool putLength(uint8_t*& op, const uint8_t* oend, std::size_t len) noexcept {
+    while (len >= 255) {
+        if (op >= oend) return false;
+        *op++ = 255;
+        len -= 255;
+    }
+    if (op >= oend) return false;
+    *op++ = static_cast<uint8_t>(len);
+    return true;
+}
+
+inline bool getLength(const uint8_t*& ip, const uint8_t* iend, std::size_t& len) noexcept {
+    uint8_t b = 0;
+    do {
+        if (ip >= iend) return false;
+        b = *ip++;
+        len += b;
+    } while (b == 255);
+    return true;
+}
+
+bool emitSequence(uint8_t*& op, const uint8_t* oend, const uint8_t* literals, std::size_t litLen, std::size_t offset,
+                  std::size_t matchLen) noexcept {
+    if (op >= oend) return false;
+    uint8_t* token = op++;
+    const std::size_t litNibble = (litLen < 15) ? litLen : 15;
+    std::size_t matchNibble = 0;
+    if (offset) matchNibble = ((matchLen - kMinMatch) < 15) ? (matchLen - kMinMatch) : 15;
+    *token = static_cast<uint8_t>((litNibble << 4) | matchNibble);
+
+    if (litNibble == 15 && !putLength(op, oend, litLen - 15)) return false;
+    if (static_cast<std::size_t>(oend - op) < litLen) return false;
+    std::memcpy(op, literals, litLen);
+    op += litLen;
+
+    if (!offset) return true;
+    if (oend - op < 2) return false;
+    *op++ = static_cast<uint8_t>(offset & 0xFFu);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    if (matchNibble == 15 && !putLength(op, oend, matchLen - kMinMatch - 15)) return false;
+    return true;
+}
+
+} // namespace
+
+std::size_t lzCompress(const void* src, std::size_t sizeBytes, void* dst, std::size_t capacity) noexcept {
+    if ((!src && sizeBytes) || !dst) return 0;
+    const uint8_t* const base = static_cast<const uint8_t*>(src);
+    const uint8_t* const iend = base + sizeBytes;
+    uint8_t* op = static_cast<uint8_t*>(dst);
+    const uint8_t* const oend = op + capacity;
+
+    // Positions + 1 (0 = empty).
+    uint32_t table[1u << kHashBits];
+    std::memset(table, 0, sizeof(table));
+
+    const uint8_t* ip = base;
+    const uint8_t* anchor = base;
+    while (iend - ip >= static_cast<std::ptrdiff_t>(kMinMatch)) {
+        const uint32_t v = read32(ip);
+        const uint32_t h = hash4(v);
+        const uint32_t candPos = table[h];
+        table[h] = static_cast<uint32_t>(ip - base) + 1u;
+
+        if (candPos) {
+            const uint8_t* cand = base + (candPos - 1u);
+            const std::size_t offset = static_cast<std::size_t>(ip - cand);
+            if (offset <= kMaxOffset && read32(cand) == v) {
+                const uint8_t* m = ip + kMinMatch;
+                const uint8_t* c = cand + kMinMatch;
+                while (m < iend && *m == *c) {
+                    ++m;
+                    ++c;
+                }
+                const std::size_t matchLen = static_cast<std::size_t>(m - ip);
+                if (!emitSequence(op, oend, anchor, static_cast<std::size_t>(ip - anchor), offset, matchLen)) return 0;
+                ip = m;
+                anchor = ip;
+                // Seed the table inside the match so the next sequence can chain off it.
+                if (iend - ip >= static_cast<std::ptrdiff_t>(kMinMatch) && ip - base >= 2) {
+                    table[hash4(read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - base) + 1u;
+                }
+                continue;
+            }
+        }
+        // Skip faster through incompressible stretches.
+        const std::size_t step = 1 + (static_cast<std::size_t>(ip - anchor) >> 6);
+        if (static_cast<std::size_t>(iend - ip) <= step) break;
+        ip += step;
+    }
+
+    if (!emitSequence(op, oend, anchor, static_cast<std::size_t>(iend - anchor), 0, 0)) return 0;
+    return static_cast<std::size_t>(op - static_cast<uint8_t*>(dst));
+}
+
+std::size_t lzDecompress(const void* src, std::size_t sizeBytes, void* dst, std::size_t capacity) noexcept {
+    if (!src || !dst || sizeBytes == 0) return 0;
+    const uint8_t* ip = static_cast<const uint8_t*>(src);
+    const uint8_t* const iend = ip + sizeBytes;
+    uint8_t* const obase = static_cast<uint8_t*>(dst);
+    uint8_t* op = obase;
+    const uint8_t* const oend = op + capacity;
+
+    for (;;) {
+        if (ip >= iend) return 0;
+        const uint8_t token = *ip++;
+
+        std::size_t litLen = token >> 4;
+        if (litLen == 15 && !getLength(ip, iend, litLen)) return 0;
+        if (static_cast<std::size_t>(iend - ip) < litLen || static_cast<std::size_t>(oend - op) < litLen) return 0;
+        std::memcpy(op, ip, litLen);
+        ip += litLen;
+        op += litLen;
+
+        if (ip == iend) break; // final literal-only sequence
+
+        if (iend - ip < 2) return 0;
+        const std::size_t offset = static_cast<std::size_t>(ip[0]) | (static_cast<std::size_t>(ip[1]) << 8);
+        ip += 2;
+        std::size_t matchLen = token & 15u;
+        if (matchLen == 15 && !getLength(ip, iend, matchLen)) return 0;
+        matchLen += kMinMatch;
+
+        if (offset == 0 || offset > static_cast<std::size_t>(op - obase)) return 0;
+        if (static_cast<std::size_t>(oend - op) < matchLen) return 0;
+        const uint8_t* m = op - offset;
+        if (offset >= matchLen) {
+            std::memcpy(op, m, matchLen);
+            op += matchLen;
+        } else {
+            // Overlapping copy (runs): byte by byte replicates the pattern.
+            for (std::size_t i = 0; i < matchLen; ++i) *op++ = *m++;
+        }
+    }
+    return static_cast<std::size_t>(op - obase);
+}
+
+} // namespace snesonline
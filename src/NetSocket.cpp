@@ -0,0 +1,306 @@
+#include "NetSocket.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#if defined(_WIN32)
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace snesonline::net {
+
+namespace {
+
+static constexpr int kSocketBufBytes = 1 << 20;
+
+#if defined(_WIN32)
+static bool ensureWinSockInitialized() noexcept {
+    static bool ok = false;
+    static bool tried = false;
+    if (tried) return ok;
+    tried = true;
+    WSADATA wsa{};
+    ok = (WSAStartup(MAKEWORD(2, 2), &wsa) == 0);
+    return ok;
+}
+#endif
+
+static bool isValidIpv4Address(const char* ip) noexcept {
+    if (!ip || !ip[0]) return false;
+#if defined(_WIN32)
+    IN_ADDR addr{};
+    return InetPtonA(AF_INET, ip, &addr) == 1;
+#else
+    in_addr addr{};
+    return inet_pton(AF_INET, ip, &addr) == 1;
+#endif
+}
+
+static bool setSocketNonBlocking(
+#if defined(_WIN32)
+    SOCKET s
+#else
+    int s
+#endif
+) noexcept {
+#if defined(_WIN32)
+    u_long mode = 1;
+    return ioctlsocket(s, FIONBIO, &mode) == 0;
+#else
+    const int flags = fcntl(s, F_GETFL, 0);
+    if (flags < 0) return false;
+    return fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+static bool parsePeerLine(const char* data, int len, sockaddr_in& outPeer) noexcept {
+    if (!data || len <= 0) return false;
+    // Expect: "SNO_PEER1 ip port\n"
+    if (len < 10) return false;
+    if (std::memcmp(data, "SNO_PEER1", 9) != 0) return false;
+
+    // Copy into a small NUL-terminated buffer for sscanf.
+    char buf[128] = {};
+    const int n = (len >= static_cast<int>(sizeof(buf))) ? (static_cast<int>(sizeof(buf)) - 1) : len;
+    std::memcpy(buf, data, static_cast<size_t>(n));
+    buf[n] = '\0';
+
+    char ip[64] = {};
+    int port = 0;
+    if (std::sscanf(buf, "SNO_PEER1 %63s %d", ip, &port) != 2) return false;
+    if (port < 1 || port > 65535) return false;
+
+    sockaddr_in peer{};
+    if (!resolveIpv4ToSockaddr(ip, peer, static_cast<uint16_t>(port))) return false;
+    outPeer = peer;
+    return true;
+}
+
+} // namespace
+
+bool resolveIpv4ToSockaddr(const char* hostOrIp, sockaddr_in& out, uint16_t port) noexcept {
+    if (!hostOrIp || !hostOrIp[0]) return false;
+
+    // Fast path: numeric IPv4.
+    if (isValidIpv4Address(hostOrIp)) {
+        out = {};
+        out.sin_family = AF_INET;
+        out.sin_port = htons(port);
+#if defined(_WIN32)
+        InetPtonA(AF_INET, hostOrIp, &out.sin_addr);
+#else
+        inet_pton(AF_INET, hostOrIp, &out.sin_addr);
+#endif
+        return true;
+    }
+
+#if defined(_WIN32)
+    if (!ensureWinSockInitialized()) return false;
+#endif
+
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    addrinfo* res = nullptr;
+    if (getaddrinfo(hostOrIp, nullptr, &hints, &res) != 0 || !res) return false;
+
+    bool ok = false;
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+        if (!ai->ai_addr || ai->ai_family != AF_INET) continue;
+        const auto* sin = reinterpret_cast<const sockaddr_in*>(ai->ai_addr);
+        out = *sin;
+        out.sin_port = htons(port);
+        ok = true;
+        break;
+    }
+
+    freeaddrinfo(res);
+    return ok;
+}
+
+bool openUdpSocket(uint16_t localPort, SocketHandle& out) noexcept {
+    out = kInvalidSocket;
+
+#if defined(_WIN32)
+    if (!ensureWinSockInitialized()) return false;
+    SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET) return false;
+
+    int yes = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&yes), sizeof(yes));
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&kSocketBufBytes), sizeof(kSocketBufBytes));
+    setsockopt(s, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&kSocketBufBytes), sizeof(kSocketBufBytes));
+
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(static_cast<u_short>(localPort));
+
+    if (bind(s, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
+        closesocket(s);
+        return false;
+    }
+
+    (void)setSocketNonBlocking(s);
+    out = static_cast<SocketHandle>(s);
+    return true;
+#else
+    int s = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (s < 0) return false;
+
+    int yes = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, &kSocketBufBytes, sizeof(kSocketBufBytes));
+    setsockopt(s, SOL_SOCKET, SO_SNDBUF, &kSocketBufBytes, sizeof(kSocketBufBytes));
+
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(localPort);
+
+    if (bind(s, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
+        ::close(s);
+        return false;
+    }
+
+    (void)setSocketNonBlocking(s);
+    out = s;
+    return true;
+#endif
+}
+
+void closeSocket(SocketHandle& s) noexcept {
+    if (s == kInvalidSocket) return;
+#if defined(_WIN32)
+    closesocket(static_cast<SOCKET>(s));
+#else
+    ::close(s);
+#endif
+    s = kInvalidSocket;
+}
+
+int recvFrom(SocketHandle s, void* buf, std::size_t capacity, sockaddr_in& from) noexcept {
+    if (s == kInvalidSocket) return -1;
+#if defined(_WIN32)
+    int fromLen = sizeof(from);
+    return recvfrom(static_cast<SOCKET>(s), static_cast<char*>(buf), static_cast<int>(capacity), 0, reinterpret_cast<sockaddr*>(&from), &fromLen);
+#else
+    socklen_t fromLen = sizeof(from);
+    return static_cast<int>(recvfrom(s, buf, capacity, 0, reinterpret_cast<sockaddr*>(&from), &fromLen));
+#endif
+}
+
+bool waitReadable(SocketHandle s, int timeoutMs) noexcept {
+    if (s == kInvalidSocket) return false;
+#if defined(_WIN32)
+    WSAPOLLFD pfd{};
+    pfd.fd = static_cast<SOCKET>(s);
+    pfd.events = POLLRDNORM;
+    return WSAPoll(&pfd, 1, timeoutMs) > 0;
+#else
+    pollfd pfd{};
+    pfd.fd = s;
+    pfd.events = POLLIN;
+    return ::poll(&pfd, 1, timeoutMs) > 0 && (pfd.revents & POLLIN);
+#endif
+}
+
+bool sendTo(SocketHandle s, const void* data, std::size_t sizeBytes, const sockaddr_in& to) noexcept {
+    if (s == kInvalidSocket) return false;
+#if defined(_WIN32)
+    const int n = sendto(static_cast<SOCKET>(s), static_cast<const char*>(data), static_cast<int>(sizeBytes), 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to));
+#else
+    const auto n = sendto(s, data, sizeBytes, 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to));
+#endif
+    return n >= 0 && static_cast<std::size_t>(n) == sizeBytes;
+}
+
+void refreshPeerFromPacket(bool discover, uint32_t& ipv4_be, uint16_t& port_be, const sockaddr_in& from) noexcept {
+    const bool valid = ipv4_be != 0 && port_be != 0;
+    if (discover) {
+        if (!valid) {
+            ipv4_be = from.sin_addr.s_addr;
+            port_be = from.sin_port;
+        } else if (ipv4_be == from.sin_addr.s_addr) {
+            port_be = from.sin_port;
+        }
+    } else {
+        if (valid && ipv4_be == from.sin_addr.s_addr) {
+            port_be = from.sin_port;
+        }
+    }
+}
+
+std::string formatEndpoint(uint32_t ipv4_be, uint16_t port_be) {
+    if (ipv4_be == 0 || port_be == 0) return {};
+
+    char ip[INET_ADDRSTRLEN] = {};
+#if defined(_WIN32)
+    IN_ADDR a{};
+    a.s_addr = ipv4_be;
+    if (!InetNtopA(AF_INET, &a, ip, INET_ADDRSTRLEN)) return {};
+#else
+    in_addr a{};
+    a.s_addr = ipv4_be;
+    if (!inet_ntop(AF_INET, &a, ip, INET_ADDRSTRLEN)) return {};
+#endif
+
+    char out[64] = {};
+    std::snprintf(out, sizeof(out), "%s:%u", ip, static_cast<unsigned>(ntohs(port_be)));
+    return std::string(out);
+}
+
+bool doServerAssistPunch(SocketHandle sock, const char* roomServerHost, uint16_t roomServerPort, const char* roomCode,
+                         sockaddr_in& outPeer) noexcept {
+    if (!roomServerHost || !roomServerHost[0] || roomServerPort == 0) return false;
+    if (!roomCode || !roomCode[0]) return false;
+
+    sockaddr_in server{};
+    if (!resolveIpv4ToSockaddr(roomServerHost, server, roomServerPort)) return false;
+
+    char msg[64] = {};
+    std::snprintf(msg, sizeof(msg), "SNO_PUNCH1 %s\n", roomCode);
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(4);
+    auto nextSend = std::chrono::steady_clock::now();
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= nextSend) {
+            sendTo(sock, msg, std::strlen(msg), server);
+            nextSend = now + std::chrono::milliseconds(250);
+        }
+
+        // Poll for replies.
+        for (int i = 0; i < 8; ++i) {
+            char buf[256] = {};
+            sockaddr_in from{};
+            const int n = recvFrom(sock, buf, sizeof(buf), from);
+            if (n <= 0) break;
+
+            // Only accept replies from the room server IP.
+            if (from.sin_addr.s_addr != server.sin_addr.s_addr) continue;
+
+            sockaddr_in peer{};
+            if (parsePeerLine(buf, n, peer)) {
+                outPeer = peer;
+                return true;
+            }
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    return false;
+}
+
+} // namespace snesonline::net
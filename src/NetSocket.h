@@ -0,0 +1,53 @@
+#pragma once
+
+// Internal UDP helpers shared by the netplay sessions (not part of the public include/ API).
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(_WIN32)
+#include <WinSock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#endif
+
+namespace snesonline::net {
+
+#if defined(_WIN32)
+using SocketHandle = uint64_t;
+static constexpr SocketHandle kInvalidSocket = ~0ull;
+#else
+using SocketHandle = int;
+static constexpr SocketHandle kInvalidSocket = -1;
+#endif
+
+// Numeric IPv4 fast path, otherwise getaddrinfo (IPv4 only).
+bool resolveIpv4ToSockaddr(const char* hostOrIp, sockaddr_in& out, uint16_t port) noexcept;
+
+// Bound, non-blocking UDP socket with 1 MiB send/receive buffers.
+bool openUdpSocket(uint16_t localPort, SocketHandle& out) noexcept;
+void closeSocket(SocketHandle& s) noexcept;
+
+// Non-blocking receive. Returns the datagram size, or <= 0 when nothing is pending.
+int recvFrom(SocketHandle s, void* buf, std::size_t capacity, sockaddr_in& from) noexcept;
+// Blocks until a datagram is pending or timeoutMs elapses. Returns true if readable.
+bool waitReadable(SocketHandle s, int timeoutMs) noexcept;
+// Returns true if the whole datagram was handed to the kernel.
+bool sendTo(SocketHandle s, const void* data, std::size_t sizeBytes, const sockaddr_in& to) noexcept;
+
+// Learn/refresh a peer endpoint from an observed packet (NATs may rewrite source ports).
+// In discover mode the first sender becomes the peer.
+void refreshPeerFromPacket(bool discover, uint32_t& ipv4_be, uint16_t& port_be, const sockaddr_in& from) noexcept;
+
+// "a.b.c.d:port", or empty if the endpoint is unset.
+std::string formatEndpoint(uint32_t ipv4_be, uint16_t port_be);
+
+// Server-assisted first connection: asks the room server (tools/room_server, "SNO_PUNCH1 CODE")
+// for the peer endpoint. Blocks for up to ~4 seconds.
+bool doServerAssistPunch(SocketHandle sock, const char* roomServerHost, uint16_t roomServerPort, const char* roomCode,
+                         sockaddr_in& outPeer) noexcept;
+
+} // namespace snesonline::net
@@ -2,6 +2,7 @@
 
 #include "snesonline/EmulatorEngine.h"
 #include "snesonline/GGPOCallbacks.h"
+#include "snesonline/Profiler.h"
 
 #include <cstddef>
 #include <cstdint>
@@ -127,6 +128,16 @@ bool NetplaySession::startGgpoSession_() noexcept {
     }
 #endif
 
+    // GGPO keeps up to GGPO_MAX_PREDICTION_FRAMES + 2 saved frames; size the ring once so
+    // save/load_game_state never allocate during rollback.
+    const std::size_t stateBytes = engine_().core().serializeSize();
+    if (stateBytes > 0 && (snapshots_.slotBytes() < stateBytes || !snapshots_.ready())) {
+        (void)snapshots_.allocate(stateBytes, static_cast<uint32_t>(GGPO_MAX_PREDICTION_FRAMES + 2));
+    }
+    snapshots_.invalidate();
+    GGPOCallbacks::setSnapshotRing(snapshots_.ready() ? &snapshots_ : nullptr);
+    GGPOCallbacks::setEngine(lastCfg_.engine);
+
     GGPOSessionCallbacks cb = GGPOCallbacks::make();
 
     const int localPlayerNum = (lastCfg_.localPlayerNum == 2) ? 2 : 1;
@@ -250,11 +261,43 @@ void NetplaySession::pollListenSocket_() noexcept {
 #endif
 }
 
+void NetplaySession::sampleStats_(uint32_t rollbacks, uint32_t resimulatedFrames) noexcept {
+    // Callbacks only report totals per drain; split the frames evenly across its rollbacks.
+    for (uint32_t i = 0; i < rollbacks; ++i) {
+        statsTracker_.onRollback(resimulatedFrames / rollbacks + ((i < resimulatedFrames % rollbacks) ? 1u : 0u));
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (!session_ || remotePlayerHandle_ < 0 || now < nextStatsSample_) return;
+    nextStatsSample_ = now + std::chrono::seconds(1);
+
+    GGPONetworkStats ns{};
+    if (ggpo_get_network_stats(session_, static_cast<GGPOPlayerHandle>(remotePlayerHandle_), &ns) != GGPO_OK) return;
+    if (hasSynchronized_ && ns.network.ping >= 0) statsTracker_.onRttSample(static_cast<uint32_t>(ns.network.ping) * 1000u);
+    ggpoBytesSentPerSecond_ = (ns.network.kbps_sent > 0) ? static_cast<uint32_t>(ns.network.kbps_sent) * 1024u : 0u;
+}
+
+void NetplaySession::noteStall_(bool stalled) noexcept {
+    const bool open = stallStart_.time_since_epoch().count() != 0;
+    if (stalled) {
+        if (!open && hasSynchronized_) stallStart_ = std::chrono::steady_clock::now();
+        return;
+    }
+    if (!open) return;
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - stallStart_).count();
+    stallStart_ = {};
+    statsTracker_.onStall((us > 0xFFFFFFFFll) ? 0xFFFFFFFFu : static_cast<uint32_t>(us));
+}
+
 #endif // SNESONLINE_ENABLE_GGPO
 
 NetplaySession::NetplaySession() noexcept = default;
 NetplaySession::~NetplaySession() noexcept { stop(); }
 
+EmulatorEngine& NetplaySession::engine_() noexcept {
+    return lastCfg_.engine ? *lastCfg_.engine : EmulatorEngine::instance();
+}
+
 bool NetplaySession::start(const Config& cfg) noexcept {
     stop();
 
@@ -265,10 +308,18 @@ bool NetplaySession::start(const Config& cfg) noexcept {
     lastCfg_.localPort = cfg.localPort;
     lastCfg_.frameDelay = cfg.frameDelay;
     lastCfg_.localPlayerNum = (cfg.localPlayerNum == 2) ? 2 : 1;
+    lastCfg_.engine = cfg.engine ? cfg.engine : &EmulatorEngine::instance();
 
     reconnectBackoffMs_ = 1000;
     nextReconnectAttempt_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(reconnectBackoffMs_);
 
+    const double fps = engine_().core().framesPerSecond();
+    statsTracker_.reset(std::chrono::steady_clock::now(), fps > 1.0 ? static_cast<uint32_t>(1000000.0 / fps) : 0u);
+    frame_ = 0;
+    stallStart_ = {};
+    nextStatsSample_ = {};
+    ggpoBytesSentPerSecond_ = 0;
+
 #if defined(SNESONLINE_ENABLE_GGPO) && SNESONLINE_ENABLE_GGPO
     const int localPort = static_cast<int>(lastCfg_.localPort ? lastCfg_.localPort : 7000);
 
@@ -335,9 +386,12 @@ void NetplaySession::stop() noexcept {
     closeListenSocket_();
     if (session_) {
         GGPOCallbacks::setActiveSession(nullptr);
+        // GGPO releases its saved frames here; keep the ring registered so free_buffer recognizes them.
         ggpo_close_session(session_);
         session_ = nullptr;
     }
+    GGPOCallbacks::setSnapshotRing(nullptr);
+    GGPOCallbacks::setEngine(nullptr);
 #endif
 
     localPlayerHandle_ = -1;
@@ -351,11 +405,21 @@ void NetplaySession::stop() noexcept {
     interrupted_ = false;
 }
 
+void NetplaySession::stats(NetplayStats& out) const noexcept {
+    statsTracker_.fill(out);
+    out.localFrame = frame_;
+    out.connected = hasSynchronized_ && !disconnected_;
+    out.waitingForPeer = waitingForPeer_;
+    out.inputDelayFrames = lastCfg_.frameDelay;
+    out.bytesSentPerSecond = ggpoBytesSentPerSecond_;
+}
+
 void NetplaySession::setLocalInput(uint16_t mask) noexcept {
     localMask_ = mask;
 }
 
 void NetplaySession::tick() noexcept {
+    SNESONLINE_PROFILE_SCOPE("ggpo.tick");
 #if defined(SNESONLINE_ENABLE_GGPO) && SNESONLINE_ENABLE_GGPO
     if (listenForPeer_ && !session_) {
         pollListenSocket_();
@@ -365,15 +429,18 @@ void NetplaySession::tick() noexcept {
     }
     if (!session_) {
         waitingForPeer_ = false;
-        EmulatorEngine::instance().setLocalInputMask(localMask_);
-        EmulatorEngine::instance().advanceFrame();
+        engine_().setLocalInputMask(localMask_);
+        engine_().advanceFrame();
+        frame_++;
         return;
     }
 
     // Drain GGPO events and convert them into app behavior.
     const auto ev = GGPOCallbacks::drainEvents();
+    sampleStats_(ev.rollbacks, ev.resimulatedFrames);
     if (ev.timesyncFramesAhead > 0) {
-        const int ms = (1000 * ev.timesyncFramesAhead) / 60;
+        const double fps = engine_().core().framesPerSecond();
+        const int ms = static_cast<int>((1000.0 * ev.timesyncFramesAhead) / (fps > 1.0 ? fps : 60.0));
         if (ms > 0) {
             std::this_thread::sleep_for(std::chrono::milliseconds(ms));
         }
@@ -397,6 +464,7 @@ void NetplaySession::tick() noexcept {
 
     // Freeze simulation on network interruption to avoid divergence.
     if (interrupted_) {
+        noteStall_(true);
         ggpo_idle(session_, 1);
         return;
     }
@@ -435,6 +503,7 @@ void NetplaySession::tick() noexcept {
     if (err != GGPO_OK) {
         // Usually means we're not synchronized yet (peer not running / handshake pending).
         waitingForPeer_ = true;
+        noteStall_(true);
         // Let GGPO process network/timeouts.
         ggpo_idle(session_, 1);
         return;
@@ -446,30 +515,34 @@ void NetplaySession::tick() noexcept {
     err = ggpo_synchronize_input(session_, inputs, static_cast<int>(sizeof(inputs)), &disconnectFlags);
     if (err != GGPO_OK) {
         waitingForPeer_ = true;
+        noteStall_(true);
         ggpo_idle(session_, 1);
         return;
     }
 
     hasSynchronized_ = true;
     waitingForPeer_ = false;
+    noteStall_(false);
 
     // Feed EmulatorEngine ports then advance exactly one frame.
     syncedMasks_[0] = inputs[0];
     syncedMasks_[1] = inputs[1];
-    EmulatorEngine::instance().setInputMask(0, syncedMasks_[0]);
-    EmulatorEngine::instance().setInputMask(1, syncedMasks_[1]);
+    engine_().setInputMask(0, syncedMasks_[0]);
+    engine_().setInputMask(1, syncedMasks_[1]);
 
-    EmulatorEngine::instance().advanceFrame();
+    engine_().advanceFrame();
 
     // Notify GGPO that we advanced exactly one frame.
     ggpo_advance_frame(session_);
+    frame_++;
 
     // Allow GGPO to pump internal state.
     ggpo_idle(session_, 0);
     return;
 #endif
-    EmulatorEngine::instance().setLocalInputMask(localMask_);
-    EmulatorEngine::instance().advanceFrame();
+    engine_().setLocalInputMask(localMask_);
+    engine_().advanceFrame();
+    frame_++;
 }
 
 } // namespace snesonline
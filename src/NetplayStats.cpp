@@ -0,0 +1,182 @@
+#include "snesonline/NetplayStats.h"
+
+namespace snesonline {
+
+namespace {
+
+// Same clock and truncation the sessions stamp probes with.
+uint32_t toMicros32(NetplayStatsTracker::Clock::time_point t) noexcept {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(t.time_since_epoch()).count());
+}
+
+} // namespace
+
+void NetplayStatsTracker::reset(Clock::time_point now, uint32_t frameMicros) noexcept {
+    *this = NetplayStatsTracker{};
+    frameMicros_ = frameMicros ? frameMicros : 16639u;
+    rateStart_ = now;
+}
+
+uint32_t NetplayStatsTracker::bucketOf_(uint32_t rttUs) noexcept {
+    const uint32_t ms = rttUs / 1000u;
+    const uint32_t b = (ms < 64u) ? ms : 64u + (ms - 64u) / 8u;
+    return (b < kRttBuckets) ? b : kRttBuckets - 1;
+}
+
+uint32_t NetplayStatsTracker::bucketUpperMicros_(uint32_t bucket) noexcept {
+    const uint32_t ms = (bucket < 64u) ? bucket + 1u : 64u + (bucket - 63u) * 8u;
+    return ms * 1000u;
+}
+
+void NetplayStatsTracker::onDatagramReceived(std::size_t sizeBytes) noexcept {
+    packetsReceived_++;
+    bytesReceived_ += sizeBytes;
+}
+
+void NetplayStatsTracker::onProbeSent(uint32_t sentUs) noexcept {
+    Probe& p = probes_[nextProbeSeq_ % kProbeHistory];
+    if (p.state == ProbeState::Pending) probesLost_++;
+    p.sentUs = sentUs;
+    p.seq = nextProbeSeq_++;
+    p.state = ProbeState::Pending;
+    probesSent_++;
+}
+
+bool NetplayStatsTracker::onProbeAnswered(uint32_t sentUs, uint32_t arrivalUs) noexcept {
+    Probe* p = nullptr;
+    for (Probe& c : probes_) {
+        if (c.state != ProbeState::Empty && c.sentUs == sentUs) {
+            p = &c;
+            break;
+        }
+    }
+    if (!p) return false;
+
+    if (p->state == ProbeState::Answered) {
+        duplicates_++;
+        return true;
+    }
+    // An answer after the timeout was late, not lost.
+    if (p->state == ProbeState::Lost) probesLost_--;
+    p->state = ProbeState::Answered;
+    probesAnswered_++;
+
+    if (anyAnswered_ && static_cast<int32_t>(p->seq - newestAnsweredSeq_) < 0) outOfOrder_++;
+    else newestAnsweredSeq_ = p->seq;
+    anyAnswered_ = true;
+
+    onRttSample(arrivalUs - sentUs);
+    return true;
+}
+
+void NetplayStatsTracker::onRttSample(uint32_t rttUs) noexcept {
+    if (rttSamples_ == 0) {
+        rttMin_ = rttUs;
+        rttMax_ = rttUs;
+    } else {
+        const uint32_t d = (rttUs > rttLast_) ? rttUs - rttLast_ : rttLast_ - rttUs;
+        jitter16_ += d - ((jitter16_ + 8u) >> 4);
+        if (rttUs < rttMin_) rttMin_ = rttUs;
+        if (rttUs > rttMax_) rttMax_ = rttUs;
+    }
+    rttLast_ = rttUs;
+    rttSamples_++;
+    rttSumMicros_ += rttUs;
+    rttCount_[bucketOf_(rttUs)]++;
+
+    const uint64_t want = (static_cast<uint64_t>(rttSamples_) * 99u + 99u) / 100u;
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < kRttBuckets; ++b) {
+        seen += rttCount_[b];
+        if (seen >= want) {
+            const uint32_t upper = bucketUpperMicros_(b);
+            rttP99_ = (upper < rttMax_) ? upper : rttMax_;
+            if (rttP99_ < rttMin_) rttP99_ = rttMin_;
+            break;
+        }
+    }
+}
+
+void NetplayStatsTracker::onInputPacket(uint32_t newestFrame) noexcept {
+    if (anyInput_ && static_cast<int32_t>(newestFrame - newestInputFrame_) < 0) {
+        outOfOrder_++;
+        return;
+    }
+    newestInputFrame_ = newestFrame;
+    anyInput_ = true;
+}
+
+void NetplayStatsTracker::onStall(uint32_t micros) noexcept {
+    stallCount_++;
+    stalledFrames_ += (static_cast<uint64_t>(micros) + frameMicros_ - 1u) / frameMicros_;
+    stallMicrosTotal_ += micros;
+    if (micros > maxStallMicros_) maxStallMicros_ = micros;
+}
+
+void NetplayStatsTracker::onRollback(uint32_t depthFrames) noexcept {
+    rollbacks_++;
+    rolledBackFrames_ += depthFrames;
+    lastRollbackDepth_ = depthFrames;
+    if (depthFrames > maxRollbackDepth_) maxRollbackDepth_ = depthFrames;
+}
+
+void NetplayStatsTracker::update(Clock::time_point now, uint64_t packetsSent, uint64_t bytesSent) noexcept {
+    packetsSent_ = packetsSent;
+    bytesSent_ = bytesSent;
+
+    const uint32_t nowUs = toMicros32(now);
+    for (Probe& p : probes_) {
+        if (p.state == ProbeState::Pending && nowUs - p.sentUs >= kProbeTimeoutMicros) {
+            p.state = ProbeState::Lost;
+            probesLost_++;
+        }
+    }
+
+    const auto elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(now - rateStart_).count();
+    if (elapsedUs < 1000000) return;
+    const uint64_t cur[4] = {packetsSent_, bytesSent_, packetsReceived_, bytesReceived_};
+    for (int i = 0; i < 4; ++i) {
+        const uint64_t perSec = (cur[i] - rateBase_[i]) * 1000000u / static_cast<uint64_t>(elapsedUs);
+        rates_[i] = (perSec > 0xFFFFFFFFull) ? 0xFFFFFFFFu : static_cast<uint32_t>(perSec);
+        rateBase_[i] = cur[i];
+    }
+    rateStart_ = now;
+}
+
+void NetplayStatsTracker::fill(NetplayStats& out) const noexcept {
+    out.rttSamples = rttSamples_;
+    out.rttMinMicros = rttMin_;
+    out.rttAvgMicros = rttSamples_ ? static_cast<uint32_t>(rttSumMicros_ / rttSamples_) : 0u;
+    out.rttP99Micros = rttP99_;
+    out.rttMaxMicros = rttMax_;
+    out.rttLastMicros = rttLast_;
+    out.jitterMicros = jitter16_ >> 4;
+
+    out.probesSent = probesSent_;
+    out.probesAnswered = probesAnswered_;
+    const uint64_t resolved = probesAnswered_ + probesLost_;
+    out.lossPercent = resolved ? static_cast<float>(static_cast<double>(probesLost_) * 100.0 / static_cast<double>(resolved)) : -1.0f;
+    out.duplicatePackets = duplicates_;
+    out.outOfOrderPackets = outOfOrder_;
+
+    out.stallCount = stallCount_;
+    out.stalledFrames = stalledFrames_;
+    out.stallMicrosTotal = stallMicrosTotal_;
+    out.maxStallMicros = maxStallMicros_;
+
+    out.rollbackCount = rollbacks_;
+    out.rolledBackFrames = rolledBackFrames_;
+    out.lastRollbackDepth = lastRollbackDepth_;
+    out.maxRollbackDepth = maxRollbackDepth_;
+
+    out.packetsSent = packetsSent_;
+    out.bytesSent = bytesSent_;
+    out.packetsReceived = packetsReceived_;
+    out.bytesReceived = bytesReceived_;
+    out.packetsSentPerSecond = rates_[0];
+    out.bytesSentPerSecond = rates_[1];
+    out.packetsReceivedPerSecond = rates_[2];
+    out.bytesReceivedPerSecond = rates_[3];
+}
+
+} // namespace snesonline
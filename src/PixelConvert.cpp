@@ -0,0 +1,336 @@
+#include "snesonline/PixelConvert.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SNESONLINE_PIXEL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SNESONLINE_PIXEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Per-function ISA enablement, so this file builds with the default flags of every platform
+// (the iOS project compiles src/ directly) and only dispatches to what the CPU reports.
+#if defined(__GNUC__) || defined(__clang__)
+#define SNESONLINE_TARGET(x) __attribute__((target(x)))
+#else
+#define SNESONLINE_TARGET(x)
+#endif
+
+namespace snesonline {
+
+namespace {
+
+using PF = LibretroCore::PixelFormat;
+using DF = DstPixelFormat;
+
+constexpr std::size_t kSrcFormats = 3;
+constexpr std::size_t kDstFormats = 2;
+
+// 16-bit layouts: where red starts and how wide green is (0RGB1555: 5, RGB565: 6).
+template <PF S>
+constexpr int kRedShift = S == PF::RGB565 ? 11 : 10;
+template <PF S>
+constexpr uint16_t kGreenMask = S == PF::RGB565 ? 0x3F : 0x1F;
+
+// All supported targets are little-endian; loads go through memcpy to stay alignment-agnostic.
+inline uint32_t load16_(const uint8_t* p) noexcept {
+    uint16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t load32_(const uint8_t* p) noexcept {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t expand5_(uint32_t v) noexcept { return (v << 3) | (v >> 2); }
+inline uint32_t expand6_(uint32_t v) noexcept { return (v << 2) | (v >> 4); }
+
+template <DF D>
+inline uint32_t pack_(uint32_t r, uint32_t g, uint32_t b) noexcept {
+    if constexpr (D == DF::ARGB8888) {
+        return 0xFF000000u | (r << 16) | (g << 8) | b;
+    } else {
+        return 0xFF000000u | (b << 16) | (g << 8) | r;
+    }
+}
+
+// Converts pixels [begin, count) of a run; also the tail of every SIMD kernel.
+template <PF S, DF D>
+void rowScalar_(const uint8_t* src, uint8_t* dst, std::size_t begin, std::size_t count) noexcept {
+    for (std::size_t x = begin; x < count; ++x) {
+        uint32_t out;
+        if constexpr (S == PF::XRGB8888) {
+            const uint32_t p = load32_(src + x * 4);
+            out = pack_<D>((p >> 16) & 0xFFu, (p >> 8) & 0xFFu, p & 0xFFu);
+        } else {
+            const uint32_t p = load16_(src + x * 2);
+            const uint32_t g = (p >> 5) & kGreenMask<S>;
+            out = pack_<D>(expand5_((p >> kRedShift<S>) & 0x1Fu), S == PF::RGB565 ? expand6_(g) : expand5_(g), expand5_(p & 0x1Fu));
+        }
+        std::memcpy(dst + x * 4, &out, sizeof(out));
+    }
+}
+
+using RowFn = void (*)(const uint8_t* src, uint8_t* dst, std::size_t count) noexcept;
+
+template <PF S, DF D>
+struct ScalarRow {
+    static void run(const uint8_t* src, uint8_t* dst, std::size_t count) noexcept { rowScalar_<S, D>(src, dst, 0, count); }
+};
+
+#if defined(SNESONLINE_PIXEL_X86)
+
+// ---- x86-64 kernels ----
+// 16-bit sources: every channel is widened in its own 16-bit lane, then (G << 8 | byte 0) and
+// (0xFF00 | byte 2) are interleaved into 32-bit pixels.
+
+template <PF S, DF D>
+struct Sse2Row {
+    static void run(const uint8_t* src, uint8_t* dst, std::size_t count) noexcept {
+        std::size_t x = 0;
+        if constexpr (S == PF::XRGB8888) {
+            const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+            const __m128i greenMask = _mm_set1_epi32(0x0000FF00);
+            const __m128i redBlueMask = _mm_set1_epi32(0x00FF00FF);
+            for (; x + 4 <= count; x += 4) {
+                __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+                if constexpr (D == DF::ABGR8888) {
+                    const __m128i rb = _mm_and_si128(p, redBlueMask);
+                    p = _mm_or_si128(_mm_and_si128(p, greenMask), _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16)));
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_or_si128(p, alpha));
+            }
+        } else {
+            const __m128i mask5 = _mm_set1_epi16(0x1F);
+            const __m128i maskG = _mm_set1_epi16(kGreenMask<S>);
+            const __m128i alpha = _mm_set1_epi16(static_cast<short>(0xFF00));
+            for (; x + 8 <= count; x += 8) {
+                const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 2));
+                __m128i r = _mm_and_si128(_mm_srli_epi16(p, kRedShift<S>), mask5);
+                __m128i g = _mm_and_si128(_mm_srli_epi16(p, 5), maskG);
+                __m128i b = _mm_and_si128(p, mask5);
+                r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+                b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+                if constexpr (S == PF::RGB565) {
+                    g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+                } else {
+                    g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+                }
+                const __m128i lo = _mm_or_si128(_mm_slli_epi16(g, 8), D == DF::ARGB8888 ? b : r);
+                const __m128i hi = _mm_or_si128(D == DF::ARGB8888 ? r : b, alpha);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_unpacklo_epi16(lo, hi));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4 + 16), _mm_unpackhi_epi16(lo, hi));
+            }
+        }
+        rowScalar_<S, D>(src, dst, x, count);
+    }
+};
+
+template <PF S, DF D>
+struct Avx2Row {
+    SNESONLINE_TARGET("avx2")
+    static void run(const uint8_t* src, uint8_t* dst, std::size_t count) noexcept {
+        std::size_t x = 0;
+        if constexpr (S == PF::XRGB8888) {
+            const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+            const __m256i greenMask = _mm256_set1_epi32(0x0000FF00);
+            const __m256i redBlueMask = _mm256_set1_epi32(0x00FF00FF);
+            for (; x + 8 <= count; x += 8) {
+                __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+                if constexpr (D == DF::ABGR8888) {
+                    const __m256i rb = _mm256_and_si256(p, redBlueMask);
+                    p = _mm256_or_si256(_mm256_and_si256(p, greenMask), _mm256_or_si256(_mm256_slli_epi32(rb, 16), _mm256_srli_epi32(rb, 16)));
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), _mm256_or_si256(p, alpha));
+            }
+        } else {
+            const __m256i mask5 = _mm256_set1_epi16(0x1F);
+            const __m256i maskG = _mm256_set1_epi16(kGreenMask<S>);
+            const __m256i alpha = _mm256_set1_epi16(static_cast<short>(0xFF00));
+            for (; x + 16 <= count; x += 16) {
+                const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 2));
+                __m256i r = _mm256_and_si256(_mm256_srli_epi16(p, kRedShift<S>), mask5);
+                __m256i g = _mm256_and_si256(_mm256_srli_epi16(p, 5), maskG);
+                __m256i b = _mm256_and_si256(p, mask5);
+                r = _mm256_or_si256(_mm256_slli_epi16(r, 3), _mm256_srli_epi16(r, 2));
+                b = _mm256_or_si256(_mm256_slli_epi16(b, 3), _mm256_srli_epi16(b, 2));
+                if constexpr (S == PF::RGB565) {
+                    g = _mm256_or_si256(_mm256_slli_epi16(g, 2), _mm256_srli_epi16(g, 4));
+                } else {
+                    g = _mm256_or_si256(_mm256_slli_epi16(g, 3), _mm256_srli_epi16(g, 2));
+                }
+                const __m256i lo = _mm256_or_si256(_mm256_slli_epi16(g, 8), D == DF::ARGB8888 ? b : r);
+                const __m256i hi = _mm256_or_si256(D == DF::ARGB8888 ? r : b, alpha);
+                // Unpacks work per 128-bit lane: pixels 0-3|8-11 and 4-7|12-15, put back in order.
+                const __m256i a = _mm256_unpacklo_epi16(lo, hi);
+                const __m256i c = _mm256_unpackhi_epi16(lo, hi);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), _mm256_permute2x128_si256(a, c, 0x20));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4 + 32), _mm256_permute2x128_si256(a, c, 0x31));
+            }
+        }
+        rowScalar_<S, D>(src, dst, x, count);
+    }
+};
+
+bool detectAvx2_() noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int r[4] = {};
+    __cpuid(r, 0);
+    const int maxLeaf = r[0];
+    __cpuid(r, 1);
+    const bool osxsave = (r[2] & (1 << 27)) != 0;
+    const bool avx = (r[2] & (1 << 28)) != 0;
+    const bool ymmEnabled = osxsave && avx && ((_xgetbv(0) & 6u) == 6u);
+    if (maxLeaf < 7) return false;
+    __cpuidex(r, 7, 0);
+    return ymmEnabled && (r[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#elif defined(SNESONLINE_PIXEL_NEON)
+
+// ---- ARM kernels ----
+// Channels are narrowed to bytes and written with an interleaving store (B,G,R,A or R,G,B,A).
+
+template <PF S, DF D>
+struct NeonRow {
+    static void run(const uint8_t* src, uint8_t* dst, std::size_t count) noexcept {
+        std::size_t x = 0;
+        if constexpr (S == PF::XRGB8888) {
+            for (; x + 16 <= count; x += 16) {
+                uint8x16x4_t p = vld4q_u8(src + x * 4);
+                if constexpr (D == DF::ABGR8888) {
+                    const uint8x16_t t = p.val[0];
+                    p.val[0] = p.val[2];
+                    p.val[2] = t;
+                }
+                p.val[3] = vdupq_n_u8(0xFF);
+                vst4q_u8(dst + x * 4, p);
+            }
+        } else {
+            const uint16x8_t mask5 = vdupq_n_u16(0x1F);
+            const uint16x8_t maskG = vdupq_n_u16(kGreenMask<S>);
+            for (; x + 8 <= count; x += 8) {
+                const uint16x8_t p = vreinterpretq_u16_u8(vld1q_u8(src + x * 2));
+                uint16x8_t r = vandq_u16(vshrq_n_u16(p, kRedShift<S>), mask5);
+                uint16x8_t g = vandq_u16(vshrq_n_u16(p, 5), maskG);
+                uint16x8_t b = vandq_u16(p, mask5);
+                r = vorrq_u16(vshlq_n_u16(r, 3), vshrq_n_u16(r, 2));
+                b = vorrq_u16(vshlq_n_u16(b, 3), vshrq_n_u16(b, 2));
+                if constexpr (S == PF::RGB565) {
+                    g = vorrq_u16(vshlq_n_u16(g, 2), vshrq_n_u16(g, 4));
+                } else {
+                    g = vorrq_u16(vshlq_n_u16(g, 3), vshrq_n_u16(g, 2));
+                }
+                uint8x8x4_t o;
+                o.val[0] = vmovn_u16(D == DF::ARGB8888 ? b : r);
+                o.val[1] = vmovn_u16(g);
+                o.val[2] = vmovn_u16(D == DF::ARGB8888 ? r : b);
+                o.val[3] = vdup_n_u8(0xFF);
+                vst4_u8(dst + x * 4, o);
+            }
+        }
+        rowScalar_<S, D>(src, dst, x, count);
+    }
+};
+
+#endif
+
+struct Kernels {
+    RowFn rows[kSrcFormats][kDstFormats] = {};
+    const char* name = "scalar";
+};
+
+template <template <PF, DF> class Row, PF S, DF D>
+void set_(Kernels& k) noexcept {
+    k.rows[static_cast<std::size_t>(S)][static_cast<std::size_t>(D)] = &Row<S, D>::run;
+}
+
+template <template <PF, DF> class Row>
+void setAll_(Kernels& k, const char* name) noexcept {
+    set_<Row, PF::XRGB1555, DF::ARGB8888>(k);
+    set_<Row, PF::XRGB1555, DF::ABGR8888>(k);
+    set_<Row, PF::XRGB8888, DF::ARGB8888>(k);
+    set_<Row, PF::XRGB8888, DF::ABGR8888>(k);
+    set_<Row, PF::RGB565, DF::ARGB8888>(k);
+    set_<Row, PF::RGB565, DF::ABGR8888>(k);
+    k.name = name;
+}
+
+Kernels portableKernels_() noexcept {
+    Kernels k;
+    setAll_<ScalarRow>(k, "scalar");
+    return k;
+}
+
+Kernels selectKernels_() noexcept {
+    Kernels k = portableKernels_();
+#if defined(SNESONLINE_PIXEL_X86)
+    setAll_<Sse2Row>(k, "sse2");
+    if (detectAvx2_()) setAll_<Avx2Row>(k, "avx2");
+#elif defined(SNESONLINE_PIXEL_NEON)
+    setAll_<NeonRow>(k, "neon");
+#endif
+    return k;
+}
+
+const Kernels& kernels_() noexcept {
+    static const Kernels k = selectKernels_();
+    return k;
+}
+
+const Kernels& portable_() noexcept {
+    static const Kernels k = portableKernels_();
+    return k;
+}
+
+bool convertWith_(const Kernels& k, PF srcFormat, DF dstFormat, const void* src, std::size_t srcPitchBytes, void* dst,
+                  std::size_t dstPitchBytes, unsigned width, unsigned height) noexcept {
+    const auto s = static_cast<std::size_t>(srcFormat);
+    const auto d = static_cast<std::size_t>(dstFormat);
+    if (s >= kSrcFormats || d >= kDstFormats || !src || !dst) return false;
+    if (width == 0 || height == 0) return true;
+
+    const RowFn row = k.rows[s][d];
+    const std::size_t srcRowBytes = static_cast<std::size_t>(width) * (srcFormat == PF::XRGB8888 ? 4u : 2u);
+    const std::size_t dstRowBytes = static_cast<std::size_t>(width) * 4u;
+    const auto* in = static_cast<const uint8_t*>(src);
+    auto* out = static_cast<uint8_t*>(dst);
+
+    // Rows packed back to back on both sides convert as one run (no per-row tails).
+    if (srcPitchBytes == srcRowBytes && dstPitchBytes == dstRowBytes) {
+        row(in, out, static_cast<std::size_t>(width) * height);
+        return true;
+    }
+    for (unsigned y = 0; y < height; ++y) {
+        row(in + y * srcPitchBytes, out + y * dstPitchBytes, width);
+    }
+    return true;
+}
+
+} // namespace
+
+bool convertPixels(LibretroCore::PixelFormat srcFormat, DstPixelFormat dstFormat, const void* src, std::size_t srcPitchBytes,
+                   void* dst, std::size_t dstPitchBytes, unsigned width, unsigned height) noexcept {
+    return convertWith_(kernels_(), srcFormat, dstFormat, src, srcPitchBytes, dst, dstPitchBytes, width, height);
+}
+
+bool convertPixelsPortable(LibretroCore::PixelFormat srcFormat, DstPixelFormat dstFormat, const void* src, std::size_t srcPitchBytes,
+                           void* dst, std::size_t dstPitchBytes, unsigned width, unsigned height) noexcept {
+    return convertWith_(portable_(), srcFormat, dstFormat, src, srcPitchBytes, dst, dstPitchBytes, width, height);
+}
+
+const char* pixelConvertKernelName() noexcept { return kernels_().name; }
+
+} // namespace snesonline
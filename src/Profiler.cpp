@@ -0,0 +1,305 @@
+#include "snesonline/Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+
+namespace snesonline {
+
+namespace {
+
+// Event fields are relaxed atomics so a reader copying a slot while its thread overwrites it is
+// well-defined; the reader then discards the slot by re-checking head.
+struct EventSlot {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> startNs{0};
+    std::atomic<uint32_t> durationNs{0};
+    std::atomic<uint32_t> depth{0};
+};
+
+struct ThreadRing {
+    std::atomic<uint64_t> head{0};      // events ever written; slot = index % kEventsPerThread
+    std::atomic<uint64_t> clearedAt{0}; // readers ignore indices below this
+    std::atomic<const char*> threadName{nullptr};
+    std::atomic<bool> inUse{true};      // cleared when the owning thread exits
+    uint32_t tid = 0;
+    uint32_t depth = 0; // owner thread only
+    EventSlot events[Profiler::kEventsPerThread];
+};
+
+const Profiler::Clock::time_point g_epoch = Profiler::Clock::now();
+
+std::atomic<bool> g_enabled{true};
+std::atomic<uint64_t> g_dropped{0};
+std::atomic<uint32_t> g_slotCount{0};
+std::atomic<ThreadRing*> g_slots[Profiler::kMaxThreads] = {};
+
+thread_local ThreadRing* t_ring = nullptr;
+thread_local bool t_ringFailed = false;
+
+// Hands the thread's ring back when the thread exits. Separate from t_ring so the recording path
+// reads a trivially destructible thread_local.
+struct RingRelease {
+    ThreadRing* ring = nullptr;
+    ~RingRelease() {
+        if (!ring) return;
+        t_ring = nullptr;
+        ring->inUse.store(false, std::memory_order_release);
+    }
+};
+thread_local RingRelease t_ringRelease;
+
+// A ring whose thread has exited, claimed for the calling thread; its old events are dropped.
+ThreadRing* reuseRing() noexcept {
+    const uint32_t count = std::min<uint32_t>(g_slotCount.load(std::memory_order_relaxed), Profiler::kMaxThreads);
+    for (uint32_t i = 0; i < count; ++i) {
+        ThreadRing* ring = g_slots[i].load(std::memory_order_acquire);
+        bool free = false;
+        if (!ring || !ring->inUse.compare_exchange_strong(free, true, std::memory_order_acq_rel)) continue;
+        ring->clearedAt.store(ring->head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        ring->threadName.store(nullptr, std::memory_order_relaxed);
+        ring->depth = 0;
+        return ring;
+    }
+    return nullptr;
+}
+
+ThreadRing* threadRing() noexcept {
+    if (t_ring) return t_ring;
+    if (t_ringFailed) return nullptr;
+    t_ringFailed = true;
+
+    ThreadRing* ring = reuseRing();
+    if (!ring) {
+        const uint32_t slot = g_slotCount.fetch_add(1, std::memory_order_relaxed);
+        if (slot >= Profiler::kMaxThreads) return nullptr;
+        ring = new (std::nothrow) ThreadRing();
+        if (!ring) return nullptr;
+        ring->tid = slot + 1;
+        g_slots[slot].store(ring, std::memory_order_release);
+    }
+
+    t_ringFailed = false;
+    t_ring = ring;
+    t_ringRelease.ring = ring;
+    return ring;
+}
+
+// Copies the events of `ring` that are still intact when the copy ends.
+template <typename Fn>
+void forEachEvent(const ThreadRing& ring, Fn&& fn) {
+    constexpr uint64_t n = Profiler::kEventsPerThread;
+    const uint64_t head = ring.head.load(std::memory_order_acquire);
+    uint64_t first = head > n ? head - n : 0;
+    first = std::max(first, ring.clearedAt.load(std::memory_order_relaxed));
+
+    std::vector<Profiler::Event> copy;
+    copy.reserve(static_cast<std::size_t>(head - first));
+    for (uint64_t i = first; i < head; ++i) {
+        const EventSlot& s = ring.events[i % n];
+        Profiler::Event e;
+        e.name = s.name.load(std::memory_order_relaxed);
+        e.startNs = s.startNs.load(std::memory_order_relaxed);
+        e.durationNs = s.durationNs.load(std::memory_order_relaxed);
+        e.depth = s.depth.load(std::memory_order_relaxed);
+        copy.push_back(e);
+    }
+
+    // The writer may have lapped us: slots at or below newHead - n are no longer ours.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t newHead = ring.head.load(std::memory_order_relaxed);
+    const uint64_t valid = newHead >= n ? newHead - n + 1 : 0;
+    for (uint64_t i = first; i < head; ++i) {
+        if (i < valid) continue;
+        const Profiler::Event& e = copy[static_cast<std::size_t>(i - first)];
+        if (e.name) fn(e);
+    }
+}
+
+template <typename Fn>
+void forEachRing(Fn&& fn) {
+    const uint32_t count = std::min<uint32_t>(g_slotCount.load(std::memory_order_relaxed), Profiler::kMaxThreads);
+    for (uint32_t i = 0; i < count; ++i) {
+        ThreadRing* ring = g_slots[i].load(std::memory_order_acquire);
+        if (ring) fn(*ring);
+    }
+}
+
+void writeJsonString(std::FILE* f, const char* s) {
+    std::fputc('"', f);
+    for (; *s; ++s) {
+        const unsigned char c = static_cast<unsigned char>(*s);
+        if (c == '"' || c == '\\') std::fputc('\\', f);
+        if (c < 0x20) std::fprintf(f, "\\u%04x", c);
+        else std::fputc(c, f);
+    }
+    std::fputc('"', f);
+}
+
+double percentileUs(const std::vector<uint32_t>& sortedNs, double p) {
+    if (sortedNs.empty()) return 0.0;
+    const std::size_t i = static_cast<std::size_t>(p * static_cast<double>(sortedNs.size() - 1) + 0.5);
+    return static_cast<double>(sortedNs[i]) / 1000.0;
+}
+
+} // namespace
+
+void Profiler::setEnabled(bool enabled) noexcept {
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::enabled() noexcept {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::setThreadName(const char* name) noexcept {
+    if (ThreadRing* ring = threadRing()) ring->threadName.store(name, std::memory_order_relaxed);
+}
+
+void Profiler::clear() noexcept {
+    forEachRing([](ThreadRing& ring) { ring.clearedAt.store(ring.head.load(std::memory_order_acquire), std::memory_order_relaxed); });
+    g_dropped.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Profiler::droppedEvents() noexcept {
+    return g_dropped.load(std::memory_order_relaxed);
+}
+
+bool Profiler::begin_(uint32_t& depth) noexcept {
+    if (!g_enabled.load(std::memory_order_relaxed)) return false;
+    ThreadRing* ring = threadRing();
+    if (!ring) {
+        g_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    depth = ring->depth++;
+    return true;
+}
+
+void Profiler::end_(const char* name, Clock::time_point start, uint32_t depth) noexcept {
+    const Clock::time_point end = Clock::now();
+    ThreadRing* ring = t_ring;
+    if (!ring) return;
+    ring->depth = depth;
+
+    const uint64_t h = ring->head.load(std::memory_order_relaxed);
+    EventSlot& s = ring->events[h % kEventsPerThread];
+    const auto startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start - g_epoch).count();
+    const auto durNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    s.name.store(name, std::memory_order_relaxed);
+    s.startNs.store(startNs > 0 ? static_cast<uint64_t>(startNs) : 0u, std::memory_order_relaxed);
+    s.durationNs.store(durNs > 0xFFFFFFFFll ? 0xFFFFFFFFu : static_cast<uint32_t>(durNs), std::memory_order_relaxed);
+    s.depth.store(depth, std::memory_order_relaxed);
+    ring->head.store(h + 1, std::memory_order_release);
+}
+
+bool Profiler::writeChromeTrace(const char* path) noexcept {
+    if (!path || !path[0]) return false;
+    std::FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+    const bool ok = writeChromeTrace(f);
+    return (std::fclose(f) == 0) && ok;
+}
+
+bool Profiler::writeChromeTrace(std::FILE* f) noexcept {
+    if (!f) return false;
+    try {
+        bool first = true;
+        auto sep = [&] {
+            std::fputs(first ? "\n" : ",\n", f);
+            first = false;
+        };
+
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", f);
+        forEachRing([&](const ThreadRing& ring) {
+            sep();
+            const char* tn = ring.threadName.load(std::memory_order_relaxed);
+            std::fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", ring.tid);
+            if (tn) writeJsonString(f, tn);
+            else std::fprintf(f, "\"thread %u\"", ring.tid);
+            std::fputs("}}", f);
+
+            forEachEvent(ring, [&](const Event& e) {
+                sep();
+                std::fputs("{\"name\":", f);
+                writeJsonString(f, e.name);
+                std::fprintf(f, ",\"cat\":\"snesonline\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", ring.tid,
+                             static_cast<double>(e.startNs) / 1000.0, static_cast<double>(e.durationNs) / 1000.0);
+            });
+        });
+        std::fputs("\n]}\n", f);
+    } catch (...) {
+        return false;
+    }
+    return std::ferror(f) == 0;
+}
+
+bool Profiler::summarize(std::vector<PhaseStats>& out) noexcept {
+    out.clear();
+    try {
+        struct Sample {
+            const char* name;
+            uint32_t ns;
+        };
+        std::vector<Sample> all;
+        forEachRing([&](const ThreadRing& ring) { forEachEvent(ring, [&](const Event& e) { all.push_back({e.name, e.durationNs}); }); });
+
+        // The same label may live at different addresses in different translation units.
+        std::sort(all.begin(), all.end(), [](const Sample& a, const Sample& b) {
+            const int c = std::strcmp(a.name, b.name);
+            return c != 0 ? c < 0 : a.ns < b.ns;
+        });
+
+        std::vector<uint32_t> durations;
+        std::vector<double> totals;
+        for (std::size_t i = 0; i < all.size();) {
+            std::size_t j = i;
+            durations.clear();
+            double total = 0.0;
+            while (j < all.size() && std::strcmp(all[j].name, all[i].name) == 0) {
+                durations.push_back(all[j].ns);
+                total += static_cast<double>(all[j].ns);
+                ++j;
+            }
+            PhaseStats st;
+            st.name = all[i].name;
+            st.count = durations.size();
+            st.meanUs = total / static_cast<double>(durations.size()) / 1000.0;
+            st.p50Us = percentileUs(durations, 0.50);
+            st.p99Us = percentileUs(durations, 0.99);
+            st.maxUs = static_cast<double>(durations.back()) / 1000.0;
+            out.push_back(st);
+            totals.push_back(total);
+            i = j;
+        }
+
+        std::vector<std::size_t> order(out.size());
+        for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return totals[a] > totals[b]; });
+        std::vector<PhaseStats> sorted;
+        sorted.reserve(out.size());
+        for (std::size_t i : order) sorted.push_back(out[i]);
+        out.swap(sorted);
+    } catch (...) {
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+bool Profiler::writeSummary(std::FILE* f) noexcept {
+    if (!f) return false;
+    std::vector<PhaseStats> phases;
+    if (!summarize(phases)) return false;
+    std::fprintf(f, "%-28s %9s %10s %10s %10s %10s\n", "phase", "count", "mean us", "p50 us", "p99 us", "max us");
+    for (const PhaseStats& p : phases) {
+        std::fprintf(f, "%-28s %9llu %10.1f %10.1f %10.1f %10.1f\n", p.name, static_cast<unsigned long long>(p.count), p.meanUs, p.p50Us, p.p99Us,
+                     p.maxUs);
+    }
+    const uint64_t dropped = droppedEvents();
+    if (dropped) std::fprintf(f, "(%llu events not recorded: no per-thread ring)\n", static_cast<unsigned long long>(dropped));
+    return std::ferror(f) == 0;
+}
+
+} // namespace snesonline
@@ -0,0 +1,311 @@
+#include "snesonline/Replay.h"
+
+#include "snesonline/EmulatorEngine.h"
+#include "snesonline/Hash.h"
+#include "snesonline/Lz.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace snesonline {
+
+namespace {
+
+static constexpr std::size_t kRunBytes = 5;
+// Runs buffered between disk writes (about 800 runs; at least 13 s of constantly changing input).
+static constexpr std::size_t kBufferBytes = 4096;
+
+inline void put16(uint8_t* p, uint16_t v) noexcept {
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+}
+
+inline void put32(uint8_t* p, uint32_t v) noexcept {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (24 - 8 * i));
+}
+
+inline uint16_t get16(const uint8_t* p) noexcept {
+    return static_cast<uint16_t>((static_cast<uint16_t>(p[0]) << 8) | p[1]);
+}
+
+inline uint32_t get32(const uint8_t* p) noexcept {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+void copyName(char (&dst)[32], const std::string& src) noexcept {
+    std::memset(dst, 0, sizeof(dst));
+    std::memcpy(dst, src.data(), src.size() < sizeof(dst) - 1 ? src.size() : sizeof(dst) - 1);
+}
+
+void buildHeader(const ReplayHeader& h, uint8_t (&out)[kReplayHeaderBytes]) noexcept {
+    std::memset(out, 0, sizeof(out));
+    put32(out, kReplayMagic);
+    put16(out + 4, kReplayVersion);
+    put16(out + 6, static_cast<uint16_t>(kReplayHeaderBytes));
+    put32(out + 8, h.flags);
+    put32(out + 12, h.startFrame);
+    put32(out + 16, h.frameCount);
+    put32(out + 20, h.endChecksum);
+    put32(out + 24, h.romCrc32);
+    put32(out + 28, h.romSizeBytes);
+    put32(out + 32, h.stateRawBytes);
+    put32(out + 36, h.stateCompressedBytes);
+    put32(out + 40, h.stateCrc32);
+    std::memcpy(out + 44, h.coreName, sizeof(h.coreName));
+    std::memcpy(out + 76, h.coreVersion, sizeof(h.coreVersion));
+}
+
+bool parseHeader(const uint8_t (&in)[kReplayHeaderBytes], ReplayHeader& h) noexcept {
+    if (get32(in) != kReplayMagic || get16(in + 4) != kReplayVersion) return false;
+    if (get16(in + 6) != kReplayHeaderBytes) return false;
+    h.flags = get32(in + 8);
+    h.startFrame = get32(in + 12);
+    h.frameCount = get32(in + 16);
+    h.endChecksum = get32(in + 20);
+    h.romCrc32 = get32(in + 24);
+    h.romSizeBytes = get32(in + 28);
+    h.stateRawBytes = get32(in + 32);
+    h.stateCompressedBytes = get32(in + 36);
+    h.stateCrc32 = get32(in + 40);
+    std::memcpy(h.coreName, in + 44, sizeof(h.coreName));
+    std::memcpy(h.coreVersion, in + 76, sizeof(h.coreVersion));
+    h.coreName[sizeof(h.coreName) - 1] = '\0';
+    h.coreVersion[sizeof(h.coreVersion) - 1] = '\0';
+    return true;
+}
+
+} // namespace
+
+bool replayIdentity(EmulatorEngine& engine, ReplayHeader& out) noexcept {
+    copyName(out.coreName, engine.core().libraryName());
+    copyName(out.coreVersion, engine.core().libraryVersion());
+    out.romCrc32 = 0;
+    out.romSizeBytes = 0;
+
+    const std::string& romPath = engine.core().romPath();
+    if (romPath.empty()) return false;
+    std::FILE* f = std::fopen(romPath.c_str(), "rb");
+    if (!f) return false;
+    uint8_t buf[64 * 1024];
+    uint32_t crc = 0;
+    uint64_t size = 0;
+    std::size_t n = 0;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) {
+        crc = crc32(buf, n, crc);
+        size += n;
+    }
+    const bool ok = !std::ferror(f);
+    std::fclose(f);
+    if (!ok) return false;
+    out.romCrc32 = crc;
+    out.romSizeBytes = static_cast<uint32_t>(size);
+    return true;
+}
+
+bool replayMatchesEngine(const ReplayHeader& header, EmulatorEngine& engine) noexcept {
+    ReplayHeader mine{};
+    const bool romKnown = replayIdentity(engine, mine);
+    if (std::strncmp(header.coreName, mine.coreName, sizeof(mine.coreName)) != 0) return false;
+    if (romKnown && header.romSizeBytes != 0) {
+        if (header.romCrc32 != mine.romCrc32 || header.romSizeBytes != mine.romSizeBytes) return false;
+    }
+    return true;
+}
+
+ReplayWriter::~ReplayWriter() noexcept { (void)close(); }
+
+bool ReplayWriter::open(const char* path, EmulatorEngine& engine, uint32_t startFrame, bool withStartState) noexcept {
+    (void)close();
+    if (!path || !path[0]) return false;
+
+    header_ = {};
+    header_.startFrame = startFrame;
+    (void)replayIdentity(engine, header_);
+
+    std::vector<uint8_t> packed;
+    if (withStartState) {
+        SaveState st;
+        if (!engine.saveState(st)) return false;
+        try {
+            packed.resize(lzMaxCompressedSize(st.sizeBytes));
+        } catch (...) {
+            return false;
+        }
+        const std::size_t n = lzCompress(st.buffer.data(), st.sizeBytes, packed.data(), packed.size());
+        if (n == 0) return false;
+        packed.resize(n);
+        header_.flags |= kReplayHasStartState;
+        header_.stateRawBytes = static_cast<uint32_t>(st.sizeBytes);
+        header_.stateCompressedBytes = static_cast<uint32_t>(n);
+        header_.stateCrc32 = crc32(st.buffer.data(), st.sizeBytes);
+    }
+
+    try {
+        buf_.resize(kBufferBytes);
+    } catch (...) {
+        return false;
+    }
+
+    file_ = std::fopen(path, "wb");
+    if (!file_) return false;
+
+    uint8_t head[kReplayHeaderBytes];
+    buildHeader(header_, head);
+    failed_ = std::fwrite(head, 1, sizeof(head), file_) != sizeof(head);
+    if (!packed.empty() && std::fwrite(packed.data(), 1, packed.size(), file_) != packed.size()) failed_ = true;
+    written_ = sizeof(head) + packed.size();
+    used_ = 0;
+    frames_ = 0;
+    runLength_ = 0;
+    return !failed_;
+}
+
+void ReplayWriter::emitRun_() noexcept {
+    if (used_ + kRunBytes > buf_.size() && !flush_()) return;
+    uint8_t* p = buf_.data() + used_;
+    p[0] = runLength_;
+    put16(p + 1, runP1_);
+    put16(p + 3, runP2_);
+    used_ += kRunBytes;
+}
+
+bool ReplayWriter::flush_() noexcept {
+    if (used_ != 0) {
+        if (std::fwrite(buf_.data(), 1, used_, file_) != used_) failed_ = true;
+        written_ += used_;
+        used_ = 0;
+    }
+    return !failed_;
+}
+
+bool ReplayWriter::close(uint32_t endChecksum) noexcept {
+    if (!file_) return false;
+    if (runLength_ != 0) emitRun_();
+    runLength_ = 0;
+    (void)flush_();
+
+    header_.frameCount = frames_;
+    header_.endChecksum = endChecksum;
+    uint8_t head[kReplayHeaderBytes];
+    buildHeader(header_, head);
+    // A non-seekable target (pipe) keeps kReplayUnknownFrames; readers then run to end of file.
+    if (std::fseek(file_, 0, SEEK_SET) == 0 && std::fwrite(head, 1, sizeof(head), file_) != sizeof(head)) failed_ = true;
+    if (std::fclose(file_) != 0) failed_ = true;
+    file_ = nullptr;
+    return !failed_;
+}
+
+ReplayReader::~ReplayReader() noexcept { close(); }
+
+bool ReplayReader::open(const char* path) noexcept {
+    close();
+    if (!path || !path[0]) return false;
+    file_ = std::fopen(path, "rb");
+    if (!file_) return false;
+
+    uint8_t head[kReplayHeaderBytes];
+    if (std::fread(head, 1, sizeof(head), file_) != sizeof(head) || !parseHeader(head, header_)) {
+        close();
+        return false;
+    }
+
+    try {
+        buf_.resize(kBufferBytes);
+        state_.resize((header_.flags & kReplayHasStartState) ? header_.stateCompressedBytes : 0u);
+    } catch (...) {
+        close();
+        return false;
+    }
+    if (!state_.empty() && std::fread(state_.data(), 1, state_.size(), file_) != state_.size()) {
+        close();
+        return false;
+    }
+    inputsOffset_ = static_cast<long>(kReplayHeaderBytes + state_.size());
+    pos_ = 0;
+    end_ = 0;
+    framesRead_ = 0;
+    runLeft_ = 0;
+    return true;
+}
+
+void ReplayReader::close() noexcept {
+    if (file_) std::fclose(file_);
+    file_ = nullptr;
+    header_ = {};
+    pos_ = 0;
+    end_ = 0;
+    framesRead_ = 0;
+    runLeft_ = 0;
+}
+
+bool ReplayReader::loadStartState(EmulatorEngine& engine) noexcept {
+    if (!file_) return false;
+    if (std::fseek(file_, inputsOffset_, SEEK_SET) != 0) return false;
+    pos_ = 0;
+    end_ = 0;
+    framesRead_ = 0;
+    runLeft_ = 0;
+    if (!(header_.flags & kReplayHasStartState)) return true;
+
+    std::vector<uint8_t> raw;
+    try {
+        raw.resize(header_.stateRawBytes);
+    } catch (...) {
+        return false;
+    }
+    const std::size_t n = lzDecompress(state_.data(), state_.size(), raw.data(), raw.size());
+    if (n != header_.stateRawBytes || crc32(raw.data(), n) != header_.stateCrc32) return false;
+    return engine.loadStateFrom(raw.data(), n);
+}
+
+bool ReplayReader::refill_() noexcept {
+    // Keep a partial run at the front and read behind it.
+    const std::size_t left = end_ - pos_;
+    if (left != 0) std::memmove(buf_.data(), buf_.data() + pos_, left);
+    pos_ = 0;
+    end_ = left + std::fread(buf_.data() + left, 1, buf_.size() - left, file_);
+    return end_ - pos_ >= kRunBytes;
+}
+
+bool ReplayReader::next(uint16_t& p1, uint16_t& p2) noexcept {
+    if (!file_) return false;
+    if (header_.frameCount != kReplayUnknownFrames && framesRead_ >= header_.frameCount) return false;
+    if (runLeft_ == 0) {
+        if (end_ - pos_ < kRunBytes && !refill_()) return false;
+        const uint8_t* p = buf_.data() + pos_;
+        if (p[0] == 0) return false;
+        runLeft_ = p[0];
+        runP1_ = get16(p + 1);
+        runP2_ = get16(p + 3);
+        pos_ += kRunBytes;
+    }
+    runLeft_--;
+    framesRead_++;
+    p1 = runP1_;
+    p2 = runP2_;
+    return true;
+}
+
+bool playReplay(EmulatorEngine& engine, ReplayReader& reader, ReplayPlayback& out) noexcept {
+    out = {};
+    if (!replayMatchesEngine(reader.header(), engine)) return false;
+    if (!reader.loadStartState(engine)) return false;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    uint16_t p1 = 0;
+    uint16_t p2 = 0;
+    while (reader.next(p1, p2)) {
+        engine.setInputMask(0, p1);
+        engine.setInputMask(1, p2);
+        engine.advanceFrame();
+    }
+    out.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    out.frames = reader.framesRead();
+
+    SaveState st;
+    if (engine.saveState(st)) out.endChecksum = st.checksum;
+    out.checksumMatched = reader.header().endChecksum != 0 && out.endChecksum == reader.header().endChecksum;
+    return true;
+}
+
+} // namespace snesonline
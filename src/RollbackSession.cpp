@@ -0,0 +1,470 @@
+#include "snesonline/RollbackSession.h"
+
+#include "snesonline/EmulatorEngine.h"
+#include "snesonline/Profiler.h"
+
+#include "InputWire.h"
+#include "NetSocket.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace snesonline {
+
+namespace {
+
+static constexpr uint16_t kLeadPresentBit = 0x8000u;
+
+uint16_t encodeLead(int32_t lead) noexcept {
+    if (lead > 127) lead = 127;
+    if (lead < -127) lead = -127;
+    return static_cast<uint16_t>(kLeadPresentBit | static_cast<uint8_t>(static_cast<int8_t>(lead)));
+}
+
+uint32_t nowMicros() noexcept {
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    return static_cast<uint32_t>(us);
+}
+
+} // namespace
+
+static constexpr uint32_t kResendWindow = 16;
+static constexpr uint32_t kMaxCatchUpFrames = 4;
+// Probes for stats() only; same interval as LockstepSession's adaptive-delay pings.
+static constexpr int64_t kPingIntervalMs = 100;
+
+// Time sync: every kSyncIntervalFrames, the side that is further ahead on prediction yields up to
+// kMaxSyncStepFrames frames of wall-clock time so both peers settle around the same lead.
+static constexpr uint32_t kSyncIntervalFrames = 30;
+static constexpr int32_t kMaxSyncStepFrames = 2;
+
+RollbackSession::RollbackSession() noexcept : engine_(&EmulatorEngine::instance()) { resetHistory_(); }
+
+RollbackSession::~RollbackSession() noexcept { stop(); }
+
+void RollbackSession::resetHistory_() noexcept {
+    for (uint32_t& t : remoteFrameTag_) t = kNoFrame;
+    std::memset(remoteMask_, 0, sizeof(remoteMask_));
+    for (uint32_t& t : sentFrameTag_) t = kNoFrame;
+    std::memset(sentMask_, 0, sizeof(sentMask_));
+    for (uint32_t& t : predictedFrameTag_) t = kNoFrame;
+    std::memset(predictedMask_, 0, sizeof(predictedMask_));
+    rollbackFrom_ = kNoFrame;
+    frame_ = 0;
+    confirmed_ = 0;
+    finalFrame_ = 0;
+    remoteLead_ = 0;
+    remoteLeadValid_ = false;
+    nextSyncFrame_ = kSyncIntervalFrames;
+}
+
+bool RollbackSession::start(const Config& cfg) noexcept {
+    stop();
+
+    localPort_ = (cfg.localPort != 0) ? cfg.localPort : 7000;
+    remotePort_ = (cfg.remotePort != 0) ? cfg.remotePort : 7000;
+    localPlayerNum_ = (cfg.localPlayerNum == 2) ? 2 : 1;
+    engine_ = cfg.engine ? cfg.engine : &EmulatorEngine::instance();
+    inputDelay_ = (cfg.inputDelayFrames > kMaxInputDelayFrames) ? kMaxInputDelayFrames : cfg.inputDelayFrames;
+    maxRollback_ = (cfg.maxRollbackFrames > kMaxRollbackFrames) ? kMaxRollbackFrames : cfg.maxRollbackFrames;
+
+    resetHistory_();
+    rollbacks_ = 0;
+    rolledBackFrames_ = 0;
+    failedRollbacks_ = 0;
+    recvCount_ = 0;
+    allowPacketV2_ = (cfg.inputPacketVersion != 1);
+    negotiator_.reset(allowPacketV2_);
+    sentPackets_ = 0;
+    sentBytes_ = 0;
+    lastRemoteFrame_ = 0;
+    maxRemoteFrame_ = 0;
+    lastPingSent_ = {};
+    stallStart_ = {};
+
+    // One slot per frame that may run on prediction, plus headroom so the oldest is never overwritten.
+    // Without a serializable core we cannot roll back; fall back to stalling on missing input.
+    const std::size_t stateBytes = engine_->core().serializeSize();
+    if (maxRollback_ > 0 && (stateBytes == 0 || !snapshots_.allocate(stateBytes, maxRollback_ + 2))) {
+        maxRollback_ = 0;
+    }
+
+    // Prime our local input history for the first few frames (see LockstepSession::start).
+    for (uint32_t f = 0; f < inputDelay_; ++f) {
+        const uint32_t idx = f % kBufN;
+        sentFrameTag_[idx] = f;
+        sentMask_[idx] = 0;
+    }
+
+    peer_ = {};
+    discoverPeer_ = false;
+    waitingForPeer_ = true;
+    connected_ = false;
+    lastRecv_ = {};
+
+    const bool hasRemoteHost = (cfg.remoteHost && cfg.remoteHost[0]);
+    if (!hasRemoteHost) {
+        if (localPlayerNum_ != 1) {
+            // Avoid deadlock: both sides can't be waiting without a target.
+            return false;
+        }
+        discoverPeer_ = true;
+    } else {
+        sockaddr_in remote{};
+        if (!net::resolveIpv4ToSockaddr(cfg.remoteHost, remote, remotePort_)) {
+            return false;
+        }
+        peer_.ipv4_be = remote.sin_addr.s_addr;
+        peer_.port_be = remote.sin_port;
+    }
+
+    if (!net::openUdpSocket(localPort_, sock_)) {
+        return false;
+    }
+
+    if (cfg.serverAssistFirstConnect && cfg.roomServerPort != 0 && cfg.roomServerHost && cfg.roomServerHost[0] && cfg.roomCode && cfg.roomCode[0]) {
+        sockaddr_in peer{};
+        if (net::doServerAssistPunch(sock_, cfg.roomServerHost, cfg.roomServerPort, cfg.roomCode, peer)) {
+            peer_.ipv4_be = peer.sin_addr.s_addr;
+            peer_.port_be = peer.sin_port;
+            discoverPeer_ = false;
+            waitingForPeer_ = false;
+        }
+    }
+
+    FrameScheduler::Config pace;
+    pace.framesPerSecond = engine_->core().framesPerSecond();
+    pace.maxCatchUpFrames = kMaxCatchUpFrames;
+    pacer_.configure(pace);
+    pacer_.start(std::chrono::steady_clock::now());
+    statsTracker_.reset(std::chrono::steady_clock::now(), pacer_.frameMicros());
+
+    if (!discoverPeer_ && peer_.valid()) {
+        waitingForPeer_ = false;
+    }
+
+    // Spectators are optional; the match runs without them if the port is taken.
+    if (cfg.spectatorPort != 0) (void)spectators_.start(cfg.spectatorPort, cfg.maxSpectators);
+    if (cfg.replayPath && cfg.replayPath[0]) (void)replay_.open(cfg.replayPath, *engine_, 0);
+
+    return true;
+}
+
+void RollbackSession::stop() noexcept {
+    net::closeSocket(sock_);
+    spectators_.stop();
+    if (replay_.isOpen()) {
+        // The engine is only at the replay's end state if no frame ran on prediction.
+        SaveState st;
+        (void)replay_.close((finalFrame_ == frame_ && engine_->saveState(st)) ? st.checksum : 0u);
+    }
+    peer_ = {};
+    discoverPeer_ = false;
+    waitingForPeer_ = false;
+    connected_ = false;
+    localMask_ = 0;
+    pacer_.restart();
+    snapshots_.reset();
+    resetHistory_();
+}
+
+void RollbackSession::setLocalInput(uint16_t mask) noexcept { localMask_ = mask; }
+
+void RollbackSession::pumpRecv_() noexcept {
+    SNESONLINE_PROFILE_SCOPE("rollback.pumpRecv");
+    if (sock_ == kInvalidSocket) return;
+
+    while (true) {
+        uint8_t buf[wire::kMaxInputV2Bytes];
+        sockaddr_in from{};
+        const int n = net::recvFrom(sock_, buf, sizeof(buf), from);
+        if (n <= 0) break;
+        statsTracker_.onDatagramReceived(static_cast<std::size_t>(n));
+
+        if (n == static_cast<int>(sizeof(wire::InputPacketV1))) {
+            wire::InputPacketV1 p{};
+            std::memcpy(&p, buf, sizeof(p));
+            net::refreshPeerFromPacket(discoverPeer_, peer_.ipv4_be, peer_.port_be, from);
+            negotiator_.onV1Received();
+            storeRemoteInput_(ntohl(p.frame_be), ntohs(p.mask_be), ntohs(p.reserved_be));
+            recvCount_++;
+            continue;
+        }
+
+        wire::ControlPacket c{};
+        if (wire::parseControl(buf, static_cast<std::size_t>(n), c)) {
+            net::refreshPeerFromPacket(discoverPeer_, peer_.ipv4_be, peer_.port_be, from);
+            if (c.magic == wire::kPongMagic) {
+                (void)statsTracker_.onProbeAnswered(c.timeUs, nowMicros());
+                continue;
+            }
+            wire::ControlPacket pong{};
+            pong.magic = wire::kPongMagic;
+            pong.timeUs = c.timeUs;
+            uint8_t out[wire::kControlBytes];
+            wire::buildControl(pong, out);
+            if (net::sendTo(sock_, out, sizeof(out), from)) {
+                sentPackets_++;
+                sentBytes_ += sizeof(out);
+            }
+            continue;
+        }
+
+        uint16_t aux = 0;
+        uint32_t newest = 0;
+        uint32_t count = 0;
+        uint16_t masks[kMaxInputWindow];
+        if (!allowPacketV2_ || !wire::parseInputV2(buf, static_cast<std::size_t>(n), aux, newest, masks, count)) continue;
+
+        net::refreshPeerFromPacket(discoverPeer_, peer_.ipv4_be, peer_.port_be, from);
+        negotiator_.onV2Received();
+        statsTracker_.onInputPacket(newest);
+        for (uint32_t i = 0; i < count; ++i) storeRemoteInput_(newest - count + 1 + i, masks[i], aux);
+        recvCount_++;
+    }
+
+    while (remoteFrameTag_[confirmed_ % kBufN] == confirmed_) confirmed_++;
+
+    if (discoverPeer_ && peer_.valid()) {
+        waitingForPeer_ = false;
+    }
+}
+
+void RollbackSession::storeRemoteInput_(uint32_t f, uint16_t m, uint16_t reserved) noexcept {
+    lastRemoteFrame_ = f;
+    if (recvCount_ == 0 || f > maxRemoteFrame_) {
+        maxRemoteFrame_ = f;
+        if (reserved & kLeadPresentBit) {
+            remoteLead_ = static_cast<int8_t>(reserved & 0xFFu);
+            remoteLeadValid_ = true;
+        }
+    }
+
+    connected_ = true;
+    waitingForPeer_ = false;
+    lastRecv_ = std::chrono::steady_clock::now();
+
+    // Ignore resends of confirmed frames and anything too far ahead to fit the history.
+    if (f < confirmed_ || f - confirmed_ >= kBufN / 2) return;
+    const uint32_t idx = f % kBufN;
+    if (remoteFrameTag_[idx] == f) return;
+    remoteFrameTag_[idx] = f;
+    remoteMask_[idx] = m;
+
+    if (predictedFrameTag_[idx] == f) {
+        if (predictedMask_[idx] != m && (rollbackFrom_ == kNoFrame || f < rollbackFrom_)) rollbackFrom_ = f;
+        predictedFrameTag_[idx] = kNoFrame;
+    }
+}
+
+int64_t RollbackSession::lastRecvAgeMs() const noexcept {
+    if (recvCount_ == 0) return -1;
+    const auto now = std::chrono::steady_clock::now();
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastRecv_).count();
+    return static_cast<int64_t>(ms);
+}
+
+void RollbackSession::stats(NetplayStats& out) const noexcept {
+    statsTracker_.fill(out);
+    out.localFrame = frame_;
+    out.remoteFrame = maxRemoteFrame_;
+    out.connected = connected_;
+    out.waitingForPeer = waitingForPeer_;
+    out.inputDelayFrames = inputDelay_;
+    out.lastRecvAgeMs = lastRecvAgeMs();
+    out.frameLead = frameLead();
+}
+
+void RollbackSession::sendPing_() noexcept {
+    if (sock_ == kInvalidSocket || !peer_.valid()) return;
+    const auto now = std::chrono::steady_clock::now();
+    if (lastPingSent_.time_since_epoch().count() != 0 &&
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - lastPingSent_).count() < kPingIntervalMs) {
+        return;
+    }
+    lastPingSent_ = now;
+
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = peer_.ipv4_be;
+    to.sin_port = peer_.port_be;
+
+    wire::ControlPacket ping{};
+    ping.magic = wire::kPingMagic;
+    ping.timeUs = nowMicros();
+    uint8_t out[wire::kControlBytes];
+    wire::buildControl(ping, out);
+    if (net::sendTo(sock_, out, sizeof(out), to)) {
+        sentPackets_++;
+        sentBytes_ += sizeof(out);
+        statsTracker_.onProbeSent(ping.timeUs);
+    }
+}
+
+void RollbackSession::sendLocal_() noexcept {
+    SNESONLINE_PROFILE_SCOPE("rollback.sendLocal");
+    if (sock_ == kInvalidSocket) return;
+
+    // A frame's input is fixed once scheduled: the peer keeps the first value it receives.
+    const uint32_t targetFrame = frame_ + inputDelay_;
+    const uint32_t sidx = targetFrame % kBufN;
+    if (sentFrameTag_[sidx] != targetFrame) {
+        sentFrameTag_[sidx] = targetFrame;
+        sentMask_[sidx] = localMask_;
+    }
+
+    if (!peer_.valid()) return;
+
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = peer_.ipv4_be;
+    to.sin_port = peer_.port_be;
+
+    const uint16_t lead = encodeLead(frameLead());
+    if (negotiator_.sendV2()) {
+        uint16_t masks[kResendWindow];
+        const uint32_t count = wire::collectInputWindow(sentMask_, sentFrameTag_, targetFrame, kResendWindow, masks);
+        uint8_t buf[wire::kMaxInputV2Bytes];
+        const std::size_t len = wire::buildInputV2(lead, targetFrame, masks, count, buf, sizeof(buf));
+        if (len != 0 && net::sendTo(sock_, buf, len, to)) {
+            sentPackets_++;
+            sentBytes_ += len;
+        }
+    }
+    if (!negotiator_.sendV1()) return;
+
+    const uint32_t start = (targetFrame >= (kResendWindow - 1)) ? (targetFrame - (kResendWindow - 1)) : 0u;
+    for (uint32_t f = start; f <= targetFrame; ++f) {
+        const uint32_t i = f % kBufN;
+        if (sentFrameTag_[i] != f) continue;
+        wire::InputPacketV1 p{};
+        p.frame_be = htonl(f);
+        p.mask_be = htons(sentMask_[i]);
+        p.reserved_be = htons(lead);
+        if (net::sendTo(sock_, &p, sizeof(p), to)) {
+            sentPackets_++;
+            sentBytes_ += sizeof(p);
+        }
+    }
+}
+
+void RollbackSession::simulateFrame_(uint32_t f, FrameOutput output) noexcept {
+    EmulatorEngine& eng = *engine_;
+    const uint32_t idx = f % kBufN;
+
+    uint16_t remoteMask = 0;
+    if (remoteFrameTag_[idx] == f) {
+        remoteMask = remoteMask_[idx];
+        predictedFrameTag_[idx] = kNoFrame;
+    } else {
+        // Predict: repeat the last confirmed input, and keep the pre-frame state for a possible rollback.
+        remoteMask = (confirmed_ > 0) ? remoteMask_[(confirmed_ - 1) % kBufN] : 0;
+        predictedFrameTag_[idx] = f;
+        predictedMask_[idx] = remoteMask;
+        (void)snapshots_.save(eng, f);
+    }
+
+    const uint16_t localMask = sentMask_[idx];
+    const bool localIsP1 = (localPlayerNum_ == 1);
+    eng.setInputMask(0, localIsP1 ? localMask : remoteMask);
+    eng.setInputMask(1, localIsP1 ? remoteMask : localMask);
+    eng.advanceFrame(output);
+}
+
+void RollbackSession::resimulate_() noexcept {
+    SNESONLINE_PROFILE_SCOPE("rollback.resimulate");
+    const uint32_t from = rollbackFrom_;
+    rollbackFrom_ = kNoFrame;
+    if (from >= frame_) return;
+
+    if (!snapshots_.load(*engine_, from)) {
+        failedRollbacks_++;
+        return;
+    }
+
+    // The original run already played these frames' audio; only the newest picture is replaced.
+    for (uint32_t f = from; f < frame_; ++f) {
+        simulateFrame_(f, f + 1 == frame_ ? FrameOutput::VideoOnly : FrameOutput::None);
+    }
+    rollbacks_++;
+    rolledBackFrames_ += frame_ - from;
+    statsTracker_.onRollback(frame_ - from);
+}
+
+void RollbackSession::syncTime_() noexcept {
+    if (frame_ < nextSyncFrame_) return;
+    nextSyncFrame_ = frame_ + kSyncIntervalFrames;
+    if (!remoteLeadValid_) return;
+
+    // Both sides see roughly (one-way latency - delay) of lead; any difference is clock offset,
+    // split evenly between the peers.
+    const int32_t yield = (frameLead() - remoteLead_) / 2;
+    if (yield <= 0) return;
+    const int32_t frames = (yield > kMaxSyncStepFrames) ? kMaxSyncStepFrames : yield;
+    pacer_.delay(static_cast<uint32_t>(frames));
+}
+
+void RollbackSession::tick() noexcept {
+    SNESONLINE_PROFILE_SCOPE("rollback.tick");
+    pumpRecv_();
+    sendPing_();
+
+    // Apply corrections before producing new frames.
+    if (rollbackFrom_ != kNoFrame) resimulate_();
+
+    syncTime_();
+
+    const uint32_t toRun = pacer_.due(std::chrono::steady_clock::now());
+
+    for (uint32_t step = 0; step < toRun; ++step) {
+        // Always send (except host waiting for first peer packet).
+        sendLocal_();
+
+        // Never run further ahead of confirmed input than we can roll back.
+        if (frame_ >= confirmed_ + maxRollback_) {
+            if (connected_ && stallStart_.time_since_epoch().count() == 0) stallStart_ = std::chrono::steady_clock::now();
+            waitingForPeer_ = true;
+            break;
+        }
+        if (stallStart_.time_since_epoch().count() != 0) {
+            const auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - stallStart_).count();
+            stallStart_ = {};
+            statsTracker_.onStall((us > 0xFFFFFFFFll) ? 0xFFFFFFFFu : static_cast<uint32_t>(us));
+        }
+
+        // Only the newest frame of a catch-up burst is shown (the check above stops the next one early).
+        const bool last = step + 1 == toRun || frame_ + 1 >= confirmed_ + maxRollback_;
+        simulateFrame_(frame_, last ? FrameOutput::Present : FrameOutput::AudioOnly);
+        frame_++;
+        pacer_.advance();
+        waitingForPeer_ = false;
+    }
+
+    publishFinalFrames_();
+    statsTracker_.update(std::chrono::steady_clock::now(), sentPackets_, sentBytes_);
+}
+
+void RollbackSession::publishFinalFrames_() noexcept {
+    const bool spectating = spectators_.active();
+    if (!spectating && !replay_.isOpen()) return;
+
+    // A frame is final once it has run and its remote input is confirmed (any correction was
+    // re-simulated at the top of tick()).
+    const uint32_t final = (confirmed_ < frame_) ? confirmed_ : frame_;
+    const bool localIsP1 = (localPlayerNum_ == 1);
+    for (; finalFrame_ < final; ++finalFrame_) {
+        const uint32_t idx = finalFrame_ % kBufN;
+        const uint16_t localMask = sentMask_[idx];
+        const uint16_t remoteMask = remoteMask_[idx];
+        const uint16_t p1 = localIsP1 ? localMask : remoteMask;
+        const uint16_t p2 = localIsP1 ? remoteMask : localMask;
+        if (spectating) spectators_.recordFrame(finalFrame_, p1, p2);
+        replay_.recordFrame(p1, p2);
+    }
+    // The current state can seed a joining spectator only if no frame behind it ran on prediction.
+    if (spectating) spectators_.service(*engine_, frame_, frame_ <= confirmed_);
+}
+
+std::string RollbackSession::peerEndpoint() const { return net::formatEndpoint(peer_.ipv4_be, peer_.port_be); }
+
+} // namespace snesonline
@@ -0,0 +1,115 @@
+#include "snesonline/RunAheadWorker.h"
+
+#include "snesonline/Profiler.h"
+
+namespace snesonline {
+
+bool RunAheadWorker::start(const char* corePath, const char* romPath) noexcept {
+    stop();
+    if (!core_.load(corePath) || !core_.loadGame(romPath)) {
+        core_.unload();
+        return false;
+    }
+
+    inSync_ = false;
+    stopping_ = false;
+    queued_ = false;
+    busy_ = false;
+    try {
+        thread_ = std::thread(&RunAheadWorker::threadMain_, this);
+    } catch (...) {
+        core_.unload();
+        return false;
+    }
+    return true;
+}
+
+void RunAheadWorker::stop() noexcept {
+    if (thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+    core_.unload();
+    state_.reset();
+    inSync_ = false;
+}
+
+void RunAheadWorker::wait() noexcept {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !busy_; });
+}
+
+void* RunAheadWorker::stateBuffer(std::size_t sizeBytes) noexcept {
+    if (sizeBytes == 0) return nullptr;
+    if (state_.size() < sizeBytes && !state_.allocate(sizeBytes, 64)) return nullptr;
+    return state_.data();
+}
+
+void RunAheadWorker::submit(bool resync, std::size_t stateBytes, uint32_t aheadFrames, uint16_t port0Mask, uint16_t port1Mask, void* videoCtx,
+                            LibretroCore::VideoRefreshFn videoFn) noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_.resync = resync;
+        job_.stateBytes = stateBytes;
+        job_.aheadFrames = aheadFrames ? aheadFrames : 1;
+        job_.masks[0] = port0Mask;
+        job_.masks[1] = port1Mask;
+        job_.videoCtx = videoCtx;
+        job_.videoFn = videoFn;
+        queued_ = true;
+        busy_ = true;
+    }
+    cv_.notify_all();
+}
+
+void RunAheadWorker::threadMain_() noexcept {
+    Profiler::setThreadName("run-ahead");
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || queued_; });
+            if (stopping_) {
+                busy_ = false;
+                break;
+            }
+            job = job_;
+            queued_ = false;
+        }
+
+        run_(job);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            busy_ = false;
+        }
+        cv_.notify_all();
+    }
+    cv_.notify_all();
+}
+
+void RunAheadWorker::run_(const Job& job) noexcept {
+    SNESONLINE_PROFILE_SCOPE("runAhead.job");
+    add_(jobs_, 1);
+    if (job.videoCtx != core_.videoSinkCtx() || job.videoFn != core_.videoSinkFn()) core_.setVideoSink(job.videoCtx, job.videoFn);
+    core_.setInputMasks(job.masks[0], job.masks[1]);
+
+    uint32_t frames = 1;
+    if (job.resync) {
+        add_(resyncs_, 1);
+        inSync_ = core_.unserialize(state_.data(), job.stateBytes);
+        frames = job.aheadFrames;
+    }
+    if (!inSync_) return;
+
+    // Hidden frames first, then the one that is shown; audio never leaves this instance.
+    for (uint32_t i = 1; i < frames; ++i) core_.runFrame(false, false);
+    core_.runFrame(true, false);
+    add_(frames_, frames);
+}
+
+} // namespace snesonline
@@ -0,0 +1,73 @@
+#include "snesonline/SnapshotRing.h"
+
+#include "snesonline/EmulatorEngine.h"
+
+namespace snesonline {
+
+bool SnapshotRing::allocate(std::size_t slotBytes, uint32_t slotCount) noexcept {
+    reset();
+    if (slotBytes == 0 || slotCount == 0) return false;
+    if (slotCount > kMaxSlots) slotCount = kMaxSlots;
+
+    // Keep every slot cache-line aligned.
+    const std::size_t stride = (slotBytes + 63u) & ~static_cast<std::size_t>(63u);
+    if (!storage_.allocate(stride * slotCount, 64)) return false;
+
+    slotBytes_ = slotBytes;
+    strideBytes_ = stride;
+    slotCount_ = slotCount;
+
+    auto* base = static_cast<uint8_t*>(storage_.data());
+    for (uint32_t i = 0; i < slotCount_; ++i) {
+        slots_[i] = {};
+        slots_[i].data = base + static_cast<std::size_t>(i) * strideBytes_;
+    }
+    return true;
+}
+
+void SnapshotRing::reset() noexcept {
+    storage_.reset();
+    slotBytes_ = 0;
+    strideBytes_ = 0;
+    slotCount_ = 0;
+    for (Slot& s : slots_) s = {};
+}
+
+void SnapshotRing::invalidate() noexcept {
+    for (uint32_t i = 0; i < slotCount_; ++i) {
+        slots_[i].sizeBytes = 0;
+        slots_[i].checksum = 0;
+        slots_[i].frame = 0xFFFFFFFFu;
+    }
+}
+
+const SnapshotRing::Slot* SnapshotRing::save(EmulatorEngine& engine, uint32_t frame) noexcept {
+    if (slotCount_ == 0) return nullptr;
+    Slot& s = slots_[frame % slotCount_];
+    s.frame = 0xFFFFFFFFu;
+    if (!engine.saveStateInto(s.data, slotBytes_, s.sizeBytes, s.checksum)) return nullptr;
+    s.frame = frame;
+    return &s;
+}
+
+bool SnapshotRing::load(EmulatorEngine& engine, uint32_t frame) const noexcept {
+    const Slot* s = find(frame);
+    if (!s) return false;
+    return engine.loadStateFrom(s->data, s->sizeBytes);
+}
+
+const SnapshotRing::Slot* SnapshotRing::find(uint32_t frame) const noexcept {
+    if (slotCount_ == 0 || frame == 0xFFFFFFFFu) return nullptr;
+    const Slot& s = slots_[frame % slotCount_];
+    if (s.frame != frame || s.sizeBytes == 0) return nullptr;
+    return &s;
+}
+
+bool SnapshotRing::owns(const void* p) const noexcept {
+    if (!p || slotCount_ == 0) return false;
+    const auto* base = static_cast<const uint8_t*>(storage_.data());
+    const auto* q = static_cast<const uint8_t*>(p);
+    return q >= base && q < base + strideBytes_ * slotCount_;
+}
+
+} // namespace snesonline
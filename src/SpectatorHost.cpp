@@ -0,0 +1,331 @@
+#include "snesonline/SpectatorHost.h"
+
+#include "snesonline/EmulatorEngine.h"
+#include "snesonline/Hash.h"
+#include "snesonline/Lz.h"
+#include "snesonline/Profiler.h"
+
+#include "NetSocket.h"
+#include "SpectatorWire.h"
+
+#include <algorithm>
+
+namespace snesonline {
+
+// A spectator that has not acked for this long is dropped; it rejoins with a fresh snapshot.
+static constexpr int64_t kViewerTimeoutMs = 5000;
+// A flushed batch older than this is sent even if it holds fewer than kBatchFrames frames.
+static constexpr int64_t kMaxBatchAgeMs = 250;
+// Unacked inputs are resent after this long (spectators ack every 250 ms).
+static constexpr int64_t kInputResendMs = 600;
+// Datagrams per spectator per service() call while it catches up.
+static constexpr uint32_t kMaxInputPacketsPerService = 4;
+// Snapshot chunks are paced per spectator (token bucket) so a burst of joins does not flood the
+// host's uplink: ~256 KiB/s each, bursts of up to kChunkBurst.
+static constexpr uint32_t kChunkBurst = 16;
+static constexpr int64_t kChunkIntervalUs = static_cast<int64_t>(wire::kSpectatorMaxDatagramBytes) * 1000000 / (256 * 1024);
+// A snapshot pass restarts from the first unacked chunk after this long.
+static constexpr int64_t kChunkResendMs = 300;
+// Joins within this window share one snapshot instead of serializing the core again.
+static constexpr int64_t kSnapshotReuseMs = 5000;
+// History is trimmed in steps of this many frames once no spectator needs them.
+static constexpr uint32_t kTrimFrames = 3600;
+
+static int64_t msSince(const std::chrono::steady_clock::time_point& t, const std::chrono::steady_clock::time_point& now) noexcept {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now - t).count();
+}
+
+SpectatorHost::~SpectatorHost() noexcept { stop(); }
+
+bool SpectatorHost::start(uint16_t localPort, uint32_t maxSpectators, uint32_t firstFrame) noexcept {
+    stop();
+    if (localPort == 0) return false;
+    maxViewers_ = maxSpectators ? maxSpectators : kDefaultMaxSpectators;
+    try {
+        viewers_.reserve(maxViewers_);
+        // Ten minutes of play before the first reallocation.
+        history_.reserve(60u * 60u * 10u);
+    } catch (...) {
+        return false;
+    }
+    historyBase_ = firstFrame;
+    validFrom_ = firstFrame;
+    joins_ = 0;
+    snapshotsTaken_ = 0;
+    lastRawBytes_ = 0;
+    lastCompressedBytes_ = 0;
+    sentPackets_ = 0;
+    sentInputBytes_ = 0;
+    sentSnapshotBytes_ = 0;
+    recvBytes_ = 0;
+    return net::openUdpSocket(localPort, sock_);
+}
+
+void SpectatorHost::stop() noexcept {
+    net::closeSocket(sock_);
+    viewers_.clear();
+    history_.clear();
+    historyBase_ = 0;
+    snapshot_.reset();
+}
+
+bool SpectatorHost::active() const noexcept { return sock_ != kInvalidSocket; }
+
+void SpectatorHost::invalidate() noexcept {
+    const uint32_t end = historyEnd_();
+    history_.clear();
+    historyBase_ = end;
+    validFrom_ = end;
+    snapshot_.reset();
+    for (Viewer& v : viewers_) {
+        v.phase = Viewer::Phase::WaitSnapshot;
+        v.snapshot.reset();
+    }
+}
+
+void SpectatorHost::recordFrame(uint32_t frame, uint16_t p1Mask, uint16_t p2Mask) noexcept {
+    if (sock_ == kInvalidSocket) return;
+    if (frame != historyEnd_()) {
+        // A gap (or a failed append below): restart the history here. Spectators that still need
+        // the lost frames fall back to a new snapshot in service().
+        history_.clear();
+        historyBase_ = frame;
+    }
+    try {
+        history_.push_back(static_cast<uint32_t>(p1Mask) | (static_cast<uint32_t>(p2Mask) << 16));
+    } catch (...) {
+        history_.clear();
+        historyBase_ = frame + 1;
+    }
+}
+
+bool SpectatorHost::sendTo_(const Viewer& v, const void* data, std::size_t sizeBytes) noexcept {
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = v.ipv4_be;
+    to.sin_port = v.port_be;
+    if (!net::sendTo(sock_, data, sizeBytes, to)) return false;
+    sentPackets_++;
+    return true;
+}
+
+void SpectatorHost::receive_(const Clock::time_point& now) noexcept {
+    uint8_t buf[64];
+    while (true) {
+        sockaddr_in from{};
+        const int n = net::recvFrom(sock_, buf, sizeof(buf), from);
+        if (n <= 0) break;
+        recvBytes_ += static_cast<uint64_t>(n);
+        wire::SpectatorAck ack{};
+        if (!wire::parseSpectatorAck(buf, static_cast<std::size_t>(n), ack)) continue;
+        handleAck_(from.sin_addr.s_addr, from.sin_port, ack, now);
+    }
+}
+
+void SpectatorHost::handleAck_(uint32_t ipv4_be, uint16_t port_be, const wire::SpectatorAck& ack, const Clock::time_point& now) noexcept {
+    Viewer* v = nullptr;
+    for (Viewer& it : viewers_) {
+        if (it.ipv4_be == ipv4_be && it.port_be == port_be) {
+            v = &it;
+            break;
+        }
+    }
+
+    const bool loaded = (ack.nextChunk == wire::kNoChunk);
+    if (!v) {
+        if (viewers_.size() >= maxViewers_) return;
+        viewers_.push_back(Viewer{}); // capacity reserved in start()
+        v = &viewers_.back();
+        v->ipv4_be = ipv4_be;
+        v->port_be = port_be;
+        v->phase = Viewer::Phase::WaitSnapshot;
+        joins_++;
+        // A spectator we timed out keeps its state if that state is still valid and the history
+        // still covers it.
+        if (loaded && ack.snapshotFrame != wire::kNoFrame && ack.snapshotFrame >= validFrom_ && ack.nextFrame >= historyBase_ &&
+            ack.nextFrame <= historyEnd_()) {
+            v->phase = Viewer::Phase::Inputs;
+            v->ackedFrame = ack.nextFrame;
+            v->sentFrame = ack.nextFrame;
+            v->lastProgress = now;
+        }
+    }
+    v->lastHeard = now;
+
+    switch (v->phase) {
+    case Viewer::Phase::WaitSnapshot:
+        break;
+    case Viewer::Phase::Snapshot: {
+        const uint32_t frame = v->snapshot->frame;
+        if (loaded && ack.snapshotFrame == frame && ack.nextFrame >= frame && ack.nextFrame <= historyEnd_()) {
+            // Loaded; stream inputs from the snapshot frame on.
+            v->phase = Viewer::Phase::Inputs;
+            v->snapshot.reset();
+            v->ackedFrame = ack.nextFrame;
+            v->sentFrame = ack.nextFrame;
+            v->lastProgress = now;
+            v->lastSend = {};
+        } else if (!loaded && ack.snapshotFrame == frame && ack.nextChunk > v->ackedChunk) {
+            v->ackedChunk = ack.nextChunk;
+        } else if (!loaded && ack.snapshotFrame == wire::kNoFrame) {
+            // Nothing received yet, or the spectator discarded a corrupt snapshot: the next pass
+            // starts from the first chunk.
+            v->ackedChunk = 0;
+        }
+        break;
+    }
+    case Viewer::Phase::Inputs:
+        if (!loaded && ack.snapshotFrame == wire::kNoFrame) {
+            // The spectator restarted.
+            v->phase = Viewer::Phase::WaitSnapshot;
+        } else if (loaded && ack.nextFrame > v->ackedFrame && ack.nextFrame <= historyEnd_()) {
+            v->ackedFrame = ack.nextFrame;
+            v->lastProgress = now;
+            if (v->sentFrame < ack.nextFrame) v->sentFrame = ack.nextFrame;
+        }
+        break;
+    }
+}
+
+bool SpectatorHost::prepareSnapshot_(EmulatorEngine& engine, uint32_t stateFrame, bool stateConfirmed,
+                                     const Clock::time_point& now) noexcept {
+    if (snapshot_ && snapshot_->frame >= historyBase_ && msSince(snapshot_->taken, now) < kSnapshotReuseMs) return true;
+    // The spectator needs every input from stateFrame on; all of them must still be recordable.
+    if (!stateConfirmed || stateFrame < historyBase_ || stateFrame > historyEnd_()) return false;
+
+    const std::size_t rawBytes = engine.core().serializeSize();
+    if (rawBytes == 0 || rawBytes > 0xFFFFFFFFu) return false;
+
+    std::shared_ptr<Snapshot> s;
+    try {
+        if (stateScratch_.size() < rawBytes) stateScratch_.resize(rawBytes);
+        s = std::make_shared<Snapshot>();
+        s->compressed.resize(lzMaxCompressedSize(rawBytes));
+    } catch (...) {
+        return false;
+    }
+
+    std::size_t size = 0;
+    uint32_t checksum = 0;
+    if (!engine.saveStateInto(stateScratch_.data(), stateScratch_.size(), size, checksum)) return false;
+    const std::size_t packed = lzCompress(stateScratch_.data(), size, s->compressed.data(), s->compressed.size());
+    const std::size_t chunks = (packed + wire::kSpectatorChunkPayloadBytes - 1) / wire::kSpectatorChunkPayloadBytes;
+    if (packed == 0 || chunks >= wire::kNoChunk) return false;
+    s->compressed.resize(packed);
+    s->frame = stateFrame;
+    s->rawBytes = static_cast<uint32_t>(size);
+    s->rawCrc = crc32(stateScratch_.data(), size);
+    s->taken = now;
+
+    snapshot_ = std::move(s);
+    snapshotsTaken_++;
+    lastRawBytes_ = size;
+    lastCompressedBytes_ = packed;
+    return true;
+}
+
+void SpectatorHost::sendChunks_(Viewer& v, const Clock::time_point& now) noexcept {
+    const Snapshot& s = *v.snapshot;
+    const uint16_t count =
+        static_cast<uint16_t>((s.compressed.size() + wire::kSpectatorChunkPayloadBytes - 1) / wire::kSpectatorChunkPayloadBytes);
+
+    if (v.nextChunk >= count) {
+        // Pass complete: go back to the first chunk the spectator is missing, if it stays missing.
+        if (v.ackedChunk >= count || msSince(v.lastChunkPass, now) < kChunkResendMs) return;
+        v.nextChunk = v.ackedChunk;
+    }
+
+    const auto interval = std::chrono::microseconds(kChunkIntervalUs);
+    const auto earliest = now - interval * kChunkBurst;
+    if (v.nextChunkAt < earliest) v.nextChunkAt = earliest;
+
+    uint8_t buf[wire::kSpectatorMaxDatagramBytes];
+    while (v.nextChunk < count && v.nextChunkAt <= now) {
+        const std::size_t offset = static_cast<std::size_t>(v.nextChunk) * wire::kSpectatorChunkPayloadBytes;
+        wire::SpectatorChunk c{};
+        c.index = v.nextChunk;
+        c.count = count;
+        c.payloadBytes = static_cast<uint16_t>(std::min(wire::kSpectatorChunkPayloadBytes, s.compressed.size() - offset));
+        c.frame = s.frame;
+        c.rawBytes = s.rawBytes;
+        c.compressedBytes = static_cast<uint32_t>(s.compressed.size());
+        c.rawCrc = s.rawCrc;
+        c.payload = s.compressed.data() + offset;
+        const std::size_t len = wire::buildSpectatorChunk(c, buf, sizeof(buf));
+        // A full socket buffer: retry this chunk on the next call.
+        if (len == 0 || !sendTo_(v, buf, len)) break;
+        sentSnapshotBytes_ += len;
+        v.nextChunk++;
+        v.nextChunkAt += interval;
+    }
+    if (v.nextChunk >= count) v.lastChunkPass = now;
+}
+
+void SpectatorHost::sendInputs_(Viewer& v, const Clock::time_point& now) noexcept {
+    const uint32_t end = historyEnd_();
+
+    // Go-back-N: everything past the last ack is resent when the ack stops moving.
+    if (v.ackedFrame < v.sentFrame && msSince(v.lastProgress, now) >= kInputResendMs) {
+        v.sentFrame = v.ackedFrame;
+        v.lastProgress = now;
+    }
+
+    uint8_t buf[wire::kSpectatorMaxDatagramBytes];
+    for (uint32_t p = 0; p < kMaxInputPacketsPerService && v.sentFrame < end; ++p) {
+        const uint32_t pending = end - v.sentFrame;
+        if (pending < kBatchFrames && msSince(v.lastSend, now) < kMaxBatchAgeMs) break;
+
+        uint32_t count = 0;
+        const std::size_t len = wire::buildSpectatorInputs(v.sentFrame, history_.data() + (v.sentFrame - historyBase_), pending, buf,
+                                                           sizeof(buf), count);
+        if (len == 0 || !sendTo_(v, buf, len)) break;
+        sentInputBytes_ += len;
+        // The resend timer runs from the oldest unacked datagram.
+        if (v.ackedFrame == v.sentFrame) v.lastProgress = now;
+        v.sentFrame += count;
+        v.lastSend = now;
+    }
+}
+
+void SpectatorHost::trimHistory_() noexcept {
+    uint32_t keep = historyEnd_();
+    for (const Viewer& v : viewers_) {
+        if (v.phase == Viewer::Phase::Inputs) keep = std::min(keep, v.ackedFrame);
+        else if (v.phase == Viewer::Phase::Snapshot) keep = std::min(keep, v.snapshot->frame);
+    }
+    if (snapshot_ && snapshot_->frame >= historyBase_) keep = std::min(keep, snapshot_->frame);
+    if (keep - historyBase_ < kTrimFrames) return;
+    history_.erase(history_.begin(), history_.begin() + (keep - historyBase_));
+    historyBase_ = keep;
+}
+
+void SpectatorHost::service(EmulatorEngine& engine, uint32_t stateFrame, bool stateConfirmed) noexcept {
+    SNESONLINE_PROFILE_SCOPE("spectatorHost.service");
+    if (sock_ == kInvalidSocket) return;
+    const auto now = Clock::now();
+    receive_(now);
+
+    viewers_.erase(std::remove_if(viewers_.begin(), viewers_.end(),
+                                  [&](const Viewer& v) { return msSince(v.lastHeard, now) >= kViewerTimeoutMs; }),
+                   viewers_.end());
+
+    if (snapshot_ && msSince(snapshot_->taken, now) >= kSnapshotReuseMs) snapshot_.reset();
+
+    for (Viewer& v : viewers_) {
+        if (v.phase == Viewer::Phase::Inputs && v.ackedFrame < historyBase_) v.phase = Viewer::Phase::WaitSnapshot;
+        if (v.phase == Viewer::Phase::WaitSnapshot) {
+            if (!prepareSnapshot_(engine, stateFrame, stateConfirmed, now)) continue;
+            v.phase = Viewer::Phase::Snapshot;
+            v.snapshot = snapshot_;
+            v.nextChunk = 0;
+            v.ackedChunk = 0;
+            v.lastChunkPass = now;
+        }
+        if (v.phase == Viewer::Phase::Snapshot) sendChunks_(v, now);
+        else sendInputs_(v, now);
+    }
+
+    trimHistory_();
+}
+
+} // namespace snesonline
@@ -0,0 +1,254 @@
+#include "snesonline/SpectatorSession.h"
+
+#include "snesonline/EmulatorEngine.h"
+#include "snesonline/Hash.h"
+#include "snesonline/Lz.h"
+#include "snesonline/Profiler.h"
+#include "snesonline/SpectatorHost.h"
+
+#include "NetSocket.h"
+#include "SpectatorWire.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace snesonline {
+
+// Live playback trails the newest input by this much, so a batch arriving a little late does not
+// stall the picture.
+static constexpr uint32_t kLiveLagFrames = 2 * SpectatorHost::kBatchFrames;
+// Beyond this lag the session fast-forwards instead of playing one frame per tick.
+static constexpr uint32_t kCatchUpLagFrames = kLiveLagFrames + 4 * SpectatorHost::kBatchFrames;
+// Join requests and snapshot acks repeat this often; once joined the ack doubles as a keep-alive.
+static constexpr int64_t kJoinAckIntervalMs = 100;
+static constexpr int64_t kLiveAckIntervalMs = 250;
+
+SpectatorSession::SpectatorSession() noexcept : engine_(&EmulatorEngine::instance()) {}
+
+SpectatorSession::~SpectatorSession() noexcept { stop(); }
+
+bool SpectatorSession::start(const Config& cfg) noexcept {
+    stop();
+
+    engine_ = cfg.engine ? cfg.engine : &EmulatorEngine::instance();
+    catchUpBudgetUs_ = cfg.catchUpBudgetMicros ? cfg.catchUpBudgetMicros : 8000u;
+
+    sockaddr_in host{};
+    if (!cfg.hostAddress || !net::resolveIpv4ToSockaddr(cfg.hostAddress, host, cfg.hostPort)) return false;
+    hostIpv4_be = host.sin_addr.s_addr;
+    hostPort_be = host.sin_port;
+
+    try {
+        ringMask_.assign(kRingN, 0u);
+        ringTag_.assign(kRingN, kNoFrame);
+    } catch (...) {
+        return false;
+    }
+
+    joined_ = false;
+    live_ = false;
+    frame_ = 0;
+    receivedEnd_ = 0;
+    newestSeen_ = 0;
+    snapshotFrame_ = 0;
+    snapshotCompressedBytes_ = 0;
+    assemblyFrame_ = kNoFrame;
+    nextChunk_ = 0;
+    ackDue_ = true;
+    lastAck_ = {};
+    recvBytes_ = 0;
+    recvPackets_ = 0;
+    sentBytes_ = 0;
+    sentPackets_ = 0;
+    lastRecv_ = {};
+    const double fps = engine_->core().framesPerSecond();
+    statsTracker_.reset(Clock::now(), fps > 1.0 ? static_cast<uint32_t>(1000000.0 / fps) : 0u);
+
+    return net::openUdpSocket(cfg.localPort, sock_);
+}
+
+void SpectatorSession::stop() noexcept {
+    net::closeSocket(sock_);
+    joined_ = false;
+    live_ = false;
+    assemblyFrame_ = kNoFrame;
+}
+
+void SpectatorSession::sendAck_() noexcept {
+    wire::SpectatorAck a{};
+    if (assemblyFrame_ != kNoFrame) {
+        a.nextChunk = nextChunk_;
+        a.snapshotFrame = assemblyFrame_;
+    } else {
+        a.nextChunk = joined_ ? wire::kNoChunk : 0;
+        a.snapshotFrame = joined_ ? snapshotFrame_ : wire::kNoFrame;
+    }
+    a.nextFrame = joined_ ? receivedEnd_ : wire::kNoFrame;
+    uint8_t out[wire::kSpectatorAckBytes];
+    wire::buildSpectatorAck(a, out);
+
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = hostIpv4_be;
+    to.sin_port = hostPort_be;
+    if (net::sendTo(sock_, out, sizeof(out), to)) {
+        sentPackets_++;
+        sentBytes_ += sizeof(out);
+    }
+    ackDue_ = false;
+    lastAck_ = Clock::now();
+}
+
+void SpectatorSession::handleInputs_(const uint8_t* data, std::size_t sizeBytes) noexcept {
+    if (!joined_) return;
+    uint32_t first = 0;
+    uint32_t count = 0;
+    uint32_t masks[wire::kSpectatorMaxFramesPerDatagram];
+    if (!wire::parseSpectatorInputs(data, sizeBytes, first, masks, wire::kSpectatorMaxFramesPerDatagram, count)) return;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t f = first + i;
+        // Older than what we still need, or too far ahead for the ring (the host resends it).
+        if (f < receivedEnd_ || f - frame_ >= kRingN) continue;
+        ringTag_[f % kRingN] = f;
+        ringMask_[f % kRingN] = masks[i];
+    }
+    if (first + count > newestSeen_) newestSeen_ = first + count;
+    while (receivedEnd_ - frame_ < kRingN && ringTag_[receivedEnd_ % kRingN] == receivedEnd_) receivedEnd_++;
+}
+
+void SpectatorSession::handleChunk_(const uint8_t* data, std::size_t sizeBytes) noexcept {
+    wire::SpectatorChunk c{};
+    if (!wire::parseSpectatorChunk(data, sizeBytes, c)) return;
+    // Late duplicates of the snapshot we already run from.
+    if (joined_ && (c.frame < frame_ || c.frame == snapshotFrame_)) return;
+
+    if (c.frame != assemblyFrame_ || c.compressedBytes != assembly_.size() || c.count != assemblyChunks_) {
+        try {
+            assembly_.resize(c.compressedBytes);
+            chunkReceived_.assign(c.count, 0u);
+        } catch (...) {
+            assemblyFrame_ = kNoFrame;
+            return;
+        }
+        assemblyFrame_ = c.frame;
+        assemblyRawBytes_ = c.rawBytes;
+        assemblyCrc_ = c.rawCrc;
+        assemblyChunks_ = c.count;
+        nextChunk_ = 0;
+    }
+
+    ackDue_ = true;
+    if (chunkReceived_[c.index]) return;
+    std::memcpy(assembly_.data() + static_cast<std::size_t>(c.index) * wire::kSpectatorChunkPayloadBytes, c.payload, c.payloadBytes);
+    chunkReceived_[c.index] = 1;
+    while (nextChunk_ < assemblyChunks_ && chunkReceived_[nextChunk_]) nextChunk_++;
+    if (nextChunk_ < assemblyChunks_) return;
+
+    if (!finishSnapshot_()) {
+        // Start over; the ack tells the host to resend from the first chunk.
+        joined_ = false;
+        live_ = false;
+    }
+    assemblyFrame_ = kNoFrame;
+}
+
+bool SpectatorSession::finishSnapshot_() noexcept {
+    try {
+        if (rawState_.size() < assemblyRawBytes_) rawState_.resize(assemblyRawBytes_);
+    } catch (...) {
+        return false;
+    }
+    const std::size_t n = lzDecompress(assembly_.data(), assembly_.size(), rawState_.data(), assemblyRawBytes_);
+    if (n != assemblyRawBytes_ || crc32(rawState_.data(), n) != assemblyCrc_) return false;
+    if (!engine_->loadStateFrom(rawState_.data(), n)) return false;
+
+    frame_ = assemblyFrame_;
+    receivedEnd_ = frame_;
+    newestSeen_ = frame_;
+    snapshotFrame_ = frame_;
+    snapshotCompressedBytes_ = assembly_.size();
+    std::fill(ringTag_.begin(), ringTag_.end(), kNoFrame);
+    joined_ = true;
+    live_ = false;
+    return true;
+}
+
+void SpectatorSession::receive_() noexcept {
+    SNESONLINE_PROFILE_SCOPE("spectator.receive");
+    uint8_t buf[wire::kSpectatorMaxDatagramBytes];
+    while (true) {
+        sockaddr_in from{};
+        const int n = net::recvFrom(sock_, buf, sizeof(buf), from);
+        if (n <= 0) break;
+        if (from.sin_addr.s_addr != hostIpv4_be || from.sin_port != hostPort_be) continue;
+        recvPackets_++;
+        recvBytes_ += static_cast<uint64_t>(n);
+        statsTracker_.onDatagramReceived(static_cast<std::size_t>(n));
+        lastRecv_ = Clock::now();
+
+        const std::size_t size = static_cast<std::size_t>(n);
+        switch (wire::peekMagic(buf, size)) {
+        case wire::kSpectatorInputMagic:
+            handleInputs_(buf, size);
+            break;
+        case wire::kSpectatorChunkMagic:
+            handleChunk_(buf, size);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void SpectatorSession::runFrame_(FrameOutput output) noexcept {
+    const uint32_t m = ringMask_[frame_ % kRingN];
+    engine_->setInputMask(0, static_cast<uint16_t>(m));
+    engine_->setInputMask(1, static_cast<uint16_t>(m >> 16));
+    engine_->advanceFrame(output);
+    frame_++;
+}
+
+void SpectatorSession::tick() noexcept {
+    SNESONLINE_PROFILE_SCOPE("spectator.tick");
+    if (sock_ == kInvalidSocket) return;
+    receive_();
+
+    if (joined_) {
+        const uint32_t lag = receivedEnd_ - frame_;
+        if (!live_ || lag > kCatchUpLagFrames) {
+            // Fast-forward through the buffered inputs, bounded so the caller's loop keeps running.
+            live_ = false;
+            const auto t0 = Clock::now();
+            const auto budget = std::chrono::microseconds(catchUpBudgetUs_);
+            // Fast-forward silently; the last frame before the trailing lag is shown.
+            while (receivedEnd_ - frame_ > kLiveLagFrames && Clock::now() - t0 < budget) {
+                runFrame_(receivedEnd_ - frame_ - 1 > kLiveLagFrames ? FrameOutput::None : FrameOutput::Present);
+            }
+            // Live once every input the host has sent so far is in and played down to the trailing lag.
+            live_ = (receivedEnd_ - frame_ <= kLiveLagFrames) && receivedEnd_ == newestSeen_ && newestSeen_ > snapshotFrame_;
+        } else if (lag > 0) {
+            // Drift: the host's clock runs a little faster than ours.
+            const bool extra = lag > kLiveLagFrames + SpectatorHost::kBatchFrames;
+            runFrame_(extra ? FrameOutput::AudioOnly : FrameOutput::Present);
+            if (extra) runFrame_(FrameOutput::Present);
+        }
+    }
+
+    const int64_t intervalMs = (joined_ && assemblyFrame_ == kNoFrame) ? kLiveAckIntervalMs : kJoinAckIntervalMs;
+    const auto sinceAck = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - lastAck_).count();
+    if (ackDue_ || sinceAck >= intervalMs) sendAck_();
+    statsTracker_.update(Clock::now(), sentPackets_, sentBytes_);
+}
+
+void SpectatorSession::stats(NetplayStats& out) const noexcept {
+    statsTracker_.fill(out);
+    out.localFrame = frame_;
+    out.remoteFrame = receivedEnd_;
+    out.connected = joined_;
+    out.waitingForPeer = !live_;
+    out.lastRecvAgeMs =
+        (recvPackets_ == 0) ? -1 : static_cast<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - lastRecv_).count());
+}
+
+} // namespace snesonline
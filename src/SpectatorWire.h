@@ -0,0 +1,183 @@
+#pragma once
+
+// Internal wire helpers shared by SpectatorHost and SpectatorSession. Spectators talk to the host on
+// their own UDP port, so none of this reaches a netplay peer.
+//
+// Spectator -> host ack (exactly 12 bytes, also the join request and keep-alive):
+//   u16 magic 'SA'
+//   u16 nextChunk     first snapshot chunk still missing; kNoChunk once the snapshot is loaded
+//   u32 nextFrame     first frame whose inputs are missing (kNoFrame before the first snapshot)
+//   u32 snapshotFrame frame of the snapshot being assembled or run from (kNoFrame: none)
+//
+// Host -> spectator inputs (confirmed frames only):
+//   u16 magic 'SI'
+//   u16 count       frames carried, starting at firstFrame
+//   u32 firstFrame
+//   runs, oldest first, until `count` frames are covered: u8 runLength, u16 p1Mask, u16 p2Mask
+//
+// Host -> spectator snapshot chunk (LZ-compressed EmulatorEngine savestate, see Lz.h):
+//   u16 magic 'SS'
+//   u16 index, u16 count, u16 payloadBytes
+//   u32 frame            first frame to run after loading the state
+//   u32 rawBytes, u32 compressedBytes, u32 rawCrc (crc32 of the uncompressed state)
+//   payload
+
+#include <cstddef>
+#include <cstdint>
+
+namespace snesonline::wire {
+
+static constexpr uint16_t kSpectatorAckMagic = 0x5341u;    // 'SA'
+static constexpr uint16_t kSpectatorInputMagic = 0x5349u;  // 'SI'
+static constexpr uint16_t kSpectatorChunkMagic = 0x5353u;  // 'SS'
+
+static constexpr uint16_t kNoChunk = 0xFFFFu;
+static constexpr uint32_t kNoFrame = 0xFFFFFFFFu;
+
+static constexpr std::size_t kSpectatorAckBytes = 12;
+static constexpr std::size_t kSpectatorInputHeaderBytes = 8;
+static constexpr std::size_t kSpectatorRunBytes = 5;
+static constexpr std::size_t kSpectatorChunkHeaderBytes = 24;
+// Keeps every spectator datagram under a typical 1280-byte path MTU.
+static constexpr std::size_t kSpectatorMaxDatagramBytes = 1200;
+static constexpr std::size_t kSpectatorChunkPayloadBytes = kSpectatorMaxDatagramBytes - kSpectatorChunkHeaderBytes;
+// Frames per input datagram; long idle runs could otherwise describe tens of thousands.
+static constexpr uint32_t kSpectatorMaxFramesPerDatagram = 2048;
+
+inline void put16(uint8_t* p, uint16_t v) noexcept {
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+}
+
+inline void put32(uint8_t* p, uint32_t v) noexcept {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (24 - 8 * i));
+}
+
+inline uint16_t get16(const uint8_t* p) noexcept {
+    return static_cast<uint16_t>((static_cast<uint16_t>(p[0]) << 8) | p[1]);
+}
+
+inline uint32_t get32(const uint8_t* p) noexcept {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline uint16_t peekMagic(const uint8_t* data, std::size_t sizeBytes) noexcept {
+    return (sizeBytes >= 2) ? get16(data) : 0;
+}
+
+struct SpectatorAck {
+    uint16_t nextChunk = kNoChunk;
+    uint32_t nextFrame = kNoFrame;
+    uint32_t snapshotFrame = kNoFrame;
+};
+
+inline void buildSpectatorAck(const SpectatorAck& a, uint8_t (&out)[kSpectatorAckBytes]) noexcept {
+    put16(out, kSpectatorAckMagic);
+    put16(out + 2, a.nextChunk);
+    put32(out + 4, a.nextFrame);
+    put32(out + 8, a.snapshotFrame);
+}
+
+inline bool parseSpectatorAck(const uint8_t* data, std::size_t sizeBytes, SpectatorAck& out) noexcept {
+    if (sizeBytes != kSpectatorAckBytes || get16(data) != kSpectatorAckMagic) return false;
+    out.nextChunk = get16(data + 2);
+    out.nextFrame = get32(data + 4);
+    out.snapshotFrame = get32(data + 8);
+    return true;
+}
+
+// masks[i] = p1 | (p2 << 16) for frame firstFrame + i. Encodes as many frames as fit in `capacity`
+// and returns the datagram size (0 if not even one frame fits); outCount receives the frame count.
+inline std::size_t buildSpectatorInputs(uint32_t firstFrame, const uint32_t* masks, uint32_t count, uint8_t* out,
+                                        std::size_t capacity, uint32_t& outCount) noexcept {
+    outCount = 0;
+    if (capacity < kSpectatorInputHeaderBytes + kSpectatorRunBytes || count == 0) return 0;
+    if (count > kSpectatorMaxFramesPerDatagram) count = kSpectatorMaxFramesPerDatagram;
+    std::size_t pos = kSpectatorInputHeaderBytes;
+    uint32_t i = 0;
+    while (i < count) {
+        if (capacity - pos < kSpectatorRunBytes) break;
+        const uint32_t m = masks[i];
+        uint32_t run = 1;
+        while (i + run < count && run < 255 && masks[i + run] == m) ++run;
+        out[pos] = static_cast<uint8_t>(run);
+        put16(out + pos + 1, static_cast<uint16_t>(m));
+        put16(out + pos + 3, static_cast<uint16_t>(m >> 16));
+        pos += kSpectatorRunBytes;
+        i += run;
+    }
+    put16(out, kSpectatorInputMagic);
+    put16(out + 2, static_cast<uint16_t>(i));
+    put32(out + 4, firstFrame);
+    outCount = i;
+    return pos;
+}
+
+// outMasks must hold `maxCount` entries (kSpectatorMaxFramesPerDatagram accepts anything a host sends).
+inline bool parseSpectatorInputs(const uint8_t* data, std::size_t sizeBytes, uint32_t& outFirstFrame, uint32_t* outMasks,
+                                 uint32_t maxCount, uint32_t& outCount) noexcept {
+    if (sizeBytes < kSpectatorInputHeaderBytes || get16(data) != kSpectatorInputMagic) return false;
+    const uint32_t count = get16(data + 2);
+    if (count == 0 || count > maxCount) return false;
+    outFirstFrame = get32(data + 4);
+    std::size_t pos = kSpectatorInputHeaderBytes;
+    uint32_t n = 0;
+    while (n < count) {
+        if (sizeBytes - pos < kSpectatorRunBytes) return false;
+        const uint32_t run = data[pos];
+        if (run == 0 || run > count - n) return false;
+        const uint32_t m = static_cast<uint32_t>(get16(data + pos + 1)) | (static_cast<uint32_t>(get16(data + pos + 3)) << 16);
+        for (uint32_t k = 0; k < run; ++k) outMasks[n++] = m;
+        pos += kSpectatorRunBytes;
+    }
+    if (pos != sizeBytes) return false;
+    outCount = count;
+    return true;
+}
+
+struct SpectatorChunk {
+    uint16_t index = 0;
+    uint16_t count = 0;
+    uint16_t payloadBytes = 0;
+    uint32_t frame = 0;
+    uint32_t rawBytes = 0;
+    uint32_t compressedBytes = 0;
+    uint32_t rawCrc = 0;
+    const uint8_t* payload = nullptr;
+};
+
+inline std::size_t buildSpectatorChunk(const SpectatorChunk& c, uint8_t* out, std::size_t capacity) noexcept {
+    const std::size_t total = kSpectatorChunkHeaderBytes + c.payloadBytes;
+    if (capacity < total) return 0;
+    put16(out, kSpectatorChunkMagic);
+    put16(out + 2, c.index);
+    put16(out + 4, c.count);
+    put16(out + 6, c.payloadBytes);
+    put32(out + 8, c.frame);
+    put32(out + 12, c.rawBytes);
+    put32(out + 16, c.compressedBytes);
+    put32(out + 20, c.rawCrc);
+    for (std::size_t i = 0; i < c.payloadBytes; ++i) out[kSpectatorChunkHeaderBytes + i] = c.payload[i];
+    return total;
+}
+
+inline bool parseSpectatorChunk(const uint8_t* data, std::size_t sizeBytes, SpectatorChunk& out) noexcept {
+    if (sizeBytes < kSpectatorChunkHeaderBytes || get16(data) != kSpectatorChunkMagic) return false;
+    out.index = get16(data + 2);
+    out.count = get16(data + 4);
+    out.payloadBytes = get16(data + 6);
+    out.frame = get32(data + 8);
+    out.rawBytes = get32(data + 12);
+    out.compressedBytes = get32(data + 16);
+    out.rawCrc = get32(data + 20);
+    out.payload = data + kSpectatorChunkHeaderBytes;
+    if (sizeBytes != kSpectatorChunkHeaderBytes + out.payloadBytes) return false;
+    if (out.count == 0 || out.count == kNoChunk || out.index >= out.count) return false;
+    // Every chunk but the last is full, so the offset of any chunk follows from its index.
+    const uint64_t offset = static_cast<uint64_t>(out.index) * kSpectatorChunkPayloadBytes;
+    if (offset + out.payloadBytes > out.compressedBytes) return false;
+    if (out.index + 1u < out.count && out.payloadBytes != kSpectatorChunkPayloadBytes) return false;
+    return true;
+}
+
+} // namespace snesonline::wire
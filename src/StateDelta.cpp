@@ -0,0 +1,527 @@
+#include "snesonline/StateDelta.h"
+
+#include "snesonline/Hash.h"
+#include "snesonline/Lz.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace snesonline {
+
+namespace {
+
+static constexpr std::size_t kNodeHeaderBytes = 16;
+static constexpr std::size_t kBlockRequestHeaderBytes = 12;
+static constexpr std::size_t kPatchHeaderBytes = 8;
+static constexpr uint32_t kMaxFanout = 64;
+
+// Node replies per host poll, and datagrams per joiner poll (node requests, block request, ack).
+static constexpr std::size_t kMaxRepliesPerPoll = 16;
+static constexpr std::size_t kMaxQueuedReplies = 64;
+static constexpr std::size_t kReplySlotBytes = kNodeHeaderBytes + 4 * kDeltaMaxHashesPerDatagram;
+static constexpr std::size_t kMaxRequestsPerPoll = 16;
+static constexpr std::size_t kRequestSlotBytes = kBulkBaseDatagramBytes;
+
+// Unanswered requests are repeated this often.
+static constexpr int64_t kRetryIntervalMs = 250;
+
+inline void put16(uint8_t* p, uint16_t v) noexcept {
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+}
+
+inline void put32(uint8_t* p, uint32_t v) noexcept {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (24 - 8 * i));
+}
+
+inline uint16_t get16(const uint8_t* p) noexcept {
+    return static_cast<uint16_t>((static_cast<uint16_t>(p[0]) << 8) | p[1]);
+}
+
+inline uint32_t get32(const uint8_t* p) noexcept {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline uint32_t blockLength(uint32_t leaf, uint32_t blockBytes, std::size_t sizeBytes) noexcept {
+    const std::size_t off = static_cast<std::size_t>(leaf) * blockBytes;
+    return static_cast<uint32_t>(std::min<std::size_t>(blockBytes, sizeBytes - off));
+}
+
+inline void putNodeHeader(uint8_t* p, uint32_t magic, uint32_t crc, uint8_t level, uint16_t first, uint16_t count) noexcept {
+    put32(p, magic);
+    put32(p + 4, crc);
+    p[8] = level;
+    p[9] = 0;
+    put16(p + 10, first);
+    put16(p + 12, count);
+    put16(p + 14, 0);
+}
+
+} // namespace
+
+// ---- Tree ----
+
+bool BlockHashTree::build(const void* data, std::size_t sizeBytes, uint32_t blockBytes, uint32_t fanout) noexcept {
+    clear();
+    if (!data || sizeBytes == 0 || blockBytes == 0 || fanout < 2 || fanout > kMaxFanout) return false;
+    const std::size_t leaves = (sizeBytes + blockBytes - 1) / blockBytes;
+    if (leaves > 0x0FFFFFFFu) return false;
+
+    try {
+        // Level sizes from the leaves up, then flipped so level 0 is the root.
+        uint32_t n = static_cast<uint32_t>(leaves);
+        counts_.push_back(n);
+        while (n > 1) {
+            n = (n + fanout - 1) / fanout;
+            counts_.push_back(n);
+        }
+        std::reverse(counts_.begin(), counts_.end());
+        uint32_t total = 0;
+        for (uint32_t c : counts_) {
+            offsets_.push_back(total);
+            total += c;
+        }
+        hashes_.assign(total, 0u);
+    } catch (...) {
+        clear();
+        return false;
+    }
+    blockBytes_ = blockBytes;
+    fanout_ = fanout;
+    sizeBytes_ = sizeBytes;
+
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint32_t leafLevel = levelCount() - 1;
+    for (uint32_t i = 0; i < counts_[leafLevel]; ++i) {
+        hashes_[offsets_[leafLevel] + i] = crc32c(p + static_cast<std::size_t>(i) * blockBytes, blockLength(i, blockBytes, sizeBytes));
+    }
+    uint8_t children[4 * kMaxFanout];
+    for (uint32_t level = leafLevel; level-- > 0;) {
+        const uint32_t below = counts_[level + 1];
+        for (uint32_t i = 0; i < counts_[level]; ++i) {
+            const uint32_t first = i * fanout;
+            const uint32_t count = std::min(fanout, below - first);
+            for (uint32_t c = 0; c < count; ++c) put32(children + 4 * c, hashes_[offsets_[level + 1] + first + c]);
+            hashes_[offsets_[level] + i] = crc32c(children, 4 * static_cast<std::size_t>(count));
+        }
+    }
+    return true;
+}
+
+void BlockHashTree::clear() noexcept {
+    hashes_.clear();
+    offsets_.clear();
+    counts_.clear();
+    blockBytes_ = 0;
+    fanout_ = 0;
+    sizeBytes_ = 0;
+}
+
+// ---- Host ----
+
+bool DeltaSyncHost::begin(uint8_t bulkChannel, const void* state, std::size_t sizeBytes) noexcept {
+    cancel();
+    if (!state || sizeBytes == 0 || sizeBytes > kBulkMaxBlobBytes) return false;
+    try {
+        state_.assign(static_cast<const uint8_t*>(state), static_cast<const uint8_t*>(state) + sizeBytes);
+        replies_.reserve(kMaxQueuedReplies);
+        if (scratch_.empty()) scratch_.resize(kMaxRepliesPerPoll * kReplySlotBytes);
+    } catch (...) {
+        cancel();
+        return false;
+    }
+    if (!tree_.build(state_.data(), state_.size()) || tree_.leafCount() > kDeltaMaxLeaves) {
+        cancel();
+        return false;
+    }
+    channel_ = bulkChannel;
+    crc_ = crc32(state_.data(), state_.size());
+    active_ = true;
+    return true;
+}
+
+void DeltaSyncHost::cancel() noexcept {
+    active_ = false;
+    receiverSeen_ = false;
+    crc_ = 0;
+    state_.clear();
+    tree_.clear();
+    replies_.clear();
+    patchRequestCrc_ = 0;
+    patchBlocks_ = 0;
+    patch_.cancel();
+}
+
+std::size_t DeltaSyncHost::writeOffer(uint8_t* out, std::size_t capacity) const noexcept {
+    if (!active_ || !out || capacity < kDeltaOfferBytes) return 0;
+    put32(out, kDeltaOfferMagic);
+    put32(out + 4, static_cast<uint32_t>(state_.size()));
+    put32(out + 8, crc_);
+    put32(out + 12, tree_.root());
+    put16(out + 16, static_cast<uint16_t>(tree_.blockBytes()));
+    put16(out + 18, static_cast<uint16_t>(tree_.fanout()));
+    return kDeltaOfferBytes;
+}
+
+void DeltaSyncHost::onDatagram(const uint8_t* data, std::size_t sizeBytes, Clock::time_point now) noexcept {
+    if (!active_ || !data || sizeBytes < 4) return;
+    const uint32_t magic = get32(data);
+    if (magic == kBulkAckMagic) {
+        patch_.onDatagram(data, sizeBytes, now);
+        return;
+    }
+    if (sizeBytes < kBlockRequestHeaderBytes || get32(data + 4) != crc_) return;
+
+    if (magic == kDeltaNodeRequestMagic) {
+        if (sizeBytes < kNodeHeaderBytes) return;
+        const uint8_t level = data[8];
+        const uint16_t first = get16(data + 10);
+        const uint16_t count = get16(data + 12);
+        if (level == 0 || level >= tree_.levelCount() || count == 0 || count > kDeltaMaxHashesPerDatagram) return;
+        if (static_cast<uint32_t>(first) + count > tree_.nodeCount(level)) return;
+        receiverSeen_ = true;
+        // A repeated request while the reply is still queued needs no second reply.
+        for (const Reply& r : replies_) {
+            if (r.level == level && r.first == first && r.count == count) return;
+        }
+        if (replies_.size() < kMaxQueuedReplies) replies_.push_back({level, first, count});
+        return;
+    }
+
+    if (magic == kDeltaBlockRequestMagic) {
+        const uint32_t leaves = get32(data + 8);
+        const std::size_t bitmapBytes = (static_cast<std::size_t>(leaves) + 7) / 8;
+        if (leaves != tree_.leafCount() || sizeBytes < kBlockRequestHeaderBytes + bitmapBytes) return;
+        receiverSeen_ = true;
+        const uint32_t requestCrc = crc32(data + kBlockRequestHeaderBytes, bitmapBytes);
+        // Repeated until the patch arrives; keep the transfer already under way.
+        if (patch_.active() && requestCrc == patchRequestCrc_) return;
+        startPatch_(data + kBlockRequestHeaderBytes, requestCrc);
+    }
+}
+
+void DeltaSyncHost::startPatch_(const uint8_t* bitmap, uint32_t requestCrc) noexcept {
+    const uint32_t blockBytes = tree_.blockBytes();
+    uint32_t blocks = 0;
+    try {
+        std::vector<uint8_t> raw;
+        for (uint32_t i = 0; i < tree_.leafCount(); ++i) {
+            if (!((bitmap[i >> 3] >> (i & 7)) & 1u)) continue;
+            const uint8_t* block = state_.data() + static_cast<std::size_t>(i) * blockBytes;
+            raw.insert(raw.end(), block, block + blockLength(i, blockBytes, state_.size()));
+            blocks++;
+        }
+        std::vector<uint8_t> blob(kPatchHeaderBytes + lzMaxCompressedSize(raw.size()));
+        put32(blob.data(), crc_);
+        put32(blob.data() + 4, requestCrc);
+        const std::size_t packed = lzCompress(raw.data(), raw.size(), blob.data() + kPatchHeaderBytes, blob.size() - kPatchHeaderBytes);
+        if (packed == 0 || !patch_.begin(channel_, blob.data(), kPatchHeaderBytes + packed)) return;
+    } catch (...) {
+        return;
+    }
+    patchRequestCrc_ = requestCrc;
+    patchBlocks_ = blocks;
+}
+
+std::size_t DeltaSyncHost::poll(Clock::time_point now, BulkDatagram* out, std::size_t maxCount) noexcept {
+    if (!active_ || !out) return 0;
+    maxCount = std::min(maxCount, kBulkMaxBatch);
+
+    std::size_t n = 0;
+    std::size_t used = 0;
+    while (used < replies_.size() && n < maxCount && n < kMaxRepliesPerPoll) {
+        const Reply r = replies_[used++];
+        uint8_t* p = scratch_.data() + n * kReplySlotBytes;
+        putNodeHeader(p, kDeltaNodeHashesMagic, crc_, r.level, r.first, r.count);
+        for (uint32_t i = 0; i < r.count; ++i) put32(p + kNodeHeaderBytes + 4 * i, tree_.hash(r.level, r.first + i));
+        out[n].data = p;
+        out[n].sizeBytes = kNodeHeaderBytes + 4 * static_cast<std::size_t>(r.count);
+        sentBytes_ += out[n].sizeBytes;
+        n++;
+    }
+    replies_.erase(replies_.begin(), replies_.begin() + static_cast<std::ptrdiff_t>(used));
+
+    return n + patch_.poll(now, out + n, maxCount - n);
+}
+
+// ---- Joiner ----
+
+bool DeltaSyncJoiner::isCurrentOffer(const uint8_t* offer, std::size_t offerBytes) const noexcept {
+    if (!active() || !offer || offerBytes < kDeltaOfferBytes || get32(offer) != kDeltaOfferMagic) return false;
+    return get32(offer + 4) == size_ && get32(offer + 8) == crc_ && get32(offer + 12) == root_;
+}
+
+bool DeltaSyncJoiner::begin(uint8_t bulkChannel, const uint8_t* offer, std::size_t offerBytes, const void* base,
+                            std::size_t baseBytes) noexcept {
+    reset();
+    if (!offer || offerBytes < kDeltaOfferBytes || get32(offer) != kDeltaOfferMagic) return false;
+    const uint32_t size = get32(offer + 4);
+    const uint32_t blockBytes = get16(offer + 16);
+    const uint32_t fanout = get16(offer + 18);
+    if (size == 0 || size > kBulkMaxBlobBytes || blockBytes == 0 || fanout < 2 || fanout > kMaxFanout) return false;
+    const uint32_t leaves = static_cast<uint32_t>((static_cast<std::size_t>(size) + blockBytes - 1) / blockBytes);
+    if (leaves > kDeltaMaxLeaves) return false;
+
+    try {
+        state_.assign(size, 0u);
+        if (scratch_.empty()) scratch_.resize(kMaxRequestsPerPoll * kRequestSlotBytes);
+    } catch (...) {
+        reset();
+        return false;
+    }
+    channel_ = bulkChannel;
+    size_ = size;
+    crc_ = get32(offer + 8);
+    root_ = get32(offer + 12);
+    blockBytes_ = blockBytes;
+    fanout_ = fanout;
+    leafCount_ = leaves;
+
+    // Without a base of the same size every block differs.
+    if (!base || baseBytes != size) {
+        requestAll_();
+        return true;
+    }
+    std::memcpy(state_.data(), base, size);
+    if (!tree_.build(state_.data(), size, blockBytes, fanout)) {
+        requestAll_();
+        return true;
+    }
+    if (tree_.root() == root_) {
+        if (crc32(state_.data(), state_.size()) == crc_) {
+            phase_ = Phase::Complete;
+            return true;
+        }
+        requestAll_();
+        return true;
+    }
+    if (tree_.levelCount() == 1) {
+        requestAll_();
+        return true;
+    }
+    // The upper levels are tiny: fetch the deepest one that fits a single reply in full, saving a
+    // round trip per level skipped.
+    uint32_t level = 1;
+    while (level + 1 < tree_.levelCount() && tree_.nodeCount(level + 1) <= kDeltaMaxHashesPerDatagram) ++level;
+    try {
+        std::vector<uint32_t> parents(tree_.nodeCount(level - 1));
+        for (uint32_t i = 0; i < parents.size(); ++i) parents[i] = i;
+        startLevel_(level, parents);
+    } catch (...) {
+        requestAll_();
+    }
+    return true;
+}
+
+void DeltaSyncJoiner::reset() noexcept {
+    phase_ = Phase::Idle;
+    channel_ = 0;
+    size_ = 0;
+    crc_ = 0;
+    root_ = 0;
+    blockBytes_ = 0;
+    fanout_ = 0;
+    leafCount_ = 0;
+    tree_.clear();
+    state_.clear();
+    level_ = 0;
+    wanted_.clear();
+    have_.clear();
+    remote_.clear();
+    missing_ = 0;
+    bitmap_.clear();
+    requestCrc_ = 0;
+    blocksRequested_ = 0;
+    fetchAll_ = false;
+    patch_.reset();
+    patchRaw_.clear();
+    requestDue_ = false;
+    lastRequest_ = {};
+}
+
+void DeltaSyncJoiner::startLevel_(uint32_t level, const std::vector<uint32_t>& parents) noexcept {
+    const uint32_t n = tree_.nodeCount(level);
+    try {
+        wanted_.assign(n, 0u);
+        have_.assign(n, 0u);
+        remote_.assign(n, 0u);
+    } catch (...) {
+        requestAll_();
+        return;
+    }
+    level_ = level;
+    missing_ = 0;
+    for (uint32_t p : parents) {
+        for (uint32_t c = p * fanout_; c < std::min(n, (p + 1) * fanout_); ++c) {
+            if (wanted_[c]) continue;
+            wanted_[c] = 1;
+            missing_++;
+        }
+    }
+    phase_ = Phase::Nodes;
+    requestDue_ = true;
+}
+
+void DeltaSyncJoiner::finishLevel_() noexcept {
+    std::vector<uint32_t> differ;
+    try {
+        for (uint32_t i = 0; i < static_cast<uint32_t>(wanted_.size()); ++i) {
+            if (wanted_[i] && remote_[i] != tree_.hash(level_, i)) differ.push_back(i);
+        }
+    } catch (...) {
+        requestAll_();
+        return;
+    }
+    // A parent differed but none of its children do: the trees disagree on more than data.
+    if (differ.empty()) {
+        requestAll_();
+        return;
+    }
+    if (level_ + 1 == tree_.levelCount()) {
+        requestBlocks_(differ);
+        return;
+    }
+    startLevel_(level_ + 1, differ);
+}
+
+void DeltaSyncJoiner::requestBlocks_(const std::vector<uint32_t>& leaves) noexcept {
+    std::size_t rawBytes = 0;
+    try {
+        bitmap_.assign((static_cast<std::size_t>(leafCount_) + 7) / 8, 0u);
+        for (uint32_t leaf : leaves) {
+            bitmap_[leaf >> 3] = static_cast<uint8_t>(bitmap_[leaf >> 3] | (1u << (leaf & 7)));
+            rawBytes += blockLength(leaf, blockBytes_, size_);
+        }
+        patchRaw_.resize(rawBytes);
+    } catch (...) {
+        reset();
+        return;
+    }
+    requestCrc_ = crc32(bitmap_.data(), bitmap_.size());
+    blocksRequested_ = static_cast<uint32_t>(leaves.size());
+    phase_ = Phase::Blocks;
+    requestDue_ = true;
+}
+
+void DeltaSyncJoiner::requestAll_() noexcept {
+    fetchAll_ = true;
+    std::vector<uint32_t> all;
+    try {
+        all.resize(leafCount_);
+    } catch (...) {
+        reset();
+        return;
+    }
+    for (uint32_t i = 0; i < leafCount_; ++i) all[i] = i;
+    requestBlocks_(all);
+}
+
+bool DeltaSyncJoiner::applyPatch_() noexcept {
+    const std::vector<uint8_t>& blob = patch_.data();
+    // A patch for an earlier request (e.g. before falling back to every block).
+    if (blob.size() < kPatchHeaderBytes || get32(blob.data()) != crc_ || get32(blob.data() + 4) != requestCrc_) return false;
+
+    const std::size_t rawBytes = lzDecompress(blob.data() + kPatchHeaderBytes, blob.size() - kPatchHeaderBytes, patchRaw_.data(), patchRaw_.size());
+    if (rawBytes == patchRaw_.size()) {
+        std::size_t pos = 0;
+        for (uint32_t i = 0; i < leafCount_; ++i) {
+            if (!((bitmap_[i >> 3] >> (i & 7)) & 1u)) continue;
+            const uint32_t len = blockLength(i, blockBytes_, size_);
+            std::memcpy(state_.data() + static_cast<std::size_t>(i) * blockBytes_, patchRaw_.data() + pos, len);
+            pos += len;
+        }
+        if (crc32(state_.data(), state_.size()) == crc_) {
+            phase_ = Phase::Complete;
+            return true;
+        }
+    }
+    if (!fetchAll_) {
+        requestAll_();
+        return false;
+    }
+    // Even every block does not add up to the offered state; leave it to the caller's timeout.
+    phase_ = Phase::Idle;
+    return false;
+}
+
+bool DeltaSyncJoiner::onDatagram(const uint8_t* data, std::size_t sizeBytes, Clock::time_point now) noexcept {
+    if (!active() || !data || sizeBytes < 4) return false;
+    const uint32_t magic = get32(data);
+
+    if (magic == kBulkDataMagic) {
+        // Finished transfers still get their duplicates acked (the host may have missed the last ack).
+        if (phase_ != Phase::Blocks && phase_ != Phase::Complete) return false;
+        if (sizeBytes < kBulkDataHeaderBytes || data[4] != channel_) return false;
+        if (!patch_.onDatagram(data, sizeBytes, now) || phase_ != Phase::Blocks) return false;
+        return applyPatch_();
+    }
+
+    if (magic != kDeltaNodeHashesMagic || phase_ != Phase::Nodes) return false;
+    if (sizeBytes < kNodeHeaderBytes || get32(data + 4) != crc_ || data[8] != level_) return false;
+    const uint32_t first = get16(data + 10);
+    const uint32_t count = get16(data + 12);
+    if (sizeBytes < kNodeHeaderBytes + 4 * static_cast<std::size_t>(count) || first + count > wanted_.size()) return false;
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t idx = first + i;
+        if (!wanted_[idx] || have_[idx]) continue;
+        have_[idx] = 1;
+        remote_[idx] = get32(data + kNodeHeaderBytes + 4 * i);
+        missing_--;
+    }
+    if (missing_ == 0) finishLevel_();
+    return false;
+}
+
+std::size_t DeltaSyncJoiner::poll(Clock::time_point now, BulkDatagram* out, std::size_t maxCount) noexcept {
+    if (!active() || !out) return 0;
+    maxCount = std::min(maxCount, kMaxRequestsPerPoll);
+    const bool retry = lastRequest_.time_since_epoch().count() == 0 ||
+                       std::chrono::duration_cast<std::chrono::milliseconds>(now - lastRequest_).count() >= kRetryIntervalMs;
+
+    std::size_t n = 0;
+    if (phase_ == Phase::Nodes && (requestDue_ || retry)) {
+        // One request per run of nodes still missing.
+        const uint32_t count = static_cast<uint32_t>(wanted_.size());
+        uint32_t i = 0;
+        while (i < count && n < maxCount) {
+            if (!wanted_[i] || have_[i]) {
+                ++i;
+                continue;
+            }
+            const uint32_t first = i;
+            while (i < count && wanted_[i] && !have_[i] && i - first < kDeltaMaxHashesPerDatagram) ++i;
+            uint8_t* p = scratch_.data() + n * kRequestSlotBytes;
+            putNodeHeader(p, kDeltaNodeRequestMagic, crc_, static_cast<uint8_t>(level_), static_cast<uint16_t>(first),
+                          static_cast<uint16_t>(i - first));
+            out[n].data = p;
+            out[n].sizeBytes = kNodeHeaderBytes;
+            n++;
+        }
+        requestDue_ = false;
+        lastRequest_ = now;
+    }
+    if (phase_ == Phase::Blocks && (requestDue_ || retry) && n < maxCount) {
+        uint8_t* p = scratch_.data() + n * kRequestSlotBytes;
+        put32(p, kDeltaBlockRequestMagic);
+        put32(p + 4, crc_);
+        put32(p + 8, leafCount_);
+        std::memcpy(p + kBlockRequestHeaderBytes, bitmap_.data(), bitmap_.size());
+        out[n].data = p;
+        out[n].sizeBytes = kBlockRequestHeaderBytes + bitmap_.size();
+        n++;
+        requestDue_ = false;
+        lastRequest_ = now;
+    }
+    if ((phase_ == Phase::Blocks || phase_ == Phase::Complete) && n < maxCount) {
+        uint8_t* p = scratch_.data() + n * kRequestSlotBytes;
+        const std::size_t ackBytes = patch_.pollAck(now, p, kRequestSlotBytes);
+        if (ackBytes != 0) {
+            out[n].data = p;
+            out[n].sizeBytes = ackBytes;
+            n++;
+        }
+    }
+    return n;
+}
+
+} // namespace snesonline
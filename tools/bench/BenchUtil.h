@@ -0,0 +1,91 @@
+#pragma once
+
+// Tiny timing helpers shared by the benchmark executables (no third-party framework).
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "snesonline/EmulatorEngine.h"
+
+namespace snesonline::bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double nowSeconds() noexcept {
+    return std::chrono::duration<double>(Clock::now().time_since_epoch()).count();
+}
+
+// Prevents the optimizer from discarding a computed value.
+template <typename T>
+inline void keep(const T& v) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "m"(v) : "memory");
+#else
+    static volatile T sink;
+    sink = v;
+    (void)sink;
+#endif
+}
+
+struct Samples {
+    std::vector<double> ns;
+
+    void add(double v) { ns.push_back(v); }
+
+    double percentile(double p) const {
+        if (ns.empty()) return 0.0;
+        std::vector<double> s = ns;
+        std::sort(s.begin(), s.end());
+        const std::size_t i = static_cast<std::size_t>(p * static_cast<double>(s.size() - 1) + 0.5);
+        return s[i];
+    }
+
+    double mean() const {
+        if (ns.empty()) return 0.0;
+        double t = 0.0;
+        for (double v : ns) t += v;
+        return t / static_cast<double>(ns.size());
+    }
+};
+
+// Runs `fn` `iters` times after `warmup` runs and records per-iteration wall time (ns).
+template <typename Fn>
+inline Samples measure(int warmup, int iters, Fn&& fn) {
+    for (int i = 0; i < warmup; ++i) fn();
+    Samples s;
+    s.ns.reserve(static_cast<std::size_t>(iters));
+    for (int i = 0; i < iters; ++i) {
+        const auto t0 = Clock::now();
+        fn();
+        const auto t1 = Clock::now();
+        s.add(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+    }
+    return s;
+}
+
+inline void printRow(const char* name, const Samples& s) {
+    std::printf("%-40s mean %10.1f ns   p50 %10.1f ns   p99 %10.1f ns\n", name, s.mean(), s.percentile(0.50), s.percentile(0.99));
+}
+
+// Loads the mock libretro core built alongside the benchmarks (see mock_core.cpp).
+inline bool loadMockCore(EmulatorEngine& eng) {
+#if defined(SNESONLINE_MOCK_CORE_PATH)
+    const char* path = std::getenv("SNESONLINE_BENCH_CORE");
+    if (!path || !path[0]) path = SNESONLINE_MOCK_CORE_PATH;
+    if (!eng.initialize(path, "mock.sfc")) {
+        std::fprintf(stderr, "failed to load core: %s\n", path);
+        return false;
+    }
+    return true;
+#else
+    (void)eng;
+    return false;
+#endif
+}
+
+} // namespace snesonline::bench
@@ -0,0 +1,223 @@
+// AudioResampler cost, quality and fill control.
+//
+// 1. Cost of resampling 1000 emulated frames of SNES audio (32040.5 Hz, ~533 frames per video
+//    frame) to common device rates, next to the plain ring copy it adds to.
+// 2. A 1 kHz sine through each conversion: SNR against the ideal sine at the output rate.
+// 3. Two minutes of simulated playback with the device clock 0.3% fast, exact and 0.3% slow:
+//    the old drop-oldest ring (fixed ratio, clamped at 4 device callbacks) against the fill
+//    controller (target 2 callbacks). Reports dropped and missing frames and where the fill ends.
+//
+// Exits non-zero if rate control drops or misses audio after the first second, ends more than
+// 10% off its target, or a conversion's SNR is under 60 dB.
+//
+// Usage: snesonline_bench_audio_resampler
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "BenchUtil.h"
+
+#include "snesonline/AudioResampler.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr double kSnesRateHz = 32040.5;
+constexpr double kSnesFps = 60.0988;
+constexpr double kPi = 3.14159265358979323846;
+
+struct Conversion {
+    const char* name;
+    double inHz;
+    double outHz;
+};
+
+constexpr Conversion kConversions[] = {
+    {"32040.5 -> 48000 Hz", kSnesRateHz, 48000.0},
+    {"32040.5 -> 44100 Hz", kSnesRateHz, 44100.0},
+    {"48000 -> 44100 Hz", 48000.0, 44100.0},
+};
+
+// One emulated frame's worth of input frames at `hz`, carrying the fraction over.
+uint32_t framesThisTick(double hz, double& carry) {
+    carry += hz / kSnesFps;
+    const uint32_t n = static_cast<uint32_t>(carry);
+    carry -= n;
+    return n;
+}
+
+void makeNoise(std::vector<int16_t>& pcm) {
+    uint32_t x = 0x2468ACE1u;
+    for (auto& s : pcm) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        s = static_cast<int16_t>((x >> 16) & 0x3FFF) - 0x2000;
+    }
+}
+
+void reportCost() {
+    std::printf("cost of 1000 emulated frames (~16.6 s of audio)\n");
+    std::vector<int16_t> in(1200 * 2);
+    makeNoise(in);
+    std::vector<int16_t> out(4096 * 2);
+
+    {
+        // The old sink's per-frame interleaved copy into the ring.
+        std::vector<int16_t> ring(1 << 17);
+        const bench::Samples s = bench::measure(3, 30, [&] {
+            double carry = 0.0;
+            uint32_t w = 0;
+            for (int f = 0; f < 1000; ++f) {
+                const uint32_t n = framesThisTick(kSnesRateHz, carry);
+                for (uint32_t i = 0; i < n; ++i) {
+                    const uint32_t idx = (w + i) % (static_cast<uint32_t>(ring.size()) / 2);
+                    ring[idx * 2 + 0] = in[i * 2 + 0];
+                    ring[idx * 2 + 1] = in[i * 2 + 1];
+                }
+                w += n;
+            }
+            bench::keep(ring[w % ring.size()]);
+        });
+        std::printf("  %-24s %8.1f us per 1000 frames\n", "ring copy only", s.mean() / 1000.0);
+    }
+
+    for (const Conversion& c : kConversions) {
+        auto rs = std::make_unique<AudioResampler>();
+        rs->configure(c.inHz, c.outHz);
+        std::size_t produced = 0;
+        const bench::Samples s = bench::measure(3, 30, [&] {
+            double carry = 0.0;
+            produced = 0;
+            for (int f = 0; f < 1000; ++f) {
+                const uint32_t n = framesThisTick(c.inHz, carry);
+                rs->updateFill(1000, 1024);
+                produced += rs->process(in.data(), n, out.data(), out.size() / 2);
+            }
+            bench::keep(out[0]);
+        });
+        std::printf("  %-24s %8.1f us per 1000 frames (%.1f ns per output frame)\n", c.name, s.mean() / 1000.0,
+                    s.mean() / static_cast<double>(produced ? produced : 1));
+    }
+}
+
+bool reportQuality() {
+    std::printf("\n1 kHz sine, -6 dBFS\n");
+    bool ok = true;
+    for (const Conversion& c : kConversions) {
+        auto rs = std::make_unique<AudioResampler>();
+        rs->configure(c.inHz, c.outHz);
+        const std::size_t inFrames = static_cast<std::size_t>(c.inHz); // 1 s
+        std::vector<int16_t> in(inFrames * 2);
+        for (std::size_t i = 0; i < inFrames; ++i) {
+            const double v = 16384.0 * std::sin(2.0 * kPi * 1000.0 * static_cast<double>(i) / c.inHz);
+            in[i * 2 + 0] = static_cast<int16_t>(std::lround(v));
+            in[i * 2 + 1] = static_cast<int16_t>(std::lround(-v));
+        }
+        std::vector<int16_t> out(rs->maxOutputFrames(inFrames) * 2);
+        const std::size_t n = rs->process(in.data(), inFrames, out.data(), out.size() / 2);
+
+        // Output frame k sits at input time k / ratio; skip the edges (filter warm-up/tail).
+        double signal = 0.0;
+        double noise = 0.0;
+        for (std::size_t k = 200; k + 200 < n; ++k) {
+            const double t = static_cast<double>(k) / c.outHz;
+            const double ideal = 16384.0 * std::sin(2.0 * kPi * 1000.0 * t);
+            const double e = static_cast<double>(out[k * 2]) - ideal;
+            signal += ideal * ideal;
+            noise += e * e;
+        }
+        const double snr = 10.0 * std::log10(signal / (noise > 0.0 ? noise : 1e-9));
+        std::printf("  %-24s %zu -> %zu frames, SNR %.1f dB\n", c.name, inFrames, n, snr);
+        if (snr < 60.0) ok = false;
+    }
+    return ok;
+}
+
+struct DriftResult {
+    uint64_t dropped = 0;
+    uint64_t missing = 0;
+    double endFill = 0.0;
+    double endAdjust = 0.0;
+};
+
+// `rateControl` false: fixed ratio, and the ring drops its oldest frames above `capFrames` (the old
+// Windows AudioRing). True: the resampler steers the fill towards `targetFrames`.
+DriftResult simulate(double deviceDrift, bool rateControl) {
+    constexpr double kOutHz = 48000.0;
+    constexpr uint32_t kCallbackFrames = 512;
+    constexpr uint32_t capFrames = kCallbackFrames * 4;
+    constexpr uint32_t targetFrames = kCallbackFrames * 2;
+    constexpr double kSeconds = 120.0;
+
+    auto rs = std::make_unique<AudioResampler>();
+    rs->configure(kSnesRateHz, kOutHz);
+    std::vector<int16_t> in(1200 * 2);
+    makeNoise(in);
+    std::vector<int16_t> out(rs->maxOutputFrames(1200) * 2);
+
+    const double frameDt = 1.0 / kSnesFps;
+    const double callbackDt = kCallbackFrames / (kOutHz * (1.0 + deviceDrift));
+    double nextFrame = 0.0;
+    double nextCallback = callbackDt;
+    double carry = 0.0;
+    uint32_t fill = 0;
+    DriftResult r;
+    double fillSum = 0.0;
+    uint32_t fillCount = 0;
+
+    while (nextFrame < kSeconds || nextCallback < kSeconds) {
+        if (nextFrame <= nextCallback) {
+            const uint32_t n = framesThisTick(kSnesRateHz, carry);
+            if (nextFrame > kSeconds - 10.0) {
+                fillSum += fill;
+                ++fillCount;
+            }
+            rs->updateFill(fill, rateControl ? targetFrames : 0u);
+            fill += static_cast<uint32_t>(rs->process(in.data(), n, out.data(), out.size() / 2));
+            if (!rateControl && fill > capFrames) {
+                if (nextFrame > 1.0) r.dropped += fill - capFrames;
+                fill = capFrames;
+            }
+            nextFrame += frameDt;
+        } else {
+            const uint32_t take = fill < kCallbackFrames ? fill : kCallbackFrames;
+            if (nextCallback > 1.0) r.missing += kCallbackFrames - take;
+            fill -= take;
+            nextCallback += callbackDt;
+        }
+    }
+    r.endFill = fillCount ? fillSum / fillCount : 0.0;
+    r.endAdjust = rs->rateAdjust();
+    return r;
+}
+
+bool reportDrift() {
+    std::printf("\n2 min at 32040.5 -> 48000 Hz, 512-frame device callbacks (fill: mean seen by the producer over the last 10 s)\n");
+    std::printf("  %-14s %-22s %10s %10s %10s %10s\n", "device clock", "scheme", "dropped", "missing", "fill", "rate adj");
+    bool ok = true;
+    const double drifts[] = {0.003, 0.0, -0.003};
+    for (double drift : drifts) {
+        for (int rc = 0; rc < 2; ++rc) {
+            const DriftResult r = simulate(drift, rc != 0);
+            std::printf("  %+13.1f%% %-22s %10llu %10llu %10.0f %+9.3f%%\n", drift * 100.0,
+                        rc ? "rate control (1024)" : "drop-oldest (cap 2048)", static_cast<unsigned long long>(r.dropped),
+                        static_cast<unsigned long long>(r.missing), r.endFill, r.endAdjust * 100.0);
+            if (rc && (r.dropped != 0 || r.missing != 0 || std::fabs(r.endFill - 1024.0) > 102.4)) ok = false;
+        }
+    }
+    return ok;
+}
+
+} // namespace
+
+int main() {
+    reportCost();
+    const bool quality = reportQuality();
+    const bool drift = reportDrift();
+    std::printf("\n%s\n", (quality && drift) ? "PASS" : "FAIL");
+    return (quality && drift) ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+// AudioRing against the per-platform rings it replaced.
+//
+// 1. Push/pop cost for one emulated frame of audio (534 stereo frames at 32 kHz, popped in
+//    512-frame device callbacks), single-threaded: the old frame-at-a-time copy with a `%` per
+//    frame against AudioRing's two-segment memcpy.
+// 2. Two threads, 20 s of audio each way as fast as possible: the producer writes a running
+//    counter into every frame and the consumer checks it arrives in order, so a torn or reordered
+//    copy, or an index moved by the wrong side, shows up as a mismatch. With a latency cap the
+//    consumer trims, so there the check only requires increasing counters.
+//
+// Exits non-zero on any mismatch.
+//
+// Usage: snesonline_bench_audio_ring
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+
+#include "snesonline/AudioRing.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr uint32_t kFrameAudio = 534;
+constexpr uint32_t kCallbackFrames = 512;
+
+// The Windows AudioRing / Android g_audio loop before AudioRing.
+struct LegacyRing {
+    static constexpr uint32_t kCapacityFrames = 48000 * 2;
+    alignas(64) int16_t samples[kCapacityFrames * 2];
+    std::atomic<uint32_t> writeFrame{0};
+    std::atomic<uint32_t> readFrame{0};
+
+    void push(const int16_t* stereoFrames, uint32_t frameCount) noexcept {
+        uint32_t w = writeFrame.load(std::memory_order_relaxed);
+        const uint32_t r = readFrame.load(std::memory_order_acquire);
+        const uint32_t used = w - r;
+        const uint32_t freeFrames = kCapacityFrames - (used > kCapacityFrames ? kCapacityFrames : used);
+        if (frameCount > freeFrames) readFrame.store(r + (frameCount - freeFrames), std::memory_order_release);
+        for (uint32_t i = 0; i < frameCount; ++i) {
+            const uint32_t idx = (w + i) % kCapacityFrames;
+            samples[idx * 2 + 0] = stereoFrames[i * 2 + 0];
+            samples[idx * 2 + 1] = stereoFrames[i * 2 + 1];
+        }
+        writeFrame.store(w + frameCount, std::memory_order_release);
+    }
+
+    uint32_t pop(int16_t* out, uint32_t frameCount) noexcept {
+        const uint32_t r = readFrame.load(std::memory_order_relaxed);
+        const uint32_t w = writeFrame.load(std::memory_order_acquire);
+        uint32_t avail = w - r;
+        if (avail > kCapacityFrames) avail = kCapacityFrames;
+        const uint32_t n = frameCount < avail ? frameCount : avail;
+        for (uint32_t i = 0; i < n; ++i) {
+            const uint32_t idx = (r + i) % kCapacityFrames;
+            out[i * 2 + 0] = samples[idx * 2 + 0];
+            out[i * 2 + 1] = samples[idx * 2 + 1];
+        }
+        readFrame.store(r + n, std::memory_order_release);
+        return n;
+    }
+};
+
+template <typename Ring>
+void costRow(const char* name) {
+    auto ring = std::make_unique<Ring>();
+    std::vector<int16_t> in(kFrameAudio * 2, 123);
+    std::vector<int16_t> out(kCallbackFrames * 2);
+    const bench::Samples s = bench::measure(1000, 20000, [&] {
+        ring->push(in.data(), kFrameAudio);
+        while (ring->pop(out.data(), kCallbackFrames) == kCallbackFrames) {
+        }
+    });
+    bench::printRow(name, s);
+}
+
+// Left channel: low 16 bits of the frame counter, right channel: high 16 bits.
+void stamp(int16_t* f, uint32_t v) noexcept {
+    f[0] = static_cast<int16_t>(v & 0xFFFFu);
+    f[1] = static_cast<int16_t>(v >> 16);
+}
+uint32_t unstamp(const int16_t* f) noexcept {
+    return static_cast<uint32_t>(static_cast<uint16_t>(f[0])) | (static_cast<uint32_t>(static_cast<uint16_t>(f[1])) << 16);
+}
+
+bool stress(const char* name, uint32_t maxBufferedFrames) {
+    constexpr uint32_t kTotalFrames = 48000 * 20;
+    auto ring = std::make_unique<AudioRing>();
+    ring->setMaxBufferedFrames(maxBufferedFrames);
+    std::atomic<bool> done{false};
+    uint64_t mismatches = 0;
+    uint64_t received = 0;
+
+    const double t0 = bench::nowSeconds();
+    std::thread consumer([&] {
+        std::vector<int16_t> out(kCallbackFrames * 2);
+        uint32_t expect = 0;
+        for (;;) {
+            const bool finished = done.load(std::memory_order_acquire);
+            const uint32_t n = ring->pop(out.data(), kCallbackFrames);
+            for (uint32_t i = 0; i < n; ++i) {
+                const uint32_t v = unstamp(&out[i * 2]);
+                if (maxBufferedFrames == 0 ? v != expect : v < expect) ++mismatches;
+                expect = v + 1;
+            }
+            received += n;
+            if (finished && n == 0) break;
+            if (n == 0) std::this_thread::yield();
+        }
+    });
+
+    std::vector<int16_t> in(kFrameAudio * 2);
+    uint32_t next = 0;
+    while (next < kTotalFrames) {
+        const uint32_t n = (kTotalFrames - next < kFrameAudio) ? kTotalFrames - next : kFrameAudio;
+        for (uint32_t i = 0; i < n; ++i) stamp(&in[i * 2], next + i);
+        const uint32_t queued = ring->push(in.data(), n);
+        next += queued;
+        if (queued < n) std::this_thread::yield();
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+    const double secs = bench::nowSeconds() - t0;
+
+    AudioRing::Stats st;
+    ring->stats(st);
+    std::printf("  %-28s %8.1f Mframes/s  pushed %llu popped %llu overflow %llu trimmed %llu underflow %llu  mismatches %llu\n", name,
+                static_cast<double>(kTotalFrames) / secs / 1e6, static_cast<unsigned long long>(st.pushedFrames),
+                static_cast<unsigned long long>(st.poppedFrames), static_cast<unsigned long long>(st.overflowFrames),
+                static_cast<unsigned long long>(st.trimmedFrames), static_cast<unsigned long long>(st.underflowFrames),
+                static_cast<unsigned long long>(mismatches));
+    std::printf("  %-28s fill histogram (%u-frame buckets):", "", st.histogramBucketFrames);
+    for (uint64_t b : st.fillHistogram) std::printf(" %llu", static_cast<unsigned long long>(b));
+    std::printf("\n");
+    return mismatches == 0 && st.poppedFrames == received && st.poppedFrames + st.trimmedFrames == kTotalFrames;
+}
+
+} // namespace
+
+int main() {
+    std::printf("one emulated frame: push %u frames, pop in %u-frame callbacks\n", kFrameAudio, kCallbackFrames);
+    costRow<LegacyRing>("legacy ring (per-frame % copy)");
+    costRow<AudioRing>("AudioRing (two-segment memcpy)");
+
+    std::printf("\nproducer/consumer threads, %u frames\n", 48000 * 20);
+    bool ok = stress("no cap", 0);
+    ok = stress("cap 2048 frames", 2048) && ok;
+    std::printf("\n%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+// Audio delivery cost for the two libretro audio callbacks, with a sink that pushes into an
+// AudioRing like the platform front-ends do. The mock core is loaded twice: once using
+// retro_audio_sample_batch, once using retro_audio_sample (SNESONLINE_MOCK_AUDIO_SINGLE=1), with no
+// emulation work so the audio path dominates.
+//
+// Rows:
+//  - batch callback: one sink call per frame;
+//  - single-sample callback: LibretroCore gathers the samples and flushes them once per frame;
+//  - one sink call per sample: what the single-sample path did before, replayed directly.
+//
+// Also checks that both callbacks deliver identical audio, and that the single-sample path makes
+// one sink call per frame. Exits non-zero if either check fails.
+//
+// Usage: snesonline_bench_audio_sample [frames=5000]
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "BenchUtil.h"
+
+#include "snesonline/AudioRing.h"
+#include "snesonline/EmulatorEngine.h"
+#include "snesonline/Hash.h"
+
+using namespace snesonline;
+
+namespace {
+
+struct Sink {
+    AudioRing ring;
+    uint64_t calls = 0;
+    uint64_t frames = 0;
+};
+
+std::size_t audioSink(void* ctx, const int16_t* stereoFrames, std::size_t frameCount) noexcept {
+    auto* s = static_cast<Sink*>(ctx);
+    s->ring.push(stereoFrames, static_cast<uint32_t>(frameCount));
+    s->calls++;
+    s->frames += frameCount;
+    return frameCount;
+}
+
+// Same samples, one sink call each (the old single-sample path).
+std::size_t perSampleSink(void* ctx, const int16_t* stereoFrames, std::size_t frameCount) noexcept {
+    for (std::size_t i = 0; i < frameCount; ++i) audioSink(ctx, stereoFrames + i * 2, 1);
+    return frameCount;
+}
+
+void setEnv(const char* name, const char* value) {
+#if defined(_WIN32)
+    _putenv_s(name, value);
+#else
+    setenv(name, value, 1);
+#endif
+}
+
+bool loadCore(EmulatorEngine& eng, bool single) {
+    setEnv("SNESONLINE_MOCK_AUDIO_SINGLE", single ? "1" : "0");
+    setEnv("SNESONLINE_MOCK_CPU_ITERS", "0");
+    return bench::loadMockCore(eng);
+}
+
+void drain(Sink& s, std::vector<int16_t>& buf) {
+    while (s.ring.pop(buf.data(), 4096) == 4096) {
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int frames = (argc > 1) ? std::atoi(argv[1]) : 5000;
+
+    // The mock reads its tunables when loaded; the second load gets a private copy of the library.
+    EmulatorEngine batchEng;
+    EmulatorEngine singleEng;
+    if (!loadCore(batchEng, false) || !loadCore(singleEng, true)) return 1;
+
+    std::vector<int16_t> buf(4096 * 2);
+    bool ok = true;
+
+    struct Row {
+        const char* name;
+        EmulatorEngine* eng;
+        LibretroCore::AudioSampleBatchFn fn;
+    };
+    const Row rows[] = {
+        {"batch callback", &batchEng, &audioSink},
+        {"single-sample, flushed per frame", &singleEng, &audioSink},
+        {"one sink call per sample (before)", &batchEng, &perSampleSink},
+    };
+
+    std::printf("%d frames per row, audio at %.0f Hz\n", frames, batchEng.core().sampleRateHz());
+    for (const Row& r : rows) {
+        auto sink = std::make_unique<Sink>();
+        SaveState start;
+        if (!r.eng->saveState(start)) return 1;
+        r.eng->core().setAudioSink(sink.get(), r.fn);
+
+        const bench::Samples s = bench::measure(0, frames, [&] {
+            r.eng->advanceFrame(FrameOutput::AudioOnly);
+            drain(*sink, buf);
+        });
+        (void)r.eng->loadState(start);
+        r.eng->core().setAudioSink(nullptr, nullptr);
+
+        bench::printRow(r.name, s);
+        std::printf("  %-38s %.1f sink calls per frame, %.1f samples per frame\n", "", static_cast<double>(sink->calls) / frames,
+                    static_cast<double>(sink->frames) / frames);
+        if (r.eng == &singleEng) ok = ok && sink->calls == static_cast<uint64_t>(frames);
+    }
+
+    // Same audio from both callbacks, sample for sample.
+    {
+        Sink a;
+        Sink b;
+        batchEng.core().setAudioSink(&a, &audioSink);
+        singleEng.core().setAudioSink(&b, &audioSink);
+        std::vector<int16_t> pa(4096 * 2);
+        std::vector<int16_t> pb(4096 * 2);
+        uint32_t mismatches = 0;
+        for (int f = 0; f < 600; ++f) {
+            batchEng.advanceFrame(FrameOutput::AudioOnly);
+            singleEng.advanceFrame(FrameOutput::AudioOnly);
+            const uint32_t na = a.ring.pop(pa.data(), 4096);
+            const uint32_t nb = b.ring.pop(pb.data(), 4096);
+            if (na != nb || stateHash64(pa.data(), na * 2 * sizeof(int16_t)) != stateHash64(pb.data(), nb * 2 * sizeof(int16_t))) mismatches++;
+        }
+        std::printf("\nsingle-sample vs batch audio: %u/600 frames differ\n", mismatches);
+        ok = ok && mismatches == 0;
+        batchEng.core().setAudioSink(nullptr, nullptr);
+        singleEng.core().setAudioSink(nullptr, nullptr);
+    }
+
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,429 @@
+// Savestate/SRAM transfer: BulkSender/BulkReceiver against the legacy chunk cycling.
+//
+// Both run at the pace the mobile frame loop drives them (one pump per 60 Hz frame on each side)
+// over real UDP sockets through the loopback impairment proxy (tools/netem), transferring the mock
+// core's savestate. The legacy scheme sends 6 x 1 KiB chunks per frame round-robin until the
+// receiver reports that it has everything, so a lost chunk costs a whole cycle.
+//
+// First it reports the LZ ratio (snesonline/Lz.h) and encode/decode cost for the mock core's
+// savestate and SRAM and for any savestate/SRAM files given on the command line (e.g. ones saved
+// by the app on a real core). Then, per profile, the time to a complete, CRC-checked blob (for
+// "bulk+lz" including compression and decompression), datagrams and bytes sent, retransmissions
+// and the datagram size the sender settled on. Then it checks that a corrupted datagram is
+// recovered from, and finally it sends the savestate through LockstepSession::sendBulk() while the
+// match runs. A clean LAN transfer must finish in well under a second; any failure makes the
+// process exit non-zero.
+//
+// Usage: snesonline_bench_bulk_transfer [seed=1] [savestate or SRAM file ...]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "NetSocket.h"
+#include "NetemProxy.h"
+
+#include "snesonline/BulkTransfer.h"
+#include "snesonline/Hash.h"
+#include "snesonline/LockstepSession.h"
+#include "snesonline/Lz.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr uint16_t kPortA = 47400;
+constexpr uint16_t kPortB = 47401;
+constexpr uint16_t kProxyForA = 47402;
+constexpr uint16_t kProxyForB = 47403;
+
+constexpr double kCleanLimitSeconds = 0.5;
+constexpr double kTimeoutSeconds = 30.0;
+
+constexpr std::size_t kLegacyChunkBytes = 1024;
+constexpr std::size_t kLegacyChunksPerFrame = 6;
+
+struct Profile {
+    const char* name;
+    netem::Impairment imp;
+};
+
+struct Result {
+    double seconds = -1.0;
+    uint64_t datagrams = 0;
+    uint64_t bytes = 0;
+    uint64_t retransmits = 0;
+    std::size_t datagramBytes = 0;
+};
+
+netem::Impairment impairment(uint32_t latencyMs, uint32_t jitterMs, double lossPct) {
+    netem::Impairment imp;
+    imp.latencyMs = latencyMs;
+    imp.jitterMs = jitterMs;
+    imp.lossPct = lossPct;
+    return imp;
+}
+
+// Compressed size and median encode/decode time of one blob; false if it does not round-trip.
+bool reportCodec(const char* name, const std::vector<uint8_t>& raw) {
+    std::vector<uint8_t> packed(lzMaxCompressedSize(raw.size()));
+    std::vector<uint8_t> back(raw.size());
+    std::size_t packedBytes = 0;
+    std::size_t rawBytes = 0;
+    const bench::Samples c = bench::measure(2, 20, [&] { packedBytes = lzCompress(raw.data(), raw.size(), packed.data(), packed.size()); });
+    const bench::Samples d = bench::measure(2, 20, [&] { rawBytes = lzDecompress(packed.data(), packedBytes, back.data(), back.size()); });
+    const bool same = packedBytes != 0 && rawBytes == raw.size() && back == raw;
+    std::printf("%-24s %9zu %9zu %6.1fx %9.2f %9.2f %s\n", name, raw.size(), packedBytes,
+                static_cast<double>(raw.size()) / static_cast<double>(packedBytes ? packedBytes : 1), c.percentile(0.5) * 1e-6,
+                d.percentile(0.5) * 1e-6, same ? "" : "MISMATCH");
+    return same;
+}
+
+bool readFile(const char* path, std::vector<uint8_t>& out) {
+    std::FILE* f = std::fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buf[64 * 1024];
+    std::size_t n = 0;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    std::fclose(f);
+    return !out.empty();
+}
+
+// Two sockets talking to each other through the proxy, pumped half a frame apart.
+struct Link {
+    netem::NetemProxy proxy;
+    net::SocketHandle a = net::kInvalidSocket;
+    net::SocketHandle b = net::kInvalidSocket;
+    sockaddr_in toB{}; // where A sends
+    sockaddr_in toA{}; // where B sends
+
+    bool open(const netem::Impairment& imp, uint32_t seed) {
+        netem::NetemProxy::Config pc{};
+        pc.listenPortA = kProxyForA;
+        pc.peerPortA = kPortA;
+        pc.listenPortB = kProxyForB;
+        pc.peerPortB = kPortB;
+        pc.seed = seed;
+        if (!proxy.open(pc)) return false;
+        proxy.setImpairment(imp);
+        if (!proxy.start()) return false;
+        if (!net::openUdpSocket(kPortA, a) || !net::openUdpSocket(kPortB, b)) return false;
+        return net::resolveIpv4ToSockaddr("127.0.0.1", toB, kProxyForA) && net::resolveIpv4ToSockaddr("127.0.0.1", toA, kProxyForB);
+    }
+
+    ~Link() {
+        proxy.stop();
+        proxy.close();
+        net::closeSocket(a);
+        net::closeSocket(b);
+    }
+};
+
+// Calls frameA()/frameB() at 60 Hz, half a frame apart, until both report done or the timeout.
+template <typename FnA, typename FnB>
+double runFrames(FnA&& frameA, FnB&& frameB) {
+    using namespace std::chrono;
+    const auto halfFrame = microseconds(8333);
+    const auto t0 = bench::Clock::now();
+    auto next = t0;
+    bool tickA = true;
+    while (duration<double>(bench::Clock::now() - t0).count() < kTimeoutSeconds) {
+        std::this_thread::sleep_until(next);
+        next += halfFrame;
+        const bool done = tickA ? frameA() : frameB();
+        if (done) return duration<double>(bench::Clock::now() - t0).count();
+        tickA = !tickA;
+    }
+    return -1.0;
+}
+
+// With `lz`, the sender compresses the blob first and the receiver decompresses it on arrival, as
+// the mobile state/SRAM sync does; both are inside the measured time.
+bool runBulk(const Profile& p, const std::vector<uint8_t>& blob, bool lz, uint32_t seed, Result& r) {
+    Link link;
+    if (!link.open(p.imp, seed)) return false;
+
+    BulkSender sender;
+    BulkReceiver receiver;
+    std::vector<uint8_t> got;
+    bool received = false;
+    const auto t0 = bench::Clock::now();
+    if (lz) {
+        std::vector<uint8_t> packed(lzMaxCompressedSize(blob.size()));
+        const std::size_t packedBytes = lzCompress(blob.data(), blob.size(), packed.data(), packed.size());
+        if (packedBytes == 0 || !sender.begin(1, packed.data(), packedBytes)) return false;
+    } else if (!sender.begin(1, blob.data(), blob.size())) {
+        return false;
+    }
+
+    auto frameA = [&] {
+        uint8_t buf[kBulkMaxDatagramBytes];
+        sockaddr_in from{};
+        int n = 0;
+        const auto now = bench::Clock::now();
+        while ((n = net::recvFrom(link.a, buf, sizeof(buf), from)) > 0) sender.onDatagram(buf, static_cast<std::size_t>(n), now);
+        BulkDatagram out[kBulkMaxBatch];
+        const std::size_t count = sender.poll(now, out, kBulkMaxBatch);
+        (void)sendBulkDatagrams(static_cast<std::intptr_t>(link.a), out, count, &link.toB, sizeof(link.toB));
+        return sender.done() && received;
+    };
+    auto frameB = [&] {
+        uint8_t buf[kBulkMaxDatagramBytes];
+        sockaddr_in from{};
+        int n = 0;
+        const auto now = bench::Clock::now();
+        while ((n = net::recvFrom(link.b, buf, sizeof(buf), from)) > 0) {
+            if (!receiver.onDatagram(buf, static_cast<std::size_t>(n), now)) continue;
+            if (lz) {
+                got.assign(blob.size(), 0u);
+                if (lzDecompress(receiver.data().data(), receiver.data().size(), got.data(), got.size()) != blob.size()) got.clear();
+            } else {
+                got = receiver.data();
+            }
+            received = true;
+        }
+        uint8_t ack[kBulkMaxAckBytes];
+        const std::size_t ackBytes = receiver.pollAck(now, ack, sizeof(ack));
+        if (ackBytes != 0) (void)net::sendTo(link.b, ack, ackBytes, link.toA);
+        return sender.done() && received;
+    };
+
+    // The receiver has the blob once `received`; the sender's last ack may still be on its way.
+    double receivedAt = -1.0;
+    const double total = runFrames(
+        [&] { return frameA(); },
+        [&] {
+            const bool done = frameB();
+            if (received && receivedAt < 0.0) receivedAt = std::chrono::duration<double>(bench::Clock::now() - t0).count();
+            return done;
+        });
+    if (total < 0.0 || got != blob) return false;
+    r.seconds = receivedAt;
+    r.datagrams = sender.sentDatagramCount();
+    r.bytes = sender.sentByteCount();
+    r.retransmits = sender.retransmitCount();
+    r.datagramBytes = sender.datagramBytes();
+    return true;
+}
+
+// Legacy: u16 index + 1 KiB payload, 6 chunks per frame round-robin; the receiver answers a
+// 4-byte "done" once it has every chunk.
+bool runLegacy(const Profile& p, const std::vector<uint8_t>& blob, uint32_t seed, Result& r) {
+    Link link;
+    if (!link.open(p.imp, seed)) return false;
+
+    const std::size_t chunks = (blob.size() + kLegacyChunkBytes - 1) / kLegacyChunkBytes;
+    std::vector<uint8_t> got(blob.size());
+    std::vector<bool> have(chunks, false);
+    std::size_t haveCount = 0;
+    std::size_t cursor = 0;
+    bool senderDone = false;
+    bool received = false;
+    double receivedAt = -1.0;
+    const auto t0 = bench::Clock::now();
+
+    auto frameA = [&] {
+        uint8_t buf[64];
+        sockaddr_in from{};
+        while (net::recvFrom(link.a, buf, sizeof(buf), from) > 0) senderDone = true;
+        if (!senderDone) {
+            for (std::size_t i = 0; i < kLegacyChunksPerFrame; ++i) {
+                uint8_t pkt[2 + kLegacyChunkBytes];
+                const std::size_t off = cursor * kLegacyChunkBytes;
+                const std::size_t len = std::min(kLegacyChunkBytes, blob.size() - off);
+                pkt[0] = static_cast<uint8_t>(cursor >> 8);
+                pkt[1] = static_cast<uint8_t>(cursor);
+                std::memcpy(pkt + 2, blob.data() + off, len);
+                if (net::sendTo(link.a, pkt, 2 + len, link.toB)) {
+                    r.datagrams++;
+                    r.bytes += 2 + len;
+                }
+                cursor = (cursor + 1) % chunks;
+            }
+        }
+        return senderDone && received;
+    };
+    auto frameB = [&] {
+        uint8_t buf[2 + kLegacyChunkBytes];
+        sockaddr_in from{};
+        int n = 0;
+        while ((n = net::recvFrom(link.b, buf, sizeof(buf), from)) > 2) {
+            const std::size_t idx = (static_cast<std::size_t>(buf[0]) << 8) | buf[1];
+            if (idx >= chunks || have[idx]) continue;
+            std::memcpy(got.data() + idx * kLegacyChunkBytes, buf + 2, static_cast<std::size_t>(n) - 2);
+            have[idx] = true;
+            haveCount++;
+        }
+        if (haveCount == chunks) {
+            if (!received) receivedAt = std::chrono::duration<double>(bench::Clock::now() - t0).count();
+            received = true;
+            const uint8_t done[4] = {'D', 'O', 'N', 'E'};
+            (void)net::sendTo(link.b, done, sizeof(done), link.toA);
+        }
+        return senderDone && received;
+    };
+
+    if (runFrames(frameA, frameB) < 0.0 || got != blob) return false;
+    r.seconds = receivedAt;
+    r.retransmits = r.datagrams > chunks ? r.datagrams - chunks : 0;
+    r.datagramBytes = 2 + kLegacyChunkBytes;
+    return true;
+}
+
+// One data datagram has a payload byte flipped (the UDP checksum is optional over IPv4 and is not
+// end to end), so the blob fails its CRC after the sender has every byte acked. The receiver's
+// restart flag must get the whole blob sent again. Sender and receiver exchange datagrams directly,
+// one round trip per step.
+bool runCorrupted(const std::vector<uint8_t>& blob) {
+    BulkSender sender;
+    BulkReceiver receiver;
+    if (!sender.begin(1, blob.data(), blob.size())) return false;
+
+    auto now = bench::Clock::now();
+    bool corrupted = false;
+    bool received = false;
+    int steps = 0;
+    for (; steps < 1000 && !(received && sender.done()); ++steps) {
+        now += std::chrono::milliseconds(10);
+        BulkDatagram out[kBulkMaxBatch];
+        const std::size_t count = sender.poll(now, out, kBulkMaxBatch);
+        for (std::size_t i = 0; i < count; ++i) {
+            uint8_t buf[kBulkMaxDatagramBytes];
+            std::memcpy(buf, out[i].data, out[i].sizeBytes);
+            if (!corrupted && out[i].sizeBytes > kBulkDataHeaderBytes) {
+                buf[kBulkDataHeaderBytes] ^= 0x5Au;
+                corrupted = true;
+            }
+            if (receiver.onDatagram(buf, out[i].sizeBytes, now)) received = true;
+        }
+        uint8_t ack[kBulkMaxAckBytes];
+        const std::size_t ackBytes = receiver.pollAck(now, ack, sizeof(ack));
+        if (ackBytes != 0) sender.onDatagram(ack, ackBytes, now);
+    }
+
+    const bool ok = received && sender.done() && receiver.data() == blob && sender.restartCount() == 1;
+    std::printf("corrupted datagram: %s after %llu restart(s), %d round trips\n", ok ? "recovered" : "FAILED",
+                static_cast<unsigned long long>(sender.restartCount()), steps);
+    return ok;
+}
+
+// The savestate rides along a running lockstep match (direct, no proxy).
+bool runSession(const std::vector<uint8_t>& blob) {
+    EmulatorEngine engA;
+    EmulatorEngine engB;
+    if (!bench::loadMockCore(engA) || !bench::loadMockCore(engB)) return false;
+
+    LockstepSession a;
+    LockstepSession b;
+    LockstepSession::Config ca{};
+    ca.remoteHost = "127.0.0.1";
+    ca.remotePort = kPortB;
+    ca.localPort = kPortA;
+    ca.localPlayerNum = 1;
+    ca.inputDelayFrames = 2;
+    ca.engine = &engA;
+    LockstepSession::Config cb = ca;
+    cb.remotePort = kPortA;
+    cb.localPort = kPortB;
+    cb.localPlayerNum = 2;
+    cb.engine = &engB;
+    if (!a.start(ca) || !b.start(cb)) {
+        std::fprintf(stderr, "session start failed\n");
+        return false;
+    }
+    if (!a.sendBulk(2, blob.data(), blob.size())) return false;
+
+    std::vector<uint8_t> got;
+    const double seconds = runFrames(
+        [&] {
+            a.setLocalInput(static_cast<uint16_t>(a.localFrame() * 7u));
+            a.tickUntil(bench::Clock::now() + std::chrono::microseconds(8333));
+            return a.bulkSendDone(2) && !got.empty();
+        },
+        [&] {
+            b.setLocalInput(static_cast<uint16_t>(b.localFrame() * 3u));
+            b.tickUntil(bench::Clock::now() + std::chrono::microseconds(8333));
+            if (got.empty()) (void)b.takeReceivedBulk(2, got);
+            return a.bulkSendDone(2) && !got.empty();
+        });
+    const uint32_t framesA = a.localFrame();
+    const uint32_t framesB = b.localFrame();
+    a.stop();
+    b.stop();
+
+    const bool ok = seconds >= 0.0 && got == blob;
+    std::printf("lockstep sendBulk: %s in %.0f ms while the match ran (%u / %u frames)\n", ok ? "delivered" : "FAILED",
+                seconds * 1000.0, framesA, framesB);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const uint32_t seed = (argc > 1) ? static_cast<uint32_t>(std::atoi(argv[1])) : 1u;
+
+    EmulatorEngine eng;
+    if (!bench::loadMockCore(eng)) return 1;
+    for (int i = 0; i < 30; ++i) eng.advanceFrame();
+    SaveState st;
+    if (!eng.saveState(st)) return 1;
+    const uint8_t* state = static_cast<const uint8_t*>(st.buffer.data());
+    const std::vector<uint8_t> blob(state, state + st.sizeBytes);
+
+    bool ok = true;
+    std::printf("%-24s %9s %9s %7s %9s %9s\n", "LZ codec", "raw B", "packed B", "ratio", "enc ms", "dec ms");
+    ok = reportCodec("mock savestate", blob) && ok;
+    const uint8_t* sram = static_cast<const uint8_t*>(eng.core().memoryData(0));
+    const std::size_t sramBytes = eng.core().memorySize(0);
+    if (sram && sramBytes != 0) ok = reportCodec("mock SRAM", std::vector<uint8_t>(sram, sram + sramBytes)) && ok;
+    for (int i = 2; i < argc; ++i) {
+        std::vector<uint8_t> file;
+        if (!readFile(argv[i], file)) {
+            std::printf("%-24s cannot read\n", argv[i]);
+            ok = false;
+            continue;
+        }
+        const char* base = std::strrchr(argv[i], '/');
+        ok = reportCodec(base ? base + 1 : argv[i], file) && ok;
+    }
+
+    std::printf("\nsavestate: %zu B (crc %08x), one pump per 60 Hz frame on each side\n\n", blob.size(),
+                crc32(blob.data(), blob.size()));
+
+    const Profile profiles[] = {
+        {"clean LAN", impairment(0, 0, 0.0)},
+        {"RTT 20 ms, 1% loss", impairment(10, 0, 1.0)},
+        {"RTT 50 ms, 5% loss", impairment(25, 5, 5.0)},
+    };
+
+    std::printf("%-20s %-7s %9s %10s %11s %9s %9s\n", "profile", "scheme", "time ms", "datagrams", "bytes", "resent", "dgram B");
+    for (const Profile& p : profiles) {
+        static const char* const kSchemes[] = {"bulk+lz", "bulk", "legacy"};
+        for (int scheme = 0; scheme < 3; ++scheme) {
+            Result r;
+            const bool ran = (scheme == 2) ? runLegacy(p, blob, seed, r) : runBulk(p, blob, scheme == 0, seed, r);
+            if (!ran) {
+                std::printf("%-20s %-7s FAILED (timed out or corrupt)\n", p.name, kSchemes[scheme]);
+                ok = false;
+                continue;
+            }
+            std::printf("%-20s %-7s %9.0f %10llu %11llu %9llu %9zu\n", p.name, kSchemes[scheme], r.seconds * 1000.0,
+                        static_cast<unsigned long long>(r.datagrams), static_cast<unsigned long long>(r.bytes),
+                        static_cast<unsigned long long>(r.retransmits), r.datagramBytes);
+            if (scheme != 2 && &p == &profiles[0] && r.seconds > kCleanLimitSeconds) {
+                std::printf("  clean LAN transfer took longer than %.0f ms\n", kCleanLimitSeconds * 1000.0);
+                ok = false;
+            }
+        }
+    }
+    std::printf("\n");
+
+    ok = runCorrupted(blob) && ok;
+    ok = runSession(blob) && ok;
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,297 @@
+// Desync recovery: block-hash delta resync (StateDelta.h) against resending the whole savestate
+// (LZ-compressed bulk transfer, what the mobile resync did before).
+//
+// The host has the mock core's savestate; the joiner has a state that differs from it by:
+//   - a few scattered bytes (a handful of game variables diverged),
+//   - one 2 KiB region (e.g. an object table),
+//   - one mock-core frame (the mock's "CPU" rewrites nearly all of its 128 KiB WRAM every frame,
+//     far more than a real game, so this is close to the worst case),
+//   - nothing in common (a power-on state).
+// Both sides are pumped once per 60 Hz frame over real UDP sockets through the loopback impairment
+// proxy (tools/netem). Per case it reports the time until the joiner holds the host's exact state,
+// bytes sent each way and the blocks fetched. Any failure makes the process exit non-zero, as does
+// a delta resync of the small desyncs that is not well below the cost of a full transfer.
+//
+// Usage: snesonline_bench_delta_resync [seed=1]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "NetSocket.h"
+#include "NetemProxy.h"
+
+#include "snesonline/BulkTransfer.h"
+#include "snesonline/Hash.h"
+#include "snesonline/Lz.h"
+#include "snesonline/StateDelta.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr uint16_t kPortA = 47410;
+constexpr uint16_t kPortB = 47411;
+constexpr uint16_t kProxyForA = 47412;
+constexpr uint16_t kProxyForB = 47413;
+
+constexpr uint8_t kChannel = 3;
+constexpr double kTimeoutSeconds = 30.0;
+// Small desyncs must cost at most this fraction of the full transfer's bytes.
+constexpr double kMaxSmallDesyncByteRatio = 0.1;
+
+struct Profile {
+    const char* name;
+    netem::Impairment imp;
+};
+
+struct Result {
+    double seconds = -1.0;
+    uint64_t bytesDown = 0; // host -> joiner
+    uint64_t bytesUp = 0;   // joiner -> host
+    uint32_t blocks = 0;
+};
+
+netem::Impairment impairment(uint32_t latencyMs, uint32_t jitterMs, double lossPct) {
+    netem::Impairment imp;
+    imp.latencyMs = latencyMs;
+    imp.jitterMs = jitterMs;
+    imp.lossPct = lossPct;
+    return imp;
+}
+
+// Host socket A and joiner socket B talking through the proxy.
+struct Link {
+    netem::NetemProxy proxy;
+    net::SocketHandle a = net::kInvalidSocket;
+    net::SocketHandle b = net::kInvalidSocket;
+    sockaddr_in toB{};
+    sockaddr_in toA{};
+
+    bool open(const netem::Impairment& imp, uint32_t seed) {
+        netem::NetemProxy::Config pc{};
+        pc.listenPortA = kProxyForA;
+        pc.peerPortA = kPortA;
+        pc.listenPortB = kProxyForB;
+        pc.peerPortB = kPortB;
+        pc.seed = seed;
+        if (!proxy.open(pc)) return false;
+        proxy.setImpairment(imp);
+        if (!proxy.start()) return false;
+        if (!net::openUdpSocket(kPortA, a) || !net::openUdpSocket(kPortB, b)) return false;
+        return net::resolveIpv4ToSockaddr("127.0.0.1", toB, kProxyForA) && net::resolveIpv4ToSockaddr("127.0.0.1", toA, kProxyForB);
+    }
+
+    ~Link() {
+        proxy.stop();
+        proxy.close();
+        net::closeSocket(a);
+        net::closeSocket(b);
+    }
+};
+
+uint64_t send(net::SocketHandle s, const BulkDatagram* d, std::size_t count, const sockaddr_in& to) {
+    uint64_t bytes = 0;
+    for (std::size_t i = 0; i < count; ++i) bytes += d[i].sizeBytes;
+    (void)sendBulkDatagrams(static_cast<std::intptr_t>(s), d, count, &to, sizeof(to));
+    return bytes;
+}
+
+// Calls host()/joiner() at 60 Hz, half a frame apart, until joiner() reports done or the timeout.
+template <typename FnA, typename FnB>
+double runFrames(FnA&& host, FnB&& joiner) {
+    using namespace std::chrono;
+    const auto halfFrame = microseconds(8333);
+    const auto t0 = bench::Clock::now();
+    auto next = t0;
+    bool tickHost = true;
+    while (duration<double>(bench::Clock::now() - t0).count() < kTimeoutSeconds) {
+        std::this_thread::sleep_until(next);
+        next += halfFrame;
+        if (tickHost) {
+            host();
+        } else if (joiner()) {
+            return duration<double>(bench::Clock::now() - t0).count();
+        }
+        tickHost = !tickHost;
+    }
+    return -1.0;
+}
+
+// The host offers every 250 ms, like the mobile 'SNOS' offer it rides along with.
+bool runDelta(const Profile& p, const std::vector<uint8_t>& target, const std::vector<uint8_t>& base, uint32_t seed, Result& r) {
+    Link link;
+    if (!link.open(p.imp, seed)) return false;
+
+    DeltaSyncHost host;
+    DeltaSyncJoiner joiner;
+    if (!host.begin(kChannel, target.data(), target.size())) return false;
+    bench::Clock::time_point lastOffer{};
+
+    auto hostFrame = [&] {
+        uint8_t buf[kBulkMaxDatagramBytes];
+        sockaddr_in from{};
+        int n = 0;
+        const auto now = bench::Clock::now();
+        while ((n = net::recvFrom(link.a, buf, sizeof(buf), from)) > 0) host.onDatagram(buf, static_cast<std::size_t>(n), now);
+        if (lastOffer.time_since_epoch().count() == 0 || now - lastOffer >= std::chrono::milliseconds(250)) {
+            uint8_t offer[kDeltaOfferBytes];
+            const std::size_t len = host.writeOffer(offer, sizeof(offer));
+            if (len != 0 && net::sendTo(link.a, offer, len, link.toB)) r.bytesDown += len;
+            lastOffer = now;
+        }
+        BulkDatagram out[kBulkMaxBatch];
+        r.bytesDown += send(link.a, out, host.poll(now, out, kBulkMaxBatch), link.toB);
+    };
+    auto joinerFrame = [&] {
+        uint8_t buf[kBulkMaxDatagramBytes];
+        sockaddr_in from{};
+        int n = 0;
+        const auto now = bench::Clock::now();
+        while ((n = net::recvFrom(link.b, buf, sizeof(buf), from)) > 0) {
+            if (n >= 4 && std::memcmp(buf, "SNOT", 4) == 0) {
+                if (!joiner.isCurrentOffer(buf, static_cast<std::size_t>(n))) {
+                    (void)joiner.begin(kChannel, buf, static_cast<std::size_t>(n), base.data(), base.size());
+                }
+                continue;
+            }
+            (void)joiner.onDatagram(buf, static_cast<std::size_t>(n), now);
+        }
+        BulkDatagram out[kBulkMaxBatch];
+        r.bytesUp += send(link.b, out, joiner.poll(now, out, kBulkMaxBatch), link.toA);
+        return joiner.complete();
+    };
+
+    r.seconds = runFrames(hostFrame, joinerFrame);
+    r.blocks = joiner.blocksRequested();
+    return r.seconds >= 0.0 && joiner.state() == target;
+}
+
+// The whole state, LZ-compressed, as one bulk transfer.
+bool runFull(const Profile& p, const std::vector<uint8_t>& target, uint32_t seed, Result& r) {
+    Link link;
+    if (!link.open(p.imp, seed)) return false;
+
+    std::vector<uint8_t> packed(lzMaxCompressedSize(target.size()));
+    BulkSender sender;
+    BulkReceiver receiver;
+    std::vector<uint8_t> got;
+    const auto t0 = bench::Clock::now();
+    const std::size_t packedBytes = lzCompress(target.data(), target.size(), packed.data(), packed.size());
+    if (packedBytes == 0 || !sender.begin(kChannel, packed.data(), packedBytes)) return false;
+
+    auto hostFrame = [&] {
+        uint8_t buf[kBulkMaxDatagramBytes];
+        sockaddr_in from{};
+        int n = 0;
+        const auto now = bench::Clock::now();
+        while ((n = net::recvFrom(link.a, buf, sizeof(buf), from)) > 0) sender.onDatagram(buf, static_cast<std::size_t>(n), now);
+        BulkDatagram out[kBulkMaxBatch];
+        r.bytesDown += send(link.a, out, sender.poll(now, out, kBulkMaxBatch), link.toB);
+    };
+    auto joinerFrame = [&] {
+        uint8_t buf[kBulkMaxDatagramBytes];
+        sockaddr_in from{};
+        int n = 0;
+        const auto now = bench::Clock::now();
+        while ((n = net::recvFrom(link.b, buf, sizeof(buf), from)) > 0) {
+            if (!receiver.onDatagram(buf, static_cast<std::size_t>(n), now)) continue;
+            got.assign(target.size(), 0u);
+            if (lzDecompress(receiver.data().data(), receiver.data().size(), got.data(), got.size()) != target.size()) got.clear();
+        }
+        uint8_t ack[kBulkMaxAckBytes];
+        const std::size_t ackBytes = receiver.pollAck(now, ack, sizeof(ack));
+        if (ackBytes != 0 && net::sendTo(link.b, ack, ackBytes, link.toA)) r.bytesUp += ackBytes;
+        return !got.empty();
+    };
+
+    const double seconds = runFrames(hostFrame, joinerFrame);
+    r.seconds = (seconds < 0.0) ? -1.0 : std::chrono::duration<double>(bench::Clock::now() - t0).count();
+    r.blocks = static_cast<uint32_t>((target.size() + kDeltaBlockBytes - 1) / kDeltaBlockBytes);
+    return seconds >= 0.0 && got == target;
+}
+
+struct Case {
+    const char* name;
+    std::vector<uint8_t> base;
+    bool small; // must beat the full transfer by kMaxSmallDesyncByteRatio
+};
+
+std::vector<uint8_t> serialize(EmulatorEngine& eng) {
+    SaveState st;
+    if (!eng.saveState(st)) return {};
+    const uint8_t* p = static_cast<const uint8_t*>(st.buffer.data());
+    return std::vector<uint8_t>(p, p + st.sizeBytes);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const uint32_t seed = (argc > 1) ? static_cast<uint32_t>(std::atoi(argv[1])) : 1u;
+
+    EmulatorEngine eng;
+    if (!bench::loadMockCore(eng)) return 1;
+    const std::vector<uint8_t> powerOn = serialize(eng);
+    for (uint32_t f = 0; f < 120; ++f) {
+        eng.setInputMask(0, static_cast<uint16_t>(f * 7u));
+        eng.advanceFrame();
+    }
+    const std::vector<uint8_t> previous = serialize(eng);
+    eng.advanceFrame();
+    const std::vector<uint8_t> target = serialize(eng);
+    if (target.empty() || previous.size() != target.size() || powerOn.size() != target.size()) return 1;
+
+    std::vector<Case> cases;
+    cases.push_back({"8 bytes differ", target, true});
+    uint32_t x = seed * 2654435761u + 1u;
+    for (int i = 0; i < 8; ++i) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        cases.back().base[16 + x % (128u * 1024u)] ^= 0xA5u;
+    }
+    cases.push_back({"2 KiB region differs", target, true});
+    for (std::size_t i = 0; i < 2048; ++i) cases.back().base[40000 + i] ^= static_cast<uint8_t>(i * 13u + 1u);
+    cases.push_back({"1 mock frame apart", previous, false});
+    cases.push_back({"power-on state", powerOn, false});
+
+    const Profile profiles[] = {
+        {"clean LAN", impairment(0, 0, 0.0)},
+        {"RTT 50 ms, 2% loss", impairment(25, 5, 2.0)},
+    };
+
+    std::printf("state %zu B, %u-byte blocks, fanout %u, one pump per 60 Hz frame on each side\n\n", target.size(), kDeltaBlockBytes,
+                kDeltaFanout);
+    std::printf("%-20s %-22s %-6s %8s %10s %8s %7s\n", "profile", "desync", "scheme", "time ms", "down B", "up B", "blocks");
+    bool ok = true;
+    for (const Profile& p : profiles) {
+        Result full;
+        if (!runFull(p, target, seed, full)) {
+            std::printf("%-20s %-22s %-6s FAILED\n", p.name, "(any)", "full");
+            ok = false;
+            continue;
+        }
+        std::printf("%-20s %-22s %-6s %8.0f %10llu %8llu %7u\n", p.name, "(any)", "full", full.seconds * 1000.0,
+                    static_cast<unsigned long long>(full.bytesDown), static_cast<unsigned long long>(full.bytesUp), full.blocks);
+        for (const Case& c : cases) {
+            Result r;
+            if (!runDelta(p, target, c.base, seed, r)) {
+                std::printf("%-20s %-22s %-6s FAILED (timed out or wrong state)\n", p.name, c.name, "delta");
+                ok = false;
+                continue;
+            }
+            std::printf("%-20s %-22s %-6s %8.0f %10llu %8llu %7u\n", p.name, c.name, "delta", r.seconds * 1000.0,
+                        static_cast<unsigned long long>(r.bytesDown), static_cast<unsigned long long>(r.bytesUp), r.blocks);
+            const double ratio = static_cast<double>(r.bytesDown + r.bytesUp) / static_cast<double>(full.bytesDown + full.bytesUp);
+            if (c.small && ratio > kMaxSmallDesyncByteRatio) {
+                std::printf("  %.0f%% of a full transfer\n", ratio * 100.0);
+                ok = false;
+            }
+        }
+    }
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
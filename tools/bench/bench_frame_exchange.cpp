@@ -0,0 +1,165 @@
+// Torn-frame stress test for FrameExchange against the single shared buffer the Android/iOS
+// front-ends used before (pixels written in place, then width/height/sequence stored).
+//
+// A producer thread publishes frames as fast as it can, alternating 256x224 and 512x448, with
+// every pixel set to the frame's sequence number. A consumer thread acquires frames and checks
+// that the size matches the sequence number and every visible pixel carries it; anything else is
+// a torn frame. The legacy buffer is driven the same way to show what the check catches.
+//
+// Exits non-zero if FrameExchange ever hands out a torn frame or a sequence number goes backwards.
+//
+// Usage: snesonline_bench_frame_exchange [seconds=2]
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+
+#include "snesonline/FrameExchange.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr unsigned kStride = FrameExchange::kStridePixels;
+
+unsigned widthFor(uint32_t seq) { return (seq & 1u) ? 512u : 256u; }
+unsigned heightFor(uint32_t seq) { return (seq & 1u) ? 448u : 224u; }
+
+void fill(uint32_t* pixels, uint32_t seq) {
+    const unsigned w = widthFor(seq);
+    const unsigned h = heightFor(seq);
+    for (unsigned y = 0; y < h; ++y) std::fill(pixels + static_cast<std::size_t>(y) * kStride, pixels + static_cast<std::size_t>(y) * kStride + w, seq);
+}
+
+bool intact(const uint32_t* pixels, unsigned w, unsigned h, uint32_t seq) {
+    if (w != widthFor(seq) || h != heightFor(seq)) return false;
+    for (unsigned y = 0; y < h; ++y) {
+        const uint32_t* row = pixels + static_cast<std::size_t>(y) * kStride;
+        for (unsigned x = 0; x < w; ++x) {
+            if (row[x] != seq) return false;
+        }
+    }
+    return true;
+}
+
+// The Android g_rgba / g_videoW / g_videoH / g_videoSeq arrangement.
+struct LegacyBuffer {
+    std::vector<uint32_t> pixels = std::vector<uint32_t>(static_cast<std::size_t>(kStride) * FrameExchange::kMaxHeight);
+    std::atomic<unsigned> width{0};
+    std::atomic<unsigned> height{0};
+    std::atomic<uint32_t> seq{0};
+};
+
+struct Result {
+    uint64_t published = 0;
+    uint64_t checked = 0;
+    uint64_t torn = 0;
+    uint64_t backwards = 0;
+};
+
+void report(const char* name, const Result& r, double secs) {
+    std::printf("  %-26s published %8llu (%7.0f/s)  checked %8llu  torn %6llu  out of order %llu\n", name,
+                static_cast<unsigned long long>(r.published), static_cast<double>(r.published) / secs,
+                static_cast<unsigned long long>(r.checked), static_cast<unsigned long long>(r.torn),
+                static_cast<unsigned long long>(r.backwards));
+}
+
+Result runExchange(double seconds) {
+    auto ex = std::make_unique<FrameExchange>();
+    std::atomic<bool> done{false};
+    Result r;
+
+    std::thread consumer([&] {
+        uint32_t last = 0;
+        for (;;) {
+            const bool finished = done.load(std::memory_order_acquire);
+            const FrameExchange::Frame f = ex->acquire();
+            if (f.seq != last && f.seq != 0) {
+                if (f.seq < last) r.backwards++;
+                if (!intact(f.pixels, f.width, f.height, f.seq)) r.torn++;
+                r.checked++;
+                last = f.seq;
+            }
+            if (finished) break;
+            std::this_thread::yield();
+        }
+    });
+
+    const double t0 = bench::nowSeconds();
+    uint32_t seq = 0;
+    while (bench::nowSeconds() - t0 < seconds) {
+        ++seq;
+        fill(ex->backBuffer(), seq);
+        ex->publish(widthFor(seq), heightFor(seq));
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+    r.published = seq;
+    return r;
+}
+
+Result runLegacy(double seconds) {
+    auto buf = std::make_unique<LegacyBuffer>();
+    std::atomic<bool> done{false};
+    Result r;
+
+    std::thread consumer([&] {
+        uint32_t last = 0;
+        while (!done.load(std::memory_order_acquire)) {
+            // What GameActivity.renderOnce did: size first, then the pixels.
+            const uint32_t seq = buf->seq.load(std::memory_order_acquire);
+            const unsigned w = buf->width.load(std::memory_order_relaxed);
+            const unsigned h = buf->height.load(std::memory_order_relaxed);
+            if (seq != last && seq != 0) {
+                if (!intact(buf->pixels.data(), w, h, seq)) r.torn++;
+                r.checked++;
+                last = seq;
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    const double t0 = bench::nowSeconds();
+    uint32_t seq = 0;
+    while (bench::nowSeconds() - t0 < seconds) {
+        ++seq;
+        fill(buf->pixels.data(), seq);
+        buf->width.store(widthFor(seq), std::memory_order_relaxed);
+        buf->height.store(heightFor(seq), std::memory_order_relaxed);
+        buf->seq.store(seq, std::memory_order_release);
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+    r.published = seq;
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const double seconds = (argc > 1) ? std::atof(argv[1]) : 2.0;
+
+    std::printf("producer/consumer threads, %.1f s each, frames alternate 256x224 / 512x448\n", seconds);
+    const Result legacy = runLegacy(seconds);
+    report("single buffer (old)", legacy, seconds);
+    const Result ex = runExchange(seconds);
+    report("FrameExchange", ex, seconds);
+
+    // Uncontended handoff cost per frame (no pixels touched).
+    auto cost = std::make_unique<FrameExchange>();
+    const bench::Samples s = bench::measure(1000, 100000, [&] {
+        cost->publish(256, 224);
+        bench::keep(cost->acquire().seq);
+    });
+    std::printf("\n");
+    bench::printRow("publish() + acquire()", s);
+
+    const bool ok = ex.torn == 0 && ex.backwards == 0 && ex.checked > 0;
+    std::printf("\n%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
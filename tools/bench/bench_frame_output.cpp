@@ -0,0 +1,132 @@
+// CPU time per frame for each FrameOutput, with sinks doing what the Android/iOS front-ends do
+// (convert the frame into a 512x512 ARGB buffer, push audio into an AudioRing). The difference
+// between Present and None is what every rollback re-simulated frame saves; AudioOnly is what a
+// catch-up frame costs. The mock core honours RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE by skipping
+// its "PPU" and mixer; run with SNESONLINE_BENCH_CORE=/path/to/snes9x for real numbers.
+//
+// Also checks that skipping output does not change emulation: the same inputs from the same state
+// must end in the same savestate for every FrameOutput. Exits non-zero if they differ.
+//
+// Usage: snesonline_bench_frame_output [frames=2000]
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "BenchUtil.h"
+
+#include "snesonline/AudioRing.h"
+#include "snesonline/EmulatorEngine.h"
+#include "snesonline/Hash.h"
+#include "snesonline/PixelConvert.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr unsigned kMaxW = 512;
+constexpr unsigned kMaxH = 512;
+
+struct Sinks {
+    std::vector<uint32_t> rgba = std::vector<uint32_t>(kMaxW * kMaxH);
+    AudioRing ring;
+    EmulatorEngine* engine = nullptr;
+    uint64_t videoFrames = 0;
+    uint64_t audioFrames = 0;
+};
+
+void videoSink(void* ctx, const void* data, unsigned width, unsigned height, std::size_t pitchBytes) noexcept {
+    auto* s = static_cast<Sinks*>(ctx);
+    if (!data || width > kMaxW || height > kMaxH) return;
+    convertPixels(s->engine->core().pixelFormat(), DstPixelFormat::ARGB8888, data, pitchBytes, s->rgba.data(), kMaxW * sizeof(uint32_t), width,
+                  height);
+    s->videoFrames++;
+}
+
+std::size_t audioSink(void* ctx, const int16_t* stereoFrames, std::size_t frameCount) noexcept {
+    auto* s = static_cast<Sinks*>(ctx);
+    s->ring.push(stereoFrames, static_cast<uint32_t>(frameCount));
+    s->audioFrames += frameCount;
+    return frameCount;
+}
+
+uint16_t scriptedInput(uint32_t f) {
+    uint32_t x = (f / 7u) * 2654435761u;
+    x ^= x >> 15;
+    return static_cast<uint16_t>(x & 0x0FFFu);
+}
+
+const char* outputName(FrameOutput o) {
+    switch (o) {
+        case FrameOutput::Present: return "Present";
+        case FrameOutput::AudioOnly: return "AudioOnly";
+        case FrameOutput::VideoOnly: return "VideoOnly";
+        case FrameOutput::None: return "None";
+    }
+    return "?";
+}
+
+uint64_t stateHash(EmulatorEngine& eng, std::vector<uint8_t>& scratch) {
+    scratch.resize(eng.core().serializeSize());
+    if (scratch.empty() || !eng.core().serialize(scratch.data(), scratch.size())) return 0;
+    return stateHash64(scratch.data(), scratch.size());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int frames = (argc > 1) ? std::atoi(argv[1]) : 2000;
+
+    auto& eng = EmulatorEngine::instance();
+    if (!bench::loadMockCore(eng)) return 1;
+
+    auto sinks = std::make_unique<Sinks>();
+    sinks->engine = &eng;
+    eng.core().setVideoSink(sinks.get(), &videoSink);
+    eng.core().setAudioSink(sinks.get(), &audioSink);
+
+    std::vector<uint8_t> start(eng.core().serializeSize());
+    std::vector<uint8_t> scratch;
+    if (start.empty() || !eng.core().serialize(start.data(), start.size())) return 1;
+
+    const FrameOutput outputs[] = {FrameOutput::Present, FrameOutput::AudioOnly, FrameOutput::VideoOnly, FrameOutput::None};
+    std::vector<int16_t> drain(4096 * 2);
+    double presentMean = 0.0;
+    double noneMean = 0.0;
+    uint64_t reference = 0;
+    bool ok = true;
+
+    std::printf("%d frames per row, pixel format %d\n", frames, static_cast<int>(eng.core().pixelFormat()));
+    for (FrameOutput o : outputs) {
+        if (!eng.core().unserialize(start.data(), start.size())) return 1;
+        sinks->videoFrames = 0;
+        sinks->audioFrames = 0;
+        uint32_t f = 0;
+        const bench::Samples s = bench::measure(0, frames, [&] {
+            const uint16_t in = scriptedInput(f++);
+            eng.setInputMask(0, in);
+            eng.setInputMask(1, static_cast<uint16_t>(in ^ 0x0A50u));
+            eng.advanceFrame(o);
+            while (sinks->ring.pop(drain.data(), 4096) == 4096) {
+            }
+        });
+
+        const uint64_t h = stateHash(eng, scratch);
+        if (o == FrameOutput::Present) reference = h;
+        const bool same = h == reference;
+        ok = ok && same;
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "advanceFrame(%s)", outputName(o));
+        bench::printRow(name, s);
+        std::printf("  %-38s video %llu frames, audio %llu frames, end state %s\n", "", static_cast<unsigned long long>(sinks->videoFrames),
+                    static_cast<unsigned long long>(sinks->audioFrames), same ? "matches Present" : "DIFFERS from Present");
+        if (o == FrameOutput::Present) presentMean = s.mean();
+        if (o == FrameOutput::None) noneMean = s.mean();
+    }
+
+    std::printf("\nsaved per re-simulated frame: %.1f us (%.0f%%)\n", (presentMean - noneMean) / 1000.0,
+                presentMean > 0.0 ? 100.0 * (presentMean - noneMean) / presentMean : 0.0);
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
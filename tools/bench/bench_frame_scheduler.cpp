@@ -0,0 +1,120 @@
+// Frame pacing accuracy: FrameScheduler against the loops it replaced.
+//
+// Drift (computed, no waiting): where frame N's deadline lands after an hour of play at the SNES
+// NTSC rate, for the old fixed 16667 us step (Android/iOS), the old 60 fps session clock
+// (LockstepSession/RollbackSession), the old per-frame duration_cast of 1/fps (Windows) and
+// FrameScheduler. Anything but ~0 is audio the core produces early or late and the resampler or
+// the ring's clamp has to absorb.
+//
+// Wake-up accuracy (live, `seconds` each): a loop that does nothing but wait for the next frame,
+// with plain sleep_until() and with the hybrid sleep-then-spin wait at a few spin margins, and the
+// CPU time the spin costs.
+//
+// Exits non-zero if FrameScheduler drifts by more than its micro-hertz rate rounding allows
+// (well under 0.1 ms over the hour).
+//
+// Usage: snesonline_bench_frame_scheduler [seconds=2]
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+
+#include "BenchUtil.h"
+
+#include "snesonline/FrameScheduler.h"
+
+using namespace snesonline;
+
+namespace {
+
+// snes9x / bsnes NTSC: 21477272 Hz master clock / (262 lines * 1364 clocks - 2).
+constexpr double kNtscFps = 21477272.0 / 357366.0;
+
+double driftMs(double deadlineSeconds, uint64_t frames) {
+    return (deadlineSeconds - static_cast<double>(frames) / kNtscFps) * 1000.0;
+}
+
+void wakeRow(const char* name, const bench::Samples& lateNs, double spinUs) {
+    std::printf("  %-22s late mean %7.1f us  p50 %7.1f us  p99 %7.1f us  max %7.1f us", name, lateNs.mean() / 1000.0,
+                lateNs.percentile(0.50) / 1000.0, lateNs.percentile(0.99) / 1000.0, lateNs.percentile(1.0) / 1000.0);
+    if (spinUs >= 0.0) std::printf("  spin %.0f us/frame", spinUs);
+    std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const double seconds = (argc > 1) ? std::atof(argv[1]) : 2.0;
+    const uint64_t hourFrames = static_cast<uint64_t>(std::llround(3600.0 * kNtscFps));
+
+    std::printf("drift after one hour (%llu frames at %.6f Hz)\n", static_cast<unsigned long long>(hourFrames), kNtscFps);
+    {
+        // Android/iOS: next += 16667us.
+        const double legacy = static_cast<double>(hourFrames) * 16667e-6;
+        std::printf("  %-34s %+10.1f ms\n", "fixed 16667 us step (old mobile)", driftMs(legacy, hourFrames));
+
+        // Sessions: frame N due at N / 60 s.
+        const double sessions = static_cast<double>(hourFrames) / 60.0;
+        std::printf("  %-34s %+10.1f ms\n", "60 fps clock (old sessions)", driftMs(sessions, hourFrames));
+
+        // Windows: next += duration_cast<steady_clock::duration>(1 / fps) every frame.
+        const auto step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / kNtscFps));
+        const double windows = std::chrono::duration<double>(step).count() * static_cast<double>(hourFrames);
+        std::printf("  %-34s %+10.3f ms\n", "truncated 1/fps step (old Windows)", driftMs(windows, hourFrames));
+    }
+
+    bool ok = true;
+    {
+        FrameScheduler::Config cfg;
+        cfg.framesPerSecond = kNtscFps;
+        FrameScheduler s(cfg);
+        const auto t0 = FrameScheduler::Clock::time_point{};
+        s.start(t0);
+        for (uint64_t i = 0; i < hourFrames; ++i) s.advance();
+        const double at = std::chrono::duration<double>(s.nextDeadline() - t0).count();
+        const double ms = driftMs(at, hourFrames);
+        std::printf("  %-34s %+10.4f ms\n", "FrameScheduler", ms);
+        ok = std::fabs(ms) < 0.1;
+    }
+
+    std::printf("\nwake-up lateness, %.1f s each at %.4f Hz\n", seconds, kNtscFps);
+    const uint64_t frames = static_cast<uint64_t>(seconds * kNtscFps);
+    {
+        FrameScheduler::Config cfg;
+        cfg.framesPerSecond = kNtscFps;
+        FrameScheduler s(cfg);
+        s.start(FrameScheduler::Clock::now());
+        bench::Samples late;
+        for (uint64_t i = 0; i < frames; ++i) {
+            s.advance();
+            const auto deadline = s.nextDeadline();
+            std::this_thread::sleep_until(deadline);
+            late.add(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(FrameScheduler::Clock::now() - deadline).count()));
+        }
+        wakeRow("sleep_until", late, -1.0);
+    }
+    for (uint32_t spinUs : {500u, 1000u, 2000u}) {
+        FrameScheduler::Config cfg;
+        cfg.framesPerSecond = kNtscFps;
+        cfg.spinMicros = spinUs;
+        FrameScheduler s(cfg);
+        s.start(FrameScheduler::Clock::now());
+        bench::Samples late;
+        for (uint64_t i = 0; i < frames; ++i) {
+            s.advance();
+            const auto deadline = s.nextDeadline();
+            s.waitForNext();
+            late.add(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(FrameScheduler::Clock::now() - deadline).count()));
+        }
+        FrameScheduler::Stats st;
+        s.stats(st);
+        char name[64];
+        std::snprintf(name, sizeof(name), "sleep + %u us spin", spinUs);
+        wakeRow(name, late, st.waits ? static_cast<double>(st.spinMicrosTotal) / static_cast<double>(st.waits) : 0.0);
+        if (st.lateWakeups) std::printf("  %-22s sleeps that overshot the whole spin window: %llu\n", "", static_cast<unsigned long long>(st.lateWakeups));
+    }
+
+    std::printf("\n%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
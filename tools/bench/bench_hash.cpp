@@ -0,0 +1,113 @@
+// Throughput of the hashing module on WRAM-sized (128 KB) and savestate-sized (400 KB) buffers,
+// against the byte-at-a-time FNV-1a and bitwise CRC-32 it replaced. Also cross-checks every
+// dispatched kernel against the portable implementation before timing anything.
+
+#include <cstring>
+#include <vector>
+
+#include "BenchUtil.h"
+
+#include "snesonline/Hash.h"
+
+using namespace snesonline;
+
+namespace {
+
+// Previous EmulatorEngine::checksum32_.
+uint32_t legacyFnv1a(const void* data, std::size_t sizeBytes) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < sizeBytes; ++i) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Previous Android/iOS crc32_.
+uint32_t legacyCrc32(const void* data, std::size_t sizeBytes) {
+    uint32_t crc = 0xFFFFFFFFu;
+    const auto* p = static_cast<const uint8_t*>(data);
+    for (std::size_t i = 0; i < sizeBytes; ++i) {
+        crc ^= p[i];
+        for (int k = 0; k < 8; ++k) {
+            const uint32_t mask = -(crc & 1u);
+            crc = (crc >> 1) ^ (0xEDB88320u & mask);
+        }
+    }
+    return ~crc;
+}
+
+bool selfCheck(const std::vector<uint8_t>& buf) {
+    uint32_t rng = 1;
+    for (int i = 0; i < 2000; ++i) {
+        rng = rng * 1664525u + 1013904223u;
+        const std::size_t off = rng % 61;
+        const std::size_t len = (i < 300) ? static_cast<std::size_t>(i) : (rng >> 8) % (buf.size() - off);
+        const uint8_t* p = buf.data() + off;
+        if (crc32(p, len) != crc32Portable(p, len) || crc32(p, len) != legacyCrc32(p, len)) {
+            std::fprintf(stderr, "crc32 mismatch (len %zu)\n", len);
+            return false;
+        }
+        if (crc32c(p, len) != crc32cPortable(p, len)) {
+            std::fprintf(stderr, "crc32c mismatch (len %zu)\n", len);
+            return false;
+        }
+        if (stateHash64(p, len, i) != stateHash64Portable(p, len, i)) {
+            std::fprintf(stderr, "stateHash64 mismatch (len %zu)\n", len);
+            return false;
+        }
+    }
+    // Running CRCs must match one-shot CRCs.
+    const std::size_t half = buf.size() / 3;
+    if (crc32(buf.data() + half, buf.size() - half, crc32(buf.data(), half)) != crc32(buf.data(), buf.size())) {
+        std::fprintf(stderr, "crc32 continuation mismatch\n");
+        return false;
+    }
+    // Known answer: CRC-32("123456789") = 0xCBF43926, CRC-32C = 0xE3069283.
+    if (crc32("123456789", 9) != 0xCBF43926u || crc32c("123456789", 9) != 0xE3069283u) {
+        std::fprintf(stderr, "crc known-answer test failed\n");
+        return false;
+    }
+    return true;
+}
+
+template <typename Fn>
+void row(const char* name, std::size_t bytes, int iters, Fn&& fn) {
+    const auto s = bench::measure(iters / 10 + 1, iters, fn);
+    const double gbps = static_cast<double>(bytes) / s.percentile(0.50);
+    std::printf("%-34s p50 %10.1f us   p99 %10.1f us   %7.2f GB/s\n", name, s.percentile(0.50) / 1000.0,
+                s.percentile(0.99) / 1000.0, gbps);
+}
+
+} // namespace
+
+int main() {
+    std::vector<uint8_t> buf(400 * 1024 + 64);
+    uint32_t x = 0x12345678u;
+    for (auto& b : buf) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        b = static_cast<uint8_t>(x);
+    }
+
+    std::printf("kernels: crc32=%s crc32c=%s stateHash=%s\n", crc32KernelName(), crc32cKernelName(), stateHashKernelName());
+    if (!selfCheck(buf)) return 1;
+    std::printf("self-check: all kernels match the portable implementations\n");
+
+    const std::size_t sizes[] = {128 * 1024, 400 * 1024};
+    for (std::size_t n : sizes) {
+        std::printf("\n%zu KB\n", n / 1024);
+        const uint8_t* p = buf.data();
+        row("legacy fnv1a (byte loop)", n, 200, [&] { bench::keep(legacyFnv1a(p, n)); });
+        row("legacy crc32 (bitwise)", n, 50, [&] { bench::keep(legacyCrc32(p, n)); });
+        row("crc32 portable (slicing-by-8)", n, 500, [&] { bench::keep(crc32Portable(p, n)); });
+        row("crc32 dispatched", n, 2000, [&] { bench::keep(crc32(p, n)); });
+        row("crc32c portable (slicing-by-8)", n, 500, [&] { bench::keep(crc32cPortable(p, n)); });
+        row("crc32c dispatched", n, 2000, [&] { bench::keep(crc32c(p, n)); });
+        row("stateHash64 portable (scalar)", n, 2000, [&] { bench::keep(stateHash64Portable(p, n)); });
+        row("stateHash64 dispatched", n, 2000, [&] { bench::keep(stateHash64(p, n)); });
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+// Runs two LockstepSessions against each other over loopback and reports how many input packets
+// and bytes each side sends, first with legacy per-frame packets and then with the negotiated v2
+// single-datagram window.
+//
+// Usage: snesonline_bench_input_packets [seconds=5]
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+#include "BenchUtil.h"
+
+#include "InputWire.h"
+#include "snesonline/LockstepSession.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr uint16_t kPortA = 47320;
+constexpr uint16_t kPortB = 47321;
+
+// Held buttons that change every few frames, roughly like real play.
+uint16_t scriptedInput(uint32_t f, uint32_t salt) {
+    uint32_t x = ((f / 7u) + salt) * 2654435761u;
+    x ^= x >> 15;
+    return static_cast<uint16_t>(x & 0x0FFFu);
+}
+
+struct Result {
+    double seconds = 0.0;
+    uint32_t frames = 0;
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    bool v2 = false;
+};
+
+bool runPair(uint8_t version, double seconds, Result& out) {
+    LockstepSession a;
+    LockstepSession b;
+
+    LockstepSession::Config ca{};
+    ca.remoteHost = "127.0.0.1";
+    ca.remotePort = kPortB;
+    ca.localPort = kPortA;
+    ca.localPlayerNum = 1;
+    ca.inputPacketVersion = version;
+
+    LockstepSession::Config cb = ca;
+    cb.remotePort = kPortA;
+    cb.localPort = kPortB;
+    cb.localPlayerNum = 2;
+
+    if (!a.start(ca) || !b.start(cb)) {
+        std::fprintf(stderr, "session start failed\n");
+        return false;
+    }
+
+    const auto t0 = bench::Clock::now();
+    const auto end = t0 + std::chrono::duration_cast<bench::Clock::duration>(std::chrono::duration<double>(seconds));
+    while (bench::Clock::now() < end) {
+        a.setLocalInput(scriptedInput(a.localFrame(), 1));
+        b.setLocalInput(scriptedInput(b.localFrame(), 2));
+        a.tick();
+        b.tick();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    out.seconds = std::chrono::duration<double>(bench::Clock::now() - t0).count();
+    out.frames = a.localFrame();
+    out.packets = a.sentPacketCount();
+    out.bytes = a.sentByteCount();
+    out.v2 = a.peerUsesPacketV2() && b.peerUsesPacketV2();
+    return true;
+}
+
+void printResult(const char* label, const Result& r) {
+    const double pps = static_cast<double>(r.packets) / r.seconds;
+    const double payload = static_cast<double>(r.bytes) / r.seconds;
+    const double wire = static_cast<double>(r.bytes + r.packets * wire::kUdpIpv4OverheadBytes) / r.seconds;
+    std::printf("%-8s %6u frames  %8.1f packets/s  %9.1f payload B/s  %9.1f wire B/s  (%.1f B/packet)%s\n", label, r.frames,
+                pps, payload, wire, r.packets ? static_cast<double>(r.bytes) / static_cast<double>(r.packets) : 0.0,
+                r.v2 ? "  [v2 negotiated]" : "");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const double seconds = (argc > 1) ? std::atof(argv[1]) : 5.0;
+
+    auto& eng = EmulatorEngine::instance();
+    if (!bench::loadMockCore(eng)) return 1;
+
+    Result legacy;
+    Result v2;
+    if (!runPair(1, seconds, legacy)) return 1;
+    if (!runPair(2, seconds, v2)) return 1;
+
+    std::printf("per peer, loopback, %.1f s each (wire = payload + 28 B IPv4/UDP header per packet)\n", seconds);
+    printResult("legacy", legacy);
+    printResult("v2", v2);
+    return v2.v2 ? 0 : 1;
+}
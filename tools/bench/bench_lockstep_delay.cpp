@@ -0,0 +1,136 @@
+// Runs two LockstepSessions through the loopback impairment proxy (tools/netem) with one-way
+// latency and jitter, and reports the delay they agree on before frame 0 (and how long that took),
+// the delay they settle on, and how often they stalled once running.
+//
+// The last case holds the input steady after the first 60 frames, so the v2 window packs into a
+// single RLE run (a datagram the size of a control packet). Exits non-zero if that case falls
+// behind real time.
+//
+// Usage: snesonline_bench_lockstep_delay [seconds=6]
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+#include "BenchUtil.h"
+#include "NetemProxy.h"
+
+#include "snesonline/LockstepSession.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr uint16_t kPortA = 47330;
+constexpr uint16_t kPortB = 47331;
+constexpr uint16_t kRelayForA = 47332; // A sends here, B receives from here
+constexpr uint16_t kRelayForB = 47333; // B sends here, A receives from here
+
+uint16_t scriptedInput(uint32_t f, uint32_t salt) {
+    uint32_t x = ((f / 7u) + salt) * 2654435761u;
+    x ^= x >> 15;
+    return static_cast<uint16_t>(x & 0x0FFFu);
+}
+
+constexpr uint32_t kHoldAfterFrames = 60;
+
+uint16_t caseInput(uint32_t f, uint32_t salt, bool hold) {
+    return (hold && f >= kHoldAfterFrames) ? static_cast<uint16_t>(salt) : scriptedInput(f, salt);
+}
+
+bool runCase(uint32_t latencyMs, uint32_t jitterMs, double seconds, bool hold) {
+    netem::NetemProxy relay;
+    netem::NetemProxy::Config rc{};
+    rc.listenPortA = kRelayForA;
+    rc.peerPortA = kPortA;
+    rc.listenPortB = kRelayForB;
+    rc.peerPortB = kPortB;
+    if (!relay.open(rc)) return false;
+    netem::Impairment imp;
+    imp.latencyMs = latencyMs;
+    imp.jitterMs = jitterMs;
+    relay.setImpairment(imp);
+
+    LockstepSession a;
+    LockstepSession b;
+    LockstepSession::Config ca{};
+    ca.remoteHost = "127.0.0.1";
+    ca.remotePort = kRelayForA;
+    ca.localPort = kPortA;
+    ca.localPlayerNum = 1;
+    LockstepSession::Config cb = ca;
+    cb.remotePort = kRelayForB;
+    cb.localPort = kPortB;
+    cb.localPlayerNum = 2;
+    if (!a.start(ca) || !b.start(cb)) {
+        std::fprintf(stderr, "session start failed\n");
+        return false;
+    }
+
+    uint32_t startDelay = 0;
+    double startMs = -1.0;
+    uint32_t minDelay = 0;
+    uint32_t maxDelay = 0;
+    uint32_t changes = 0;
+    uint32_t lastDelay = 0;
+    uint32_t stalledTicksA = 0;
+    uint32_t ticks = 0;
+
+    const auto t0 = bench::Clock::now();
+    const auto end = t0 + std::chrono::duration_cast<bench::Clock::duration>(std::chrono::duration<double>(seconds));
+    while (bench::Clock::now() < end) {
+        a.setLocalInput(caseInput(a.localFrame(), 1, hold));
+        b.setLocalInput(caseInput(b.localFrame(), 2, hold));
+        a.tick();
+        b.tick();
+        relay.pump();
+
+        // Stalls and delay changes count from the first frame on.
+        const uint32_t d = a.inputDelayFrames();
+        if (a.localFrame() == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (startMs < 0.0) {
+            startMs = std::chrono::duration<double, std::milli>(bench::Clock::now() - t0).count();
+            startDelay = minDelay = maxDelay = lastDelay = d;
+        }
+        ++ticks;
+        if (a.waitingForPeer()) ++stalledTicksA;
+        if (d != lastDelay) {
+            ++changes;
+            lastDelay = d;
+        }
+        if (d < minDelay) minDelay = d;
+        if (d > maxDelay) maxDelay = d;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const double elapsed = std::chrono::duration<double>(bench::Clock::now() - t0).count();
+    const double expected = elapsed * 60.0;
+    std::printf("%4u ms +-%3u%s | start %2u after %4.0f ms | delay %2u (p2 %2u, range %u..%u, %u changes) | rtt %6.1f ms, jitter %5.1f ms | "
+                "%5u frames, %5.1f%% of real time, stalled %4.1f%% of ticks\n",
+                latencyMs, jitterMs, hold ? " held" : "", startDelay, startMs, a.inputDelayFrames(), b.inputDelayFrames(), minDelay, maxDelay, changes,
+                a.rttMicros() / 1000.0, a.jitterMicros() / 1000.0, a.localFrame(), 100.0 * a.localFrame() / expected,
+                ticks ? 100.0 * stalledTicksA / ticks : 0.0);
+    // Without jitter the sessions keep up with the wall clock; a frozen match does not.
+    return !hold || a.localFrame() >= expected * 0.9;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const double seconds = (argc > 1) ? std::atof(argv[1]) : 6.0;
+
+    auto& eng = EmulatorEngine::instance();
+    if (!bench::loadMockCore(eng)) return 1;
+
+    std::printf("one-way latency | agreed start | adaptive delay | measured | progress (%.1f s each)\n", seconds);
+    const uint32_t cases[][2] = {{0, 0}, {15, 2}, {40, 5}, {80, 10}};
+    for (const auto& c : cases) {
+        if (!runCase(c[0], c[1], seconds, false)) return 1;
+    }
+    const bool ok = runCase(15, 0, seconds, true);
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+// Measures how long LockstepSession stalls on late remote input with a plain tick() + sleep_until
+// frame loop versus tickUntil(), which waits for the input until the next frame slot.
+//
+// A scripted peer on its own thread sends its inputs on a 60 Hz clock (half a frame out of phase)
+// through a relay with latency and jitter chosen so some inputs land just after they are due.
+//
+// Usage: snesonline_bench_lockstep_wait [latencyMs=22] [jitterMs=6] [seconds=8]
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+#include "BenchUtil.h"
+#include "NetemProxy.h"
+
+#include "InputWire.h"
+#include "NetSocket.h"
+#include "snesonline/LockstepSession.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr uint16_t kSessionPort = 47350;
+constexpr uint16_t kPeerPort = 47351;
+constexpr uint16_t kRelayForSession = 47352;
+constexpr uint16_t kRelayForPeer = 47353;
+constexpr uint32_t kDelay = 2;
+
+uint16_t peerInput(uint32_t f) {
+    if (f < kDelay) return 0;
+    uint32_t x = (f / 7u) * 2654435761u;
+    x ^= x >> 15;
+    return static_cast<uint16_t>(x & 0x0FFFu);
+}
+
+// Sends frame g + kDelay at the peer's frame slot g, as a v2 window like a real session.
+void runPeer(std::atomic<bool>& running, bench::Clock::time_point start) {
+    net::SocketHandle sock = net::kInvalidSocket;
+    if (!net::openUdpSocket(kPeerPort, sock)) return;
+    sockaddr_in relay{};
+    net::resolveIpv4ToSockaddr("127.0.0.1", relay, kRelayForPeer);
+
+    const auto frame = std::chrono::microseconds(16667);
+    auto next = start + frame / 2;
+    for (uint32_t g = 0; running.load(); ++g) {
+        std::this_thread::sleep_until(next);
+        next += frame;
+
+        const uint32_t newest = g + kDelay;
+        uint16_t masks[16];
+        const uint32_t count = (newest + 1 < 16) ? newest + 1 : 16;
+        for (uint32_t i = 0; i < count; ++i) masks[i] = peerInput(newest - count + 1 + i);
+        uint8_t buf[wire::kMaxInputV2Bytes];
+        const std::size_t len = wire::buildInputV2(0, newest, masks, count, buf, sizeof(buf));
+        net::sendTo(sock, buf, len, relay);
+
+        // Drain what the session sends us.
+        uint8_t sink[512];
+        sockaddr_in from{};
+        while (net::recvFrom(sock, sink, sizeof(sink), from) > 0) {
+        }
+    }
+    net::closeSocket(sock);
+}
+
+bool runMode(const char* label, bool useTickUntil, bool networkThread, uint32_t latencyMs, uint32_t jitterMs, double seconds) {
+    netem::NetemProxy relay;
+    netem::NetemProxy::Config rc{};
+    rc.listenPortA = kRelayForSession;
+    rc.peerPortA = kSessionPort;
+    rc.listenPortB = kRelayForPeer;
+    rc.peerPortB = kPeerPort;
+    if (!relay.open(rc)) return false;
+    netem::Impairment imp;
+    imp.latencyMs = latencyMs;
+    imp.jitterMs = jitterMs;
+    relay.setImpairment(imp);
+    relay.start();
+
+    LockstepSession s;
+    LockstepSession::Config cfg{};
+    cfg.remoteHost = "127.0.0.1";
+    cfg.remotePort = kRelayForSession;
+    cfg.localPort = kSessionPort;
+    cfg.localPlayerNum = 1;
+    cfg.inputDelayFrames = kDelay;
+    cfg.networkThread = networkThread;
+    if (!s.start(cfg)) {
+        std::fprintf(stderr, "session start failed\n");
+        return false;
+    }
+
+    std::atomic<bool> running{true};
+    const auto start = bench::Clock::now();
+    std::thread peer(runPeer, std::ref(running), start);
+
+    const auto frame = std::chrono::microseconds(16667);
+    auto next = start;
+    const auto end = start + std::chrono::duration_cast<bench::Clock::duration>(std::chrono::duration<double>(seconds));
+    uint32_t lateSlots = 0;
+    uint32_t slots = 0;
+    while (next < end) {
+        next += frame;
+        s.setLocalInput(0);
+        const uint32_t before = s.localFrame();
+        if (useTickUntil) s.tickUntil(next);
+        else s.tick();
+        ++slots;
+        if (s.localFrame() == before) ++lateSlots;
+        std::this_thread::sleep_until(next);
+    }
+
+    running.store(false);
+    peer.join();
+    relay.stop();
+
+    const double avgMs = s.stallCount() ? (static_cast<double>(s.stallMicrosTotal()) / s.stallCount()) / 1000.0 : 0.0;
+    std::printf("%-26s %4llu stalls, avg %5.2f ms, max %5.2f ms, total %7.1f ms | %3u of %u frame slots ran nothing\n", label,
+                static_cast<unsigned long long>(s.stallCount()), avgMs, s.maxStallMicros() / 1000.0,
+                s.stallMicrosTotal() / 1000.0, lateSlots, slots);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const uint32_t latencyMs = (argc > 1) ? static_cast<uint32_t>(std::atoi(argv[1])) : 22u;
+    const uint32_t jitterMs = (argc > 2) ? static_cast<uint32_t>(std::atoi(argv[2])) : 6u;
+    const double seconds = (argc > 3) ? std::atof(argv[3]) : 8.0;
+
+    auto& eng = EmulatorEngine::instance();
+    if (!bench::loadMockCore(eng)) return 1;
+
+    std::printf("input delay %u frames, one-way latency %u +- %u ms, %.1f s per mode\n", kDelay, latencyMs, jitterMs, seconds);
+    if (!runMode("tick() + sleep_until", false, false, latencyMs, jitterMs, seconds)) return 1;
+    if (!runMode("tickUntil(), polling", true, false, latencyMs, jitterMs, seconds)) return 1;
+    if (!runMode("tickUntil(), net thread", true, true, latencyMs, jitterMs, seconds)) return 1;
+    return 0;
+}
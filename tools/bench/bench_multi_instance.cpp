@@ -0,0 +1,140 @@
+// Runs several EmulatorEngines in one process.
+//
+// 1. N engines on N threads, all fed the same scripted input: every final state checksum must match
+//    (instances do not share core globals or callbacks), and aggregate frames/s shows how many
+//    emulators one process can host.
+// 2. Two engines driven by two LockstepSessions over loopback UDP in one thread, i.e. an in-process
+//    netplay match: both sides must end on the same state.
+//
+// Usage: snesonline_bench_multi_instance [threads=4] [frames=600]
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+
+#include "snesonline/LockstepSession.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr uint16_t kPortA = 47370;
+constexpr uint16_t kPortB = 47371;
+
+uint16_t scriptedInput(uint32_t f, uint32_t salt) {
+    uint32_t x = ((f / 7u) + salt) * 2654435761u;
+    x ^= x >> 15;
+    return static_cast<uint16_t>(x & 0x0FFFu);
+}
+
+uint32_t stateChecksum(EmulatorEngine& eng) {
+    SaveState st;
+    return eng.saveState(st) ? st.checksum : 0u;
+}
+
+struct Worker {
+    EmulatorEngine engine;
+    uint32_t checksum = 0;
+    double seconds = 0.0;
+};
+
+double runEngines(std::vector<std::unique_ptr<Worker>>& workers, uint32_t frames) {
+    const auto t0 = bench::Clock::now();
+    std::vector<std::thread> threads;
+    for (auto& w : workers) {
+        threads.emplace_back([&w, frames] {
+            const auto s0 = bench::Clock::now();
+            for (uint32_t f = 0; f < frames; ++f) {
+                w->engine.setInputMask(0, scriptedInput(f, 1));
+                w->engine.setInputMask(1, scriptedInput(f, 2));
+                w->engine.advanceFrame();
+            }
+            w->seconds = std::chrono::duration<double>(bench::Clock::now() - s0).count();
+            w->checksum = stateChecksum(w->engine);
+        });
+    }
+    for (auto& t : threads) t.join();
+    return std::chrono::duration<double>(bench::Clock::now() - t0).count();
+}
+
+bool parallelEngines(uint32_t threads, uint32_t frames) {
+    bool ok = true;
+    for (uint32_t n : {1u, threads}) {
+        std::vector<std::unique_ptr<Worker>> workers;
+        for (uint32_t i = 0; i < n; ++i) {
+            workers.push_back(std::make_unique<Worker>());
+            if (!bench::loadMockCore(workers.back()->engine)) return false;
+        }
+        const double wall = runEngines(workers, frames);
+
+        bool same = true;
+        for (const auto& w : workers) same = same && (w->checksum == workers[0]->checksum);
+        ok = ok && same;
+        std::printf("%2u engine(s): %8.0f frames/s total, %7.0f per engine | state %08x %s\n", n,
+                    static_cast<double>(frames) * n / wall, static_cast<double>(frames) / workers[0]->seconds,
+                    workers[0]->checksum, same ? "identical" : "MISMATCH");
+    }
+    return ok;
+}
+
+bool inProcessNetplay(uint32_t frames) {
+    EmulatorEngine engA;
+    EmulatorEngine engB;
+    if (!bench::loadMockCore(engA) || !bench::loadMockCore(engB)) return false;
+
+    LockstepSession a;
+    LockstepSession b;
+    LockstepSession::Config ca{};
+    ca.remoteHost = "127.0.0.1";
+    ca.remotePort = kPortB;
+    ca.localPort = kPortA;
+    ca.localPlayerNum = 1;
+    ca.inputDelayFrames = 2;
+    ca.engine = &engA;
+    LockstepSession::Config cb = ca;
+    cb.remotePort = kPortA;
+    cb.localPort = kPortB;
+    cb.localPlayerNum = 2;
+    cb.engine = &engB;
+    if (!a.start(ca) || !b.start(cb)) {
+        std::fprintf(stderr, "session start failed\n");
+        return false;
+    }
+
+    const auto t0 = bench::Clock::now();
+    const auto timeout = t0 + std::chrono::seconds(30);
+    while ((a.localFrame() < frames || b.localFrame() < frames) && bench::Clock::now() < timeout) {
+        if (a.localFrame() < frames) {
+            a.setLocalInput(scriptedInput(a.localFrame(), 1));
+            a.tick();
+        }
+        if (b.localFrame() < frames) {
+            b.setLocalInput(scriptedInput(b.localFrame(), 2));
+            b.tick();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const uint32_t ha = stateChecksum(engA);
+    const uint32_t hb = stateChecksum(engB);
+    const bool same = a.localFrame() == frames && b.localFrame() == frames && ha == hb;
+    std::printf("in-process lockstep: %u/%u frames, states %08x / %08x %s\n", a.localFrame(), b.localFrame(), ha, hb,
+                same ? "in sync" : "DESYNC");
+    return same;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const uint32_t threads = (argc > 1) ? static_cast<uint32_t>(std::atoi(argv[1])) : 4u;
+    const uint32_t frames = (argc > 2) ? static_cast<uint32_t>(std::atoi(argv[2])) : 600u;
+
+    bool ok = parallelEngines(threads ? threads : 1u, frames);
+    ok = inProcessNetplay(frames) && ok;
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
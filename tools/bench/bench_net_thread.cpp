@@ -0,0 +1,119 @@
+// Compares LockstepSession with and without its network thread. Two peers run a 60 Hz frame loop
+// half a frame out of phase (like two real machines) and talk through a relay with fixed latency.
+// Without the thread, a ping is only answered on the peer's next tick and its pong only read on
+// ours, so the measured RTT (and the adaptive input delay derived from it) includes up to two frame
+// slots of loop latency.
+//
+// Usage: snesonline_bench_net_thread [latencyMs=10] [jitterMs=2] [seconds=8]
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+#include "BenchUtil.h"
+#include "NetemProxy.h"
+
+#include "snesonline/LockstepSession.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr uint16_t kPortA = 47340;
+constexpr uint16_t kPortB = 47341;
+constexpr uint16_t kRelayForA = 47342;
+constexpr uint16_t kRelayForB = 47343;
+
+uint16_t scriptedInput(uint32_t f, uint32_t salt) {
+    uint32_t x = ((f / 7u) + salt) * 2654435761u;
+    x ^= x >> 15;
+    return static_cast<uint16_t>(x & 0x0FFFu);
+}
+
+bool runMode(bool networkThread, uint32_t latencyMs, uint32_t jitterMs, double seconds) {
+    netem::NetemProxy relay;
+    netem::NetemProxy::Config rc{};
+    rc.listenPortA = kRelayForA;
+    rc.peerPortA = kPortA;
+    rc.listenPortB = kRelayForB;
+    rc.peerPortB = kPortB;
+    if (!relay.open(rc)) return false;
+    netem::Impairment imp;
+    imp.latencyMs = latencyMs;
+    imp.jitterMs = jitterMs;
+    relay.setImpairment(imp);
+    relay.start();
+
+    LockstepSession a;
+    LockstepSession b;
+    LockstepSession::Config ca{};
+    ca.remoteHost = "127.0.0.1";
+    ca.remotePort = kRelayForA;
+    ca.localPort = kPortA;
+    ca.localPlayerNum = 1;
+    ca.networkThread = networkThread;
+    LockstepSession::Config cb = ca;
+    cb.remotePort = kRelayForB;
+    cb.localPort = kPortB;
+    cb.localPlayerNum = 2;
+    if (!a.start(ca) || !b.start(cb)) {
+        std::fprintf(stderr, "session start failed\n");
+        return false;
+    }
+
+    bench::Samples rtt;
+    uint32_t seenSamples = 0;
+    uint32_t slots = 0;
+    uint32_t stalledSlots = 0;
+    uint64_t delaySum = 0;
+
+    const auto halfFrame = std::chrono::microseconds(8333);
+    auto next = bench::Clock::now();
+    const auto end = next + std::chrono::duration_cast<bench::Clock::duration>(std::chrono::duration<double>(seconds));
+    bool tickA = true;
+    while (next < end) {
+        next += halfFrame;
+        std::this_thread::sleep_until(next);
+
+        LockstepSession& s = tickA ? a : b;
+        s.setLocalInput(scriptedInput(s.localFrame(), tickA ? 1 : 2));
+        const uint32_t before = s.localFrame();
+        s.tick();
+        // Slots before frame 0 (the delay agreement) are not stalls.
+        if (tickA && a.localFrame() > 0) {
+            ++slots;
+            if (a.localFrame() == before) ++stalledSlots;
+            delaySum += a.inputDelayFrames();
+            if (a.rttSampleCount() != seenSamples) {
+                seenSamples = a.rttSampleCount();
+                rtt.add(static_cast<double>(a.lastRttMicros()) * 1000.0);
+            }
+        }
+        tickA = !tickA;
+    }
+    relay.stop();
+
+    const double avgDelay = slots ? static_cast<double>(delaySum) / slots : 0.0;
+    std::printf("%-13s rtt p50 %5.1f  p90 %5.1f  p99 %5.1f ms | delay now %2u avg %4.1f frames (%5.1f ms input latency) | "
+                "stalled %4.1f%% of %u frame slots\n",
+                networkThread ? "net thread" : "tick polling", rtt.percentile(0.50) / 1e6, rtt.percentile(0.90) / 1e6,
+                rtt.percentile(0.99) / 1e6, a.inputDelayFrames(), avgDelay, avgDelay * 1000.0 / 60.0,
+                slots ? 100.0 * stalledSlots / slots : 0.0, slots);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const uint32_t latencyMs = (argc > 1) ? static_cast<uint32_t>(std::atoi(argv[1])) : 10u;
+    const uint32_t jitterMs = (argc > 2) ? static_cast<uint32_t>(std::atoi(argv[2])) : 2u;
+    const double seconds = (argc > 3) ? std::atof(argv[3]) : 8.0;
+
+    auto& eng = EmulatorEngine::instance();
+    if (!bench::loadMockCore(eng)) return 1;
+
+    std::printf("one-way latency %u +- %u ms, 60 Hz loops half a frame apart, %.1f s per mode\n", latencyMs, jitterMs, seconds);
+    if (!runMode(false, latencyMs, jitterMs, seconds)) return 1;
+    if (!runMode(true, latencyMs, jitterMs, seconds)) return 1;
+    return 0;
+}
@@ -0,0 +1,240 @@
+// Netplay soak test and regression gate. Two LockstepSessions (network thread + tickUntil, like the
+// Windows runner) run 60 Hz loops half a frame apart through the loopback impairment proxy
+// (tools/netem) under a set of network profiles, one of which drops everything for a second.
+//
+// Per profile it reports stall frames (time spent waiting for remote input, in 60 Hz frames), the
+// effective (average) input delay, resend volume (bytes and packets sent per simulated frame) and,
+// for outages, the time until frames run again and until the session is back on its wall-clock pace.
+// Each profile has limits; any breach makes the process exit non-zero.
+//
+// Usage: snesonline_bench_netplay_soak [seconds=8] [seed=1]   (seconds >= 6)
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+#include "BenchUtil.h"
+#include "NetemProxy.h"
+
+#include "snesonline/LockstepSession.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr uint16_t kPortA = 47360;
+constexpr uint16_t kPortB = 47361;
+constexpr uint16_t kProxyForA = 47362;
+constexpr uint16_t kProxyForB = 47363;
+// Adaptive delay is agreed before frame 0 but may still move in the first evaluations; the delay
+// average only counts frame slots after this, so it does not depend on the run length.
+constexpr double kDelayWarmupSeconds = 3.0;
+
+struct Profile {
+    const char* name;
+    netem::Impairment imp;
+    uint32_t outageMs;        // blackhole for this long, starting at a third of the run
+    double maxStallFrames;    // limit: player 1 stall time in frames
+    double maxAvgDelay;       // limit: average input delay in frames
+    double maxBytesPerFrame;  // limit: bytes player 1 sends per simulated frame
+    uint32_t maxRecoverMs;    // limit: outage end -> back on pace
+};
+
+struct Result {
+    double stallFrames = 0.0;
+    double avgDelay = 0.0;
+    double bytesPerFrame = 0.0;
+    double packetsPerFrame = 0.0;
+    uint32_t frames = 0;
+    uint64_t stalls = 0;
+    uint32_t maxStallMs = 0;
+    uint64_t dropped = 0;
+    uint64_t duplicated = 0;
+    uint64_t reordered = 0;
+    int64_t resumeMs = -1;
+    int64_t recoverMs = -1;
+};
+
+netem::Impairment impairment(uint32_t latencyMs, uint32_t jitterMs) {
+    netem::Impairment imp;
+    imp.latencyMs = latencyMs;
+    imp.jitterMs = jitterMs;
+    return imp;
+}
+
+uint16_t scriptedInput(uint32_t f, uint32_t salt) {
+    uint32_t x = ((f / 7u) + salt) * 2654435761u;
+    x ^= x >> 15;
+    return static_cast<uint16_t>(x & 0x0FFFu);
+}
+
+bool runProfile(const Profile& p, double seconds, uint32_t seed, Result& r) {
+    netem::NetemProxy proxy;
+    netem::NetemProxy::Config pc{};
+    pc.listenPortA = kProxyForA;
+    pc.peerPortA = kPortA;
+    pc.listenPortB = kProxyForB;
+    pc.peerPortB = kPortB;
+    pc.seed = seed;
+    if (!proxy.open(pc)) return false;
+    proxy.setImpairment(p.imp);
+    if (!proxy.start()) return false;
+
+    LockstepSession a;
+    LockstepSession b;
+    LockstepSession::Config ca{};
+    ca.remoteHost = "127.0.0.1";
+    ca.remotePort = kProxyForA;
+    ca.localPort = kPortA;
+    ca.localPlayerNum = 1;
+    ca.networkThread = true;
+    LockstepSession::Config cb = ca;
+    cb.remotePort = kProxyForB;
+    cb.localPort = kPortB;
+    cb.localPlayerNum = 2;
+    if (!a.start(ca) || !b.start(cb)) {
+        std::fprintf(stderr, "session start failed\n");
+        return false;
+    }
+
+    using namespace std::chrono;
+    const auto halfFrame = microseconds(8333);
+    const auto t0 = bench::Clock::now();
+    const auto end = t0 + duration_cast<bench::Clock::duration>(duration<double>(seconds));
+    const auto outageBegin = t0 + duration_cast<bench::Clock::duration>(duration<double>(seconds / 3.0));
+    const auto outageEnd = outageBegin + milliseconds(p.outageMs);
+    bool outage = false;
+
+    uint32_t delaySlots = 0;
+    uint64_t delaySum = 0;
+    uint32_t firstFrame = 0;
+    uint64_t firstBytes = 0;
+    uint64_t firstPackets = 0;
+    bench::Clock::time_point firstAt{};
+    bool measuring = false;
+
+    auto next = t0;
+    bool tickA = true;
+    while (next < end) {
+        const auto slot = next;
+        next += halfFrame;
+
+        if (p.outageMs && !outage && slot >= outageBegin && slot < outageEnd) {
+            outage = true;
+            proxy.setBlackhole(true);
+        } else if (outage && slot >= outageEnd) {
+            outage = false;
+            proxy.setBlackhole(false);
+        }
+
+        LockstepSession& s = tickA ? a : b;
+        s.setLocalInput(scriptedInput(s.localFrame(), tickA ? 1 : 2));
+        const uint32_t before = s.localFrame();
+        s.tickUntil(next);
+
+        if (tickA && a.connected()) {
+            const auto now = bench::Clock::now();
+            if (!measuring) {
+                // Skip the handshake; count from the first connected frame slot.
+                measuring = true;
+                firstFrame = a.localFrame();
+                firstBytes = a.sentByteCount();
+                firstPackets = a.sentPacketCount();
+                firstAt = now;
+            }
+            if (now - t0 >= duration<double>(kDelayWarmupSeconds)) {
+                ++delaySlots;
+                delaySum += a.inputDelayFrames();
+            }
+
+            if (p.outageMs && now >= outageEnd) {
+                const int64_t sinceEnd = duration_cast<milliseconds>(now - outageEnd).count();
+                if (r.resumeMs < 0 && a.localFrame() != before) r.resumeMs = sinceEnd;
+                // Back on pace: within the catch-up budget of where the wall clock says we should be,
+                // counting from the first connected slot (frame 0 waits for the delay agreement).
+                const uint32_t due = firstFrame + static_cast<uint32_t>(duration_cast<microseconds>(now - firstAt).count() / 16667) + 1u;
+                if (r.resumeMs >= 0 && r.recoverMs < 0 && a.localFrame() + 4u >= due) r.recoverMs = sinceEnd;
+            }
+        }
+        std::this_thread::sleep_until(next);
+        tickA = !tickA;
+    }
+    proxy.stop();
+
+    const uint32_t frames = a.localFrame() - firstFrame;
+    r.frames = frames;
+    r.stallFrames = static_cast<double>(a.stallMicrosTotal()) / 16667.0;
+    r.avgDelay = delaySlots ? static_cast<double>(delaySum) / delaySlots : 0.0;
+    r.bytesPerFrame = frames ? static_cast<double>(a.sentByteCount() - firstBytes) / frames : 0.0;
+    r.packetsPerFrame = frames ? static_cast<double>(a.sentPacketCount() - firstPackets) / frames : 0.0;
+    r.stalls = a.stallCount();
+    r.maxStallMs = a.maxStallMicros() / 1000u;
+    const netem::DirectionStats ab = proxy.statsAToB();
+    const netem::DirectionStats ba = proxy.statsBToA();
+    r.dropped = ab.lost + ab.burstLost + ab.blackholed + ba.lost + ba.burstLost + ba.blackholed;
+    r.duplicated = ab.duplicated + ba.duplicated;
+    r.reordered = ab.reordered + ba.reordered;
+    return true;
+}
+
+bool check(bool ok, const char* what, bool& allOk) {
+    if (!ok) {
+        std::printf("    FAIL: %s\n", what);
+        allOk = false;
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    double seconds = (argc > 1) ? std::atof(argv[1]) : 8.0;
+    if (seconds < 6.0) seconds = 6.0;
+    const uint32_t seed = (argc > 2) ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 1u;
+
+    auto& eng = EmulatorEngine::instance();
+    if (!bench::loadMockCore(eng)) return 1;
+
+    Profile profiles[] = {
+        {"clean 10+-2", impairment(10, 2), 0, 1.0, 4.5, 40.0, 0},
+        {"loss 2%", impairment(20, 4), 0, 6.0, 5.5, 40.0, 0},
+        {"burst loss", impairment(20, 4), 0, 15.0, 6.0, 40.0, 0},
+        {"reorder+dup", impairment(20, 4), 0, 6.0, 5.5, 40.0, 0},
+        {"jitter 30+-15", impairment(30, 15), 0, 12.0, 8.0, 40.0, 0},
+        {"1 s outage", impairment(20, 4), 1000, 90.0, 6.0, 40.0, 1500},
+    };
+    profiles[1].imp.lossPct = 2.0;
+    profiles[2].imp.burstEnterPct = 1.0;
+    profiles[2].imp.burstExitPct = 30.0;
+    profiles[3].imp.reorderPct = 10.0;
+    profiles[3].imp.reorderMs = 15;
+    profiles[3].imp.duplicatePct = 5.0;
+
+    std::printf("%.1f s per profile, seed %u, limits in []\n", seconds, seed);
+    bool allOk = true;
+    for (const Profile& p : profiles) {
+        Result r;
+        if (!runProfile(p, seconds, seed, r)) return 1;
+        std::printf("%-14s stall %5.1f frames [%4.1f] (%3llu, max %4u ms) | delay avg %4.1f [%4.1f] | %5.1f B/frame [%4.1f] "
+                    "%4.2f pkt/frame | %4u frames | net drop %4llu dup %3llu reord %3llu",
+                    p.name, r.stallFrames, p.maxStallFrames, static_cast<unsigned long long>(r.stalls), r.maxStallMs,
+                    r.avgDelay, p.maxAvgDelay, r.bytesPerFrame, p.maxBytesPerFrame, r.packetsPerFrame, r.frames,
+                    static_cast<unsigned long long>(r.dropped), static_cast<unsigned long long>(r.duplicated),
+                    static_cast<unsigned long long>(r.reordered));
+        if (p.outageMs) {
+            std::printf(" | resume %lld ms, on pace %lld ms [%u]", static_cast<long long>(r.resumeMs),
+                        static_cast<long long>(r.recoverMs), p.maxRecoverMs);
+        }
+        std::printf("\n");
+
+        check(r.frames > 0, "no frames simulated", allOk);
+        check(r.stallFrames <= p.maxStallFrames, "too much stall time", allOk);
+        check(r.avgDelay <= p.maxAvgDelay, "input delay too high", allOk);
+        check(r.bytesPerFrame <= p.maxBytesPerFrame, "resend volume too high", allOk);
+        if (p.outageMs) {
+            check(r.recoverMs >= 0 && r.recoverMs <= static_cast<int64_t>(p.maxRecoverMs), "slow outage recovery", allOk);
+        }
+    }
+    std::printf("%s\n", allOk ? "PASS" : "FAIL");
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,200 @@
+// NetplayStats snapshots (stats()) and the NetplayStatsTracker that fills them.
+//
+// 1. Tracker bookkeeping against a scripted probe sequence: loss, duplicates, reordering, the RTT
+//    percentiles and jitter must come out as expected.
+// 2. In-process lockstep and rollback matches over loopback UDP: both sides must report RTT samples,
+//    no probe loss, traffic in both directions, the frames they ran and (rollback) the rollbacks
+//    the session counted; prints each side's snapshot.
+// 3. Cost of one stats() call, i.e. what polling it every frame adds.
+//
+// Exits non-zero if any check fails.
+//
+// Usage: snesonline_bench_netplay_stats [frames=240]
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <type_traits>
+
+#include "BenchUtil.h"
+
+#include "snesonline/LockstepSession.h"
+#include "snesonline/NetplayStats.h"
+#include "snesonline/RollbackSession.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr uint16_t kPortA = 47380;
+constexpr uint16_t kPortB = 47381;
+constexpr int kCallsPerSample = 1000;
+
+uint16_t scriptedInput(uint32_t f, uint32_t salt) {
+    uint32_t x = ((f / 7u) + salt) * 2654435761u;
+    x ^= x >> 15;
+    return static_cast<uint16_t>(x & 0x0FFFu);
+}
+
+bool check(bool cond, const char* what) {
+    if (!cond) std::printf("  FAILED: %s\n", what);
+    return cond;
+}
+
+void printStats(const char* name, const NetplayStats& s) {
+    std::printf("  %-10s f=%u rf=%u delay=%u rtt min/avg/p99/max=%u/%u/%u/%u us jitter=%u us samples=%u\n", name, s.localFrame, s.remoteFrame,
+                s.inputDelayFrames, s.rttMinMicros, s.rttAvgMicros, s.rttP99Micros, s.rttMaxMicros, s.jitterMicros, s.rttSamples);
+    std::printf("  %-10s probes %llu/%llu loss=%.1f%% dup=%llu ooo=%llu stalls=%llu (%llu frames, max %u us) rollbacks=%llu (max depth %u)\n", "",
+                static_cast<unsigned long long>(s.probesAnswered), static_cast<unsigned long long>(s.probesSent), static_cast<double>(s.lossPercent),
+                static_cast<unsigned long long>(s.duplicatePackets), static_cast<unsigned long long>(s.outOfOrderPackets),
+                static_cast<unsigned long long>(s.stallCount), static_cast<unsigned long long>(s.stalledFrames), s.maxStallMicros,
+                static_cast<unsigned long long>(s.rollbackCount), s.maxRollbackDepth);
+    std::printf("  %-10s sent %llu pkts/%llu B (%u pkt/s, %u B/s) recv %llu pkts/%llu B (%u pkt/s, %u B/s)\n", "",
+                static_cast<unsigned long long>(s.packetsSent), static_cast<unsigned long long>(s.bytesSent), s.packetsSentPerSecond,
+                s.bytesSentPerSecond, static_cast<unsigned long long>(s.packetsReceived), static_cast<unsigned long long>(s.bytesReceived),
+                s.packetsReceivedPerSecond, s.bytesReceivedPerSecond);
+}
+
+bool trackerChecks() {
+    NetplayStatsTracker t;
+    const auto t0 = NetplayStatsTracker::Clock::now();
+    t.reset(t0, 16639);
+    const uint32_t base = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(t0.time_since_epoch()).count());
+
+    // 10 probes, 100 ms apart. #3 and #7 are never answered, #5 arrives after #6, #8 is answered twice.
+    for (uint32_t i = 0; i < 10; ++i) t.onProbeSent(base + i * 100000u);
+    const uint32_t order[] = {0, 1, 2, 4, 6, 5, 8, 8, 9};
+    for (uint32_t i : order) (void)t.onProbeAnswered(base + i * 100000u, base + i * 100000u + 20000u + i * 1000u);
+    const bool unknown = !t.onProbeAnswered(base + 123u, base + 20000u);
+    t.update(t0 + std::chrono::seconds(3), 10, 120);
+
+    NetplayStats s;
+    t.fill(s);
+    bool ok = true;
+    ok = check(unknown, "answer to an unknown probe accepted") && ok;
+    ok = check(s.probesSent == 10 && s.probesAnswered == 8, "probe counts") && ok;
+    ok = check(s.lossPercent > 19.9f && s.lossPercent < 20.1f, "2 of 10 probes lost => 20%") && ok;
+    ok = check(s.duplicatePackets == 1 && s.outOfOrderPackets == 1, "one duplicate, one reordered answer") && ok;
+    ok = check(s.rttMinMicros == 20000 && s.rttMaxMicros == 29000 && s.rttSamples == 8, "RTT min/max") && ok;
+
+    // RTT distribution 1..100 ms: p99 is within one histogram bucket of 99 ms.
+    t.reset(t0, 16639);
+    for (uint32_t ms = 1; ms <= 100; ++ms) t.onRttSample(ms * 1000u);
+    t.onInputPacket(50);
+    t.onInputPacket(49);
+    t.onStall(40000);
+    t.onRollback(3);
+    t.onRollback(5);
+    t.fill(s);
+    ok = check(s.rttP99Micros >= 96000 && s.rttP99Micros <= 100000, "p99 of 1..100 ms") && ok;
+    ok = check(s.rttAvgMicros == 50500, "mean of 1..100 ms") && ok;
+    ok = check(s.jitterMicros > 500 && s.jitterMicros <= 1000, "jitter of a 1 ms ramp") && ok;
+    ok = check(s.lossPercent < 0.0f, "loss unknown without probes") && ok;
+    ok = check(s.outOfOrderPackets == 1, "older input packet counted out of order") && ok;
+    ok = check(s.stallCount == 1 && s.stalledFrames == 3 && s.maxStallMicros == 40000, "stall of 40 ms = 3 frames") && ok;
+    ok = check(s.rollbackCount == 2 && s.rolledBackFrames == 8 && s.lastRollbackDepth == 5 && s.maxRollbackDepth == 5, "rollback depth") && ok;
+    std::printf("tracker: p99 of 1..100 ms = %u us, jitter %u us: %s\n", s.rttP99Micros, s.jitterMicros, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+template <typename Session>
+bool checkSide(const char* name, const Session& session, uint32_t frames) {
+    NetplayStats s;
+    session.stats(s);
+    printStats(name, s);
+    bool ok = true;
+    ok = check(s.localFrame >= frames && s.connected, "ran every frame, connected") && ok;
+    ok = check(s.rttSamples > 0 && s.rttMinMicros <= s.rttAvgMicros && s.rttAvgMicros <= s.rttMaxMicros && s.rttP99Micros <= s.rttMaxMicros,
+               "RTT samples and ordering") && ok;
+    ok = check(s.probesSent > 0 && s.lossPercent <= 0.0f, "no probe loss on loopback") && ok;
+    ok = check(s.packetsSent == session.sentPacketCount() && s.bytesSent == session.sentByteCount(), "sent totals match the session") && ok;
+    ok = check(s.packetsReceived > 0 && s.bytesReceivedPerSecond > 0 && s.bytesSentPerSecond > 0, "traffic both ways") && ok;
+    if constexpr (std::is_same<Session, RollbackSession>::value) {
+        ok = check(s.rollbackCount == session.rollbackCount() && s.rolledBackFrames == session.rolledBackFrames(), "rollback totals") && ok;
+    }
+    return ok;
+}
+
+template <typename Session>
+bool loopbackMatch(const char* name, uint32_t frames) {
+    EmulatorEngine engA;
+    EmulatorEngine engB;
+    if (!bench::loadMockCore(engA) || !bench::loadMockCore(engB)) return false;
+
+    Session a;
+    Session b;
+    typename Session::Config ca{};
+    ca.remoteHost = "127.0.0.1";
+    ca.remotePort = kPortB;
+    ca.localPort = kPortA;
+    ca.localPlayerNum = 1;
+    // Rollback without input delay: every input change arrives late and is rolled back.
+    ca.inputDelayFrames = std::is_same<Session, RollbackSession>::value ? 0 : 2;
+    ca.engine = &engA;
+    typename Session::Config cb = ca;
+    cb.remotePort = kPortA;
+    cb.localPort = kPortB;
+    cb.localPlayerNum = 2;
+    cb.engine = &engB;
+    if (!a.start(ca) || !b.start(cb)) {
+        std::fprintf(stderr, "%s: session start failed\n", name);
+        return false;
+    }
+
+    // Polls stats() every iteration, like a front-end showing it every frame.
+    NetplayStats polled;
+    const auto timeout = bench::Clock::now() + std::chrono::seconds(30);
+    while ((a.localFrame() < frames || b.localFrame() < frames) && bench::Clock::now() < timeout) {
+        if (a.localFrame() < frames) {
+            a.setLocalInput(scriptedInput(a.localFrame(), 1));
+            a.tick();
+        }
+        if (b.localFrame() < frames) {
+            b.setLocalInput(scriptedInput(b.localFrame(), 2));
+            b.tick();
+        }
+        a.stats(polled);
+        b.stats(polled);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // Let the last pings get answered.
+    const auto settle = bench::Clock::now() + std::chrono::milliseconds(200);
+    while (bench::Clock::now() < settle) {
+        a.tick();
+        b.tick();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::printf("\n%s over loopback, %u frames:\n", name, frames);
+    bool ok = checkSide("player 1", a, frames);
+    ok = checkSide("player 2", b, frames) && ok;
+    if constexpr (std::is_same<Session, RollbackSession>::value) {
+        // Player 2 ticks after player 1 and always has its input in time; player 1 never does.
+        ok = check(a.rollbackCount() + b.rollbackCount() > 0, "late inputs rolled back") && ok;
+    }
+
+    bench::printRow("stats() (per call)", [&] {
+        bench::Samples s = bench::measure(10, 200, [&] {
+            for (int i = 0; i < kCallsPerSample; ++i) {
+                a.stats(polled);
+                bench::keep(polled.rttAvgMicros);
+            }
+        });
+        for (double& v : s.ns) v /= kCallsPerSample;
+        return s;
+    }());
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const uint32_t frames = (argc > 1) ? static_cast<uint32_t>(std::atoi(argv[1])) : 240u;
+
+    bool ok = trackerChecks();
+    ok = loopbackMatch<LockstepSession>("lockstep", frames) && ok;
+    ok = loopbackMatch<RollbackSession>("rollback", frames) && ok;
+
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+// Per-frame cost of the pixel conversion module at SNES resolutions (256x224, and 512x448 for
+// hi-res/interlaced modes), against the per-pixel loop Android/iOS videoSink used before. Every
+// case writes into a 512-pixel-wide buffer like the front-ends' g_rgba, from a source with the
+// core's 512-pixel pitch.
+//
+// Before timing, cross-checks the dispatched kernel against the portable one for every format
+// pair at widths 1..67 (all SIMD tails) with unpacked pitches, and the portable 16-bit paths
+// against the old helpers. Exits non-zero on any mismatch.
+//
+// Usage: snesonline_bench_pixel_convert
+
+#include <cstring>
+#include <vector>
+
+#include "BenchUtil.h"
+
+#include "snesonline/PixelConvert.h"
+
+using namespace snesonline;
+
+namespace {
+
+using PF = LibretroCore::PixelFormat;
+
+constexpr unsigned kStridePixels = 512;
+
+// Previous Android/iOS videoSink helpers (the XRGB8888 one byte-swapped the pixel).
+uint32_t legacyFromXRGB8888(uint32_t xrgb) {
+    const uint32_t r = (xrgb >> 8) & 0xFF;
+    const uint32_t g = (xrgb >> 16) & 0xFF;
+    const uint32_t b = (xrgb >> 24) & 0xFF;
+    return 0xFF000000u | (r << 16) | (g << 8) | b;
+}
+
+uint32_t legacyFromRGB565(uint16_t p) {
+    const uint32_t r = (p >> 11) & 0x1F;
+    const uint32_t g = (p >> 5) & 0x3F;
+    const uint32_t b = (p >> 0) & 0x1F;
+    return 0xFF000000u | (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+}
+
+uint32_t legacyFrom0RGB1555(uint16_t p) {
+    const uint32_t r = (p >> 10) & 0x1F;
+    const uint32_t g = (p >> 5) & 0x1F;
+    const uint32_t b = (p >> 0) & 0x1F;
+    return 0xFF000000u | (((r << 3) | (r >> 2)) << 16) | (((g << 3) | (g >> 2)) << 8) | ((b << 3) | (b >> 2));
+}
+
+void legacyConvert(PF fmt, const void* data, unsigned width, unsigned height, std::size_t pitchBytes, uint32_t* out) {
+    const auto* src = static_cast<const uint8_t*>(data);
+    for (unsigned y = 0; y < height; ++y) {
+        uint32_t* dst = &out[y * kStridePixels];
+        if (fmt == PF::XRGB8888) {
+            const uint32_t* row = reinterpret_cast<const uint32_t*>(src + y * pitchBytes);
+            for (unsigned x = 0; x < width; ++x) dst[x] = legacyFromXRGB8888(row[x]);
+        } else if (fmt == PF::RGB565) {
+            const uint16_t* row = reinterpret_cast<const uint16_t*>(src + y * pitchBytes);
+            for (unsigned x = 0; x < width; ++x) dst[x] = legacyFromRGB565(row[x]);
+        } else {
+            const uint16_t* row = reinterpret_cast<const uint16_t*>(src + y * pitchBytes);
+            for (unsigned x = 0; x < width; ++x) dst[x] = legacyFrom0RGB1555(row[x]);
+        }
+    }
+}
+
+const char* formatName(PF fmt) {
+    switch (fmt) {
+        case PF::XRGB1555: return "0RGB1555";
+        case PF::XRGB8888: return "XRGB8888";
+        case PF::RGB565: return "RGB565";
+    }
+    return "?";
+}
+
+unsigned bytesPerPixel(PF fmt) { return fmt == PF::XRGB8888 ? 4u : 2u; }
+
+std::vector<uint8_t> randomBytes(std::size_t n, uint32_t seed) {
+    std::vector<uint8_t> v(n);
+    uint32_t x = seed;
+    for (auto& b : v) {
+        x = x * 1664525u + 1013904223u;
+        b = static_cast<uint8_t>(x >> 24);
+    }
+    return v;
+}
+
+bool crossCheck() {
+    bool ok = true;
+    const PF formats[] = {PF::XRGB1555, PF::XRGB8888, PF::RGB565};
+    const DstPixelFormat dsts[] = {DstPixelFormat::ARGB8888, DstPixelFormat::ABGR8888};
+    constexpr unsigned kHeight = 3;
+    for (PF fmt : formats) {
+        for (DstPixelFormat dfmt : dsts) {
+            for (unsigned w = 1; w <= 67; ++w) {
+                // Odd pitches on both sides so rows never line up with the vector width.
+                const std::size_t srcPitch = w * bytesPerPixel(fmt) + 6;
+                const std::size_t dstPitch = w * 4 + 12;
+                const std::vector<uint8_t> src = randomBytes(srcPitch * kHeight, w * 7 + static_cast<uint32_t>(fmt));
+                std::vector<uint8_t> a(dstPitch * kHeight, 0xCD);
+                std::vector<uint8_t> b(dstPitch * kHeight, 0xCD);
+                convertPixels(fmt, dfmt, src.data(), srcPitch, a.data(), dstPitch, w, kHeight);
+                convertPixelsPortable(fmt, dfmt, src.data(), srcPitch, b.data(), dstPitch, w, kHeight);
+                if (a != b) {
+                    std::printf("MISMATCH %s -> %u at width %u\n", formatName(fmt), static_cast<unsigned>(dfmt), w);
+                    ok = false;
+                }
+            }
+        }
+    }
+
+    // Every 16-bit value against the old helpers.
+    std::vector<uint16_t> all(65536);
+    for (uint32_t i = 0; i < 65536; ++i) all[i] = static_cast<uint16_t>(i);
+    std::vector<uint32_t> out(65536);
+    for (PF fmt : {PF::XRGB1555, PF::RGB565}) {
+        convertPixelsPortable(fmt, DstPixelFormat::ARGB8888, all.data(), all.size() * 2, out.data(), out.size() * 4, 65536, 1);
+        for (uint32_t i = 0; i < 65536; ++i) {
+            const uint32_t want = fmt == PF::RGB565 ? legacyFromRGB565(all[i]) : legacyFrom0RGB1555(all[i]);
+            if (out[i] != want) {
+                std::printf("MISMATCH %s vs old helper at 0x%04X\n", formatName(fmt), i);
+                ok = false;
+                break;
+            }
+        }
+    }
+    return ok;
+}
+
+void costRows(PF fmt, unsigned width, unsigned height) {
+    const std::size_t srcPitch = kStridePixels * bytesPerPixel(fmt);
+    const std::vector<uint8_t> src = randomBytes(srcPitch * height, 1234);
+    std::vector<uint32_t> dst(kStridePixels * 512);
+    const std::size_t dstPitch = kStridePixels * sizeof(uint32_t);
+
+    std::printf("%s %ux%u\n", formatName(fmt), width, height);
+    bench::Samples s = bench::measure(50, 1000, [&] { legacyConvert(fmt, src.data(), width, height, srcPitch, dst.data()); });
+    bench::keep(dst[width / 2]);
+    bench::printRow("  old per-pixel loop", s);
+    s = bench::measure(50, 1000, [&] {
+        convertPixelsPortable(fmt, DstPixelFormat::ARGB8888, src.data(), srcPitch, dst.data(), dstPitch, width, height);
+    });
+    bench::keep(dst[width / 2]);
+    bench::printRow("  portable", s);
+    s = bench::measure(50, 1000, [&] {
+        convertPixels(fmt, DstPixelFormat::ARGB8888, src.data(), srcPitch, dst.data(), dstPitch, width, height);
+    });
+    bench::keep(dst[width / 2]);
+    char name[64];
+    std::snprintf(name, sizeof(name), "  dispatched (%s)", pixelConvertKernelName());
+    bench::printRow(name, s);
+}
+
+} // namespace
+
+int main() {
+    std::printf("kernel: %s\n", pixelConvertKernelName());
+    const bool ok = crossCheck();
+    std::printf("cross-check: %s\n\n", ok ? "ok" : "FAILED");
+
+    for (PF fmt : {PF::RGB565, PF::XRGB1555, PF::XRGB8888}) {
+        costRows(fmt, 256, 224);
+        costRows(fmt, 512, 448);
+    }
+    std::printf("\n%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+// Cost and output of the hot-path profiler (Profiler / SNESONLINE_PROFILE_SCOPE).
+//
+// 1. Cost of one scope: recording, runtime-disabled, and no scope at all.
+// 2. `frames` mock-core frames with a per-frame scope, plus the built-in markers when the build
+//    has SNESONLINE_ENABLE_PROFILER; prints the per-phase summary and writes a Chrome trace.
+// 3. A thread recording flat out while this one dumps repeatedly: every dump must be complete and
+//    in order (the reader never blocks the writer and never sees a torn event).
+// 4. Many more short-lived threads than Profiler::kMaxThreads, one after another (a front-end
+//    starting a loop thread per game): each must still get a ring.
+//
+// Exits non-zero if the summary or the trace miss events, a concurrent dump is inconsistent, or a
+// short-lived thread could not record.
+//
+// Usage: snesonline_bench_profiler [frames=600] [trace=snesonline_profile.json]
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+
+#include "snesonline/EmulatorEngine.h"
+#include "snesonline/Profiler.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr int kScopesPerSample = 1000;
+
+bench::Samples scopeCost(bool enabled) {
+    Profiler::setEnabled(enabled);
+    bench::Samples s = bench::measure(10, 200, [] {
+        for (int i = 0; i < kScopesPerSample; ++i) ProfileScope scope("bench.scope");
+    });
+    for (double& v : s.ns) v /= kScopesPerSample;
+    Profiler::setEnabled(true);
+    return s;
+}
+
+uint64_t countInFile(const char* path, const char* needle) {
+    std::FILE* f = std::fopen(path, "rb");
+    if (!f) return 0;
+    std::string text;
+    char buf[1 << 14];
+    std::size_t n = 0;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+    std::fclose(f);
+    uint64_t count = 0;
+    for (std::size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1)) count++;
+    return count;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int frames = (argc > 1) ? std::atoi(argv[1]) : 600;
+    const char* tracePath = (argc > 2) ? argv[2] : "snesonline_profile.json";
+    bool ok = true;
+
+    std::printf("SNESONLINE_PROFILE_SCOPE markers %s in this build\n\n", Profiler::compiledIn() ? "compiled" : "NOT compiled");
+
+    bench::printRow("scope, recording (per scope)", scopeCost(true));
+    bench::printRow("scope, runtime-disabled (per scope)", scopeCost(false));
+    bench::printRow("no scope (loop only, per iteration)", [] {
+        bench::Samples s = bench::measure(10, 200, [] {
+            for (int i = 0; i < kScopesPerSample; ++i) bench::keep(i);
+        });
+        for (double& v : s.ns) v /= kScopesPerSample;
+        return s;
+    }());
+
+    // Frames through the engine.
+    auto& eng = EmulatorEngine::instance();
+    if (!bench::loadMockCore(eng)) return 1;
+    Profiler::clear();
+    Profiler::setThreadName("bench main");
+    SaveState st;
+    for (int f = 0; f < frames; ++f) {
+        ProfileScope frame("bench.frame");
+        eng.setInputMask(0, static_cast<uint16_t>((f / 7) & 0x0FFF));
+        eng.advanceFrame();
+        if (f % 60 == 0) (void)eng.saveState(st);
+    }
+
+    std::printf("\n%d frames:\n", frames);
+    (void)Profiler::writeSummary(stdout);
+    std::vector<Profiler::PhaseStats> phases;
+    ok = Profiler::summarize(phases) && ok;
+    uint64_t frameEvents = 0;
+    for (const auto& p : phases) {
+        if (std::strcmp(p.name, "bench.frame") == 0) frameEvents = p.count;
+    }
+    ok = ok && frameEvents == static_cast<uint64_t>(frames);
+
+    if (Profiler::writeChromeTrace(tracePath)) {
+        const uint64_t inTrace = countInFile(tracePath, "\"name\":\"bench.frame\"");
+        std::printf("trace: %s (%llu frame events)\n", tracePath, static_cast<unsigned long long>(inTrace));
+        ok = ok && inTrace == static_cast<uint64_t>(frames);
+    } else {
+        std::printf("trace: failed to write %s\n", tracePath);
+        ok = false;
+    }
+
+    // Dumps while another thread records.
+    Profiler::clear();
+    std::atomic<bool> stop{false};
+    std::thread writer([&] {
+        Profiler::setThreadName("bench writer");
+        while (!stop.load(std::memory_order_relaxed)) ProfileScope scope("bench.writer");
+    });
+    uint32_t dumps = 0;
+    uint32_t bad = 0;
+    const double until = bench::nowSeconds() + 0.5;
+    while (bench::nowSeconds() < until) {
+        std::vector<Profiler::PhaseStats> snap;
+        if (!Profiler::summarize(snap)) bad++;
+        for (const auto& p : snap) {
+            if (std::strcmp(p.name, "bench.writer") == 0 && (p.count == 0 || p.count > Profiler::kEventsPerThread || p.p50Us > p.maxUs)) bad++;
+        }
+        dumps++;
+    }
+    stop.store(true, std::memory_order_relaxed);
+    writer.join();
+    std::printf("\nconcurrent: %u summaries while recording, %u inconsistent\n", dumps, bad);
+    ok = ok && bad == 0 && dumps > 0;
+
+    // Threads that come and go hand their rings on.
+    Profiler::clear();
+    const uint32_t threads = static_cast<uint32_t>(Profiler::kMaxThreads) * 4u;
+    for (uint32_t i = 0; i < threads; ++i) {
+        std::thread t([] { ProfileScope scope("bench.shortLived"); });
+        t.join();
+    }
+    std::vector<Profiler::PhaseStats> shortLived;
+    (void)Profiler::summarize(shortLived);
+    uint64_t lastThreadEvents = 0;
+    for (const auto& p : shortLived) {
+        if (std::strcmp(p.name, "bench.shortLived") == 0) lastThreadEvents = p.count;
+    }
+    std::printf("short-lived: %u threads, %llu events dropped, %llu kept\n", threads, static_cast<unsigned long long>(Profiler::droppedEvents()),
+                static_cast<unsigned long long>(lastThreadEvents));
+    ok = ok && Profiler::droppedEvents() == 0 && lastThreadEvents > 0;
+
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+// Replay recording and headless re-simulation.
+//
+// 1. Records a scripted match with ReplayWriter: per-frame record cost (disk writes included) and
+//    file size per minute of play.
+// 2. Plays it back on a fresh engine with no video/audio sinks as fast as the core allows
+//    (frames/s), and checks the end state matches the recorded checksum.
+// 3. Records an in-process lockstep match through LockstepSession::Config::replayPath on both
+//    peers and replays each file: both replays must end on the peers' final state.
+//
+// With a path argument it only plays that replay (e.g. one saved from a real match; point
+// SNESONLINE_BENCH_CORE at the core it was recorded with) and reports frames/s.
+//
+// Usage: snesonline_bench_replay [frames=36000]
+//        snesonline_bench_replay <file.snr>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include "BenchUtil.h"
+
+#include "snesonline/LockstepSession.h"
+#include "snesonline/Replay.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr uint16_t kPortA = 47390;
+constexpr uint16_t kPortB = 47391;
+
+uint16_t scriptedInput(uint32_t f, uint32_t salt) {
+    uint32_t x = ((f / 7u) + salt) * 2654435761u;
+    x ^= x >> 15;
+    return static_cast<uint16_t>(x & 0x0FFFu);
+}
+
+uint32_t stateChecksum(EmulatorEngine& eng) {
+    SaveState st;
+    return eng.saveState(st) ? st.checksum : 0u;
+}
+
+std::string tempPath(const char* name) {
+    std::error_code ec;
+    const std::filesystem::path dir = std::filesystem::temp_directory_path(ec);
+    return (ec ? std::filesystem::path(name) : dir / name).string();
+}
+
+bool play(const char* path, ReplayPlayback& out) {
+    EmulatorEngine eng;
+    if (!bench::loadMockCore(eng)) return false;
+    ReplayReader reader;
+    if (!reader.open(path)) {
+        std::fprintf(stderr, "cannot read replay: %s\n", path);
+        return false;
+    }
+    if (!playReplay(eng, reader, out)) {
+        std::fprintf(stderr, "replay does not match the loaded core/ROM, or its start state is corrupt: %s\n", path);
+        return false;
+    }
+    const ReplayHeader& h = reader.header();
+    std::printf("replay %s: core '%s' %s, %u frames from frame %u, start state %u -> %u B\n", path, h.coreName, h.coreVersion,
+                out.frames, h.startFrame, h.stateRawBytes, h.stateCompressedBytes);
+    std::printf("  re-simulated at %.0f frames/s (%.1fx real time), end state %08x %s\n",
+                static_cast<double>(out.frames) / (out.seconds > 0.0 ? out.seconds : 1e-9),
+                static_cast<double>(out.frames) / 60.0988 / (out.seconds > 0.0 ? out.seconds : 1e-9), out.endChecksum,
+                h.endChecksum == 0 ? "(no recorded checksum)" : (out.checksumMatched ? "matches" : "MISMATCH"));
+    return true;
+}
+
+bool recordAndPlay(uint32_t frames) {
+    const std::string path = tempPath("snesonline_bench_replay.snr");
+    EmulatorEngine eng;
+    if (!bench::loadMockCore(eng)) return false;
+
+    ReplayWriter writer;
+    if (!writer.open(path.c_str(), eng, 0)) {
+        std::fprintf(stderr, "cannot write replay: %s\n", path.c_str());
+        return false;
+    }
+    const uint64_t startBytes = writer.byteCount();
+    double recordNs = 0.0;
+    for (uint32_t f = 0; f < frames; ++f) {
+        const uint16_t p1 = scriptedInput(f, 1);
+        const uint16_t p2 = scriptedInput(f, 2);
+        eng.setInputMask(0, p1);
+        eng.setInputMask(1, p2);
+        eng.advanceFrame();
+        const auto t0 = bench::Clock::now();
+        writer.recordFrame(p1, p2);
+        recordNs += static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(bench::Clock::now() - t0).count());
+    }
+    const uint32_t expected = stateChecksum(eng);
+    const bool closed = writer.close(expected);
+    const double inputBytes = static_cast<double>(std::filesystem::file_size(path)) - static_cast<double>(startBytes);
+    const double minutes = static_cast<double>(frames) / 60.0988 / 60.0;
+    std::printf("record: %u frames, %.1f ns/frame, header+start state %llu B, inputs %.0f B (%.0f B per minute of play)\n", frames,
+                recordNs / static_cast<double>(frames ? frames : 1), static_cast<unsigned long long>(startBytes), inputBytes,
+                inputBytes / (minutes > 0.0 ? minutes : 1.0));
+
+    ReplayPlayback pb{};
+    const bool ok = closed && play(path.c_str(), pb) && pb.frames == frames && pb.checksumMatched;
+    std::remove(path.c_str());
+    return ok;
+}
+
+bool sessionReplays(uint32_t frames) {
+    const std::string pathA = tempPath("snesonline_bench_replay_a.snr");
+    const std::string pathB = tempPath("snesonline_bench_replay_b.snr");
+    EmulatorEngine engA;
+    EmulatorEngine engB;
+    if (!bench::loadMockCore(engA) || !bench::loadMockCore(engB)) return false;
+
+    LockstepSession a;
+    LockstepSession b;
+    LockstepSession::Config ca{};
+    ca.remoteHost = "127.0.0.1";
+    ca.remotePort = kPortB;
+    ca.localPort = kPortA;
+    ca.localPlayerNum = 1;
+    ca.inputDelayFrames = 2;
+    ca.engine = &engA;
+    ca.replayPath = pathA.c_str();
+    LockstepSession::Config cb = ca;
+    cb.remotePort = kPortA;
+    cb.localPort = kPortB;
+    cb.localPlayerNum = 2;
+    cb.engine = &engB;
+    cb.replayPath = pathB.c_str();
+    if (!a.start(ca) || !b.start(cb) || !a.replay().isOpen() || !b.replay().isOpen()) {
+        std::fprintf(stderr, "session start failed\n");
+        return false;
+    }
+
+    const auto timeout = bench::Clock::now() + std::chrono::seconds(30);
+    while ((a.localFrame() < frames || b.localFrame() < frames) && bench::Clock::now() < timeout) {
+        if (a.localFrame() < frames) {
+            a.setLocalInput(scriptedInput(a.localFrame(), 1));
+            a.tick();
+        }
+        if (b.localFrame() < frames) {
+            b.setLocalInput(scriptedInput(b.localFrame(), 2));
+            b.tick();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const uint32_t final = stateChecksum(engA);
+    a.stop();
+    b.stop();
+
+    ReplayPlayback pa{};
+    ReplayPlayback pb{};
+    const bool ok = play(pathA.c_str(), pa) && play(pathB.c_str(), pb) && pa.frames == frames && pb.frames == frames &&
+                    pa.checksumMatched && pb.checksumMatched && pa.endChecksum == final && pb.endChecksum == final;
+    std::printf("lockstep session replays: %s\n", ok ? "both end on the match's final state" : "MISMATCH");
+    std::remove(pathA.c_str());
+    std::remove(pathB.c_str());
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::atoi(argv[1]) == 0) {
+        ReplayPlayback pb{};
+        return play(argv[1], pb) ? 0 : 1;
+    }
+    const uint32_t frames = (argc > 1) ? static_cast<uint32_t>(std::atoi(argv[1])) : 36000u;
+
+    bool ok = recordAndPlay(frames);
+    ok = sessionReplays(240) && ok;
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
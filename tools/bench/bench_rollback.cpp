@@ -0,0 +1,140 @@
+// Drives a RollbackSession against a scripted UDP peer that delivers its inputs with a fixed
+// latency, then checks that the rolled-back simulation ends in exactly the same state as a
+// straight run with all inputs known up front.
+//
+// Usage: snesonline_bench_rollback [latencyFrames=4] [inputDelay=2] [frames=360]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+
+#include "NetSocket.h"
+#include "snesonline/EmulatorEngine.h"
+#include "snesonline/Hash.h"
+#include "snesonline/RollbackSession.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr uint16_t kSessionPort = 47310;
+constexpr uint16_t kPeerPort = 47311;
+
+// Remote input changes every few frames so predictions regularly miss.
+uint16_t remoteScript(uint32_t f, uint32_t delay) {
+    if (f < delay) return 0;
+    uint32_t x = (f / 5u) * 2654435761u;
+    x ^= x >> 13;
+    return static_cast<uint16_t>(x & 0x0FFFu);
+}
+
+uint64_t currentStateHash(EmulatorEngine& eng, std::vector<uint8_t>& scratch) {
+    const std::size_t sz = eng.core().serializeSize();
+    scratch.resize(sz);
+    if (!eng.core().serialize(scratch.data(), sz)) return 0;
+    return stateHash64(scratch.data(), sz);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const uint32_t latency = (argc > 1) ? static_cast<uint32_t>(std::atoi(argv[1])) : 4u;
+    const uint32_t delay = (argc > 2) ? static_cast<uint32_t>(std::atoi(argv[2])) : 2u;
+    const uint32_t frames = (argc > 3) ? static_cast<uint32_t>(std::atoi(argv[3])) : 360u;
+
+    auto& eng = EmulatorEngine::instance();
+    if (!bench::loadMockCore(eng)) return 1;
+
+    std::vector<uint8_t> initial(eng.core().serializeSize());
+    std::vector<uint8_t> scratch;
+    if (initial.empty() || !eng.core().serialize(initial.data(), initial.size())) return 1;
+
+    net::SocketHandle peer = net::kInvalidSocket;
+    if (!net::openUdpSocket(kPeerPort, peer)) {
+        std::fprintf(stderr, "failed to bind peer port %u\n", kPeerPort);
+        return 1;
+    }
+    sockaddr_in sessionAddr{};
+    net::resolveIpv4ToSockaddr("127.0.0.1", sessionAddr, kSessionPort);
+
+    RollbackSession session;
+    RollbackSession::Config cfg{};
+    cfg.remoteHost = "127.0.0.1";
+    cfg.remotePort = kPeerPort;
+    cfg.localPort = kSessionPort;
+    cfg.localPlayerNum = 1;
+    cfg.inputDelayFrames = static_cast<uint8_t>(delay);
+    if (!session.start(cfg)) {
+        std::fprintf(stderr, "session start failed\n");
+        return 1;
+    }
+
+    uint32_t nextPeerFrame = 0;
+    auto sendPeerUpTo = [&](uint32_t lastFrame) {
+        for (; nextPeerFrame <= lastFrame; ++nextPeerFrame) {
+            uint8_t pkt[8] = {};
+            const uint32_t f_be = htonl(nextPeerFrame);
+            const uint16_t m_be = htons(remoteScript(nextPeerFrame, delay));
+            std::memcpy(pkt, &f_be, 4);
+            std::memcpy(pkt + 4, &m_be, 2);
+            net::sendTo(peer, pkt, sizeof(pkt), sessionAddr);
+        }
+    };
+
+    bench::Samples tickNs;
+    session.setLocalInput(0);
+    const auto peerStart = bench::Clock::now();
+    while (session.localFrame() < frames) {
+        // The peer runs on its own 60 Hz clock. Its input for frame g is produced at its frame
+        // g - delay and lands `latency` frames later.
+        const auto peerNs = std::chrono::duration_cast<std::chrono::nanoseconds>(bench::Clock::now() - peerStart).count();
+        const uint32_t peerNow = static_cast<uint32_t>((peerNs * 60) / 1000000000);
+        if (peerNow + delay >= latency) sendPeerUpTo(peerNow + delay - latency);
+
+        const auto t0 = bench::Clock::now();
+        session.tick();
+        const auto t1 = bench::Clock::now();
+        tickNs.add(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+
+        // Drain whatever the session sent us.
+        uint8_t sink[64];
+        sockaddr_in from{};
+        while (net::recvFrom(peer, sink, sizeof(sink), from) > 0) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Deliver everything outstanding so the last frames are corrected, then let one more tick apply it.
+    sendPeerUpTo(session.localFrame() + 64);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    session.tick();
+    const uint32_t finalFrame = session.localFrame();
+    const uint64_t rolledBackHash = currentStateHash(eng, scratch);
+
+    std::printf("latency %u frames, input delay %u, %u frames\n", latency, delay, finalFrame);
+    std::printf("rollbacks %llu, re-simulated frames %llu, failed rollbacks %llu, confirmed %u\n",
+                static_cast<unsigned long long>(session.rollbackCount()),
+                static_cast<unsigned long long>(session.rolledBackFrames()),
+                static_cast<unsigned long long>(session.failedRollbacks()), session.confirmedFrame());
+    bench::printRow("tick()", tickNs);
+    session.stop();
+    net::closeSocket(peer);
+
+    // Reference: same inputs, no prediction.
+    eng.core().unserialize(initial.data(), initial.size());
+    for (uint32_t f = 0; f < finalFrame; ++f) {
+        eng.setInputMask(0, 0);
+        eng.setInputMask(1, remoteScript(f, delay));
+        eng.advanceFrame();
+    }
+    const uint64_t referenceHash = currentStateHash(eng, scratch);
+
+    const bool match = rolledBackHash == referenceHash;
+    std::printf("final state %s reference (%016llx vs %016llx)\n", match ? "matches" : "DIFFERS from",
+                static_cast<unsigned long long>(rolledBackHash), static_cast<unsigned long long>(referenceHash));
+    return match ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+// CPU cost of run-ahead (EmulatorEngine::setRunAheadFrames) per displayed frame for N = 0..4, with
+// sinks doing what the Android/iOS front-ends do (convert the frame into a 512x512 ARGB buffer,
+// push audio into an AudioRing). Run with SNESONLINE_BENCH_CORE=/path/to/snes9x for real numbers;
+// the mock core's frame and savestate costs are only rough stand-ins.
+//
+// Also checks that run-ahead does what it claims:
+//  - the emulation state and the audio after the run are identical to a run without run-ahead;
+//  - with input held steady, the picture shown for frame f is the picture frame f + N shows
+//    without run-ahead.
+// Exits non-zero if either check fails.
+//
+// Usage: snesonline_bench_run_ahead [frames=1000]
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "BenchUtil.h"
+
+#include "snesonline/AudioRing.h"
+#include "snesonline/EmulatorEngine.h"
+#include "snesonline/Hash.h"
+#include "snesonline/PixelConvert.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr unsigned kMaxW = 512;
+constexpr unsigned kMaxH = 512;
+constexpr uint32_t kMaxN = 4;
+
+struct Sinks {
+    std::vector<uint32_t> rgba = std::vector<uint32_t>(kMaxW * kMaxH);
+    AudioRing ring;
+    EmulatorEngine* engine = nullptr;
+    uint64_t lastPicture = 0;
+    uint64_t audioHash = 0;
+    uint64_t audioFrames = 0;
+};
+
+void videoSink(void* ctx, const void* data, unsigned width, unsigned height, std::size_t pitchBytes) noexcept {
+    auto* s = static_cast<Sinks*>(ctx);
+    if (!data || width > kMaxW || height > kMaxH) return;
+    convertPixels(s->engine->core().pixelFormat(), DstPixelFormat::ARGB8888, data, pitchBytes, s->rgba.data(), kMaxW * sizeof(uint32_t), width,
+                  height);
+    s->lastPicture = stateHash64(s->rgba.data(), static_cast<std::size_t>(kMaxW) * height * sizeof(uint32_t)) ^ width ^ (uint64_t{height} << 32);
+}
+
+std::size_t audioSink(void* ctx, const int16_t* stereoFrames, std::size_t frameCount) noexcept {
+    auto* s = static_cast<Sinks*>(ctx);
+    s->ring.push(stereoFrames, static_cast<uint32_t>(frameCount));
+    s->audioHash = s->audioHash * 1099511628211ull ^ stateHash64(stereoFrames, frameCount * 2 * sizeof(int16_t));
+    s->audioFrames += frameCount;
+    return frameCount;
+}
+
+uint16_t scriptedInput(uint32_t f) {
+    uint32_t x = (f / 7u) * 2654435761u;
+    x ^= x >> 15;
+    return static_cast<uint16_t>(x & 0x0FFFu);
+}
+
+uint64_t stateHash(EmulatorEngine& eng, std::vector<uint8_t>& scratch) {
+    scratch.resize(eng.core().serializeSize());
+    if (scratch.empty() || !eng.core().serialize(scratch.data(), scratch.size())) return 0;
+    return stateHash64(scratch.data(), scratch.size());
+}
+
+void drain(Sinks& s, std::vector<int16_t>& buf) {
+    while (s.ring.pop(buf.data(), 4096) == 4096) {
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int frames = (argc > 1) ? std::atoi(argv[1]) : 1000;
+
+    auto& eng = EmulatorEngine::instance();
+    if (!bench::loadMockCore(eng)) return 1;
+
+    auto sinks = std::make_unique<Sinks>();
+    sinks->engine = &eng;
+    eng.core().setVideoSink(sinks.get(), &videoSink);
+    eng.core().setAudioSink(sinks.get(), &audioSink);
+
+    std::vector<uint8_t> start(eng.core().serializeSize());
+    std::vector<uint8_t> scratch;
+    std::vector<int16_t> buf(4096 * 2);
+    if (start.empty() || !eng.core().serialize(start.data(), start.size())) return 1;
+    bool ok = true;
+
+    // Cost per displayed frame, and end state / audio against N = 0.
+    std::printf("%d displayed frames per row, savestate %zu bytes\n", frames, start.size());
+    double base = 0.0;
+    uint64_t refState = 0;
+    uint64_t refAudio = 0;
+    for (uint32_t n = 0; n <= kMaxN; ++n) {
+        if (!eng.core().unserialize(start.data(), start.size())) return 1;
+        eng.setRunAheadFrames(n);
+        sinks->audioHash = 0;
+        sinks->audioFrames = 0;
+        uint32_t f = 0;
+        const bench::Samples s = bench::measure(0, frames, [&] {
+            const uint16_t in = scriptedInput(f++);
+            eng.setInputMask(0, in);
+            eng.setInputMask(1, static_cast<uint16_t>(in ^ 0x0A50u));
+            eng.advanceFrame(FrameOutput::Present);
+            drain(*sinks, buf);
+        });
+
+        const uint64_t st = stateHash(eng, scratch);
+        if (n == 0) {
+            base = s.mean();
+            refState = st;
+            refAudio = sinks->audioHash;
+        }
+        const bool same = st == refState && sinks->audioHash == refAudio;
+        ok = ok && same;
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "run-ahead %u", n);
+        bench::printRow(name, s);
+        std::printf("  %-38s +%.1f us per frame (%.2fx), state and audio %s\n", "", (s.mean() - base) / 1000.0, base > 0.0 ? s.mean() / base : 0.0,
+                    same ? "match N=0" : "DIFFER from N=0");
+    }
+
+    // Latency: with steady input, frame f under run-ahead N shows reference frame f + N.
+    constexpr uint32_t kCheckFrames = 120;
+    std::vector<uint64_t> pictures(kCheckFrames + kMaxN);
+    if (!eng.core().unserialize(start.data(), start.size())) return 1;
+    eng.setRunAheadFrames(0);
+    eng.setInputMask(0, 0x0081u);
+    eng.setInputMask(1, 0x0400u);
+    for (uint64_t& p : pictures) {
+        eng.advanceFrame(FrameOutput::Present);
+        drain(*sinks, buf);
+        p = sinks->lastPicture;
+    }
+    std::printf("\n");
+    for (uint32_t n = 1; n <= kMaxN; ++n) {
+        if (!eng.core().unserialize(start.data(), start.size())) return 1;
+        eng.setRunAheadFrames(n);
+        uint32_t matches = 0;
+        for (uint32_t f = 0; f < kCheckFrames; ++f) {
+            eng.advanceFrame(FrameOutput::Present);
+            drain(*sinks, buf);
+            if (sinks->lastPicture == pictures[f + n]) matches++;
+        }
+        std::printf("run-ahead %u: %u/%u shown frames are %u frame(s) ahead\n", n, matches, kCheckFrames, n);
+        ok = ok && matches == kCheckFrames;
+    }
+    eng.setRunAheadFrames(0);
+
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+// Second-instance run-ahead (EmulatorEngine::setRunAheadSecondInstance) against single-instance
+// run-ahead: time the emulation thread spends per displayed frame for N = 1..4, with input that
+// changes every 7 frames (every change reloads the second instance) and with input held steady
+// (it never does after the first frame). Sinks are the ones bench_run_ahead uses. On a machine
+// with one CPU the worker competes with the emulation thread, so expect no gain there.
+//
+// Also checks that the second instance shows exactly what single-instance run-ahead shows, frame
+// by frame, and that the primary's state and audio are as without run-ahead. Exits non-zero if
+// either check fails.
+//
+// Usage: snesonline_bench_run_ahead_thread [frames=1000]
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "BenchUtil.h"
+
+#include "snesonline/AudioRing.h"
+#include "snesonline/EmulatorEngine.h"
+#include "snesonline/Hash.h"
+#include "snesonline/PixelConvert.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr unsigned kMaxW = 512;
+constexpr unsigned kMaxH = 512;
+constexpr uint32_t kMaxN = 4;
+
+struct Sinks {
+    std::vector<uint32_t> rgba = std::vector<uint32_t>(kMaxW * kMaxH);
+    AudioRing ring;
+    EmulatorEngine* engine = nullptr;
+    uint64_t lastPicture = 0;
+    uint64_t audioHash = 0;
+};
+
+// Runs on the worker thread in second-instance mode.
+void videoSink(void* ctx, const void* data, unsigned width, unsigned height, std::size_t pitchBytes) noexcept {
+    auto* s = static_cast<Sinks*>(ctx);
+    if (!data || width > kMaxW || height > kMaxH) return;
+    convertPixels(s->engine->core().pixelFormat(), DstPixelFormat::ARGB8888, data, pitchBytes, s->rgba.data(), kMaxW * sizeof(uint32_t), width,
+                  height);
+    s->lastPicture = stateHash64(s->rgba.data(), static_cast<std::size_t>(kMaxW) * height * sizeof(uint32_t)) ^ width ^ (uint64_t{height} << 32);
+}
+
+std::size_t audioSink(void* ctx, const int16_t* stereoFrames, std::size_t frameCount) noexcept {
+    auto* s = static_cast<Sinks*>(ctx);
+    s->ring.push(stereoFrames, static_cast<uint32_t>(frameCount));
+    s->audioHash = s->audioHash * 1099511628211ull ^ stateHash64(stereoFrames, frameCount * 2 * sizeof(int16_t));
+    return frameCount;
+}
+
+uint16_t scriptedInput(uint32_t f, bool steady) {
+    if (steady) return 0x0081u;
+    uint32_t x = (f / 7u) * 2654435761u;
+    x ^= x >> 15;
+    return static_cast<uint16_t>(x & 0x0FFFu);
+}
+
+uint64_t stateHash(EmulatorEngine& eng, std::vector<uint8_t>& scratch) {
+    scratch.resize(eng.core().serializeSize());
+    if (scratch.empty() || !eng.core().serialize(scratch.data(), scratch.size())) return 0;
+    return stateHash64(scratch.data(), scratch.size());
+}
+
+void drain(Sinks& s, std::vector<int16_t>& buf) {
+    while (s.ring.pop(buf.data(), 4096) == 4096) {
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int frames = (argc > 1) ? std::atoi(argv[1]) : 1000;
+
+    auto& eng = EmulatorEngine::instance();
+    if (!bench::loadMockCore(eng)) return 1;
+
+    auto sinks = std::make_unique<Sinks>();
+    sinks->engine = &eng;
+    eng.core().setVideoSink(sinks.get(), &videoSink);
+    eng.core().setAudioSink(sinks.get(), &audioSink);
+
+    std::vector<uint8_t> start(eng.core().serializeSize());
+    std::vector<uint8_t> scratch;
+    std::vector<int16_t> buf(4096 * 2);
+    if (start.empty() || !eng.core().serialize(start.data(), start.size())) return 1;
+    bool ok = true;
+
+    auto play = [&](uint32_t n, bool second, bool steady, int count, std::vector<uint64_t>* pictures) {
+        (void)eng.loadStateFrom(start.data(), start.size());
+        eng.setRunAheadFrames(n);
+        if (!eng.setRunAheadSecondInstance(second)) {
+            std::fprintf(stderr, "failed to start the second instance\n");
+            std::exit(1);
+        }
+        sinks->audioHash = 0;
+        uint32_t f = 0;
+        const bench::Samples s = bench::measure(0, count, [&] {
+            const uint16_t in = scriptedInput(f++, steady);
+            eng.setInputMask(0, in);
+            eng.setInputMask(1, static_cast<uint16_t>(in ^ 0x0A50u));
+            eng.advanceFrame(FrameOutput::Present);
+            drain(*sinks, buf);
+            if (pictures) {
+                // The checks compare this frame's picture, not the previous one.
+                eng.waitForRunAhead();
+                pictures->push_back(sinks->lastPicture);
+            }
+        });
+        eng.waitForRunAhead();
+        return s;
+    };
+
+    // Reference state and audio without run-ahead.
+    (void)play(0, false, false, frames, nullptr);
+    const uint64_t refState = stateHash(eng, scratch);
+    const uint64_t refAudio = sinks->audioHash;
+
+    std::printf("%d displayed frames per row, emulation-thread time per frame\n", frames);
+    for (const bool steady : {false, true}) {
+        std::printf("\n%s\n", steady ? "input held steady" : "input changes every 7 frames");
+        for (uint32_t n = 1; n <= kMaxN; ++n) {
+            const bench::Samples single = play(n, false, steady, frames, nullptr);
+            const uint64_t resyncs0 = eng.runAheadWorker().resyncCount();
+            const bench::Samples second = play(n, true, steady, frames, nullptr);
+            const uint64_t resyncs = eng.runAheadWorker().resyncCount() - resyncs0;
+            const bool same = steady || (stateHash(eng, scratch) == refState && sinks->audioHash == refAudio);
+            ok = ok && same;
+
+            char name[64];
+            std::snprintf(name, sizeof(name), "single-instance N=%u", n);
+            bench::printRow(name, single);
+            std::snprintf(name, sizeof(name), "second-instance N=%u", n);
+            bench::printRow(name, second);
+            std::printf("  %-38s %.2fx of single-instance, %llu resyncs, state and audio %s\n", "", single.mean() > 0.0 ? second.mean() / single.mean() : 0.0,
+                        static_cast<unsigned long long>(resyncs), same ? "match N=0" : "DIFFER from N=0");
+            (void)eng.setRunAheadSecondInstance(false);
+        }
+    }
+
+    // Same pictures as single-instance run-ahead, frame for frame, through input changes.
+    constexpr int kCheckFrames = 200;
+    std::printf("\n");
+    for (uint32_t n = 1; n <= kMaxN; ++n) {
+        std::vector<uint64_t> want;
+        std::vector<uint64_t> got;
+        (void)play(n, false, false, kCheckFrames, &want);
+        (void)play(n, true, false, kCheckFrames, &got);
+        (void)eng.setRunAheadSecondInstance(false);
+        uint32_t matches = 0;
+        for (int i = 0; i < kCheckFrames; ++i) matches += (want[i] == got[i]) ? 1u : 0u;
+        std::printf("second-instance N=%u: %u/%d shown frames match single-instance\n", n, matches, kCheckFrames);
+        ok = ok && matches == static_cast<uint32_t>(kCheckFrames);
+    }
+    eng.setRunAheadFrames(0);
+
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+// Compares the legacy GGPO save/load callback bodies (fresh SaveState + malloc + memcpy) with
+// the SnapshotRing path (serialize straight into a preallocated slot, unserialize in place).
+
+#include <cstdlib>
+#include <cstring>
+
+#include "BenchUtil.h"
+
+#include "snesonline/EmulatorEngine.h"
+#include "snesonline/SnapshotRing.h"
+
+using namespace snesonline;
+
+namespace {
+
+// Mirrors the pre-ring save_game_state_cb.
+unsigned char* legacySave(EmulatorEngine& eng, int& len) {
+    SaveState state;
+    if (!eng.saveState(state)) return nullptr;
+    auto* out = static_cast<unsigned char*>(std::malloc(state.sizeBytes));
+    if (!out) return nullptr;
+    std::memcpy(out, state.buffer.data(), state.sizeBytes);
+    len = static_cast<int>(state.sizeBytes);
+    return out;
+}
+
+// Mirrors the pre-ring load_game_state_cb.
+bool legacyLoad(EmulatorEngine& eng, const unsigned char* buffer, int len) {
+    SaveState state;
+    if (!state.buffer.allocate(static_cast<std::size_t>(len), 64)) return false;
+    std::memcpy(state.buffer.data(), buffer, static_cast<std::size_t>(len));
+    state.sizeBytes = static_cast<std::size_t>(len);
+    return eng.loadState(state);
+}
+
+} // namespace
+
+int main() {
+    auto& eng = EmulatorEngine::instance();
+    if (!bench::loadMockCore(eng)) return 1;
+
+    const std::size_t stateBytes = eng.core().serializeSize();
+    constexpr uint32_t kSlots = 10; // GGPO_MAX_PREDICTION_FRAMES + 2
+    constexpr int kIters = 2000;
+
+    std::printf("state size: %zu bytes, %u slots\n\n", stateBytes, kSlots);
+
+    // Legacy GGPO ring of malloc'd buffers.
+    unsigned char* legacy[kSlots] = {};
+    int legacyLen[kSlots] = {};
+    uint32_t frame = 0;
+
+    const auto legacySaveS = bench::measure(50, kIters, [&] {
+        const uint32_t i = frame++ % kSlots;
+        std::free(legacy[i]);
+        legacy[i] = legacySave(eng, legacyLen[i]);
+    });
+    const auto legacyLoadS = bench::measure(50, kIters, [&] {
+        const uint32_t i = frame++ % kSlots;
+        if (legacy[i]) bench::keep(legacyLoad(eng, legacy[i], legacyLen[i]));
+    });
+    for (unsigned char* p : legacy) std::free(p);
+
+    SnapshotRing ring;
+    if (!ring.allocate(stateBytes, kSlots)) {
+        std::fprintf(stderr, "ring allocation failed\n");
+        return 1;
+    }
+    frame = 0;
+    const auto ringSaveS = bench::measure(50, kIters, [&] { bench::keep(ring.save(eng, frame++)); });
+    uint32_t back = 0;
+    const auto ringLoadS = bench::measure(50, kIters, [&] { bench::keep(ring.load(eng, frame - 1 - (back++ % kSlots))); });
+
+    bench::printRow("save: legacy (alloc+malloc+memcpy)", legacySaveS);
+    bench::printRow("save: snapshot ring", ringSaveS);
+    bench::printRow("load: legacy (alloc+memcpy)", legacyLoadS);
+    bench::printRow("load: snapshot ring (in place)", ringLoadS);
+
+    std::printf("\nper save: legacy allocates %zu bytes and copies %zu bytes; ring allocates 0 and copies 0 beyond serialize\n",
+                stateBytes * 2, stateBytes);
+    std::printf("per load: legacy allocates %zu bytes and copies %zu bytes; ring allocates 0 and copies 0 beyond unserialize\n",
+                stateBytes, stateBytes);
+    return 0;
+}
@@ -0,0 +1,232 @@
+// Spectator broadcasting: a lockstep match over loopback with N spectators (SpectatorHost on
+// player 1, SpectatorSession per viewer, every emulator in this process via separate engines).
+// Half of the spectators join at the start, the rest halfway through and have to download a compressed
+// savestate and fast-forward to live.
+//
+// Reports the savestate codec (ratio, MB/s), join-to-live time, and per-spectator bandwidth while
+// live (on the wire, i.e. including 28 bytes of IPv4/UDP headers per datagram). At the end the
+// players stop and every spectator must reach the host's last frame with an identical state.
+// Exits non-zero when a spectator desyncs, never goes live, or goes over the bandwidth limits.
+//
+// Usage: snesonline_bench_spectators [spectators=8] [seconds=15]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+
+#include "snesonline/LockstepSession.h"
+#include "snesonline/Lz.h"
+#include "snesonline/SpectatorSession.h"
+
+#include "InputWire.h"
+
+using namespace snesonline;
+
+namespace {
+
+constexpr uint16_t kPortA = 47380;
+constexpr uint16_t kPortB = 47381;
+constexpr uint16_t kSpectatorPort = 47382;
+
+// Limits for the live phase, per spectator.
+constexpr double kMaxDownBytesPerSec = 600.0;
+constexpr double kMaxUpBytesPerSec = 200.0;
+constexpr double kMaxJoinToLiveSec = 3.0;
+
+uint16_t scriptedInput(uint32_t f, uint32_t salt) {
+    uint32_t x = ((f / 7u) + salt) * 2654435761u;
+    x ^= x >> 15;
+    return static_cast<uint16_t>(x & 0x0FFFu);
+}
+
+uint32_t stateChecksum(EmulatorEngine& eng) {
+    SaveState st;
+    return eng.saveState(st) ? st.checksum : 0u;
+}
+
+bool benchCodec(EmulatorEngine& eng) {
+    for (uint32_t f = 0; f < 600; ++f) {
+        eng.setInputMask(0, scriptedInput(f, 1));
+        eng.setInputMask(1, scriptedInput(f, 2));
+        eng.advanceFrame();
+    }
+    SaveState st;
+    if (!eng.saveState(st)) return false;
+
+    std::vector<uint8_t> packed(lzMaxCompressedSize(st.sizeBytes));
+    std::vector<uint8_t> raw(st.sizeBytes);
+    std::size_t packedBytes = 0;
+    std::size_t rawBytes = 0;
+    const bench::Samples c = bench::measure(3, 30, [&] {
+        packedBytes = lzCompress(st.buffer.data(), st.sizeBytes, packed.data(), packed.size());
+    });
+    const bench::Samples d = bench::measure(3, 30, [&] { rawBytes = lzDecompress(packed.data(), packedBytes, raw.data(), raw.size()); });
+    const bool same = rawBytes == st.sizeBytes && std::memcmp(raw.data(), st.buffer.data(), rawBytes) == 0;
+
+    const double mb = static_cast<double>(st.sizeBytes) / (1024.0 * 1024.0);
+    std::printf("savestate %zu B -> %zu B (%.1fx) | compress %.0f MB/s, decompress %.0f MB/s | round trip %s\n", st.sizeBytes,
+                packedBytes, static_cast<double>(st.sizeBytes) / static_cast<double>(packedBytes ? packedBytes : 1),
+                mb / (c.percentile(0.5) * 1e-9), mb / (d.percentile(0.5) * 1e-9), same ? "ok" : "MISMATCH");
+    return same && packedBytes != 0;
+}
+
+struct Viewer {
+    EmulatorEngine engine;
+    SpectatorSession session;
+    double joinAt = 0.0;
+    double liveAt = -1.0;
+    bool started = false;
+    uint64_t downMark = 0;
+    uint64_t upMark = 0;
+};
+
+uint64_t wireBytes(uint64_t payload, uint64_t packets) { return payload + packets * wire::kUdpIpv4OverheadBytes; }
+
+bool broadcast(uint32_t spectators, double seconds) {
+    EmulatorEngine engA;
+    EmulatorEngine engB;
+    if (!bench::loadMockCore(engA) || !bench::loadMockCore(engB)) return false;
+    std::vector<std::unique_ptr<Viewer>> viewers;
+    for (uint32_t i = 0; i < spectators; ++i) {
+        viewers.push_back(std::make_unique<Viewer>());
+        if (!bench::loadMockCore(viewers.back()->engine)) return false;
+        // First half at the start, the rest halfway through (past the host's snapshot reuse window).
+        viewers.back()->joinAt = (i < (spectators + 1) / 2) ? 0.2 : seconds / 2.0;
+    }
+
+    LockstepSession a;
+    LockstepSession b;
+    LockstepSession::Config ca{};
+    ca.remoteHost = "127.0.0.1";
+    ca.remotePort = kPortB;
+    ca.localPort = kPortA;
+    ca.localPlayerNum = 1;
+    ca.engine = &engA;
+    ca.spectatorPort = kSpectatorPort;
+    LockstepSession::Config cb = ca;
+    cb.remotePort = kPortA;
+    cb.localPort = kPortB;
+    cb.localPlayerNum = 2;
+    cb.engine = &engB;
+    cb.spectatorPort = 0;
+    if (!a.start(ca) || !b.start(cb) || !a.spectators().active()) {
+        std::fprintf(stderr, "session start failed\n");
+        return false;
+    }
+
+    const auto t0 = bench::Clock::now();
+    const auto elapsed = [&] { return std::chrono::duration<double>(bench::Clock::now() - t0).count(); };
+    const double measureFrom = seconds / 2.0 + kMaxJoinToLiveSec + 0.5;
+    bool marked = false;
+    double markedAt = 0.0;
+    auto nextViewerTick = t0;
+
+    while (elapsed() < seconds) {
+        a.setLocalInput(scriptedInput(a.localFrame() + 5, 1));
+        a.tick();
+        b.setLocalInput(scriptedInput(b.localFrame() + 5, 2));
+        b.tick();
+
+        const auto now = bench::Clock::now();
+        if (now >= nextViewerTick) {
+            nextViewerTick += std::chrono::microseconds(16667);
+            const double t = elapsed();
+            for (auto& v : viewers) {
+                if (!v->started && t >= v->joinAt) {
+                    SpectatorSession::Config sc{};
+                    sc.hostAddress = "127.0.0.1";
+                    sc.hostPort = kSpectatorPort;
+                    sc.engine = &v->engine;
+                    v->started = v->session.start(sc);
+                    v->joinAt = t;
+                }
+                if (!v->started) continue;
+                v->session.tick();
+                if (v->liveAt < 0.0 && v->session.live()) v->liveAt = elapsed();
+            }
+        }
+
+        if (!marked && elapsed() >= measureFrom) {
+            marked = true;
+            markedAt = elapsed();
+            for (auto& v : viewers) {
+                v->downMark = wireBytes(v->session.recvByteCount(), v->session.recvPacketCount());
+                v->upMark = wireBytes(v->session.sentByteCount(), v->session.sentPacketCount());
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const double window = elapsed() - markedAt;
+
+    // Freeze the match: B stops, A runs out of B's buffered inputs and keeps servicing spectators
+    // while it waits.
+    const auto settleUntil = bench::Clock::now() + std::chrono::milliseconds(300);
+    while (bench::Clock::now() < settleUntil) {
+        a.tick();
+        for (auto& v : viewers) v->session.tick();
+        std::this_thread::sleep_for(std::chrono::milliseconds(16));
+    }
+    const uint32_t finalFrame = a.localFrame();
+    const uint32_t hostState = stateChecksum(engA);
+    const auto drainUntil = bench::Clock::now() + std::chrono::seconds(5);
+    bool drained = false;
+    while (!drained && bench::Clock::now() < drainUntil) {
+        a.tick();
+        drained = true;
+        for (auto& v : viewers) {
+            v->session.tick();
+            drained = drained && v->session.frame() >= finalFrame;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(16));
+    }
+
+    bool ok = a.localFrame() == finalFrame;
+    std::printf("host: %u frames, %llu joins, %llu snapshot(s) of %zu -> %zu B, %llu datagrams (%llu B inputs, %llu B snapshots)\n",
+                finalFrame, static_cast<unsigned long long>(a.spectators().joinCount()),
+                static_cast<unsigned long long>(a.spectators().snapshotCount()), a.spectators().lastSnapshotRawBytes(),
+                a.spectators().lastSnapshotCompressedBytes(), static_cast<unsigned long long>(a.spectators().sentPacketCount()),
+                static_cast<unsigned long long>(a.spectators().sentInputBytes()),
+                static_cast<unsigned long long>(a.spectators().sentSnapshotBytes()));
+
+    double downTotal = 0.0;
+    for (std::size_t i = 0; i < viewers.size(); ++i) {
+        Viewer& v = *viewers[i];
+        const double down = static_cast<double>(wireBytes(v.session.recvByteCount(), v.session.recvPacketCount()) - v.downMark) / window;
+        const double up = static_cast<double>(wireBytes(v.session.sentByteCount(), v.session.sentPacketCount()) - v.upMark) / window;
+        const double joinToLive = (v.liveAt >= 0.0) ? (v.liveAt - v.joinAt) : -1.0;
+        const uint32_t st = stateChecksum(v.engine);
+        const bool vok = v.started && joinToLive >= 0.0 && joinToLive <= kMaxJoinToLiveSec && v.session.frame() == finalFrame &&
+                         st == hostState && down <= kMaxDownBytesPerSec && up <= kMaxUpBytesPerSec;
+        ok = ok && vok;
+        downTotal += down;
+        std::printf("spectator %2zu: joined at %4.1f s from frame %5u, live after %5.2f s | live %5.0f B/s down %4.0f B/s up | "
+                    "frame %u state %08x %s\n",
+                    i, v.joinAt, v.session.snapshotFrame(), joinToLive, down, up, v.session.frame(), st, vok ? "ok" : "FAIL");
+    }
+    std::printf("host upstream for %u spectators: %.1f KB/s (limits per spectator: %.0f B/s down, %.0f B/s up, live within %.1f s)\n",
+                spectators, downTotal / 1024.0, kMaxDownBytesPerSec, kMaxUpBytesPerSec, kMaxJoinToLiveSec);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const uint32_t spectators = (argc > 1) ? static_cast<uint32_t>(std::atoi(argv[1])) : 8u;
+    double seconds = (argc > 2) ? std::atof(argv[2]) : 15.0;
+    // Late joiners start halfway through and need time to go live before the measurement.
+    if (seconds < 12.0) seconds = 12.0;
+
+    EmulatorEngine codecEngine;
+    if (!bench::loadMockCore(codecEngine)) return 1;
+    bool ok = benchCodec(codecEngine);
+    codecEngine.shutdown();
+
+    ok = broadcast(spectators ? spectators : 1u, seconds) && ok;
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
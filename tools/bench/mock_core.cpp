@@ -0,0 +1,277 @@
+// Minimal deterministic libretro core used by the benchmarks.
+// It behaves like a small SNES core from the host's point of view: 128 KB WRAM, a mostly-empty
+// VRAM region, battery SRAM, a 256x224 frame and ~534 stereo samples per frame at 32040 Hz.
+//
+// Tunables (environment variables, read in retro_init):
+//   SNESONLINE_MOCK_STATE_KB      serialized state size in KiB (default 400, min 208)
+//   SNESONLINE_MOCK_AUDIO_SINGLE  1 => use retro_audio_sample instead of the batch callback
+//   SNESONLINE_MOCK_PIXEL_FORMAT  0=0RGB1555, 1=XRGB8888, 2=RGB565 (default 2, like snes9x)
+//   SNESONLINE_MOCK_CPU_ITERS     emulation work per frame (default 20000)
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32)
+#define MOCK_EXPORT extern "C" __declspec(dllexport)
+#else
+#define MOCK_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+namespace {
+
+using EnvFn = bool (*)(unsigned, void*);
+using VideoFn = void (*)(const void*, unsigned, unsigned, size_t);
+using AudioSampleFn = void (*)(int16_t, int16_t);
+using AudioBatchFn = size_t (*)(const int16_t*, size_t);
+using InputPollFn = void (*)();
+using InputStateFn = int16_t (*)(unsigned, unsigned, unsigned, unsigned);
+
+constexpr unsigned kEnvSetPixelFormat = 10;
+constexpr unsigned kEnvGetAudioVideoEnable = 47 | 0x10000;
+
+constexpr unsigned kWidth = 256;
+constexpr unsigned kHeight = 224;
+constexpr double kFps = 60.098813897440515; // NTSC SNES
+constexpr double kSampleRate = 32040.0;
+constexpr std::size_t kWramBytes = 128 * 1024;
+constexpr std::size_t kVramBytes = 64 * 1024;
+constexpr std::size_t kSramBytes = 8 * 1024;
+constexpr std::size_t kHeaderBytes = 16;
+
+EnvFn g_env = nullptr;
+VideoFn g_video = nullptr;
+AudioSampleFn g_audioSample = nullptr;
+AudioBatchFn g_audioBatch = nullptr;
+InputPollFn g_inputPoll = nullptr;
+InputStateFn g_inputState = nullptr;
+
+std::size_t g_stateBytes = 400 * 1024;
+bool g_audioSingle = false;
+int g_pixelFormat = 2;
+uint32_t g_cpuIters = 20000;
+
+// Serialized layout: header | WRAM | VRAM | filler. SRAM lives outside the state like real cores.
+// Plain malloc'd storage: no static destructors, since hosts may deinit from their own atexit path.
+uint8_t* g_state = nullptr;
+uint8_t g_sram[kSramBytes];
+alignas(64) uint32_t g_frame32[kWidth * kHeight];
+int16_t g_audio[2 * 1024];
+
+struct Header {
+    uint32_t frame;
+    uint32_t rng;
+    // Fractional audio frames carried between frames; part of the state like a real APU's.
+    double audioPhase;
+};
+static_assert(sizeof(Header) == kHeaderBytes, "header layout");
+
+Header* header() { return reinterpret_cast<Header*>(g_state); }
+uint8_t* wram() { return g_state + kHeaderBytes; }
+uint8_t* vram() { return g_state + kHeaderBytes + kWramBytes; }
+
+uint32_t xorshift32(uint32_t& s) {
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+}
+
+long envLong(const char* name, long fallback) {
+    const char* v = std::getenv(name);
+    if (!v || !v[0]) return fallback;
+    char* end = nullptr;
+    const long n = std::strtol(v, &end, 10);
+    return (end && end != v) ? n : fallback;
+}
+
+uint16_t pollInputMask(unsigned port) {
+    if (!g_inputState) return 0;
+    uint16_t m = 0;
+    for (unsigned id = 0; id < 12; ++id) {
+        if (g_inputState(port, 1, 0, id)) m |= static_cast<uint16_t>(1u << id);
+    }
+    return m;
+}
+
+void render(uint32_t seed) {
+    // A cheap but non-trivial "PPU": gradient + per-frame scroll, in the negotiated format.
+    if (g_pixelFormat == 1) {
+        for (unsigned y = 0; y < kHeight; ++y) {
+            uint32_t* row = &g_frame32[y * kWidth];
+            for (unsigned x = 0; x < kWidth; ++x) {
+                const uint32_t v = (x + seed) ^ (y * 3u);
+                row[x] = ((v & 0xFFu) << 16) | (((v >> 1) & 0xFFu) << 8) | ((v >> 2) & 0xFFu);
+            }
+        }
+        if (g_video) g_video(g_frame32, kWidth, kHeight, kWidth * sizeof(uint32_t));
+    } else {
+        auto* fb = reinterpret_cast<uint16_t*>(g_frame32);
+        for (unsigned y = 0; y < kHeight; ++y) {
+            uint16_t* row = &fb[y * kWidth];
+            for (unsigned x = 0; x < kWidth; ++x) {
+                row[x] = static_cast<uint16_t>((x + seed) ^ (y * 3u));
+            }
+        }
+        if (g_video) g_video(fb, kWidth, kHeight, kWidth * sizeof(uint16_t));
+    }
+}
+
+void mix(bool enabled) {
+    // Accumulate fractional samples so the average rate matches kSampleRate / kFps.
+    double& phase = header()->audioPhase;
+    phase += kSampleRate / kFps;
+    const std::size_t frames = static_cast<std::size_t>(phase);
+    phase -= static_cast<double>(frames);
+    if (!enabled) return;
+
+    for (std::size_t i = 0; i < frames; ++i) {
+        const int16_t s = static_cast<int16_t>(((header()->frame * 977u + static_cast<uint32_t>(i) * 131u) & 0x3FFFu) - 0x2000);
+        g_audio[i * 2 + 0] = s;
+        g_audio[i * 2 + 1] = static_cast<int16_t>(-s);
+    }
+    if (g_audioSingle && g_audioSample) {
+        for (std::size_t i = 0; i < frames; ++i) g_audioSample(g_audio[i * 2], g_audio[i * 2 + 1]);
+    } else if (g_audioBatch) {
+        g_audioBatch(g_audio, frames);
+    }
+}
+
+} // namespace
+
+MOCK_EXPORT void retro_set_environment(EnvFn fn) { g_env = fn; }
+MOCK_EXPORT void retro_set_video_refresh(VideoFn fn) { g_video = fn; }
+MOCK_EXPORT void retro_set_audio_sample(AudioSampleFn fn) { g_audioSample = fn; }
+MOCK_EXPORT void retro_set_audio_sample_batch(AudioBatchFn fn) { g_audioBatch = fn; }
+MOCK_EXPORT void retro_set_input_poll(InputPollFn fn) { g_inputPoll = fn; }
+MOCK_EXPORT void retro_set_input_state(InputStateFn fn) { g_inputState = fn; }
+
+MOCK_EXPORT unsigned retro_api_version() { return 1; }
+
+MOCK_EXPORT void retro_get_system_info(void* out) {
+    struct Info {
+        const char* library_name;
+        const char* library_version;
+        const char* valid_extensions;
+        bool need_fullpath;
+        bool block_extract;
+    };
+    Info* info = static_cast<Info*>(out);
+    info->library_name = "snesonline mock";
+    info->library_version = "1";
+    info->valid_extensions = "sfc|smc";
+    info->need_fullpath = true;
+    info->block_extract = false;
+}
+
+MOCK_EXPORT void retro_init() {
+    long kb = envLong("SNESONLINE_MOCK_STATE_KB", 400);
+    const long minKb = static_cast<long>((kHeaderBytes + kWramBytes + kVramBytes + 1023) / 1024) + 16;
+    if (kb < minKb) kb = minKb;
+    g_stateBytes = static_cast<std::size_t>(kb) * 1024u;
+    g_audioSingle = envLong("SNESONLINE_MOCK_AUDIO_SINGLE", 0) != 0;
+    g_pixelFormat = static_cast<int>(envLong("SNESONLINE_MOCK_PIXEL_FORMAT", 2));
+    if (g_pixelFormat < 0 || g_pixelFormat > 2) g_pixelFormat = 2;
+    g_cpuIters = static_cast<uint32_t>(envLong("SNESONLINE_MOCK_CPU_ITERS", 20000));
+
+    std::free(g_state);
+    g_state = static_cast<uint8_t*>(std::calloc(g_stateBytes, 1));
+    std::memset(g_sram, 0, sizeof(g_sram));
+    header()->rng = 0x12345678u;
+    header()->audioPhase = 0.0;
+}
+
+MOCK_EXPORT void retro_deinit() {
+    std::free(g_state);
+    g_state = nullptr;
+}
+
+MOCK_EXPORT bool retro_load_game(const void* /*info*/) {
+    if (g_env) {
+        int fmt = g_pixelFormat;
+        g_env(kEnvSetPixelFormat, &fmt);
+    }
+    return g_state != nullptr;
+}
+
+MOCK_EXPORT void retro_unload_game() {}
+
+struct MockGeometry {
+    unsigned base_width;
+    unsigned base_height;
+    unsigned max_width;
+    unsigned max_height;
+    float aspect_ratio;
+};
+struct MockTiming {
+    double fps;
+    double sample_rate;
+};
+struct MockAvInfo {
+    MockGeometry geometry;
+    MockTiming timing;
+};
+
+MOCK_EXPORT void retro_get_system_av_info(void* out) {
+    auto* av = static_cast<MockAvInfo*>(out);
+    av->geometry = {kWidth, kHeight, 512, 448, 4.0f / 3.0f};
+    av->timing = {kFps, kSampleRate};
+}
+
+MOCK_EXPORT void retro_run() {
+    if (!g_state) return;
+    if (g_inputPoll) g_inputPoll();
+
+    int avEnable = 3; // video + audio
+    if (!g_env || !g_env(kEnvGetAudioVideoEnable, &avEnable)) avEnable = 3;
+
+    Header* h = header();
+    const uint16_t p0 = pollInputMask(0);
+    const uint16_t p1 = pollInputMask(1);
+    uint32_t rng = h->rng ^ (static_cast<uint32_t>(p0) << 16) ^ p1 ^ (h->frame * 2654435761u);
+    if (rng == 0) rng = 1;
+
+    // "CPU": scattered read-modify-write traffic over WRAM, plus occasional VRAM/SRAM writes.
+    uint8_t* w = wram();
+    for (uint32_t i = 0; i < g_cpuIters; ++i) {
+        const uint32_t r = xorshift32(rng);
+        const uint32_t a = r & (kWramBytes - 1u);
+        w[a] = static_cast<uint8_t>(w[a] + (r >> 24) + 1u);
+    }
+    const uint32_t va = xorshift32(rng) & (kVramBytes - 1u) & ~63u;
+    std::memset(vram() + va, static_cast<int>(h->frame & 0xFFu), 64);
+    if (p0 & (1u << 3)) g_sram[h->frame % kSramBytes] ^= 0x5Au; // START touches SRAM
+
+    h->rng = rng;
+    h->frame++;
+
+    if (avEnable & 1) render(h->frame);
+    mix((avEnable & 2) != 0);
+}
+
+MOCK_EXPORT size_t retro_serialize_size() { return g_stateBytes; }
+
+MOCK_EXPORT bool retro_serialize(void* data, size_t size) {
+    if (!data || size < g_stateBytes || !g_state) return false;
+    std::memcpy(data, g_state, g_stateBytes);
+    return true;
+}
+
+MOCK_EXPORT bool retro_unserialize(const void* data, size_t size) {
+    if (!data || size < g_stateBytes || !g_state) return false;
+    std::memcpy(g_state, data, g_stateBytes);
+    return true;
+}
+
+MOCK_EXPORT void* retro_get_memory_data(unsigned id) {
+    if (id == 0) return g_sram;
+    if (id == 2 && g_state) return wram();
+    return nullptr;
+}
+
+MOCK_EXPORT size_t retro_get_memory_size(unsigned id) {
+    if (id == 0) return kSramBytes;
+    if (id == 2) return kWramBytes;
+    return 0;
+}
@@ -0,0 +1,233 @@
+#include "NetemProxy.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace snesonline::netem {
+
+NetemProxy::~NetemProxy() noexcept { close(); }
+
+bool NetemProxy::open(const Config& cfg) noexcept {
+    close();
+    rng_.seed(cfg.seed);
+
+    if (!net::openUdpSocket(cfg.listenPortA, sockA_) || !net::openUdpSocket(cfg.listenPortB, sockB_)) {
+        close();
+        return false;
+    }
+
+    // A -> B arrives on A's listen socket and leaves from B's, so B sees the proxy as its peer.
+    aToB_ = {};
+    aToB_.inSock = sockA_;
+    aToB_.outSock = sockB_;
+    bToA_ = {};
+    bToA_.inSock = sockB_;
+    bToA_.outSock = sockA_;
+
+    if (cfg.peerHostB && cfg.peerHostB[0] && cfg.peerPortB != 0) {
+        aToB_.toKnown = net::resolveIpv4ToSockaddr(cfg.peerHostB, aToB_.to, cfg.peerPortB);
+    }
+    if (cfg.peerHostA && cfg.peerHostA[0] && cfg.peerPortA != 0) {
+        bToA_.toKnown = net::resolveIpv4ToSockaddr(cfg.peerHostA, bToA_.to, cfg.peerPortA);
+    }
+    return true;
+}
+
+void NetemProxy::close() noexcept {
+    stop();
+    net::closeSocket(sockA_);
+    net::closeSocket(sockB_);
+    aToB_ = {};
+    bToA_ = {};
+}
+
+void NetemProxy::setImpairment(const Impairment& aToB, const Impairment& bToA) noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    aToB_.imp = aToB;
+    bToA_.imp = bToA;
+}
+
+void NetemProxy::setBlackhole(bool on) noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    aToB_.imp.blackhole = on;
+    bToA_.imp.blackhole = on;
+}
+
+DirectionStats NetemProxy::statsAToB() const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return aToB_.stats;
+}
+
+DirectionStats NetemProxy::statsBToA() const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bToA_.stats;
+}
+
+bool NetemProxy::later_(const Pending& a, const Pending& b) noexcept {
+    return (a.due != b.due) ? (a.due > b.due) : (a.seq > b.seq);
+}
+
+bool NetemProxy::chance_(double pct) noexcept {
+    if (pct <= 0.0) return false;
+    if (pct >= 100.0) return true;
+    return std::uniform_real_distribution<double>(0.0, 100.0)(rng_) < pct;
+}
+
+void NetemProxy::enqueue_(Direction& d, const uint8_t* data, std::size_t size, Clock::time_point now, uint32_t extraUs) noexcept {
+    int64_t us = static_cast<int64_t>(d.imp.latencyMs) * 1000 + extraUs;
+    if (d.imp.jitterMs) {
+        const int64_t j = static_cast<int64_t>(d.imp.jitterMs) * 1000;
+        us += std::uniform_int_distribution<int64_t>(-j, j)(rng_);
+    }
+    if (us < 0) us = 0;
+
+    Pending p;
+    p.due = now + std::chrono::microseconds(us);
+    p.seq = seq_++;
+    p.data.assign(data, data + size);
+    d.queue.push_back(std::move(p));
+    std::push_heap(d.queue.begin(), d.queue.end(), &NetemProxy::later_);
+}
+
+void NetemProxy::receive_(Direction& d, Direction& reverse, Clock::time_point now) noexcept {
+    uint8_t buf[2048];
+    sockaddr_in from{};
+    int n = 0;
+    while ((n = net::recvFrom(d.inSock, buf, sizeof(buf), from)) > 0) {
+        d.stats.received++;
+        // Learn the sender so replies travelling the other way reach it.
+        if (!reverse.toKnown) {
+            reverse.to = from;
+            reverse.toKnown = true;
+        }
+
+        if (d.imp.blackhole) {
+            d.stats.blackholed++;
+            continue;
+        }
+        if (d.burstBad) {
+            if (chance_(d.imp.burstExitPct)) d.burstBad = false;
+        } else if (chance_(d.imp.burstEnterPct)) {
+            d.burstBad = true;
+        }
+        if (d.burstBad && chance_(d.imp.burstLossPct)) {
+            d.stats.burstLost++;
+            continue;
+        }
+        if (chance_(d.imp.lossPct)) {
+            d.stats.lost++;
+            continue;
+        }
+
+        uint32_t extraUs = 0;
+        if (chance_(d.imp.reorderPct)) {
+            extraUs = d.imp.reorderMs * 1000u;
+            d.stats.reordered++;
+        }
+        enqueue_(d, buf, static_cast<std::size_t>(n), now, extraUs);
+        if (chance_(d.imp.duplicatePct)) {
+            enqueue_(d, buf, static_cast<std::size_t>(n), now, 0);
+            d.stats.duplicated++;
+        }
+    }
+}
+
+void NetemProxy::flush_(Direction& d, Clock::time_point now) noexcept {
+    while (!d.queue.empty() && d.queue.front().due <= now) {
+        std::pop_heap(d.queue.begin(), d.queue.end(), &NetemProxy::later_);
+        Pending p = std::move(d.queue.back());
+        d.queue.pop_back();
+        if (!d.toKnown) continue;
+        if (net::sendTo(d.outSock, p.data.data(), p.data.size(), d.to)) {
+            d.stats.forwarded++;
+            d.stats.bytesForwarded += p.data.size();
+        }
+    }
+}
+
+void NetemProxy::pump() noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto now = Clock::now();
+    receive_(aToB_, bToA_, now);
+    receive_(bToA_, aToB_, now);
+    flush_(aToB_, now);
+    flush_(bToA_, now);
+}
+
+bool NetemProxy::start() noexcept {
+    if (thread_.joinable()) return true;
+    running_.store(true);
+    try {
+        thread_ = std::thread([this] {
+            while (running_.load()) {
+                pump();
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        });
+    } catch (...) {
+        running_.store(false);
+        return false;
+    }
+    return true;
+}
+
+void NetemProxy::stop() noexcept {
+    running_.store(false);
+    if (thread_.joinable()) thread_.join();
+}
+
+bool parseImpairment(const char* spec, Impairment& out) noexcept {
+    if (!spec) return false;
+    const std::string s(spec);
+    std::size_t pos = 0;
+    while (pos < s.size()) {
+        std::size_t end = s.find(',', pos);
+        if (end == std::string::npos) end = s.size();
+        const std::string item = s.substr(pos, end - pos);
+        pos = end + 1;
+        if (item.empty()) continue;
+
+        const std::size_t eq = item.find('=');
+        if (eq == std::string::npos) return false;
+        const std::string key = item.substr(0, eq);
+        const std::string val = item.substr(eq + 1);
+
+        // Up to three ':'-separated numbers.
+        double v[3] = {0.0, 0.0, 0.0};
+        int count = 0;
+        const char* p = val.c_str();
+        while (*p && count < 3) {
+            char* next = nullptr;
+            v[count++] = std::strtod(p, &next);
+            if (next == p || v[count - 1] < 0.0) return false;
+            p = next;
+            if (*p == ':') ++p;
+            else if (*p) return false;
+        }
+        if (count == 0) return false;
+
+        if (key == "latency") {
+            out.latencyMs = static_cast<uint32_t>(v[0]);
+        } else if (key == "jitter") {
+            out.jitterMs = static_cast<uint32_t>(v[0]);
+        } else if (key == "loss") {
+            out.lossPct = v[0];
+        } else if (key == "burst") {
+            out.burstEnterPct = v[0];
+            if (count > 1) out.burstExitPct = v[1];
+            if (count > 2) out.burstLossPct = v[2];
+        } else if (key == "reorder") {
+            out.reorderPct = v[0];
+            if (count > 1) out.reorderMs = static_cast<uint32_t>(v[1]);
+        } else if (key == "dup") {
+            out.duplicatePct = v[0];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace snesonline::netem
@@ -0,0 +1,130 @@
+#pragma once
+
+// Loopback UDP impairment proxy. Sits between two peers: peer A talks to listenPortA, peer B to
+// listenPortB, and every datagram is forwarded to the other side after the configured impairments.
+// Used by the snesonline_netem tool and the netplay soak benchmark.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "NetSocket.h"
+
+namespace snesonline::netem {
+
+// Per-direction impairments. Percentages are 0..100.
+struct Impairment {
+    uint32_t latencyMs = 0;
+    // Uniform +-jitterMs around latencyMs. Large jitter reorders packets on its own.
+    uint32_t jitterMs = 0;
+    // Independent random loss.
+    double lossPct = 0.0;
+    // Gilbert-Elliott burst loss: chance per packet to enter the bad state, chance to leave it,
+    // and loss while in it.
+    double burstEnterPct = 0.0;
+    double burstExitPct = 25.0;
+    double burstLossPct = 100.0;
+    // Chance that a packet is held back by an extra reorderMs (arrives after later packets).
+    double reorderPct = 0.0;
+    uint32_t reorderMs = 20;
+    // Chance that a packet is delivered twice (the copy gets its own delay).
+    double duplicatePct = 0.0;
+    // While true, everything is dropped (simulated outage).
+    bool blackhole = false;
+};
+
+struct DirectionStats {
+    uint64_t received = 0;
+    uint64_t forwarded = 0;
+    uint64_t bytesForwarded = 0;
+    uint64_t lost = 0;       // random loss
+    uint64_t burstLost = 0;  // Gilbert-Elliott bad state
+    uint64_t blackholed = 0; // outage
+    uint64_t reordered = 0;
+    uint64_t duplicated = 0;
+};
+
+class NetemProxy {
+public:
+    struct Config {
+        uint16_t listenPortA = 0;
+        uint16_t listenPortB = 0;
+        // Where to forward to. Empty host => learn the peer from the first datagram it sends us.
+        const char* peerHostA = "127.0.0.1";
+        uint16_t peerPortA = 0;
+        const char* peerHostB = "127.0.0.1";
+        uint16_t peerPortB = 0;
+        uint32_t seed = 1;
+    };
+
+    NetemProxy() noexcept = default;
+    ~NetemProxy() noexcept;
+
+    NetemProxy(const NetemProxy&) = delete;
+    NetemProxy& operator=(const NetemProxy&) = delete;
+
+    bool open(const Config& cfg) noexcept;
+    void close() noexcept;
+
+    // Impairments for datagrams travelling A -> B and B -> A. Safe to call while running.
+    void setImpairment(const Impairment& aToB, const Impairment& bToA) noexcept;
+    void setImpairment(const Impairment& both) noexcept { setImpairment(both, both); }
+    void setBlackhole(bool on) noexcept;
+
+    // Receives and forwards whatever is due. Call often, or use start().
+    void pump() noexcept;
+
+    // Pumps on a background thread (~0.2 ms resolution).
+    bool start() noexcept;
+    void stop() noexcept;
+
+    DirectionStats statsAToB() const noexcept;
+    DirectionStats statsBToA() const noexcept;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Pending {
+        Clock::time_point due;
+        uint64_t seq = 0;
+        std::vector<uint8_t> data;
+    };
+
+    struct Direction {
+        net::SocketHandle inSock = net::kInvalidSocket;  // receives from the sender
+        net::SocketHandle outSock = net::kInvalidSocket; // forwards to the receiver (its own listen socket)
+        sockaddr_in to{};
+        bool toKnown = false;
+        Impairment imp;
+        bool burstBad = false;
+        std::vector<Pending> queue; // min-heap on (due, seq)
+        DirectionStats stats;
+    };
+
+    void receive_(Direction& d, Direction& reverse, Clock::time_point now) noexcept;
+    void enqueue_(Direction& d, const uint8_t* data, std::size_t size, Clock::time_point now, uint32_t extraUs) noexcept;
+    void flush_(Direction& d, Clock::time_point now) noexcept;
+    bool chance_(double pct) noexcept;
+    static bool later_(const Pending& a, const Pending& b) noexcept;
+
+    net::SocketHandle sockA_ = net::kInvalidSocket;
+    net::SocketHandle sockB_ = net::kInvalidSocket;
+    Direction aToB_;
+    Direction bToA_;
+    uint64_t seq_ = 0;
+    std::mt19937_64 rng_{1};
+
+    mutable std::mutex mutex_;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
+
+// Parses "latency=40,jitter=10,loss=2,burst=1:25:100,reorder=5:20,dup=1" into `out`.
+// Unknown keys or malformed values return false.
+bool parseImpairment(const char* spec, Impairment& out) noexcept;
+
+} // namespace snesonline::netem
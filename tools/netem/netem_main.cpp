@@ -0,0 +1,149 @@
+// snesonline_netem: local UDP impairment proxy for reproducing bad networks without a WAN link.
+//
+// Point peer A at --a-listen and peer B at --b-listen; each side's traffic is forwarded to the
+// other after the configured impairments. Works with any of the netplay protocols (lockstep,
+// rollback, GGPO, the Android/iOS UdpNetplay loop) since it only forwards datagrams.
+//
+// Example (two local instances on 7000/7001; one command line):
+//   snesonline_netem --a-listen 7100 --a-peer 127.0.0.1:7000 --b-listen 7101 --b-peer 127.0.0.1:7001
+//                    --impair latency=40,jitter=8,loss=1,burst=0.5:30,reorder=2:15,dup=1
+//   instance A: local 7000, remote 127.0.0.1:7100
+//   instance B: local 7001, remote 127.0.0.1:7101
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "NetemProxy.h"
+
+using namespace snesonline;
+
+namespace {
+
+std::atomic<bool> g_running{true};
+
+void onSignal(int) { g_running.store(false); }
+
+void usage() {
+    std::fprintf(stderr,
+                 "usage: snesonline_netem --a-listen PORT --b-listen PORT [--a-peer HOST:PORT] [--b-peer HOST:PORT]\n"
+                 "                        [--impair SPEC] [--a2b SPEC] [--b2a SPEC] [--outage MS:EVERY_MS] [--seed N]\n"
+                 "  SPEC: comma-separated latency=MS, jitter=MS, loss=PCT, burst=ENTER:EXIT[:LOSS] (pct),\n"
+                 "        reorder=PCT[:MS], dup=PCT\n"
+                 "  Peers without --x-peer are learned from the first datagram they send.\n");
+}
+
+bool parseEndpoint(const char* s, std::string& host, uint16_t& port) {
+    const char* colon = std::strrchr(s, ':');
+    if (!colon || colon == s) return false;
+    const int p = std::atoi(colon + 1);
+    if (p <= 0 || p > 65535) return false;
+    host.assign(s, colon);
+    port = static_cast<uint16_t>(p);
+    return true;
+}
+
+void printStats(const char* label, const netem::DirectionStats& s) {
+    std::printf("  %s rx %8llu fwd %8llu (%9llu B) lost %6llu burst %6llu outage %6llu reord %6llu dup %6llu\n", label,
+                static_cast<unsigned long long>(s.received), static_cast<unsigned long long>(s.forwarded),
+                static_cast<unsigned long long>(s.bytesForwarded), static_cast<unsigned long long>(s.lost),
+                static_cast<unsigned long long>(s.burstLost), static_cast<unsigned long long>(s.blackholed),
+                static_cast<unsigned long long>(s.reordered), static_cast<unsigned long long>(s.duplicated));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    netem::NetemProxy::Config cfg{};
+    std::string hostA;
+    std::string hostB;
+    cfg.peerHostA = "";
+    cfg.peerHostB = "";
+    netem::Impairment aToB;
+    netem::Impairment bToA;
+    uint32_t outageMs = 0;
+    uint32_t outageEveryMs = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = val != nullptr;
+        if (std::strcmp(arg, "--a-listen") == 0 && ok) {
+            cfg.listenPortA = static_cast<uint16_t>(std::atoi(val));
+        } else if (std::strcmp(arg, "--b-listen") == 0 && ok) {
+            cfg.listenPortB = static_cast<uint16_t>(std::atoi(val));
+        } else if (std::strcmp(arg, "--a-peer") == 0 && ok) {
+            ok = parseEndpoint(val, hostA, cfg.peerPortA);
+        } else if (std::strcmp(arg, "--b-peer") == 0 && ok) {
+            ok = parseEndpoint(val, hostB, cfg.peerPortB);
+        } else if (std::strcmp(arg, "--impair") == 0 && ok) {
+            ok = netem::parseImpairment(val, aToB) && netem::parseImpairment(val, bToA);
+        } else if (std::strcmp(arg, "--a2b") == 0 && ok) {
+            ok = netem::parseImpairment(val, aToB);
+        } else if (std::strcmp(arg, "--b2a") == 0 && ok) {
+            ok = netem::parseImpairment(val, bToA);
+        } else if (std::strcmp(arg, "--outage") == 0 && ok) {
+            ok = std::sscanf(val, "%u:%u", &outageMs, &outageEveryMs) == 2 && outageEveryMs > outageMs;
+        } else if (std::strcmp(arg, "--seed") == 0 && ok) {
+            cfg.seed = static_cast<uint32_t>(std::strtoul(val, nullptr, 10));
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::fprintf(stderr, "bad argument: %s\n", arg);
+            usage();
+            return 2;
+        }
+        ++i;
+    }
+    if (cfg.listenPortA == 0 || cfg.listenPortB == 0) {
+        usage();
+        return 2;
+    }
+    cfg.peerHostA = hostA.c_str();
+    cfg.peerHostB = hostB.c_str();
+
+    netem::NetemProxy proxy;
+    if (!proxy.open(cfg)) {
+        std::fprintf(stderr, "failed to bind %u/%u\n", cfg.listenPortA, cfg.listenPortB);
+        return 1;
+    }
+    proxy.setImpairment(aToB, bToA);
+    if (!proxy.start()) return 1;
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::printf("forwarding A:%u <-> B:%u (Ctrl+C to stop)\n", cfg.listenPortA, cfg.listenPortB);
+
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    auto nextReport = start + std::chrono::seconds(1);
+    bool inOutage = false;
+    while (g_running.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const auto now = Clock::now();
+        if (outageEveryMs) {
+            const auto ms = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count());
+            const bool want = (ms % outageEveryMs) >= outageEveryMs - outageMs;
+            if (want != inOutage) {
+                inOutage = want;
+                proxy.setBlackhole(inOutage);
+                std::printf("outage %s\n", inOutage ? "begin" : "end");
+            }
+        }
+        if (now >= nextReport) {
+            nextReport += std::chrono::seconds(1);
+            printStats("A->B", proxy.statsAToB());
+            printStats("B->A", proxy.statsBToA());
+            std::fflush(stdout);
+        }
+    }
+
+    proxy.close();
+    return 0;
+}